@@ -0,0 +1,249 @@
+//! Per-process EL0 access to the cycle counter and the virtual counter.
+//!
+//! A benchmark that wants sub-microsecond timing opts in with
+//! `prctl(PR_AKUMA_EL0_COUNTERS, mask)` (`sys_prctl`).  After that its
+//! threads may `mrs pmccntr_el0` (PMUv3 cycle counter, read-only via
+//! PMUSERENR_EL0.CR) and `mrs cntvct_el0` (CNTKCTL_EL1.EL0VCTEN) without
+//! trapping.  Everyone else keeps trapping on the cycle counter, so one
+//! process's grant never leaks into another's.
+//!
+//! Grants belong to an address space, keyed by its L0 table: threads and
+//! CLONE_VM/vfork children share it, a fork child starts without it, and
+//! `UserAddressSpace`'s drop revokes it.  The scheduler calls [`switch_to`]
+//! after loading TTBR0 and rewrites the two enable bits only when the grant
+//! changes, so the switch path costs one atomic load while no one has opted
+//! in.  The enable registers and the cycle counter are per PE and EL0 runs
+//! on the secondaries too (pinned processes, R4b.4), so every core starts
+//! its own counter ([`init`]) and remembers its own applied mask.
+//!
+//! With the time page enabled `CNTVCT_EL0` is already readable by everyone
+//! (`timer::enable_el0_counter_access`); a `CNTVCT` grant is then a no-op
+//! that is still reported back, and only `PMCCNTR` is switched per process.
+
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+
+use crate::runtime::with_irqs_disabled;
+use crate::threading::{current_cpu, MAX_CPUS};
+
+/// Grant bit: EL0 may read `CNTVCT_EL0` / `CNTFRQ_EL0`.
+pub const EL0_CNTVCT: u64 = 1 << 0;
+/// Grant bit: EL0 may read `PMCCNTR_EL0` (needs PMUv3).
+pub const EL0_PMCCNTR: u64 = 1 << 1;
+pub const EL0_ALL: u64 = EL0_CNTVCT | EL0_PMCCNTR;
+
+/// Address spaces that can hold a grant at once.  Benchmarks are few; a
+/// full table is reported as `EBUSY` by the prctl.
+const MAX_GRANTS: usize = 32;
+
+/// The L0 table PA inside a TTBR0 value (drops the ASID and CnP bit).
+const L0_MASK: u64 = 0x0000_FFFF_FFFF_F000;
+
+/// Each entry is `l0_pa | mask` (the mask fits in the page offset), 0 = free.
+static GRANTS: [AtomicU64; MAX_GRANTS] = [const { AtomicU64::new(0) }; MAX_GRANTS];
+static GRANT_COUNT: AtomicUsize = AtomicUsize::new(0);
+/// Mask currently programmed into each core's enable registers, indexed by
+/// [`current_cpu`].
+static APPLIED: [AtomicU64; MAX_CPUS] = [const { AtomicU64::new(0) }; MAX_CPUS];
+static PMU_PRESENT: AtomicBool = AtomicBool::new(false);
+
+/// Detect PMUv3 and start the cycle counter on the calling core.  The
+/// kernel's `timer::init` calls it on the BSP and `smp` on each secondary
+/// before that core runs EL0; EL0 access stays off until a grant.
+pub fn init() {
+    if !pmu_detect() {
+        return;
+    }
+    PMU_PRESENT.store(true, Ordering::Relaxed);
+    pmu_start_cycle_counter();
+}
+
+pub fn pmu_present() -> bool {
+    PMU_PRESENT.load(Ordering::Relaxed)
+}
+
+/// Grant `want` to the calling process's address space and apply it at once
+/// (the syscall returns to EL0 without a context switch).  `want == 0`
+/// revokes.  Returns the mask actually granted — `EL0_PMCCNTR` is dropped
+/// without a PMU — or `None` when the table is full.
+pub fn grant_current(want: u64) -> Option<u64> {
+    let ttbr0 = crate::mmu::get_current_ttbr0() as u64;
+    let granted = with_irqs_disabled(|| {
+        let granted = grant(ttbr0 & L0_MASK, filter(want))?;
+        apply(granted);
+        Some(granted)
+    })?;
+    Some(if vct_shared() { granted | (want & EL0_CNTVCT) } else { granted })
+}
+
+/// Drop any grant held by the address space rooted at `l0_pa`.  Called when
+/// the L0 table is freed, before the PA can be reused.
+pub fn revoke(l0_pa: usize) {
+    if GRANT_COUNT.load(Ordering::Relaxed) == 0 {
+        return;
+    }
+    with_irqs_disabled(|| {
+        let _ = grant(l0_pa as u64 & L0_MASK, 0);
+    });
+}
+
+/// Program the enable bits for the thread about to run with `ttbr0`.
+/// Called by the scheduler with IRQs masked, right after the TTBR0 load.
+#[inline]
+pub fn switch_to(ttbr0: u64) {
+    if GRANT_COUNT.load(Ordering::Relaxed) == 0 && applied().load(Ordering::Relaxed) == 0 {
+        return;
+    }
+    apply(lookup(ttbr0 & L0_MASK));
+}
+
+/// The bits this kernel can grant.
+fn filter(want: u64) -> u64 {
+    let mut mask = want & EL0_ALL;
+    if !pmu_present() {
+        mask &= !EL0_PMCCNTR;
+    }
+    if vct_shared() {
+        // Already on for everyone; nothing to switch.
+        mask &= !EL0_CNTVCT;
+    }
+    mask
+}
+
+fn vct_shared() -> bool {
+    crate::runtime::config().time_page_enabled
+}
+
+/// Record `mask` for `l0` (0 removes it).  Caller masks IRQs, and only the
+/// owning core touches its table (a secondary's `GRANTS` is replicated with
+/// the rest of its `.bss`), so the find-or-insert cannot interleave with
+/// another grant.
+fn grant(l0: u64, mask: u64) -> Option<u64> {
+    let mut free = None;
+    for slot in &GRANTS {
+        let v = slot.load(Ordering::Relaxed);
+        if v != 0 && v & L0_MASK == l0 {
+            if mask == 0 {
+                slot.store(0, Ordering::Relaxed);
+                GRANT_COUNT.fetch_sub(1, Ordering::Relaxed);
+            } else {
+                slot.store(l0 | mask, Ordering::Relaxed);
+            }
+            return Some(mask);
+        }
+        if v == 0 && free.is_none() {
+            free = Some(slot);
+        }
+    }
+    if mask == 0 {
+        return Some(0);
+    }
+    let slot = free?;
+    slot.store(l0 | mask, Ordering::Relaxed);
+    GRANT_COUNT.fetch_add(1, Ordering::Relaxed);
+    Some(mask)
+}
+
+fn lookup(l0: u64) -> u64 {
+    GRANTS
+        .iter()
+        .map(|s| s.load(Ordering::Relaxed))
+        .find(|&v| v != 0 && v & L0_MASK == l0)
+        .map_or(0, |v| v & !L0_MASK)
+}
+
+/// Program `mask` into this core's enable registers.  Other cores pick a
+/// changed grant up at their next [`switch_to`].
+fn apply(mask: u64) {
+    if applied().swap(mask, Ordering::Relaxed) != mask {
+        write_enables(mask, !vct_shared());
+    }
+}
+
+/// This core's [`APPLIED`] slot.
+fn applied() -> &'static AtomicU64 {
+    &APPLIED[current_cpu()]
+}
+
+#[cfg(target_os = "none")]
+fn pmu_detect() -> bool {
+    let dfr0: u64;
+    unsafe { core::arch::asm!("mrs {}, id_aa64dfr0_el1", out(reg) dfr0, options(nomem, nostack)) };
+    // PMUVer: 0 = none, 0xF = IMPLEMENTATION DEFINED (not PMUv3).
+    let ver = (dfr0 >> 8) & 0xF;
+    ver != 0 && ver != 0xF
+}
+
+#[cfg(target_os = "none")]
+fn pmu_start_cycle_counter() {
+    unsafe {
+        let mut pmcr: u64;
+        core::arch::asm!("mrs {}, pmcr_el0", out(reg) pmcr, options(nomem, nostack));
+        pmcr |= (1 << 0) | (1 << 6); // E, LC (64-bit overflow)
+        core::arch::asm!(
+            "msr pmccfiltr_el0, xzr", // count at EL0 and EL1
+            "msr pmcr_el0, {pmcr}",
+            "msr pmcntenset_el0, {en}",
+            "isb",
+            pmcr = in(reg) pmcr,
+            en = in(reg) 1u64 << 31,
+            options(nomem, nostack),
+        );
+    }
+}
+
+#[cfg(target_os = "none")]
+fn write_enables(mask: u64, switch_vct: bool) {
+    unsafe {
+        // PMUSERENR_EL0.CR (bit 2): EL0 reads of PMCCNTR_EL0, nothing else.
+        let user = if mask & EL0_PMCCNTR != 0 { 1u64 << 2 } else { 0 };
+        if pmu_present() {
+            core::arch::asm!("msr pmuserenr_el0, {}", in(reg) user, options(nomem, nostack));
+        }
+        if switch_vct {
+            let mut kctl: u64;
+            core::arch::asm!("mrs {}, cntkctl_el1", out(reg) kctl, options(nomem, nostack));
+            if mask & EL0_CNTVCT != 0 {
+                kctl |= 1 << 1; // EL0VCTEN
+            } else {
+                kctl &= !(1 << 1);
+            }
+            core::arch::asm!("msr cntkctl_el1, {}", in(reg) kctl, options(nomem, nostack));
+        }
+        core::arch::asm!("isb", options(nomem, nostack));
+    }
+}
+
+#[cfg(not(target_os = "none"))]
+fn pmu_detect() -> bool {
+    false
+}
+
+#[cfg(not(target_os = "none"))]
+fn pmu_start_cycle_counter() {}
+
+#[cfg(not(target_os = "none"))]
+fn write_enables(_mask: u64, _switch_vct: bool) {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn grant_lookup_revoke() {
+        let a = 0x4123_4000;
+        let b = 0x4567_8000;
+        assert_eq!(grant(a, EL0_PMCCNTR), Some(EL0_PMCCNTR));
+        assert_eq!(grant(b, EL0_ALL), Some(EL0_ALL));
+        // ASID bits in TTBR0 are ignored.
+        assert_eq!(lookup(((7u64 << 48) | a) & L0_MASK), EL0_PMCCNTR);
+        assert_eq!(lookup(b), EL0_ALL);
+        assert_eq!(grant(a, EL0_CNTVCT), Some(EL0_CNTVCT));
+        assert_eq!(lookup(a), EL0_CNTVCT);
+        assert_eq!(grant(a, 0), Some(0));
+        assert_eq!(lookup(a), 0);
+        assert_eq!(grant(b, 0), Some(0));
+        assert_eq!(GRANT_COUNT.load(Ordering::Relaxed), 0);
+        // Revoking something never granted is fine.
+        assert_eq!(grant(a, 0), Some(0));
+    }
+}
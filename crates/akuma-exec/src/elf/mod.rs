@@ -807,6 +807,9 @@ pub fn load_elf_with_stack(
     auxv_vec.push(AuxEntry { a_type: auxv::AT_EGID, a_val: 0 });
     auxv_vec.push(AuxEntry { a_type: auxv::AT_HWCAP, a_val: auxv::AARCH64_HWCAP });
     auxv_vec.push(AuxEntry { a_type: auxv::AT_HWCAP2, a_val: 0 });
+    if let Some(va) = crate::timepage::auxv_value() {
+        auxv_vec.push(AuxEntry { a_type: auxv::AT_AKUMA_TIMEPAGE, a_val: va });
+    }
     if let Some(ref interp) = loaded.interp {
         auxv_vec.push(AuxEntry { a_type: auxv::AT_BASE, a_val: interp.base_addr as u64 });
     }
@@ -1156,6 +1159,9 @@ pub fn load_elf_with_stack_from_path(
     auxv_vec.push(AuxEntry { a_type: auxv::AT_EGID, a_val: 0 });
     auxv_vec.push(AuxEntry { a_type: auxv::AT_HWCAP, a_val: auxv::AARCH64_HWCAP });
     auxv_vec.push(AuxEntry { a_type: auxv::AT_HWCAP2, a_val: 0 });
+    if let Some(va) = crate::timepage::auxv_value() {
+        auxv_vec.push(AuxEntry { a_type: auxv::AT_AKUMA_TIMEPAGE, a_val: va });
+    }
     if let Some(ref interp) = loaded.interp {
         auxv_vec.push(AuxEntry { a_type: auxv::AT_BASE, a_val: interp.base_addr as u64 });
     }
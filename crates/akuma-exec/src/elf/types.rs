@@ -52,6 +52,9 @@ pub mod auxv {
     pub const AT_HWCAP: u64 = 16;
     pub const AT_CLKTCK: u64 = 17;
     pub const AT_HWCAP2: u64 = 26;
+    /// Akuma extension: VA of the read-only time page (see `timepage`).
+    /// Outside Linux's range, so libcs that don't know it just skip it.
+    pub const AT_AKUMA_TIMEPAGE: u64 = 0x414B_0001;
 
     pub const HWCAP_FP: u64 = 1 << 0;
     pub const HWCAP_ASIMD: u64 = 1 << 1;
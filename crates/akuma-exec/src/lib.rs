@@ -90,6 +90,8 @@ pub mod mmu;
 pub mod elf_loader;
 pub mod threading;
 pub mod process;
+pub mod timepage;
+pub mod el0_counters;
 #[path = "box_mod/mod.rs"]
 pub mod box_registry;
 #[cfg(target_os = "none")]
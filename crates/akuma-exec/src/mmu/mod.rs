@@ -131,6 +131,7 @@ const DEV_PAGES: &[(usize, usize)] = &[
     (4, 0x0A00_0000), // L3[4]: VirtIO MMIO
     (5, 0x080A_0000), // L3[5]: GICv3 redistributor CPU0 RD_base frame
     (6, 0x080B_0000), // L3[6]: GICv3 redistributor CPU0 SGI_base frame
+    (7, 0x0800_6000), // L3[7]: GICv3 distributor GICD_IROUTER page (SPI routing)
 ];
 
 /// Allocate the shared L1/L2/L3 device page tables that every user address
@@ -369,6 +370,9 @@ impl UserAddressSpace {
         if let Some(prepare) = runtime().prepare_user_address_space {
             prepare(&mut addr_space).ok()?;
         }
+        if crate::runtime::config().time_page_enabled {
+            crate::timepage::map_into(&mut addr_space).ok()?;
+        }
         Some(addr_space)
     }
 
@@ -707,22 +711,9 @@ impl UserAddressSpace {
     /// batch one barrier per region instead of one per page.
     pub fn unmap_page_no_flush(&mut self, va: usize) -> Result<(), &'static str> {
         let _irq_guard = IrqGuard::new();
-        let l0_idx = (va >> 39) & 0x1FF;
-        let l1_idx = (va >> 30) & 0x1FF;
-        let l2_idx = (va >> 21) & 0x1FF;
         let l3_idx = (va >> 12) & 0x1FF;
-        unsafe {
-            let l0_ptr = phys_to_virt(self.l0_frame.addr) as *mut u64;
-            let l0_entry = l0_ptr.add(l0_idx).read_volatile();
-            if l0_entry & flags::VALID == 0 { return Ok(()); }
-            let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l1_entry = l1_ptr.add(l1_idx).read_volatile();
-            if l1_entry & flags::VALID == 0 { return Ok(()); }
-            let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l2_entry = l2_ptr.add(l2_idx).read_volatile();
-            if l2_entry & flags::VALID == 0 { return Ok(()); }
-            let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            l3_ptr.add(l3_idx).write_volatile(0);
+        if let Some(l3_ptr) = self.l3_table_for(va, true) {
+            unsafe { l3_ptr.add(l3_idx).write_volatile(0); }
         }
         Ok(())
     }
@@ -742,21 +733,9 @@ impl UserAddressSpace {
     /// showed single 12,426-page unmaps); per-page barriers dominated otherwise.
     pub fn unmap_and_free_page_no_flush(&mut self, va: usize) -> Option<PhysFrame> {
         let _irq_guard = IrqGuard::new();
-        let l0_idx = (va >> 39) & 0x1FF;
-        let l1_idx = (va >> 30) & 0x1FF;
-        let l2_idx = (va >> 21) & 0x1FF;
         let l3_idx = (va >> 12) & 0x1FF;
+        let l3_ptr = self.l3_table_for(va, true)?;
         let pa = unsafe {
-            let l0_ptr = phys_to_virt(self.l0_frame.addr) as *mut u64;
-            let l0_entry = l0_ptr.add(l0_idx).read_volatile();
-            if l0_entry & flags::VALID == 0 { return None; }
-            let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l1_entry = l1_ptr.add(l1_idx).read_volatile();
-            if l1_entry & flags::VALID == 0 { return None; }
-            let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l2_entry = l2_ptr.add(l2_idx).read_volatile();
-            if l2_entry & flags::VALID == 0 { return None; }
-            let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
             let l3_entry = l3_ptr.add(l3_idx).read_volatile();
             if l3_entry & flags::VALID == 0 { return None; }
             l3_ptr.add(l3_idx).write_volatile(0);
@@ -793,21 +772,11 @@ impl UserAddressSpace {
     /// reallocated frame would corrupt memory (same hazard `munmap` guards).
     pub fn try_evict_ro_page(&mut self, va: usize) -> Option<PhysFrame> {
         let _irq_guard = IrqGuard::new();
-        let l0_idx = (va >> 39) & 0x1FF;
-        let l1_idx = (va >> 30) & 0x1FF;
-        let l2_idx = (va >> 21) & 0x1FF;
         let l3_idx = (va >> 12) & 0x1FF;
+        // No split: this runs on the reclaim path, which must not allocate a
+        // page table. Blocks are evicted whole by `try_evict_ro_block`.
+        let l3_ptr = self.l3_table_for(va, false)?;
         let pa = unsafe {
-            let l0_ptr = phys_to_virt(self.l0_frame.addr) as *mut u64;
-            let l0_entry = l0_ptr.add(l0_idx).read_volatile();
-            if l0_entry & flags::VALID == 0 { return None; }
-            let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l1_entry = l1_ptr.add(l1_idx).read_volatile();
-            if l1_entry & flags::VALID == 0 { return None; }
-            let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l2_entry = l2_ptr.add(l2_idx).read_volatile();
-            if l2_entry & flags::VALID == 0 { return None; }
-            let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
             let l3_entry = l3_ptr.add(l3_idx).read_volatile();
             if l3_entry & flags::VALID == 0 { return None; }
             // AP_RO_ALL (bits [7:6] == 0b11) is the only state guaranteed clean:
@@ -825,30 +794,142 @@ impl UserAddressSpace {
         }
     }
 
-    /// Zero the physical page backing `va` without unmapping it.
-    /// Returns true if a page was found and zeroed, false if no mapping exists.
-    pub fn zero_mapped_page(&self, va: usize) -> bool {
+    /// Evict the read-only user 2 MiB block covering `va` (see
+    /// [`map_user_block_no_flush`]) in one go: clear the L2 entry, flush, and
+    /// return to the PMM every frame whose last reference this dropped.
+    /// Returns the number of frames freed; 0 if `va` is not in such a block.
+    /// Same clean-page argument as [`try_evict_ro_page`], and likewise
+    /// allocates nothing, so the reclaim path can call it.
+    pub fn try_evict_ro_block(&mut self, va: usize) -> usize {
+        use core::sync::atomic::AtomicU64;
         let _irq_guard = IrqGuard::new();
-        let l0_idx = (va >> 39) & 0x1FF;
-        let l1_idx = (va >> 30) & 0x1FF;
-        let l2_idx = (va >> 21) & 0x1FF;
-        let l3_idx = (va >> 12) & 0x1FF;
+        let Some(l2_ptr) = self.l2_table_for(va) else { return 0; };
+        let slot = unsafe { &*(l2_ptr.add((va >> 21) & 0x1FF) as *const AtomicU64) };
+        let entry = slot.load(Ordering::Acquire);
+        if !is_user_block(entry) || (entry & flags::AP_RO_ALL) != flags::AP_RO_ALL {
+            return 0;
+        }
+        if slot.compare_exchange(entry, 0, Ordering::AcqRel, Ordering::Acquire).is_err() {
+            return 0;
+        }
+        flush_tlb_page(va & !(BLOCK_2MB - 1));
+        let base = (entry & 0x0000_FFFF_FFE0_0000) as usize;
+        let mut freed = 0;
+        for i in 0..ENTRIES_PER_TABLE {
+            let frame = PhysFrame::new(base + i * PAGE_SIZE);
+            if self.remove_user_frame(frame) {
+                (runtime().free_page)(frame);
+                freed += 1;
+            }
+        }
+        freed
+    }
+
+    /// L2 table covering `va`, if the L0/L1 levels are present as tables.
+    fn l2_table_for(&self, va: usize) -> Option<*mut u64> {
         unsafe {
             let l0_ptr = phys_to_virt(self.l0_frame.addr) as *mut u64;
-            let l0_entry = l0_ptr.add(l0_idx).read_volatile();
-            if l0_entry & flags::VALID == 0 { return false; }
+            let l0_entry = l0_ptr.add((va >> 39) & 0x1FF).read_volatile();
+            if l0_entry & flags::VALID == 0 { return None; }
             let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l1_entry = l1_ptr.add(l1_idx).read_volatile();
-            if l1_entry & flags::VALID == 0 { return false; }
-            let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l2_entry = l2_ptr.add(l2_idx).read_volatile();
-            if l2_entry & flags::VALID == 0 { return false; }
-            let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l3_entry = l3_ptr.add(l3_idx).read_volatile();
-            if l3_entry & flags::VALID == 0 { return false; }
-            let pa = (l3_entry & 0x0000_FFFF_FFFF_F000) as usize;
-            core::ptr::write_bytes(phys_to_virt(pa) as *mut u8, 0, 4096);
+            let l1_entry = l1_ptr.add((va >> 30) & 0x1FF).read_volatile();
+            if l1_entry & (flags::VALID | flags::TABLE) != flags::VALID | flags::TABLE { return None; }
+            Some(phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64)
+        }
+    }
+
+    /// L3 table covering `va`, for the paths that edit one page entry. A user
+    /// 2 MiB block there is split into pages first when `split` is set (and
+    /// yields `None` otherwise); a kernel identity block always yields `None`,
+    /// so a stray VA can never be walked as if the block were a table.
+    fn l3_table_for(&self, va: usize, split: bool) -> Option<*mut u64> {
+        let l2_ptr = self.l2_table_for(va)?;
+        let l2_idx = (va >> 21) & 0x1FF;
+        let l2_entry = unsafe { l2_ptr.add(l2_idx).read_volatile() };
+        if l2_entry & flags::VALID == 0 { return None; }
+        if l2_entry & flags::TABLE == 0 {
+            if !split || !is_user_block(l2_entry) { return None; }
+            return unsafe { self.shatter_user_block(l2_ptr, l2_idx, va & !(BLOCK_2MB - 1)) };
         }
+        Some(phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64)
+    }
+
+    /// Replace the user block at `l2_ptr[l2_idx]` with an L3 table of the 512
+    /// page entries it stands for, and return that table.
+    ///
+    /// Break-before-make, as the architecture requires when a live entry
+    /// changes size: the block is swapped for an invalid entry and its TLB
+    /// entry flushed before the table goes in. A sibling thread touching the
+    /// range meanwhile takes an ordinary demand-paging fault and may install
+    /// its own L3 table; ours is then merged into it slot by slot (its pages
+    /// win). If it installed a new block instead we split that one too. Block
+    /// frames displaced either way lose this address space's reference at
+    /// once, and go back to the PMM when that was the last one.
+    unsafe fn shatter_user_block(&self, l2_ptr: *mut u64, l2_idx: usize, block_va: usize) -> Option<*mut u64> { unsafe {
+        use core::sync::atomic::AtomicU64;
+        let slot = &*(l2_ptr.add(l2_idx) as *const AtomicU64);
+        loop {
+            let entry = slot.load(Ordering::Acquire);
+            if entry & flags::VALID != 0 && entry & flags::TABLE != 0 {
+                return Some(phys_to_virt((entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64);
+            }
+            if !is_user_block(entry) { return None; }
+            let rt = runtime();
+            let frame = (rt.alloc_page_zeroed)()?;
+            shatter_block_to_pages(frame.addr, entry);
+            if slot.compare_exchange(entry, 0, Ordering::AcqRel, Ordering::Acquire).is_err() {
+                (rt.free_page)(frame);
+                continue;
+            }
+            flush_tlb_page(block_va);
+            let table = (frame.addr as u64) | flags::VALID | flags::TABLE;
+            match slot.compare_exchange(0, table, Ordering::AcqRel, Ordering::Acquire) {
+                Ok(_) => {
+                    (rt.track_frame)(frame, FrameSource::UserPageTable);
+                    { let _irq = IrqGuard::new(); self.page_table_frames.lock().push(frame); }
+                    return Some(phys_to_virt(frame.addr) as *mut u64);
+                }
+                Err(cur) if cur & flags::VALID != 0 && cur & flags::TABLE != 0 => {
+                    let theirs = phys_to_virt((cur & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
+                    let ours = phys_to_virt(frame.addr) as *const u64;
+                    for i in 0..ENTRIES_PER_TABLE {
+                        let pte = &*(theirs.add(i) as *const AtomicU64);
+                        let page = ours.add(i).read();
+                        if pte.compare_exchange(0, page, Ordering::AcqRel, Ordering::Acquire).is_err() {
+                            self.release_displaced(PhysFrame::new((page & 0x0000_FFFF_FFFF_F000) as usize));
+                        }
+                    }
+                    (rt.free_page)(frame);
+                    return Some(theirs);
+                }
+                Err(_) => {
+                    // A sibling mapped a fresh block: none of ours survives.
+                    let base = (entry & 0x0000_FFFF_FFE0_0000) as usize;
+                    for i in 0..ENTRIES_PER_TABLE {
+                        self.release_displaced(PhysFrame::new(base + i * PAGE_SIZE));
+                    }
+                    (rt.free_page)(frame);
+                }
+            }
+        }
+    }}
+
+    /// Drop this address space's reference to a block frame that
+    /// [`Self::shatter_user_block`] unmapped and could not re-install (its TLB entry
+    /// is already flushed), freeing it if that was the last one.
+    fn release_displaced(&self, frame: PhysFrame) {
+        if self.remove_user_frame(frame) {
+            (runtime().free_page)(frame);
+        }
+    }
+
+    /// Zero the physical page backing `va` without unmapping it.
+    /// Returns true if a page was found and zeroed, false if no mapping exists.
+    pub fn zero_mapped_page(&self, va: usize) -> bool {
+        let Some(pa) = self.phys_addr_for_page_va(va) else {
+            return false;
+        };
+        unsafe { core::ptr::write_bytes(phys_to_virt(pa), 0, 4096); }
         true
     }
 
@@ -856,22 +937,10 @@ impl UserAddressSpace {
     /// Preserves the physical address and fixed flags, replaces only user permission bits.
     pub fn update_page_flags(&mut self, va: usize, new_flags: u64) -> Result<(), &'static str> {
         let _irq_guard = IrqGuard::new();
-        let l0_idx = (va >> 39) & 0x1FF;
-        let l1_idx = (va >> 30) & 0x1FF;
-        let l2_idx = (va >> 21) & 0x1FF;
         let l3_idx = (va >> 12) & 0x1FF;
         const PERM_MASK: u64 = flags::AP_RO_ALL | flags::AP_RW_ALL | flags::UXN | flags::PXN;
+        let Some(l3_ptr) = self.l3_table_for(va, true) else { return Ok(()); };
         unsafe {
-            let l0_ptr = phys_to_virt(self.l0_frame.addr) as *mut u64;
-            let l0_entry = l0_ptr.add(l0_idx).read_volatile();
-            if l0_entry & flags::VALID == 0 { return Ok(()); }
-            let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l1_entry = l1_ptr.add(l1_idx).read_volatile();
-            if l1_entry & flags::VALID == 0 { return Ok(()); }
-            let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l2_entry = l2_ptr.add(l2_idx).read_volatile();
-            if l2_entry & flags::VALID == 0 { return Ok(()); }
-            let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
             let old_entry = l3_ptr.add(l3_idx).read_volatile();
             if old_entry & flags::VALID == 0 { return Ok(()); }
             let entry = (old_entry & !PERM_MASK) | new_flags;
@@ -888,22 +957,10 @@ impl UserAddressSpace {
     /// `flush_tlb_asid` to make the permission changes visible to userspace.
     pub fn update_page_flags_no_flush(&mut self, va: usize, new_flags: u64) -> Result<(), &'static str> {
         let _irq_guard = IrqGuard::new();
-        let l0_idx = (va >> 39) & 0x1FF;
-        let l1_idx = (va >> 30) & 0x1FF;
-        let l2_idx = (va >> 21) & 0x1FF;
         let l3_idx = (va >> 12) & 0x1FF;
         const PERM_MASK: u64 = flags::AP_RO_ALL | flags::AP_RW_ALL | flags::UXN | flags::PXN;
+        let Some(l3_ptr) = self.l3_table_for(va, true) else { return Ok(()); };
         unsafe {
-            let l0_ptr = phys_to_virt(self.l0_frame.addr) as *mut u64;
-            let l0_entry = l0_ptr.add(l0_idx).read_volatile();
-            if l0_entry & flags::VALID == 0 { return Ok(()); }
-            let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l1_entry = l1_ptr.add(l1_idx).read_volatile();
-            if l1_entry & flags::VALID == 0 { return Ok(()); }
-            let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
-            let l2_entry = l2_ptr.add(l2_idx).read_volatile();
-            if l2_entry & flags::VALID == 0 { return Ok(()); }
-            let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
             let old_entry = l3_ptr.add(l3_idx).read_volatile();
             if old_entry & flags::VALID == 0 { return Ok(()); }
             let entry = (old_entry & !PERM_MASK) | new_flags;
@@ -914,6 +971,7 @@ impl UserAddressSpace {
     }
 
     /// Raw L3 page descriptor for `va` (4KiB-aligned), if mapped at the final level.
+    /// Inside a user 2 MiB block, the descriptor the page would have once split.
     /// Used by kernel tests and diagnostics (e.g. verify `UXN` after `update_page_flags`).
     pub fn read_l3_page_entry(&self, va: usize) -> Option<u64> {
         let va = va & !(PAGE_SIZE - 1);
@@ -938,6 +996,14 @@ impl UserAddressSpace {
             if l2_entry & flags::VALID == 0 {
                 return None;
             }
+            if l2_entry & flags::TABLE == 0 {
+                // 2 MiB block: the page entry it stands for (see `shatter_block_to_pages`).
+                if !is_user_block(l2_entry) {
+                    return None;
+                }
+                let pa = (l2_entry & 0x0000_FFFF_FFE0_0000) + ((va & 0x1F_F000) as u64);
+                return Some(pa | (l2_entry & BLOCK_ATTR_MASK) | flags::VALID | flags::TABLE);
+            }
             let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
             let l3_entry = l3_ptr.add(l3_idx).read_volatile();
             if l3_entry & flags::VALID == 0 {
@@ -978,6 +1044,7 @@ impl UserAddressSpace {
             core::arch::asm!("dsb ish", "msr ttbr0_el1, {ttbr0}", "isb", ttbr0 = in(reg) _ttbr0);
         }
         flush_tlb_all();
+        crate::el0_counters::switch_to(_ttbr0);
     }
 
     pub fn deactivate() {
@@ -988,6 +1055,7 @@ impl UserAddressSpace {
             core::arch::asm!("dsb ish", "msr ttbr0_el1, {ttbr0}", "isb", ttbr0 = in(reg) _boot_ttbr0);
         }
         flush_tlb_all();
+        crate::el0_counters::switch_to(_boot_ttbr0);
     }
 }
 
@@ -1035,6 +1103,7 @@ impl Drop for UserAddressSpace {
                     let _irq = IrqGuard::new();
                     for frame in &*self.page_table_frames.lock() { (rt.free_page)(*frame); }
                 }
+                crate::el0_counters::revoke(l0_addr);
                 (rt.free_page)(self.l0_frame);
                 with_irqs_disabled(|| { SHARED_L0_TABLE.lock().remove(&l0_addr); });
             }
@@ -1074,6 +1143,7 @@ impl Drop for UserAddressSpace {
                     (rt.free_page)(PhysFrame::new(addr));
                 }
                 for frame in &pf { (rt.free_page)(*frame); }
+                crate::el0_counters::revoke(l0.addr);
                 (rt.free_page)(l0);
             }
         }
@@ -1083,12 +1153,25 @@ impl Drop for UserAddressSpace {
 }
 
 
+/// Descriptor bits a 2MB block shares with the 4KB page entries it splits
+/// into: upper attributes [63:52] (UXN/PXN) and lower attributes [11:2].
+const BLOCK_ATTR_MASK: u64 = 0xFFF0_0000_0000_0FFC;
+
+/// `true` for a 2MB block installed for user data by
+/// [`map_user_block_no_flush`]: a valid non-table L2 entry with nG set. The
+/// kernel RAM identity blocks in every user table are global, so they never
+/// match.
+#[inline]
+fn is_user_block(entry: u64) -> bool {
+    entry & (flags::VALID | flags::TABLE) == flags::VALID && entry & flags::NG != 0
+}
+
 /// Populate an L3 page table from a 2MB block descriptor, preserving the
 /// block's identity mapping as 512 individual 4KB page entries.
 pub unsafe fn shatter_block_to_pages(l3_frame_addr: usize, block_entry: u64) {
     let l3_ptr = phys_to_virt(l3_frame_addr) as *mut u64;
     let block_pa = block_entry & 0x0000_FFFF_FFE0_0000; // 2MB-aligned PA
-    let attrs = block_entry & 0xFFF0_0000_0000_0FFC; // upper[63:52] + lower[11:2]
+    let attrs = block_entry & BLOCK_ATTR_MASK;
     for i in 0..512u64 {
         let page_pa = block_pa + (i << 12);
         unsafe {
@@ -1203,6 +1286,63 @@ pub unsafe fn map_user_page_no_flush(va: usize, pa: usize, user_flags_val: u64)
     }
 }}
 
+/// Whether the current address space could take a 2MB block at `va`: its L2
+/// entry is empty (no page of the 2MB range is mapped, not even an empty L3
+/// table) or the upper levels don't exist yet. Checked before reading a whole
+/// block's worth of file data; [`map_user_block_no_flush`] re-checks it
+/// atomically.
+pub fn current_user_block_slot_free(va: usize) -> bool {
+    let ttbr0 = get_current_ttbr0();
+    if ttbr0 == 0 { return false; }
+    let l0_ptr = phys_to_virt(ttbr0 & 0x0000_FFFF_FFFF_F000) as *const u64;
+    unsafe {
+        let l0_entry = l0_ptr.add((va >> 39) & 0x1FF).read_volatile();
+        if l0_entry & flags::VALID == 0 { return true; }
+        let l1_ptr = phys_to_virt((l0_entry & 0x0000_FFFF_FFFF_F000) as usize) as *const u64;
+        let l1_entry = l1_ptr.add((va >> 30) & 0x1FF).read_volatile();
+        if l1_entry & flags::VALID == 0 { return true; }
+        if l1_entry & flags::TABLE == 0 { return false; }
+        let l2_ptr = phys_to_virt((l1_entry & 0x0000_FFFF_FFFF_F000) as usize) as *const u64;
+        l2_ptr.add((va >> 21) & 0x1FF).read_volatile() == 0
+    }
+}
+
+/// Map the 2MB-aligned, physically contiguous `pa` at the 2MB-aligned user
+/// `va` with a single L2 block entry, in the current address space, **without**
+/// a TLB flush (as [`map_user_page_no_flush`]). One TLB entry then covers what
+/// would take 512 page entries, which is the point for large read-only file
+/// mappings such as model weights.
+///
+/// Only installs into an empty L2 slot (compare-exchange from 0), so it never
+/// replaces pages already mapped in the range. Returns `(table_frames,
+/// installed)` like [`map_user_page`]; the caller tracks the 512 data frames
+/// itself. Every page-level edit of the range later (`munmap`, `mprotect`,
+/// `MADV_DONTNEED`, CoW) splits the block into pages first; reclaim evicts it
+/// whole (`UserAddressSpace::try_evict_ro_block`).
+pub unsafe fn map_user_block_no_flush(va: usize, pa: usize, user_flags_val: u64) -> (Vec<PhysFrame>, bool) { unsafe {
+    let _irq_guard = IrqGuard::new();
+    let mut allocated_tables = Vec::new();
+    if va & (BLOCK_2MB - 1) != 0 || pa & (BLOCK_2MB - 1) != 0 {
+        return (allocated_tables, false);
+    }
+    let l0_addr = get_current_ttbr0() & 0x0000_FFFF_FFFF_F000;
+    if l0_addr == 0 { return (allocated_tables, false); }
+    let l0_ptr = phys_to_virt(l0_addr) as *mut u64;
+    let (l1_addr, l1_frame) = get_or_create_table_atomic(l0_ptr, (va >> 39) & 0x1FF);
+    if let Some(frame) = l1_frame { allocated_tables.push(frame); }
+    if l1_addr == 0 { return (allocated_tables, false); }
+    let l1_ptr = phys_to_virt(l1_addr) as *mut u64;
+    let (l2_addr, l2_frame) = get_or_create_table_atomic(l1_ptr, (va >> 30) & 0x1FF);
+    if let Some(frame) = l2_frame { allocated_tables.push(frame); }
+    if l2_addr == 0 { return (allocated_tables, false); }
+    let l2_ptr = phys_to_virt(l2_addr) as *mut u64;
+    let slot = &*((l2_ptr.add((va >> 21) & 0x1FF)) as *const core::sync::atomic::AtomicU64);
+    let entry = (pa as u64) | flags::VALID | flags::AF | flags::NG | attr_index(MAIR_NORMAL_WB) | flags::SH_INNER | user_flags_val;
+    let installed = slot.compare_exchange(0, entry,
+        core::sync::atomic::Ordering::AcqRel, core::sync::atomic::Ordering::Acquire).is_ok();
+    (allocated_tables, installed)
+}}
+
 /// Flush TLB entries for a contiguous range of virtual addresses.
 ///
 /// Issues `tlbi vale1is` for each page in [start_va, start_va + pages*4096),
@@ -1503,9 +1643,18 @@ pub fn collect_mapped_pages_sparse(
                 continue;
             }
             if l2_entry & flags::TABLE == 0 {
-                // 2MB block mapping — unlikely for user pages, skip
-                let next = (va | 0x1F_FFFF) + 1;
-                va = next.min(va_end);
+                // 2MB block: a user one (read-only file data) reports each
+                // page it covers; a kernel identity block is skipped.
+                let next = ((va | 0x1F_FFFF) + 1).min(va_end);
+                if is_user_block(l2_entry) {
+                    let block_pa = (l2_entry & 0x0000_FFFF_FFE0_0000) as usize;
+                    let mut page_va = va & !0xFFF;
+                    while page_va < next {
+                        result.push((page_va, block_pa + (page_va & 0x1F_F000)));
+                        page_va += PAGE_SIZE;
+                    }
+                }
+                va = next;
                 continue;
             }
             // Valid L3 table — scan pages within this 2MB range
@@ -1569,7 +1718,19 @@ pub fn collect_mapped_pages_with_flags(
                 va = ((va | 0x1F_FFFF) + 1).min(va_end); continue;
             }
             if l2_entry & flags::TABLE == 0 {
-                va = ((va | 0x1F_FFFF) + 1).min(va_end); continue;
+                // 2MB block: expand a user one into its pages (CoW fork maps
+                // them into the child as pages); skip a kernel identity block.
+                let next = ((va | 0x1F_FFFF) + 1).min(va_end);
+                if is_user_block(l2_entry) {
+                    let block_pa = (l2_entry & 0x0000_FFFF_FFE0_0000) as usize;
+                    let pte_flags = l2_entry & (flags::AP_RO_ALL | flags::UXN | flags::PXN);
+                    let mut page_va = va & !0xFFF;
+                    while page_va < next {
+                        result.push((page_va, block_pa + (page_va & 0x1F_F000), pte_flags));
+                        page_va += PAGE_SIZE;
+                    }
+                }
+                va = next; continue;
             }
             let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *const u64;
             let l3_start = (va >> 12) & 0x1FF;
@@ -1596,7 +1757,8 @@ pub fn collect_mapped_pages_with_flags(
     result
 }
 
-/// Demote all RW L3 PTEs in [va_start, va_start + pages*PAGE_SIZE) to RO.
+/// Demote all RW L3 PTEs in [va_start, va_start + pages*PAGE_SIZE) to RO,
+/// except frames shared on purpose (`ExecRuntime::frame_is_shared`).
 ///
 /// Walks the page table via raw L0 pointer (no `&mut UserAddressSpace` needed).
 /// Returns the number of PTEs actually demoted.  Caller must flush the TLB
@@ -1632,6 +1794,8 @@ pub unsafe fn demote_range_to_ro(l0_ptr: *mut u64, va_start: usize, pages: usize
             va = ((va | 0x1F_FFFF) + 1).min(va_end); continue;
         }
         if l2_entry & flags::TABLE == 0 {
+            // Kernel identity block, or a user block — only ever installed
+            // read-only, so there is nothing to demote.
             va = ((va | 0x1F_FFFF) + 1).min(va_end); continue;
         }
         let l3_ptr = phys_to_virt((l2_entry & 0x0000_FFFF_FFFF_F000) as usize) as *mut u64;
@@ -1646,7 +1810,9 @@ pub unsafe fn demote_range_to_ro(l0_ptr: *mut u64, va_start: usize, pages: usize
             let entry = l3_ptr.add(l3_idx).read_volatile();
             if entry & flags::VALID == 0 { continue; }
             let ap = entry & AP_MASK;
-            if ap == flags::AP_RW_ALL {
+            if ap == flags::AP_RW_ALL
+                && !(runtime().frame_is_shared)((entry & 0x0000_FFFF_FFFF_F000) as usize)
+            {
                 // Demote RW → RO: clear AP_RW_ALL, set AP_RO_ALL
                 let new_entry = (entry & !AP_MASK) | flags::AP_RO_ALL;
                 l3_ptr.add(l3_idx).write_volatile(new_entry);
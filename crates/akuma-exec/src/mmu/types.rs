@@ -19,6 +19,8 @@ pub const DEV_GICR_RD_VA: usize  = 0x80_0000_5000;
 /// GICv3 redistributor, CPU0 SGI_base frame (PA 0x080B_0000). SGI/PPI enable,
 /// priority and group registers live here.
 pub const DEV_GICR_SGI_VA: usize = 0x80_0000_6000;
+/// GICv3 distributor page holding GICD_IROUTER for INTIDs 32-511 (PA 0x0800_6000).
+pub const DEV_GICD_IROUTER_VA: usize = 0x80_0000_7000;
 
 pub const MAIR_DEVICE_NGNRNE: u64 = 0;
 pub const MAIR_NORMAL_NC: u64 = 1;
@@ -66,6 +68,8 @@ pub mod user_flags {
     /// PROT_NONE: EL1-only access, EL0 gets no read/write/exec.
     pub const NONE: u64 = flags::AP_RO_EL1 | flags::UXN | flags::PXN;
     pub const RO: u64 = flags::AP_RO_ALL;
+    /// Read-only at EL0 and EL1, never executable (the time page).
+    pub const RO_NO_EXEC: u64 = flags::AP_RO_ALL | flags::UXN | flags::PXN;
     pub const RW: u64 = flags::AP_RW_ALL;
     pub const EXEC: u64 = flags::AP_RO_ALL;
     pub const RW_NO_EXEC: u64 = flags::AP_RW_ALL | flags::UXN | flags::PXN;
@@ -4,7 +4,7 @@ use alloc::vec::Vec;
 use spinning_top::Spinlock;
 
 use crate::process::Process;
-use crate::process::types::{Pid, ProcessInfo, PROCESS_INFO_ADDR, LazyRegion, LazySource, ProcessInfo2, ProcessState};
+use crate::process::types::{Pid, ProcessInfo, PROCESS_INFO_ADDR, LazyRegion, LazySource, Readahead, ProcessInfo2, ProcessState};
 use crate::process::channel::{ProcessChannel, get_channel};
 use crate::process::table::{LAZY_REGION_TABLE, THREAD_PID_MAP, find_process};
 use crate::runtime::{with_irqs_disabled, runtime, PhysFrame};
@@ -368,7 +368,7 @@ pub fn record_mmap_region(start_va: usize, frames: Vec<PhysFrame>) {
 pub fn record_lazy_region(start_va: usize, size: usize, page_flags: u64) {
     let pid = address_space_owner_pid_for_fault().unwrap_or(0);
     if let Some(proc) = lookup_process(pid) {
-        proc.lazy_regions.push(LazyRegion { start_va, size, flags: page_flags, source: LazySource::Zero });
+        proc.lazy_regions.push(LazyRegion { start_va, size, flags: page_flags, source: LazySource::Zero, ra: Readahead::default() });
     }
 }
 
@@ -486,6 +486,15 @@ pub fn reclaim_clean_file_pages(want: usize) -> usize {
             if let Some(frame) = proc.address_space.try_evict_ro_page(va) {
                 (runtime().free_page)(frame);
                 freed += 1;
+            } else {
+                // A 2 MiB file block goes as a whole: splitting it would
+                // need a page-table frame, and we must not allocate here.
+                let n = proc.address_space.try_evict_ro_block(va);
+                if n > 0 {
+                    freed += n;
+                    va = (va | 0x1F_FFFF) + 1;
+                    continue;
+                }
             }
             va += 0x1000;
         }
@@ -601,7 +610,7 @@ pub fn push_lazy_region_with_source(pid: Pid, start_va: usize, size: usize, page
     let len = with_irqs_disabled(|| {
         let mut table = LAZY_REGION_TABLE.lock();
         let regions = table.entry(pid).or_insert_with(alloc::collections::BTreeMap::new);
-        regions.insert(start_va, LazyRegion { start_va, size, flags: page_flags, source });
+        regions.insert(start_va, LazyRegion { start_va, size, flags: page_flags, source, ra: Readahead::default() });
         regions.len()
     });
     len
@@ -609,6 +618,23 @@ pub fn push_lazy_region_with_source(pid: Pid, start_va: usize, size: usize, page
 
 /// Update flags on all lazy regions that overlap [range_start, range_start+range_size).
 pub fn update_lazy_region_flags(pid: Pid, range_start: usize, range_size: usize, new_flags: u64) {
+    update_lazy_regions_in_range(pid, range_start, range_size, |r| r.flags = new_flags);
+}
+
+/// Record an `madvise` readahead hint (`Readahead::NORMAL/RANDOM/SEQUENTIAL`)
+/// on the lazy regions overlapping [range_start, range_start+range_size),
+/// splitting them at the range edges. Resets the window so the next fault
+/// starts from the new policy.
+pub fn set_lazy_region_advice(pid: Pid, range_start: usize, range_size: usize, advice: u8) {
+    update_lazy_regions_in_range(pid, range_start, range_size, |r| {
+        r.ra = Readahead { advice, window: 0, next_va: 0 };
+    });
+}
+
+/// Apply `update` to the part of every lazy region that overlaps
+/// [range_start, range_start+range_size). A region only partly inside the
+/// range is split into up to 3 pieces and only the overlapping one updated.
+fn update_lazy_regions_in_range(pid: Pid, range_start: usize, range_size: usize, update: impl Fn(&mut LazyRegion)) {
     let range_end = range_start + range_size;
     with_irqs_disabled(|| {
         let mut table = LAZY_REGION_TABLE.lock();
@@ -623,43 +649,39 @@ pub fn update_lazy_region_flags(pid: Pid, range_start: usize, range_size: usize,
 
             for key in keys {
                 let r_start = key;
-                let r_size = regions[&key].size;
-                let r_end = r_start + r_size;
-                let r_flags = regions[&key].flags;
-                let r_source = regions[&key].source.clone();
+                let r_end = r_start + regions[&key].size;
 
                 let clip_start = r_start.max(range_start);
                 let clip_end = r_end.min(range_end);
 
                 if clip_start == r_start && clip_end == r_end {
                     // Fully contained: update in place.
-                    regions.get_mut(&key).unwrap().flags = new_flags;
+                    update(regions.get_mut(&key).unwrap());
                 } else {
                     // Partially overlapping: remove and re-insert up to 3 pieces.
-                    regions.remove(&key);
-                    // "before" tail keeps old flags.
+                    let old = regions.remove(&key).unwrap();
+                    // "before" tail keeps the old state.
                     if clip_start > r_start {
                         regions.insert(r_start, LazyRegion {
                             start_va: r_start,
                             size: clip_start - r_start,
-                            flags: r_flags,
-                            source: r_source.clone(),
+                            ..old.clone()
                         });
                     }
-                    // Overlapping slice gets new flags.
-                    regions.insert(clip_start, LazyRegion {
+                    // Overlapping slice gets the update.
+                    let mut mid = LazyRegion {
                         start_va: clip_start,
                         size: clip_end - clip_start,
-                        flags: new_flags,
-                        source: r_source.clone(),
-                    });
-                    // "after" tail keeps old flags.
+                        ..old.clone()
+                    };
+                    update(&mut mid);
+                    regions.insert(clip_start, mid);
+                    // "after" tail keeps the old state.
                     if clip_end < r_end {
                         regions.insert(clip_end, LazyRegion {
                             start_va: clip_end,
                             size: r_end - clip_end,
-                            flags: r_flags,
-                            source: r_source,
+                            ..old
                         });
                     }
                 }
@@ -668,6 +690,48 @@ pub fn update_lazy_region_flags(pid: Pid, range_start: usize, range_size: usize,
     });
 }
 
+/// Smallest window a run of non-sequential faults shrinks an `MADV_NORMAL`
+/// region to (64 KB), so a random reader still gets some locality.
+const READAHEAD_MIN_PAGES: usize = 16;
+
+/// Readahead window, in pages, for a file-backed fault at `va`, updating the
+/// region's state for the next one. `MADV_RANDOM` reads just the faulting
+/// page and `MADV_SEQUENTIAL` always reads `max`. `MADV_NORMAL` starts at
+/// `init`, doubles (up to `max`) each time a fault lands inside or right at
+/// the end of the previous window — the signature of a sequential scan, the
+/// inside case being a window the fault path cut short (PMM budget, 2 MB block
+/// alignment) — and halves (down to `READAHEAD_MIN_PAGES`) on any other fault,
+/// so a random reader stops paying for pages it never touches. Keyed like
+/// [`lazy_region_lookup_for_page_fault`]; `init` if `va` has no region.
+pub fn lazy_region_readahead(pid: Pid, va: usize, init: usize, max: usize) -> usize {
+    let page_va = va & !0xFFF;
+    let update = |key: Pid| with_irqs_disabled(|| {
+        let mut table = LAZY_REGION_TABLE.lock();
+        let regions = table.get_mut(&key)?;
+        let (_, r) = regions.range_mut(..=page_va).next_back()?;
+        if page_va >= r.start_va + r.size {
+            return None;
+        }
+        let prev = r.ra.window as usize;
+        let window = match r.ra.advice {
+            Readahead::RANDOM => 1,
+            Readahead::SEQUENTIAL => max,
+            _ if prev == 0 => init,
+            _ if page_va <= r.ra.next_va && page_va > r.ra.next_va - prev * 0x1000 =>
+                (prev * 2).min(max),
+            _ => (prev / 2).max(READAHEAD_MIN_PAGES),
+        };
+        r.ra.window = window as u32;
+        r.ra.next_va = page_va + window * 0x1000;
+        Some(window)
+    });
+    if let Some(owner) = address_space_owner_pid_for_fault()
+        && let Some(w) = update(owner) {
+        return w;
+    }
+    update(pid).unwrap_or(init)
+}
+
 pub fn remove_lazy_region(pid: Pid, start_va: usize) -> Option<LazyRegion> {
     with_irqs_disabled(|| {
         let mut table = LAZY_REGION_TABLE.lock();
@@ -712,6 +776,7 @@ fn munmap_lazy_region_overlapping(pid: Pid, range_start: usize, range_end: usize
         let reg_end = reg_start + reg_size;
         let reg_flags = regions[&key].flags;
         let reg_source = regions[&key].source.clone();
+        let reg_ra = regions[&key].ra;
 
         let clip_start = range_start.max(reg_start);
         let clip_end = range_end.min(reg_end);
@@ -727,6 +792,7 @@ fn munmap_lazy_region_overlapping(pid: Pid, range_start: usize, range_end: usize
                 size: reg_end - clip_end,
                 flags: reg_flags,
                 source: reg_source,
+                ra: reg_ra,
             });
             let freed = (clip_end - clip_start) / 4096;
             Some(('P', clip_start, freed))
@@ -743,6 +809,7 @@ fn munmap_lazy_region_overlapping(pid: Pid, range_start: usize, range_end: usize
                 size: reg_end - clip_end,
                 flags: reg_flags,
                 source: reg_source,
+                ra: reg_ra,
             });
             let freed = (clip_end - clip_start) / 4096;
             Some(('M', clip_start, freed))
@@ -931,7 +998,10 @@ mod child_channel_drain_tests {
             eventfd_close: |_| {},
             eventfd_clone_ref: |_| {},
             epoll_destroy: |_| {},
+            epoll_token_wake: |_| {},
             pidfd_close: |_| {},
+            tap_close: |_| {},
+            tap_clone_ref: |_| {},
             resolve_symlinks: |_| alloc::string::String::new(),
             file_size: |_| Ok(0),
             get_box_namespace: |_| None,
@@ -941,6 +1011,7 @@ mod child_channel_drain_tests {
             cow_ref_inc: |_| {},
             cow_ref_dec: |_| false,
             cow_ref_get: |_| 0,
+            frame_is_shared: |_| false,
             prepare_user_address_space: None,
             remote_fd_close: None,
         };
@@ -967,6 +1038,7 @@ mod child_channel_drain_tests {
             proc_stdout_max_size: 1 << 20,
             cow_fork_enabled: false,
             vfork_fastpath_enabled: false,
+            time_page_enabled: false,
             prefer_whole_file_load: false,
         };
         register(rt, cfg);
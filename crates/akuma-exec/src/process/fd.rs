@@ -64,6 +64,7 @@ impl SharedFdTable {
                     (crate::runtime::runtime().pipe_clone_ref)(*tx, true);
                 }
                 FileDescriptor::EventFd(id) => (crate::runtime::runtime().eventfd_clone_ref)(*id),
+                FileDescriptor::Tap { bounce, .. } => (crate::runtime::runtime().tap_clone_ref)(*bounce),
                 _ => {}
             }
         }
@@ -113,6 +114,9 @@ impl SharedFdTable {
                 FileDescriptor::PidFd(pidfd_id) => {
                     (runtime().pidfd_close)(pidfd_id);
                 }
+                FileDescriptor::Tap { bounce, .. } => {
+                    (runtime().tap_close)(bounce);
+                }
                 FileDescriptor::RemoteFd { owner, handle, kind } => {
                     // Forward a close to the owner core so it frees the backing file/socket
                     // (multikernel §8.1). No-op on a build without the hook (BSP/single-kernel,
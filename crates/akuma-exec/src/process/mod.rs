@@ -224,6 +224,9 @@ pub struct Process {
     pub current_syscall: AtomicU64,
     pub last_syscall: AtomicU64,
     pub syscall_stats: ProcessSyscallStats,
+    /// EL0 instructions the kernel emulated for this address space
+    /// (`/proc/<pid>/emulation`); counted on the thread-group leader.
+    pub emulation: EmulationStats,
 }
 
 /// Shared signal action table for CLONE_SIGHAND semantics.
@@ -359,6 +362,7 @@ impl Process {
             current_syscall: core::sync::atomic::AtomicU64::new(!0),
             last_syscall: core::sync::atomic::AtomicU64::new(0),
             syscall_stats: ProcessSyscallStats::new(),
+            emulation: EmulationStats::new(),
 })
     }
 
@@ -457,6 +461,7 @@ impl Process {
             current_syscall: core::sync::atomic::AtomicU64::new(!0),
             last_syscall: core::sync::atomic::AtomicU64::new(0),
             syscall_stats: ProcessSyscallStats::new(),
+            emulation: EmulationStats::new(),
 })
     }
 
@@ -1364,6 +1369,7 @@ pub fn fork_process(child_pid: u32, stack_ptr: u64) -> Result<u32, &'static str>
         current_syscall: core::sync::atomic::AtomicU64::new(!0),
         last_syscall: core::sync::atomic::AtomicU64::new(0),
         syscall_stats: ProcessSyscallStats::new(),
+        emulation: EmulationStats::new(),
     }).map_err(|_| "Failed to allocate Process struct (ENOMEM)")?;
     
     // 4. Perform memory copy
@@ -1467,8 +1473,14 @@ pub fn fork_process(child_pid: u32, stack_ptr: u64) -> Result<u32, &'static str>
             for (va, pa, pte_flags) in mapped {
                 // Increment CoW refcount (inserts with count=2 on first share)
                 (runtime().cow_ref_inc)(pa);
-                // Force AP to RO, preserving UXN/PXN from the original PTE
-                let child_flags = (pte_flags & !(mmu::flags::AP_RO_ALL)) | mmu::flags::AP_RO_ALL;
+                // Force AP to RO, preserving UXN/PXN from the original PTE.
+                // A frame shared on purpose keeps the parent's permissions
+                // (demote_range_to_ro leaves it alone too).
+                let child_flags = if (runtime().frame_is_shared)(pa) {
+                    pte_flags
+                } else {
+                    (pte_flags & !(mmu::flags::AP_RO_ALL)) | mmu::flags::AP_RO_ALL
+                };
                 child_as.map_page(va, pa, child_flags)?;
                 child_as.track_user_frame(PhysFrame::new(pa));
             }
@@ -2011,6 +2023,7 @@ pub fn vfork_process(child_pid: u32, stack_ptr: u64) -> Result<u32, &'static str
         current_syscall: core::sync::atomic::AtomicU64::new(!0),
         last_syscall: core::sync::atomic::AtomicU64::new(0),
         syscall_stats: ProcessSyscallStats::new(),
+        emulation: EmulationStats::new(),
     }).map_err(|_| "Failed to allocate Process struct (ENOMEM)")?;
 
     // Child context: inherit the parent's, return 0, clean EL0t, optional new SP.
@@ -2121,6 +2134,7 @@ pub fn clone_thread(stack: u64, tls: u64, parent_tid_ptr: u64, child_tid_ptr: u6
         current_syscall: core::sync::atomic::AtomicU64::new(!0),
         last_syscall: core::sync::atomic::AtomicU64::new(0),
         syscall_stats: ProcessSyscallStats::new(),
+        emulation: EmulationStats::new(),
     }).map_err(|_| "Failed to allocate Process struct (ENOMEM)")?;
 
     let parent_tid = crate::threading::current_thread_id();
@@ -105,6 +105,85 @@ impl ProcessSyscallStats {
     }
 }
 
+/// Instruction classes the kernel emulates for EL0 (src/exceptions.rs).
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum EmuClass {
+    /// `DC ZVA` that QEMU TCG delivered as EC=0x15 (SVC) instead of trapping
+    DcZvaMisrouted = 0,
+    /// `DC ZVA` trapped as a system-register access (EC=0x18)
+    DcZvaTrapped = 1,
+    /// `stp xzr, xzr, [Xn, #imm]` that QEMU TCG delivered as EC=0x15
+    StpXzrMisrouted = 2,
+}
+
+impl EmuClass {
+    pub const COUNT: usize = 3;
+
+    pub fn name(self) -> &'static str {
+        match self {
+            EmuClass::DcZvaMisrouted => "dc_zva_misrouted",
+            EmuClass::DcZvaTrapped => "dc_zva_trapped",
+            EmuClass::StpXzrMisrouted => "stp_xzr_misrouted",
+        }
+    }
+}
+
+/// Per-process counters for EL0 instruction emulation, shown in
+/// `/proc/<pid>/emulation`. Under TCG a memset-heavy loop can take these traps
+/// millions of times; this makes that visible per process.
+pub struct EmulationStats {
+    counts: [AtomicU64; EmuClass::COUNT],
+    /// Bytes zeroed through `copy_to_user_safe`
+    pub bytes_zeroed: AtomicU64,
+    /// Unpopulated anonymous pages installed already zeroed instead of copied to
+    pub pages_prefaulted: AtomicU64,
+    /// Page the last emulated store hit, and how many in a row hit it
+    last_page: AtomicU64,
+    streak: AtomicU64,
+}
+
+impl EmulationStats {
+    pub const fn new() -> Self {
+        Self {
+            counts: [const { AtomicU64::new(0) }; EmuClass::COUNT],
+            bytes_zeroed: AtomicU64::new(0),
+            pages_prefaulted: AtomicU64::new(0),
+            last_page: AtomicU64::new(0),
+            streak: AtomicU64::new(0),
+        }
+    }
+
+    pub fn inc(&self, class: EmuClass) {
+        self.counts[class as usize].fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub fn count(&self, class: EmuClass) -> u64 {
+        self.counts[class as usize].load(Ordering::Relaxed)
+    }
+
+    /// Record a store to `page_va`; returns how many consecutive emulated
+    /// stores (this one included) have hit that page.
+    pub fn note_page(&self, page_va: usize) -> u64 {
+        if self.last_page.swap(page_va as u64, Ordering::Relaxed) == page_va as u64 {
+            self.streak.fetch_add(1, Ordering::Relaxed) + 1
+        } else {
+            self.streak.store(1, Ordering::Relaxed);
+            1
+        }
+    }
+
+    /// `/proc/<pid>/emulation`: one `name value` line per counter.
+    pub fn format(&self) -> String {
+        let mut s = String::new();
+        for class in [EmuClass::DcZvaMisrouted, EmuClass::DcZvaTrapped, EmuClass::StpXzrMisrouted] {
+            let _ = writeln!(&mut s, "{} {}", class.name(), self.count(class));
+        }
+        let _ = writeln!(&mut s, "bytes_zeroed {}", self.bytes_zeroed.load(Ordering::Relaxed));
+        let _ = writeln!(&mut s, "pages_prefaulted {}", self.pages_prefaulted.load(Ordering::Relaxed));
+        s
+    }
+}
+
 pub fn dump_running_process_stats() {
     if !process_syscall_stats_enabled() { return; }
     let mut pids: Vec<(Pid, String, u64)> = Vec::new();
@@ -167,7 +167,9 @@ pub enum FileDescriptor {
     /// `read` with no frame ready blocks (cooperatively yields) until one arrives;
     /// when true it returns `EAGAIN` — POSIX device-read semantics, so the rump
     /// virtif RX thread can do a plain blocking `read()` instead of busy-polling.
-    Tap { nonblock: bool },
+    /// `bounce`: the open file's preallocated staging buffers (kernel tap
+    /// table id), shared by `dup`/fork copies and freed with the last one.
+    Tap { nonblock: bool, bounce: u32 },
     /// A socket living in a `stack=rump` box's NetBSD `rump_server`. The box
     /// process sees a normal low-numbered fd; the kernel proxy forwards this
     /// fd's socket syscalls over the box's sysproxy channel, translating the box
@@ -247,6 +249,25 @@ pub enum LazySource {
     },
 }
 
+/// Per-region readahead state for file-backed demand paging: the `madvise`
+/// hint and the adaptive window (see `lazy_region_readahead`). Copied into
+/// every piece when a region is split, as Linux keeps it per VMA.
+#[derive(Clone, Copy, Default)]
+pub struct Readahead {
+    /// `MADV_NORMAL` (0), `MADV_RANDOM` (1) or `MADV_SEQUENTIAL` (2).
+    pub advice: u8,
+    /// Current window in pages; 0 until the region's first file fault.
+    pub window: u32,
+    /// First VA past the last window — where a sequential reader faults next.
+    pub next_va: usize,
+}
+
+impl Readahead {
+    pub const NORMAL: u8 = 0;
+    pub const RANDOM: u8 = 1;
+    pub const SEQUENTIAL: u8 = 2;
+}
+
 /// A lazily-backed virtual memory region.
 #[derive(Clone)]
 pub struct LazyRegion {
@@ -254,6 +275,7 @@ pub struct LazyRegion {
     pub size: usize,
     pub flags: u64,
     pub source: LazySource,
+    pub ra: Readahead,
 }
 
 /// Process state
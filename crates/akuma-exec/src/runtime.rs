@@ -132,7 +132,12 @@ pub struct ExecRuntime {
     pub eventfd_close: fn(u32),
     pub eventfd_clone_ref: fn(u32),
     pub epoll_destroy: fn(u32),
+    /// Wake of a poller id tagged with [`POLLER_TOKEN_TAG`](crate::threading::POLLER_TOKEN_TAG):
+    /// the kernel's epoll ready list (may run in IRQ context; must not allocate).
+    pub epoll_token_wake: fn(usize),
     pub pidfd_close: fn(u32),
+    pub tap_close: fn(u32),
+    pub tap_clone_ref: fn(u32),
 
     // VFS helpers
     pub resolve_symlinks: fn(&str) -> alloc::string::String,
@@ -150,6 +155,9 @@ pub struct ExecRuntime {
     pub cow_ref_inc: fn(usize),
     pub cow_ref_dec: fn(usize) -> bool,
     pub cow_ref_get: fn(usize) -> u16,
+    /// Frame mapped shared on purpose: fork maps it writable in both processes
+    /// instead of copy-on-write.
+    pub frame_is_shared: fn(usize) -> bool,
 
     /// Optional hook run at the tail of `UserAddressSpace::new()`, after the default
     /// identity kernel mappings are installed. `None` on a normal (single-kernel /
@@ -204,6 +212,9 @@ pub struct ExecConfig {
     /// Enable the vfork fast-path (shared-AS child for CLONE_VFORK). See
     /// `config::VFORK_FASTPATH_ENABLED`.
     pub vfork_fastpath_enabled: bool,
+    /// Map the read-only time page into every user address space and enable EL0
+    /// counter reads. See `config::TIME_PAGE_ENABLED` and `timepage`.
+    pub time_page_enabled: bool,
 
     /// Always load an exec'd ELF whole (via `runtime().read_file`) instead of the
     /// demand-paged path, regardless of size. Set on a multikernel SECONDARY core, where
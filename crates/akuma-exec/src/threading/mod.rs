@@ -2291,6 +2291,8 @@ pub fn sgi_scheduler_handler_with_sp(irq: u32, current_sp: u64) -> u64 {
                 "isb",
                 ttbr0 = in(reg) new_ttbr0,
             );
+            // Per-process PMCCNTR/CNTVCT grants follow the address space
+            crate::el0_counters::switch_to(new_ttbr0);
             
             if config().enable_sgi_debug_prints {
                 safe_print!(64, "[SGI-S] returning new_sp={:#x}\n", new_sp);
@@ -2351,6 +2353,13 @@ pub fn update_thread_context(thread_id: usize, user_context: &crate::process::Us
 
 use core::task::{RawWaker, RawWakerVTable, Waker};
 
+/// Poller ids with this bit set are not thread ids but epoll tokens
+/// (`epoll_id << 32 | fd`, see the kernel's `syscall::poll`). Resources keep
+/// them in the same `pollers` sets as tids and wake them the same way;
+/// [`ThreadWaker::wake`] hands them to `ExecRuntime::epoll_token_wake`, which
+/// appends the fd to that instance's ready list.
+pub const POLLER_TOKEN_TAG: usize = 1 << 63;
+
 /// Waker implementation for thread-based waking
 pub struct ThreadWaker {
     thread_id: usize,
@@ -2379,6 +2388,8 @@ impl ThreadWaker {
                 // Trigger SGI to ensure scheduler runs and picks up the thread
                 (runtime().trigger_sgi)(0);
             }
+        } else if tid & POLLER_TOKEN_TAG != 0 {
+            (runtime().epoll_token_wake)(tid);
         }
     }
 }
@@ -2638,6 +2649,24 @@ pub fn current_thread_id() -> usize {
     get_current_thread_register()
 }
 
+/// Cores a per-CPU table needs a slot for (`akuma_smp::MAX_CORES`).
+pub const MAX_CPUS: usize = 8;
+
+/// Index of the calling core for per-CPU tables: `MPIDR_EL1.Aff0`, as `smp`
+/// numbers the cores, clamped below [`MAX_CPUS`]. Always 0 on the host.
+#[inline]
+pub fn current_cpu() -> usize {
+    #[cfg(target_os = "none")]
+    let cpu = {
+        let mpidr: u64;
+        unsafe { core::arch::asm!("mrs {}, mpidr_el1", out(reg) mpidr, options(nomem, nostack)) };
+        (mpidr & 0xff) as usize
+    };
+    #[cfg(not(target_os = "none"))]
+    let cpu = 0;
+    cpu.min(MAX_CPUS - 1)
+}
+
 /// Pend a signal on the given thread slot.
 /// The signal will be delivered at the next syscall return for that thread.
 /// Overwrites any previously pending signal (only one pending signal supported).
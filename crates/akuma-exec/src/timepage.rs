@@ -0,0 +1,164 @@
+//! Read-only time page mapped into every user address space.
+//!
+//! The kernel enables EL0 reads of `CNTVCT_EL0` (CNTKCTL_EL1.EL0VCTEN) and
+//! publishes what userspace cannot read itself — the counter frequency and
+//! the CLOCK_REALTIME offset — in one page mapped RO/no-exec at
+//! [`TIME_PAGE_VA`].  The VA is handed to the process in the auxv under
+//! [`AT_AKUMA_TIMEPAGE`](crate::elf_loader::types::auxv::AT_AKUMA_TIMEPAGE),
+//! so `clock_gettime` and friends become `mrs cntvct_el0` plus a little
+//! arithmetic instead of an SVC round trip (see docs/TIME_PAGE.md).
+//!
+//! One physical page per kernel instance, shared by every process and never
+//! freed.  It is mapped with `map_page` and deliberately not tracked as a
+//! user frame, so address-space teardown leaves it alone; a write from EL0 is
+//! a permission fault on a page with no CoW refcount and no lazy region, which
+//! the fault handler turns into SIGSEGV.
+
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use spinning_top::Spinlock;
+
+use crate::mmu::{self, UserAddressSpace, user_flags};
+use crate::runtime::{runtime, with_irqs_disabled, FrameSource};
+
+/// Last page of L0[0] (just under 512 GB): above `MAX_STACK_TOP` (256 GB) and
+/// the mmap window below it, below the device mappings at L0[1].
+pub const TIME_PAGE_VA: usize = 0x7F_FFFF_F000;
+
+/// "AKTP" little-endian.
+pub const TIME_PAGE_MAGIC: u32 = 0x5054_4B41;
+pub const TIME_PAGE_VERSION: u32 = 1;
+
+/// `flags` bit: `realtime_off_ns` is valid (the RTC or NTP has set the time).
+pub const TP_REALTIME_VALID: u64 = 1 << 0;
+
+/// Layout shared with userspace (libakuma `time_page`, rumpuser `clock.rs`,
+/// `userspace/forktest/c_stress/clock_bench.c`).  Readers follow the usual
+/// seqlock protocol: read `seq`, retry while odd, read the fields, retry if
+/// `seq` changed.
+#[repr(C)]
+pub struct TimePage {
+    pub magic: u32,
+    pub version: u32,
+    pub seq: AtomicU32,
+    pub _pad: u32,
+    /// `CNTFRQ_EL0` in Hz.
+    pub cntfrq: AtomicU64,
+    /// CLOCK_REALTIME = this + [`counter_to_ns`] (the boot offset in ns since
+    /// the Unix epoch).
+    pub realtime_off_ns: AtomicU64,
+    pub flags: AtomicU64,
+}
+
+/// Counter ticks → nanoseconds, exactly (no mult/shift rounding), so the
+/// syscall path and the EL0 fast path agree to the nanosecond for the same
+/// counter value.  Two 64-bit divisions; `rem * 1e9` cannot overflow for any
+/// frequency below 18 GHz.
+#[inline]
+pub const fn counter_to_ns(cnt: u64, freq: u64) -> u64 {
+    if freq == 0 {
+        return 0;
+    }
+    (cnt / freq) * 1_000_000_000 + (cnt % freq) * 1_000_000_000 / freq
+}
+
+/// Physical address of this kernel's time page (0 until the first process).
+/// The lock also orders publishes against the lazy allocation.
+static PAGE_PA: Spinlock<usize> = Spinlock::new(0);
+static REALTIME_OFF_NS: AtomicU64 = AtomicU64::new(0);
+static REALTIME_VALID: AtomicU64 = AtomicU64::new(0);
+
+fn page_ptr(pa: usize) -> *const TimePage {
+    mmu::phys_to_virt(pa).cast::<TimePage>().cast_const()
+}
+
+/// Rewrite the published fields under the seqlock.  Caller holds `PAGE_PA`.
+fn publish(pa: usize) {
+    let page = unsafe { &*page_ptr(pa) };
+    let seq = page.seq.load(Ordering::Relaxed);
+    page.seq.store(seq.wrapping_add(1), Ordering::Relaxed);
+    core::sync::atomic::fence(Ordering::Release);
+    page.cntfrq.store(read_cntfrq(), Ordering::Relaxed);
+    page.realtime_off_ns.store(REALTIME_OFF_NS.load(Ordering::Relaxed), Ordering::Relaxed);
+    page.flags.store(REALTIME_VALID.load(Ordering::Relaxed), Ordering::Relaxed);
+    page.seq.store(seq.wrapping_add(2), Ordering::Release);
+}
+
+#[cfg(target_os = "none")]
+fn read_cntfrq() -> u64 {
+    let f: u64;
+    unsafe { core::arch::asm!("mrs {}, cntfrq_el0", out(reg) f) };
+    f
+}
+
+#[cfg(not(target_os = "none"))]
+fn read_cntfrq() -> u64 {
+    0
+}
+
+/// Publish the CLOCK_REALTIME offset (`None` = wall time unknown).  Called by
+/// the kernel's `timer::set_utc_time_us`; safe before any process exists.
+pub fn set_realtime_offset_ns(off: Option<u64>) {
+    with_irqs_disabled(|| {
+        let pa = PAGE_PA.lock();
+        REALTIME_OFF_NS.store(off.unwrap_or(0), Ordering::Relaxed);
+        REALTIME_VALID.store(if off.is_some() { TP_REALTIME_VALID } else { 0 }, Ordering::Relaxed);
+        if *pa != 0 {
+            publish(*pa);
+        }
+    });
+}
+
+/// This kernel's time page, allocated and filled on first use.
+fn page_pa() -> Option<usize> {
+    with_irqs_disabled(|| {
+        let mut pa = PAGE_PA.lock();
+        if *pa == 0 {
+            let rt = runtime();
+            let frame = (rt.alloc_page_zeroed)()?;
+            (rt.track_frame)(frame, FrameSource::Kernel);
+            let page = unsafe { &mut *page_ptr(frame.addr).cast_mut() };
+            page.magic = TIME_PAGE_MAGIC;
+            page.version = TIME_PAGE_VERSION;
+            publish(frame.addr);
+            *pa = frame.addr;
+        }
+        Some(*pa)
+    })
+}
+
+/// Map the time page read-only (EL0 and EL1), never executable, into `aspace`.
+pub fn map_into(aspace: &mut UserAddressSpace) -> Result<(), &'static str> {
+    let pa = page_pa().ok_or("Failed to allocate time page")?;
+    aspace.map_page(TIME_PAGE_VA, pa, user_flags::RO_NO_EXEC)
+}
+
+/// Value for the `AT_AKUMA_TIMEPAGE` auxv entry, or `None` when disabled.
+pub fn auxv_value() -> Option<u64> {
+    crate::runtime::config().time_page_enabled.then_some(TIME_PAGE_VA as u64)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn counter_to_ns_is_exact() {
+        // QEMU virt: 62.5 MHz → 16 ns per tick.
+        assert_eq!(counter_to_ns(62_500_000, 62_500_000), 1_000_000_000);
+        assert_eq!(counter_to_ns(1, 62_500_000), 16);
+        // 24 MHz (Apple HVF / many SoCs): matches the u128 reference.
+        for cnt in [0u64, 1, 23_999_999, 24_000_000, 86_400 * 24_000_000 + 12_345, 1 << 50] {
+            let want = (u128::from(cnt) * 1_000_000_000 / 24_000_000) as u64;
+            assert_eq!(counter_to_ns(cnt, 24_000_000), want, "cnt={cnt}");
+        }
+        assert_eq!(counter_to_ns(123, 0), 0);
+    }
+
+    #[test]
+    fn layout_is_stable() {
+        assert_eq!(core::mem::offset_of!(TimePage, seq), 8);
+        assert_eq!(core::mem::offset_of!(TimePage, cntfrq), 16);
+        assert_eq!(core::mem::offset_of!(TimePage, realtime_off_ns), 24);
+        assert_eq!(core::mem::offset_of!(TimePage, flags), 32);
+    }
+}
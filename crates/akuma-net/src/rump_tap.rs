@@ -4,7 +4,10 @@
 //! frame send/recv, completely bypassing smoltcp. The kernel surfaces this as a
 //! `/dev/net/tap0` char device whose `read()`/`write()` move whole frames, so a
 //! userspace rump kernel's stock Linux `virtif` backend can drive the NetBSD
-//! TCP/IP stack over it.
+//! TCP/IP stack over it. The `TAPRECVBATCH`/`TAPSENDBATCH` ioctls move several
+//! frames per syscall and per `TAP` lock ([`read_frames`], [`write_frames`]),
+//! and a process that `mmap`s the tap gets a shared slot ring instead
+//! ([`sync_ring`]).
 //!
 //! This module is the **hardware** half: it implements [`akuma_rump::RawNic`]
 //! over virtio-drivers' `VirtIONetRaw` (real DMA via [`NetHal`]) and owns the
@@ -12,29 +15,118 @@
 //! the RX two-phase state machine, the malformed-length bounds guard — lives in
 //! the `akuma-rump` crate, where it is unit-tested on the host with a mock NIC.
 //!
+//! [`set_vnet`] re-initialises NIC1 with checksum/TSO offload negotiated and
+//! switches the tap to carrying a virtio-net header with each frame
+//! ([`akuma_rump::vnet`]). `VirtIONetRaw` negotiates a fixed feature set, so
+//! the extra bits go in through [`OffloadTransport`].
+//!
+//! Blocked readers sleep on NIC1's RX interrupt once the kernel wires it
+//! ([`set_rx_wait`], [`ack_interrupt`]); until then, and on a core with no
+//! interrupt for its NIC, they re-poll between yields.
+//!
 //! NIC0 stays owned by smoltcp (the native stack); `init()` claims the second
 //! virtio-net (the plan's §4 option A — dedicated second NIC). When no second
 //! NIC is present (the default QEMU command line), `init()` returns `Err` and
 //! the tap device never becomes ready; `/dev/net/tap0` then returns `ENODEV`.
 
-use core::sync::atomic::{AtomicBool, Ordering};
+use core::ptr::NonNull;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
 use spinning_top::Spinlock;
 use virtio_drivers::device::net::VirtIONetRaw;
 use virtio_drivers::transport::mmio::{MmioTransport, VirtIOHeader};
+use virtio_drivers::transport::{DeviceStatus, DeviceType, Transport};
+use virtio_drivers::PhysAddr;
 use alloc::vec::Vec;
 use crate::hal::NetHal;
+use akuma_rump::ring::{RingError, RingMem, Synced, TapRing};
+use akuma_rump::vnet::{self, VnetHdr, VNET_HDR_LEN};
 use akuma_rump::{NicError, RawNic, TapNic};
 
 const VIRTIO_MMIO_DEVICE_ID_OFFSET: usize = 0x008;
+const VIRTIO_MMIO_INTERRUPT_STATUS_OFFSET: usize = 0x060;
+const VIRTIO_MMIO_INTERRUPT_ACK_OFFSET: usize = 0x064;
+
+/// Longest a blocked reader sleeps between re-polls even with the RX
+/// interrupt wired, so a lost edge costs latency rather than a hang.
+const RX_PARK_MAX_US: u64 = 100_000;
+
+/// The MMIO transport, negotiating `extra` (offload features the device
+/// offers) on top of the set `VirtIONetRaw` negotiates itself.
+struct OffloadTransport {
+    inner: MmioTransport,
+    extra: u64,
+}
+
+impl Transport for OffloadTransport {
+    fn device_type(&self) -> DeviceType {
+        self.inner.device_type()
+    }
+    fn read_device_features(&mut self) -> u64 {
+        self.inner.read_device_features()
+    }
+    fn write_driver_features(&mut self, driver_features: u64) {
+        self.inner.write_driver_features(driver_features | self.extra);
+    }
+    fn max_queue_size(&mut self, queue: u16) -> u32 {
+        self.inner.max_queue_size(queue)
+    }
+    fn notify(&mut self, queue: u16) {
+        self.inner.notify(queue);
+    }
+    fn get_status(&self) -> DeviceStatus {
+        self.inner.get_status()
+    }
+    fn set_status(&mut self, status: DeviceStatus) {
+        self.inner.set_status(status);
+    }
+    fn set_guest_page_size(&mut self, guest_page_size: u32) {
+        self.inner.set_guest_page_size(guest_page_size);
+    }
+    fn requires_legacy_layout(&self) -> bool {
+        self.inner.requires_legacy_layout()
+    }
+    fn queue_set(&mut self, queue: u16, size: u32, descriptors: PhysAddr, driver_area: PhysAddr, device_area: PhysAddr) {
+        self.inner.queue_set(queue, size, descriptors, driver_area, device_area);
+    }
+    fn queue_unset(&mut self, queue: u16) {
+        self.inner.queue_unset(queue);
+    }
+    fn queue_used(&mut self, queue: u16) -> bool {
+        self.inner.queue_used(queue)
+    }
+    fn ack_interrupt(&mut self) -> bool {
+        self.inner.ack_interrupt()
+    }
+    fn config_space<T: 'static>(&self) -> virtio_drivers::Result<NonNull<T>> {
+        self.inner.config_space()
+    }
+}
 
 /// The real raw NIC: a virtio-net device driven without buffer management.
 /// Wraps the `unsafe` `VirtIONetRaw` calls in the safe [`RawNic`] trait so the
 /// `akuma-rump` orchestration (and its host tests) need no virtio knowledge.
 struct VirtioRawNic {
-    inner: VirtIONetRaw<NetHal, MmioTransport, 16>,
+    inner: VirtIONetRaw<NetHal, OffloadTransport, 16>,
+    /// Offload features negotiated, of those asked for.
+    offloads: u64,
+    /// Device header + frame for [`RawNic::send_vnet`]; one heap allocation,
+    /// so physically contiguous for the DMA (see [`TapNic`]). Sized on first
+    /// use: only a vnet-mode tap needs it.
+    tx_buf: Vec<u8>,
 }
 
 impl VirtioRawNic {
+    /// Initialise the virtio-net at `addr`, negotiating the offload features
+    /// in `want` that it offers.
+    fn new(addr: usize, want: u64) -> Result<Self, &'static str> {
+        let header_ptr = NonNull::new(addr as *mut VirtIOHeader).ok_or("tap: bad mmio addr")?;
+        let mut mmio = unsafe { MmioTransport::new(header_ptr) }.map_err(|_| "tap: transport init failed")?;
+        let offloads = vnet::negotiate(mmio.read_device_features()) & want;
+        let transport = OffloadTransport { inner: mmio, extra: offloads };
+        let inner = VirtIONetRaw::new(transport).map_err(|_| "tap: VirtIONetRaw init failed")?;
+        Ok(Self { inner, offloads, tx_buf: Vec::new() })
+    }
+
     fn mac(&self) -> [u8; 6] {
         self.inner.mac_address()
     }
@@ -44,8 +136,8 @@ impl RawNic for VirtioRawNic {
     fn receive_begin(&mut self, buf: &mut [u8]) -> Result<u16, NicError> {
         unsafe { self.inner.receive_begin(buf) }.map_err(|_| NicError)
     }
-    fn poll_receive(&mut self) -> bool {
-        self.inner.poll_receive().is_some()
+    fn poll_receive(&mut self) -> Option<u16> {
+        self.inner.poll_receive()
     }
     fn receive_complete(&mut self, token: u16, buf: &mut [u8]) -> Result<(usize, usize), NicError> {
         unsafe { self.inner.receive_complete(token, buf) }.map_err(|_| NicError)
@@ -53,10 +145,44 @@ impl RawNic for VirtioRawNic {
     fn send(&mut self, frame: &[u8]) -> Result<(), NicError> {
         self.inner.send(frame).map_err(|_| NicError)
     }
+    fn send_vnet(&mut self, hdr: &VnetHdr, frame: &[u8]) -> Result<(), NicError> {
+        if self.tx_buf.is_empty() {
+            // The device header is at most 12 bytes (with `num_buffers`).
+            self.tx_buf = alloc::vec![0u8; 12 + vnet::TSO_FRAME_MAX];
+        }
+        let buf = &mut self.tx_buf[..];
+        let hdr_len = self.inner.fill_buffer_header(buf).map_err(|_| NicError)?;
+        let end = hdr_len + frame.len();
+        if hdr_len < VNET_HDR_LEN || end > buf.len() {
+            return Err(NicError);
+        }
+        buf[..VNET_HDR_LEN].copy_from_slice(&hdr.to_bytes());
+        buf[hdr_len..end].copy_from_slice(frame);
+        // Wait for the device to take it, as `send` does: the buffer is
+        // reused by the next frame.
+        let token = unsafe { self.inner.transmit_begin(&buf[..end]) }.map_err(|_| NicError)?;
+        while self.inner.poll_transmit() != Some(token) {
+            core::hint::spin_loop();
+        }
+        unsafe { self.inner.transmit_complete(token, &buf[..end]) }.map_err(|_| NicError)
+    }
 }
 
 static TAP: Spinlock<Option<TapNic<VirtioRawNic>>> = Spinlock::new(None);
 static READY: AtomicBool = AtomicBool::new(false);
+/// MMIO base of the bound NIC, for [`ack_interrupt`] (which must not take `TAP`).
+static MMIO_BASE: AtomicUsize = AtomicUsize::new(0);
+
+/// Kernel hooks that let a blocked reader sleep until NIC1's RX interrupt.
+#[derive(Clone, Copy)]
+pub struct RxWait {
+    /// Register the current thread to be woken by the next RX interrupt.
+    pub arm: fn(),
+    /// Sleep until woken or the `uptime_us` deadline passes.
+    pub park: fn(u64),
+}
+
+static RX_WAIT: Spinlock<Option<RxWait>> = Spinlock::new(None);
 
 /// Bind NIC1 to the tap path.
 ///
@@ -87,25 +213,82 @@ pub fn init(mmio_addrs: &[usize]) -> Result<[u8; 6], &'static str> {
 /// binds the NIC on `virtio-mmio-bus.5` (docs/MULTIKERNEL_NETWORKING_EXPERIMENT.md Stage 0/1).
 /// Returns the NIC MAC on success.
 pub fn init_at(addr: usize) -> Result<[u8; 6], &'static str> {
-    let header_ptr =
-        core::ptr::NonNull::new(addr as *mut VirtIOHeader).ok_or("tap: bad mmio addr")?;
-    let transport =
-        unsafe { MmioTransport::new(header_ptr) }.map_err(|_| "tap: transport init failed")?;
-    let inner = VirtIONetRaw::new(transport).map_err(|_| "tap: VirtIONetRaw init failed")?;
-
-    let nic = VirtioRawNic { inner };
+    let nic = VirtioRawNic::new(addr, 0)?;
     let mac = nic.mac();
     *TAP.lock() = Some(TapNic::new(nic));
+    MMIO_BASE.store(addr, Ordering::Release);
     READY.store(true, Ordering::Release);
     Ok(mac)
 }
 
+/// Switch the tap into (`on`) or out of [`akuma_rump::vnet`] mode. Returns
+/// the offload features now negotiated (`0` when off, or when the device
+/// offers none, as QEMU's user-mode netdev does).
+///
+/// Changing mode re-initialises NIC1 so the new feature set is negotiated:
+/// frames in flight are dropped, as on a link reset. Setting the current
+/// mode is a no-op.
+pub fn set_vnet(on: bool) -> Result<u64, &'static str> {
+    let addr = MMIO_BASE.load(Ordering::Acquire);
+    let mut guard = TAP.lock();
+    let Some(tap) = guard.as_ref() else { return Err("tap: not ready") };
+    if tap.vnet().is_some() == on {
+        return Ok(tap.vnet().unwrap_or(0));
+    }
+    // The old driver resets its queues on drop; free them before the new
+    // one claims the device.
+    drop(guard.take());
+    let nic = match VirtioRawNic::new(addr, if on { vnet::OFFLOAD_FEATURES } else { 0 }) {
+        Ok(nic) => nic,
+        Err(e) => {
+            READY.store(false, Ordering::Release);
+            return Err(e);
+        }
+    };
+    let offloads = nic.offloads;
+    *guard = Some(if on { TapNic::with_vnet(nic, offloads) } else { TapNic::new(nic) });
+    Ok(if on { offloads } else { 0 })
+}
+
 /// Whether NIC1 was found and bound (i.e. `/dev/net/tap0` is usable).
 #[must_use]
 pub fn is_ready() -> bool {
     READY.load(Ordering::Acquire)
 }
 
+/// Install the RX interrupt hooks: from now on blocked readers `arm` and
+/// `park` instead of yielding. Called once the kernel routes NIC1's IRQ to a
+/// handler that calls [`ack_interrupt`] and wakes the armed threads.
+pub fn set_rx_wait(wait: RxWait) {
+    *RX_WAIT.lock() = Some(wait);
+}
+
+/// Acknowledge NIC1's pending interrupt from the IRQ handler. Returns whether
+/// it had raised one (used-buffer or config change), i.e. whether waiters
+/// should be woken.
+///
+/// Touches only the transport's status/ack registers, never `TAP`, so it is
+/// safe while the interrupted thread holds the lock.
+pub fn ack_interrupt() -> bool {
+    let base = MMIO_BASE.load(Ordering::Acquire);
+    if base == 0 {
+        return false;
+    }
+    unsafe {
+        let status = core::ptr::read_volatile((base + VIRTIO_MMIO_INTERRUPT_STATUS_OFFSET) as *const u32);
+        if status == 0 {
+            return false;
+        }
+        core::ptr::write_volatile((base + VIRTIO_MMIO_INTERRUPT_ACK_OFFSET) as *mut u32, status);
+    }
+    true
+}
+
+/// Whether an RX frame is waiting, without taking it (`POLLIN` on the tap).
+pub fn rx_ready() -> bool {
+    TAP.lock().as_mut().is_some_and(TapNic::has_frame)
+}
+
 /// Pull one received L2 frame into `buf`. `Some(len)` if a frame was available
 /// (truncated to `buf.len()`), `None` if none ready (caller → `EAGAIN`).
 pub fn read_frame(buf: &mut [u8]) -> Option<usize> {
@@ -115,25 +298,82 @@ pub fn read_frame(buf: &mut [u8]) -> Option<usize> {
 
 /// Blocking variant of [`read_frame`]: wait until a frame is available, then return it.
 ///
-/// Cooperative — re-polls the tap and yields the CPU to the scheduler between attempts
-/// (Akuma's net is poll-based, no RX IRQ), so the calling thread (the rump virtif RX
-/// kthread) sleeps efficiently instead of busy-waiting. Returns `None` only if
-/// interrupted, or if `timeout_us` elapses with no frame.
+/// The calling thread (the rump virtif RX kthread) sleeps until NIC1's RX interrupt
+/// when one is wired ([`set_rx_wait`]), else re-polls the tap between yields. Returns
+/// `None` only if interrupted, or if `timeout_us` elapses with no frame.
 pub fn read_frame_blocking(buf: &mut [u8], timeout_us: Option<u64>) -> Option<usize> {
+    block_on(timeout_us, || read_frame(buf))
+}
+
+/// Pull every ready frame, up to `max_frames`, into `buf` as
+/// [`akuma_rump::BATCH_HDR`] records, under one lock. `Some((frames, bytes
+/// used))`, or `None` if no frame is ready (caller → `EAGAIN`).
+pub fn read_frames(buf: &mut [u8], max_frames: usize) -> Option<(usize, usize)> {
+    let mut guard = TAP.lock();
+    match guard.as_mut()?.read_frames(buf, max_frames) {
+        (0, _) => None,
+        got => Some(got),
+    }
+}
+
+/// Blocking variant of [`read_frames`]: wait for the first frame, then take
+/// whatever else is ready with it.
+pub fn read_frames_blocking(buf: &mut [u8], max_frames: usize, timeout_us: Option<u64>) -> Option<(usize, usize)> {
+    block_on(timeout_us, || read_frames(buf, max_frames))
+}
+
+/// Move frames between a process's mapped ring and the NIC under one lock
+/// (see [`akuma_rump::ring`]).
+pub fn sync_ring<M: RingMem>(ring: &mut TapRing, mem: &mut M) -> Result<Synced, RingError> {
+    let mut guard = TAP.lock();
+    let tap = guard.as_mut().ok_or(RingError::Fault)?;
+    ring.sync(tap, mem)
+}
+
+/// Blocking variant of [`sync_ring`]: re-sync (which also flushes TX queued
+/// meanwhile) until an RX frame is waiting. `None` on interrupt or timeout.
+pub fn sync_ring_blocking<M: RingMem>(
+    ring: &mut TapRing,
+    mem: &mut M,
+    timeout_us: Option<u64>,
+) -> Option<Result<Synced, RingError>> {
+    block_on(timeout_us, || match sync_ring(ring, mem) {
+        Ok(s) if s.rx_ready == 0 => None,
+        other => Some(other),
+    })
+}
+
+/// Re-run `poll` until it yields, sleeping on the RX interrupt (or yielding
+/// the CPU, with none wired) in between; `None` on interrupt or timeout.
+///
+/// The thread arms before polling, so a frame landing between an empty poll
+/// and the park still wakes it (the kernel's wake is sticky).
+fn block_on<T>(timeout_us: Option<u64>, mut poll: impl FnMut() -> Option<T>) -> Option<T> {
     let rt = crate::runtime::runtime();
+    let wait = *RX_WAIT.lock();
     let start = (rt.uptime_us)();
     loop {
-        if let Some(n) = read_frame(buf) {
-            return Some(n);
+        if let Some(w) = wait {
+            (w.arm)();
+        }
+        if let Some(got) = poll() {
+            return Some(got);
         }
         if (rt.is_current_interrupted)() {
             return None;
         }
+        let now = (rt.uptime_us)();
         if let Some(t) = timeout_us
-            && (rt.uptime_us)() - start > t {
+            && now - start > t {
                 return None;
             }
-        (rt.yield_now)();
+        match wait {
+            Some(w) => {
+                let deadline = timeout_us.map_or(u64::MAX, |t| start + t);
+                (w.park)(deadline.min(now + RX_PARK_MAX_US));
+            }
+            None => (rt.yield_now)(),
+        }
     }
 }
 
@@ -143,3 +383,11 @@ pub fn write_frame(frame: &[u8]) -> Result<usize, &'static str> {
     let tap = guard.as_mut().ok_or("tap: not ready")?;
     tap.write_frame(frame).map_err(|_| "tap: send failed")
 }
+
+/// Transmit the frames of a batch buffer ([`akuma_rump::BATCH_HDR`] records)
+/// under one lock. Returns how many were sent.
+pub fn write_frames(batch: &[u8]) -> Result<usize, &'static str> {
+    let mut guard = TAP.lock();
+    let tap = guard.as_mut().ok_or("tap: not ready")?;
+    tap.write_frames(batch).map_err(|_| "tap: send failed")
+}
@@ -20,6 +20,9 @@ pub struct NetRuntime {
     /// tracking (see `smoltcp_net::network_holder_snapshot`). Plain `u32`
     /// because the holder slot is an `AtomicU32` and stays IRQ-friendly.
     pub current_thread_id: fn() -> u32,
+    /// Index of the calling core, below 8 (`akuma_exec::threading::current_cpu`).
+    /// Picks the per-CPU tap stats slot.
+    pub current_cpu: fn() -> usize,
 }
 
 static RUNTIME: Spinlock<Option<NetRuntime>> = Spinlock::new(None);
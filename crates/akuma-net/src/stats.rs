@@ -1,8 +1,10 @@
 //! Network Statistics
 //!
 //! Provides network statistics tracking for the async network stack.
-//! The actual networking is handled by `async_net` module.
+//! The actual networking is handled by `async_net` module. The raw tap
+//! device (`/dev/net/tap0`) keeps its own per-CPU counters ([`tap_stats`]).
 
+use core::sync::atomic::{AtomicU64, Ordering};
 use spinning_top::Spinlock;
 
 // ============================================================================
@@ -51,3 +53,111 @@ pub fn get_stats() -> (u64, u64, u64) {
     let s = NET_STATS.lock();
     (s.connections, s.bytes_rx, s.bytes_tx)
 }
+
+// ============================================================================
+// /dev/net/tap0 statistics (per CPU)
+// ============================================================================
+//
+// Bumped on every tap read/write, so they are plain relaxed atomics in one
+// cache line per core instead of the spinlock above: concurrent readers on
+// different cores never share a line, and a snapshot sums the slots.
+
+/// Cores with their own slot; `NetRuntime::current_cpu` stays below this.
+const TAP_STATS_CPUS: usize = 8;
+
+/// Tap counters of one core.
+#[derive(Clone, Copy, Default, Debug, PartialEq, Eq)]
+pub struct TapStats {
+    /// Frames handed to `read()` callers, and their bytes
+    pub rx_frames: u64,
+    pub rx_bytes: u64,
+    /// Frames sent by `write()`, and their bytes
+    pub tx_frames: u64,
+    pub tx_bytes: u64,
+    /// Staging buffers allocated (one per `open`) or grown; flat once warm
+    pub bounce_allocs: u64,
+    /// Reads/writes that found their fd's staging buffer in use by another
+    /// thread and used a temporary one
+    pub bounce_busy: u64,
+}
+
+#[repr(align(64))]
+struct TapStatsSlot {
+    rx_frames: AtomicU64,
+    rx_bytes: AtomicU64,
+    tx_frames: AtomicU64,
+    tx_bytes: AtomicU64,
+    bounce_allocs: AtomicU64,
+    bounce_busy: AtomicU64,
+}
+
+impl TapStatsSlot {
+    const fn new() -> Self {
+        Self {
+            rx_frames: AtomicU64::new(0),
+            rx_bytes: AtomicU64::new(0),
+            tx_frames: AtomicU64::new(0),
+            tx_bytes: AtomicU64::new(0),
+            bounce_allocs: AtomicU64::new(0),
+            bounce_busy: AtomicU64::new(0),
+        }
+    }
+}
+
+static TAP_STATS: [TapStatsSlot; TAP_STATS_CPUS] = [const { TapStatsSlot::new() }; TAP_STATS_CPUS];
+
+/// This core's slot, from the kernel's current-CPU index (slot 0 before the
+/// runtime is registered, and in host tests).
+fn tap_slot() -> &'static TapStatsSlot {
+    let cpu = crate::runtime::try_runtime().map_or(0, |rt| (rt.current_cpu)());
+    &TAP_STATS[cpu.min(TAP_STATS_CPUS - 1)]
+}
+
+/// Count one frame read by a process.
+pub fn tap_rx(bytes: usize) {
+    let s = tap_slot();
+    s.rx_frames.fetch_add(1, Ordering::Relaxed);
+    s.rx_bytes.fetch_add(bytes as u64, Ordering::Relaxed);
+}
+
+/// Count one frame written by a process.
+pub fn tap_tx(bytes: usize) {
+    let s = tap_slot();
+    s.tx_frames.fetch_add(1, Ordering::Relaxed);
+    s.tx_bytes.fetch_add(bytes as u64, Ordering::Relaxed);
+}
+
+/// Count a staging buffer allocation.
+pub fn tap_bounce_alloc() {
+    tap_slot().bounce_allocs.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Count a read/write that found its staging buffer busy.
+pub fn tap_bounce_busy() {
+    tap_slot().bounce_busy.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Tap counters of core `cpu` (`None` past the last slot).
+pub fn tap_stats_cpu(cpu: usize) -> Option<TapStats> {
+    let s = TAP_STATS.get(cpu)?;
+    Some(TapStats {
+        rx_frames: s.rx_frames.load(Ordering::Relaxed),
+        rx_bytes: s.rx_bytes.load(Ordering::Relaxed),
+        tx_frames: s.tx_frames.load(Ordering::Relaxed),
+        tx_bytes: s.tx_bytes.load(Ordering::Relaxed),
+        bounce_allocs: s.bounce_allocs.load(Ordering::Relaxed),
+        bounce_busy: s.bounce_busy.load(Ordering::Relaxed),
+    })
+}
+
+/// Tap counters summed over every core.
+pub fn tap_stats() -> TapStats {
+    (0..TAP_STATS_CPUS).filter_map(tap_stats_cpu).fold(TapStats::default(), |a, b| TapStats {
+        rx_frames: a.rx_frames + b.rx_frames,
+        rx_bytes: a.rx_bytes + b.rx_bytes,
+        tx_frames: a.tx_frames + b.tx_frames,
+        tx_bytes: a.tx_bytes + b.tx_bytes,
+        bounce_allocs: a.bounce_allocs + b.bounce_allocs,
+        bounce_busy: a.bounce_busy + b.bounce_busy,
+    })
+}
@@ -108,6 +108,24 @@ mod stats_tests {
         assert_eq!(rx_after, rx_before + 100);
         assert_eq!(tx_after, tx_before + 200);
     }
+
+    #[test]
+    fn tap_stats_sum_counters() {
+        let before = stats::tap_stats();
+        stats::tap_rx(1514);
+        stats::tap_rx(60);
+        stats::tap_tx(1514);
+        stats::tap_bounce_alloc();
+        stats::tap_bounce_busy();
+        let after = stats::tap_stats();
+        assert_eq!(after.rx_frames, before.rx_frames + 2);
+        assert_eq!(after.rx_bytes, before.rx_bytes + 1574);
+        assert_eq!(after.tx_frames, before.tx_frames + 1);
+        assert_eq!(after.tx_bytes, before.tx_bytes + 1514);
+        assert_eq!(after.bounce_allocs, before.bounce_allocs + 1);
+        assert_eq!(after.bounce_busy, before.bounce_busy + 1);
+        assert!(stats::tap_stats_cpu(0).is_some());
+    }
 }
 
 #[cfg(test)]
@@ -0,0 +1,134 @@
+//! Lock-free log2 latency histogram for the sysproxy client instrumentation.
+//!
+//! The kernel records one sample per proxied syscall (and one per blocking
+//! wait on the reply pipe) from whichever core issued it, so recording is a
+//! single relaxed `fetch_add` on a bucket. Bucket `i` counts samples in
+//! `[2^(i-1), 2^i)` µs (bucket 0 is exactly 0 µs), so a percentile is reported
+//! as the upper edge of the bucket it falls in: "p99 <= 2048us". That is coarse
+//! but stable, and it is what the p50/p99 before/after comparisons need.
+
+use core::sync::atomic::{AtomicU32, Ordering};
+
+/// Buckets up to `2^(BUCKETS-1)` µs (~4.2 s); slower samples land in the last.
+pub const BUCKETS: usize = 24;
+
+/// Histogram of microsecond samples; `const`-constructible for statics.
+pub struct LatHist {
+    buckets: [AtomicU32; BUCKETS],
+}
+
+impl LatHist {
+    #[allow(clippy::declare_interior_mutable_const)]
+    const ZERO: AtomicU32 = AtomicU32::new(0);
+
+    #[must_use]
+    pub const fn new() -> Self {
+        Self { buckets: [Self::ZERO; BUCKETS] }
+    }
+
+    /// Count one sample of `us` microseconds.
+    pub fn record(&self, us: u64) {
+        let i = (u64::BITS - us.leading_zeros()) as usize;
+        self.buckets[i.min(BUCKETS - 1)].fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Copy the counts out and zero them, so each report covers one window.
+    /// Samples racing the take land in either this window or the next.
+    pub fn take(&self) -> LatSnapshot {
+        let mut counts = [0u32; BUCKETS];
+        for (c, b) in counts.iter_mut().zip(&self.buckets) {
+            *c = b.swap(0, Ordering::Relaxed);
+        }
+        LatSnapshot { counts }
+    }
+}
+
+impl Default for LatHist {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// One window's bucket counts, taken from a [`LatHist`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct LatSnapshot {
+    counts: [u32; BUCKETS],
+}
+
+impl LatSnapshot {
+    /// Number of samples in the window.
+    #[must_use]
+    pub fn count(&self) -> u64 {
+        self.counts.iter().map(|&c| u64::from(c)).sum()
+    }
+
+    /// Upper bound (µs) of the bucket holding the `pct`th-percentile sample,
+    /// or 0 for an empty window.
+    #[must_use]
+    pub fn percentile(&self, pct: u32) -> u64 {
+        let n = self.count();
+        if n == 0 {
+            return 0;
+        }
+        // rank of the sample, 1-based, rounded up: p50 of 3 samples is the 2nd
+        let rank = (n * u64::from(pct.min(100))).div_ceil(100).max(1);
+        let mut seen = 0u64;
+        for (i, &c) in self.counts.iter().enumerate() {
+            seen += u64::from(c);
+            if seen >= rank {
+                return if i == 0 { 0 } else { 1u64 << i };
+            }
+        }
+        1u64 << (BUCKETS - 1)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn bucket_edges() {
+        let h = LatHist::new();
+        h.record(0);
+        assert_eq!(h.take().percentile(50), 0);
+        h.record(1);
+        assert_eq!(h.take().percentile(50), 2);
+        h.record(1023);
+        assert_eq!(h.take().percentile(50), 1024);
+        h.record(1024);
+        assert_eq!(h.take().percentile(50), 2048);
+    }
+
+    #[test]
+    fn huge_samples_clamp_to_last_bucket() {
+        let h = LatHist::new();
+        h.record(u64::MAX);
+        assert_eq!(h.take().percentile(99), 1 << (BUCKETS - 1));
+    }
+
+    #[test]
+    fn p50_and_p99_split_a_long_tail() {
+        let h = LatHist::new();
+        for _ in 0..98 {
+            h.record(100); // bucket <= 128us
+        }
+        h.record(5000); // <= 8192us
+        h.record(5000);
+        let s = h.take();
+        assert_eq!(s.count(), 100);
+        assert_eq!(s.percentile(50), 128);
+        assert_eq!(s.percentile(98), 128);
+        assert_eq!(s.percentile(99), 8192);
+    }
+
+    #[test]
+    fn take_resets_the_window() {
+        let h = LatHist::new();
+        h.record(10);
+        assert_eq!(h.take().count(), 1);
+        let s = h.take();
+        assert_eq!(s.count(), 0);
+        assert_eq!(s.percentile(99), 0);
+    }
+}
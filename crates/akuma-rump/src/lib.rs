@@ -8,8 +8,13 @@
 //!
 //! - [`select_second_net_addr`] — the NIC-selection ordering (skip the first
 //!   virtio-net, which smoltcp owns; claim the second).
-//! - [`TapNic`] — the RX two-phase state machine (post a buffer once, poll,
-//!   complete) and its **malformed-length bounds guard**, plus frame TX.
+//! - [`TapNic`] — the RX two-phase state machine (keep buffers posted, poll,
+//!   complete) and its **malformed-length bounds guard**, plus frame TX, one
+//!   frame at a time or batched in the [`BATCH_HDR`] record format.
+//! - [`ring`] — the shared RX/TX slot ring a process can `mmap` from the tap,
+//!   and the sync that moves frames between it and a [`TapNic`].
+//! - [`vnet`] — the virtio-net header mode that carries checksum/TSO offload
+//!   requests with each frame.
 //!
 //! `akuma-net::rump_tap` implements `RawNic` over `VirtIONetRaw` and owns the
 //! global instance; the kernel syscall layer talks to that. Nothing about
@@ -23,6 +28,20 @@ pub mod sysproxy;
 /// Linux⇄NetBSD translation (sysnums, sockaddr, errno, fd map) for the proxy.
 pub mod syscall_translation;
 
+/// The mmap-able `/dev/net/tap0` packet ring: layout and kernel-side sync.
+pub mod ring;
+
+/// Log2 latency histogram behind the sysproxy p50/p99 instrumentation.
+pub mod latency;
+
+/// Shared-memory sysproxy channel: ring layout, doorbells and transport.
+pub mod shmchan;
+
+/// virtio-net header (offload) mode of the tap.
+pub mod vnet;
+
+use vnet::{VnetHdr, VNET_HDR_LEN};
+
 /// Opaque error from a raw NIC backend. The orchestration only branches on
 /// success vs. failure, so the cause is intentionally not modelled.
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -31,19 +50,23 @@ pub struct NicError;
 /// Minimal raw L2 NIC backend the tap orchestration drives.
 ///
 /// Buffer/token semantics mirror virtio-drivers' `VirtIONetRaw`: the driver
-/// posts a receive buffer (`receive_begin` → token), polls for completion, then
-/// `receive_complete`s with the same token to learn the header/packet split.
+/// posts receive buffers (`receive_begin` → token), polls for the next filled
+/// one (its token), then `receive_complete`s with that token to learn the
+/// header/packet split. Buffers complete in the order the device used them.
 /// The real impl (akuma-net) wraps the `unsafe` virtio calls; tests use a mock.
 pub trait RawNic {
     /// Post `buf` to the device to receive into; returns a token identifying it.
     fn receive_begin(&mut self, buf: &mut [u8]) -> Result<u16, NicError>;
-    /// Whether the device has filled a previously posted buffer.
-    fn poll_receive(&mut self) -> bool;
+    /// The token of the next buffer the device has filled, if any.
+    fn poll_receive(&mut self) -> Option<u16>;
     /// Complete a receive started with `token`. Returns `(header_len, packet_len)`
     /// — the frame occupies `buf[header_len .. header_len + packet_len]`.
     fn receive_complete(&mut self, token: u16, buf: &mut [u8]) -> Result<(usize, usize), NicError>;
     /// Transmit a bare L2 (Ethernet) frame; the backend prepends any device header.
     fn send(&mut self, frame: &[u8]) -> Result<(), NicError>;
+    /// Transmit a frame with the offload requests in `hdr` (already checked
+    /// against the negotiated features) as its device header.
+    fn send_vnet(&mut self, hdr: &VnetHdr, frame: &[u8]) -> Result<(), NicError>;
 }
 
 /// Staging buffer size: Ethernet MTU (1500) + headers + virtio-net header slack,
@@ -53,10 +76,34 @@ pub const FRAME_BUF: usize = 2048;
 /// virtio device id for a network device (per the virtio spec).
 pub const VIRTIO_DEVICE_ID_NET: u32 = 1;
 
-/// Device-independent tap state over an arbitrary [`RawNic`]: one staging buffer
-/// and an optional posted-RX token.
+/// Receive buffers [`TapNic`] keeps posted. With one, a frame arriving while
+/// the last is being copied out waits for the next read to re-post, and a
+/// burst is dropped by the device; with several, it queues in the virtqueue
+/// and [`TapNic::read_frames`] drains it in one call. Half of the driver's
+/// 16-entry queue.
+pub const RX_SLOTS: usize = 8;
+
+/// Bytes before each frame in a batch buffer: its length as a little-endian
+/// `u32`. Each record (header + frame) is padded to a multiple of 4, so the
+/// next header is aligned:
+///
+/// ```text
+/// [len u32 LE][frame: len bytes][pad to 4] [len u32 LE][frame] ...
+/// ```
+///
+/// The same format carries batches both ways (`TAPRECVBATCH`/`TAPSENDBATCH`).
+pub const BATCH_HDR: usize = 4;
+
+/// Size of a batch record holding a `len`-byte frame.
+#[must_use]
+pub const fn batch_record_len(len: usize) -> usize {
+    (BATCH_HDR + len + 3) & !3
+}
+
+/// Device-independent tap state over an arbitrary [`RawNic`]: [`RX_SLOTS`]
+/// staging buffers and the token each is posted under.
 ///
-/// The RX staging buffer is **heap-allocated** (`Box<[u8]>`), not an inline array,
+/// The RX staging buffers are **heap-allocated** (`Box<[u8]>`), not inline arrays,
 /// and this is load-bearing for the DMA on a secondary core. A secondary maps the
 /// kernel's `.data`/`.bss` window to PRIVATE, per-core physical pages (R1
 /// replication, `src/smp.rs`), and those pages are NOT guaranteed physically
@@ -73,8 +120,10 @@ pub const VIRTIO_DEVICE_ID_NET: u32 = 1;
 /// itself lives.
 pub struct TapNic<N: RawNic> {
     nic: N,
-    rx_buffer: alloc::boxed::Box<[u8]>,
-    rx_token: Option<u16>,
+    rx_buffers: alloc::vec::Vec<alloc::boxed::Box<[u8]>>,
+    rx_tokens: [Option<u16>; RX_SLOTS],
+    /// In [`vnet`] mode: the offload features the device negotiated.
+    vnet: Option<u64>,
 }
 
 impl<N: RawNic> TapNic<N> {
@@ -82,11 +131,71 @@ impl<N: RawNic> TapNic<N> {
     pub fn new(nic: N) -> Self {
         Self {
             nic,
-            rx_buffer: alloc::vec![0u8; FRAME_BUF].into_boxed_slice(),
-            rx_token: None,
+            rx_buffers: (0..RX_SLOTS).map(|_| alloc::vec![0u8; FRAME_BUF].into_boxed_slice()).collect(),
+            rx_tokens: [None; RX_SLOTS],
+            vnet: None,
+        }
+    }
+
+    /// Wrap a raw NIC backend in [`vnet`] mode; `features` are the offloads
+    /// it negotiated.
+    pub fn with_vnet(nic: N, features: u64) -> Self {
+        Self { vnet: Some(features), ..Self::new(nic) }
+    }
+
+    /// The negotiated offload features if in [`vnet`] mode.
+    pub fn vnet(&self) -> Option<u64> {
+        self.vnet
+    }
+
+    /// Post every staging buffer that is not posted. Stops at the first the
+    /// device refuses (queue full or broken); those are retried next time.
+    fn post_buffers(&mut self) {
+        for (slot, buf) in self.rx_buffers.iter_mut().enumerate() {
+            if self.rx_tokens[slot].is_none() {
+                match self.nic.receive_begin(&mut buf[..]) {
+                    Ok(token) => self.rx_tokens[slot] = Some(token),
+                    Err(_) => return,
+                }
+            }
         }
     }
 
+    /// Complete the next filled buffer, hand its frame to `f` and post the
+    /// buffer again. `None` if no frame is ready, or if the device reported a
+    /// malformed one (dropped).
+    ///
+    /// In [`vnet`] mode the frame handed over is prefixed with the device
+    /// header's first [`VNET_HDR_LEN`] bytes, moved up to abut it in place
+    /// (the device's header may be longer: `num_buffers` follows).
+    fn take_frame<R>(&mut self, f: impl FnOnce(&[u8]) -> R) -> Option<R> {
+        let token = self.nic.poll_receive()?;
+        let slot = self.rx_tokens.iter().position(|&t| t == Some(token))?;
+        self.rx_tokens[slot] = None;
+        let buf = &mut self.rx_buffers[slot];
+        let got = match self.nic.receive_complete(token, &mut buf[..]) {
+            Ok((hdr_len, pkt_len)) if hdr_len.saturating_add(pkt_len) <= buf.len() => match self.vnet {
+                None => Some(f(&buf[hdr_len..hdr_len + pkt_len])),
+                Some(_) if hdr_len >= VNET_HDR_LEN => {
+                    let start = hdr_len - VNET_HDR_LEN;
+                    buf.copy_within(..VNET_HDR_LEN, start);
+                    Some(f(&buf[start..hdr_len + pkt_len]))
+                }
+                Some(_) => None,
+            },
+            _ => None,
+        };
+        self.rx_tokens[slot] = self.nic.receive_begin(&mut buf[..]).ok();
+        got
+    }
+
+    /// Whether the device has filled a buffer, without taking the frame (the
+    /// tap fd's `POLLIN`). Posts the buffers first, as a read would.
+    pub fn has_frame(&mut self) -> bool {
+        self.post_buffers();
+        self.nic.poll_receive().is_some()
+    }
+
     /// Pull one received L2 frame into `out`.
     ///
     /// Returns `Some(n)` if a frame was available — copied into `out`, truncated
@@ -94,38 +203,90 @@ impl<N: RawNic> TapNic<N> {
     /// `EAGAIN`). Guards against a malformed device response reporting a length
     /// past the staging buffer (which would otherwise be an out-of-bounds slice).
     pub fn read_frame(&mut self, out: &mut [u8]) -> Option<usize> {
-        // Phase 1: ensure a receive buffer is posted.
-        if self.rx_token.is_none() {
-            match self.nic.receive_begin(&mut self.rx_buffer[..]) {
-                Ok(token) => self.rx_token = Some(token),
-                Err(_) => return None,
-            }
-        }
+        self.read_frame_with(|frame| {
+            let n = frame.len().min(out.len());
+            out[..n].copy_from_slice(&frame[..n]);
+            n
+        })
+    }
 
-        // Phase 2: has the device filled it?
-        if !self.nic.poll_receive() {
-            return None;
-        }
-        let token = self.rx_token.take()?;
-        match self.nic.receive_complete(token, &mut self.rx_buffer[..]) {
-            Ok((hdr_len, pkt_len)) => {
-                if hdr_len.saturating_add(pkt_len) > self.rx_buffer.len() {
-                    return None;
+    /// Pull one received L2 frame and hand it to `f` in place (the staging
+    /// buffer), for callers that copy it somewhere other than a slice (the
+    /// shared [`ring`]). `None` if no frame is ready.
+    pub fn read_frame_with<R>(&mut self, f: impl FnOnce(&[u8]) -> R) -> Option<R> {
+        // Phase 1: ensure the receive buffers are posted.
+        self.post_buffers();
+
+        // Phase 2: has the device filled one?
+        self.take_frame(f)
+    }
+
+    /// Pull every ready frame, up to `max_frames`, into `out` as batch records
+    /// (see [`BATCH_HDR`]). Returns `(frames, bytes used)`; `(0, 0)` if none
+    /// is ready.
+    ///
+    /// A frame is only taken while `out` has room for the largest one
+    /// (`batch_record_len(FRAME_BUF)`), so none is ever truncated or lost: a
+    /// buffer smaller than that gets no frames.
+    pub fn read_frames(&mut self, out: &mut [u8], max_frames: usize) -> (usize, usize) {
+        self.post_buffers();
+        let (mut frames, mut used) = (0, 0);
+        while frames < max_frames && out.len() - used >= batch_record_len(FRAME_BUF) {
+            let rec = &mut out[used..];
+            let got = self.take_frame(|frame| {
+                rec[..BATCH_HDR].copy_from_slice(&(frame.len() as u32).to_le_bytes());
+                rec[BATCH_HDR..BATCH_HDR + frame.len()].copy_from_slice(frame);
+                batch_record_len(frame.len())
+            });
+            match got {
+                Some(n) => {
+                    frames += 1;
+                    used += n;
                 }
-                let n = pkt_len.min(out.len());
-                out[..n].copy_from_slice(&self.rx_buffer[hdr_len..hdr_len + n]);
-                Some(n)
+                None => break,
             }
-            Err(_) => None,
         }
+        (frames, used)
     }
 
-    /// Transmit one bare L2 frame. Returns the bytes accepted (`frame.len()`).
+    /// Transmit one L2 frame (in [`vnet`] mode, header first). Returns the
+    /// bytes accepted (`frame.len()`). A vnet header the negotiated features
+    /// cannot honour fails the send.
     pub fn write_frame(&mut self, frame: &[u8]) -> Result<usize, NicError> {
-        self.nic.send(frame)?;
+        match self.vnet {
+            None => self.nic.send(frame)?,
+            Some(features) => {
+                let hdr = VnetHdr::from_bytes(frame).ok_or(NicError)?;
+                let body = &frame[VNET_HDR_LEN..];
+                if !vnet::tx_check(&hdr, body.len(), features, FRAME_BUF - VNET_HDR_LEN) {
+                    return Err(NicError);
+                }
+                self.nic.send_vnet(&hdr, body)?;
+            }
+        }
         Ok(frame.len())
     }
 
+    /// Transmit the frames of a batch buffer (see [`BATCH_HDR`]), in order.
+    /// Returns how many were sent: a truncated record ends the batch, and a
+    /// send failure after the first frame is a short count (as a short
+    /// `write`). `Err` only if nothing was sent because the first send failed.
+    pub fn write_frames(&mut self, mut batch: &[u8]) -> Result<usize, NicError> {
+        let mut sent = 0;
+        while batch.len() >= BATCH_HDR {
+            let len = u32::from_le_bytes([batch[0], batch[1], batch[2], batch[3]]) as usize;
+            if BATCH_HDR + len > batch.len() {
+                break;
+            }
+            if let Err(e) = self.write_frame(&batch[BATCH_HDR..BATCH_HDR + len]) {
+                return if sent == 0 { Err(e) } else { Ok(sent) };
+            }
+            sent += 1;
+            batch = &batch[batch_record_len(len).min(batch.len())..];
+        }
+        Ok(sent)
+    }
+
     /// Borrow the backend (e.g. to read its MAC at init).
     pub fn nic(&self) -> &N {
         &self.nic
@@ -199,8 +360,11 @@ mod tests {
         rx_script: Vec<RxStep>,
         rx_idx: usize,
         sent: Vec<Vec<u8>>,
+        sent_vnet: Vec<(VnetHdr, Vec<u8>)>,
         send_should_fail: bool,
         begin_calls: usize,
+        // Tokens of the posted buffers, in the order the device fills them.
+        posted: alloc::collections::VecDeque<u16>,
     }
 
     #[derive(Clone)]
@@ -218,8 +382,10 @@ mod tests {
                 rx_script: Vec::new(),
                 rx_idx: 0,
                 sent: Vec::new(),
+                sent_vnet: Vec::new(),
                 send_should_fail: false,
                 begin_calls: 0,
+                posted: alloc::collections::VecDeque::new(),
             }
         }
     }
@@ -230,13 +396,18 @@ mod tests {
             if self.begin_should_fail {
                 Err(NicError)
             } else {
-                Ok(7) // arbitrary token
+                let token = 7 + self.begin_calls as u16; // arbitrary, distinct
+                self.posted.push_back(token);
+                Ok(token)
             }
         }
-        fn poll_receive(&mut self) -> bool {
-            self.rx_script.get(self.rx_idx).map(|s| s.poll_ready).unwrap_or(false)
+        fn poll_receive(&mut self) -> Option<u16> {
+            let ready = self.rx_script.get(self.rx_idx).map(|s| s.poll_ready).unwrap_or(false);
+            if ready { self.posted.front().copied() } else { None }
         }
-        fn receive_complete(&mut self, _token: u16, buf: &mut [u8]) -> Result<(usize, usize), NicError> {
+        fn receive_complete(&mut self, token: u16, buf: &mut [u8]) -> Result<(usize, usize), NicError> {
+            // Completing anything but the next filled buffer is a driver error.
+            assert_eq!(self.posted.pop_front(), Some(token));
             let step = self.rx_script[self.rx_idx].clone();
             self.rx_idx += 1;
             match step.complete {
@@ -245,6 +416,10 @@ mod tests {
                     // exceed the buffer — the guard under test must reject it
                     // before any copy, so we must not write OOB here either).
                     let buf_len = buf.len();
+                    // The device header: bytes 0, 1, 2, ... to tell them apart.
+                    for (i, b) in buf[..hdr.min(buf_len)].iter_mut().enumerate() {
+                        *b = i as u8;
+                    }
                     let start = hdr.min(buf_len);
                     let end = hdr.saturating_add(pkt).min(buf_len);
                     for b in &mut buf[start..end] {
@@ -262,6 +437,13 @@ mod tests {
             self.sent.push(frame.to_vec());
             Ok(())
         }
+        fn send_vnet(&mut self, hdr: &VnetHdr, frame: &[u8]) -> Result<(), NicError> {
+            if self.send_should_fail {
+                return Err(NicError);
+            }
+            self.sent_vnet.push((*hdr, frame.to_vec()));
+            Ok(())
+        }
     }
 
     #[test]
@@ -271,8 +453,8 @@ mod tests {
         let mut tap = TapNic::new(nic);
         let mut out = [0u8; 64];
         assert_eq!(tap.read_frame(&mut out), None);
-        // Buffer was posted exactly once even though no frame arrived.
-        assert_eq!(tap.nic().begin_calls, 1);
+        // Each buffer was posted exactly once even though no frame arrived.
+        assert_eq!(tap.nic().begin_calls, RX_SLOTS);
     }
 
     #[test]
@@ -286,8 +468,22 @@ mod tests {
         let mut out = [0u8; 64];
         assert_eq!(tap.read_frame(&mut out), None);
         assert_eq!(tap.read_frame(&mut out), None);
-        // The token persists across empty polls — no re-post.
-        assert_eq!(tap.nic().begin_calls, 1);
+        // The tokens persist across empty polls — no re-post.
+        assert_eq!(tap.nic().begin_calls, RX_SLOTS);
+    }
+
+    #[test]
+    fn has_frame_peeks_without_consuming() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![RxStep { poll_ready: true, complete: Some((10, 20, 0xAB)) }];
+        let mut tap = TapNic::new(nic);
+        assert!(tap.has_frame());
+        assert!(tap.has_frame());
+        let mut out = [0u8; 64];
+        assert_eq!(tap.read_frame(&mut out), Some(20));
+        assert!(!tap.has_frame());
+        // Posting happened once, on the first peek; the read re-posted its slot.
+        assert_eq!(tap.nic().begin_calls, RX_SLOTS + 1);
     }
 
     #[test]
@@ -340,6 +536,136 @@ mod tests {
         assert_eq!(tap.read_frame(&mut out), None);
     }
 
+    #[test]
+    fn read_frame_reposts_the_buffer_it_consumed() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![
+            RxStep { poll_ready: true, complete: Some((10, 20, 0xAB)) },
+            RxStep { poll_ready: true, complete: Some((10, 30, 0xBC)) },
+        ];
+        let mut tap = TapNic::new(nic);
+        let mut out = [0u8; 64];
+        assert_eq!(tap.read_frame(&mut out), Some(20));
+        assert_eq!(tap.nic().begin_calls, RX_SLOTS + 1);
+        assert_eq!(tap.nic().posted.len(), RX_SLOTS);
+        assert_eq!(tap.read_frame(&mut out), Some(30));
+        assert!(out[..30].iter().all(|&b| b == 0xBC));
+    }
+
+    // ── Batched RX/TX ───────────────────────────────────────────────────────
+
+    /// Split a batch buffer back into frames.
+    fn records(mut batch: &[u8]) -> Vec<Vec<u8>> {
+        let mut frames = Vec::new();
+        while batch.len() >= BATCH_HDR {
+            let len = u32::from_le_bytes([batch[0], batch[1], batch[2], batch[3]]) as usize;
+            frames.push(batch[BATCH_HDR..BATCH_HDR + len].to_vec());
+            batch = &batch[batch_record_len(len).min(batch.len())..];
+        }
+        frames
+    }
+
+    #[test]
+    fn batch_records_are_padded_to_4() {
+        assert_eq!(batch_record_len(0), 4);
+        assert_eq!(batch_record_len(1), 8);
+        assert_eq!(batch_record_len(60), 64);
+        assert_eq!(batch_record_len(61), 68);
+    }
+
+    #[test]
+    fn read_frames_drains_every_ready_frame() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![
+            RxStep { poll_ready: true, complete: Some((10, 60, 1)) },
+            RxStep { poll_ready: true, complete: Some((10, 61, 2)) },
+            RxStep { poll_ready: true, complete: Some((10, 1514, 3)) },
+            RxStep { poll_ready: false, complete: None },
+        ];
+        let mut tap = TapNic::new(nic);
+        let mut out = vec![0u8; 16 * 1024];
+        let (frames, used) = tap.read_frames(&mut out, 32);
+        assert_eq!(frames, 3);
+        assert_eq!(used, batch_record_len(60) + batch_record_len(61) + batch_record_len(1514));
+        let got = records(&out[..used]);
+        assert_eq!(got, vec![vec![1u8; 60], vec![2u8; 61], vec![3u8; 1514]]);
+        // Every consumed buffer went back to the device.
+        assert_eq!(tap.nic().posted.len(), RX_SLOTS);
+    }
+
+    #[test]
+    fn read_frames_stops_at_max_frames() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![
+            RxStep { poll_ready: true, complete: Some((10, 60, 1)) },
+            RxStep { poll_ready: true, complete: Some((10, 60, 2)) },
+        ];
+        let mut tap = TapNic::new(nic);
+        let mut out = vec![0u8; 16 * 1024];
+        assert_eq!(tap.read_frames(&mut out, 1), (1, 64));
+        assert_eq!(records(&out[..64]), vec![vec![1u8; 60]]);
+        // The second is still queued for the next call.
+        assert_eq!(tap.read_frames(&mut out, 1), (1, 64));
+        assert_eq!(records(&out[..64]), vec![vec![2u8; 60]]);
+    }
+
+    #[test]
+    fn read_frames_takes_nothing_without_room_for_a_full_frame() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![RxStep { poll_ready: true, complete: Some((10, 60, 1)) }];
+        let mut tap = TapNic::new(nic);
+        let mut small = vec![0u8; batch_record_len(FRAME_BUF) - 1];
+        assert_eq!(tap.read_frames(&mut small, 32), (0, 0));
+        // Not lost: a single-frame read still gets it.
+        let mut out = [0u8; 64];
+        assert_eq!(tap.read_frame(&mut out), Some(60));
+    }
+
+    #[test]
+    fn read_frames_none_ready() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![RxStep { poll_ready: false, complete: None }];
+        let mut tap = TapNic::new(nic);
+        let mut out = vec![0u8; 16 * 1024];
+        assert_eq!(tap.read_frames(&mut out, 32), (0, 0));
+    }
+
+    #[test]
+    fn write_frames_sends_each_record_in_order() {
+        let mut batch = Vec::new();
+        for (len, fill) in [(60usize, 1u8), (61, 2), (1514, 3)] {
+            batch.extend_from_slice(&(len as u32).to_le_bytes());
+            batch.extend(core::iter::repeat_n(fill, len));
+            batch.resize(batch.len().next_multiple_of(4), 0);
+        }
+        let mut tap = TapNic::new(MockNic::new());
+        assert_eq!(tap.write_frames(&batch), Ok(3));
+        assert_eq!(tap.nic().sent, vec![vec![1u8; 60], vec![2u8; 61], vec![3u8; 1514]]);
+    }
+
+    #[test]
+    fn write_frames_stops_at_truncated_record() {
+        let mut batch = Vec::new();
+        batch.extend_from_slice(&4u32.to_le_bytes());
+        batch.extend_from_slice(&[9, 9, 9, 9]);
+        // Claims 100 bytes, carries 3.
+        batch.extend_from_slice(&100u32.to_le_bytes());
+        batch.extend_from_slice(&[1, 2, 3]);
+        let mut tap = TapNic::new(MockNic::new());
+        assert_eq!(tap.write_frames(&batch), Ok(1));
+        assert_eq!(tap.nic().sent, vec![vec![9u8; 4]]);
+    }
+
+    #[test]
+    fn write_frames_propagates_first_error() {
+        let mut nic = MockNic::new();
+        nic.send_should_fail = true;
+        let mut tap = TapNic::new(nic);
+        let mut batch = 3u32.to_le_bytes().to_vec();
+        batch.extend_from_slice(&[1, 2, 3, 0]);
+        assert_eq!(tap.write_frames(&batch), Err(NicError));
+    }
+
     #[test]
     fn write_frame_sends_and_returns_len() {
         let mut tap = TapNic::new(MockNic::new());
@@ -356,4 +682,83 @@ mod tests {
         let mut tap = TapNic::new(nic);
         assert_eq!(tap.write_frame(&[1, 2, 3]), Err(NicError));
     }
+
+    // ── vnet (offload header) mode ─────────────────────────────────────────
+
+    use vnet::{F_NEEDS_CSUM, FEAT_CSUM, FEAT_HOST_TSO4, GSO_TCPV4, TSO_FRAME_MAX};
+
+    #[test]
+    fn vnet_rx_prefixes_the_device_header() {
+        // Legacy 10-byte device header: already in place.
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![RxStep { poll_ready: true, complete: Some((10, 20, 0xAB)) }];
+        let mut tap = TapNic::with_vnet(nic, 0);
+        let mut out = [0u8; 64];
+        assert_eq!(tap.read_frame(&mut out), Some(30));
+        assert_eq!(out[..10], [0, 1, 2, 3, 4, 5, 6, 7, 8, 9]);
+        assert!(out[10..30].iter().all(|&b| b == 0xAB));
+    }
+
+    #[test]
+    fn vnet_rx_drops_num_buffers_from_a_12_byte_header() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![RxStep { poll_ready: true, complete: Some((12, 20, 0xAB)) }];
+        let mut tap = TapNic::with_vnet(nic, 0);
+        let mut out = vec![0u8; 16 * 1024];
+        assert_eq!(tap.read_frames(&mut out, 4), (1, batch_record_len(30)));
+        let got = records(&out[..batch_record_len(30)]);
+        assert_eq!(got[0][..10], [0, 1, 2, 3, 4, 5, 6, 7, 8, 9]);
+        assert!(got[0][10..].iter().all(|&b| b == 0xAB));
+    }
+
+    #[test]
+    fn vnet_rx_drops_a_frame_with_a_short_device_header() {
+        let mut nic = MockNic::new();
+        nic.rx_script = vec![RxStep { poll_ready: true, complete: Some((4, 20, 0xAB)) }];
+        let mut tap = TapNic::with_vnet(nic, 0);
+        let mut out = [0u8; 64];
+        assert_eq!(tap.read_frame(&mut out), None);
+    }
+
+    #[test]
+    fn vnet_tx_hands_the_header_to_the_nic() {
+        let features = FEAT_CSUM | FEAT_HOST_TSO4;
+        let mut tap = TapNic::with_vnet(MockNic::new(), features);
+        let hdr = VnetHdr { flags: F_NEEDS_CSUM, gso_type: GSO_TCPV4, hdr_len: 54, gso_size: 1448, csum_start: 34, csum_offset: 16 };
+        let mut frame = hdr.to_bytes().to_vec();
+        frame.extend(core::iter::repeat_n(5u8, 60_000));
+        assert_eq!(tap.write_frame(&frame), Ok(frame.len()));
+        assert_eq!(tap.nic().sent_vnet, vec![(hdr, vec![5u8; 60_000])]);
+        assert!(tap.nic().sent.is_empty());
+    }
+
+    #[test]
+    fn vnet_tx_rejects_what_was_not_negotiated() {
+        let mut tap = TapNic::with_vnet(MockNic::new(), 0);
+        let hdr = VnetHdr { flags: F_NEEDS_CSUM, csum_start: 34, csum_offset: 16, ..VnetHdr::default() };
+        let mut frame = hdr.to_bytes().to_vec();
+        frame.extend_from_slice(&[0u8; 60]);
+        assert_eq!(tap.write_frame(&frame), Err(NicError));
+        // Shorter than a header, and a plain frame past the staging size.
+        assert_eq!(tap.write_frame(&[0u8; 9]), Err(NicError));
+        assert_eq!(tap.write_frame(&vec![0u8; VNET_HDR_LEN + FRAME_BUF]), Err(NicError));
+        assert_eq!(tap.write_frame(&vec![0u8; TSO_FRAME_MAX]), Err(NicError));
+        assert!(tap.nic().sent_vnet.is_empty());
+    }
+
+    #[test]
+    fn vnet_batch_records_carry_headers() {
+        let mut tap = TapNic::with_vnet(MockNic::new(), 0);
+        let mut batch = Vec::new();
+        for fill in [1u8, 2] {
+            let mut rec = VnetHdr::default().to_bytes().to_vec();
+            rec.extend(core::iter::repeat_n(fill, 60));
+            batch.extend_from_slice(&(rec.len() as u32).to_le_bytes());
+            batch.extend_from_slice(&rec);
+            batch.resize(batch.len().next_multiple_of(4), 0);
+        }
+        assert_eq!(tap.write_frames(&batch), Ok(2));
+        let frames: Vec<_> = tap.nic().sent_vnet.iter().map(|(_, f)| f.clone()).collect();
+        assert_eq!(frames, vec![vec![1u8; 60], vec![2u8; 60]]);
+    }
 }
@@ -0,0 +1,432 @@
+//! Shared packet ring for `/dev/net/tap0`, the host-testable core.
+//!
+//! `mmap(tap_fd, RING_BYTES, PROT_READ|PROT_WRITE, MAP_SHARED)` gives the
+//! process a ring of frame slots in its own memory, in the spirit of netmap:
+//! one `TAPRINGSYNC` ioctl then sends every frame the process queued and
+//! fills every free RX slot straight from the NIC's receive buffers, so the
+//! rump stack moves a whole burst per syscall and each RX frame is copied
+//! once by the kernel (into its slot) instead of twice (into a temp, then
+//! out to the `read` buffer).
+//!
+//! Layout (all fields `u32`, little-endian; the index fields are free-running
+//! and each on its own cache line, written by one side only):
+//!
+//! ```text
+//! 0      magic, version, slots, slot_size, rx_slots_off, tx_slots_off
+//! 64     rx_head   user: next RX slot to consume
+//! 128    rx_tail   kernel: next RX slot to fill
+//! 192    tx_head   kernel: next TX slot to send
+//! 256    tx_tail   user: next TX slot to fill
+//! 1024   rx_len[RING_SLOTS]
+//! 1536   tx_len[RING_SLOTS]
+//! 4096   RX slots, RING_SLOTS x RING_SLOT_SIZE
+//!        TX slots, RING_SLOTS x RING_SLOT_SIZE
+//! ```
+//!
+//! Slot `i` of a ring is `index % RING_SLOTS`. RX slots `[rx_head, rx_tail)`
+//! hold frames for the process; TX slots `[tx_head, tx_tail)` hold frames for
+//! the NIC. A producer writes the slot and its length before publishing the
+//! new tail (release); a consumer reads the tail (acquire) before the slots.
+//!
+//! The kernel keeps its own copy of the indices it owns ([`TapRing`]) and
+//! only reads the process's, checking them, so a corrupted ring can make a
+//! sync fail but never index outside the mapping. The kernel supplies a
+//! [`RingMem`] over the mapping's user pages.
+
+extern crate alloc;
+use alloc::boxed::Box;
+use core::sync::atomic::{fence, Ordering};
+
+use crate::{RawNic, TapNic, FRAME_BUF};
+
+/// Slots per direction.
+pub const RING_SLOTS: u32 = 64;
+/// Bytes per slot: one staging buffer, so any received frame fits.
+pub const RING_SLOT_SIZE: usize = FRAME_BUF;
+/// Header page, then the RX and TX slot arrays.
+pub const RING_BYTES: usize = 4096 + 2 * RING_SLOTS as usize * RING_SLOT_SIZE;
+/// `"TRNG"`
+pub const RING_MAGIC: u32 = 0x474e_5254;
+pub const RING_VERSION: u32 = 1;
+
+pub const OFF_MAGIC: usize = 0;
+pub const OFF_VERSION: usize = 4;
+pub const OFF_SLOTS: usize = 8;
+pub const OFF_SLOT_SIZE: usize = 12;
+pub const OFF_RX_SLOTS_OFF: usize = 16;
+pub const OFF_TX_SLOTS_OFF: usize = 20;
+pub const OFF_RX_HEAD: usize = 64;
+pub const OFF_RX_TAIL: usize = 128;
+pub const OFF_TX_HEAD: usize = 192;
+pub const OFF_TX_TAIL: usize = 256;
+pub const OFF_RX_LEN: usize = 1024;
+pub const OFF_TX_LEN: usize = 1536;
+pub const OFF_RX_SLOTS: usize = 4096;
+pub const OFF_TX_SLOTS: usize = OFF_RX_SLOTS + RING_SLOTS as usize * RING_SLOT_SIZE;
+
+/// Access to the ring's memory (the process's pages). `false` = the access
+/// faulted (the mapping is gone).
+pub trait RingMem {
+    fn read(&mut self, off: usize, out: &mut [u8]) -> bool;
+    fn write(&mut self, off: usize, data: &[u8]) -> bool;
+}
+
+/// Why a sync failed.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum RingError {
+    /// The ring's memory could not be accessed (`EFAULT`).
+    Fault,
+    /// The process's indices or lengths are impossible (`EINVAL`).
+    Corrupt,
+}
+
+/// What a sync did.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Synced {
+    /// RX frames now waiting for the process (old and new).
+    pub rx_ready: u32,
+    /// RX frames the kernel added in this sync.
+    pub received: u32,
+    /// TX frames sent in this sync.
+    pub sent: u32,
+}
+
+fn load<M: RingMem>(mem: &mut M, off: usize) -> Result<u32, RingError> {
+    let mut b = [0u8; 4];
+    if mem.read(off, &mut b) { Ok(u32::from_le_bytes(b)) } else { Err(RingError::Fault) }
+}
+
+fn store<M: RingMem>(mem: &mut M, off: usize, v: u32) -> Result<(), RingError> {
+    if mem.write(off, &v.to_le_bytes()) { Ok(()) } else { Err(RingError::Fault) }
+}
+
+fn slot_off(base: usize, index: u32) -> usize {
+    base + (index % RING_SLOTS) as usize * RING_SLOT_SIZE
+}
+
+fn len_off(base: usize, index: u32) -> usize {
+    base + (index % RING_SLOTS) as usize * 4
+}
+
+/// The kernel's side of one mapped ring: the indices it owns and a staging
+/// buffer for TX (the NIC sends from a kernel slice).
+pub struct TapRing {
+    rx_tail: u32,
+    tx_head: u32,
+    tx_buf: Box<[u8]>,
+}
+
+impl TapRing {
+    /// Write the header of a freshly mapped (zeroed) ring.
+    pub fn init<M: RingMem>(mem: &mut M) -> Result<Self, RingError> {
+        let header = [
+            (OFF_MAGIC, RING_MAGIC),
+            (OFF_VERSION, RING_VERSION),
+            (OFF_SLOTS, RING_SLOTS),
+            (OFF_SLOT_SIZE, RING_SLOT_SIZE as u32),
+            (OFF_RX_SLOTS_OFF, OFF_RX_SLOTS as u32),
+            (OFF_TX_SLOTS_OFF, OFF_TX_SLOTS as u32),
+            (OFF_RX_HEAD, 0),
+            (OFF_RX_TAIL, 0),
+            (OFF_TX_HEAD, 0),
+            (OFF_TX_TAIL, 0),
+        ];
+        for (off, v) in header {
+            store(mem, off, v)?;
+        }
+        Ok(Self { rx_tail: 0, tx_head: 0, tx_buf: alloc::vec![0u8; RING_SLOT_SIZE].into_boxed_slice() })
+    }
+
+    /// Send the queued TX frames, then fill free RX slots from `tap`.
+    ///
+    /// A TX frame the NIC refuses stays queued for the next sync. RX takes
+    /// frames while slots are free and the NIC has them.
+    pub fn sync<N: RawNic, M: RingMem>(&mut self, tap: &mut TapNic<N>, mem: &mut M) -> Result<Synced, RingError> {
+        let tx_tail = load(mem, OFF_TX_TAIL)?;
+        // The tail before the slots it publishes
+        fence(Ordering::Acquire);
+        if tx_tail.wrapping_sub(self.tx_head) > RING_SLOTS {
+            return Err(RingError::Corrupt);
+        }
+        let mut sent = 0;
+        while self.tx_head != tx_tail {
+            let len = load(mem, len_off(OFF_TX_LEN, self.tx_head))? as usize;
+            if len > RING_SLOT_SIZE {
+                return Err(RingError::Corrupt);
+            }
+            if !mem.read(slot_off(OFF_TX_SLOTS, self.tx_head), &mut self.tx_buf[..len]) {
+                return Err(RingError::Fault);
+            }
+            if tap.write_frame(&self.tx_buf[..len]).is_err() {
+                break;
+            }
+            self.tx_head = self.tx_head.wrapping_add(1);
+            sent += 1;
+        }
+        if sent > 0 {
+            store(mem, OFF_TX_HEAD, self.tx_head)?;
+        }
+
+        let rx_head = load(mem, OFF_RX_HEAD)?;
+        let queued = self.rx_tail.wrapping_sub(rx_head);
+        if queued > RING_SLOTS {
+            return Err(RingError::Corrupt);
+        }
+        let mut received = 0;
+        while queued + received < RING_SLOTS {
+            let index = self.rx_tail;
+            let got = tap.read_frame_with(|frame| {
+                let len = (frame.len() as u32).to_le_bytes();
+                mem.write(slot_off(OFF_RX_SLOTS, index), frame) && mem.write(len_off(OFF_RX_LEN, index), &len)
+            });
+            match got {
+                Some(true) => {
+                    self.rx_tail = self.rx_tail.wrapping_add(1);
+                    received += 1;
+                }
+                Some(false) => return Err(RingError::Fault),
+                None => break,
+            }
+        }
+        if received > 0 {
+            // Slots and lengths before the tail that publishes them
+            fence(Ordering::Release);
+            store(mem, OFF_RX_TAIL, self.rx_tail)?;
+        }
+        Ok(Synced { rx_ready: queued + received, received, sent })
+    }
+
+    /// Whether RX slots the kernel filled are still waiting for the process
+    /// (the ring's share of the tap fd's `POLLIN`). `false` if the ring
+    /// cannot be read.
+    pub fn rx_pending<M: RingMem>(&self, mem: &mut M) -> bool {
+        load(mem, OFF_RX_HEAD).is_ok_and(|head| head != self.rx_tail)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::NicError;
+    use alloc::vec;
+    use alloc::vec::Vec;
+
+    struct VecMem(Vec<u8>);
+
+    impl RingMem for VecMem {
+        fn read(&mut self, off: usize, out: &mut [u8]) -> bool {
+            match self.0.get(off..off + out.len()) {
+                Some(src) => {
+                    out.copy_from_slice(src);
+                    true
+                }
+                None => false,
+            }
+        }
+        fn write(&mut self, off: usize, data: &[u8]) -> bool {
+            match self.0.get_mut(off..off + data.len()) {
+                Some(dst) => {
+                    dst.copy_from_slice(data);
+                    true
+                }
+                None => false,
+            }
+        }
+    }
+
+    impl VecMem {
+        fn u32(&self, off: usize) -> u32 {
+            u32::from_le_bytes(self.0[off..off + 4].try_into().unwrap())
+        }
+        fn set_u32(&mut self, off: usize, v: u32) {
+            self.0[off..off + 4].copy_from_slice(&v.to_le_bytes());
+        }
+        /// What the process does to queue a TX frame
+        fn queue_tx(&mut self, frame: &[u8]) {
+            let tail = self.u32(OFF_TX_TAIL);
+            let off = slot_off(OFF_TX_SLOTS, tail);
+            self.0[off..off + frame.len()].copy_from_slice(frame);
+            self.set_u32(len_off(OFF_TX_LEN, tail), frame.len() as u32);
+            self.set_u32(OFF_TX_TAIL, tail.wrapping_add(1));
+        }
+        /// What the process does to consume every RX frame
+        fn take_rx(&mut self) -> Vec<Vec<u8>> {
+            let (mut head, tail) = (self.u32(OFF_RX_HEAD), self.u32(OFF_RX_TAIL));
+            let mut frames = Vec::new();
+            while head != tail {
+                let len = self.u32(len_off(OFF_RX_LEN, head)) as usize;
+                let off = slot_off(OFF_RX_SLOTS, head);
+                frames.push(self.0[off..off + len].to_vec());
+                head = head.wrapping_add(1);
+            }
+            self.set_u32(OFF_RX_HEAD, head);
+            frames
+        }
+    }
+
+    /// A NIC with a queue of frames to receive, completing in order.
+    struct QueueNic {
+        rx: Vec<Vec<u8>>,
+        posted: alloc::collections::VecDeque<u16>,
+        next_token: u16,
+        sent: Vec<Vec<u8>>,
+        send_fails: bool,
+    }
+
+    impl QueueNic {
+        fn new(rx: Vec<Vec<u8>>) -> Self {
+            Self { rx, posted: Default::default(), next_token: 0, sent: Vec::new(), send_fails: false }
+        }
+    }
+
+    impl RawNic for QueueNic {
+        fn receive_begin(&mut self, _buf: &mut [u8]) -> Result<u16, NicError> {
+            self.next_token += 1;
+            self.posted.push_back(self.next_token);
+            Ok(self.next_token)
+        }
+        fn poll_receive(&mut self) -> Option<u16> {
+            if self.rx.is_empty() { None } else { self.posted.front().copied() }
+        }
+        fn receive_complete(&mut self, token: u16, buf: &mut [u8]) -> Result<(usize, usize), NicError> {
+            assert_eq!(self.posted.pop_front(), Some(token));
+            let frame = self.rx.remove(0);
+            buf[12..12 + frame.len()].copy_from_slice(&frame);
+            Ok((12, frame.len()))
+        }
+        fn send(&mut self, frame: &[u8]) -> Result<(), NicError> {
+            if self.send_fails {
+                return Err(NicError);
+            }
+            self.sent.push(frame.to_vec());
+            Ok(())
+        }
+        fn send_vnet(&mut self, hdr: &crate::vnet::VnetHdr, frame: &[u8]) -> Result<(), NicError> {
+            let mut with_hdr = hdr.to_bytes().to_vec();
+            with_hdr.extend_from_slice(frame);
+            self.send(&with_hdr)
+        }
+    }
+
+    fn ring() -> (TapRing, VecMem) {
+        let mut mem = VecMem(vec![0u8; RING_BYTES]);
+        let ring = TapRing::init(&mut mem).unwrap();
+        (ring, mem)
+    }
+
+    #[test]
+    fn init_writes_the_header() {
+        let (_, mem) = ring();
+        assert_eq!(mem.u32(OFF_MAGIC), RING_MAGIC);
+        assert_eq!(mem.u32(OFF_SLOTS), RING_SLOTS);
+        assert_eq!(mem.u32(OFF_SLOT_SIZE) as usize, RING_SLOT_SIZE);
+        assert_eq!(mem.u32(OFF_TX_SLOTS_OFF) as usize, OFF_TX_SLOTS);
+        assert_eq!(OFF_TX_SLOTS + RING_SLOTS as usize * RING_SLOT_SIZE, RING_BYTES);
+    }
+
+    #[test]
+    fn sync_fills_rx_slots_in_order() {
+        let (mut ring, mut mem) = ring();
+        let mut tap = TapNic::new(QueueNic::new(vec![vec![1; 60], vec![2; 1514], vec![3; 61]]));
+        let s = ring.sync(&mut tap, &mut mem).unwrap();
+        assert_eq!(s, Synced { rx_ready: 3, received: 3, sent: 0 });
+        assert_eq!(mem.take_rx(), vec![vec![1u8; 60], vec![2u8; 1514], vec![3u8; 61]]);
+    }
+
+    #[test]
+    fn rx_pending_until_the_process_consumes() {
+        let (mut ring, mut mem) = ring();
+        let mut tap = TapNic::new(QueueNic::new(vec![vec![1; 60]]));
+        assert!(!ring.rx_pending(&mut mem));
+        ring.sync(&mut tap, &mut mem).unwrap();
+        assert!(ring.rx_pending(&mut mem));
+        mem.take_rx();
+        assert!(!ring.rx_pending(&mut mem));
+        assert!(!ring.rx_pending(&mut VecMem(Vec::new())));
+    }
+
+    #[test]
+    fn sync_stops_when_rx_ring_is_full_and_resumes_after_consume() {
+        let (mut ring, mut mem) = ring();
+        let frames: Vec<Vec<u8>> = (0..RING_SLOTS + 5).map(|i| vec![i as u8; 64]).collect();
+        let mut tap = TapNic::new(QueueNic::new(frames.clone()));
+        assert_eq!(ring.sync(&mut tap, &mut mem).unwrap().rx_ready, RING_SLOTS);
+        // Full: nothing more until the process consumes.
+        assert_eq!(ring.sync(&mut tap, &mut mem).unwrap().received, 0);
+        assert_eq!(mem.take_rx(), frames[..RING_SLOTS as usize].to_vec());
+        let s = ring.sync(&mut tap, &mut mem).unwrap();
+        assert_eq!((s.received, s.rx_ready), (5, 5));
+        // Indices wrapped around the slot array.
+        assert_eq!(mem.take_rx(), frames[RING_SLOTS as usize..].to_vec());
+    }
+
+    #[test]
+    fn sync_sends_queued_tx_frames() {
+        let (mut ring, mut mem) = ring();
+        let mut tap = TapNic::new(QueueNic::new(Vec::new()));
+        mem.queue_tx(&[7; 60]);
+        mem.queue_tx(&[8; 1514]);
+        let s = ring.sync(&mut tap, &mut mem).unwrap();
+        assert_eq!(s.sent, 2);
+        assert_eq!(mem.u32(OFF_TX_HEAD), 2);
+        assert_eq!(tap.nic().sent, vec![vec![7u8; 60], vec![8u8; 1514]]);
+    }
+
+    #[test]
+    fn vnet_mode_carries_the_header_both_ways() {
+        use crate::vnet::{VnetHdr, F_NEEDS_CSUM, FEAT_CSUM, VNET_HDR_LEN};
+        let (mut ring, mut mem) = ring();
+        let mut tap = TapNic::with_vnet(QueueNic::new(vec![vec![1; 60]]), FEAT_CSUM);
+        let hdr = VnetHdr { flags: F_NEEDS_CSUM, csum_start: 34, csum_offset: 16, ..VnetHdr::default() };
+        let mut tx = hdr.to_bytes().to_vec();
+        tx.extend_from_slice(&[7; 60]);
+        mem.queue_tx(&tx);
+        let s = ring.sync(&mut tap, &mut mem).unwrap();
+        assert_eq!((s.received, s.sent), (1, 1));
+        assert_eq!(tap.nic().sent, vec![tx]);
+        let mut rx = vec![0u8; VNET_HDR_LEN];
+        rx.extend_from_slice(&[1; 60]);
+        assert_eq!(mem.take_rx(), vec![rx]);
+    }
+
+    #[test]
+    fn refused_tx_frame_stays_queued() {
+        let (mut ring, mut mem) = ring();
+        let mut nic = QueueNic::new(Vec::new());
+        nic.send_fails = true;
+        let mut tap = TapNic::new(nic);
+        mem.queue_tx(&[7; 60]);
+        assert_eq!(ring.sync(&mut tap, &mut mem).unwrap().sent, 0);
+        assert_eq!(mem.u32(OFF_TX_HEAD), 0);
+    }
+
+    #[test]
+    fn impossible_indices_are_rejected() {
+        let (mut ring, mut mem) = ring();
+        let mut tap = TapNic::new(QueueNic::new(Vec::new()));
+        mem.set_u32(OFF_TX_TAIL, RING_SLOTS + 1);
+        assert_eq!(ring.sync(&mut tap, &mut mem), Err(RingError::Corrupt));
+        mem.set_u32(OFF_TX_TAIL, 0);
+        // rx_head ahead of the kernel's rx_tail
+        mem.set_u32(OFF_RX_HEAD, 3);
+        assert_eq!(ring.sync(&mut tap, &mut mem), Err(RingError::Corrupt));
+    }
+
+    #[test]
+    fn oversized_tx_length_is_rejected() {
+        let (mut ring, mut mem) = ring();
+        let mut tap = TapNic::new(QueueNic::new(Vec::new()));
+        mem.queue_tx(&[1; 4]);
+        mem.set_u32(len_off(OFF_TX_LEN, 0), RING_SLOT_SIZE as u32 + 1);
+        assert_eq!(ring.sync(&mut tap, &mut mem), Err(RingError::Corrupt));
+        assert!(tap.nic().sent.is_empty());
+    }
+
+    #[test]
+    fn unmapped_ring_faults() {
+        let mut tap = TapNic::new(QueueNic::new(vec![vec![1; 60]]));
+        let (mut ring, _) = ring();
+        let mut gone = VecMem(Vec::new());
+        assert_eq!(ring.sync(&mut tap, &mut gone), Err(RingError::Fault));
+    }
+}
@@ -0,0 +1,444 @@
+//! Shared-memory sysproxy channel, the host-testable core.
+//!
+//! The kernel allocates one region per `stack=rump` box and `rump_server`
+//! maps it with `mmap(fd 3, SHM_BYTES, PROT_READ|PROT_WRITE, MAP_SHARED)`.
+//! Frames then travel through two byte rings in that region instead of the
+//! kernel pipe pair: each byte is copied once, by its producer, and the
+//! consumer reads it in place. A bulk transfer up to
+//! [`MAX_TRANSFER`](crate::sysproxy::MAX_TRANSFER) streams through its ring
+//! rather than through a pipe buffer.
+//!
+//! The pipes stay as doorbells (the eventfd of this channel): a producer
+//! writes one byte to the peer's pipe only when the peer said it is going to
+//! sleep, so a busy channel costs no pipe traffic at all.
+//!
+//! Layout (all fields `u32`, little-endian; the index fields are free-running
+//! byte counts, each on its own cache line, written by one side only):
+//!
+//! ```text
+//! 0      magic, version, ring_bytes, req_off, resp_off
+//! 64     req_head    server: request bytes consumed
+//! 128    req_tail    kernel: request bytes produced
+//! 192    resp_head   kernel: response bytes consumed
+//! 256    resp_tail   server: response bytes produced
+//! 320    req_bell    server: 0 = "about to sleep, ring me"; kernel sets 1 when it rings
+//! 384    resp_bell   kernel: 0 = "about to sleep, ring me"; server sets 1 when it rings
+//! 4096   request ring, SHM_RING_BYTES
+//!        response ring, SHM_RING_BYTES
+//! ```
+//!
+//! Sleeping side: clear its bell, full fence, re-check the ring, then block
+//! on its doorbell pipe. Producing side: publish the tail, full fence, and if
+//! the peer's bell is 0, set it and write one byte. One of the two always sees
+//! the other, so a wakeup is never lost. Both ends must follow this; the
+//! server's copy lives in `sp_serve_fd.c`.
+//!
+//! The kernel keeps its own copy of the indices it owns ([`ShmEnd`]) and only
+//! reads the server's, checking them, so a corrupted ring fails the channel
+//! but never indexes outside the region.
+
+use core::sync::atomic::{fence, Ordering};
+
+use crate::ring::{RingError, RingMem};
+use crate::sysproxy::{PipeIo, Transport, TransportErr};
+
+/// Bytes per direction (a power of two).
+pub const SHM_RING_BYTES: usize = 128 * 1024;
+/// Header page, then the request and response rings.
+pub const SHM_BYTES: usize = 4096 + 2 * SHM_RING_BYTES;
+/// `"SPCH"`
+pub const SHM_MAGIC: u32 = 0x4843_5053;
+pub const SHM_VERSION: u32 = 1;
+
+pub const OFF_MAGIC: usize = 0;
+pub const OFF_VERSION: usize = 4;
+pub const OFF_RING_BYTES: usize = 8;
+pub const OFF_REQ_OFF: usize = 12;
+pub const OFF_RESP_OFF: usize = 16;
+pub const OFF_REQ_HEAD: usize = 64;
+pub const OFF_REQ_TAIL: usize = 128;
+pub const OFF_RESP_HEAD: usize = 192;
+pub const OFF_RESP_TAIL: usize = 256;
+pub const OFF_REQ_BELL: usize = 320;
+pub const OFF_RESP_BELL: usize = 384;
+pub const OFF_REQ_RING: usize = 4096;
+pub const OFF_RESP_RING: usize = OFF_REQ_RING + SHM_RING_BYTES;
+// The response ring ends the channel.
+const _: () = assert!(OFF_RESP_RING + SHM_RING_BYTES == SHM_BYTES);
+
+fn load<M: RingMem>(mem: &mut M, off: usize) -> Result<u32, RingError> {
+    let mut b = [0u8; 4];
+    if mem.read(off, &mut b) { Ok(u32::from_le_bytes(b)) } else { Err(RingError::Fault) }
+}
+
+fn store<M: RingMem>(mem: &mut M, off: usize, v: u32) -> Result<(), RingError> {
+    if mem.write(off, &v.to_le_bytes()) { Ok(()) } else { Err(RingError::Fault) }
+}
+
+/// Write the header of a freshly allocated (zeroed) region.
+pub fn init<M: RingMem>(mem: &mut M) -> Result<(), RingError> {
+    let header = [
+        (OFF_MAGIC, SHM_MAGIC),
+        (OFF_VERSION, SHM_VERSION),
+        (OFF_RING_BYTES, SHM_RING_BYTES as u32),
+        (OFF_REQ_OFF, OFF_REQ_RING as u32),
+        (OFF_RESP_OFF, OFF_RESP_RING as u32),
+        (OFF_REQ_HEAD, 0),
+        (OFF_REQ_TAIL, 0),
+        (OFF_RESP_HEAD, 0),
+        (OFF_RESP_TAIL, 0),
+        // Both ends start out waiting, so the banner and first request ring.
+        (OFF_REQ_BELL, 0),
+        (OFF_RESP_BELL, 0),
+    ];
+    for (off, v) in header {
+        store(mem, off, v)?;
+    }
+    Ok(())
+}
+
+/// A response is waiting (or the server corrupted its index, which the next
+/// read reports).
+pub fn reply_ready<M: RingMem>(mem: &mut M) -> bool {
+    match (load(mem, OFF_RESP_TAIL), load(mem, OFF_RESP_HEAD)) {
+        (Ok(tail), Ok(head)) => tail != head,
+        _ => true,
+    }
+}
+
+/// Copy `data` into ring `[ring, ring + SHM_RING_BYTES)` at free-running
+/// position `pos`, wrapping.
+fn ring_write<M: RingMem>(mem: &mut M, ring: usize, pos: u32, data: &[u8]) -> bool {
+    let at = pos as usize % SHM_RING_BYTES;
+    let first = data.len().min(SHM_RING_BYTES - at);
+    mem.write(ring + at, &data[..first]) && (first == data.len() || mem.write(ring, &data[first..]))
+}
+
+fn ring_read<M: RingMem>(mem: &mut M, ring: usize, pos: u32, out: &mut [u8]) -> bool {
+    let at = pos as usize % SHM_RING_BYTES;
+    let first = out.len().min(SHM_RING_BYTES - at);
+    let (a, b) = out.split_at_mut(first);
+    mem.read(ring + at, a) && (b.is_empty() || mem.read(ring, b))
+}
+
+/// The kernel's end of one channel: the indices it owns.
+#[derive(Debug, Default)]
+pub struct ShmEnd {
+    req_tail: u32,
+    resp_head: u32,
+}
+
+impl ShmEnd {
+    #[must_use]
+    pub const fn new() -> Self {
+        Self { req_tail: 0, resp_head: 0 }
+    }
+
+    /// Produce as much of `data` as fits into the request ring; returns the
+    /// bytes written (0 = full) and whether the server must be rung.
+    pub fn send<M: RingMem>(&mut self, mem: &mut M, data: &[u8]) -> Result<(usize, bool), RingError> {
+        let head = load(mem, OFF_REQ_HEAD)?;
+        let used = self.req_tail.wrapping_sub(head) as usize;
+        if used > SHM_RING_BYTES {
+            return Err(RingError::Corrupt);
+        }
+        let n = data.len().min(SHM_RING_BYTES - used);
+        if n == 0 {
+            return Ok((0, false));
+        }
+        if !ring_write(mem, OFF_REQ_RING, self.req_tail, &data[..n]) {
+            return Err(RingError::Fault);
+        }
+        self.req_tail = self.req_tail.wrapping_add(n as u32);
+        fence(Ordering::Release);
+        store(mem, OFF_REQ_TAIL, self.req_tail)?;
+        fence(Ordering::SeqCst);
+        let ring = load(mem, OFF_REQ_BELL)? == 0;
+        if ring {
+            store(mem, OFF_REQ_BELL, 1)?;
+        }
+        Ok((n, ring))
+    }
+
+    /// Consume up to `out.len()` response bytes; returns how many (0 = empty).
+    pub fn recv<M: RingMem>(&mut self, mem: &mut M, out: &mut [u8]) -> Result<usize, RingError> {
+        let tail = load(mem, OFF_RESP_TAIL)?;
+        fence(Ordering::Acquire);
+        let avail = tail.wrapping_sub(self.resp_head) as usize;
+        if avail > SHM_RING_BYTES {
+            return Err(RingError::Corrupt);
+        }
+        let n = out.len().min(avail);
+        if n == 0 {
+            return Ok(0);
+        }
+        if !ring_read(mem, OFF_RESP_RING, self.resp_head, &mut out[..n]) {
+            return Err(RingError::Fault);
+        }
+        fence(Ordering::Release);
+        self.resp_head = self.resp_head.wrapping_add(n as u32);
+        store(mem, OFF_RESP_HEAD, self.resp_head)?;
+        Ok(n)
+    }
+}
+
+/// Block until a response is waiting or `deadline_us` passes: ask the server
+/// to ring (clear `resp_bell`), drain stale doorbell bytes from pipe `rd`,
+/// re-check, and only then sleep on `rd`. Returns at once if a response is
+/// already there.
+pub fn wait_reply<M: RingMem, P: PipeIo>(mem: &mut M, io: &mut P, rd: u32, deadline_us: u64) {
+    if store(mem, OFF_RESP_BELL, 0).is_err() {
+        return;
+    }
+    fence(Ordering::SeqCst);
+    let mut scratch = [0u8; 16];
+    loop {
+        let (n, eof) = io.read(rd, &mut scratch);
+        if eof {
+            return; // server gone: let the caller's read fail
+        }
+        if n < scratch.len() {
+            break;
+        }
+    }
+    if reply_ready(mem) {
+        return;
+    }
+    io.wait_readable(rd, deadline_us);
+}
+
+/// A [`Transport`] over a mapped channel: frames through the rings, the pipe
+/// pair (`wr` to the server, `rd` from it) only as doorbells.
+pub struct ShmTransport<M: RingMem, P: PipeIo> {
+    pub mem: M,
+    pub io: P,
+    pub end: ShmEnd,
+    pub wr: u32,
+    pub rd: u32,
+    /// Per-`read_exact`/`write_all` timeout in microseconds.
+    pub timeout_us: u64,
+}
+
+impl<M: RingMem, P: PipeIo> Transport for ShmTransport<M, P> {
+    fn write_all(&mut self, buf: &[u8]) -> Result<(), TransportErr> {
+        let start = self.io.now_us();
+        let mut sent = 0;
+        while sent < buf.len() {
+            let (n, ring) = self.end.send(&mut self.mem, &buf[sent..]).map_err(|_| TransportErr)?;
+            if ring && !self.io.write(self.wr, &[1]) {
+                return Err(TransportErr);
+            }
+            sent += n;
+            if n == 0 {
+                // Full: a frame bigger than what the server has drained so
+                // far. It consumes without ringing us, so sleep briefly (on
+                // our doorbell, which any reply also rings) and retry.
+                let now = self.io.now_us();
+                if now.wrapping_sub(start) > self.timeout_us {
+                    return Err(TransportErr);
+                }
+                self.io.wait_readable(self.rd, now + 1_000);
+            }
+        }
+        Ok(())
+    }
+
+    fn read_exact(&mut self, buf: &mut [u8]) -> Result<(), TransportErr> {
+        let start = self.io.now_us();
+        let deadline = start.wrapping_add(self.timeout_us);
+        let mut got = 0;
+        while got < buf.len() {
+            let n = self.end.recv(&mut self.mem, &mut buf[got..]).map_err(|_| TransportErr)?;
+            if n > 0 {
+                got += n;
+                continue;
+            }
+            if self.io.now_us().wrapping_sub(start) > self.timeout_us {
+                return Err(TransportErr);
+            }
+            wait_reply(&mut self.mem, &mut self.io, self.rd, deadline);
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use alloc::vec;
+    use alloc::vec::Vec;
+
+    struct Mem(Vec<u8>);
+    impl RingMem for Mem {
+        fn read(&mut self, off: usize, out: &mut [u8]) -> bool {
+            let Some(s) = self.0.get(off..off + out.len()) else { return false };
+            out.copy_from_slice(s);
+            true
+        }
+        fn write(&mut self, off: usize, data: &[u8]) -> bool {
+            let Some(s) = self.0.get_mut(off..off + data.len()) else { return false };
+            s.copy_from_slice(data);
+            true
+        }
+    }
+
+    fn region() -> Mem {
+        let mut m = Mem(vec![0u8; SHM_BYTES]);
+        init(&mut m).expect("init");
+        m
+    }
+
+    fn get(m: &mut Mem, off: usize) -> u32 {
+        load(m, off).unwrap()
+    }
+
+    /// The server's side, as sp_serve_fd.c does it.
+    fn server_take(m: &mut Mem, n: usize) -> Vec<u8> {
+        let head = get(m, OFF_REQ_HEAD);
+        let mut out = vec![0u8; n];
+        assert!(ring_read(m, OFF_REQ_RING, head, &mut out));
+        store(m, OFF_REQ_HEAD, head.wrapping_add(n as u32)).unwrap();
+        out
+    }
+
+    fn server_put(m: &mut Mem, data: &[u8]) {
+        let tail = get(m, OFF_RESP_TAIL);
+        assert!(ring_write(m, OFF_RESP_RING, tail, data));
+        store(m, OFF_RESP_TAIL, tail.wrapping_add(data.len() as u32)).unwrap();
+    }
+
+    #[test]
+    fn header_describes_the_layout() {
+        let mut m = region();
+        assert_eq!(get(&mut m, OFF_MAGIC), SHM_MAGIC);
+        assert_eq!(get(&mut m, OFF_RING_BYTES) as usize, SHM_RING_BYTES);
+        assert_eq!(get(&mut m, OFF_RESP_OFF) as usize, OFF_RESP_RING);
+    }
+
+    #[test]
+    fn request_bytes_reach_the_server_in_order() {
+        let mut m = region();
+        let mut end = ShmEnd::new();
+        assert_eq!(end.send(&mut m, b"hello ").unwrap().0, 6);
+        assert_eq!(end.send(&mut m, b"world").unwrap().0, 5);
+        assert_eq!(server_take(&mut m, 11), b"hello world");
+    }
+
+    // The doorbell is rung only when the server cleared its bell.
+    #[test]
+    fn request_bell_rings_once_per_sleep() {
+        let mut m = region();
+        let mut end = ShmEnd::new();
+        assert!(end.send(&mut m, b"a").unwrap().1); // server starts out waiting
+        assert!(!end.send(&mut m, b"b").unwrap().1); // already rung
+        store(&mut m, OFF_REQ_BELL, 0).unwrap(); // server about to sleep again
+        assert!(end.send(&mut m, b"c").unwrap().1);
+        assert!(!end.send(&mut m, b"d").unwrap().1);
+    }
+
+    // A full ring takes only what fits; the rest goes once the server drains.
+    #[test]
+    fn full_request_ring_is_partial() {
+        let mut m = region();
+        let mut end = ShmEnd::new();
+        let big = vec![7u8; SHM_RING_BYTES + 10];
+        assert_eq!(end.send(&mut m, &big).unwrap().0, SHM_RING_BYTES);
+        assert_eq!(end.send(&mut m, &big[SHM_RING_BYTES..]).unwrap().0, 0);
+        server_take(&mut m, 100);
+        assert_eq!(end.send(&mut m, &big[SHM_RING_BYTES..]).unwrap().0, 10);
+    }
+
+    // Responses wrap around the end of the ring intact.
+    #[test]
+    fn response_wraps() {
+        let mut m = region();
+        let mut end = ShmEnd::new();
+        let first = vec![1u8; SHM_RING_BYTES - 3];
+        server_put(&mut m, &first);
+        let mut out = vec![0u8; first.len()];
+        assert_eq!(end.recv(&mut m, &mut out).unwrap(), first.len());
+        server_put(&mut m, b"wrapped");
+        assert!(reply_ready(&mut m));
+        let mut out = [0u8; 7];
+        assert_eq!(end.recv(&mut m, &mut out).unwrap(), 7);
+        assert_eq!(&out, b"wrapped");
+        assert!(!reply_ready(&mut m));
+        assert_eq!(end.recv(&mut m, &mut out).unwrap(), 0);
+    }
+
+    // A server index that claims more than a ring's worth is refused.
+    #[test]
+    fn corrupt_indices_are_refused() {
+        let mut m = region();
+        let mut end = ShmEnd::new();
+        store(&mut m, OFF_RESP_TAIL, SHM_RING_BYTES as u32 + 1).unwrap();
+        assert_eq!(end.recv(&mut m, &mut [0u8; 4]), Err(RingError::Corrupt));
+        store(&mut m, OFF_REQ_HEAD, 5).unwrap(); // ahead of what we produced
+        assert_eq!(end.send(&mut m, b"x"), Err(RingError::Corrupt));
+    }
+
+    /// Doorbell pipes: `bells` counts bytes written to the server; `reply`
+    /// is what the "server" puts in the response ring when we sleep.
+    struct Io {
+        bells: u32,
+        waits: u32,
+        clock: u64,
+        pending_bells: usize,
+    }
+    impl PipeIo for Io {
+        fn read(&mut self, _id: u32, buf: &mut [u8]) -> (usize, bool) {
+            let n = self.pending_bells.min(buf.len());
+            self.pending_bells -= n;
+            (n, false)
+        }
+        fn write(&mut self, _id: u32, _buf: &[u8]) -> bool {
+            self.bells += 1;
+            true
+        }
+        fn wait_readable(&mut self, _id: u32, _deadline_us: u64) {
+            self.waits += 1;
+        }
+        fn now_us(&mut self) -> u64 {
+            self.clock += 1;
+            self.clock
+        }
+    }
+
+    // wait_reply clears the reply bell and drains stale doorbell bytes; with
+    // a reply already waiting it does not sleep.
+    #[test]
+    fn wait_reply_arms_the_bell() {
+        let mut m = region();
+        let mut io = Io { bells: 0, waits: 0, clock: 0, pending_bells: 40 };
+        wait_reply(&mut m, &mut io, 2, 100);
+        assert_eq!(get(&mut m, OFF_RESP_BELL), 0);
+        assert_eq!(io.pending_bells, 0);
+        assert_eq!(io.waits, 1);
+        server_put(&mut m, b"r");
+        wait_reply(&mut m, &mut io, 2, 100);
+        assert_eq!(io.waits, 1);
+    }
+
+    #[test]
+    fn transport_rings_a_sleeping_server() {
+        let m = region();
+        let io = Io { bells: 0, waits: 0, clock: 0, pending_bells: 0 };
+        let mut t = ShmTransport { mem: m, io, end: ShmEnd::new(), wr: 1, rd: 2, timeout_us: 1000 };
+        t.write_all(b"frame").expect("write");
+        assert_eq!(t.io.bells, 1);
+        assert_eq!(server_take(&mut t.mem, 5), b"frame");
+
+        server_put(&mut t.mem, b"reply");
+        let mut out = [0u8; 5];
+        t.read_exact(&mut out).expect("read");
+        assert_eq!(&out, b"reply");
+    }
+
+    #[test]
+    fn transport_read_times_out() {
+        let io = Io { bells: 0, waits: 0, clock: 0, pending_bells: 0 };
+        let mut t = ShmTransport { mem: region(), io, end: ShmEnd::new(), wr: 1, rd: 2, timeout_us: 10 };
+        assert_eq!(t.read_exact(&mut [0u8; 1]), Err(TransportErr));
+        assert!(t.io.waits > 0);
+    }
+}
@@ -18,6 +18,21 @@
 //! COPYOUT / ANONMMAP callbacks before the final RESP — exactly the loop in
 //! `rumpclient.c:cliwaitresp` + `handlereq`.
 //!
+//! Pipelining: [`Client::submit`] sends a request and returns its reqno without
+//! waiting; [`Client::pump`] reads one frame, servicing a callback or filing a
+//! RESP under its reqno for [`Client::take_done`], so several box threads can
+//! have syscalls in flight on the one connection and collect replies out of
+//! order. Callbacks carry the *server's* reqno, not the syscall's, so they can't
+//! be attributed to a request: whoever pumps services them against its own
+//! [`ClientMem`]. The kernel therefore only overlaps requests that need no
+//! per-call memory state, from one address space.
+//!
+//! Bulk copy: a request may carry user-memory segments the server is about to
+//! copyin (a write's buffer, a writev's iovecs). They ride in an Akuma-only
+//! PREFETCH frame sent just before the SYSCALL, and `sp_serve_fd.c` serves the
+//! covered copyins locally — each saved copyin is one pipe round trip fewer.
+//! Only sent when the server's banner advertises it ([`PREFETCH_BANNER_TOKEN`]).
+//!
 //! SECURITY (RUMP_SYSPROXY.md "sysproxy wire bounds-checks"): server callbacks
 //! carry server-supplied lengths/addrs. Split: this module coarse-caps sizes
 //! ([`MAX_TRANSFER`]); the kernel [`ClientMem`] impl sanity-checks the size and
@@ -25,6 +40,7 @@
 //! server's job and lands when the sp glue is ported to Rust (not done today).
 
 extern crate alloc;
+use alloc::collections::BTreeMap;
 use alloc::vec::Vec;
 
 /// Header size on the wire (`sizeof(struct rsp_hdr)`).
@@ -44,6 +60,30 @@ const RUMPSP_COPYOUT: u16 = 4;
 const RUMPSP_COPYOUTSTR: u16 = 5;
 const RUMPSP_ANONMMAP: u16 = 6;
 const RUMPSP_RAISE: u16 = 8;
+/// Akuma extension, not in NetBSD's `enum rumpsp_type` (must match
+/// `sp_serve_fd.c`). Payload: `{ nlive:u32, nseg:u32, live:[u64; nlive],
+/// nseg × { addr:u64, len:u64, data[len], pad to 8 } }`, sent as a REQ with the
+/// reqno of the SYSCALL that follows it. `live` lists the reqnos the client still
+/// has in flight; the server drops prefetched data of every other reqno.
+const RUMPSP_AKUMA_PREFETCH: u16 = 0x4150;
+
+/// Banner suffix by which the server advertises PREFETCH support.
+pub const PREFETCH_BANNER_TOKEN: &[u8] = b"+prefetch";
+
+/// Banner suffix by which the server says it serves several channels (one
+/// client each) and takes more from the kernel, so boxes can share its stack.
+pub const MUX_BANNER_TOKEN: &[u8] = b"+mux";
+
+/// Whether the banner's flags — the `+token`s after the machine name, in any
+/// order — include `token`.
+fn banner_has(banner: &[u8], token: &[u8]) -> bool {
+    let Some(slash) = banner.iter().rposition(|&b| b == b'/') else { return false };
+    banner[slash + 1..].split(|&b| b == b'+').skip(1).any(|f| f == &token[1..])
+}
+
+/// Cap on the user memory one request pre-sends; the rest is copied in by
+/// callback as before.
+pub const MAX_PREFETCH: usize = 64 * 1024;
 
 // handshake subtype (enum { HANDSHAKE_GUEST, HANDSHAKE_AUTH, ... })
 const HANDSHAKE_GUEST: u32 = 0;
@@ -131,11 +171,27 @@ const EINVAL: i32 = 22;
 pub struct Client<T: Transport> {
     t: T,
     reqno: u64,
+    /// The banner advertised PREFETCH; bulk segments are dropped otherwise.
+    prefetch: bool,
+    /// The banner advertised a multi-client server ([`MUX_BANNER_TOKEN`]).
+    mux: bool,
+    /// Submitted reqnos not yet collected ([`take_done`](Client::take_done) or
+    /// [`abandon`](Client::abandon)).
+    inflight: Vec<u64>,
+    /// The subset of `inflight` that sent a PREFETCH with data.
+    prefetched: Vec<u64>,
+    /// A prefetching request was collected since the last PREFETCH frame, so
+    /// the server may hold data for a reqno no longer in flight.
+    stale: bool,
+    /// Replies read off the wire, awaiting collection by their submitter.
+    done: BTreeMap<u64, SyscallResult>,
     /// Server→client callbacks (copyin/copyout/anonmmap) serviced during the LAST
     /// [`syscall`](Client::syscall). A latency-localization signal: one proxied
     /// syscall costs `1 + callbacks` pipe round-trips, so this separates "many
     /// copyin hops" from "one slow hop" when reading the `[RUMP-SP]` timings.
     callbacks: u32,
+    /// Callbacks serviced over the connection's lifetime.
+    total_callbacks: u64,
 }
 
 impl<T: Transport> Client<T> {
@@ -144,6 +200,7 @@ impl<T: Transport> Client<T> {
     /// `HANDSHAKE_GUEST` request carrying `progname` and await its RESP.
     pub fn connect(mut t: T, progname: &[u8]) -> Result<Self, i32> {
         // 1. Banner: read bytes until '\n' (bounded by MAXBANNER=96).
+        let mut banner = Vec::with_capacity(96);
         let mut got_nl = false;
         for _ in 0..96 {
             let mut b = [0u8; 1];
@@ -152,12 +209,24 @@ impl<T: Transport> Client<T> {
                 got_nl = true;
                 break;
             }
+            banner.push(b[0]);
         }
         if !got_nl {
             return Err(EIO);
         }
 
-        let mut c = Self { t, reqno: 1, callbacks: 0 };
+        let mut c = Self {
+            t,
+            reqno: 1,
+            prefetch: banner_has(&banner, PREFETCH_BANNER_TOKEN),
+            mux: banner_has(&banner, MUX_BANNER_TOKEN),
+            inflight: Vec::new(),
+            prefetched: Vec::new(),
+            stale: false,
+            done: BTreeMap::new(),
+            callbacks: 0,
+            total_callbacks: 0,
+        };
         // 2. Handshake request: hdr + progname + NUL.
         let reqno = c.next_reqno();
         let mut payload = Vec::with_capacity(progname.len() + 1);
@@ -177,7 +246,7 @@ impl<T: Transport> Client<T> {
         // `rsp_sysresp` — the server sends a short payload (a 4-byte handshake
         // word), so we must not run `parse_sysresp` (which needs 24 bytes). We
         // only need: a RESP for our reqno = success, ERROR = failure.
-        c.await_response(reqno, &mut NoMem, false)?;
+        c.await_handshake(reqno)?;
         Ok(c)
     }
 
@@ -192,56 +261,153 @@ impl<T: Transport> Client<T> {
     /// copyin/copyout callback loop against `mem` until the final RESP.
     pub fn syscall(&mut self, sysnum: u32, args: &[u8], mem: &mut dyn ClientMem) -> SyscallResult {
         self.callbacks = 0;
+        let reqno = self.submit(sysnum, args, &[])?;
+        loop {
+            if let Some(res) = self.take_done(reqno) {
+                return res;
+            }
+            if let Err(e) = self.pump(mem) {
+                self.abandon(reqno);
+                return Err(e);
+            }
+        }
+    }
+
+    /// Send a SYSCALL request without waiting for it; returns its reqno for
+    /// [`take_done`](Client::take_done). `bulk` is `(user addr, bytes)` the
+    /// server will copyin, pre-sent when the server supports PREFETCH (capped
+    /// at [`MAX_PREFETCH`] in total).
+    pub fn submit(&mut self, sysnum: u32, args: &[u8], bulk: &[(u64, &[u8])]) -> Result<u64, i32> {
         let reqno = self.next_reqno();
+        self.inflight.push(reqno);
+        let sent = self.send_prefetch(reqno, bulk).and_then(|()| {
+            let hdr = enc_hdr(
+                (HDRSZ + args.len()) as u64,
+                reqno,
+                RUMPSP_REQ,
+                RUMPSP_SYSCALL,
+                sysnum,
+            );
+            self.t.write_all(&hdr).map_err(|_| EIO)?;
+            self.t.write_all(args).map_err(|_| EIO)
+        });
+        if let Err(e) = sent {
+            self.abandon(reqno);
+            return Err(e);
+        }
+        Ok(reqno)
+    }
+
+    /// Send the PREFETCH frame ahead of `reqno`'s SYSCALL: its bulk segments,
+    /// and — even without any — the live set, whenever the server may still
+    /// hold data for a collected request (so it can never serve that data to a
+    /// later copyin of the same, since rewritten, user buffer).
+    fn send_prefetch(&mut self, reqno: u64, bulk: &[(u64, &[u8])]) -> Result<(), i32> {
+        if !self.prefetch || (bulk.is_empty() && !self.stale) {
+            return Ok(());
+        }
+        let payload = enc_prefetch(&self.inflight, bulk);
         let hdr = enc_hdr(
-            (HDRSZ + args.len()) as u64,
+            (HDRSZ + payload.len()) as u64,
             reqno,
             RUMPSP_REQ,
-            RUMPSP_SYSCALL,
-            sysnum,
+            RUMPSP_AKUMA_PREFETCH,
+            0,
         );
         self.t.write_all(&hdr).map_err(|_| EIO)?;
-        self.t.write_all(args).map_err(|_| EIO)?;
-        self.await_response(reqno, mem, true)
-    }
-
-    /// Read frames, servicing server callbacks, until the RESP/ERROR for
-    /// `want_reqno` arrives. `expect_sysresp` controls how a RESP payload is
-    /// interpreted: a syscall reply is a `rsp_sysresp` (parse it); a handshake
-    /// reply is a short non-sysresp word (RESP alone = success).
-    fn await_response(
-        &mut self,
-        want_reqno: u64,
-        mem: &mut dyn ClientMem,
-        expect_sysresp: bool,
-    ) -> SyscallResult {
-        loop {
-            let mut hbuf = [0u8; HDRSZ];
-            self.t.read_exact(&mut hbuf).map_err(|_| EIO)?;
-            let h = dec_hdr(&hbuf);
-            if (h.len as usize) < HDRSZ {
-                return Err(EIO);
-            }
-            let dlen = h.len as usize - HDRSZ;
-            if dlen > MAX_TRANSFER {
-                return Err(EIO);
+        self.t.write_all(&payload).map_err(|_| EIO)?;
+        self.stale = false;
+        if !bulk.is_empty() {
+            self.prefetched.push(reqno);
+        }
+        Ok(())
+    }
+
+    /// Read one frame: service a server callback against `mem`, or file a
+    /// RESP/ERROR under its reqno. Returns the reqno whose reply was filed (so
+    /// the caller can wake its submitter), or `None`. A reply for a reqno no
+    /// longer in flight (abandoned after a timeout) is dropped.
+    pub fn pump(&mut self, mem: &mut dyn ClientMem) -> Result<Option<u64>, i32> {
+        let (h, data) = self.read_frame()?;
+        match h.class {
+            RUMPSP_RESP | RUMPSP_ERROR if self.inflight.contains(&h.reqno) => {
+                let res = if h.class == RUMPSP_ERROR {
+                    Err(rumpsp_err_to_errno(h.u))
+                } else {
+                    parse_sysresp(&data)
+                };
+                self.done.insert(h.reqno, res);
+                Ok(Some(h.reqno))
             }
-            let mut data = Vec::new();
-            if dlen > 0 {
-                data.resize(dlen, 0);
-                self.t.read_exact(&mut data).map_err(|_| EIO)?;
+            RUMPSP_REQ => {
+                self.handle_req(&h, &data, mem)?;
+                Ok(None)
             }
+            _ => Ok(None),
+        }
+    }
+
+    /// Collect `reqno`'s reply if [`pump`](Client::pump) has filed it.
+    pub fn take_done(&mut self, reqno: u64) -> Option<SyscallResult> {
+        let res = self.done.remove(&reqno)?;
+        self.retire(reqno);
+        Some(res)
+    }
+
+    /// Give up on `reqno` (timeout, transport error): its reply, if it ever
+    /// arrives, is dropped by [`pump`](Client::pump).
+    pub fn abandon(&mut self, reqno: u64) {
+        self.done.remove(&reqno);
+        self.retire(reqno);
+    }
+
+    fn retire(&mut self, reqno: u64) {
+        self.inflight.retain(|&r| r != reqno);
+        if let Some(i) = self.prefetched.iter().position(|&r| r == reqno) {
+            self.prefetched.swap_remove(i);
+            self.stale = true;
+        }
+    }
+
+    /// Requests submitted and not yet collected.
+    #[must_use]
+    pub fn in_flight(&self) -> usize {
+        self.inflight.len()
+    }
+
+    fn read_frame(&mut self) -> Result<(DecHdr, Vec<u8>), i32> {
+        let mut hbuf = [0u8; HDRSZ];
+        self.t.read_exact(&mut hbuf).map_err(|_| EIO)?;
+        let h = dec_hdr(&hbuf);
+        if (h.len as usize) < HDRSZ {
+            return Err(EIO);
+        }
+        let dlen = h.len as usize - HDRSZ;
+        if dlen > MAX_TRANSFER {
+            return Err(EIO);
+        }
+        let mut data = Vec::new();
+        if dlen > 0 {
+            data.resize(dlen, 0);
+            self.t.read_exact(&mut data).map_err(|_| EIO)?;
+        }
+        Ok((h, data))
+    }
 
+    /// Read frames, servicing server callbacks, until the handshake RESP/ERROR
+    /// for `want_reqno` arrives. A handshake reply is a short non-sysresp word,
+    /// so a RESP alone means success.
+    fn await_handshake(&mut self, want_reqno: u64) -> Result<(), i32> {
+        loop {
+            let (h, data) = self.read_frame()?;
             match h.class {
                 RUMPSP_RESP | RUMPSP_ERROR if h.reqno == want_reqno => {
                     if h.class == RUMPSP_ERROR {
                         return Err(rumpsp_err_to_errno(h.u));
                     }
-                    return if expect_sysresp { parse_sysresp(&data) } else { Ok([0, 0]) };
+                    return Ok(());
                 }
-                RUMPSP_REQ => self.handle_req(&h, &data, mem)?,
-                // A RESP for some other reqno (shouldn't happen on our
-                // serialized per-box connection): ignore and keep reading.
+                RUMPSP_REQ => self.handle_req(&h, &data, &mut NoMem)?,
                 _ => {}
             }
         }
@@ -254,9 +420,30 @@ impl<T: Transport> Client<T> {
         self.callbacks
     }
 
+    /// Callbacks serviced since connect, across all requests; a pipelined
+    /// caller diffs this around its own pumps.
+    #[must_use]
+    pub fn total_callbacks(&self) -> u64 {
+        self.total_callbacks
+    }
+
+    /// The transport the client was connected over.
+    #[must_use]
+    pub fn transport(&self) -> &T {
+        &self.t
+    }
+
+    /// The server takes further channels for other boxes (its banner said
+    /// [`MUX_BANNER_TOKEN`]).
+    #[must_use]
+    pub fn server_mux(&self) -> bool {
+        self.mux
+    }
+
     /// Service one server→client callback (copyin/copyout/anonmmap/raise).
     fn handle_req(&mut self, h: &DecHdr, data: &[u8], mem: &mut dyn ClientMem) -> Result<(), i32> {
         self.callbacks = self.callbacks.saturating_add(1);
+        self.total_callbacks += 1;
         match h.typ {
             RUMPSP_COPYIN | RUMPSP_COPYINSTR => {
                 let (len, addr) = parse_copydata_head(data)?;
@@ -311,6 +498,33 @@ impl<T: Transport> Client<T> {
     }
 }
 
+/// Encode a PREFETCH payload (layout at [`RUMPSP_AKUMA_PREFETCH`]). Segments
+/// past [`MAX_PREFETCH`] bytes in total are cut short or left out.
+fn enc_prefetch(live: &[u64], bulk: &[(u64, &[u8])]) -> Vec<u8> {
+    let mut budget = MAX_PREFETCH;
+    let segs: Vec<(u64, &[u8])> = bulk
+        .iter()
+        .map_while(|&(addr, b)| {
+            let n = b.len().min(budget);
+            budget -= n;
+            (n > 0).then(|| (addr, &b[..n]))
+        })
+        .collect();
+    let mut p = Vec::with_capacity(8 + live.len() * 8 + segs.len() * 24 + (MAX_PREFETCH - budget));
+    p.extend_from_slice(&(live.len() as u32).to_le_bytes());
+    p.extend_from_slice(&(segs.len() as u32).to_le_bytes());
+    for r in live {
+        p.extend_from_slice(&r.to_le_bytes());
+    }
+    for (addr, b) in segs {
+        p.extend_from_slice(&addr.to_le_bytes());
+        p.extend_from_slice(&(b.len() as u64).to_le_bytes());
+        p.extend_from_slice(b);
+        p.resize(p.len().next_multiple_of(8), 0);
+    }
+    p
+}
+
 /// `struct rsp_copydata { size_t rcp_len; void *rcp_addr; u8 rcp_data[]; }`.
 fn parse_copydata_head(data: &[u8]) -> Result<(usize, u64), i32> {
     if data.len() < 16 {
@@ -705,6 +919,155 @@ mod tests {
         assert_eq!(addr, 0x1000);
     }
 
+    // ── pipelining + PREFETCH ────────────────────────────────────────────────
+
+    const PF_BANNER: &[u8] = b"RUMPSP-0.1-NetBSD-10.0/aarch64+prefetch\n";
+
+    fn connected(banner: &[u8], rest: &[u8]) -> Client<MockT> {
+        let mut inbox = banner.to_vec();
+        inbox.extend_from_slice(&frame(1, RUMPSP_RESP, RUMPSP_HANDSHAKE, 0, &[0u8; 4]));
+        inbox.extend_from_slice(rest);
+        Client::connect(MockT::new(inbox), b"k").expect("hs")
+    }
+
+    /// Split `out` into (hdr, payload) frames.
+    fn frames(mut out: &[u8]) -> Vec<(DecHdr, Vec<u8>)> {
+        let mut v = Vec::new();
+        while !out.is_empty() {
+            let h = dec_hdr(&out[..HDRSZ].try_into().unwrap());
+            let len = h.len as usize;
+            v.push((h, out[HDRSZ..len].to_vec()));
+            out = &out[len..];
+        }
+        v
+    }
+
+    // Two requests in flight; the server answers the second first. Each reply
+    // is filed under its own reqno and collected by its submitter.
+    #[test]
+    fn pipelined_replies_match_out_of_order() {
+        let mut rest = frame(3, RUMPSP_RESP, RUMPSP_SYSCALL, 0, &sysresp(0, 30, 0));
+        rest.extend_from_slice(&frame(2, RUMPSP_RESP, RUMPSP_SYSCALL, 0, &sysresp(0, 20, 0)));
+        let mut c = connected(b"b\n", &rest);
+        let mut mem = MockMem::new();
+        let a = c.submit(3, &[0u8; 24], &[]).expect("a");
+        let b = c.submit(4, &[0u8; 24], &[]).expect("b");
+        assert_eq!((a, b), (2, 3));
+        assert_eq!(c.in_flight(), 2);
+
+        assert_eq!(c.pump(&mut mem), Ok(Some(3)));
+        assert_eq!(c.take_done(a), None);
+        assert_eq!(c.take_done(b), Some(Ok([30, 0])));
+        assert_eq!(c.pump(&mut mem), Ok(Some(2)));
+        assert_eq!(c.take_done(a), Some(Ok([20, 0])));
+        assert_eq!(c.in_flight(), 0);
+    }
+
+    // A late reply for an abandoned request is read and dropped.
+    #[test]
+    fn abandoned_reply_is_dropped() {
+        let rest = frame(2, RUMPSP_RESP, RUMPSP_SYSCALL, 0, &sysresp(0, 1, 0));
+        let mut c = connected(b"b\n", &rest);
+        let r = c.submit(3, &[0u8; 24], &[]).expect("submit");
+        c.abandon(r);
+        assert_eq!(c.pump(&mut MockMem::new()), Ok(None));
+        assert_eq!(c.take_done(r), None);
+    }
+
+    // Flags are `+token`s after the machine name, in any order; a token must
+    // match whole.
+    #[test]
+    fn banner_flags_parse_in_any_order() {
+        let c = connected(b"RUMPSP-0.1-NetBSD-10.0/aarch64+mux+prefetch\n", &[]);
+        assert!(c.prefetch && c.server_mux());
+        let c = connected(PF_BANNER, &[]);
+        assert!(c.prefetch && !c.server_mux());
+        let c = connected(b"RUMPSP-0.1-NetBSD-10.0/aarch64+muxer\n", &[]);
+        assert!(!c.prefetch && !c.server_mux());
+    }
+
+    // Without the banner token, bulk is not sent: the wire is exactly what a
+    // stock NetBSD server expects.
+    #[test]
+    fn bulk_needs_the_banner_token() {
+        let mut c = connected(b"RUMPSP-0.1-NetBSD-10.0/aarch64\n", &[]);
+        let before = c.t.outbox.len();
+        c.submit(4, &[0u8; 24], &[(0x4000, b"hello")]).expect("submit");
+        let f = frames(&c.t.outbox[before..]);
+        assert_eq!(f.len(), 1);
+        assert_eq!(f[0].0.typ, RUMPSP_SYSCALL);
+    }
+
+    // With it, a PREFETCH frame carrying the live set and the 8-aligned
+    // segments precedes the SYSCALL, under the same reqno.
+    #[test]
+    fn prefetch_frame_precedes_syscall() {
+        let mut c = connected(PF_BANNER, &[]);
+        let before = c.t.outbox.len();
+        let r = c.submit(4, &[0u8; 24], &[(0x4000, b"hello"), (0x9000, &[7u8; 8])]).expect("submit");
+        let f = frames(&c.t.outbox[before..]);
+        assert_eq!(f.len(), 2);
+        let (h, p) = &f[0];
+        assert_eq!((h.class, h.typ, h.reqno), (RUMPSP_REQ, RUMPSP_AKUMA_PREFETCH, r));
+        assert_eq!(&p[0..8], &[1, 0, 0, 0, 2, 0, 0, 0]); // nlive=1 nseg=2
+        assert_eq!(u64::from_le_bytes(p[8..16].try_into().unwrap()), r);
+        assert_eq!(u64::from_le_bytes(p[16..24].try_into().unwrap()), 0x4000);
+        assert_eq!(u64::from_le_bytes(p[24..32].try_into().unwrap()), 5);
+        assert_eq!(&p[32..37], b"hello");
+        assert_eq!(u64::from_le_bytes(p[40..48].try_into().unwrap()), 0x9000);
+        assert_eq!(&p[56..64], &[7u8; 8]);
+        assert_eq!(p.len(), 64);
+        assert_eq!((f[1].0.typ, f[1].0.reqno), (RUMPSP_SYSCALL, r));
+    }
+
+    // Bulk beyond MAX_PREFETCH is cut, not sent whole.
+    #[test]
+    fn prefetch_is_capped() {
+        let big = alloc::vec![1u8; MAX_PREFETCH + 100];
+        let p = enc_prefetch(&[2], &[(0x1000, &big), (0x2000, b"x")]);
+        assert_eq!(&p[0..8], &[1, 0, 0, 0, 1, 0, 0, 0]);
+        assert_eq!(u64::from_le_bytes(p[24..32].try_into().unwrap()), MAX_PREFETCH as u64);
+    }
+
+    // Once a prefetching request is collected, the next request (even without
+    // bulk) first tells the server which reqnos are still live, exactly once.
+    #[test]
+    fn collected_prefetch_is_retired_by_the_next_request() {
+        let rest = frame(2, RUMPSP_RESP, RUMPSP_SYSCALL, 0, &sysresp(0, 5, 0));
+        let mut c = connected(PF_BANNER, &rest);
+        let mut mem = MockMem::new();
+        let r = c.submit(4, &[0u8; 24], &[(0x4000, b"hello")]).expect("submit");
+        c.pump(&mut mem).expect("pump");
+        assert_eq!(c.take_done(r), Some(Ok([5, 0])));
+
+        let before = c.t.outbox.len();
+        let r2 = c.submit(3, &[0u8; 24], &[]).expect("submit");
+        let f = frames(&c.t.outbox[before..]);
+        assert_eq!(f.len(), 2);
+        assert_eq!(f[0].0.typ, RUMPSP_AKUMA_PREFETCH);
+        assert_eq!(&f[0].1[0..8], &[1, 0, 0, 0, 0, 0, 0, 0]); // live={r2}, no segments
+        assert_eq!(u64::from_le_bytes(f[0].1[8..16].try_into().unwrap()), r2);
+
+        let before = c.t.outbox.len();
+        c.submit(3, &[0u8; 24], &[]).expect("submit");
+        assert_eq!(frames(&c.t.outbox[before..]).len(), 1);
+    }
+
+    // Callbacks count toward both the per-syscall and lifetime hop counters.
+    #[test]
+    fn callbacks_counted_across_requests() {
+        let mut rest = frame(9, RUMPSP_REQ, RUMPSP_COPYIN, 0, &copydata_head(2, 0x4000));
+        rest.extend_from_slice(&frame(2, RUMPSP_RESP, RUMPSP_SYSCALL, 0, &sysresp(0, 2, 0)));
+        rest.extend_from_slice(&frame(3, RUMPSP_RESP, RUMPSP_SYSCALL, 0, &sysresp(0, 0, 0)));
+        let mut c = connected(b"b\n", &rest);
+        let mut mem = MockMem::new();
+        mem.regions.insert(0x4000, alloc::vec![1, 2]);
+        c.syscall(4, &[0u8; 24], &mut mem).expect("first");
+        assert_eq!(c.last_callbacks(), 1);
+        c.syscall(3, &[0u8; 24], &mut mem).expect("second");
+        assert_eq!((c.last_callbacks(), c.total_callbacks()), (0, 1));
+    }
+
     // ── PipeTransport (the kernel-pipe blocking read loop) ──────────────────
 
     /// Scripted PipeIo: `reads` is a queue of (bytes, eof) chunks delivered on
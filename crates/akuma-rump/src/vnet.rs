@@ -0,0 +1,194 @@
+//! virtio-net header mode for `/dev/net/tap0`: checksum and TSO offload.
+//!
+//! By default the tap moves bare Ethernet frames and NIC1 is negotiated with
+//! no offloads, so the rump stack checksums and segments everything itself.
+//! `TAPSETVNET` switches the tap to *vnet mode*: the kernel renegotiates NIC1
+//! with whichever of [`OFFLOAD_FEATURES`] the device offers, and every frame,
+//! both ways and on every path (read/write, the batch ioctls, the ring), is
+//! prefixed with a [`VNET_HDR_LEN`]-byte `struct virtio_net_hdr`, as with
+//! Linux's `IFF_VNET_HDR`:
+//!
+//! ```text
+//! [flags u8][gso_type u8][hdr_len u16][gso_size u16][csum_start u16][csum_offset u16][frame]
+//! ```
+//!
+//! Fields are little-endian (the device's legacy header on a little-endian
+//! guest). On RX the header is the device's, so `F_DATA_VALID` /
+//! `F_NEEDS_CSUM` say the checksum need not be verified. On TX the writer may
+//! ask for `F_NEEDS_CSUM` (the device completes the checksum at
+//! `csum_start + csum_offset`, which holds the pseudo-header sum) and, with a
+//! TSO feature, a `GSO_TCPV4`/`GSO_TCPV6` frame of up to [`TSO_FRAME_MAX`]
+//! bytes that the device cuts into `gso_size` segments. TSO frames do not fit
+//! a ring slot, so they go by `write` or `TAPSENDBATCH`. [`tx_check`] rejects
+//! a header the negotiated features cannot honour.
+//!
+//! Receive-side segmentation offload (`GUEST_TSO*`) is deliberately not
+//! negotiated: it needs 64 KB receive buffers per slot, and the NetBSD stack
+//! drops frames over the interface MTU on input anyway.
+
+/// Bytes of `struct virtio_net_hdr` before each frame in vnet mode.
+pub const VNET_HDR_LEN: usize = 10;
+
+/// `flags`: the device (TX) or peer (RX) left the checksum to be completed.
+pub const F_NEEDS_CSUM: u8 = 1;
+/// `flags` (RX only): the checksum was already verified.
+pub const F_DATA_VALID: u8 = 2;
+
+/// `gso_type` values.
+pub const GSO_NONE: u8 = 0;
+pub const GSO_TCPV4: u8 = 1;
+pub const GSO_TCPV6: u8 = 4;
+/// Or'ed into `gso_type`: the segments carry ECN's CWR bit. Needs
+/// `HOST_ECN`, which the tap does not negotiate, so it is refused.
+pub const GSO_ECN: u8 = 0x80;
+
+/// virtio-net feature bits (virtio spec §5.1.3) the tap can negotiate.
+pub const FEAT_CSUM: u64 = 1 << 0;
+pub const FEAT_GUEST_CSUM: u64 = 1 << 1;
+pub const FEAT_HOST_TSO4: u64 = 1 << 11;
+pub const FEAT_HOST_TSO6: u64 = 1 << 12;
+
+/// What vnet mode asks the device for: TX checksum and TSO, RX checksum.
+pub const OFFLOAD_FEATURES: u64 = FEAT_CSUM | FEAT_GUEST_CSUM | FEAT_HOST_TSO4 | FEAT_HOST_TSO6;
+
+/// Largest TSO frame (after its header): with the header, and the length of
+/// a batch record, it fits one 64 KB `write` chunk or `TAPSENDBATCH` buffer.
+/// Stacks should cap their TSO length to fit.
+pub const TSO_FRAME_MAX: usize = 64 * 1024 - crate::BATCH_HDR - VNET_HDR_LEN;
+
+/// The subset of `offered` the tap negotiates: the TSO bits need `CSUM`
+/// (spec: `HOST_TSO*` requires `CSUM`).
+#[must_use]
+pub const fn negotiate(offered: u64) -> u64 {
+    let f = offered & OFFLOAD_FEATURES;
+    if f & FEAT_CSUM == 0 { f & !(FEAT_HOST_TSO4 | FEAT_HOST_TSO6) } else { f }
+}
+
+/// A `struct virtio_net_hdr`.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct VnetHdr {
+    pub flags: u8,
+    pub gso_type: u8,
+    pub hdr_len: u16,
+    pub gso_size: u16,
+    pub csum_start: u16,
+    pub csum_offset: u16,
+}
+
+impl VnetHdr {
+    /// Parse the first [`VNET_HDR_LEN`] bytes of `b`.
+    #[must_use]
+    pub fn from_bytes(b: &[u8]) -> Option<Self> {
+        let b = b.get(..VNET_HDR_LEN)?;
+        let u16_at = |i: usize| u16::from_le_bytes([b[i], b[i + 1]]);
+        Some(Self {
+            flags: b[0],
+            gso_type: b[1],
+            hdr_len: u16_at(2),
+            gso_size: u16_at(4),
+            csum_start: u16_at(6),
+            csum_offset: u16_at(8),
+        })
+    }
+
+    #[must_use]
+    pub fn to_bytes(&self) -> [u8; VNET_HDR_LEN] {
+        let mut b = [0u8; VNET_HDR_LEN];
+        b[0] = self.flags;
+        b[1] = self.gso_type;
+        b[2..4].copy_from_slice(&self.hdr_len.to_le_bytes());
+        b[4..6].copy_from_slice(&self.gso_size.to_le_bytes());
+        b[6..8].copy_from_slice(&self.csum_start.to_le_bytes());
+        b[8..10].copy_from_slice(&self.csum_offset.to_le_bytes());
+        b
+    }
+}
+
+/// Whether a TX frame of `frame_len` bytes with `hdr` can go to a device
+/// that negotiated `features`.
+///
+/// The checksum field must lie inside the frame, a GSO type must be one the
+/// device took and carry a segment size, and only a GSO frame may exceed
+/// `max_plain` (the most a plain frame may be).
+#[must_use]
+pub fn tx_check(hdr: &VnetHdr, frame_len: usize, features: u64, max_plain: usize) -> bool {
+    if hdr.flags & F_NEEDS_CSUM != 0
+        && (features & FEAT_CSUM == 0
+            || usize::from(hdr.csum_start) + usize::from(hdr.csum_offset) + 2 > frame_len)
+    {
+        return false;
+    }
+    let need = match hdr.gso_type {
+        GSO_NONE => return frame_len <= max_plain,
+        GSO_TCPV4 => FEAT_HOST_TSO4,
+        GSO_TCPV6 => FEAT_HOST_TSO6,
+        _ => return false,
+    };
+    features & need != 0
+        && hdr.flags & F_NEEDS_CSUM != 0
+        && hdr.gso_size != 0
+        && usize::from(hdr.hdr_len) < frame_len
+        && frame_len <= TSO_FRAME_MAX
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const ALL: u64 = OFFLOAD_FEATURES;
+
+    fn tso4(len: usize) -> (VnetHdr, usize) {
+        let hdr = VnetHdr {
+            flags: F_NEEDS_CSUM,
+            gso_type: GSO_TCPV4,
+            hdr_len: 54,
+            gso_size: 1448,
+            csum_start: 34,
+            csum_offset: 16,
+        };
+        (hdr, len)
+    }
+
+    #[test]
+    fn header_round_trips_little_endian() {
+        let h = VnetHdr { flags: 1, gso_type: 4, hdr_len: 0x0102, gso_size: 0x0304, csum_start: 0x0506, csum_offset: 0x0708 };
+        let b = h.to_bytes();
+        assert_eq!(b, [1, 4, 2, 1, 4, 3, 6, 5, 8, 7]);
+        assert_eq!(VnetHdr::from_bytes(&b), Some(h));
+        assert_eq!(VnetHdr::from_bytes(&b[..9]), None);
+    }
+
+    #[test]
+    fn negotiate_drops_tso_without_csum() {
+        assert_eq!(negotiate(!0), ALL);
+        assert_eq!(negotiate(FEAT_HOST_TSO4 | FEAT_GUEST_CSUM), FEAT_GUEST_CSUM);
+        assert_eq!(negotiate(0), 0);
+    }
+
+    #[test]
+    fn plain_frames_pass_up_to_the_limit() {
+        let h = VnetHdr::default();
+        assert!(tx_check(&h, 1514, 0, 2038));
+        assert!(!tx_check(&h, 2039, ALL, 2038));
+    }
+
+    #[test]
+    fn csum_needs_the_feature_and_a_field_inside_the_frame() {
+        let h = VnetHdr { flags: F_NEEDS_CSUM, csum_start: 34, csum_offset: 16, ..VnetHdr::default() };
+        assert!(tx_check(&h, 60, FEAT_CSUM, 2038));
+        assert!(!tx_check(&h, 60, 0, 2038));
+        assert!(!tx_check(&h, 51, FEAT_CSUM, 2038));
+    }
+
+    #[test]
+    fn tso_needs_its_feature_csum_and_a_segment_size() {
+        let (h, len) = tso4(60_000);
+        assert!(tx_check(&h, len, ALL, 2038));
+        assert!(!tx_check(&h, len, FEAT_CSUM | FEAT_HOST_TSO6, 2038));
+        assert!(!tx_check(&VnetHdr { gso_size: 0, ..h }, len, ALL, 2038));
+        assert!(!tx_check(&VnetHdr { flags: 0, ..h }, len, ALL, 2038));
+        assert!(!tx_check(&h, TSO_FRAME_MAX + 1, ALL, 2038));
+        assert!(!tx_check(&VnetHdr { gso_type: GSO_TCPV4 | GSO_ECN, ..h }, len, ALL, 2038));
+        assert!(!tx_check(&VnetHdr { gso_type: 3, ..h }, len, ALL, 2038));
+    }
+}
@@ -150,7 +150,13 @@ esac
 #            independent of NIC0 (which stays on the native smoltcp stack).
 #              0 (default) no second NIC; /dev/net/tap0 stays ENODEV
 #              1           add NIC1 → rump tap usable
+# RUMP_NIC_TAP - with RUMP_NIC=1: back NIC1 with this existing host tap
+#                interface (vnet_hdr=on) instead of SLIRP. Only then does QEMU
+#                offer the checksum/TSO offloads the tap's TAPSETVNET mode
+#                negotiates; SLIRP offers none. No DHCP or port forward: the
+#                host side of the tap is yours to configure.
 RUMP_NIC="${RUMP_NIC:-0}"
+RUMP_NIC_TAP="${RUMP_NIC_TAP:-}"
 RUMP_NIC_ARGS=()
 case "$RUMP_NIC" in
   0|off|no|false|FALSE)
@@ -162,7 +168,10 @@ case "$RUMP_NIC" in
     #                 Distinct from NIC0/smoltcp's 2222 (Akuma's own sshd). Default
     #                 2223; set empty to disable the forward.
     RUMP_SSH_PORT="${RUMP_SSH_PORT:-2223}"
-    if [ -n "$RUMP_SSH_PORT" ]; then
+    if [ -n "$RUMP_NIC_TAP" ]; then
+      RUMP_NIC_ARGS+=(-netdev "tap,id=net1,ifname=${RUMP_NIC_TAP},script=no,downscript=no,vnet_hdr=on")
+      echo "[cargo_runner] rump: NIC1 (net1) → /dev/net/tap0 over host tap ${RUMP_NIC_TAP} (offloads available)" >&2
+    elif [ -n "$RUMP_SSH_PORT" ]; then
       RUMP_NIC_ARGS+=(-netdev "user,id=net1,hostfwd=tcp::${RUMP_SSH_PORT}-:22")
       echo "[cargo_runner] rump: NIC1 (net1) → /dev/net/tap0; ssh box via host :${RUMP_SSH_PORT} → rump:22" >&2
     else
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Compare two `qjs --bench` runs and fail on regressions.
+
+Each input is the JSON-lines output of `qjs --bench` (see
+userspace/quickjs/src/bench.rs), e.g. collected from a VM with
+
+    ssh -p 2222 root@localhost qjs --bench > new.jsonl
+
+Usage:
+    scripts/qjs_bench_compare.py BASELINE.jsonl NEW.jsonl [--tolerance 0.10]
+
+Prints one row per benchmark: ops/sec, peak heap and GC time, before and
+after. Exits 1 if any benchmark lost more than the tolerance in ops/sec or
+grew its peak heap by more than it, failed to run, or went missing.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            r = json.loads(line)
+            results[r["bench"]] = r
+    return results
+
+
+def main(argv=None):
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("baseline")
+    p.add_argument("new")
+    p.add_argument("--tolerance", type=float, default=0.10,
+                   help="allowed relative loss (default 0.10)")
+    args = p.parse_args(argv)
+
+    base, new = load(args.baseline), load(args.new)
+    failed = False
+    print(f"{'bench':<12} {'ops/s base':>12} {'ops/s new':>12} {'change':>8} "
+          f"{'peak kb':>15} {'gc ms':>15}")
+    for name, b in base.items():
+        n = new.get(name)
+        if n is None or "error" in n:
+            why = n["error"] if n else "missing"
+            print(f"{name:<12} FAIL: {why}")
+            failed = True
+            continue
+        if "error" in b:
+            continue
+        change = n["ops_per_sec"] / b["ops_per_sec"] - 1
+        peak_growth = n["peak_heap_kb"] / max(b["peak_heap_kb"], 1) - 1
+        flags = []
+        if change < -args.tolerance:
+            flags.append("slower")
+        if peak_growth > args.tolerance:
+            flags.append("more memory")
+        failed |= bool(flags)
+        print(f"{name:<12} {b['ops_per_sec']:>12.1f} {n['ops_per_sec']:>12.1f} "
+              f"{change:>+7.1%} {b['peak_heap_kb']:>7}->{n['peak_heap_kb']:<7} "
+              f"{b['gc_ms']:>7.1f}->{n['gc_ms']:<7.1f} {' '.join(flags)}")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -310,6 +310,22 @@ pub const COW_FORK_ENABLED: bool = true;
 /// Set to false to fall back to copy-fork for vfork (clean kill switch).
 pub const VFORK_FASTPATH_ENABLED: bool = true;
 
+/// Syscall-free clocks (docs/TIME_PAGE.md). Sets CNTKCTL_EL1.EL0VCTEN on every
+/// core so EL0 can `mrs cntvct_el0`, and maps a read-only page at
+/// `akuma_exec::timepage::TIME_PAGE_VA` carrying CNTFRQ and the CLOCK_REALTIME
+/// offset into each address space (advertised via `AT_AKUMA_TIMEPAGE`).
+/// libakuma, rumpuser and the qjs clock shims read time from it without
+/// trapping and fall back to the syscall when the auxv entry is absent.
+pub const TIME_PAGE_ENABLED: bool = true;
+
+/// Per-process EL0 counter opt-in (docs/TIME_PAGE.md, "Cycle counter"). When set,
+/// `timer::init` starts the PMUv3 cycle counter and `prctl(PR_AKUMA_EL0_COUNTERS,
+/// mask)` lets a process read `PMCCNTR_EL0` (and `CNTVCT_EL0`, if the time page
+/// has not already opened it to everyone) from EL0. The grant is switched with
+/// the address space (`akuma_exec::el0_counters`); when false the prctl fails
+/// with EINVAL and benchmarks fall back to the time page or the syscall.
+pub const EL0_COUNTERS_PRCTL_ENABLED: bool = true;
+
 /// Eager/lazy threshold for **anonymous private** `mmap` (docs/COW_OPTIMIZATIONS.md,
 /// "lazy/zero-on-demand population").  An anonymous mapping of more than this many
 /// pages is registered as a lazy region and demand-paged (zero-fill on first touch)
@@ -343,6 +359,41 @@ pub const MMAP_EAGER_MAX_PAGES: usize = 16;
 /// that touch *every* mapped page (e.g. fully-read model weights).
 pub const MMAP_FILE_BACKED_LAZY: bool = true;
 
+/// Initial readahead window, in pages, of a file-backed region's first fault
+/// (256 = 1 MB, the old fixed window). Each region then adapts on its own: a
+/// fault at the page just past the previous window doubles it (sequential
+/// reader), a fault elsewhere halves it, down to 16 pages. `madvise` overrides
+/// the policy per region: `MADV_RANDOM` reads one page per fault,
+/// `MADV_SEQUENTIAL` starts at [`MMAP_READAHEAD_MAX_PAGES`].
+pub const MMAP_READAHEAD_PAGES: usize = 256;
+
+/// Ceiling of the adaptive readahead window, in pages (2048 = 8 MB). Every
+/// window is still clamped to `pmm::user_readahead_budget`, so this only sets
+/// how fast a streaming read of a big file (model weights) can go, not how
+/// much memory it may take.
+#[cfg(not(kernel_profile_size))]
+pub const MMAP_READAHEAD_MAX_PAGES: usize = 2048;
+// size/extreme: 1 MB — an 8 MB window is a sizeable share of an 8–64 MB box and
+// just gets reclaimed again.
+#[cfg(kernel_profile_size)]
+pub const MMAP_READAHEAD_MAX_PAGES: usize = 256;
+
+/// Map 2 MB-aligned chunks of large **read-only** file mappings with a single
+/// L2 block entry when the readahead window covers a whole chunk: one
+/// physically contiguous, 2 MB-aligned allocation, one file read, and one TLB
+/// entry instead of 512 (weights for llama.cpp-style inference are read-only
+/// and scanned end to end). Falls back to pages whenever no aligned run is
+/// free, part of the chunk is already mapped, or the region is writable. A
+/// later `munmap`/`mprotect`/`MADV_DONTNEED` of part of the chunk splits the
+/// block back into pages; reclaim evicts it whole.
+///
+/// `false` on the small-RAM profiles, where a free aligned 2 MB run is rare
+/// and a whole block is too coarse a unit to page out.
+#[cfg(not(kernel_profile_size))]
+pub const MMAP_FILE_BLOCKS: bool = true;
+#[cfg(kernel_profile_size)]
+pub const MMAP_FILE_BLOCKS: bool = false;
+
 /// Kernel heap size override, in **MiB**. `0` = auto-size from detected RAM
 /// (see `compute_heap_size` in `src/main.rs`). Set a fixed value to pin the heap
 /// — useful for squeezing onto very small machines or reproducing a layout.
@@ -529,6 +580,11 @@ pub const SYSCALL_DEBUG_NET_ENABLED: bool = false;
 /// to avoid serial floods; increase for quieter traces, decrease (e.g. 512) while debugging.
 pub const EPOLL_ZERO_SAMPLE_INTERVAL: u64 = 64;
 
+/// Safety net for the epoll ready list: a blocked `epoll_pwait` re-marks its whole interest
+/// list this often, so a resource that misses a wake costs latency, not a hang. Each rescan
+/// is O(interest list); `0` disables it (pure O(ready) waits). See `docs/EPOLL_PERFORMANCE.md`.
+pub const EPOLL_RESCAN_INTERVAL_US: u64 = 1_000_000;
+
 /// Option to disable [ext2] debug prints to the kernel log.
 pub const DEBUG_EXT2: bool = false;
 
@@ -9,6 +9,7 @@
 //! 4. Handler returns, registers restored, ERET to EL0
 
 use core::arch::global_asm;
+use core::sync::atomic::{AtomicU64, Ordering};
 
 // Exception vector table with EL0 support
 global_asm!(
@@ -712,33 +713,235 @@ pub fn far_in_kernel_identity_user_range(far: u64) -> bool {
         && a < akuma_exec::mmu::kernel_va_end()
 }
 
+/// Source for emulated zero stores: `copy_to_user_safe` reads from here instead
+/// of a fresh 2 KB stack buffer on every trap.
+static EMU_ZEROS: [u8; 2048] = [0; 2048];
+
+/// Consecutive emulated stores into one page before the next page is pre-faulted.
+/// A memset walking forward through fresh anonymous memory then finds the next
+/// page already mapped and zero instead of taking an EL1 fault on its first store.
+const EMU_STREAK_READAHEAD: u64 = 8;
+
+/// Emulation counters of the address space the current thread runs in (the
+/// thread-group leader's, for CLONE_VM threads), for `/proc/<pid>/emulation`.
+fn emu_stats() -> Option<&'static akuma_exec::process::EmulationStats> {
+    let pid = akuma_exec::process::address_space_owner_pid_for_fault()
+        .or_else(akuma_exec::process::read_current_pid)?;
+    akuma_exec::process::lookup_process(pid).map(|p| &p.emulation)
+}
+
+/// Install a zeroed frame at `page_va` if it is an unpopulated page of an
+/// anonymous lazy region, with the flags the data-abort path would use (a
+/// PROT_NONE reservation is committed RW, as on first touch). `speculative`
+/// leaves PROT_NONE reservations alone. Returns true if the page is now mapped
+/// and all zero because of this call.
+fn prefault_zero_page(page_va: usize, speculative: bool) -> bool {
+    if akuma_exec::mmu::is_current_user_page_mapped(page_va) {
+        return false;
+    }
+    let pid = akuma_exec::process::read_current_pid().unwrap_or(0);
+    let as_owner = akuma_exec::process::address_space_owner_pid_for_fault().unwrap_or(pid);
+    let Some((flags, akuma_exec::process::LazySource::Zero, _, _)) =
+        akuma_exec::process::lazy_region_lookup_for_page_fault(pid, page_va)
+    else {
+        return false;
+    };
+    let map_flags = if akuma_exec::mmu::user_flags::is_none(flags) {
+        if speculative {
+            return false;
+        }
+        akuma_exec::mmu::user_flags::RW_NO_EXEC
+    } else if flags != 0 {
+        flags
+    } else {
+        akuma_exec::mmu::user_flags::RW
+    };
+    let Some(pf) = crate::pmm::alloc_page_zeroed() else { return false };
+    let (tfs, installed) = unsafe { akuma_exec::mmu::map_user_page(page_va, pf.addr, map_flags) };
+    let owner = akuma_exec::process::lookup_process(as_owner);
+    if installed {
+        if let Some(owner) = owner {
+            owner.address_space.track_user_frame(pf);
+            for tf in tfs { owner.address_space.track_page_table_frame(tf); }
+        } else {
+            crate::pmm::free_page(pf);
+            for tf in tfs { crate::pmm::free_page(tf); }
+        }
+    } else {
+        crate::pmm::free_page(pf);
+        if let Some(owner) = owner {
+            for tf in tfs { owner.address_space.track_page_table_frame(tf); }
+        } else {
+            for tf in tfs { crate::pmm::free_page(tf); }
+        }
+    }
+    installed
+}
+
+/// Store `len` (<= 2048) zero bytes at EL0 address `addr` on the process's behalf.
+///
+/// An unpopulated anonymous target page is installed already zeroed, which
+/// makes the store itself redundant. After [`EMU_STREAK_READAHEAD`] stores in a
+/// row into one page, the following page is pre-faulted the same way. `stats` is
+/// the trap's [`emu_stats`], looked up once by the caller.
+fn emulate_zero_store(addr: u64, len: usize, stats: Option<&akuma_exec::process::EmulationStats>) {
+    let page_va = (addr as usize) & !0xFFF;
+    if prefault_zero_page(page_va, false) {
+        if let Some(st) = stats {
+            st.pages_prefaulted.fetch_add(1, Ordering::Relaxed);
+            st.note_page(page_va);
+        }
+        // A block never straddles a page (DC ZVA is aligned, STP is 16 bytes
+        // and only the first page can be new here), so nothing is left to do
+        // unless the store runs into the next page.
+        if (addr as usize & 0xFFF) + len <= 0x1000 {
+            return;
+        }
+    }
+    let _ = unsafe {
+        akuma_exec::mmu::user_access::copy_to_user_safe(addr as *mut u8, EMU_ZEROS.as_ptr(), len)
+    };
+    let Some(st) = stats else { return };
+    st.bytes_zeroed.fetch_add(len as u64, Ordering::Relaxed);
+    if st.note_page(page_va) == EMU_STREAK_READAHEAD && prefault_zero_page(page_va + 0x1000, true) {
+        st.pages_prefaulted.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
 /// Emulate `DC ZVA` for EL0 when QEMU TCG still traps it despite SCTLR_EL1.DZE=1.
 /// Zeros the naturally-aligned block that contains `addr`, using the block size
 /// from DCZID_EL0.BS (4 << BS bytes, typically 64).
-pub fn emulate_dc_zva(addr: u64) {
+pub fn emulate_dc_zva(addr: u64, stats: Option<&akuma_exec::process::EmulationStats>) {
     let dczid: u64;
     unsafe { core::arch::asm!("mrs {}, dczid_el0", out(reg) dczid); }
     // Bit 4 (DZP) set means DC ZVA is prohibited; skip silently.
     if dczid & (1 << 4) != 0 { return; }
     let bs = (dczid & 0xF) as u32;
-    // block_size = 4 << BS; cap at 2048 to bound the stack frame.
-    let block_size = (4usize << bs).min(2048);
+    // block_size = 4 << BS; cap at 2048 (the size of EMU_ZEROS).
+    let block_size = (4usize << bs).min(EMU_ZEROS.len());
     let aligned_addr = addr & !(block_size as u64 - 1);
-    let zeros = [0u8; 2048];
-    let _ = unsafe {
-        akuma_exec::mmu::user_access::copy_to_user_safe(
-            aligned_addr as *mut u8, zeros.as_ptr(), block_size)
-    };
+    emulate_zero_store(aligned_addr, block_size, stats);
 }
 
 /// Emulate `stp xzr, xzr, [Xn, #imm7*8]` for EL0 when QEMU TCG misroutes it as EC=0x15.
-/// Writes 16 zero bytes to `addr`.
-fn emulate_stp_xzr_xzr(addr: u64) {
-    let zeros = [0u8; 16];
-    let _ = unsafe {
-        akuma_exec::mmu::user_access::copy_to_user_safe(
-            addr as *mut u8, zeros.as_ptr(), 16)
+/// Writes 16 zero bytes to `addr`, demand-paging a PROT_NONE lazy target first.
+fn emulate_stp_xzr_xzr(addr: u64, stats: Option<&akuma_exec::process::EmulationStats>) {
+    emulate_zero_store(addr, 16, stats);
+}
+
+/// An instruction at ELR that QEMU TCG may deliver as EC=0x15 (SVC).
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Misroute {
+    /// `dc zva, Xt`
+    DcZva { xt: u8 },
+    /// `stp xzr, xzr, [Xn, #offset]`
+    StpXzr { rn: u8, offset: i16 },
+}
+
+impl Misroute {
+    fn decode(instr: u32) -> Option<Self> {
+        if (instr & !0x1F) == 0xD50B_7420 {
+            return Some(Misroute::DcZva { xt: (instr & 0x1F) as u8 });
+        }
+        decode_stp_xzr_xzr(instr).map(|(rn, offset)| Misroute::StpXzr { rn: rn as u8, offset: offset as i16 })
+    }
+
+    /// As stored in a [`DecodeEntry`]; 0 is "not a misroute".
+    fn pack(op: Option<Self>) -> u64 {
+        match op {
+            None => 0,
+            Some(Misroute::DcZva { xt }) => 1 | u64::from(xt) << 8,
+            Some(Misroute::StpXzr { rn, offset }) => 2 | u64::from(rn) << 8 | u64::from(offset as u16) << 16,
+        }
+    }
+
+    fn unpack(v: u64) -> Option<Self> {
+        match v & 0xFF {
+            1 => Some(Misroute::DcZva { xt: (v >> 8) as u8 }),
+            2 => Some(Misroute::StpXzr { rn: (v >> 8) as u8, offset: (v >> 16) as u16 as i16 }),
+            _ => None,
+        }
+    }
+}
+
+fn read_user_u32(va: u64) -> Option<u32> {
+    let mut buf = [0u8; 4];
+    unsafe { akuma_exec::mmu::user_access::copy_from_user_safe(buf.as_mut_ptr(), va as *const u8, 4).ok() }
+        .map(|()| u32::from_le_bytes(buf))
+}
+
+/// The words at `elr - 4` and `elr`, as `prev | cur << 32`. One user copy when
+/// both are in ELR's page; when ELR starts a page, the word before it is read
+/// separately, and only if `cur` is a candidate (0 if it cannot be read).
+fn read_misroute_window(elr: u64) -> Option<u64> {
+    if elr & 0xFFF >= 4 {
+        let mut buf = [0u8; 8];
+        return unsafe {
+            akuma_exec::mmu::user_access::copy_from_user_safe(buf.as_mut_ptr(), (elr - 4) as *const u8, 8).ok()
+        }
+        .map(|()| u64::from_le_bytes(buf));
+    }
+    let cur = read_user_u32(elr)?;
+    let prev = if Misroute::decode(cur).is_some() {
+        elr.checked_sub(4).and_then(read_user_u32).unwrap_or(0)
+    } else {
+        0
     };
+    Some(u64::from(prev) | u64::from(cur) << 32)
+}
+
+/// One recently checked misroute candidate: the words at `pc - 4` and `pc` in
+/// the address space `ttbr0`, and the [`Misroute::pack`]ed decision they gave.
+struct DecodeEntry {
+    ttbr0: AtomicU64,
+    pc: AtomicU64,
+    words: AtomicU64,
+    op: AtomicU64,
+}
+
+impl DecodeEntry {
+    const fn new() -> Self {
+        Self { ttbr0: AtomicU64::new(0), pc: AtomicU64::new(0), words: AtomicU64::new(0), op: AtomicU64::new(0) }
+    }
+}
+
+const DECODE_CACHE_SIZE: usize = 16;
+
+/// Per CPU, direct-mapped by PC: a memset loop traps on the same one or two
+/// PCs millions of times. A slot is only touched by its own core with IRQs
+/// masked, so there is no lock. The key is (TTBR0, PC), but a hit also needs
+/// both words to be unchanged: code can be rewritten or remapped under the
+/// same key, and replaying a stale decision would skip a real syscall.
+static DECODE_CACHE: [[DecodeEntry; DECODE_CACHE_SIZE]; akuma_exec::threading::MAX_CPUS] =
+    [const { [const { DecodeEntry::new() }; DECODE_CACHE_SIZE] }; akuma_exec::threading::MAX_CPUS];
+
+/// The misrouted instruction at `elr` to emulate, if this EC=0x15 is one:
+/// the word at ELR decodes as DC ZVA or STP XZR and the word before it is not
+/// an SVC. Any other word at ELR (every real syscall) returns before the
+/// [`DECODE_CACHE`] lookup.
+fn misrouted_instr_at(elr: u64) -> Option<Misroute> {
+    let words = read_misroute_window(elr)?;
+    let cur = (words >> 32) as u32;
+    if (cur & !0x1F) != 0xD50B_7420 && (cur & 0xFFC0_7C1F) != 0xA900_7C1F {
+        return None;
+    }
+    let ttbr0 = akuma_exec::mmu::get_current_ttbr0() as u64;
+    akuma_exec::runtime::with_irqs_disabled(|| {
+        let e = &DECODE_CACHE[akuma_exec::threading::current_cpu()][((elr >> 2) as usize) % DECODE_CACHE_SIZE];
+        if e.pc.load(Ordering::Relaxed) == elr
+            && e.ttbr0.load(Ordering::Relaxed) == ttbr0
+            && e.words.load(Ordering::Relaxed) == words
+        {
+            return Misroute::unpack(e.op.load(Ordering::Relaxed));
+        }
+        let after_svc = (words as u32 & 0xFFE0_001F) == 0xD400_0001;
+        let op = Misroute::decode(cur).filter(|_| !after_svc);
+        e.ttbr0.store(ttbr0, Ordering::Relaxed);
+        e.pc.store(elr, Ordering::Relaxed);
+        e.words.store(words, Ordering::Relaxed);
+        e.op.store(Misroute::pack(op), Ordering::Relaxed);
+        op
+    })
 }
 
 /// Decode `stp xzr, xzr, [Xn, #imm7*8]` signed-offset form.
@@ -2203,103 +2406,47 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
             // ELR by 4, and return the goroutine's original x0 unchanged so that
             // x0 (the zero-target address) is never overwritten with a syscall
             // return value — which would crash the goroutine when it resumes DC ZVA.
+            //
+            // QEMU-STP-XZR-MISROUTING: the same for `stp xzr, xzr, [Xn, #N]` when Xn
+            // points into a PROT_NONE lazy region (Go's sysReserve arena), which
+            // should have been EC=0x25. Pattern 4 in GO_FORKTEST_DEBUG.md (crush,
+            // crash36.log).
+            //
+            // Both are recognised by `misrouted_instr_at`: one user copy of the
+            // words at ELR-4 and ELR for every SVC, and a per-CPU decode cache
+            // for the candidates. Per-process counts are in /proc/<pid>/emulation.
             {
                 let elr = frame_ref.elr_el1;
-                let elr_instr = {
-                    let mut buf = [0u8; 4];
-                    unsafe {
-                        akuma_exec::mmu::user_access::copy_from_user_safe(
-                            buf.as_mut_ptr(), elr as *const u8, 4)
-                        .ok()
-                    }.map(|()| u32::from_le_bytes(buf))
-                };
-                if elr_instr.is_some_and(|i| (i & !0x1F) == 0xD50B7420) {
-                    let prev_instr = elr.checked_sub(4).and_then(|prev| {
-                        let mut buf = [0u8; 4];
-                        unsafe {
-                            akuma_exec::mmu::user_access::copy_from_user_safe(
-                                buf.as_mut_ptr(), prev as *const u8, 4)
-                            .ok()
-                        }.map(|()| u32::from_le_bytes(buf))
-                    });
-                    let prev_is_svc = prev_instr
-                        .is_some_and(|i| (i & 0xFFE0001F) == 0xD4000001);
-                    if !prev_is_svc {
-                        // Misrouted DC ZVA: decode Xt register and emulate.
-                        let xt = (elr_instr.unwrap_or(0) & 0x1F) as usize;
+                let op = misrouted_instr_at(elr);
+                let stats = if op.is_some() { emu_stats() } else { None };
+                match op {
+                    Some(Misroute::DcZva { xt }) => {
+                        // Misrouted DC ZVA: emulate on the address in Xt.
+                        let xt = xt as usize;
                         let dc_addr = if xt < 31 {
                             unsafe { core::ptr::read_volatile((frame as *const u64).add(xt)) }
                         } else { 0 };
-                        emulate_dc_zva(dc_addr);
+                        emulate_dc_zva(dc_addr, stats);
                         crate::syscall::syscall_counters::inc_qemu_dc_zva_ec15();
+                        if let Some(st) = stats { st.inc(akuma_exec::process::EmuClass::DcZvaMisrouted); }
                         unsafe { (*frame).elr_el1 = elr.wrapping_add(4); }
                         return unsafe { (*frame).x0 };
                     }
-                }
-            }
-
-            // QEMU-STP-XZR-MISROUTING: QEMU TCG sometimes generates EC=0x15 (SVC)
-            // instead of EC=0x25 (data abort) for `stp xzr, xzr, [Xn, #N]` when Xn
-            // points into a PROT_NONE lazy region (Go's sysReserve arena). Same class
-            // as the DC ZVA misrouting above but for a different instruction.
-            // Pattern 4 in GO_FORKTEST_DEBUG.md (crush, crash36.log).
-            {
-                let elr = frame_ref.elr_el1;
-                let elr_instr = {
-                    let mut buf = [0u8; 4];
-                    unsafe {
-                        akuma_exec::mmu::user_access::copy_from_user_safe(
-                            buf.as_mut_ptr(), elr as *const u8, 4)
-                        .ok()
-                    }.map(|()| u32::from_le_bytes(buf))
-                };
-                if let Some((rn, offset)) = elr_instr.and_then(decode_stp_xzr_xzr) {
-                    let prev_instr = elr.checked_sub(4).and_then(|prev| {
-                        let mut buf = [0u8; 4];
-                        unsafe {
-                            akuma_exec::mmu::user_access::copy_from_user_safe(
-                                buf.as_mut_ptr(), prev as *const u8, 4)
-                            .ok()
-                        }.map(|()| u32::from_le_bytes(buf))
-                    });
-                    let prev_is_svc = prev_instr
-                        .is_some_and(|i| (i & 0xFFE0001F) == 0xD4000001);
-                    if !prev_is_svc {
+                    Some(Misroute::StpXzr { rn, offset }) => {
+                        // Misrouted STP XZR: demand-page a PROT_NONE lazy target
+                        // and store the 16 zero bytes.
+                        let rn = rn as usize;
                         let base = if rn < 31 {
                             unsafe { core::ptr::read_volatile((frame as *const u64).add(rn)) }
                         } else { 0 };
-                        let store_va = (base as i64).wrapping_add(offset) as u64;
-                        let page_va = (store_va as usize) & !0xFFF;
-                        // Demand-page if target is in a PROT_NONE lazy region.
-                        let pid = akuma_exec::process::read_current_pid().unwrap_or(0);
-                        let as_owner = akuma_exec::process::address_space_owner_pid_for_fault().unwrap_or(pid);
-                        if akuma_exec::process::lazy_region_lookup_for_page_fault(pid, store_va as usize).is_some()
-                            && let Some(pf) = crate::pmm::alloc_page_zeroed() {
-                                let (tfs, installed) = unsafe {
-                                    akuma_exec::mmu::map_user_page(page_va, pf.addr, akuma_exec::mmu::user_flags::RW_NO_EXEC)
-                                };
-                                if installed {
-                                    if let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
-                                        owner.address_space.track_user_frame(pf);
-                                        for tf in tfs { owner.address_space.track_page_table_frame(tf); }
-                                    } else {
-                                        crate::pmm::free_page(pf);
-                                        for tf in tfs { crate::pmm::free_page(tf); }
-                                    }
-                                } else {
-                                    crate::pmm::free_page(pf);
-                                    if let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
-                                        for tf in tfs { owner.address_space.track_page_table_frame(tf); }
-                                    } else {
-                                        for tf in tfs { crate::pmm::free_page(tf); }
-                                    }
-                                }
-                            }
-                        emulate_stp_xzr_xzr(store_va);
+                        let store_va = (base as i64).wrapping_add(i64::from(offset)) as u64;
+                        emulate_stp_xzr_xzr(store_va, stats);
                         crate::syscall::syscall_counters::inc_qemu_stp_xzr_ec15();
+                        if let Some(st) = stats { st.inc(akuma_exec::process::EmuClass::StpXzrMisrouted); }
                         unsafe { (*frame).elr_el1 = elr.wrapping_add(4); }
                         return unsafe { (*frame).x0 };
                     }
+                    None => {}
                 }
             }
 
@@ -2549,6 +2696,10 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
                                 }
                                 crate::pmm::dp_count(&crate::pmm::DP_PROTNONE_PAGES, 1);
                                 crate::syscall::syscall_counters::inc_pagefault(1);
+                                if crate::config::PROCESS_SYSCALL_STATS
+                                    && let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
+                                        owner.syscall_stats.inc_pagefault(1);
+                                    }
                             } else {
                                 // Race: another CPU already mapped this page.
                                 crate::pmm::free_page(page_frame);
@@ -2594,169 +2745,35 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
                     let is_exec = (map_flags & akuma_exec::mmu::flags::UXN) == 0;
 
                     if let akuma_exec::process::LazySource::File { ref path, inode, file_offset, filesz, segment_va } = source {
-                        const READAHEAD_PAGES: usize = 256;
+                        // Adaptive per-region window (MMAP_READAHEAD_PAGES to
+                        // MMAP_READAHEAD_MAX_PAGES, or per madvise), clamped to the
+                        // region and, when 2 MB blocks apply, to a block boundary.
                         let region_end = region_start + region_size;
-                        let ra_end = core::cmp::min(page_va + READAHEAD_PAGES * 0x1000, region_end);
-
-                        // Count how many pages actually need allocation (skip mapped)
-                        let mut needed = 0usize;
-                        {
-                            let mut va = page_va;
-                            while va < ra_end {
-                                if !akuma_exec::mmu::is_current_user_page_mapped(va) {
-                                    needed += 1;
-                                }
-                                va += 0x1000;
-                            }
-                        }
-
-                        // Clamp the readahead batch so file-backed demand paging never
-                        // drains the PMM below USER_PAGE_RESERVE — the same floor the
-                        // anonymous path respects via alloc_page_zeroed_user(). Without
-                        // this an mmap larger than RAM drains PMM to 0, and a later
-                        // kernel-side alloc (IRQ/scheduler, no current process) panics
-                        // into a whole-kernel brk #1 abort instead of SIGSEGV-ing the
-                        // offending process. When the budget hits 0 (free <= reserve)
-                        // nothing maps and we fall through to the single-page fallback
-                        // below (alloc_page_zeroed_user -> None -> SIGSEGV).
-                        let needed = needed.min(crate::pmm::user_readahead_budget(crate::pmm::free_count()));
-
-                        // Batch-allocate all needed frames in one lock acquisition
-                        let frame_pool = if needed > 0 {
-                            crate::pmm::alloc_pages_zeroed(needed).unwrap_or_else(|| {
-                                // Fallback: allocate what we can one at a time, still
-                                // honouring the reserve so we can't starve the kernel.
-                                let mut v = alloc::vec::Vec::new();
-                                for _ in 0..needed {
-                                    match crate::pmm::alloc_page_zeroed_user() {
-                                        Some(f) => v.push(f),
-                                        None => break,
-                                    }
-                                }
-                                v
-                            })
-                        } else {
-                            alloc::vec::Vec::new()
-                        };
-                        let mut pool_idx = 0usize;
-
-                        let mut any_mapped = false;
-                        let mut pages_mapped = 0u64;
-                        let mut cur_va = page_va;
-                        while cur_va < ra_end {
-                            if akuma_exec::mmu::is_current_user_page_mapped(cur_va) {
-                                cur_va += 0x1000;
-                                continue;
-                            }
-                            if pool_idx >= frame_pool.len() {
-                                break;
-                            }
-                            let pf = frame_pool[pool_idx];
-                            pool_idx += 1;
-
-                            {
-                                let pg_data_start = core::cmp::max(cur_va, segment_va);
-                                let pg_data_end = core::cmp::min(cur_va + 0x1000, segment_va + filesz);
-                                if pg_data_start < pg_data_end {
-                                    let dst_off = pg_data_start - cur_va;
-                                    let file_off = file_offset + (pg_data_start - segment_va);
-                                    let len = pg_data_end - pg_data_start;
-                                    let page_ptr = akuma_exec::mmu::phys_to_virt(pf.addr);
-                                    let page_buf = unsafe {
-                                        core::slice::from_raw_parts_mut(page_ptr.cast::<u8>().add(dst_off), len)
-                                    };
-                                    if inode != 0 {
-                                        let _ = crate::vfs::read_at_by_inode(path, inode, file_off, page_buf);
-                                    } else {
-                                        let _ = crate::vfs::read_at(path, file_off, page_buf);
-                                    }
-                                }
-                            }
-
-                                if is_exec {
-                                    let kva = akuma_exec::mmu::phys_to_virt(pf.addr) as usize;
-                                    for off in (0..0x1000_usize).step_by(64) {
-                                        unsafe { core::arch::asm!("dc cvau, {}", in(reg) kva + off); }
-                                    }
-                                    unsafe { core::arch::asm!("dsb ish"); }
-                                    for off in (0..0x1000_usize).step_by(64) {
-                                        // IC IVAU by the kernel VA (kva), not the user VA: the
-                                        // user page is not mapped yet at this point (map happens
-                                        // below), so an IC IVAU on cur_va translation-faults on
-                                        // real hardware / HVF. I-cache invalidation to PoU is by
-                                        // physical address, so the kva alias of the same frame is
-                                        // equivalent and always mapped.
-                                        unsafe { core::arch::asm!("ic ivau, {}", in(reg) kva + off); }
-                                    }
-                                }
-
-                                // Use no_flush variant — we batch the TLB invalidation
-                                // after the loop with a single flush_tlb_range call.
-                                let (table_frames, installed) = unsafe {
-                                    akuma_exec::mmu::map_user_page_no_flush(cur_va, pf.addr, map_flags)
-                                };
-                                if installed {
-                                    if let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
-                                        owner.address_space.track_user_frame(pf);
-                                        for tf in table_frames {
-                                            owner.address_space.track_page_table_frame(tf);
-                                        }
-                                    } else {
-                                        crate::pmm::free_page(pf);
-                                        for tf in table_frames { crate::pmm::free_page(tf); }
-                                    }
-                                    any_mapped = true;
-                                    pages_mapped += 1;
-                                } else {
-                                    // Race: another CPU mapped this page between our check and
-                                    // the atomic install. The page IS mapped now - don't SIGSEGV!
-                                    crate::pmm::free_page(pf);
-                                    if let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
-                                        for tf in table_frames {
-                                            owner.address_space.track_page_table_frame(tf);
-                                        }
-                                    } else {
-                                        for tf in table_frames { crate::pmm::free_page(tf); }
-                                    }
-                                    // Critical: if this is the faulting page, it's now mapped!
-                                    if cur_va == page_va {
-                                        any_mapped = true;
-                                    }
-                                }
-                            cur_va += 0x1000;
-                        }
-
-                        // Flush TLB for the entire readahead range in one shot.
-                        // This replaces N individual (dsb+tlbi+dsb+isb) sequences with
-                        // a single flush_tlb_range call — ~100x fewer barriers for 256 pages.
-                        if any_mapped {
-                            akuma_exec::mmu::flush_tlb_range(page_va, pages_mapped as usize);
-                        }
-
-                        // Return unused frames from the batch back to PMM
-                        while pool_idx < frame_pool.len() {
-                            crate::pmm::free_page(frame_pool[pool_idx]);
-                            pool_idx += 1;
-                        }
-
-                        if is_exec {
-                            unsafe {
-                                core::arch::asm!("dsb ish");
-                                core::arch::asm!("isb");
-                            }
-                        }
-
-                        if any_mapped {
-                            crate::pmm::dp_count(&crate::pmm::DP_FILE_PAGES, pages_mapped as usize);
+                        let window = akuma_exec::process::lazy_region_readahead(pid, page_va,
+                            crate::config::MMAP_READAHEAD_PAGES, crate::config::MMAP_READAHEAD_MAX_PAGES);
+                        let ra_end = crate::syscall::mem::file_window_end(page_va,
+                            core::cmp::min(page_va + window * 0x1000, region_end), region_end, map_flags);
+
+                        // Batched read + map of the window, clamped to the user
+                        // readahead budget so an mmap larger than RAM SIGSEGVs the
+                        // process instead of draining the PMM (see fill_file_pages).
+                        // When the budget hits 0 nothing maps and we fall through to
+                        // the single-page fallback below (alloc_page_zeroed_user ->
+                        // None -> SIGSEGV).
+                        let (mapped, faulting_mapped) = crate::syscall::mem::fill_file_range(
+                            as_owner, &source, map_flags, is_exec, page_va, ra_end);
+                        let pages_mapped = mapped as u64;
+
+                        if pages_mapped > 0 {
+                            crate::pmm::dp_count(&crate::pmm::DP_FILE_PAGES, mapped);
                             crate::syscall::syscall_counters::inc_pagefault(pages_mapped);
                             if crate::config::PROCESS_SYSCALL_STATS
                                 && let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
                                     owner.syscall_stats.inc_pagefault(pages_mapped);
                                 }
-                            return unsafe { (*frame).x0 };
-                        } else if akuma_exec::mmu::is_current_user_page_mapped(page_va) {
-                            // Race: another CPU mapped the faulting page while we were doing
-                            // readahead. The page is now present — return success.
+                        }
+                        if faulting_mapped || akuma_exec::mmu::is_current_user_page_mapped(page_va) {
+                            // Mapped by us, or by another CPU racing our readahead.
                             return unsafe { (*frame).x0 };
                         }
                         // Readahead pool was exhausted before reaching page_va.
@@ -2820,6 +2837,10 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
                             }
                             crate::pmm::dp_count(&crate::pmm::DP_FILE_PAGES, 1);
                             crate::syscall::syscall_counters::inc_pagefault(1);
+                            if crate::config::PROCESS_SYSCALL_STATS
+                                && let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
+                                    owner.syscall_stats.inc_pagefault(1);
+                                }
                             return unsafe { (*frame).x0 };
                         }
                         let (_, _, free2) = crate::pmm::stats();
@@ -3118,149 +3139,31 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
                     if let akuma_exec::process::LazySource::File { ref path, inode, file_offset, filesz, segment_va } = source {
                         crate::tprint!(256, "[IA-DP] file region: fault_va={:#x} seg_va={:#x} filesz={:#x} file_off={:#x}\n",
                             far_usize, segment_va, filesz, file_offset);
-                        const READAHEAD_PAGES: usize = 256;
                         let region_end = region_start + region_size;
-                        let ra_end = core::cmp::min(page_va + READAHEAD_PAGES * 0x1000, region_end);
-
-                        // Count needed pages then batch-allocate (single PMM lock).
-                        let mut needed = 0usize;
-                        {
-                            let mut va = page_va;
-                            while va < ra_end {
-                                if !akuma_exec::mmu::is_current_user_page_mapped(va) {
-                                    needed += 1;
-                                }
-                                va += 0x1000;
-                            }
-                        }
-                        // Clamp the readahead batch to the kernel reserve — see the
-                        // matching comment in the data-abort path. A file-backed exec
-                        // mapping larger than RAM must SIGSEGV the process, not drain
-                        // the PMM to 0 and panic the kernel from a background alloc.
-                        let needed = needed.min(crate::pmm::user_readahead_budget(crate::pmm::free_count()));
-
-                        let ia_frame_pool = if needed > 0 {
-                            crate::pmm::alloc_pages_zeroed(needed).unwrap_or_else(|| {
-                                let mut v = alloc::vec::Vec::new();
-                                for _ in 0..needed {
-                                    match crate::pmm::alloc_page_zeroed_user() {
-                                        Some(f) => v.push(f),
-                                        None => break,
-                                    }
-                                }
-                                v
-                            })
-                        } else {
-                            alloc::vec::Vec::new()
-                        };
-                        let mut ia_pool_idx = 0usize;
-
-                        let mut any_mapped = false;
-                        let mut pages_mapped = 0u64;
-                        let mut cur_va = page_va;
-                        while cur_va < ra_end {
-                            if akuma_exec::mmu::is_current_user_page_mapped(cur_va) {
-                                cur_va += 0x1000;
-                                continue;
-                            }
-                            if ia_pool_idx >= ia_frame_pool.len() {
-                                break;
-                            }
-                            let pf = ia_frame_pool[ia_pool_idx];
-                            ia_pool_idx += 1;
-                            if true {
-                                let pg_data_start = core::cmp::max(cur_va, segment_va);
-                                let pg_data_end = core::cmp::min(cur_va + 0x1000, segment_va + filesz);
-                                if pg_data_start < pg_data_end {
-                                    let dst_off = pg_data_start - cur_va;
-                                    let file_off = file_offset + (pg_data_start - segment_va);
-                                    let len = pg_data_end - pg_data_start;
-                                    let page_ptr = akuma_exec::mmu::phys_to_virt(pf.addr);
-                                    let page_buf = unsafe {
-                                        core::slice::from_raw_parts_mut(page_ptr.cast::<u8>().add(dst_off), len)
-                                    };
-                                    if inode != 0 {
-                                        let _ = crate::vfs::read_at_by_inode(path, inode, file_off, page_buf);
-                                    } else {
-                                        let _ = crate::vfs::read_at(path, file_off, page_buf);
-                                    }
-                                }
-
-                                let kva = akuma_exec::mmu::phys_to_virt(pf.addr) as usize;
-                                for off in (0..0x1000_usize).step_by(64) {
-                                    unsafe { core::arch::asm!("dc cvau, {}", in(reg) kva + off); }
-                                }
-                                unsafe { core::arch::asm!("dsb ish"); }
-                                for off in (0..0x1000_usize).step_by(64) {
-                                    // IC IVAU by kva, not the user VA — the page isn't mapped yet
-                                    // (see note at the other demand-paging sites); on HVF an IC
-                                    // IVAU on cur_va would translation-fault.
-                                    unsafe { core::arch::asm!("ic ivau, {}", in(reg) kva + off); }
-                                }
-
-                                // Use no_flush — TLB batched after the loop.
-                                let (table_frames, installed) = unsafe {
-                                    akuma_exec::mmu::map_user_page_no_flush(cur_va, pf.addr, map_flags)
-                                };
-                                if installed {
-                                    if let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
-                                        owner.address_space.track_user_frame(pf);
-                                        for tf in table_frames {
-                                            owner.address_space.track_page_table_frame(tf);
-                                        }
-                                    } else {
-                                        crate::pmm::free_page(pf);
-                                        for tf in table_frames { crate::pmm::free_page(tf); }
-                                    }
-                                    any_mapped = true;
-                                    pages_mapped += 1;
-                                } else {
-                                    // Race: another CPU mapped this page between our check and
-                                    // the atomic install. The page IS mapped now - don't SIGSEGV!
-                                    // We just need to free our unused page and track table frames.
-                                    crate::pmm::free_page(pf);
-                                    if let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
-                                        for tf in table_frames {
-                                            owner.address_space.track_page_table_frame(tf);
-                                        }
-                                    } else {
-                                        for tf in table_frames { crate::pmm::free_page(tf); }
-                                    }
-                                    // Critical: if this is the faulting page, it's now mapped!
-                                    if cur_va == page_va {
-                                        any_mapped = true;
-                                    }
-                                }
-                            } // end if true (batch pool entry)
-                            cur_va += 0x1000;
-                        }
-
-                        // Return unused frames from the batch pool back to PMM.
-                        while ia_pool_idx < ia_frame_pool.len() {
-                            crate::pmm::free_page(ia_frame_pool[ia_pool_idx]);
-                            ia_pool_idx += 1;
-                        }
-
-                        // Single TLB flush for the entire readahead window.
-                        if any_mapped {
-                            akuma_exec::mmu::flush_tlb_range(page_va, pages_mapped as usize);
-                        }
-
-                        unsafe {
-                            core::arch::asm!("dsb ish");
-                            core::arch::asm!("isb");
-                        }
-
-                        if any_mapped {
-                            crate::pmm::dp_count(&crate::pmm::DP_FILE_PAGES, pages_mapped as usize);
+                        let window = akuma_exec::process::lazy_region_readahead(pid, page_va,
+                            crate::config::MMAP_READAHEAD_PAGES, crate::config::MMAP_READAHEAD_MAX_PAGES);
+                        let ra_end = crate::syscall::mem::file_window_end(page_va,
+                            core::cmp::min(page_va + window * 0x1000, region_end), region_end, map_flags);
+
+                        // Batched read + map of the window with I-cache maintenance,
+                        // clamped to the user readahead budget — see the data-abort
+                        // path. A file-backed exec mapping larger than RAM must
+                        // SIGSEGV the process, not drain the PMM to 0 and panic the
+                        // kernel from a background alloc.
+                        let (mapped, faulting_mapped) = crate::syscall::mem::fill_file_range(
+                            as_owner, &source, map_flags, true, page_va, ra_end);
+                        let pages_mapped = mapped as u64;
+
+                        if pages_mapped > 0 {
+                            crate::pmm::dp_count(&crate::pmm::DP_FILE_PAGES, mapped);
                             crate::syscall::syscall_counters::inc_pagefault(pages_mapped);
                             if crate::config::PROCESS_SYSCALL_STATS
                                 && let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
                                     owner.syscall_stats.inc_pagefault(pages_mapped);
                                 }
-                            return unsafe { (*frame).x0 };
-                        } else if akuma_exec::mmu::is_current_user_page_mapped(page_va) {
-                            // Race: another CPU mapped the faulting page — return success.
+                        }
+                        if faulting_mapped || akuma_exec::mmu::is_current_user_page_mapped(page_va) {
+                            // Mapped by us, or by another CPU racing our readahead.
                             return unsafe { (*frame).x0 };
                         }
                         // Readahead pool exhausted before reaching page_va.
@@ -3318,6 +3221,10 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
                             unsafe { core::arch::asm!("dsb ish"); core::arch::asm!("isb"); }
                             crate::pmm::dp_count(&crate::pmm::DP_FILE_PAGES, 1);
                             crate::syscall::syscall_counters::inc_pagefault(1);
+                            if crate::config::PROCESS_SYSCALL_STATS
+                                && let Some(owner) = akuma_exec::process::lookup_process(as_owner) {
+                                    owner.syscall_stats.inc_pagefault(1);
+                                }
                             return unsafe { (*frame).x0 };
                         }
                         let (_, _, free2) = crate::pmm::stats();
@@ -3447,7 +3354,9 @@ extern "C" fn rust_sync_el0_handler(frame: *mut UserTrapFrame) -> u64 {
                     } else if op1 == 3 && crm == 5 && op2 == 1 {
                         unsafe { core::arch::asm!("ic ivau, {}", in(reg) addr); }
                     } else if op1 == 3 && crm == 4 && op2 == 1 {
-                        emulate_dc_zva(addr);
+                        let stats = emu_stats();
+                        emulate_dc_zva(addr, stats);
+                        if let Some(st) = stats { st.inc(akuma_exec::process::EmuClass::DcZvaTrapped); }
                     }
                 }
             }
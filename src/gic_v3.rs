@@ -9,12 +9,14 @@
 //! - **SGIs and PPIs** (INTID 0-31) are configured per-PE in the **redistributor**
 //!   (GICR) rather than the distributor (GICD).
 //!
-//! Akuma uses only SGI 0 (scheduler) and PPIs 27/30 (EL1 virtual/physical timer),
-//! so the distributor needs only its global control register and no SPI routing
-//! (`GICD_IROUTER`) is programmed.
+//! Akuma uses SGI 0 (scheduler), PPIs 27/30 (EL1 virtual/physical timer) and,
+//! under the `rump` feature, the SPI of the tap NIC. [`enable_irq`] configures an
+//! SPI on demand in the distributor (Group 1, priority, routed to CPU0 via
+//! `GICD_IROUTER`); everything else lives in the redistributor.
 //!
 //! Register frames (QEMU `virt`, confirmed from the generated DTB):
-//! - GICD at PA `0x0800_0000` (mapped at [`mmu::DEV_GIC_DIST_VA`])
+//! - GICD at PA `0x0800_0000` (mapped at [`mmu::DEV_GIC_DIST_VA`]); its
+//!   `GICD_IROUTER` page at `0x0800_6000` ([`mmu::DEV_GICD_IROUTER_VA`])
 //! - GICR base at PA `0x080A_0000`; CPU0 RD_base frame `0x080A_0000`
 //!   ([`mmu::DEV_GICR_RD_VA`]) and SGI_base frame `0x080B_0000`
 //!   ([`mmu::DEV_GICR_SGI_VA`]).
@@ -24,6 +26,16 @@ use akuma_exec::mmu;
 // --- GICD (distributor) MMIO register offsets ---
 mod gicd {
     pub const CTLR: usize = 0x0000; // Distributor Control Register
+    pub const IGROUPR: usize = 0x0080; // Interrupt Group Registers (1 bit per INTID)
+    pub const ISENABLER: usize = 0x0100; // Interrupt Set-Enable Registers
+    pub const IPRIORITYR: usize = 0x0400; // Interrupt Priority (1 byte per INTID)
+}
+
+/// GICD_IROUTER<n> (64 bits per INTID, from offset 0x6000) sits in its own
+/// distributor page, mapped separately at [`mmu::DEV_GICD_IROUTER_VA`].
+#[inline]
+fn gicd_irouter(irq: u32) -> usize {
+    mmu::DEV_GICD_IROUTER_VA + irq as usize * 8
 }
 
 // GICD_CTLR bits, with Security disabled (DS=1), as QEMU `virt` presents.
@@ -182,7 +194,9 @@ pub fn init() {
 }
 
 /// Enable a specific IRQ. SGIs/PPIs (INTID < 32) live in this PE's
-/// redistributor; SPIs (>= 32) would use the distributor (unused by Akuma).
+/// redistributor; an SPI (>= 32) is set up in the distributor first: Group 1
+/// (reset is Group 0, which IGRPEN1 does not signal), the same mid priority as
+/// the SGIs/PPIs, and routed to CPU0 (affinity 0.0.0.0; reset is UNKNOWN).
 pub fn enable_irq(irq: u32) {
     if irq >= 1020 {
         return; // Invalid / special INTID
@@ -191,12 +205,21 @@ pub fn enable_irq(irq: u32) {
         // GICR SGI_base frame, device-mapped for CPU0.
         mmio_w32(gicr_sgi(gicr_sgi::ISENABLER0), 1u32 << irq);
     } else {
-        // SPI: GICD_ISENABLER<n> at 0x100 + (irq/32)*4 (best effort; Akuma uses
-        // no SPIs, and affinity routing via GICD_IROUTER is not programmed).
-        const GICD_ISENABLER: usize = 0x0100;
-        let off = GICD_ISENABLER + ((irq / 32) as usize) * 4;
+        let word = ((irq / 32) as usize) * 4;
         let bit = 1u32 << (irq % 32);
-        mmio_w32(gicd(off), bit);
+        let group = gicd(gicd::IGROUPR + word);
+        mmio_w32(group, mmio_r32(group) | bit);
+        let prio = gicd(gicd::IPRIORITYR + (irq as usize & !3));
+        let shift = (irq % 4) * 8;
+        mmio_w32(prio, (mmio_r32(prio) & !(0xFF << shift)) | (0xA0 << shift));
+        // 64-bit register as two 32-bit halves: Aff2.Aff1.Aff0 = 0, IRM = 0; Aff3 = 0.
+        // Only INTIDs < 512 fall in the mapped IROUTER page (QEMU virt has 256).
+        if irq < 512 {
+            let route = gicd_irouter(irq);
+            mmio_w32(route, 0);
+            mmio_w32(route + 4, 0);
+        }
+        mmio_w32(gicd(gicd::ISENABLER + word), bit);
     }
     dsb_ish();
 }
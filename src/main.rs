@@ -441,10 +441,22 @@ pub(crate) fn build_exec_runtime(
         epoll_destroy: crate::syscall::poll::epoll_destroy,
         #[cfg(not(feature = "sc-epoll"))]
         epoll_destroy: noop_u32,
+        #[cfg(feature = "sc-epoll")]
+        epoll_token_wake: crate::syscall::poll::epoll_token_wake,
+        #[cfg(not(feature = "sc-epoll"))]
+        epoll_token_wake: |_| {},
         #[cfg(feature = "sc-pidfd")]
         pidfd_close: crate::syscall::pidfd::pidfd_close,
         #[cfg(not(feature = "sc-pidfd"))]
         pidfd_close: noop_u32,
+        #[cfg(feature = "rump")]
+        tap_close: crate::syscall::tap_close,
+        #[cfg(not(feature = "rump"))]
+        tap_close: noop_u32,
+        #[cfg(feature = "rump")]
+        tap_clone_ref: crate::syscall::tap_clone_ref,
+        #[cfg(not(feature = "rump"))]
+        tap_clone_ref: noop_u32,
         resolve_symlinks: |path| crate::vfs::resolve_symlinks(path),
         file_size: |path| crate::fs::file_size(path).map_err(|_| "fs error"),
         get_box_namespace: |box_id| crate::vfs::get_box_namespace(box_id),
@@ -454,6 +466,7 @@ pub(crate) fn build_exec_runtime(
         cow_ref_inc: pmm::cow_ref_inc,
         cow_ref_dec: pmm::cow_ref_dec,
         cow_ref_get: pmm::cow_ref_get,
+        frame_is_shared: pmm::is_shared_frame,
         // No user-AS overlay on the BSP / single-kernel build. A multikernel secondary
         // sets this when it initializes (src/smp.rs) so the normal spawn path builds a
         // correct user table on it too (docs/MULTIKERNEL.md §4.2/R4b.3a).
@@ -496,6 +509,7 @@ pub(crate) fn build_exec_runtime(
         proc_stdout_max_size: config::PROC_STDOUT_MAX_SIZE,
         cow_fork_enabled: config::COW_FORK_ENABLED,
         vfork_fastpath_enabled: config::VFORK_FASTPATH_ENABLED,
+        time_page_enabled: config::TIME_PAGE_ENABLED,
         // BSP/single-kernel: use the normal size-based loader. A multikernel secondary flips
         // this to true (it forwards file reads to the owner; whole-file is simplest there).
         prefer_whole_file_load: false,
@@ -1164,6 +1178,7 @@ fn run_async_main() -> ! {
             is_current_interrupted: process::is_current_interrupted,
             rng_fill: |buf| rng::fill_bytes(buf).expect("RNG required for networking"),
             current_thread_id: || threading::current_thread_id() as u32,
+            current_cpu: threading::current_cpu,
         },
         &mmio_addrs,
         config::ENABLE_DHCP,
@@ -1192,6 +1207,9 @@ fn run_async_main() -> ! {
                 "[rump] /dev/net/tap0 bound to NIC1 (bus.4), MAC {:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}\n",
                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]
             );
+            // QEMU virt wires virtio-mmio slot n to SPI 16+n (INTID 48+n). Blocked tap
+            // readers and pollers now sleep until NIC1 raises RX instead of yield-polling.
+            crate::syscall::tap_wire_rx_irq(48 + 4);
         }
         Err(e) => {
             crate::safe_print!(128, "[rump] BSP tap not available: {} (run QEMU with RUMP_NIC=1)\n", e);
@@ -3,7 +3,7 @@
 //! Manages physical page allocation using a bitmap allocator.
 //! Each bit in the bitmap represents a 4KB page.
 
-use alloc::collections::BTreeMap;
+use alloc::collections::{BTreeMap, BTreeSet};
 use alloc::vec::Vec;
 use core::sync::atomic::{AtomicUsize, Ordering};
 use spinning_top::Spinlock;
@@ -387,6 +387,34 @@ impl BitmapAllocator {
         None
     }
 
+    /// Allocate `count` contiguous pages whose first page is physically
+    /// aligned to `align` pages (a power of two). Only aligned starts are
+    /// tried, so a run found is usable as a 2MB block mapping as-is.
+    fn alloc_pages_aligned(&mut self, count: usize, align: usize) -> Option<PhysFrame> {
+        if count == 0 || align == 0 || !align.is_power_of_two() { return None; }
+        if self.free_pages < count { return None; }
+
+        // Page index of the first aligned physical address at or above base.
+        let align_bytes = align * PAGE_SIZE;
+        let first = (self.base_addr.next_multiple_of(align_bytes) - self.base_addr) / PAGE_SIZE;
+        let mut start = first;
+        'candidates: while start + count <= self.total_pages {
+            for i in start..start + count {
+                if !self.is_free(i) {
+                    // Skip to the next aligned start past the used page.
+                    start = first + (i + 1 - first).next_multiple_of(align);
+                    continue 'candidates;
+                }
+            }
+            for i in start..start + count {
+                self.mark_used(i);
+            }
+            self.free_pages -= count;
+            return Some(PhysFrame::new(self.base_addr + start * PAGE_SIZE));
+        }
+        None
+    }
+
     /// Free `count` contiguous pages starting from `frame`.
     fn free_pages_contiguous(&mut self, frame: PhysFrame, count: usize) {
         if frame.addr < self.base_addr { return; }
@@ -654,6 +682,19 @@ pub fn alloc_pages_contiguous_zeroed(count: usize) -> Option<PhysFrame> {
     Some(frame)
 }
 
+/// Allocate `count` physically contiguous pages starting on an `align`-page
+/// boundary, **not** zeroed (the caller overwrites them, e.g. with file data
+/// for a 2MB block mapping). Fails rather than reclaiming: large aligned runs
+/// are an optimisation and callers fall back to single pages.
+pub fn alloc_pages_aligned(count: usize, align: usize) -> Option<PhysFrame> {
+    crate::irq::with_irqs_disabled(|| {
+        let mut pmm = PMM.lock();
+        let result = pmm.alloc_pages_aligned(count, align)?;
+        ALLOCATED_PAGES.fetch_add(count, Ordering::Relaxed);
+        Some(result)
+    })
+}
+
 /// Free `count` contiguous physical pages starting from `frame`.
 pub fn free_pages_contiguous(frame: PhysFrame, count: usize) {
     crate::irq::with_irqs_disabled(|| {
@@ -813,6 +854,15 @@ pub fn alloc_pages_zeroed(count: usize) -> Option<alloc::vec::Vec<PhysFrame>> {
 /// have no overhead.
 static COW_REFCOUNTS: Spinlock<BTreeMap<usize, u16>> = Spinlock::new(BTreeMap::new());
 
+/// Frames mapped shared on purpose (the sysproxy channel, see
+/// `syscall::mem::mmap_sysproxy_chan`).  They are refcounted in
+/// `COW_REFCOUNTS` like CoW frames, so the last unmap frees them, but a write
+/// never copies them: `cow_ref_get` reports 0, and fork maps them writable into
+/// the child without demoting the parent's PTE.  Leaves with the last reference.
+static SHARED_FRAMES: Spinlock<BTreeSet<usize>> = Spinlock::new(BTreeSet::new());
+/// `SHARED_FRAMES.len()`, so fork's per-page check skips the lock when empty.
+static SHARED_FRAME_COUNT: AtomicUsize = AtomicUsize::new(0);
+
 #[allow(dead_code)]
 /// Increment the CoW reference count for a physical address.
 /// First call for a new address inserts it with count=2 (parent + child).
@@ -825,6 +875,23 @@ pub fn cow_ref_inc(pa: usize) {
     });
 }
 
+/// Add a mapping of `pa` that must stay shared with every other one: like
+/// [`cow_ref_inc`], and the frame joins `SHARED_FRAMES`.
+pub fn shared_ref_inc(pa: usize) {
+    crate::irq::with_irqs_disabled(|| {
+        if SHARED_FRAMES.lock().insert(pa) {
+            SHARED_FRAME_COUNT.fetch_add(1, Ordering::Relaxed);
+        }
+    });
+    cow_ref_inc(pa);
+}
+
+/// Whether `pa` was mapped with [`shared_ref_inc`] and is still referenced.
+pub fn is_shared_frame(pa: usize) -> bool {
+    SHARED_FRAME_COUNT.load(Ordering::Relaxed) != 0
+        && crate::irq::with_irqs_disabled(|| SHARED_FRAMES.lock().contains(&pa))
+}
+
 /// Decrement the CoW reference count.  Returns true if the count reached 0
 /// (meaning the caller should free the physical frame).  Removes the entry
 /// from the table when count reaches 0 to avoid unbounded growth.
@@ -836,6 +903,9 @@ pub fn cow_ref_dec(pa: usize) -> bool {
                 *count = count.saturating_sub(1);
                 if *count == 0 {
                     table.remove(&pa);
+                    if SHARED_FRAMES.lock().remove(&pa) {
+                        SHARED_FRAME_COUNT.fetch_sub(1, Ordering::Relaxed);
+                    }
                     true
                 } else {
                     false
@@ -848,8 +918,12 @@ pub fn cow_ref_dec(pa: usize) -> bool {
 
 #[allow(dead_code)]
 /// Get the current CoW reference count for a physical address.
-/// Returns 0 if the address is not in the CoW table (not shared).
+/// Returns 0 if the address is not in the CoW table (not shared), or is
+/// shared on purpose ([`shared_ref_inc`]) and so never copied on write.
 pub fn cow_ref_get(pa: usize) -> u16 {
+    if is_shared_frame(pa) {
+        return 0;
+    }
     crate::irq::with_irqs_disabled(|| {
         COW_REFCOUNTS.lock().get(&pa).copied().unwrap_or(0)
     })
@@ -208,6 +208,7 @@ pub fn run_all_tests() {
     test_lazy_region_lookup_for_page_fault_clone();
     test_lazy_region_lookup_resolves_tgid_for_demand_paging();
     test_lazy_region_lookup_resolves_tgid();
+    test_lazy_region_readahead_window();
     test_alloc_mmap_resolves_tgid();
     test_alloc_mmap_resolves_tgid();
     test_fault_mutex_insert_remove();
@@ -365,6 +366,7 @@ pub fn run_all_tests() {
     test_epoll_eventfd_write_triggers_event();
     test_epoll_del_removes_interest();
     test_epoll_multiple_ready_events();
+    test_epoll_ready_list_only_ready_fds();
 
     // Zombie-related: kill_thread_group child channel notification + pidfd
     test_kill_thread_group_sets_child_channel_exited();
@@ -460,9 +462,58 @@ pub fn run_all_tests() {
     // binary lands on disk as zero bytes).
     test_shared_file_mmap_writeback();
 
+    // Syscall-free clocks (docs/TIME_PAGE.md): every new address space carries
+    // the read-only time page, and reading it gives the same nanoseconds as
+    // clock_gettime's trapping path.
+    if crate::config::TIME_PAGE_ENABLED {
+        test_time_page_mapped_and_consistent();
+    }
+
     console::print("--- Process Execution Tests Done ---\n\n");
 }
 
+/// A fresh `UserAddressSpace` maps this kernel's time page at `TIME_PAGE_VA`;
+/// the page carries CNTFRQ, and counter → ns through it lands between two
+/// `timer::uptime_ns()` reads taken around it (the EL0 readers do exactly this).
+fn test_time_page_mapped_and_consistent() {
+    use akuma_exec::timepage::{self, TimePage, TIME_PAGE_VA};
+    use core::sync::atomic::Ordering;
+
+    let Some(aspace) = akuma_exec::mmu::UserAddressSpace::new() else {
+        console::print("[Test] time_page_mapped_and_consistent SKIPPED (AS alloc failed)\n");
+        return;
+    };
+    let l0 = akuma_exec::mmu::phys_to_virt(aspace.l0_phys()) as *const u64;
+    let Some(pa) = akuma_exec::mmu::translate_user_va(l0, TIME_PAGE_VA) else {
+        console::print("[Test] time_page_mapped_and_consistent FAILED (not mapped)\n");
+        panic!("time page not mapped into a new address space");
+    };
+    let page = unsafe { &*akuma_exec::mmu::phys_to_virt(pa).cast::<TimePage>() };
+    let freq = page.cntfrq.load(Ordering::Acquire);
+
+    let before = crate::timer::uptime_ns();
+    let via_page = timepage::counter_to_ns(crate::timer::read_counter(), freq);
+    let after = crate::timer::uptime_ns();
+
+    let realtime_ok = match crate::timer::utc_time_us() {
+        Some(_) => page.flags.load(Ordering::Acquire) & timepage::TP_REALTIME_VALID != 0,
+        None => true,
+    };
+    let pass = page.magic == timepage::TIME_PAGE_MAGIC
+        && freq == crate::timer::read_frequency()
+        && before <= via_page && via_page <= after
+        && realtime_ok;
+    if pass {
+        crate::safe_print!(160, "[Test] time_page_mapped_and_consistent PASSED (pa={:#x} freq={} ns={})\n",
+            pa, freq, via_page);
+    } else {
+        crate::safe_print!(224,
+            "[Test] time_page_mapped_and_consistent FAILED (magic={:#x} freq={} before={} page={} after={} realtime_ok={})\n",
+            page.magic, freq, before, via_page, after, realtime_ok);
+        panic!("time page contents disagree with the kernel clock");
+    }
+}
+
 /// Exercises the core of the writable MAP_SHARED writeback path: fill a resident
 /// physical page with a known pattern and confirm `writeback_shared_pages` copies
 /// it into the backing file at the right offset (overwriting prior content), so a
@@ -1388,7 +1439,7 @@ fn test_forktest_parent_mmap() {
 
 /// Helper to create a minimal Process for testing logic without loading a real ELF.
 pub fn make_test_process(pid: u32) -> alloc::boxed::Box<akuma_exec::process::Process> {
-    use akuma_exec::process::{Process, ProcessMemory, SharedFdTable, SharedSignalTable, ProcessSyscallStats};
+    use akuma_exec::process::{Process, ProcessMemory, SharedFdTable, SharedSignalTable, ProcessSyscallStats, EmulationStats};
     use akuma_exec::mmu::UserAddressSpace;
     use spinning_top::Spinlock;
     use alloc::sync::Arc;
@@ -1426,6 +1477,7 @@ pub fn make_test_process(pid: u32) -> alloc::boxed::Box<akuma_exec::process::Pro
         current_syscall: core::sync::atomic::AtomicU64::new(!0),
         last_syscall: core::sync::atomic::AtomicU64::new(0),
         syscall_stats: ProcessSyscallStats::new(),
+        emulation: EmulationStats::new(),
     })
 }
 
@@ -5232,6 +5284,49 @@ fn test_kill_thread_group_preserves_lazy_regions() {
     }
 }
 
+/// File-fault readahead window (`lazy_region_readahead`): starts at `init`,
+/// doubles on faults inside or at the end of the last window, halves on a
+/// jump elsewhere, and follows per-range `madvise` hints — which split the
+/// region without disturbing its other pieces.
+fn test_lazy_region_readahead_window() {
+    use akuma_exec::process::{
+        push_lazy_region, clear_lazy_regions, lazy_region_readahead, set_lazy_region_advice,
+        Readahead,
+    };
+    use akuma_exec::mmu::user_flags;
+
+    let pid = 60_070u32;
+    let va = 0xD200_0000usize;
+    let size = 0x400_0000usize; // 64 MB
+    let page = 0x1000usize;
+    push_lazy_region(pid, va, size, user_flags::RO);
+
+    let first = lazy_region_readahead(pid, va, 256, 2048);
+    let at_end = lazy_region_readahead(pid, va + 256 * page, 256, 2048);
+    // Inside the 512-page window (a window the fault path cut short).
+    let inside = lazy_region_readahead(pid, va + 600 * page, 256, 2048);
+    let jump = lazy_region_readahead(pid, va + 0x200_0000, 256, 2048);
+
+    set_lazy_region_advice(pid, va + 0x100_0000, 0x40_0000, Readahead::RANDOM);
+    let random = lazy_region_readahead(pid, va + 0x110_0000, 256, 2048);
+    let before_split = lazy_region_readahead(pid, va + 0x80_0000, 256, 2048);
+    set_lazy_region_advice(pid, va, size, Readahead::SEQUENTIAL);
+    let sequential = lazy_region_readahead(pid, va + 0x300_0000, 256, 2048);
+    let no_region = lazy_region_readahead(pid, va + size, 256, 2048);
+
+    clear_lazy_regions(pid);
+
+    if (first, at_end, inside, jump) == (256, 512, 1024, 512)
+        && random == 1 && before_split > 1 && sequential == 2048 && no_region == 256
+    {
+        console::print("[Test] lazy_region_readahead_window PASSED\n");
+    } else {
+        crate::safe_print!(192,
+            "[Test] lazy_region_readahead_window FAILED: {} {} {} {} random={} before={} seq={} none={}\n",
+            first, at_end, inside, jump, random, before_split, sequential, no_region);
+    }
+}
+
 /// forktest / GO_FORKTEST_DEBUG: `lazy_region_lookup_for_page_fault` must find regions
 /// cloned to sibling PIDs (same as `lazy_region_lookup_for_pid` after `clone_lazy_regions`).
 fn test_lazy_region_lookup_for_page_fault_clone() {
@@ -7686,6 +7781,81 @@ fn test_epoll_multiple_ready_events() {
     }
 }
 
+/// Test that epoll_pwait harvests only the fds a resource woke: 200 idle
+/// eventfds stay off the ready list, three written ones land on it through
+/// their poller tokens, and LT-ready ones are requeued after being reported.
+fn test_epoll_ready_list_only_ready_fds() {
+    use crate::syscall::poll::{sys_epoll_create1, sys_epoll_ctl, sys_epoll_pwait, epoll_ready_pending};
+    use crate::syscall::eventfd::{eventfd_create, eventfd_write, eventfd_close};
+    use akuma_exec::process::{register_process, unregister_process, register_thread_pid, unregister_thread_pid, FileDescriptor};
+
+    const N: usize = 200;
+    let pid = 70_040u32;
+    let tid = akuma_exec::threading::current_thread_id();
+    let proc = make_test_process(pid);
+
+    let mut efds = alloc::vec::Vec::with_capacity(N);
+    let mut fds = alloc::vec::Vec::with_capacity(N);
+    for _ in 0..N {
+        let efd = eventfd_create(0, 0);
+        fds.push(proc.alloc_fd(FileDescriptor::EventFd(efd)));
+        efds.push(efd);
+    }
+
+    register_process(pid, proc);
+    register_thread_pid(tid, pid);
+
+    let epfd = sys_epoll_create1(0) as u32;
+
+    const EPOLLIN: u32 = 0x001;
+    const EPOLL_CTL_ADD: i32 = 1;
+    const EPOLL_CTL_DEL: i32 = 2;
+    #[repr(C)]
+    #[derive(Copy, Clone)]
+    struct EpollEvent { events: u32, _pad: u32, data: u64 }
+
+    for (i, &fd) in fds.iter().enumerate() {
+        let ev = EpollEvent { events: EPOLLIN, _pad: 0, data: i as u64 };
+        sys_epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &raw const ev as usize);
+    }
+    let queued_by_add = epoll_ready_pending(epfd);
+
+    // First wait checks every fd once (registering tokens); none are ready.
+    let mut out = [EpollEvent { events: 0, _pad: 0, data: 0 }; 8];
+    let first = sys_epoll_pwait(epfd, out.as_mut_ptr() as usize, 8, 0);
+    let idle_pending = epoll_ready_pending(epfd);
+
+    for &i in &[7usize, 100, 199] {
+        let _ = eventfd_write(efds[i], 1);
+    }
+    let woken_pending = epoll_ready_pending(epfd);
+
+    let nready = sys_epoll_pwait(epfd, out.as_mut_ptr() as usize, 8, 0);
+    let mut datas = [out[0].data, out[1].data, out[2].data];
+    datas.sort_unstable();
+    // Still readable (LT): requeued for the next wait.
+    let requeued = epoll_ready_pending(epfd);
+
+    sys_epoll_ctl(epfd, EPOLL_CTL_DEL, fds[100], 0);
+    let after_del = epoll_ready_pending(epfd);
+
+    unregister_process(pid);
+    unregister_thread_pid(tid);
+    for &efd in &efds {
+        eventfd_close(efd);
+    }
+
+    if queued_by_add == N && first == 0 && idle_pending == 0 && woken_pending == 3
+        && nready == 3 && datas == [7, 100, 199] && requeued == 3 && after_del == 2
+    {
+        console::print("[Test] epoll_ready_list_only_ready_fds PASSED\n");
+    } else {
+        crate::safe_print!(192,
+            "[Test] epoll_ready_list_only_ready_fds FAILED: add={} first={} idle={} woken={} nready={} data={:?} requeued={} after_del={}\n",
+            queued_by_add, first, idle_pending, woken_pending, nready, datas, requeued, after_del);
+    }
+}
+
 /// Test that kill_thread_group properly sets the sibling's PROCESS_CHANNEL
 /// as exited. PROCESS_CHANNELS are per-thread I/O channels, not pidfd channels.
 fn test_kill_thread_group_sets_child_channel_exited() {
@@ -8,16 +8,29 @@
 //! That is the on-Akuma proof of the kernel-pipe transport; full syscall
 //! interception + per-box wiring (a real [`ClientMem`] over user VA, the fd map,
 //! the `stack=rump` dispatch hook) come next.
+//!
+//! A box's channel also gets a shared-memory region ([`ShmChan`]): once
+//! `rump_server` maps it from fd 3, frames travel through its rings and the
+//! pipes only carry doorbells (see [`akuma_rump::shmchan`]).
 
 use crate::syscall::pipe;
 use akuma_exec::mmu::user_access::{copy_from_user_safe, copy_to_user_safe};
 use akuma_exec::{process, threading};
-use akuma_rump::sysproxy::{Client, ClientMem, PipeIo, PipeTransport, MAX_TRANSFER};
+use akuma_exec::PhysFrame;
+use akuma_rump::latency::{LatHist, LatSnapshot};
+use akuma_rump::ring::RingMem;
+use akuma_rump::shmchan::{self, ShmEnd, ShmTransport};
+use akuma_rump::sysproxy::{
+    Client, ClientMem, PipeIo, PipeTransport, SyscallResult, Transport, TransportErr, MAX_PREFETCH,
+    MAX_TRANSFER,
+};
 use akuma_rump::syscall_translation as translation;
 use alloc::vec::Vec;
 
 /// EFAULT (NetBSD/Linux share it).
 const EFAULT: i32 = 14;
+/// EIO (NetBSD/Linux share it): a pipelined request that got no reply in time.
+const EIO: i32 = 5;
 /// Cap a single blocking read so a wedged server fails the request instead of
 /// hanging the boot before herd/SSH come up.
 const READ_TIMEOUT_US: u64 = 8_000_000;
@@ -42,11 +55,30 @@ use spinning_top::Spinlock;
 static RUMP_WAIT_US: AtomicU64 = AtomicU64::new(0);
 static RUMP_WAIT_N: AtomicU32 = AtomicU32::new(0);
 
+// Distributions behind those sums: each blocking wait (hop) and each proxied
+// syscall's wall-time for the connect / send / recv families, reported as p50/p99
+// every RUMP_LAT_WINDOW proxied syscalls and then reset. Means hide exactly what a
+// server-side scheduling change moves (the tail), so compare these windows across
+// a connect+send+recv loop before/after such a change.
+static RUMP_WAIT_HIST: LatHist = LatHist::new();
+static RUMP_LAT_CONNECT: LatHist = LatHist::new();
+static RUMP_LAT_SEND: LatHist = LatHist::new();
+static RUMP_LAT_RECV: LatHist = LatHist::new();
+static RUMP_LAT_N: AtomicU32 = AtomicU32::new(0);
+const RUMP_LAT_WINDOW: u32 = 256;
+/// Server callbacks (copyin/copyout/anonmmap hops) serviced in the window, so
+/// the PREFETCH bulk copy's saving shows as hops per window, not just latency.
+static RUMP_HOPS: AtomicU64 = AtomicU64::new(0);
+
 /// Box IDs whose network stack is the NetBSD rump kernel — set via the
 /// `SET_BOX_STACK` syscall when herd starts a `stack = rump` service. A box not
 /// in this set uses smoltcp (the default), so its socket dispatch is unchanged.
 static RUMP_BOXES: Spinlock<BTreeSet<u64>> = Spinlock::new(BTreeSet::new());
 
+/// `stack = rump` boxes that share another box's rump stack instead of running
+/// a rump_server of their own: box → the box whose server serves it.
+static NET_OWNERS: Spinlock<BTreeMap<u64, u64>> = Spinlock::new(BTreeMap::new());
+
 /// Fast-path guard: the per-syscall trace/dispatch hook costs a single relaxed
 /// load when no `stack=rump` box exists (the common case / pre-rumpnet boot).
 static RUMP_ACTIVE: AtomicBool = AtomicBool::new(false);
@@ -56,10 +88,24 @@ static RUMP_ACTIVE: AtomicBool = AtomicBool::new(false);
 /// `SET_BOX_STACK` for the box BEFORE it spawns the box's `rump_server`, so that
 /// when that spawn lands the kernel knows to wire it a sysproxy channel (see
 /// [`attach_server`]). herd owns the server process; the kernel owns the channel.
-pub fn mark_box_rump(box_id: u64) {
+///
+/// A non-zero `net_box` other than `box_id` makes the box share that box's
+/// stack: it runs no rump_server, and its first socket syscall gets it a
+/// channel of its own into `net_box`'s server ([`attach_shared`]).
+pub fn mark_box_rump(box_id: u64, net_box: u64) {
     RUMP_BOXES.lock().insert(box_id);
     RUMP_ACTIVE.store(true, Ordering::Relaxed);
-    crate::safe_print!(64, "[RUMP-SP] box {} marked stack=rump\n", box_id);
+    if net_box != 0 && net_box != box_id {
+        NET_OWNERS.lock().insert(box_id, net_box);
+        crate::safe_print!(80, "[RUMP-SP] box {} marked stack=rump (shares box {})\n", box_id, net_box);
+    } else {
+        crate::safe_print!(64, "[RUMP-SP] box {} marked stack=rump\n", box_id);
+    }
+}
+
+/// The box whose rump_server serves `box_id`, if it shares another's stack.
+fn net_owner(box_id: u64) -> Option<u64> {
+    NET_OWNERS.lock().get(&box_id).copied()
 }
 
 /// Is this box's network stack the rump kernel?
@@ -109,7 +155,10 @@ const HANDSHAKE_TIMEOUT_US: u64 = 15_000_000;
 /// rump_server at boot; the handshake takes ~5s through rump_init + DHCP).
 const PROXY_WAIT_TIMEOUT_US: u64 = 20_000_000;
 
-type ProxyClient = Client<PipeTransport<KernelPipeIo>>;
+type ProxyClient = Client<ChanTransport>;
+
+/// Most plain transfers one box thread group may have in flight at once.
+const PIPELINE_MAX: u32 = 16;
 
 /// One box's live sysproxy connection to its `rump_server` (approach 1: the
 /// box's own syscall thread drives the round-trip synchronously).
@@ -119,21 +168,174 @@ pub struct BoxProxy {
     /// drives one syscall, then puts it back — so the brief guarding spinlock is
     /// never held across the yielding channel read.
     client: Spinlock<Option<ProxyClient>>,
+    /// The reply pipe (server → kernel), for the pipelined readiness check.
+    rd: u32,
+    /// The channel region, when the replies arrive through it rather than `rd`.
+    shm: Option<Arc<ShmChan>>,
+    /// The server takes channels for other boxes (see [`attach_shared`]).
+    mux: bool,
+    /// Who may use the client: see [`BoxProxy::pipelined`].
+    flight: Spinlock<Flight>,
+}
+
+/// Admission state behind [`BoxProxy::with_client`] / [`BoxProxy::pipelined`].
+#[derive(Default)]
+struct Flight {
+    /// Pipelined requests in flight, all from thread group `tgid`.
+    n: u32,
+    tgid: process::Pid,
+    /// An exclusive caller holds the client, or waits for the pipeline to drain.
+    exclusive: bool,
+    /// Submitting thread of each pipelined reqno, woken when another thread's
+    /// pump files that reqno's reply.
+    waiters: BTreeMap<u64, usize>,
+}
+
+/// One pass of a pipelined submitter over the client.
+enum Step {
+    Done(SyscallResult),
+    /// Read a frame; `Some(reqno)` = filed that request's reply.
+    Pumped(Option<u64>),
+    /// Nothing to read yet.
+    Idle,
 }
 
 impl BoxProxy {
-    /// Run `f` with exclusive access to the client (see field doc).
+    fn new(client: ProxyClient, rd: u32) -> Self {
+        let shm = client.transport().shm();
+        let mux = client.server_mux();
+        Self { client: Spinlock::new(Some(client)), rd, shm, mux, flight: Spinlock::new(Flight::default()) }
+    }
+
+    /// A reply (or callback) is waiting to be pumped.
+    fn reply_ready(&self) -> bool {
+        match &self.shm {
+            Some(chan) => shmchan::reply_ready(&mut chan.mem()),
+            None => pipe::pipe_can_read(self.rd),
+        }
+    }
+
+    /// Run `f` with exclusive access to the client: no pipelined request is in
+    /// flight while it runs, so `f`'s [`ClientMem`] services every callback.
     fn with_client<R>(&self, f: impl FnOnce(&mut ProxyClient) -> R) -> R {
+        loop {
+            {
+                let mut fl = self.flight.lock();
+                if !fl.exclusive {
+                    fl.exclusive = true;
+                    break;
+                }
+            }
+            threading::yield_now();
+        }
+        // New pipelined admissions are held off; let the ones in flight finish.
+        while self.flight.lock().n > 0 {
+            threading::yield_now();
+        }
+        let r = self.take_client(f);
+        self.flight.lock().exclusive = false;
+        r
+    }
+
+    /// Take the client out of its slot for `f` (see field doc), counting the
+    /// callbacks `f` services into the window's hop total.
+    fn take_client<R>(&self, f: impl FnOnce(&mut ProxyClient) -> R) -> R {
         let mut c = loop {
             if let Some(c) = self.client.lock().take() {
                 break c;
             }
             threading::yield_now();
         };
+        let hops0 = c.total_callbacks();
         let r = f(&mut c);
+        RUMP_HOPS.fetch_add(c.total_callbacks() - hops0, Ordering::Relaxed);
         *self.client.lock() = Some(c);
         r
     }
+
+    /// Proxy a plain transfer — one needing no per-call [`ProcMem`] state —
+    /// pipelined with the same thread group's other such requests: submit, then
+    /// pump the channel until our reply is filed, by us or by whichever
+    /// submitter read it (it wakes us). A callback carries no syscall reqno, so
+    /// whoever pumps services it against the *current* address space; that is
+    /// why only one thread group's requests overlap. `bulk` is pre-sent for the
+    /// server's copyins. Returns the reply and the callbacks this thread
+    /// serviced.
+    fn pipelined(
+        &self,
+        tgid: process::Pid,
+        sysnum: u32,
+        args: &[u8],
+        bulk: &[(u64, &[u8])],
+    ) -> (SyscallResult, u32) {
+        loop {
+            {
+                let mut fl = self.flight.lock();
+                if !fl.exclusive && (fl.n == 0 || fl.tgid == tgid) && fl.n < PIPELINE_MAX {
+                    fl.n += 1;
+                    fl.tgid = tgid;
+                    break;
+                }
+            }
+            threading::yield_now();
+        }
+        let mut hops = 0u64;
+        let res = match self.take_client(|c| c.submit(sysnum, args, bulk)) {
+            Ok(reqno) => self.await_pipelined(reqno, &mut hops),
+            Err(e) => Err(e),
+        };
+        self.flight.lock().n -= 1;
+        (res, u32::try_from(hops).unwrap_or(u32::MAX))
+    }
+
+    fn await_pipelined(&self, reqno: u64, hops: &mut u64) -> SyscallResult {
+        self.flight.lock().waiters.insert(reqno, threading::current_thread_id());
+        let deadline = crate::timer::uptime_us() + READ_TIMEOUT_US;
+        let res = loop {
+            let step = self.take_client(|c| {
+                if let Some(r) = c.take_done(reqno) {
+                    return Step::Done(r);
+                }
+                if !self.reply_ready() {
+                    return Step::Idle;
+                }
+                let cb0 = c.total_callbacks();
+                let got = c.pump(&mut ProcMem::new());
+                *hops += c.total_callbacks() - cb0;
+                match got {
+                    Ok(filed) => Step::Pumped(filed),
+                    Err(e) => {
+                        c.abandon(reqno);
+                        Step::Done(Err(e))
+                    }
+                }
+            });
+            match step {
+                Step::Done(r) => break r,
+                Step::Pumped(Some(other)) if other != reqno => {
+                    if let Some(&tid) = self.flight.lock().waiters.get(&other) {
+                        threading::get_waker_for_thread(tid).wake();
+                    }
+                }
+                Step::Pumped(_) => {}
+                Step::Idle => {
+                    if crate::timer::uptime_us() >= deadline {
+                        self.take_client(|c| c.abandon(reqno));
+                        break Err(EIO);
+                    }
+                    // Woken by the server's next write (or doorbell), or by the
+                    // thread that pumps our reply (WOKEN is sticky, so a wake
+                    // landing before we block is not lost).
+                    match &self.shm {
+                        Some(chan) => shmchan::wait_reply(&mut chan.mem(), &mut KernelPipeIo, self.rd, deadline),
+                        None => KernelPipeIo.wait_readable(self.rd, deadline),
+                    }
+                }
+            }
+        };
+        self.flight.lock().waiters.remove(&reqno);
+        res
+    }
 }
 
 /// Lifecycle of a box's proxy: `Initializing` serializes concurrent first
@@ -155,6 +357,10 @@ static PROXIES: Spinlock<BTreeMap<u64, ProxyEntry>> = Spinlock::new(BTreeMap::ne
 /// `UnixSocket` channel fd — exactly as the proven box-0 `run_demo` does.
 static SERVER_PIDS: Spinlock<BTreeSet<process::Pid>> = Spinlock::new(BTreeSet::new());
 
+/// Control pipe of each box's `rump_server` (its fd 4, `--chan-fd 4`), by box:
+/// `(server pid, pipe id)`. [`attach_shared`] announces new channels on it.
+static SERVER_CTL: Spinlock<BTreeMap<u64, (process::Pid, u32)>> = Spinlock::new(BTreeMap::new());
+
 /// Is `pid` a kernel-spawned `rump_server`? Its own syscalls must never be
 /// proxied (it IS the proxy target). True throughout its life, incl. bring-up.
 fn is_server_pid(pid: process::Pid) -> bool {
@@ -163,16 +369,23 @@ fn is_server_pid(pid: process::Pid) -> bool {
 
 /// Wait (bounded) for the box's proxy to become `Ready`. Does NOT spawn anything
 /// — herd owns the `rump_server`, and the kernel brings the proxy up in a
-/// kthread via [`attach_server`] when herd spawns it. Returns the proxy, or
-/// `None` if it failed or never appeared within the timeout.
+/// kthread via [`attach_server`] when herd spawns it, or via [`attach_shared`]
+/// here for a box sharing another's stack. Returns the proxy, or `None` if it
+/// failed or never appeared within the timeout.
 fn ensure_box_proxy(box_id: u64) -> Option<Arc<BoxProxy>> {
     let start = crate::timer::uptime_us();
     loop {
         match PROXIES.lock().get(&box_id) {
             Some(ProxyEntry::Ready(p)) => return Some(p.clone()),
             Some(ProxyEntry::Failed) => return None,
-            // Handshaking, or the server hasn't been spawned yet.
-            Some(ProxyEntry::Initializing) | None => {}
+            Some(ProxyEntry::Initializing) => {}
+            // The server hasn't been spawned yet, or (sharing) the box's
+            // channel into it hasn't been opened yet.
+            None => {
+                if let Some(owner) = net_owner(box_id) {
+                    share_stack(box_id, owner);
+                }
+            }
         }
         if crate::timer::uptime_us().saturating_sub(start) > PROXY_WAIT_TIMEOUT_US {
             crate::safe_print!(64, "[RUMP-SP] box={} proxy not ready (timeout)\n", box_id);
@@ -183,16 +396,20 @@ fn ensure_box_proxy(box_id: u64) -> Option<Arc<BoxProxy>> {
 }
 
 /// Wire a freshly-spawned `rump_server` into the per-box proxy. Called from the
-/// spawn path when herd spawns the box's `rump_server` (`--fd 3 --net`): creates
-/// the kernel pipe pair, installs it on the server's fd 3 BEFORE the server runs,
-/// then handshakes IN A KTHREAD (the handshake blocks ~5s through rump_init +
-/// DHCP) and publishes the proxy to [`PROXIES`]. herd owns the server PROCESS
-/// lifecycle; the kernel owns the CHANNEL + proxy.
+/// spawn path when herd spawns the box's `rump_server` (`--fd 3 --chan-fd 4
+/// --net`): creates the kernel pipe pair, installs it on the server's fd 3 and
+/// a control pipe on its fd 4 BEFORE the server runs, then handshakes in a
+/// kthread ([`spawn_handshake`]). herd owns the server PROCESS lifecycle; the
+/// kernel owns the CHANNEL + proxy.
 ///
 /// TODO (channel-wiring trigger): currently detected by path-match in
 /// `sys_spawn_ext` (`box_is_rump` + "rump_server"). A cleaner signal — herd
 /// notifying the kernel explicitly which spawn is the stack daemon — is TBD.
 pub fn attach_server(box_id: u64, server_pid: process::Pid) {
+    if let Some(owner) = net_owner(box_id) {
+        crate::safe_print!(96, "[RUMP-SP] box={} shares box {}'s stack; not attaching pid={}\n", box_id, owner, server_pid);
+        return;
+    }
     {
         let mut m = PROXIES.lock();
         if m.contains_key(&box_id) {
@@ -212,27 +429,109 @@ pub fn attach_server(box_id: u64, server_pid: process::Pid) {
         PROXIES.lock().insert(box_id, ProxyEntry::Failed);
         return;
     };
+    // The region the server maps from fd 3; without one (no contiguous run
+    // free) the channel stays on the pipes.
+    let shm = ShmChan::alloc();
+    if let Some(chan) = &shm {
+        SHM_CHANS.lock().insert(px, chan.clone());
+    }
     // Install the channel at fd 3 before the server is scheduled (single-core:
     // it does not run until the spawning thread yields).
     server.set_fd(3, process::FileDescriptor::UnixSocket { rx: px, tx: py });
+    // ...and the control pipe at fd 4. A server started without `--chan-fd`
+    // never reads it and says so in its banner, so nothing is sent on it.
+    let ctl = pipe::pipe_create();
+    server.set_fd(4, process::FileDescriptor::PipeRead(ctl));
+    SERVER_CTL.lock().insert(box_id, (server_pid, ctl));
     crate::safe_print!(
         96,
         "[RUMP-SP] box={} attached sysproxy channel to rump_server pid={}; handshaking\n",
         box_id,
         server_pid
     );
+    spawn_handshake(box_id, px, py, shm, Some(server_pid));
+}
+
+/// Give `box_id` a channel of its own into the rump_server of `owner`, whose
+/// stack it shares: a new pipe pair (and region) at a free fd of the server,
+/// announced on the server's control pipe. The server takes it on as one more
+/// sysproxy client — its own rump process, so its own fd namespace — served by
+/// the same receive loop and event wait as the owner's channel.
+fn attach_shared(box_id: u64, owner: u64) {
+    {
+        let mut m = PROXIES.lock();
+        if m.contains_key(&box_id) {
+            return;
+        }
+        m.insert(box_id, ProxyEntry::Initializing);
+    }
+    let ctl = SERVER_CTL.lock().get(&owner).copied();
+    let Some((server, ctl)) = ctl.and_then(|(pid, ctl)| Some((process::lookup_process(pid)?, ctl))) else {
+        crate::safe_print!(64, "[RUMP-SP] box={} owner box {} has no server\n", box_id, owner);
+        PROXIES.lock().insert(box_id, ProxyEntry::Failed);
+        return;
+    };
+    let px = pipe::pipe_create();
+    let py = pipe::pipe_create();
+    let shm = ShmChan::alloc();
+    if let Some(chan) = &shm {
+        SHM_CHANS.lock().insert(px, chan.clone());
+    }
+    let fd = server.alloc_fd(process::FileDescriptor::UnixSocket { rx: px, tx: py });
+    if pipe::pipe_write(ctl, &fd.to_le_bytes()).is_err() {
+        let _ = server.remove_fd(fd);
+        SHM_CHANS.lock().remove(&px);
+        PROXIES.lock().insert(box_id, ProxyEntry::Failed);
+        return;
+    }
+    crate::safe_print!(
+        96,
+        "[RUMP-SP] box={} opened channel fd {} into box {}'s rump_server; handshaking\n",
+        box_id,
+        fd,
+        owner
+    );
+    spawn_handshake(box_id, px, py, shm, None);
+}
+
+/// `box_id` shares `owner`'s stack and has no channel yet: open one once the
+/// owner's proxy is up. Sticky `Failed` if the owner's failed, or if its server
+/// serves a single client (no `+mux` in its banner: started without
+/// `--chan-fd`).
+fn share_stack(box_id: u64, owner: u64) {
+    let mux = match PROXIES.lock().get(&owner) {
+        Some(ProxyEntry::Ready(p)) => p.mux,
+        Some(ProxyEntry::Failed) => false,
+        Some(ProxyEntry::Initializing) | None => return,
+    };
+    if mux {
+        attach_shared(box_id, owner);
+    } else {
+        crate::safe_print!(80, "[RUMP-SP] box={} cannot share box {}'s stack\n", box_id, owner);
+        PROXIES.lock().entry(box_id).or_insert(ProxyEntry::Failed);
+    }
+}
 
+/// Handshake the channel `px`/`py` IN A KTHREAD (a new server's handshake
+/// blocks ~5s through rump_init + DHCP) and publish the box's proxy to
+/// [`PROXIES`]. On failure `server_pid`, the box's own server, stops being
+/// excluded from interception.
+fn spawn_handshake(box_id: u64, px: u32, py: u32, shm: Option<Arc<ShmChan>>, server_pid: Option<process::Pid>) {
     let _ = threading::spawn_fn(move || {
-        let chan =
-            PipeTransport { io: KernelPipeIo, wr: px, rd: py, timeout_us: HANDSHAKE_TIMEOUT_US };
+        let chan = ChanTransport::new(px, py, HANDSHAKE_TIMEOUT_US, shm);
         let entry = match Client::connect(chan, b"akuma-kernel") {
             Ok(client) => {
-                crate::safe_print!(64, "[RUMP-SP] box={} proxy ready\n", box_id);
-                ProxyEntry::Ready(Arc::new(BoxProxy { client: Spinlock::new(Some(client)) }))
+                let via = if client.transport().shm().is_some() { "shm" } else { "pipe" };
+                let mux = if client.server_mux() { ", mux" } else { "" };
+                crate::safe_print!(64, "[RUMP-SP] box={} proxy ready ({}{})\n", box_id, via, mux);
+                ProxyEntry::Ready(Arc::new(BoxProxy::new(client, py)))
             }
             Err(e) => {
                 crate::safe_print!(64, "[RUMP-SP] box={} handshake failed errno={}\n", box_id, e);
-                SERVER_PIDS.lock().remove(&server_pid);
+                if let Some(pid) = server_pid {
+                    SERVER_PIDS.lock().remove(&pid);
+                }
+                SHM_CHANS.lock().remove(&px);
                 ProxyEntry::Failed
             }
         };
@@ -353,7 +652,8 @@ pub fn intercept_box_syscall(syscall_num: u64, args: &[u64; 6]) -> Option<u64> {
         args[2]
     );
 
-    Some(match op {
+    let t0 = crate::timer::uptime_us();
+    let ret = match op {
         translation::Op::Socket => proxy_socket(args, proc, box_id),
         translation::Op::Close => proxy_close(args, proc, box_id),
         translation::Op::Connect => proxy_connect(args, proc, box_id),
@@ -376,7 +676,34 @@ pub fn intercept_box_syscall(syscall_num: u64, args: &[u64; 6]) -> Option<u64> {
         // so it never needs sendmsg. Clean error so the box never reaches smoltcp
         // with a rump fd.
         _ => neg_linux_errno(LINUX_EOPNOTSUPP),
-    })
+    };
+    record_latency(op, crate::timer::uptime_us().saturating_sub(t0));
+    Some(ret)
+}
+
+/// Count one proxied syscall's wall-time; every [`RUMP_LAT_WINDOW`] syscalls,
+/// log and reset the p50/p99 window.
+fn record_latency(op: translation::Op, us: u64) {
+    use translation::Op;
+    match op {
+        Op::Connect => RUMP_LAT_CONNECT.record(us),
+        Op::Sendto | Op::Write | Op::Writev => RUMP_LAT_SEND.record(us),
+        Op::Recvfrom | Op::Recvmsg | Op::Read | Op::Readv => RUMP_LAT_RECV.record(us),
+        _ => {}
+    }
+    if RUMP_LAT_N.fetch_add(1, Ordering::Relaxed) % RUMP_LAT_WINDOW == RUMP_LAT_WINDOW - 1 {
+        let (c, tx, rx, hop) =
+            (RUMP_LAT_CONNECT.take(), RUMP_LAT_SEND.take(), RUMP_LAT_RECV.take(), RUMP_WAIT_HIST.take());
+        let p = |h: &LatSnapshot| (h.count(), h.percentile(50), h.percentile(99));
+        let (c, tx, rx, hop) = (p(&c), p(&tx), p(&rx), p(&hop));
+        crate::safe_print!(
+            288,
+            "[RUMP-SP] lat/{}: connect n={} p50<={}us p99<={}us | send n={} p50<={}us p99<={}us | recv n={} p50<={}us p99<={}us | blk n={} p50<={}us p99<={}us | hops={}\n",
+            RUMP_LAT_WINDOW,
+            c.0, c.1, c.2, tx.0, tx.1, tx.2, rx.0, rx.1, rx.2, hop.0, hop.1, hop.2,
+            RUMP_HOPS.swap(0, Ordering::Relaxed)
+        );
+    }
 }
 
 /// `socket(domain, type, proto)` → a rump socket fd. Only `AF_INET` is proxied;
@@ -732,17 +1059,21 @@ const RECV_BLOCK_SLICE_US: u64 = 100_000;
 /// `TcpStream::read` busy-retries on EAGAIN with no sleep, so returning EAGAIN
 /// immediately would hot-spin the proxy. (Non-blocking box sockets keep the
 /// single-shot path in `proxy_transfer`.)
-fn proxy_recv_blocking(proxy: &Arc<BoxProxy>, rump_fd: i32, buf: u64, len: u64) -> u64 {
+fn proxy_recv_blocking(
+    proxy: &Arc<BoxProxy>,
+    tgid: process::Pid,
+    rump_fd: i32,
+    buf: u64,
+    len: u64,
+) -> u64 {
     let deadline = crate::timer::uptime_us() + RECV_BLOCK_SLICE_US;
+    let a = translation::pack_args(&[rump_fd as u64, buf, len, NB_MSG_DONTWAIT, 0, 0]);
     loop {
         if akuma_exec::process::is_current_interrupted() {
             return neg_linux_errno(LINUX_EINTR);
         }
-        let mut mem = ProcMem::new();
-        let res = proxy.with_client(|c| {
-            let a = translation::pack_args(&[rump_fd as u64, buf, len, NB_MSG_DONTWAIT, 0, 0]);
-            c.syscall(translation::netbsd_sysno(translation::Op::Recvfrom), &a, &mut mem)
-        });
+        let (res, _) =
+            proxy.pipelined(tgid, translation::netbsd_sysno(translation::Op::Recvfrom), &a, &[]);
         match res {
             Ok([n, _]) => return n as u64, // n>0 = data, n==0 = peer closed (EOF)
             Err(e) => {
@@ -846,7 +1177,7 @@ fn proxy_transfer(args: &[u64; 6], proc: &Process, box_id: u64, op: translation:
     // TcpStream::read is exactly this. Non-blocking sockets fall through to the
     // single-shot MSG_DONTWAIT path below.
     if matches!(op, translation::Op::Recvfrom) && args[4] == 0 && !nonblock {
-        return proxy_recv_blocking(&proxy, rump_fd, args[1], args[2]);
+        return proxy_recv_blocking(&proxy, proc.tgid, rump_fd, args[1], args[2]);
     }
     // args[1],args[2] = (buf,len) for read/write/sendto/recvfrom, or (iovptr,
     // iovcnt) for readv/writev — same positional layout, passed verbatim. The
@@ -929,8 +1260,17 @@ fn proxy_transfer(args: &[u64; 6], proc: &Process, box_id: u64, op: translation:
     let t0 = crate::timer::uptime_us();
     let w_us0 = RUMP_WAIT_US.load(Ordering::Relaxed);
     let w_n0 = RUMP_WAIT_N.load(Ordering::Relaxed);
-    let (res, hops) =
-        proxy.with_client(|c| (c.syscall(translation::netbsd_sysno(op), &nb_args, &mut mem), c.last_callbacks()));
+    let sysnum = translation::netbsd_sysno(op);
+    // No sockaddr translation riding on `mem` → nothing per-call for a callback
+    // to need, so the request can overlap the thread group's others and carry
+    // its copyin data up front.
+    let (res, hops) = if mem.cin_override.is_empty() && mem.cout_sockaddr.is_empty() {
+        let bulk = transfer_bulk(op, a1, a2);
+        let bulk: Vec<(u64, &[u8])> = bulk.iter().map(|(a, b)| (*a, b.as_slice())).collect();
+        proxy.pipelined(proc.tgid, sysnum, &nb_args, &bulk)
+    } else {
+        proxy.with_client(|c| (c.syscall(sysnum, &nb_args, &mut mem), c.last_callbacks()))
+    };
     let dt = crate::timer::uptime_us().saturating_sub(t0);
     let w_us = RUMP_WAIT_US.load(Ordering::Relaxed).saturating_sub(w_us0);
     let w_n = RUMP_WAIT_N.load(Ordering::Relaxed).saturating_sub(w_n0);
@@ -954,6 +1294,61 @@ fn proxy_transfer(args: &[u64; 6], proc: &Process, box_id: u64, op: translation:
     }
 }
 
+/// The user memory a plain transfer's server side will copyin, read up front
+/// for the PREFETCH bulk copy: a write's buffer; a readv/writev's iovec array
+/// and, for writev, the buffers it points at — at most [`MAX_PREFETCH`] bytes.
+/// An unreadable range is simply left out: the server then copies it in by
+/// callback and reports the fault itself.
+fn transfer_bulk(op: translation::Op, a1: u64, a2: u64) -> Vec<(u64, Vec<u8>)> {
+    use translation::Op;
+    let read = |addr: u64, len: usize| {
+        let mut v = alloc::vec![0u8; len];
+        let ok = len > 0
+            && unsafe { copy_from_user_safe(v.as_mut_ptr(), addr as *const u8, len).is_ok() };
+        ok.then_some(v)
+    };
+    let mut out = Vec::new();
+    match op {
+        Op::Write | Op::Sendto => {
+            if let Some(b) = read(a1, (a2 as usize).min(MAX_PREFETCH)) {
+                out.push((a1, b));
+            }
+        }
+        Op::Readv | Op::Writev => {
+            let iov_len = (a2 as usize).saturating_mul(16);
+            if iov_len > MAX_PREFETCH {
+                return out;
+            }
+            let Some(iov) = read(a1, iov_len) else {
+                return out;
+            };
+            let mut budget = MAX_PREFETCH - iov_len;
+            let bufs: Vec<(u64, usize)> = iov
+                .chunks_exact(16)
+                .map(|e| {
+                    let base = u64::from_le_bytes(e[0..8].try_into().unwrap());
+                    (base, u64::from_le_bytes(e[8..16].try_into().unwrap()) as usize)
+                })
+                .collect();
+            out.push((a1, iov));
+            if matches!(op, Op::Writev) {
+                for (base, len) in bufs {
+                    let n = len.min(budget);
+                    if n == 0 {
+                        break;
+                    }
+                    if let Some(b) = read(base, n) {
+                        budget -= n;
+                        out.push((base, b));
+                    }
+                }
+            }
+        }
+        _ => {}
+    }
+    out
+}
+
 // Linux aarch64 `struct msghdr` field offsets (LP64): name@0, namelen@8 (u32),
 // iov@16, iovlen@24 (size_t), control@32, controllen@40 (size_t), flags@48 (u32).
 const MSGHDR_NAME: usize = 0;
@@ -1136,6 +1531,7 @@ impl PipeIo for KernelPipeIo {
             let dt = crate::timer::uptime_us().saturating_sub(t0);
             RUMP_WAIT_US.fetch_add(dt, Ordering::Relaxed);
             RUMP_WAIT_N.fetch_add(1, Ordering::Relaxed);
+            RUMP_WAIT_HIST.record(dt);
         }
     }
     fn now_us(&mut self) -> u64 {
@@ -1143,6 +1539,154 @@ impl PipeIo for KernelPipeIo {
     }
 }
 
+// ── shared-memory channel (akuma_rump::shmchan) ───────────────────────────
+
+const SHM_PAGES: usize = shmchan::SHM_BYTES / 4096;
+
+/// One box's channel region: contiguous kernel pages, reached by the kernel
+/// through the direct map and by `rump_server` through its `mmap` of fd 3.
+/// The mapping holds its own reference on each frame, so dropping the last
+/// `Arc` frees only what the server no longer maps.
+struct ShmChan {
+    base: PhysFrame,
+    /// `rump_server` mapped the region. Set before the server can write to
+    /// it, so a doorbell seen before this is set is plain pipe traffic.
+    mapped: AtomicBool,
+}
+
+/// Channel regions by the server's rx pipe (`px`), for its fd-3 `mmap`.
+static SHM_CHANS: Spinlock<BTreeMap<u32, Arc<ShmChan>>> = Spinlock::new(BTreeMap::new());
+
+impl ShmChan {
+    fn alloc() -> Option<Arc<Self>> {
+        let base = crate::pmm::alloc_pages_contiguous_zeroed(SHM_PAGES)?;
+        let chan = Arc::new(Self { base, mapped: AtomicBool::new(false) });
+        shmchan::init(&mut chan.mem()).ok()?;
+        Some(chan)
+    }
+
+    fn mem(&self) -> KernelShm {
+        KernelShm { base: akuma_exec::mmu::phys_to_virt(self.base.addr) as usize }
+    }
+}
+
+impl Drop for ShmChan {
+    fn drop(&mut self) {
+        for i in 0..SHM_PAGES {
+            crate::pmm::free_page(PhysFrame::new(self.base.addr + i * 4096));
+        }
+    }
+}
+
+/// `sys_mmap` of a channel fd whose rx pipe is `rx`: the frames of its region,
+/// if the kernel set one up and the server has not mapped it yet. The caller
+/// maps all of them shared, then reports back with [`shm_chan_mapped`].
+pub fn shm_chan_frames(rx: u32) -> Option<Vec<PhysFrame>> {
+    let chans = SHM_CHANS.lock();
+    let chan = chans.get(&rx).filter(|c| !c.mapped.load(Ordering::Acquire))?;
+    Some((0..SHM_PAGES).map(|i| PhysFrame::new(chan.base.addr + i * 4096)).collect())
+}
+
+/// The server mapped the region of channel `rx`: the kernel end switches to it.
+pub fn shm_chan_mapped(rx: u32) {
+    if let Some(chan) = SHM_CHANS.lock().get(&rx) {
+        chan.mapped.store(true, Ordering::Release);
+    }
+}
+
+/// A channel region through the kernel's direct map.
+struct KernelShm {
+    base: usize,
+}
+
+impl RingMem for KernelShm {
+    fn read(&mut self, off: usize, out: &mut [u8]) -> bool {
+        if off + out.len() > shmchan::SHM_BYTES {
+            return false;
+        }
+        unsafe { core::ptr::copy_nonoverlapping((self.base + off) as *const u8, out.as_mut_ptr(), out.len()) };
+        true
+    }
+    fn write(&mut self, off: usize, data: &[u8]) -> bool {
+        if off + data.len() > shmchan::SHM_BYTES {
+            return false;
+        }
+        unsafe { core::ptr::copy_nonoverlapping(data.as_ptr(), (self.base + off) as *mut u8, data.len()) };
+        true
+    }
+}
+
+/// The kernel end of a sysproxy channel. Until the server's banner arrives it
+/// does not know which way the server talks: a server that maps the region
+/// does so before writing anything, so a byte on `rd` while the region is
+/// still unmapped means plain pipes (an older `rump_server`, or no region).
+struct ChanTransport {
+    pipe: PipeTransport<KernelPipeIo>,
+    chan: Option<Arc<ShmChan>>,
+    shm: Option<ShmTransport<KernelShm, KernelPipeIo>>,
+    resolved: bool,
+}
+
+impl ChanTransport {
+    fn new(px: u32, py: u32, timeout_us: u64, chan: Option<Arc<ShmChan>>) -> Self {
+        Self {
+            pipe: PipeTransport { io: KernelPipeIo, wr: px, rd: py, timeout_us },
+            resolved: chan.is_none(),
+            chan,
+            shm: None,
+        }
+    }
+
+    /// The region the channel runs over, once resolved to it.
+    fn shm(&self) -> Option<Arc<ShmChan>> {
+        self.shm.as_ref().and(self.chan.clone())
+    }
+
+    fn resolve(&mut self) -> Result<(), TransportErr> {
+        let rd = self.pipe.rd;
+        let deadline = crate::timer::uptime_us() + self.pipe.timeout_us;
+        while !self.resolved {
+            let Some(chan) = &self.chan else { break };
+            let mapped = || chan.mapped.load(Ordering::Acquire);
+            if mapped() {
+                self.shm = Some(ShmTransport {
+                    mem: chan.mem(),
+                    io: KernelPipeIo,
+                    end: ShmEnd::new(),
+                    wr: self.pipe.wr,
+                    rd,
+                    timeout_us: self.pipe.timeout_us,
+                });
+                self.resolved = true;
+            } else if pipe::pipe_can_read(rd) {
+                // Re-check: the server may have mapped and rung since.
+                self.resolved = !mapped();
+            } else if crate::timer::uptime_us() >= deadline {
+                return Err(TransportErr);
+            } else {
+                KernelPipeIo.wait_readable(rd, deadline);
+            }
+        }
+        Ok(())
+    }
+}
+
+impl Transport for ChanTransport {
+    fn read_exact(&mut self, buf: &mut [u8]) -> Result<(), TransportErr> {
+        self.resolve()?;
+        match &mut self.shm {
+            Some(t) => t.read_exact(buf),
+            None => self.pipe.read_exact(buf),
+        }
+    }
+    fn write_all(&mut self, buf: &[u8]) -> Result<(), TransportErr> {
+        match &mut self.shm {
+            Some(t) => t.write_all(buf),
+            None => self.pipe.write_all(buf),
+        }
+    }
+}
+
 /// A no-op [`ClientMem`] for syscalls with no pointer args (e.g. `socket()`).
 /// The real per-box accessor over the calling process's user VA arrives with the
 /// interception wiring.
@@ -1221,7 +1765,7 @@ pub fn run_demo() {
 /// rump fd, or a short failure reason (errno baked in).
 fn drive_socket(px: u32, py: u32) -> Result<i64, alloc::string::String> {
     use alloc::format;
-    let chan = PipeTransport { io: KernelPipeIo, wr: px, rd: py, timeout_us: READ_TIMEOUT_US };
+    let chan = ChanTransport::new(px, py, READ_TIMEOUT_US, None);
     let mut client = Client::connect(chan, b"akuma-kernel")
         .map_err(|e| format!("handshake errno {e}"))?;
     crate::console::print("[Test] rump_sysproxy: handshake OK; rump_sys_socket...\n");
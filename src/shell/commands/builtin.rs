@@ -123,6 +123,14 @@ impl Command for StatsCommand {
                 "Network Statistics:\r\n  Connections: {connections}\r\n  Bytes RX: {bytes_rx}\r\n  Bytes TX: {bytes_tx}\r\n"
             );
             let _ = stdout.write(stats.as_bytes()).await;
+            let tap = network::tap_stats();
+            if tap.rx_frames + tap.tx_frames > 0 {
+                let tap = format!(
+                    "  Tap RX: {} frames {} bytes\r\n  Tap TX: {} frames {} bytes\r\n  Tap bounce: {} allocs, {} busy\r\n",
+                    tap.rx_frames, tap.rx_bytes, tap.tx_frames, tap.tx_bytes, tap.bounce_allocs, tap.bounce_busy
+                );
+                let _ = stdout.write(tap.as_bytes()).await;
+            }
             Ok(())
         })
     }
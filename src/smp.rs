@@ -1549,6 +1549,8 @@ extern "C" fn secondary_main(cfg_pa: usize, core_idx: usize) -> ! {
         }
     }
     secondary_gic_init(core_idx);
+    // EL0 counter access for the time page (CNTKCTL_EL1 is per-PE).
+    crate::timer::enable_el0_counter_access();
     // Arm this core's virtual timer for periodic heartbeat-tick wakeups (so the
     // loop can `wfe`-sleep yet keep liveness advancing). CNTV_CVAL = now + interval;
     // CNTV_CTL = 1 (enable, unmasked). The IRQ handler re-arms on each tick.
@@ -2185,6 +2187,7 @@ fn secondary_park_and_await_init(cfg: &MachineConfig, core_idx: usize, percpu: u
         unsafe { core::arch::asm!("msr tpidrro_el0, {0}", in(reg) percpu, options(nomem, nostack)) };
     }
     secondary_gic_init(core_idx);
+    crate::timer::enable_el0_counter_access();
     // SAFETY: CNTV* are EL1-accessible; arm a periodic tick (re-armed by smp_irq_handler).
     unsafe {
         let now: u64;
@@ -2269,6 +2272,12 @@ fn secondary_steady_state(cfg: &MachineConfig, idx: usize, percpu: usize, mut sm
     secondary_gic_init(idx);
     scheduler_sgi_enable(idx);
 
+    // The PMU cycle counter behind `PR_AKUMA_EL0_COUNTERS` is per PE, like CNTKCTL:
+    // start this core's before it runs any EL0 process.
+    if crate::config::EL0_COUNTERS_PRCTL_ENABLED {
+        akuma_exec::el0_counters::init();
+    }
+
     // Enable REAL preemptive scheduling on this secondary. Two changes vs. the bringup
     // default: (1) make the idle boot thread preemptible — it's a pure idle/heartbeat loop
     // here (not the BSP's async/network runner), and while it stays cooperative the timer
@@ -2677,6 +2686,7 @@ fn secondary_init_local_nic(idx: usize) {
         is_current_interrupted: akuma_exec::process::is_current_interrupted,
         rng_fill: secondary_net_rng_stub,
         current_thread_id: || akuma_exec::threading::current_thread_id() as u32,
+        current_cpu: akuma_exec::threading::current_cpu,
     });
     // NIC2 is on virtio-mmio-bus.5: DEV_VIRTIO_VA + 5 * 0x200 (the virtio-mmio slot stride).
     let addr = akuma_exec::mmu::DEV_VIRTIO_VA + 5 * 0x200;
@@ -525,29 +525,12 @@ pub fn sys_read(fd_num: u64, buf_ptr: u64, count: usize) -> u64 {
             }
         }
         #[cfg(feature = "rump")]
-        akuma_exec::process::FileDescriptor::Tap { nonblock } => {
+        akuma_exec::process::FileDescriptor::Tap { nonblock, bounce } => {
             // Pull one L2 frame. O_NONBLOCK → EAGAIN when none ready; otherwise
-            // BLOCK cooperatively (yield to the scheduler, re-poll the tap) until a
-            // frame arrives — so the rump virtif RX thread does a plain blocking
-            // read() with no busy-wait. Akuma's net is poll-based (no RX IRQ), so
-            // this mirrors how socket recv blocks (akuma-net wait_until).
-            let mut temp = alloc::vec![0u8; count];
-            let got = if nonblock {
-                akuma_net::rump_tap::read_frame(&mut temp)
-            } else {
-                // Block until a frame (None timeout); None only on interrupt → EAGAIN.
-                akuma_net::rump_tap::read_frame_blocking(&mut temp, None)
-            };
-            match got {
-                Some(n) => {
-                    if n > 0
-                        && unsafe { copy_to_user_safe(buf_ptr as *mut u8, temp.as_ptr(), n).is_err() } {
-                            return EFAULT;
-                        }
-                    n as u64
-                }
-                None => EAGAIN,
-            }
+            // BLOCK until a frame arrives — sleeping on NIC1's RX interrupt where
+            // it is wired (the BSP tap), else re-polling between yields — so the
+            // rump virtif RX thread does a plain blocking read() with no busy-wait.
+            super::tap::tap_read(bounce, buf_ptr, count, nonblock)
         }
         #[cfg(feature = "sc-timerfd")]
         akuma_exec::process::FileDescriptor::TimerFd(timer_id) => {
@@ -710,6 +693,13 @@ pub(super) fn sys_write(fd_num: u64, buf_ptr: u64, count: usize) -> u64 {
         0
     };
 
+    // One write() == one L2 frame, staged in the process's TX bounce buffer
+    // rather than a fresh chunk buffer.
+    #[cfg(feature = "rump")]
+    if let akuma_exec::process::FileDescriptor::Tap { bounce, .. } = fd {
+        return super::tap::tap_write(bounce, buf_ptr, count);
+    }
+
     let chunk_size = count.min(64 * 1024);
     let mut kernel_buf = alloc::vec![0u8; chunk_size];
     let mut total_written = 0;
@@ -854,17 +844,6 @@ pub(super) fn sys_write(fd_num: u64, buf_ptr: u64, count: usize) -> u64 {
                 }
             }
             akuma_exec::process::FileDescriptor::DevNull | akuma_exec::process::FileDescriptor::DevUrandom | akuma_exec::process::FileDescriptor::DevZero => this_chunk as u64,
-            #[cfg(feature = "rump")]
-            akuma_exec::process::FileDescriptor::Tap { .. } => {
-                // One write() == one L2 frame. Ethernet frames are <2 KB, so a
-                // frame never exceeds the 64 KB chunk (single iteration).
-                if let Ok(n) = akuma_net::rump_tap::write_frame(buf_slice) {
-                    n as u64
-                } else {
-                    if total_written > 0 { return total_written as u64; }
-                    return EIO;
-                }
-            }
             akuma_exec::process::FileDescriptor::DevDsp => {
                 // Blocking PCM playback. The audio driver re-chunks into bounded
                 // periods internally; consumes the whole slice or errors.
@@ -1015,6 +994,8 @@ pub(super) fn sys_dup(oldfd: u32) -> u64 {
             super::pipe::pipe_clone_ref(*rx, false);
             super::pipe::pipe_clone_ref(*tx, true);
         }
+        #[cfg(feature = "rump")]
+        akuma_exec::process::FileDescriptor::Tap { bounce, .. } => super::tap::tap_clone_ref(*bounce),
         _ => {}
     }
     let newfd = proc.alloc_fd(entry);
@@ -1048,6 +1029,8 @@ pub(super) fn sys_dup3(oldfd: u32, newfd: u32, flags: u32) -> u64 {
             super::pipe::pipe_clone_ref(*rx, false);
             super::pipe::pipe_clone_ref(*tx, true);
         }
+        #[cfg(feature = "rump")]
+        akuma_exec::process::FileDescriptor::Tap { bounce, .. } => super::tap::tap_clone_ref(*bounce),
         _ => {}
     }
 
@@ -1075,6 +1058,8 @@ pub(super) fn sys_dup3(oldfd: u32, newfd: u32, flags: u32) -> u64 {
             akuma_exec::process::FileDescriptor::EventFd(efd_id) => {
                 super::eventfd::eventfd_close(efd_id);
             }
+            #[cfg(feature = "rump")]
+            akuma_exec::process::FileDescriptor::Tap { bounce, .. } => super::tap::tap_close(bounce),
             _ => {}
         }
     }
@@ -1194,9 +1179,13 @@ pub(super) fn sys_openat(dirfd: i32, path_ptr: u64, flags: u32, mode: u32) -> u6
         if !akuma_net::rump_tap::is_ready() {
             return ENODEV;
         }
+        // Every open starts with bare frames: a restarted rump_server must
+        // not inherit its predecessor's TAPSETVNET.
+        let _ = akuma_net::rump_tap::set_vnet(false);
         if let Some(proc) = akuma_exec::process::current_process() {
             let fd = proc.alloc_fd(akuma_exec::process::FileDescriptor::Tap {
                 nonblock: flags & 0x800 != 0, // O_NONBLOCK
+                bounce: super::tap::tap_open(),
             });
             if flags & akuma_exec::process::open_flags::O_CLOEXEC != 0 {
                 proc.set_cloexec(fd);
@@ -1326,6 +1315,11 @@ pub fn sys_close(fd: u32) -> u64 {
                 akuma_exec::process::FileDescriptor::DevDsp => {
                     crate::audio::stop();
                 }
+                #[cfg(feature = "rump")]
+                akuma_exec::process::FileDescriptor::Tap { bounce, .. } => {
+                    super::tap::ring_close(proc.tgid);
+                    super::tap::tap_close(bounce);
+                }
                 // Multikernel (R4b.5): forward the close so the owner frees the file/socket.
                 #[cfg(kernel_smp)]
                 akuma_exec::process::FileDescriptor::RemoteFd { handle, .. } => {
@@ -1374,6 +1368,11 @@ pub fn sys_close_range(first: u32, last: u32, flags: u32) -> u64 {
                 akuma_exec::process::FileDescriptor::EventFd(efd_id) => {
                     super::eventfd::eventfd_close(efd_id);
                 }
+                #[cfg(feature = "rump")]
+                akuma_exec::process::FileDescriptor::Tap { bounce, .. } => {
+                    super::tap::ring_close(proc.tgid);
+                    super::tap::tap_close(bounce);
+                }
                 #[cfg(kernel_smp)]
                 akuma_exec::process::FileDescriptor::RemoteFd { handle, .. } => {
                     let _ = crate::smp::fwd_close(handle);
@@ -1966,6 +1965,8 @@ pub(super) fn sys_fcntl(fd: u32, cmd: u32, arg: u64) -> u64 {
             match &entry {
                 akuma_exec::process::FileDescriptor::PipeWrite(id) => super::pipe::pipe_clone_ref(*id, true),
                 akuma_exec::process::FileDescriptor::PipeRead(id) => super::pipe::pipe_clone_ref(*id, false),
+                #[cfg(feature = "rump")]
+                akuma_exec::process::FileDescriptor::Tap { bounce, .. } => super::tap::tap_clone_ref(*bounce),
                 _ => {}
             }
             let new_fd = proc.alloc_fd_from(arg as u32, entry);
@@ -186,6 +186,44 @@ fn mmap_eager_to_lazy_fallback(
     mmap_addr as u64
 }
 
+/// Map a sysproxy channel region (see `rump_proxy::ShmChan`) into `proc`:
+/// all of it, shared, writable, from offset 0. Each frame gains a reference
+/// for the mapping, so the server's munmap/exit drops only its own and the
+/// kernel's view stays valid. The frames are marked shared
+/// (`pmm::shared_ref_inc`), not copy-on-write, so neither a fork of the
+/// server nor a write fault can give it a private copy of the rings.
+#[cfg(feature = "rump")]
+fn mmap_sysproxy_chan(
+    proc: &akuma_exec::process::Process,
+    rx: u32, frames: alloc::vec::Vec<akuma_exec::PhysFrame>,
+    len: usize, prot: u32, flags: u32, offset: usize,
+) -> u64 {
+    let pages = frames.len();
+    if len.div_ceil(4096) != pages || flags & MAP_SHARED == 0 || prot & PROT_WRITE == 0 || offset != 0
+        || flags & (MAP_FIXED | MAP_FIXED_NOREPLACE) != 0
+    {
+        return EINVAL;
+    }
+    let Some(mmap_addr) = proc.memory.alloc_mmap(pages * 4096) else { return ENOMEM };
+    let page_flags = akuma_exec::mmu::user_flags::from_prot(prot);
+    for (i, frame) in frames.iter().enumerate() {
+        crate::pmm::shared_ref_inc(frame.addr);
+        let (table_frames, _) = unsafe {
+            akuma_exec::mmu::map_user_page_no_flush(mmap_addr + i * 4096, frame.addr, page_flags)
+        };
+        proc.address_space.track_user_frame(*frame);
+        for tf in table_frames {
+            proc.address_space.track_page_table_frame(tf);
+        }
+    }
+    akuma_exec::mmu::flush_tlb_range(mmap_addr, pages);
+    proc.vm_with_regions(|r| r.push((mmap_addr, frames)));
+    crate::rump_proxy::shm_chan_mapped(rx);
+    crate::tprint!(128, "[mmap] pid={} fd-chan rx={} len=0x{:x} = 0x{:x} (sysproxy shm)\n",
+        proc.pid, rx, len, mmap_addr);
+    mmap_addr as u64
+}
+
 pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32, offset: usize) -> u64 {
     if len == 0 { return EINVAL; }
     let pages = len.div_ceil(4096);
@@ -212,6 +250,28 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
         None => return ESRCH,
     };
 
+    // rump_server's sysproxy channel (fd 3): the kernel-owned ring region,
+    // mapped shared rather than fresh pages (rump_proxy::shm_chan_frames).
+    #[cfg(feature = "rump")]
+    if flags & MAP_ANONYMOUS == 0 && fd >= 0
+        && let Some(akuma_exec::process::FileDescriptor::UnixSocket { rx, .. }) = proc.get_fd(fd as u32)
+        && let Some(frames) = crate::rump_proxy::shm_chan_frames(rx)
+    {
+        return mmap_sysproxy_chan(proc, rx, frames, len, prot, flags, offset);
+    }
+
+    // /dev/net/tap0: the shared packet ring (syscall::tap). Eager anonymous
+    // pages, registered with the tap once mapped.
+    #[cfg(feature = "rump")]
+    let tap_ring = flags & MAP_ANONYMOUS == 0 && fd >= 0
+        && matches!(proc.get_fd(fd as u32), Some(akuma_exec::process::FileDescriptor::Tap { .. }));
+    #[cfg(not(feature = "rump"))]
+    let tap_ring = false;
+    #[cfg(feature = "rump")]
+    if tap_ring && !super::tap::ring_mmap_ok(len, prot, flags, offset) {
+        return EINVAL;
+    }
+
     let mmap_addr = if (is_fixed || is_fixed_noreplace) && addr != 0 {
         // Reject MAP_FIXED mappings that overlap the kernel identity-map range.
         // The Go runtime uses MAP_FIXED to commit its heap arenas; without this
@@ -238,7 +298,7 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
         return ENOMEM;
     };
 
-    let is_file_backed = flags & MAP_ANONYMOUS == 0 && fd >= 0;
+    let is_file_backed = flags & MAP_ANONYMOUS == 0 && fd >= 0 && !tap_ring;
 
     // Writable MAP_SHARED on a file-backed mapping has true shared-page semantics:
     // writes through the mapping must become visible in the file. Akuma has no
@@ -248,15 +308,16 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
     // writes to flush, so it stays on the cheap lazy MAP_PRIVATE-equivalent path.
     let is_shared_writable = (flags & MAP_SHARED != 0) && is_file_backed && (prot & PROT_WRITE != 0);
 
-    // MAP_POPULATE requests eager pre-faulting; it suppresses lazy allocation.
-    // MADV_WILLNEED can also trigger pre-faulting on existing lazy regions.
+    // MAP_POPULATE requests eager pre-faulting; it suppresses lazy allocation
+    // of anonymous memory (lazy file mappings are populated right after they
+    // are registered, below). MADV_WILLNEED pre-faults existing lazy regions.
     // Anonymous private mappings above MMAP_EAGER_MAX_PAGES are demand-paged
     // (zero-fill on first touch) rather than eagerly allocated+zeroed+mapped.
     // This is the "lazy/zero-on-demand population" win from COW_OPTIMIZATIONS.md:
     // pages that are never touched are never allocated, which cuts the physical
     // footprint (the rustc trace ended near OOM from eager over-commit). Small
     // mappings stay eager — see config::MMAP_EAGER_MAX_PAGES for the rationale.
-    let use_lazy = !is_file_backed && !map_populate && (
+    let use_lazy = !is_file_backed && !map_populate && !tap_ring && (
         is_lazy ||
         (flags & MAP_NORESERVE != 0) ||
         pages > crate::config::MMAP_EAGER_MAX_PAGES
@@ -291,6 +352,12 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
                 proc.tgid, mmap_addr, pages * 4096, page_flags, source);
             crate::tprint!(192, "[mmap] pid={} fd={} file={} off={} len=0x{:x} = 0x{:x} (lazy-file, {} regions)\n",
                 proc.pid, fd, &path, offset, len, mmap_addr, count);
+            // MAP_POPULATE: read the whole mapping in now, through the same
+            // batched (and, for large read-only files, 2 MB block) path a
+            // faulting reader takes — minus the faults.
+            if map_populate {
+                populate_lazy_range(proc, mmap_addr, mmap_addr + pages * 4096);
+            }
             return mmap_addr as u64;
         }
 
@@ -313,10 +380,10 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
         if reclaimed > 0 {
             if let Some(b) = crate::pmm::alloc_pages_zeroed(pages) {
                 b
-            } else if is_shared_writable {
+            } else if is_shared_writable || tap_ring {
                 // A writable MAP_SHARED mapping must stay eager so its pages are
                 // tracked for writeback; the lazy fallback can't do that, so fail
-                // rather than silently drop writes.
+                // rather than silently drop writes. (The tap ring likewise.)
                 return ENOMEM;
             } else {
                 // Still short of a contiguous eager batch: fall back to a lazy
@@ -325,13 +392,12 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
                 // for both anonymous and file-backed mappings.
                 return mmap_eager_to_lazy_fallback(proc, is_file_backed, fd, offset, len, mmap_addr, pages, page_flags);
             }
-        } else if is_shared_writable {
+        } else if is_shared_writable || tap_ring {
             return ENOMEM;
         } else {
             return mmap_eager_to_lazy_fallback(proc, is_file_backed, fd, offset, len, mmap_addr, pages, page_flags);
         }
     };
-    let _ = map_populate; // populate is now subsumed by the lazy fallback above
     let mut frames = alloc::vec::Vec::with_capacity(pages);
     for (i, frame) in frame_batch.into_iter().enumerate() {
         let (table_frames, _) = unsafe {
@@ -394,6 +460,12 @@ pub(super) fn sys_mmap(addr: usize, len: usize, prot: u32, flags: u32, fd: i32,
 
     proc.vm_with_regions(|r| r.push((mmap_addr, frames)));
 
+    #[cfg(feature = "rump")]
+    if tap_ring && !super::tap::ring_mapped(proc.tgid, mmap_addr) {
+        let _ = sys_munmap(mmap_addr, len);
+        return EFAULT;
+    }
+
     mmap_addr as u64
 }
 
@@ -506,71 +578,415 @@ pub(super) fn sys_mremap(old_addr: usize, old_size: usize, new_size: usize, flag
     } else { ENOMEM }
 }
 
+/// Read file data for a lazy region into `buf` — by inode when the region
+/// resolved one at mmap time, else by path — looping over short reads.
+/// Returns the bytes read; the rest of `buf` is left untouched.
+fn read_lazy_file(path: &str, inode: u32, off: usize, buf: &mut [u8]) -> usize {
+    let mut done = 0usize;
+    while done < buf.len() {
+        let r = if inode != 0 {
+            crate::vfs::read_at_by_inode(path, inode, off + done, &mut buf[done..])
+        } else {
+            crate::vfs::read_at(path, off + done, &mut buf[done..])
+        };
+        match r {
+            Ok(n) if n > 0 => done += n,
+            _ => break,
+        }
+    }
+    done
+}
+
+/// Clean D-cache and invalidate I-cache to PoU over freshly filled frames at
+/// kernel VA `kva`, before they are mapped executable. By the kernel alias,
+/// not the user VA: the user page isn't mapped yet, and an IC IVAU on it
+/// translation-faults on real hardware / HVF. The caller issues the final
+/// `dsb ish; isb` once its mappings are in.
+fn sync_icache_kva(kva: usize, len: usize) {
+    for off in (0..len).step_by(64) {
+        unsafe { core::arch::asm!("dc cvau, {}", in(reg) kva + off); }
+    }
+    unsafe { core::arch::asm!("dsb ish"); }
+    for off in (0..len).step_by(64) {
+        unsafe { core::arch::asm!("ic ivau, {}", in(reg) kva + off); }
+    }
+}
+
+/// Whether a file-backed lazy region mapped with `map_flags` may take 2 MB
+/// block mappings (`config::MMAP_FILE_BLOCKS`): read-only for EL0, since a
+/// block is never written through, only split or evicted.
+fn file_blocks_ok(map_flags: u64) -> bool {
+    use akuma_exec::mmu::flags::AP_RO_ALL;
+    crate::config::MMAP_FILE_BLOCKS && map_flags & AP_RO_ALL == AP_RO_ALL
+}
+
+/// End of a file-backed readahead window `[page_va, ra_end)` in a region
+/// ending at `region_end`. When blocks apply and the window stops short of the
+/// region end, it is cut back to a 2 MB boundary: the next window then starts
+/// on a whole chunk a block can take, instead of one already partly mapped by
+/// pages. (`lazy_region_readahead` counts a fault inside a cut window as
+/// sequential, so the window keeps growing.)
+pub fn file_window_end(page_va: usize, ra_end: usize, region_end: usize, map_flags: u64) -> usize {
+    if !file_blocks_ok(map_flags) || ra_end >= region_end {
+        return ra_end;
+    }
+    let cut = ra_end & !(akuma_exec::mmu::BLOCK_2MB - 1);
+    if cut > page_va { cut } else { ra_end }
+}
+
+/// Demand-fill the unmapped pages of `[start, end)` of a file-backed lazy
+/// region from `source`, in the current address space (owned by `as_owner`):
+/// one batched allocation clamped to the user readahead budget, a `no_flush`
+/// map per page, one TLB flush over the span. Returns the pages this call
+/// mapped and whether `start` is mapped now — by us, or by a sibling thread
+/// that raced us to it.
+fn fill_file_pages(
+    as_owner: u32,
+    source: &akuma_exec::process::LazySource,
+    map_flags: u64,
+    is_exec: bool,
+    start: usize,
+    end: usize,
+) -> (usize, bool) {
+    let akuma_exec::process::LazySource::File { path, inode, file_offset, filesz, segment_va } = source else {
+        return (0, false);
+    };
+
+    // Count how many pages actually need allocation (skip mapped), then clamp
+    // the batch so file-backed demand paging never drains the PMM below
+    // USER_PAGE_RESERVE — the floor the anonymous path respects via
+    // alloc_page_zeroed_user(). Without this an mmap larger than RAM drains
+    // PMM to 0, and a later kernel-side alloc (IRQ/scheduler, no current
+    // process) panics into a whole-kernel brk #1 abort instead of SIGSEGV-ing
+    // the offending process.
+    let mut needed = 0usize;
+    let mut va = start;
+    while va < end {
+        if !akuma_exec::mmu::is_current_user_page_mapped(va) {
+            needed += 1;
+        }
+        va += 4096;
+    }
+    let needed = needed.min(crate::pmm::user_readahead_budget(crate::pmm::free_count()));
+
+    // Batch-allocate all needed frames in one lock acquisition.
+    let pool = if needed > 0 {
+        crate::pmm::alloc_pages_zeroed(needed).unwrap_or_else(|| {
+            // Fallback: allocate what we can one at a time, still honouring
+            // the reserve so we can't starve the kernel.
+            let mut v = alloc::vec::Vec::new();
+            for _ in 0..needed {
+                match crate::pmm::alloc_page_zeroed_user() {
+                    Some(f) => v.push(f),
+                    None => break,
+                }
+            }
+            v
+        })
+    } else {
+        alloc::vec::Vec::new()
+    };
+    let mut pool_idx = 0usize;
+
+    let owner = akuma_exec::process::lookup_process(as_owner);
+    let mut mapped = 0usize;
+    let mut start_mapped = false;
+    let mut last_va = start;
+    let mut cur_va = start;
+    while cur_va < end {
+        if akuma_exec::mmu::is_current_user_page_mapped(cur_va) {
+            start_mapped |= cur_va == start;
+            cur_va += 4096;
+            continue;
+        }
+        if pool_idx >= pool.len() {
+            break;
+        }
+        let pf = pool[pool_idx];
+        pool_idx += 1;
+
+        let data_start = core::cmp::max(cur_va, *segment_va);
+        let data_end = core::cmp::min(cur_va + 4096, segment_va + filesz);
+        let kva = akuma_exec::mmu::phys_to_virt(pf.addr);
+        if data_start < data_end {
+            let buf = unsafe {
+                core::slice::from_raw_parts_mut(kva.add(data_start - cur_va), data_end - data_start)
+            };
+            read_lazy_file(path, *inode, file_offset + (data_start - segment_va), buf);
+        }
+        if is_exec {
+            sync_icache_kva(kva as usize, 4096);
+        }
+
+        // Use no_flush variant — we batch the TLB invalidation after the loop.
+        let (table_frames, installed) = unsafe {
+            akuma_exec::mmu::map_user_page_no_flush(cur_va, pf.addr, map_flags)
+        };
+        if let Some(ref o) = owner {
+            for tf in table_frames { o.address_space.track_page_table_frame(tf); }
+        } else {
+            for tf in table_frames { crate::pmm::free_page(tf); }
+        }
+        if installed && let Some(ref o) = owner {
+            o.address_space.track_user_frame(pf);
+        } else {
+            // Lost the race to a sibling (the page IS mapped now) or the
+            // owner exited under us.
+            crate::pmm::free_page(pf);
+        }
+        if installed {
+            mapped += 1;
+            last_va = cur_va;
+        }
+        start_mapped |= cur_va == start;
+        cur_va += 4096;
+    }
+
+    // Return unused frames from the batch back to PMM.
+    for &pf in &pool[pool_idx..] {
+        crate::pmm::free_page(pf);
+    }
+    // One flush for the whole span instead of N dsb+tlbi+dsb+isb sequences.
+    if mapped > 0 {
+        akuma_exec::mmu::flush_tlb_range(start, (last_va - start) / 4096 + 1);
+    }
+    (mapped, start_mapped)
+}
+
+/// Map the 2 MB chunk at `block_va` (2 MB aligned, wholly inside the region)
+/// of a read-only file-backed lazy region with one block entry: one aligned
+/// allocation, one file read, one TLB entry for the process to hit instead of
+/// 512. Returns `false` — nothing mapped, nothing held — if blocks don't
+/// apply ([`file_blocks_ok`]), any page of the chunk is already mapped, the
+/// readahead budget can't spare the chunk twice over, or no aligned run is
+/// free; the caller then fills the chunk page by page.
+fn map_file_block(
+    as_owner: u32,
+    source: &akuma_exec::process::LazySource,
+    map_flags: u64,
+    is_exec: bool,
+    block_va: usize,
+) -> bool {
+    const BLOCK: usize = akuma_exec::mmu::BLOCK_2MB;
+    const BLOCK_PAGES: usize = BLOCK / 4096;
+    let akuma_exec::process::LazySource::File { path, inode, file_offset, filesz, segment_va } = source else {
+        return false;
+    };
+    if !file_blocks_ok(map_flags)
+        || !akuma_exec::mmu::current_user_block_slot_free(block_va)
+        || crate::pmm::user_readahead_budget(crate::pmm::free_count()) < 2 * BLOCK_PAGES
+    {
+        return false;
+    }
+    let Some(base) = crate::pmm::alloc_pages_aligned(BLOCK_PAGES, BLOCK_PAGES) else {
+        return false;
+    };
+
+    // Not zeroed by the allocator: read the file part, zero the rest.
+    let kva = akuma_exec::mmu::phys_to_virt(base.addr);
+    let block = unsafe { core::slice::from_raw_parts_mut(kva, BLOCK) };
+    let data_start = core::cmp::min(core::cmp::max(block_va, *segment_va) - block_va, BLOCK);
+    let data_end = core::cmp::min(block_va + BLOCK, segment_va + filesz).saturating_sub(block_va);
+    let mut filled = data_start;
+    if data_start < data_end {
+        filled += read_lazy_file(path, *inode, file_offset + (block_va + data_start - segment_va),
+            &mut block[data_start..data_end]);
+    }
+    block[..data_start].fill(0);
+    block[filled..].fill(0);
+    if is_exec {
+        sync_icache_kva(kva as usize, BLOCK);
+    }
+
+    let (table_frames, installed) = unsafe {
+        akuma_exec::mmu::map_user_block_no_flush(block_va, base.addr, map_flags)
+    };
+    let owner = akuma_exec::process::lookup_process(as_owner);
+    if let Some(ref o) = owner {
+        for tf in table_frames { o.address_space.track_page_table_frame(tf); }
+    } else {
+        for tf in table_frames { crate::pmm::free_page(tf); }
+    }
+    if installed && let Some(ref o) = owner {
+        // Tracked page by page, so munmap/exit/reclaim free them as pages.
+        for i in 0..BLOCK_PAGES {
+            o.address_space.track_user_frame(crate::pmm::PhysFrame::new(base.addr + i * 4096));
+        }
+    } else {
+        crate::pmm::free_pages_contiguous(base, BLOCK_PAGES);
+    }
+    if !installed {
+        return false;
+    }
+    akuma_exec::mmu::flush_tlb_range(block_va, 1);
+    true
+}
+
+/// Fill `[start, end)` of a file-backed lazy region (see [`fill_file_pages`]),
+/// chunk by chunk: a 2 MB-aligned chunk the range covers whole goes in as one
+/// block when [`map_file_block`] takes it, everything else page by page.
+/// Shared by the data/instruction abort paths and `MADV_WILLNEED`/
+/// `MAP_POPULATE`. Returns `(pages mapped, start mapped)`.
+pub fn fill_file_range(
+    as_owner: u32,
+    source: &akuma_exec::process::LazySource,
+    map_flags: u64,
+    is_exec: bool,
+    start: usize,
+    end: usize,
+) -> (usize, bool) {
+    const BLOCK: usize = akuma_exec::mmu::BLOCK_2MB;
+    let mut mapped = 0usize;
+    let mut start_mapped = false;
+    let mut va = start;
+    while va < end {
+        let chunk_end = core::cmp::min((va | (BLOCK - 1)) + 1, end);
+        let (n, first) = if va & (BLOCK - 1) == 0 && chunk_end - va == BLOCK
+            && map_file_block(as_owner, source, map_flags, is_exec, va)
+        {
+            (BLOCK / 4096, true)
+        } else {
+            fill_file_pages(as_owner, source, map_flags, is_exec, va, chunk_end)
+        };
+        mapped += n;
+        if va == start {
+            start_mapped = first;
+        }
+        va = chunk_end;
+    }
+    if is_exec {
+        unsafe {
+            core::arch::asm!("dsb ish");
+            core::arch::asm!("isb");
+        }
+    }
+    (mapped, start_mapped)
+}
+
+/// Pre-fault the unmapped pages of the lazy regions overlapping
+/// `[start, end)` (`MADV_WILLNEED`, `MAP_POPULATE` on a lazy file mapping):
+/// file-backed regions are read in as the fault path would, with blocks where
+/// they apply; anonymous ones get zeroed pages; `PROT_NONE` is skipped.
+/// Advisory — stops quietly at the user readahead budget.
+fn populate_lazy_range(proc: &akuma_exec::process::Process, start: usize, end: usize) {
+    let mut va = start;
+    while va < end {
+        let Some((flags, source, region_start, region_size)) =
+            akuma_exec::process::lazy_region_lookup_for_pid(proc.tgid, va)
+        else {
+            va += 4096;
+            continue;
+        };
+        let seg_end = core::cmp::min(region_start + region_size, end);
+        if akuma_exec::mmu::user_flags::is_none(flags) {
+            va = seg_end;
+            continue;
+        }
+        let map_flags = if flags != 0 { flags } else { akuma_exec::mmu::user_flags::RW_NO_EXEC };
+        if matches!(source, akuma_exec::process::LazySource::File { .. }) {
+            let is_exec = map_flags & akuma_exec::mmu::flags::UXN == 0;
+            fill_file_range(proc.tgid, &source, map_flags, is_exec, va, seg_end);
+        } else {
+            populate_zero_pages(proc, va, seg_end, map_flags);
+        }
+        va = seg_end;
+    }
+}
+
+/// Map zeroed pages at the unmapped pages of `[start, end)` of an anonymous
+/// lazy region, in one batch clamped to the user readahead budget.
+fn populate_zero_pages(proc: &akuma_exec::process::Process, start: usize, end: usize, map_flags: u64) {
+    let mut prefault: alloc::vec::Vec<usize> = alloc::vec::Vec::new();
+    let budget = crate::pmm::user_readahead_budget(crate::pmm::free_count());
+    let mut va = start;
+    while va < end && prefault.len() < budget {
+        if !akuma_exec::mmu::is_current_user_page_mapped(va) {
+            prefault.push(va);
+        }
+        va += 4096;
+    }
+    if prefault.is_empty() {
+        return;
+    }
+    let frames = match crate::pmm::alloc_pages_zeroed(prefault.len()) {
+        Some(v) => v,
+        None => return, // advisory — ignore OOM
+    };
+    for (&page_va, frame) in prefault.iter().zip(frames) {
+        let (table_frames, installed) = unsafe {
+            akuma_exec::mmu::map_user_page_no_flush(page_va, frame.addr, map_flags)
+        };
+        if installed {
+            proc.address_space.track_user_frame(frame);
+        } else {
+            crate::pmm::free_page(frame);
+        }
+        for tf in table_frames {
+            proc.address_space.track_page_table_frame(tf);
+        }
+    }
+    let last = prefault[prefault.len() - 1];
+    akuma_exec::mmu::flush_tlb_range(start, (last - start) / 4096 + 1);
+}
+
 pub(super) fn sys_madvise(addr: usize, len: usize, advice: i32) -> u64 {
+    const MADV_NORMAL: i32 = 0;
+    const MADV_RANDOM: i32 = 1;
+    const MADV_SEQUENTIAL: i32 = 2;
     const MADV_WILLNEED: i32 = 3;
     const MADV_DONTNEED: i32 = 4;
     const MADV_FREE: i32 = 8;
 
+    let current_pid = akuma_exec::process::read_current_pid().unwrap_or(0);
+    let owner_pid = akuma_exec::process::lookup_process(current_pid).map_or(current_pid, |p| p.tgid);
+    let proc = match akuma_exec::process::lookup_process(owner_pid) {
+        Some(p) => p,
+        None => return 0,
+    };
+    let aligned_addr = addr & !0xFFF;
+    let end = (addr.saturating_add(len) + 0xFFF) & !0xFFF;
+
     match advice {
+        MADV_NORMAL | MADV_RANDOM | MADV_SEQUENTIAL => {
+            // Readahead policy of the file-backed lazy regions in the range
+            // (see lazy_region_readahead); splits regions at the range edges.
+            let ra = match advice {
+                MADV_RANDOM => akuma_exec::process::Readahead::RANDOM,
+                MADV_SEQUENTIAL => akuma_exec::process::Readahead::SEQUENTIAL,
+                _ => akuma_exec::process::Readahead::NORMAL,
+            };
+            akuma_exec::process::set_lazy_region_advice(proc.tgid, aligned_addr, end - aligned_addr, ra);
+            0
+        }
         MADV_WILLNEED => {
             // Pre-fault pages in lazy regions that aren't yet mapped.
             // This is advisory; OOM during pre-faulting is silently ignored.
-            let current_pid = akuma_exec::process::read_current_pid().unwrap_or(0);
-    let owner_pid = akuma_exec::process::lookup_process(current_pid).map_or(current_pid, |p| p.tgid);
-            let proc = match akuma_exec::process::lookup_process(owner_pid) {
-                Some(p) => p,
-                None => return 0,
-            };
-            let aligned_addr = addr & !0xFFF;
-            let end = (addr.saturating_add(len) + 0xFFF) & !0xFFF;
-
-            // Collect (va, flags) pairs for pages in lazy regions not yet mapped.
-            let mut prefault: alloc::vec::Vec<(usize, u64)> = alloc::vec::Vec::new();
+            populate_lazy_range(proc, aligned_addr, end);
+            0
+        }
+        MADV_DONTNEED => {
+            // File-backed lazy pages are dropped so the next touch re-reads
+            // the file (what MAP_PRIVATE file pages do on Linux); anything
+            // else is zeroed in place, as for anonymous memory.
             let mut va = aligned_addr;
             while va < end {
-                if !akuma_exec::mmu::is_current_user_page_mapped(va)
-                    && let Some((flags, _, _, _)) =
-                        akuma_exec::process::lazy_region_lookup_for_pid(proc.tgid, va)
-                    {
-                        prefault.push((va, flags));
+                let file_end = match akuma_exec::process::lazy_region_lookup_for_pid(proc.tgid, va) {
+                    Some((_, akuma_exec::process::LazySource::File { .. }, start, size)) =>
+                        core::cmp::min(start + size, end),
+                    _ => {
+                        proc.address_space.zero_mapped_page(va);
+                        va += 4096;
+                        continue;
                     }
-                va += 4096;
-            }
-            if prefault.is_empty() {
-                return 0;
-            }
-
-            // Batch-allocate and map with deferred TLB flush.
-            let frames = match crate::pmm::alloc_pages_zeroed(prefault.len()) {
-                Some(v) => v,
-                None => return 0, // advisory — ignore OOM
-            };
-            for (idx, (page_va, flags)) in prefault.into_iter().enumerate() {
-                let frame = frames[idx];
-                let (table_frames, _) = unsafe {
-                    akuma_exec::mmu::map_user_page_no_flush(page_va, frame.addr, flags)
                 };
-                proc.address_space.track_user_frame(frame);
-                for tf in table_frames {
-                    proc.address_space.track_page_table_frame(tf);
+                let first = va;
+                while va < file_end {
+                    if let Some(frame) = proc.address_space.unmap_and_free_page_no_flush(va) {
+                        crate::pmm::free_page(frame);
+                    }
+                    va += 4096;
                 }
-            }
-            // Flush the entire requested range (covers all newly mapped pages).
-            akuma_exec::mmu::flush_tlb_range(aligned_addr, (end - aligned_addr) / 4096);
-            0
-        }
-        MADV_DONTNEED => {
-            let current_pid = akuma_exec::process::read_current_pid().unwrap_or(0);
-    let owner_pid = akuma_exec::process::lookup_process(current_pid).map_or(current_pid, |p| p.tgid);
-            let proc = match akuma_exec::process::lookup_process(owner_pid) {
-                Some(p) => p,
-                None => return 0,
-            };
-            let aligned_addr = addr & !0xFFF;
-            let aligned_len = ((addr + len + 0xFFF) & !0xFFF) - aligned_addr;
-            let pages = aligned_len / 4096;
-            for i in 0..pages {
-                proc.address_space.zero_mapped_page(aligned_addr + i * 4096);
+                akuma_exec::mmu::flush_tlb_range_all_asid(first, (file_end - first) / 4096);
             }
             0
         }
@@ -35,12 +35,16 @@ pub mod poll;
 pub mod proc;
 pub mod signal;
 mod sync;
+#[cfg(feature = "rump")]
+mod tap;
 mod term;
 mod time;
 #[cfg(feature = "sc-timerfd")]
 mod timerfd;
 
 pub use sync::futex_wake;
+#[cfg(feature = "rump")]
+pub use tap::{tap_clone_ref, tap_close, tap_wire_rx_irq};
 #[cfg(not(any(feature = "no-tests", kernel_profile_size)))]
 pub use sync::futex_do_wake;
 #[cfg(not(any(feature = "no-tests", kernel_profile_size)))]
@@ -394,6 +398,8 @@ const EAGAIN: u64 = (-11i64) as u64;
 const ENOMEM: u64 = (-12i64) as u64;
 const EACCES: u64 = (-13i64) as u64;
 const EFAULT: u64 = (-14i64) as u64;
+#[cfg(feature = "rump")]
+const EBUSY: u64 = (-16i64) as u64;
 const EEXIST: u64 = (-17i64) as u64;
 #[cfg(feature = "sc-containers")]
 const ENODEV: u64 = (-19i64) as u64;
@@ -710,7 +716,7 @@ pub fn handle_syscall(syscall_num: u64, args: &[u64; 6]) -> u64 {
         nr::POLL_INPUT_EVENT => term::sys_poll_input_event(args[0], args[1] as usize, args[2]),
         nr::GET_CPU_STATS => term::sys_get_cpu_stats(args[0], args[1] as usize),
         nr::SPAWN_EXT => proc::sys_spawn_ext(args[0], args[1], args[2], args[3], args[4], args[5]),
-        nr::SET_BOX_STACK => proc::sys_set_box_stack(args[0], args[1]),
+        nr::SET_BOX_STACK => proc::sys_set_box_stack(args[0], args[1], args[2]),
         nr::CLOSE_CHILD_STDIN => proc::sys_close_child_stdin(args[0] as u32),
         nr::CORE_INIT => proc::sys_core_init(args[0] as usize, args[1]),
         #[cfg(feature = "sc-containers")]
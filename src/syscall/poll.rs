@@ -5,7 +5,9 @@ use akuma_exec::mmu::user_access::{copy_from_user_safe, copy_to_user_safe};
 use core::sync::atomic::AtomicU64;
 use core::task::Waker;
 #[cfg(feature = "sc-epoll")]
-use alloc::collections::BTreeMap;
+use alloc::collections::{BTreeMap, BTreeSet};
+#[cfg(feature = "sc-epoll")]
+use alloc::vec::Vec;
 
 #[cfg(feature = "sc-epoll")]
 struct EpollEntry {
@@ -17,10 +19,186 @@ struct EpollEntry {
 #[cfg(feature = "sc-epoll")]
 struct EpollInstance {
     interest_list: BTreeMap<u32, EpollEntry>,
+    /// Interest fds whose readiness no resource wakes (timerfd, rump sockets):
+    /// re-checked on every `epoll_pwait` pass instead of waiting on the ready list.
+    polled: BTreeSet<u32>,
 }
 
 #[cfg(feature = "sc-epoll")]
 static EPOLL_TABLE: Spinlock<BTreeMap<u32, EpollInstance>> = Spinlock::new(BTreeMap::new());
+
+/// Per-instance ready list: the fds some resource has signalled since the last
+/// harvest. Resources wake the instance through its poller token
+/// ([`epoll_token`]), which lands in [`epoll_token_wake`] and marks the fd here,
+/// so `epoll_pwait` only re-checks fds that actually changed — O(ready), not
+/// O(interest list).
+///
+/// A bitmap rather than a queue: marking is idempotent (a pipe written ten
+/// times between waits is one entry) and never allocates once `reserve` has
+/// sized it in `epoll_ctl`, which matters because wakes can come from IRQ
+/// context (tap RX). Kept apart from `EPOLL_TABLE` and always locked with IRQs
+/// disabled for the same reason.
+#[cfg(feature = "sc-epoll")]
+struct ReadySet {
+    /// One bit per fd number.
+    bits: Vec<u64>,
+    /// Subset of `bits` marked by a resource wake rather than by epoll itself
+    /// (ctl, LT requeue, rescan): a fresh edge for `EPOLLET`.
+    edges: Vec<u64>,
+    /// One bit per non-zero word of `bits`, so a harvest skips empty words.
+    summary: Vec<u64>,
+    /// Harvest resumes here, so a busy low fd cannot starve higher ones when
+    /// `maxevents` is small.
+    cursor: u32,
+    /// Threads blocked in `epoll_pwait` on this instance.
+    waiters: Vec<usize>,
+}
+
+#[cfg(feature = "sc-epoll")]
+impl ReadySet {
+    const fn new() -> Self {
+        Self { bits: Vec::new(), edges: Vec::new(), summary: Vec::new(), cursor: 0, waiters: Vec::new() }
+    }
+
+    /// Make room for `fd` so a later `mark` is allocation-free.
+    fn reserve(&mut self, fd: u32) {
+        let words = fd as usize / 64 + 1;
+        if self.bits.len() < words {
+            self.bits.resize(words, 0);
+            self.edges.resize(words, 0);
+            self.summary.resize(words.div_ceil(64), 0);
+        }
+    }
+
+    /// Returns false when `fd` was never reserved (not in this instance).
+    fn mark(&mut self, fd: u32, edge: bool) -> bool {
+        let w = fd as usize / 64;
+        let Some(word) = self.bits.get_mut(w) else { return false };
+        *word |= 1 << (fd % 64);
+        if edge {
+            self.edges[w] |= 1 << (fd % 64);
+        }
+        self.summary[w / 64] |= 1 << (w % 64);
+        true
+    }
+
+    fn clear(&mut self, fd: u32) {
+        let w = fd as usize / 64;
+        if let Some(word) = self.bits.get_mut(w) {
+            *word &= !(1 << (fd % 64));
+            self.edges[w] &= !(1 << (fd % 64));
+            if *word == 0 {
+                self.summary[w / 64] &= !(1 << (w % 64));
+            }
+        }
+    }
+
+    fn is_empty(&self) -> bool {
+        self.summary.iter().all(|&s| s == 0)
+    }
+
+    /// Lowest marked fd `>= from`.
+    fn next_set(&self, from: usize) -> Option<usize> {
+        let w = from / 64;
+        let first = *self.bits.get(w)? & (!0u64 << (from % 64));
+        if first != 0 {
+            return Some(w * 64 + first.trailing_zeros() as usize);
+        }
+        let w = w + 1;
+        let mut s = w / 64;
+        let mut mask = !0u64 << (w % 64);
+        while s < self.summary.len() {
+            let sm = self.summary[s] & mask;
+            if sm != 0 {
+                let ww = s * 64 + sm.trailing_zeros() as usize;
+                return Some(ww * 64 + self.bits[ww].trailing_zeros() as usize);
+            }
+            s += 1;
+            mask = !0;
+        }
+        None
+    }
+
+    /// Unmark and return up to `out.len()` fds with their edge flag,
+    /// round-robin from the cursor.
+    fn take(&mut self, out: &mut [(u32, bool)]) -> usize {
+        let start = self.cursor as usize;
+        let mut from = start;
+        let mut wrapped = false;
+        let mut n = 0;
+        while n < out.len() {
+            match self.next_set(from) {
+                Some(fd) if !wrapped || fd < start => {
+                    let edge = self.edges[fd / 64] & (1 << (fd % 64)) != 0;
+                    self.clear(fd as u32);
+                    out[n] = (fd as u32, edge);
+                    n += 1;
+                    from = fd + 1;
+                }
+                _ if !wrapped => {
+                    wrapped = true;
+                    from = 0;
+                }
+                _ => break,
+            }
+        }
+        if n > 0 {
+            self.cursor = out[n - 1].0.wrapping_add(1);
+        }
+        n
+    }
+}
+
+#[cfg(feature = "sc-epoll")]
+static EPOLL_READY: Spinlock<BTreeMap<u32, ReadySet>> = Spinlock::new(BTreeMap::new());
+
+/// Poller id registered with resources on behalf of (`epoll_id`, `fd`). It
+/// sits in the same `pollers` sets as thread ids; `ThreadWaker::wake` routes
+/// the tagged ids to [`epoll_token_wake`].
+#[cfg(feature = "sc-epoll")]
+fn epoll_token(epoll_id: u32, fd: u32) -> usize {
+    akuma_exec::threading::POLLER_TOKEN_TAG | ((epoll_id as usize & 0x7FFF_FFFF) << 32) | fd as usize
+}
+
+/// `ExecRuntime::epoll_token_wake`: a resource woke an epoll poller token.
+/// Marks the fd on that instance's ready list and wakes its blocked waiters.
+/// Runs inside the resource's own critical section (and from the tap RX IRQ),
+/// so it only touches `EPOLL_READY` and never allocates.
+#[cfg(feature = "sc-epoll")]
+pub fn epoll_token_wake(token: usize) {
+    let epoll_id = ((token >> 32) & 0x7FFF_FFFF) as u32;
+    let fd = token as u32;
+    crate::irq::with_irqs_disabled(|| {
+        let mut ready = EPOLL_READY.lock();
+        if let Some(rs) = ready.get_mut(&epoll_id)
+            && rs.mark(fd, true) {
+                for tid in rs.waiters.drain(..) {
+                    akuma_exec::threading::get_waker_for_thread(tid).wake();
+                }
+            }
+    });
+}
+
+#[cfg(feature = "sc-epoll")]
+fn epoll_ready_mark(epoll_id: u32, fds: &[u32]) {
+    crate::irq::with_irqs_disabled(|| {
+        if let Some(rs) = EPOLL_READY.lock().get_mut(&epoll_id) {
+            for &fd in fds {
+                rs.mark(fd, false);
+            }
+        }
+    });
+}
+
+/// Test helper: number of fds currently on an instance's ready list.
+#[cfg(all(feature = "sc-epoll", not(any(feature = "no-tests", kernel_profile_size))))]
+pub fn epoll_ready_pending(epfd: u32) -> usize {
+    let Some(akuma_exec::process::FileDescriptor::EpollFd(id)) =
+        akuma_exec::process::current_process().and_then(|p| p.get_fd(epfd)) else { return 0 };
+    crate::irq::with_irqs_disabled(|| {
+        EPOLL_READY.lock().get(&id).map_or(0, |rs| rs.bits.iter().map(|w| w.count_ones() as usize).sum())
+    })
+}
 #[cfg(feature = "sc-epoll")]
 static NEXT_EPOLL_ID: AtomicU32 = AtomicU32::new(1);
 /// Counts `epoll_pwait(timeout=0)` returns with `nready=0` for rate-limited logging.
@@ -84,7 +262,7 @@ fn log_epoll_pwait_return(
     ready_count: usize,
     iterations: u64,
     start_time: u64,
-    interest_fd_count: usize,
+    checked_fds: usize,
     kernel_events: &[EpollEvent],
     note: &'static str,
 ) {
@@ -115,14 +293,14 @@ fn log_epoll_pwait_return(
 
     crate::tprint!(
         224,
-        "[epoll] pwait ret pid={} epfd={} timeout_ms={} nready={} iters={} dur_us={} interest_fds={} {}\n",
+        "[epoll] pwait ret pid={} epfd={} timeout_ms={} nready={} iters={} dur_us={} checked_fds={} {}\n",
         pid,
         epfd,
         timeout,
         nready,
         iterations,
         elapsed_us,
-        interest_fd_count,
+        checked_fds,
         note,
     );
     if nready == 0 || kernel_events.is_empty() {
@@ -149,6 +327,9 @@ fn log_epoll_pwait_return(
 #[cfg(feature = "sc-epoll")]
 pub fn epoll_destroy(epoll_id: u32) {
     EPOLL_TABLE.lock().remove(&epoll_id);
+    // Tokens still parked in resources' poller sets find no entry and are dropped.
+    let rs = crate::irq::with_irqs_disabled(|| EPOLL_READY.lock().remove(&epoll_id));
+    drop(rs);
 }
 
 /// No-op when epoll is gated out: there is no interest table to reset, and the
@@ -163,20 +344,12 @@ pub(super) fn epoll_on_fd_drained(_fd: u32) {}
 /// the transition is missed and EPOLLIN never re-fires.
 #[cfg(feature = "sc-epoll")]
 pub(super) fn epoll_on_fd_drained(fd: u32) {
-    // Snapshot IDs to avoid holding EPOLL_TABLE lock during the entire iteration
-    // (though not strictly necessary for this simple function yet, good practice)
-    let ids: alloc::vec::Vec<u32> = {
-        let table = EPOLL_TABLE.lock();
-        table.keys().copied().collect()
-    };
-
-    for epoll_id in ids {
-        let mut table = EPOLL_TABLE.lock();
-        if let Some(inst) = table.get_mut(&epoll_id)
-            && let Some(entry) = inst.interest_list.get_mut(&fd)
-                && entry.events & EPOLLET != 0 {
-                    entry.last_ready &= !EPOLLIN;
-                }
+    let mut table = EPOLL_TABLE.lock();
+    for inst in table.values_mut() {
+        if let Some(entry) = inst.interest_list.get_mut(&fd)
+            && entry.events & EPOLLET != 0 {
+                entry.last_ready &= !EPOLLIN;
+            }
     }
 }
 
@@ -189,7 +362,9 @@ pub fn sys_epoll_create1(flags: u32) -> u64 {
         let epoll_id = NEXT_EPOLL_ID.fetch_add(1, Ordering::SeqCst);
         EPOLL_TABLE.lock().insert(epoll_id, EpollInstance {
             interest_list: BTreeMap::new(),
+            polled: BTreeSet::new(),
         });
+        crate::irq::with_irqs_disabled(|| EPOLL_READY.lock().insert(epoll_id, ReadySet::new()));
         let fd = proc.alloc_fd(akuma_exec::process::FileDescriptor::EpollFd(epoll_id));
         if flags & EPOLL_CLOEXEC != 0 {
             proc.set_cloexec(fd);
@@ -220,7 +395,7 @@ pub fn sys_epoll_ctl(epfd: u32, op: i32, fd: u32, event_ptr: usize) -> u64 {
 
     const EPOLL_EVENT_SIZE: usize = core::mem::size_of::<EpollEvent>();  // 16 on ARM64
 
-    match op {
+    let ret = match op {
         EPOLL_CTL_ADD => {
             if !validate_user_ptr(event_ptr as u64, EPOLL_EVENT_SIZE) { return EFAULT; }
             let mut ev = EpollEvent { events: 0, _pad: 0, data: 0 };
@@ -263,29 +438,71 @@ pub fn sys_epoll_ctl(epfd: u32, op: i32, fd: u32, event_ptr: usize) -> u64 {
             }
         }
         EPOLL_CTL_DEL => {
+            instance.polled.remove(&fd);
             match instance.interest_list.remove(&fd) {
                 Some(_) => 0,
                 None => ENOENT,
             }
         }
         _ => EINVAL,
+    };
+
+    // ADD/MOD queue the fd so the next epoll_pwait checks it once, which also
+    // registers this instance's token with the resource; DEL drops any pending
+    // mark. Stale tokens left in a resource only cause one spurious re-check.
+    if ret == 0 {
+        crate::irq::with_irqs_disabled(|| {
+            if let Some(rs) = EPOLL_READY.lock().get_mut(&epoll_id) {
+                if op == EPOLL_CTL_DEL {
+                    rs.clear(fd);
+                } else {
+                    rs.reserve(fd);
+                    rs.mark(fd, false);
+                }
+            }
+        });
     }
+    ret
 }
 
 pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Waker>) -> u32 {
+    let poller = waker.map(|_| akuma_exec::threading::current_thread_id());
+    check_fd_readiness(fd_num, requested, poller).0
+}
+
+/// How a registered poller learns that an fd's readiness changed.
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum FdWake {
+    /// The resource wakes its pollers on each event on this fd (pipes,
+    /// eventfd, channels, tap), or readiness never changes.
+    Event,
+    /// Sockets: `wake_all` fires on any network state change, so a wake alone
+    /// is not a new edge — `EPOLLET` relies on `last_ready` and
+    /// `epoll_on_fd_drained` instead.
+    Broadcast,
+    /// Nothing wakes pollers (timerfd, rump sockets): epoll re-checks the fd
+    /// on every pass.
+    Polled,
+}
+
+/// Readiness of `fd_num`, registering `poller` (a thread id, or an epoll token
+/// from [`epoll_token`]) to be woken when it changes.
+fn check_fd_readiness(fd_num: u32, requested: u32, poller: Option<usize>) -> (u32, FdWake) {
     let fd_entry = akuma_exec::process::current_process().and_then(|p| p.get_fd(fd_num));
     let fd_entry = match fd_entry {
         Some(e) => e,
-        None => return EPOLLHUP | EPOLLERR,
+        None => return (EPOLLHUP | EPOLLERR, FdWake::Event),
     };
 
     let mut ready = 0u32;
-    let tid = akuma_exec::threading::current_thread_id();
+    let mut wake = FdWake::Event;
+    let tid = poller.unwrap_or_else(akuma_exec::threading::current_thread_id);
 
     match fd_entry {
         akuma_exec::process::FileDescriptor::Socket(idx) => {
-            if let Some(w) = waker {
-                socket::socket_add_waker(idx, w.clone());
+            wake = FdWake::Broadcast;
+            if let Some(p) = poller {
+                socket::socket_add_waker(idx, akuma_exec::threading::get_waker_for_thread(p));
             }
 
             if socket::is_udp_socket(idx) {
@@ -322,7 +539,7 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         }
         #[cfg(feature = "sc-eventfd")]
         akuma_exec::process::FileDescriptor::EventFd(efd_id) => {
-            if waker.is_some() {
+            if poller.is_some() {
                 super::eventfd::eventfd_add_poller(efd_id, tid);
             }
             let can_read = super::eventfd::eventfd_can_read(efd_id);
@@ -336,7 +553,7 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         akuma_exec::process::FileDescriptor::ChildStdout(child_pid) => {
             if requested & EPOLLIN != 0 {
                 if let Some(ch) = akuma_exec::process::get_child_channel(child_pid) {
-                    if waker.is_some() {
+                    if poller.is_some() {
                         ch.add_poller(tid);
                     }
                     if ch.has_stdout_data() || ch.has_exited() {
@@ -350,7 +567,7 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         akuma_exec::process::FileDescriptor::PipeRead(pipe_id) => {
             if requested & EPOLLIN != 0 {
                 // Register for wakeup notifications
-                if waker.is_some() {
+                if poller.is_some() {
                     super::pipe::pipe_add_poller(pipe_id, tid);
                 }
                 if super::pipe::pipe_can_read(pipe_id) {
@@ -370,7 +587,7 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         // when `tx`'s peer is still open.
         akuma_exec::process::FileDescriptor::UnixSocket { rx, tx } => {
             if requested & EPOLLIN != 0 {
-                if waker.is_some() {
+                if poller.is_some() {
                     super::pipe::pipe_add_poller(rx, tid);
                 }
                 if super::pipe::pipe_can_read(rx) {
@@ -384,10 +601,13 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
                 }
             }
         }
+        // Expiry is a deadline, not an event: timerfd pollers are registered
+        // but nothing wakes them, so epoll keeps this fd on its polled list.
         #[cfg(feature = "sc-timerfd")]
         akuma_exec::process::FileDescriptor::TimerFd(timer_id) => {
             if requested & EPOLLIN != 0 {
-                if waker.is_some() {
+                wake = FdWake::Polled;
+                if poller.is_some() {
                     super::timerfd::timerfd_add_poller(timer_id, tid);
                 }
                 if super::timerfd::timerfd_can_read(timer_id) {
@@ -401,7 +621,7 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
             if requested & EPOLLIN != 0 {
                 if let Some(target_pid) = super::pidfd::pidfd_get_pid(pidfd_id)
                     && let Some(ch) = akuma_exec::process::get_child_channel(target_pid)
-                        && waker.is_some() {
+                        && poller.is_some() {
                             ch.add_poller(tid);
                         }
                 if super::pidfd::pidfd_can_read(pidfd_id) {
@@ -412,7 +632,7 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         akuma_exec::process::FileDescriptor::Stdin => {
             if requested & EPOLLIN != 0
                 && let Some(ch) = akuma_exec::process::current_channel() {
-                    if waker.is_some() {
+                    if poller.is_some() {
                         ch.add_poller(tid);
                     }
                     if ch.has_stdin_data() {
@@ -425,6 +645,23 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
                 ready |= EPOLLOUT;
             }
         }
+        // /dev/net/tap0: POLLIN when NIC1 (or the process's mapped ring) holds
+        // a frame; pollers are woken by NIC1's RX interrupt. POLLOUT is always
+        // ready, as a frame write never blocks.
+        #[cfg(feature = "rump")]
+        akuma_exec::process::FileDescriptor::Tap { .. } => {
+            if requested & EPOLLIN != 0 {
+                if poller.is_some() {
+                    super::tap::rx_add_poller(tid);
+                }
+                if akuma_exec::process::current_process().is_some_and(|p| super::tap::tap_can_read(p.tgid)) {
+                    ready |= EPOLLIN;
+                }
+            }
+            if requested & EPOLLOUT != 0 {
+                ready |= EPOLLOUT;
+            }
+        }
         // A rump socket (stack=rump box): POLLIN comes from a non-blocking
         // MSG_PEEK probe forwarded to the rump server; POLLOUT is assumed ready
         // (sends are blocking-synchronous through the proxy). This lets a client
@@ -432,8 +669,11 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         // Each readiness check is a sysproxy round-trip (proxy latency applies).
         #[cfg(feature = "rump")]
         akuma_exec::process::FileDescriptor::RumpSocket { rump_fd, .. } => {
-            if requested & EPOLLIN != 0 && crate::rump_proxy::rump_socket_readable(rump_fd) {
-                ready |= EPOLLIN;
+            if requested & EPOLLIN != 0 {
+                wake = FdWake::Polled;
+                if crate::rump_proxy::rump_socket_readable(rump_fd) {
+                    ready |= EPOLLIN;
+                }
             }
             if requested & EPOLLOUT != 0 {
                 ready |= EPOLLOUT;
@@ -445,12 +685,78 @@ pub fn epoll_check_fd_readiness(fd_num: u32, requested: u32, waker: Option<&Wake
         }
     }
 
-    ready
+    (ready, wake)
+}
+
+/// Check one fd for `epoll_pwait` and append its event, if any.
+///
+/// `edge` says a resource woke this fd's token since the last check. LT fds
+/// that are reported go on `requeue`: they return to the ready list after the
+/// pass (as Linux re-adds them to its rdllist), so the next wait re-checks
+/// them even though no new wake will come.
+#[cfg(feature = "sc-epoll")]
+fn epoll_check_one(
+    epoll_id: u32,
+    fd: u32,
+    edge: bool,
+    from_polled: bool,
+    events: &mut Vec<EpollEvent>,
+    requeue: &mut Vec<u32>,
+) {
+    // Re-acquire lock to get entry details (MUST NOT hold during readiness check)
+    let entry_info = {
+        let table = EPOLL_TABLE.lock();
+        table.get(&epoll_id).and_then(|inst| inst.interest_list.get(&fd)).map(|e| (e.events, e.data, e.last_ready))
+    };
+    let Some((raw_events, data, last_ready)) = entry_info else {
+        return; // FD removed from epoll interest since it was queued
+    };
+
+    let is_et = raw_events & EPOLLET != 0;
+    let requested = raw_events & EPOLL_EVENT_MASK;
+
+    // Registers this instance's token with the resource.
+    // check_fd_readiness locks PROCESS_TABLE.
+    let (revents, wake) = check_fd_readiness(fd, requested, Some(epoll_token(epoll_id, fd)));
+
+    let reported = if !is_et {
+        revents
+    } else if edge && wake == FdWake::Event {
+        // A write/signal on this very fd: a new edge even if it was already readable.
+        revents
+    } else {
+        revents & !last_ready
+    };
+
+    let polled = wake == FdWake::Polled;
+    if is_et || polled != from_polled {
+        let mut table = EPOLL_TABLE.lock();
+        if let Some(inst) = table.get_mut(&epoll_id) {
+            if is_et
+                && let Some(entry) = inst.interest_list.get_mut(&fd) {
+                    entry.last_ready = revents;
+                }
+            if polled {
+                inst.polled.insert(fd);
+            } else {
+                inst.polled.remove(&fd);
+            }
+        }
+    }
+
+    if reported != 0 {
+        events.push(EpollEvent { events: reported, _pad: 0, data });
+        if !is_et && !polled {
+            requeue.push(fd);
+        }
+    }
 }
 
 #[cfg(feature = "sc-epoll")]
 pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i32) -> u64 {
     const EPOLL_EVENT_SIZE: usize = core::mem::size_of::<EpollEvent>();  // 16 on ARM64
+    /// Ready-list fds taken per `EPOLL_READY` acquisition.
+    const HARVEST_BATCH: usize = 64;
     
     if maxevents <= 0 { return EINVAL; }
     let maxevents = maxevents as usize;
@@ -468,7 +774,8 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
         0
     };
     let start_time = crate::timer::uptime_us();
-    let waker = akuma_exec::threading::current_thread_waker();
+    let tid = akuma_exec::threading::current_thread_id();
+    let mut last_rescan = start_time;
 
     let mut iterations = 0u64;
     loop {
@@ -477,81 +784,58 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
         // Drive network stack (only once per loop)
         akuma_net::smoltcp_net::poll();
 
-        let mut kernel_events = alloc::vec![];
-        let mut ready_count = 0usize;
-
-        // Snapshot interest list to avoid holding EPOLL_TABLE lock during readiness checks.
-        // This prevents deadlock with PROCESS_TABLE lock (which readiness checks need).
-        // We use a stack-allocated array for common small interest lists (up to 128).
-        const STACK_SNAPSHOT_SIZE: usize = 128;
-        let mut stack_snapshot = [0u32; STACK_SNAPSHOT_SIZE];
-        let mut heap_snapshot = None;
-        let snapshot_count;
-
-        {
+        // Safety net: every EPOLL_RESCAN_INTERVAL_US of waiting, queue the whole
+        // interest list once, in case some resource missed a wake.
+        let rescan_us = crate::config::EPOLL_RESCAN_INTERVAL_US;
+        if rescan_us != 0 && crate::timer::uptime_us().saturating_sub(last_rescan) >= rescan_us {
+            last_rescan = crate::timer::uptime_us();
             let table = EPOLL_TABLE.lock();
-            let instance = match table.get(&epoll_id) {
-                Some(inst) => inst,
-                None => return EBADF,
-            };
-
-            snapshot_count = instance.interest_list.len();
-            if snapshot_count <= STACK_SNAPSHOT_SIZE {
-                for (i, (&fd, _)) in instance.interest_list.iter().enumerate() {
-                    stack_snapshot[i] = fd;
-                }
-            } else {
-                heap_snapshot = Some(instance.interest_list.keys().copied().collect::<alloc::vec::Vec<u32>>());
+            if let Some(inst) = table.get(&epoll_id) {
+                crate::irq::with_irqs_disabled(|| {
+                    if let Some(rs) = EPOLL_READY.lock().get_mut(&epoll_id) {
+                        for &fd in inst.interest_list.keys() {
+                            rs.mark(fd, false);
+                        }
+                    }
+                });
             }
         }
 
-        let fds: &[u32] = if let Some(ref h) = heap_snapshot { 
-            h 
-        } else { 
-            &stack_snapshot[..snapshot_count] 
-        };
-
-        for &fd in fds {
-            if ready_count >= maxevents { break; }
-
-            // Re-acquire lock to get entry details (MUST NOT hold during readiness check)
-            let entry_info = {
-                let table = EPOLL_TABLE.lock();
-                table.get(&epoll_id).and_then(|inst| inst.interest_list.get(&fd)).map(|e| (e.events, e.data, e.last_ready))
-            };
+        let mut kernel_events: Vec<EpollEvent> = Vec::new();
+        let mut requeue: Vec<u32> = Vec::new();
+        let mut checked = 0usize;
 
-            let (raw_events, data, last_ready) = match entry_info {
-                Some(info) => info,
-                None => continue, // FD removed from epoll interest during loop
-            };
+        // Polled fds first: nothing puts them on the ready list. Snapshot so
+        // EPOLL_TABLE is not held across readiness checks (PROCESS_TABLE order).
+        let polled: Vec<u32> = match EPOLL_TABLE.lock().get(&epoll_id) {
+            Some(inst) => inst.polled.iter().copied().collect(),
+            None => return EBADF,
+        };
+        for &fd in &polled {
+            if kernel_events.len() >= maxevents { break; }
+            checked += 1;
+            epoll_check_one(epoll_id, fd, false, true, &mut kernel_events, &mut requeue);
+        }
 
-            let is_et = raw_events & EPOLLET != 0;
-            let requested = raw_events & EPOLL_EVENT_MASK;
-            
-            // Pass waker to register interest for event-driven wakeups.
-            // epoll_check_fd_readiness locks PROCESS_TABLE.
-            let revents = epoll_check_fd_readiness(fd, requested, Some(&waker));
-
-            if is_et {
-                let new_bits = revents & !last_ready;
-                // Update last_ready in the table
-                {
-                    let mut table = EPOLL_TABLE.lock();
-                    if let Some(inst) = table.get_mut(&epoll_id)
-                        && let Some(entry) = inst.interest_list.get_mut(&fd) {
-                            entry.last_ready = revents;
-                        }
-                }
-                if new_bits != 0 {
-                    kernel_events.push(EpollEvent { events: new_bits, _pad: 0, data });
-                    ready_count += 1;
-                }
-            } else if revents != 0 {
-                kernel_events.push(EpollEvent { events: revents, _pad: 0, data });
-                ready_count += 1;
+        // Then the ready list, never taking more than the free event slots so
+        // nothing taken goes unchecked.
+        let mut batch = [(0u32, false); HARVEST_BATCH];
+        while kernel_events.len() < maxevents {
+            let want = (maxevents - kernel_events.len()).min(HARVEST_BATCH);
+            let n = crate::irq::with_irqs_disabled(|| {
+                EPOLL_READY.lock().get_mut(&epoll_id).map_or(0, |rs| rs.take(&mut batch[..want]))
+            });
+            if n == 0 { break; }
+            for &(fd, edge) in &batch[..n] {
+                checked += 1;
+                epoll_check_one(epoll_id, fd, edge, false, &mut kernel_events, &mut requeue);
             }
         }
+        if !requeue.is_empty() {
+            epoll_ready_mark(epoll_id, &requeue);
+        }
 
+        let ready_count = kernel_events.len();
         if ready_count > 0 {
             if unsafe { copy_to_user_safe(events_ptr as *mut u8, kernel_events.as_ptr().cast::<u8>(), ready_count * EPOLL_EVENT_SIZE).is_err() } {
                 return EFAULT;
@@ -562,7 +846,7 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
                 ready_count,
                 iterations,
                 start_time,
-                0,
+                checked,
                 &kernel_events,
                 "",
             );
@@ -576,7 +860,7 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
                 0,
                 iterations,
                 start_time,
-                0,
+                checked,
                 &[],
                 "",
             );
@@ -592,7 +876,7 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
                     0,
                     iterations,
                     start_time,
-                    0,
+                    checked,
                     &[],
                     "timeout_expired",
                 );
@@ -615,17 +899,17 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
                 0,
                 iterations,
                 start_time,
-                0,
+                checked,
                 &[],
                 "EINTR",
             );
             return EINTR;
         }
 
-        // With the waker mechanism, we can now block more efficiently.
-        // We still use a 10ms cap for safety and for resources that don't
-        // yet support wakers (like TimerFd), but network events will
-        // now wake us up IMMEDIATELY.
+        // Resource wakes land on the ready list and wake us IMMEDIATELY. The
+        // 10ms cap stays: polled fds need it, and the loop top is what drives
+        // smoltcp (turning NIC traffic into socket wakes) on a core without
+        // the network thread. An idle pass costs O(polled), not O(interest).
         let abs_deadline = epoll_wait_deadline(timeout, start_time, timeout_us, crate::timer::uptime_us());
         if abs_deadline == 0 {
             log_epoll_pwait_return(
@@ -634,7 +918,7 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
                 0,
                 iterations,
                 start_time,
-                0,
+                checked,
                 &[],
                 "deadline_abs0",
             );
@@ -642,7 +926,27 @@ pub fn sys_epoll_pwait(epfd: u32, events_ptr: usize, maxevents: i32, timeout: i3
         }
         let deadline = abs_deadline.min(crate::timer::uptime_us() + BLOCKING_POLL_INTERVAL_US);
 
-        akuma_exec::threading::schedule_blocking(deadline);
+        // Check-and-park under the ready-list lock: a wake either lands before
+        // (we see it and loop) or after (it finds us in `waiters`).
+        let parked = crate::irq::with_irqs_disabled(|| {
+            match EPOLL_READY.lock().get_mut(&epoll_id) {
+                Some(rs) if rs.is_empty() => {
+                    if !rs.waiters.contains(&tid) {
+                        rs.waiters.push(tid);
+                    }
+                    true
+                }
+                _ => false,
+            }
+        });
+        if parked {
+            akuma_exec::threading::schedule_blocking(deadline);
+            crate::irq::with_irqs_disabled(|| {
+                if let Some(rs) = EPOLL_READY.lock().get_mut(&epoll_id) {
+                    rs.waiters.retain(|&t| t != tid);
+                }
+            });
+        }
     }
 }
 
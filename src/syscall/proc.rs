@@ -710,6 +710,8 @@ pub fn do_execve(resolved_path: String, args: Vec<String>, env: Vec<String>) ->
             akuma_exec::process::FileDescriptor::EpollFd(epoll_id) => super::poll::epoll_destroy(epoll_id),
             #[cfg(feature = "sc-pidfd")]
             akuma_exec::process::FileDescriptor::PidFd(pidfd_id) => super::pidfd::pidfd_close(pidfd_id),
+            #[cfg(feature = "rump")]
+            akuma_exec::process::FileDescriptor::Tap { bounce, .. } => super::tap::tap_close(bounce),
             _ => {}
         }
     }
@@ -1317,18 +1319,19 @@ pub fn sys_spawn_ext(path_ptr: u64, options_ptr: u64, _a2: u64, _a3: u64, _a4: u
     ENOMEM
 }
 
-/// `SET_BOX_STACK(box_id, stack)` — select a box's network stack. `stack == 1`
-/// marks the box as using the NetBSD rump kernel (its AF_INET syscalls are
-/// routed to that box's rump_server); any other value is a no-op (smoltcp
-/// default). herd calls this for a `stack = rump` service. Without the `rump`
-/// kernel feature the call is harmlessly ignored.
-pub fn sys_set_box_stack(box_id: u64, stack: u64) -> u64 {
+/// `SET_BOX_STACK(box_id, stack, net_box)` — select a box's network stack.
+/// `stack == 1` marks the box as using the NetBSD rump kernel (its AF_INET
+/// syscalls are routed to that box's rump_server, or with a non-zero `net_box`
+/// to the rump_server of box `net_box`, whose stack it shares); any other
+/// value is a no-op (smoltcp default). herd calls this for a `stack = rump`
+/// service. Without the `rump` kernel feature the call is harmlessly ignored.
+pub fn sys_set_box_stack(box_id: u64, stack: u64, net_box: u64) -> u64 {
     #[cfg(feature = "rump")]
     if stack == 1 {
-        crate::rump_proxy::mark_box_rump(box_id);
+        crate::rump_proxy::mark_box_rump(box_id, net_box);
     }
     #[cfg(not(feature = "rump"))]
-    let _ = (box_id, stack);
+    let _ = (box_id, stack, net_box);
     0
 }
 
@@ -1467,6 +1470,9 @@ pub(super) fn sys_prctl(option: i32, arg2: u64, arg3: u64, arg4: u64, arg5: u64)
     const PR_CAPBSET_DROP: i32 = 24;
     const PR_CAP_AMBIENT: i32 = 47;
     const PR_SET_PTRACER: i32 = 42;
+    // Akuma: arg2 = mask of EL0 counters to open to this address space
+    // (1 = CNTVCT_EL0, 2 = PMCCNTR_EL0, 0 = close); returns the mask granted.
+    const PR_AKUMA_EL0_COUNTERS: i32 = 0x414b_4330; // "AKC0"
 
     match option {
         PR_SET_NAME => {
@@ -1510,6 +1516,12 @@ pub(super) fn sys_prctl(option: i32, arg2: u64, arg3: u64, arg4: u64, arg5: u64)
             }
             0
         }
+        PR_AKUMA_EL0_COUNTERS => {
+            if !crate::config::EL0_COUNTERS_PRCTL_ENABLED || arg2 & !akuma_exec::el0_counters::EL0_ALL != 0 {
+                return EINVAL;
+            }
+            akuma_exec::el0_counters::grant_current(arg2).unwrap_or(EBUSY)
+        }
         PR_GET_DUMPABLE => {
             // Return 1 (dumpable)
             1
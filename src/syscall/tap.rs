@@ -0,0 +1,413 @@
+//! `/dev/net/tap0` beyond one frame per `read`/`write` (kernel `rump` feature)
+//!
+//! - `TAPRECVBATCH` / `TAPSENDBATCH` ([`tap_batch`]): several frames per
+//!   syscall, as `akuma_rump::BATCH_HDR` records in a user buffer.
+//! - The shared slot ring: `mmap` of the tap fd ([`ring_mmap_ok`],
+//!   [`ring_mapped`]) gives the process eager anonymous pages holding an
+//!   `akuma_rump::ring` layout, and `TAPRINGSYNC` ([`ring_sync`]) sends its
+//!   queued TX slots and fills its free RX slots straight from the NIC.
+//! - `TAPSETVNET` ([`set_vnet`]): frames carry a virtio-net header, and NIC1
+//!   is renegotiated with checksum/TSO offload (`akuma_rump::vnet`).
+//! - RX wakeups ([`tap_wire_rx_irq`]): NIC1's interrupt wakes the threads blocked
+//!   in a tap read or sync, or polling the tap fd, instead of them re-polling
+//!   between yields.
+//! - Plain `read`/`write` ([`tap_read`], [`tap_write`]) and the batch ioctls
+//!   without a heap buffer per call: each open tap has staging buffers
+//!   allocated at `open` ([`tap_open`]) and reused for every frame or batch.
+//!
+//! One ring per process (there is one tap); a new `mmap` replaces it, and
+//! closing a tap fd drops it. The pages stay an ordinary region of the
+//! process, freed by `munmap`/exit like any other, so the kernel only ever
+//! touches them through the process's own mapping during its syscalls: a
+//! sync after `munmap` fails with `EFAULT` (and drops the ring) rather than
+//! writing freed frames.
+
+use super::*;
+use alloc::collections::BTreeSet;
+use akuma_rump::ring::{RingError, RingMem, TapRing, RING_BYTES};
+
+/// `TAPRINGSYNC` argument: block until an RX frame is waiting. Per call, not
+/// per fd: one thread can wait on RX while another only flushes TX.
+const TAPRING_WAIT: u64 = 1;
+
+/// Mapped rings by tgid: `(base VA, kernel-side state)`. The state is taken
+/// out while a sync runs, as the copies may fault and must not run under the
+/// lock.
+static TAP_RINGS: Spinlock<BTreeMap<u32, (usize, Option<TapRing>)>> = Spinlock::new(BTreeMap::new());
+
+/// Staging buffers of an open tap (`FileDescriptor::Tap::bounce`). The NIC
+/// lock is never held across a user copy, so a frame moves NIC → `rx` → user
+/// and user → `tx` → NIC. Each is taken out while in use, like a ring.
+///
+/// Both are sized for a plain frame at `open`, and grow once (to at most
+/// [`TAP_BATCH_MAX`]) if the fd moves a batch or a vnet TSO frame.
+struct TapBounce {
+    refs: u32,
+    rx: Option<Vec<u8>>,
+    tx: Option<Vec<u8>>,
+}
+
+static TAP_BOUNCE: Spinlock<BTreeMap<u32, TapBounce>> = Spinlock::new(BTreeMap::new());
+static NEXT_BOUNCE_ID: AtomicU32 = AtomicU32::new(1);
+
+/// Threads to wake on the next RX interrupt: blocked readers (armed by
+/// `akuma_net::rump_tap`) and pollers of a tap fd.
+static RX_POLLERS: Spinlock<BTreeSet<usize>> = Spinlock::new(BTreeSet::new());
+
+/// Route NIC1's interrupt `irq` to the RX wakeup and let blocked tap readers
+/// sleep on it. Call once the tap is bound.
+pub fn tap_wire_rx_irq(irq: u32) {
+    crate::irq::register_handler(irq, tap_rx_irq);
+    akuma_net::rump_tap::set_rx_wait(akuma_net::rump_tap::RxWait {
+        arm: || rx_add_poller(akuma_exec::threading::current_thread_id()),
+        park: akuma_exec::threading::schedule_blocking,
+    });
+}
+
+fn tap_rx_irq(_irq: u32) {
+    if akuma_net::rump_tap::ack_interrupt() {
+        rx_wake_all();
+    }
+}
+
+fn rx_wake_all() {
+    crate::irq::with_irqs_disabled(|| {
+        let mut pollers = RX_POLLERS.lock();
+        while let Some(tid) = pollers.pop_first() {
+            akuma_exec::threading::get_waker_for_thread(tid).wake();
+        }
+    });
+}
+
+/// Wake `tid` on the next RX interrupt.
+pub(super) fn rx_add_poller(tid: usize) {
+    crate::irq::with_irqs_disabled(|| {
+        RX_POLLERS.lock().insert(tid);
+    });
+}
+
+/// `POLLIN` on a tap fd of `tgid`: a frame is waiting in the NIC, or in the
+/// process's ring (filled by a sync it has not consumed yet). The ring is
+/// taken out for the read, as for a sync; one being synced counts as empty,
+/// since that sync reports its frames itself.
+pub(super) fn tap_can_read(tgid: u32) -> bool {
+    if akuma_net::rump_tap::rx_ready() {
+        return true;
+    }
+    let (base, ring) = match TAP_RINGS.lock().get_mut(&tgid) {
+        Some((base, slot)) => match slot.take() {
+            Some(ring) => (*base, ring),
+            None => return false,
+        },
+        None => return false,
+    };
+    let pending = ring.rx_pending(&mut UserRing { base });
+    if let Some((b, slot @ None)) = TAP_RINGS.lock().get_mut(&tgid)
+        && *b == base
+    {
+        *slot = Some(ring);
+    }
+    pending
+}
+
+/// The ring through the calling process's mapping at `base`.
+struct UserRing {
+    base: usize,
+}
+
+impl RingMem for UserRing {
+    fn read(&mut self, off: usize, out: &mut [u8]) -> bool {
+        off + out.len() <= RING_BYTES
+            && unsafe { copy_from_user_safe(out.as_mut_ptr(), (self.base + off) as *const u8, out.len()).is_ok() }
+    }
+    fn write(&mut self, off: usize, data: &[u8]) -> bool {
+        off + data.len() <= RING_BYTES
+            && unsafe { copy_to_user_safe((self.base + off) as *mut u8, data.as_ptr(), data.len()).is_ok() }
+    }
+}
+
+/// Whether an `mmap` of a tap fd asks for the ring: all of it, shared,
+/// writable, from offset 0.
+pub(super) fn ring_mmap_ok(len: usize, prot: u32, flags: u32, offset: usize) -> bool {
+    len == RING_BYTES && flags & super::mem::MAP_SHARED != 0 && prot & super::mem::PROT_WRITE != 0 && offset == 0
+}
+
+/// `sys_mmap` mapped zeroed pages for a tap ring at `base`: write the header
+/// and register it. False if the header could not be written.
+pub(super) fn ring_mapped(tgid: u32, base: usize) -> bool {
+    let Ok(ring) = TapRing::init(&mut UserRing { base }) else { return false };
+    TAP_RINGS.lock().insert(tgid, (base, Some(ring)));
+    true
+}
+
+/// A tap fd of `tgid` was closed.
+pub(super) fn ring_close(tgid: u32) {
+    TAP_RINGS.lock().remove(&tgid);
+}
+
+/// Allocate the staging buffers of a newly opened tap; returns their id.
+pub(super) fn tap_open() -> u32 {
+    let id = NEXT_BOUNCE_ID.fetch_add(1, Ordering::Relaxed);
+    let bounce = TapBounce {
+        refs: 1,
+        rx: Some(alloc::vec![0u8; akuma_rump::FRAME_BUF]),
+        tx: Some(alloc::vec![0u8; akuma_rump::FRAME_BUF]),
+    };
+    akuma_net::stats::tap_bounce_alloc();
+    TAP_BOUNCE.lock().insert(id, bounce);
+    id
+}
+
+/// A tap fd was duplicated (`dup`, fork): it shares the staging buffers.
+pub fn tap_clone_ref(id: u32) {
+    if let Some(b) = TAP_BOUNCE.lock().get_mut(&id) {
+        b.refs += 1;
+    }
+}
+
+/// A tap fd was closed; the last one frees the staging buffers.
+pub fn tap_close(id: u32) {
+    let freed = {
+        let mut table = TAP_BOUNCE.lock();
+        match table.get_mut(&id) {
+            Some(b) if b.refs > 1 => {
+                b.refs -= 1;
+                None
+            }
+            Some(_) => table.remove(&id),
+            None => None,
+        }
+    };
+    // Dropped outside the lock
+    drop(freed);
+}
+
+/// Take the `tx` (else `rx`) staging buffer of tap `id`, at least `len` bytes
+/// long. Another thread of the fd holding it gets a temporary one instead.
+fn take_bounce(id: u32, tx: bool, len: usize) -> Vec<u8> {
+    let taken = TAP_BOUNCE.lock().get_mut(&id).and_then(|b| if tx { b.tx.take() } else { b.rx.take() });
+    let mut buf = taken.unwrap_or_else(|| {
+        akuma_net::stats::tap_bounce_busy();
+        Vec::new()
+    });
+    if buf.len() < len {
+        buf.resize(len, 0);
+        akuma_net::stats::tap_bounce_alloc();
+    }
+    buf
+}
+
+/// Return a buffer from [`take_bounce`], unless the slot was refilled meanwhile
+/// or the tap closed (then it is freed).
+fn put_bounce(id: u32, tx: bool, buf: Vec<u8>) {
+    if let Some(b) = TAP_BOUNCE.lock().get_mut(&id) {
+        let slot = if tx { &mut b.tx } else { &mut b.rx };
+        if slot.is_none() {
+            *slot = Some(buf);
+        }
+    }
+}
+
+/// Fault in `[va, va + len)` for writing (demand pages, copy-on-write), so a
+/// frame is only taken off the NIC once the copy to it can succeed. Each page
+/// has one byte read and written back.
+fn fault_in_writable(va: usize, len: usize) -> bool {
+    if len == 0 {
+        return true;
+    }
+    let end = va + len;
+    let mut p = va;
+    while p < end {
+        let mut b = 0u8;
+        unsafe {
+            if copy_from_user_safe(&raw mut b, p as *const u8, 1).is_err()
+                || copy_to_user_safe(p as *mut u8, &raw const b, 1).is_err()
+            {
+                return false;
+            }
+        }
+        p = (p & !0xFFF) + 0x1000;
+    }
+    true
+}
+
+/// Plain `read` of a tap fd: one frame, truncated to `count`. O_NONBLOCK →
+/// `EAGAIN` when none is ready; otherwise blocks (see `rump_tap::block_on`).
+///
+/// The user buffer is faulted in for writing first, then the frame is copied
+/// into the fd's RX staging buffer under the NIC lock and out to the user
+/// after it. A second thread reading the same tap meanwhile stages on its
+/// stack instead (a frame is at most `FRAME_BUF` bytes).
+pub(super) fn tap_read(id: u32, buf_ptr: u64, count: usize, nonblock: bool) -> u64 {
+    let want = count.min(akuma_rump::FRAME_BUF);
+    if !fault_in_writable(buf_ptr as usize, want) {
+        return EFAULT;
+    }
+    let mut own = TAP_BOUNCE.lock().get_mut(&id).and_then(|b| b.rx.take());
+    let mut on_stack;
+    let buf: &mut [u8] = if let Some(rx) = own.as_deref_mut() {
+        &mut rx[..want]
+    } else {
+        akuma_net::stats::tap_bounce_busy();
+        on_stack = [0u8; akuma_rump::FRAME_BUF];
+        &mut on_stack[..want]
+    };
+    let got = if nonblock {
+        akuma_net::rump_tap::read_frame(buf)
+    } else {
+        akuma_net::rump_tap::read_frame_blocking(buf, None)
+    };
+    let ret = match got {
+        Some(n) => {
+            // Only a sibling unmapping the buffer since the fault-in fails
+            // here; the frame is dropped, as Linux's tun does on a failed
+            // copy-out.
+            if n > 0 && unsafe { copy_to_user_safe(buf_ptr as *mut u8, buf.as_ptr(), n).is_err() } {
+                EFAULT
+            } else {
+                akuma_net::stats::tap_rx(n);
+                n as u64
+            }
+        }
+        None => EAGAIN,
+    };
+    if let Some(rx) = own {
+        put_bounce(id, false, rx);
+    }
+    ret
+}
+
+/// Plain `write` of a tap fd: one frame. The NIC reads the frame by DMA from
+/// kernel memory, so it is copied once, into the fd's TX staging buffer. A
+/// vnet TSO frame fits 64 KB with its header
+/// (`akuma_rump::vnet::TSO_FRAME_MAX`); anything past that is a short write.
+///
+/// A second thread writing the same tap meanwhile gets a heap buffer for that
+/// frame: the DMA needs kernel heap memory, not a stack. virtif serialises
+/// its sends, so this only counts (`bounce_busy`) when something else shares
+/// the fd.
+pub(super) fn tap_write(id: u32, buf_ptr: u64, count: usize) -> u64 {
+    let len = count.min(TAP_BATCH_MAX);
+    let mut tx = take_bounce(id, true, len);
+    let ret = if unsafe { copy_from_user_safe(tx.as_mut_ptr(), buf_ptr as *const u8, len).is_err() } {
+        EFAULT
+    } else {
+        match akuma_net::rump_tap::write_frame(&tx[..len]) {
+            Ok(n) => {
+                akuma_net::stats::tap_tx(n);
+                n as u64
+            }
+            Err(_) => EIO,
+        }
+    };
+    put_bounce(id, true, tx);
+    ret
+}
+
+/// `TAPRINGSYNC`: returns the RX frames waiting in the ring. With
+/// `TAPRING_WAIT`, blocks (re-syncing on each wakeup) until there is one.
+/// `EBUSY` while another thread of the process is syncing; that thread is
+/// woken to re-sync, so a TX kick from the sender is never lost.
+pub(super) fn ring_sync(tgid: u32, arg: u64) -> u64 {
+    let (base, mut ring) = match TAP_RINGS.lock().get_mut(&tgid) {
+        Some((base, slot)) => match slot.take() {
+            Some(ring) => (*base, ring),
+            None => {
+                rx_wake_all();
+                return EBUSY;
+            }
+        },
+        None => return EINVAL,
+    };
+    // Still the region the ring was mapped to (not unmapped and reused)
+    let mapped = akuma_exec::process::lookup_process(tgid).is_some_and(|p| {
+        p.vm_with_regions(|r| r.iter().any(|(start, frames)| *start == base && frames.len() * 4096 >= RING_BYTES))
+    });
+    if !mapped {
+        ring_close(tgid);
+        return EFAULT;
+    }
+    let mut mem = UserRing { base };
+    let result = if arg & TAPRING_WAIT != 0 {
+        akuma_net::rump_tap::sync_ring_blocking(&mut ring, &mut mem, None)
+    } else {
+        Some(akuma_net::rump_tap::sync_ring(&mut ring, &mut mem))
+    };
+    // Unless the process mapped a new ring or closed the tap meanwhile
+    if let Some((b, slot @ None)) = TAP_RINGS.lock().get_mut(&tgid)
+        && *b == base
+    {
+        *slot = Some(ring);
+    }
+    match result {
+        Some(Ok(s)) => u64::from(s.rx_ready),
+        Some(Err(RingError::Fault)) => EFAULT,
+        Some(Err(RingError::Corrupt)) => EINVAL,
+        None => EAGAIN,
+    }
+}
+
+/// `TAPSETVNET`: switch the tap's virtio-net header mode on (`arg` != 0) or
+/// off. Returns the virtio-net offload feature bits now negotiated, so the
+/// caller knows which header requests the device will honour (none on a
+/// user-mode netdev); a plain-frame tap reports 0.
+pub(super) fn set_vnet(arg: u64) -> u64 {
+    match akuma_net::rump_tap::set_vnet(arg != 0) {
+        Ok(features) => features,
+        Err(_) => EIO,
+    }
+}
+
+/// `struct tap_batch` of the tap batch ioctls: a user buffer of
+/// `akuma_rump::BATCH_HDR` frame records and, for receive, the most frames
+/// to return.
+#[repr(C)]
+#[derive(Default)]
+struct TapBatch {
+    buf: u64,
+    len: u32,
+    max_frames: u32,
+}
+
+/// Largest batch buffer copied per call, as for one `write` chunk.
+const TAP_BATCH_MAX: usize = 64 * 1024;
+
+/// `TAPRECVBATCH` (`recv`) / `TAPSENDBATCH`: move several frames in one
+/// syscall and one `TAP` lock. Receive blocks (unless `nonblock`) for the
+/// first frame, then takes whatever else is ready, and returns the frame
+/// count, like `recvmmsg`; send returns the frames sent, like `sendmmsg`.
+/// The batch is staged in the fd's `rx`/`tx` buffer, as for [`tap_read`] and
+/// [`tap_write`].
+pub(super) fn tap_batch(id: u32, recv: bool, nonblock: bool, arg: u64) -> u64 {
+    let size = core::mem::size_of::<TapBatch>();
+    if !validate_user_ptr(arg, size) { return EFAULT; }
+    let mut req = TapBatch::default();
+    if unsafe { copy_from_user_safe((&raw mut req).cast::<u8>(), arg as *const u8, size).is_err() } {
+        return EFAULT;
+    }
+    let len = (req.len as usize).min(TAP_BATCH_MAX);
+    if !validate_user_ptr(req.buf, len) { return EFAULT; }
+    let mut temp = take_bounce(id, !recv, len);
+    let ret = if recv {
+        let max = req.max_frames as usize;
+        let got = if nonblock {
+            akuma_net::rump_tap::read_frames(&mut temp[..len], max)
+        } else {
+            akuma_net::rump_tap::read_frames_blocking(&mut temp[..len], max, None)
+        };
+        match got {
+            Some((_, used)) if unsafe { copy_to_user_safe(req.buf as *mut u8, temp.as_ptr(), used).is_err() } => EFAULT,
+            Some((frames, _)) => frames as u64,
+            None => EAGAIN,
+        }
+    } else if unsafe { copy_from_user_safe(temp.as_mut_ptr(), req.buf as *const u8, len).is_err() } {
+        EFAULT
+    } else {
+        match akuma_net::rump_tap::write_frames(&temp[..len]) {
+            Ok(n) => n as u64,
+            Err(_) => EIO,
+        }
+    };
+    put_bounce(id, !recv, temp);
+    ret
+}
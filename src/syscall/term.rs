@@ -18,6 +18,18 @@ pub(super) fn sys_ioctl(fd: u32, cmd: u32, arg: u64) -> u64 {
     // TUN/TAP: _IOW('T', 202, int) — rump's Linux virtif uses this to bind the tap.
     #[cfg(feature = "rump")]
     const TUNSETIFF: u32 = 0x4004_54ca;
+    // Akuma tap batches: _IOWR('T', 0xf0, struct tap_batch) and
+    // _IOW('T', 0xf1, struct tap_batch), clear of Linux's TUN numbers.
+    #[cfg(feature = "rump")]
+    const TAPRECVBATCH: u32 = 0xc010_54f0;
+    #[cfg(feature = "rump")]
+    const TAPSENDBATCH: u32 = 0x4010_54f1;
+    // _IO('T', 0xf2): sync the mmap'd tap ring; arg = TAPRING_WAIT or 0
+    #[cfg(feature = "rump")]
+    const TAPRINGSYNC: u32 = 0x54f2;
+    // _IO('T', 0xf3): virtio-net header (offload) mode on (arg 1) or off (0)
+    #[cfg(feature = "rump")]
+    const TAPSETVNET: u32 = 0x54f3;
     // OSS audio ioctls for /dev/dsp (mirror crate::audio constants).
     const SNDCTL_DSP_SPEED: u32 = crate::audio::SNDCTL_DSP_SPEED;
     const SNDCTL_DSP_SETFMT: u32 = crate::audio::SNDCTL_DSP_SETFMT;
@@ -120,6 +132,28 @@ pub(super) fn sys_ioctl(fd: u32, cmd: u32, arg: u64) -> u64 {
             }
             return 0;
         }
+        #[cfg(feature = "rump")]
+        TAPRECVBATCH | TAPSENDBATCH => {
+            let (nonblock, bounce) = match proc.get_fd(fd) {
+                Some(akuma_exec::process::FileDescriptor::Tap { nonblock, bounce }) => (nonblock, bounce),
+                _ => return (-(25i64)) as u64, // ENOTTY — not a tap fd
+            };
+            return super::tap::tap_batch(bounce, cmd == TAPRECVBATCH, nonblock, arg);
+        }
+        #[cfg(feature = "rump")]
+        TAPRINGSYNC => {
+            if !matches!(proc.get_fd(fd), Some(akuma_exec::process::FileDescriptor::Tap { .. })) {
+                return (-(25i64)) as u64; // ENOTTY — not a tap fd
+            }
+            return super::tap::ring_sync(proc.tgid, arg);
+        }
+        #[cfg(feature = "rump")]
+        TAPSETVNET => {
+            if !matches!(proc.get_fd(fd), Some(akuma_exec::process::FileDescriptor::Tap { .. })) {
+                return (-(25i64)) as u64; // ENOTTY — not a tap fd
+            }
+            return super::tap::set_vnet(arg);
+        }
         _ => {}
     }
 
@@ -445,3 +479,4 @@ pub(super) fn sys_get_cpu_stats(ptr: u64, max: usize) -> u64 {
     }
     count as u64
 }
+
@@ -20,6 +20,26 @@ pub fn init() {
         let rtc = Rtc::new(0x9010000 as *mut _);
         *RTC.lock() = Some(rtc);
     }
+    enable_el0_counter_access();
+    if crate::config::EL0_COUNTERS_PRCTL_ENABLED {
+        akuma_exec::el0_counters::init();
+    }
+}
+
+// Let EL0 read CNTVCT_EL0/CNTFRQ_EL0 directly (CNTKCTL_EL1.EL0VCTEN, bit 1) so the
+// time page fast path (akuma_exec::timepage, docs/TIME_PAGE.md) never traps.
+// Per-PE register: the BSP sets it here, each secondary in smp.rs before it arms
+// its CNTV tick. Pure asm, no statics — safe in the secondaries' isolated context.
+pub fn enable_el0_counter_access() {
+    if !crate::config::TIME_PAGE_ENABLED {
+        return;
+    }
+    unsafe {
+        let mut kctl: u64;
+        asm!("mrs {}, cntkctl_el1", out(reg) kctl, options(nomem, nostack));
+        kctl |= 1 << 1; // EL0VCTEN
+        asm!("msr cntkctl_el1, {}", "isb", in(reg) kctl, options(nomem, nostack));
+    }
 }
 
 // Enable timer interrupts for preemptive scheduling
@@ -152,6 +172,13 @@ pub fn uptime_us() -> u64 {
     get_time_us()
 }
 
+// Nanoseconds since boot, computed exactly as the EL0 time page readers do
+// (akuma_exec::timepage::counter_to_ns) so clock_gettime gives the same value
+// whether it traps or not.
+pub fn uptime_ns() -> u64 {
+    akuma_exec::timepage::counter_to_ns(read_counter(), read_frequency())
+}
+
 // Read Unix timestamp from PL031 RTC (seconds since Unix epoch)
 // Returns None if RTC is not initialized
 pub fn read_rtc_timestamp() -> Option<u32> {
@@ -177,7 +204,9 @@ pub fn init_utc_from_rtc() -> bool {
 pub fn set_utc_time_us(unix_epoch_us: u64) {
     let boot_time = uptime_us();
     let mut offset = UTC_OFFSET_US.lock();
-    *offset = Some(unix_epoch_us.saturating_sub(boot_time));
+    let off = unix_epoch_us.saturating_sub(boot_time);
+    *offset = Some(off);
+    akuma_exec::timepage::set_realtime_offset_ns(Some(off.saturating_mul(1_000)));
 }
 
 // Get current UTC time in microseconds since Unix epoch
@@ -187,6 +216,13 @@ pub fn utc_time_us() -> Option<u64> {
     offset.map(|off| off.wrapping_add(uptime_us()))
 }
 
+// Get current UTC time in nanoseconds since Unix epoch (CLOCK_REALTIME)
+// Same offset + counter arithmetic as the time page, see uptime_ns()
+pub fn utc_time_ns() -> Option<u64> {
+    let offset = *UTC_OFFSET_US.lock();
+    offset.map(|off| off.wrapping_mul(1_000).wrapping_add(uptime_ns()))
+}
+
 // Get current UTC time in seconds since Unix epoch
 // Returns None if UTC time has not been set
 // Used by TLS certificate verification
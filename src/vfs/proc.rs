@@ -6,6 +6,7 @@
 //! - /proc/<pid>/fd/1 - stdout (readable by all, writable by owning process)
 //! - /proc/<pid>/cmdline - argv as NUL-separated bytes (Linux-compatible)
 //! - /proc/<pid>/status - human-readable `Name`, `State`, `Pid`, `PPid`, etc.
+//! - /proc/<pid>/emulation - counters for EL0 instructions the kernel emulated
 //!
 //! # TODO: Rewrite without allocations
 //!
@@ -25,9 +26,24 @@ use crate::config::PROC_STDOUT_MAX_SIZE;
 use akuma_exec::process::{self, Pid, ProcessState};
 
 // ============================================================================
-// /proc/<pid>/cmdline + status (Linux-style)
+// /proc/<pid>/cmdline + status (Linux-style), emulation (Akuma)
 // ============================================================================
 
+/// Per-process files served from the process table rather than a log.
+const PID_FILES: [&str; 3] = ["cmdline", "status", "emulation"];
+
+fn is_pid_file(name: &str) -> bool {
+    PID_FILES.contains(&name)
+}
+
+fn proc_pid_file_bytes(p: &process::Process, name: &str) -> Vec<u8> {
+    match name {
+        "cmdline" => proc_cmdline_bytes(p),
+        "emulation" => p.emulation.format().into_bytes(),
+        _ => proc_status_text(p).into_bytes(),
+    }
+}
+
 fn proc_cmdline_bytes(p: &process::Process) -> Vec<u8> {
     if p.args.is_empty() {
         let mut v: Vec<u8> = p.name.as_bytes().to_vec();
@@ -298,18 +314,14 @@ impl Filesystem for ProcFilesystem {
                     is_symlink: false,
                     size: 0,
                 });
-                pid_entries.push(DirEntry {
-                    name: String::from("cmdline"),
-                    is_dir: false,
-                    is_symlink: false,
-                    size: 0,
-                });
-                pid_entries.push(DirEntry {
-                    name: String::from("status"),
-                    is_dir: false,
-                    is_symlink: false,
-                    size: 0,
-                });
+                for name in PID_FILES {
+                    pid_entries.push(DirEntry {
+                        name: String::from(name),
+                        is_dir: false,
+                        is_symlink: false,
+                        size: 0,
+                    });
+                }
             }
             if crate::config::PROC_SYSCALL_LOG_ENABLED
                 && crate::syscall::log::get_formatted(pid).is_some()
@@ -389,10 +401,10 @@ impl Filesystem for ProcFilesystem {
                 }
         }
 
-        // Handle <pid>/cmdline and <pid>/status
+        // Handle <pid>/cmdline, status and emulation
         {
             let parts: Vec<&str> = path.splitn(2, '/').collect();
-            if parts.len() == 2 && (parts[1] == "cmdline" || parts[1] == "status")
+            if parts.len() == 2 && is_pid_file(parts[1])
                 && let Ok(pid) = parts[0].parse::<Pid>() {
                     let proc = process::lookup_process(pid).ok_or(FsError::NotFound)?;
                     let current_box_id =
@@ -400,11 +412,7 @@ impl Filesystem for ProcFilesystem {
                     if current_box_id != 0 && proc.box_id != current_box_id {
                         return Err(FsError::NotFound);
                     }
-                    let data = if parts[1] == "cmdline" {
-                        proc_cmdline_bytes(proc)
-                    } else {
-                        proc_status_text(proc).into_bytes()
-                    };
+                    let data = proc_pid_file_bytes(proc, parts[1]);
                     if offset >= data.len() {
                         return Ok(0);
                     }
@@ -563,19 +571,16 @@ impl Filesystem for ProcFilesystem {
                 }
         }
 
-        // Handle <pid>/cmdline and <pid>/status
+        // Handle <pid>/cmdline, status and emulation
         {
             let parts: Vec<&str> = path.splitn(2, '/').collect();
-            if parts.len() == 2 && (parts[1] == "cmdline" || parts[1] == "status")
+            if parts.len() == 2 && is_pid_file(parts[1])
                 && let Ok(pid) = parts[0].parse::<Pid>() {
                     let proc = process::lookup_process(pid).ok_or(FsError::NotFound)?;
                     if current_box_id != 0 && proc.box_id != current_box_id {
                         return Err(FsError::NotFound);
                     }
-                    if parts[1] == "cmdline" {
-                        return Ok(proc_cmdline_bytes(proc));
-                    }
-                    return Ok(proc_status_text(proc).into_bytes());
+                    return Ok(proc_pid_file_bytes(proc, parts[1]));
                 }
         }
 
@@ -712,7 +717,7 @@ impl Filesystem for ProcFilesystem {
             if parts.len() == 2 && parts[1] == "fd" {
                 return Self::process_exists(pid);
             }
-            if parts.len() == 2 && (parts[1] == "cmdline" || parts[1] == "status") {
+            if parts.len() == 2 && is_pid_file(parts[1]) {
                 if !Self::process_exists(pid) {
                     return false;
                 }
@@ -859,19 +864,15 @@ impl Filesystem for ProcFilesystem {
                 }
                 return Err(FsError::NotFound);
             }
-            // <pid>/cmdline and <pid>/status
-            if parts.len() == 2 && (parts[1] == "cmdline" || parts[1] == "status") {
+            // <pid>/cmdline, status and emulation
+            if parts.len() == 2 && is_pid_file(parts[1]) {
                 let proc = process::lookup_process(pid).ok_or(FsError::NotFound)?;
                 let current_box_id =
                     akuma_exec::process::current_process().map_or(0, |p| p.box_id);
                 if current_box_id != 0 && proc.box_id != current_box_id {
                     return Err(FsError::NotFound);
                 }
-                let size = if parts[1] == "cmdline" {
-                    proc_cmdline_bytes(proc).len() as u64
-                } else {
-                    proc_status_text(proc).len() as u64
-                };
+                let size = proc_pid_file_bytes(proc, parts[1]).len() as u64;
                 return Ok(Metadata {
                     is_dir: false,
                     size,
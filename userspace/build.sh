@@ -29,12 +29,75 @@ build_member() {
     fi
 }
 
+# Build the cshim microbenchmarks (static musl binaries). The shim is linked
+# under renamed symbols so it can sit next to musl's own mem*/str*/qsort.
+build_cshim_bench() {
+    echo "Building cshim benchmarks (C)..."
+    (
+        cd cshim/bench
+        for src in mem string qsort dtoa printf; do
+            aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+                "-DCSHIM_NAME(n)=cshim_##n" -o "$src.o" "../$src.c"
+        done
+        local cc_bench=(aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -fno-builtin
+                        -fno-tree-loop-distribute-patterns)
+        "${cc_bench[@]}" -o mem_bench mem_bench.c mem.o
+        "${cc_bench[@]}" -o str_bench str_bench.c string.o
+        "${cc_bench[@]}" -o qsort_bench qsort_bench.c qsort.o
+        "${cc_bench[@]}" -o dtoa_bench dtoa_bench.c dtoa.o
+        "${cc_bench[@]}" -o printf_bench printf_bench.c printf.o dtoa.o
+    )
+    cp cshim/bench/mem_bench cshim/bench/str_bench cshim/bench/qsort_bench cshim/bench/dtoa_bench \
+        cshim/bench/printf_bench ../bootstrap/bin/
+    echo "mem_bench + str_bench + qsort_bench + dtoa_bench + printf_bench (C) copied to bootstrap/bin/"
+    # qjs scripts exercising cshim (math.c, dtoa.c) and libunicode through
+    # the engine.
+    cp quickjs/bench/math_bench.js quickjs/bench/json_bench.js quickjs/bench/unicode_bench.js \
+        ../bootstrap/bin/
+    echo "math_bench.js + json_bench.js + unicode_bench.js (qjs) copied to bootstrap/bin/"
+    # qjs Worker and libbf multiplication thread scaling (run on 1, 2 and 4
+    # vCPUs).
+    cp quickjs/bench/worker_bench.js quickjs/bench/bigint_bench.js ../bootstrap/bin/
+    echo "worker_bench.js + bigint_bench.js (qjs) copied to bootstrap/bin/"
+    # Akuma.crypto against plain JS (QJS_CRYPTO_HW=0 for the portable path),
+    # and streaming JSON against whole-input parsing.
+    cp quickjs/bench/crypto_bench.js quickjs/bench/ndjson_bench.js ../bootstrap/bin/
+    echo "crypto_bench.js + ndjson_bench.js (qjs) copied to bootstrap/bin/"
+    # tcc link timing: writes a 20-object program to link against libc.a.
+    cp tcc/examples/link_bench/gen.c ../bootstrap/link_bench.c
+    echo "link_bench.c (tcc) copied to bootstrap/"
+}
+
+# mmap/munmap and demand-paging throughput (C, opt-in via --with-bench).
+build_mmap_bench() {
+    echo "Building mmap_bench (C)..."
+    (
+        cd forktest/c_stress
+        aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -o mmap_bench mmap_bench.c -lpthread
+    )
+    cp forktest/c_stress/mmap_bench ../bootstrap/bin/
+    echo "mmap_bench (C) copied to bootstrap/bin/"
+}
+
+# Clock-read cost, syscall vs time page (C, opt-in via --with-bench).
+build_clock_bench() {
+    echo "Building clock_bench (C)..."
+    (
+        cd forktest/c_stress
+        aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -I../../cshim -o clock_bench clock_bench.c
+    )
+    cp forktest/c_stress/clock_bench ../bootstrap/bin/
+    echo "clock_bench (C) copied to bootstrap/bin/"
+}
+
 WITH_FORKTEST=false
+WITH_BENCH=false
 FORCE_REBUILD=false
 MEMBER_ONLY=""
 for arg in "$@"; do
     case "$arg" in
         --with-forktest) WITH_FORKTEST=true ;;
+        --with-bench) WITH_BENCH=true ;;
         --force-rebuild) FORCE_REBUILD=true ;;
         --*-only)
             member="${arg#--}"
@@ -72,7 +135,13 @@ if [ -n "$MEMBER_ONLY" ]; then
             echo "Warning: Binary $MEMBER_ONLY not found"
         fi
     fi
-    echo "Build process completed."
+    if [ "$WITH_BENCH" = true ]; then
+        build_cshim_bench
+        build_mmap_bench
+        build_clock_bench
+    fi
+
+echo "Build process completed."
     exit 0
 fi
 
@@ -102,6 +171,7 @@ MEMBERS=(
     "wavplay"
     "scratch"
     "needle-server"
+    "netbench"
     "nca"
     )
 
@@ -148,6 +218,7 @@ BINARIES=(
     "llama-cli"
     "crush"
     "needle-server"
+    "netbench"
     "nca"
 )
 
@@ -205,11 +276,18 @@ if [ "$WITH_FORKTEST" = true ]; then
     (
         cd forktest/c_stress
         aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -o mmap_stress mmap_stress.c
-        aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -o pattern2_parent pattern2_parent.c
+        aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -o pattern2_parent pattern2_parent.c -lpthread
     )
     cp forktest/c_stress/mmap_stress ../bootstrap/bin/
     cp forktest/c_stress/pattern2_parent ../bootstrap/bin/
     echo "mmap_stress + pattern2_parent (C) copied to bootstrap/bin/"
 fi
 
+# cshim microbenchmarks (C, opt-in via --with-bench).
+if [ "$WITH_BENCH" = true ]; then
+    build_cshim_bench
+    build_mmap_bench
+    build_clock_bench
+fi
+
 echo "Build process completed."
@@ -0,0 +1,257 @@
+/*
+ * akuma_timing.h — header-only benchmark timing for C code on Akuma
+ *
+ *   akt_init()            opt in to EL0 counter reads (prctl), calibrate
+ *   akt_now()             raw ticks: PMCCNTR_EL0 cycles if granted, else CNTVCT_EL0
+ *   akt_to_ns(ticks)      ticks -> ns with a calibrated 40.24 fixed-point factor
+ *   struct akt_hist       log2 latency histogram: add, quantile, print
+ *
+ * akt_init() asks the kernel for PMCCNTR_EL0 and CNTVCT_EL0 with
+ * prctl(AKT_PR_EL0_COUNTERS, mask) (docs/TIME_PAGE.md, "Cycle counter"). With
+ * the cycle counter granted it measures the cycle rate against CNTVCT for
+ * ~10 ms; otherwise it ticks at CNTFRQ_EL0. Both reads are a bare `isb; mrs`,
+ * no syscall, so a timed region costs a few ns instead of an SVC round trip.
+ * On a kernel without the prctl (or Linux) the call fails and the CNTVCT
+ * path is used, which EL0 can read there anyway.
+ *
+ * Same rules as the rest of cshim: no includes, so it builds against the
+ * qjs shim headers, musl or tcc alike. tcc has no arm64 inline assembler, so
+ * under __TINYC__ the four register reads are external functions that
+ * libtcc1.a provides, built from this header with -DAKT_OUT_OF_LINE
+ * (tcc/build.rs). Elsewhere than AArch64 the reads return 0 and akt_init()
+ * reports AKT_SRC_NONE.
+ *
+ *   #include "akuma_timing.h"
+ *   struct akt_hist h;
+ *   akt_init();
+ *   akt_hist_init(&h);
+ *   for (...) { akt_u64 t0 = akt_now(); work(); akt_hist_add(&h, akt_to_ns(akt_now() - t0)); }
+ *   akt_hist_print(&h, "work", printf);
+ */
+#ifndef AKUMA_TIMING_H
+#define AKUMA_TIMING_H
+
+typedef unsigned long long akt_u64;
+
+/* prctl option and grant bits (akuma_exec::el0_counters) */
+#define AKT_PR_EL0_COUNTERS 0x414b4330 /* "AKC0" */
+#define AKT_CNTVCT 1
+#define AKT_PMCCNTR 2
+
+/* What akt_now() counts */
+#define AKT_SRC_NONE 0
+#define AKT_SRC_CNTVCT 1
+#define AKT_SRC_PMCCNTR 2
+
+/* ---- register reads ---------------------------------------------------- */
+
+#if defined(__TINYC__) && !defined(AKT_OUT_OF_LINE)
+akt_u64 akt_cntvct(void);
+akt_u64 akt_cntfrq(void);
+akt_u64 akt_pmccntr(void);
+long akt_prctl2(long option, long arg2);
+#else
+#ifdef AKT_OUT_OF_LINE
+#define AKT_RAW
+#else
+#define AKT_RAW static inline
+#endif
+
+AKT_RAW akt_u64 akt_cntvct(void) {
+#ifdef __aarch64__
+    akt_u64 c;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(c)::"memory");
+    return c;
+#else
+    return 0;
+#endif
+}
+
+AKT_RAW akt_u64 akt_cntfrq(void) {
+#ifdef __aarch64__
+    akt_u64 f;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(f));
+    return f;
+#else
+    return 0;
+#endif
+}
+
+/* Traps (SIGILL) unless the kernel granted AKT_PMCCNTR */
+AKT_RAW akt_u64 akt_pmccntr(void) {
+#ifdef __aarch64__
+    akt_u64 c;
+    __asm__ volatile("isb; mrs %0, pmccntr_el0" : "=r"(c)::"memory");
+    return c;
+#else
+    return 0;
+#endif
+}
+
+/* Raw prctl(2): the header cannot include <sys/prctl.h> */
+AKT_RAW long akt_prctl2(long option, long arg2) {
+#ifdef __aarch64__
+    register long x8 __asm__("x8") = 167; /* __NR_prctl */
+    register long x0 __asm__("x0") = option;
+    register long x1 __asm__("x1") = arg2;
+    register long x2 __asm__("x2") = 0;
+    register long x3 __asm__("x3") = 0;
+    register long x4 __asm__("x4") = 0;
+    __asm__ volatile("svc #0" : "+r"(x0) : "r"(x8), "r"(x1), "r"(x2), "r"(x3), "r"(x4) : "memory");
+    return x0;
+#else
+    (void)option;
+    (void)arg2;
+    return -38; /* -ENOSYS */
+#endif
+}
+#endif
+
+#ifndef AKT_OUT_OF_LINE
+
+/* ---- clock ------------------------------------------------------------- */
+
+#define AKT_SHIFT 24
+
+static struct {
+    int src;      /* AKT_SRC_* */
+    akt_u64 freq; /* akt_now() ticks per second */
+    akt_u64 mult; /* ns per tick << AKT_SHIFT */
+} akt__clk;
+
+static inline akt_u64 akt_now(void) {
+    return akt__clk.src == AKT_SRC_PMCCNTR ? akt_pmccntr() : akt_cntvct();
+}
+
+/* ticks * 1e9 / freq without a division or 128-bit product: accurate to a
+ * few parts in 10^8 at counter rates, exact enough for any benchmark. */
+static inline akt_u64 akt_to_ns(akt_u64 ticks) {
+    akt_u64 hi = ticks >> AKT_SHIFT, lo = ticks & ((1ULL << AKT_SHIFT) - 1);
+    return hi * akt__clk.mult + ((lo * akt__clk.mult) >> AKT_SHIFT);
+}
+
+static inline akt_u64 akt_freq(void) { return akt__clk.freq; }
+static inline int akt_source(void) { return akt__clk.src; }
+static inline const char *akt_source_name(void) {
+    return akt__clk.src == AKT_SRC_PMCCNTR ? "pmccntr" : akt__clk.src == AKT_SRC_CNTVCT ? "cntvct" : "none";
+}
+
+/* Opt in and calibrate; returns the AKT_SRC_* now in use. Safe to call again
+ * (e.g. after fork, whose child does not inherit the cycle-counter grant). */
+static inline int akt_init(void) {
+    long granted = akt_prctl2(AKT_PR_EL0_COUNTERS, AKT_CNTVCT | AKT_PMCCNTR);
+    akt_u64 frq = akt_cntfrq();
+
+    akt__clk.src = AKT_SRC_NONE;
+    akt__clk.freq = 0;
+    akt__clk.mult = 0;
+    if (frq == 0)
+        return AKT_SRC_NONE;
+    akt__clk.src = AKT_SRC_CNTVCT;
+    akt__clk.freq = frq;
+    if (granted > 0 && (granted & AKT_PMCCNTR)) {
+        akt_u64 c0 = akt_cntvct(), p0 = akt_pmccntr(), c1, p1;
+        do
+            c1 = akt_cntvct();
+        while (c1 - c0 < frq / 100);
+        p1 = akt_pmccntr();
+        if (p1 > p0) {
+            akt__clk.src = AKT_SRC_PMCCNTR;
+            akt__clk.freq = (p1 - p0) * frq / (c1 - c0);
+        }
+    }
+    akt__clk.mult = (1000000000ULL << AKT_SHIFT) / akt__clk.freq;
+    return akt__clk.src;
+}
+
+/* ---- log2 histogram ---------------------------------------------------- */
+
+/* Bucket 0 holds 0; bucket k > 0 holds [2^(k-1), 2^k). */
+#define AKT_HIST_BUCKETS 64
+
+struct akt_hist {
+    akt_u64 n, sum, min, max;
+    akt_u64 bucket[AKT_HIST_BUCKETS];
+};
+
+static inline int akt_log2_bucket(akt_u64 v) {
+#if defined(__GNUC__) && !defined(__TINYC__)
+    int k = v ? 64 - __builtin_clzll(v) : 0;
+#else
+    int k = 0;
+    while (v) {
+        v >>= 1;
+        k++;
+    }
+#endif
+    return k < AKT_HIST_BUCKETS ? k : AKT_HIST_BUCKETS - 1;
+}
+
+static inline void akt_hist_init(struct akt_hist *h) {
+    int i;
+    h->n = h->sum = h->max = 0;
+    h->min = ~0ULL;
+    for (i = 0; i < AKT_HIST_BUCKETS; i++)
+        h->bucket[i] = 0;
+}
+
+static inline void akt_hist_add(struct akt_hist *h, akt_u64 v) {
+    h->n++;
+    h->sum += v;
+    if (v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+    h->bucket[akt_log2_bucket(v)]++;
+}
+
+/* Upper bound of the bucket holding the permille-th sample, clamped to
+ * [min, max]: a log2 histogram knows quantiles to within a factor of two. */
+static inline akt_u64 akt_hist_quantile(const struct akt_hist *h, unsigned permille) {
+    akt_u64 want, seen = 0, hi;
+    int k;
+
+    if (h->n == 0)
+        return 0;
+    want = (h->n * permille + 999) / 1000;
+    if (want == 0)
+        want = 1;
+    for (k = 0; k < AKT_HIST_BUCKETS; k++) {
+        seen += h->bucket[k];
+        if (seen >= want)
+            break;
+    }
+    hi = k == 0 ? 0 : (1ULL << k) - 1;
+    return hi < h->min ? h->min : hi > h->max ? h->max : hi;
+}
+
+/* One summary line, then one line per non-empty bucket:
+ *   name n=N min=.. p50=.. p90=.. p99=.. max=.. mean=..
+ *     [lo, hi] count ####
+ * `out` is printf or anything with its signature. */
+static inline void akt_hist_print(const struct akt_hist *h, const char *name, int (*out)(const char *, ...)) {
+    akt_u64 top = 0;
+    int k;
+
+    out("%s n=%llu min=%llu p50=%llu p90=%llu p99=%llu max=%llu mean=%llu\n", name, h->n,
+        h->n ? h->min : 0ULL, akt_hist_quantile(h, 500), akt_hist_quantile(h, 900),
+        akt_hist_quantile(h, 990), h->max, h->n ? h->sum / h->n : 0ULL);
+    for (k = 0; k < AKT_HIST_BUCKETS; k++)
+        if (h->bucket[k] > top)
+            top = h->bucket[k];
+    for (k = 0; k < AKT_HIST_BUCKETS; k++) {
+        akt_u64 lo = k ? 1ULL << (k - 1) : 0, hi = k ? (1ULL << k) - 1 : 0;
+        int bar, i;
+
+        if (!h->bucket[k])
+            continue;
+        bar = (int)(h->bucket[k] * 40 / top);
+        out("  [%llu, %llu] %llu ", lo, hi, h->bucket[k]);
+        for (i = 0; i < bar; i++)
+            out("#");
+        out("\n");
+    }
+}
+
+#endif /* !AKT_OUT_OF_LINE */
+#endif /* AKUMA_TIMING_H */
@@ -0,0 +1,265 @@
+/*
+ * dtoa_bench.c — cshim number conversion versus what qjs used before: the
+ * digit-summing strtod from quickjs/stubs.c (copied verbatim below) and
+ * js_ecvt's shortest-digits search, which ran snprintf("%.*e") + strtod until
+ * the digits round-tripped (reproduced here on top of musl).
+ *
+ * Inputs are the numbers a telemetry JSON payload carries: fractional
+ * doubles printed at full precision, short decimals and integers. Build like
+ * mem_bench (see build.sh):
+ *
+ *   aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+ *       -D'CSHIM_NAME(n)=cshim_##n' -o dtoa.o ../dtoa.c
+ *   aarch64-linux-musl-gcc -static -O2 -fno-builtin \
+ *       -fno-tree-loop-distribute-patterns -o dtoa_bench dtoa_bench.c dtoa.o
+ *
+ * Usage: dtoa_bench [-n=N]   (N = numbers per workload, default 200000)
+ * Output: one line per (op, workload):
+ *   op workload baseline_ns cshim_ns speedup baseline_wrong cshim_wrong
+ * where *_wrong counts results differing from musl's correctly rounded strtod
+ * (parse) or failing to round-trip / not being shortest (print).
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+double cshim_strtod(const char *nptr, char **endptr);
+int cshim_dtoa_shortest(double d, char *buf, int *decpt);
+
+/* ---- baseline: the pre-cshim conversions ---- */
+
+/* quickjs/stubs.c */
+static double stub_strtod(const char *nptr, char **endptr) {
+    double result = 0.0;
+    double fraction = 0.0;
+    double divisor = 10.0;
+    int negative = 0;
+    int in_fraction = 0;
+    int in_exponent = 0;
+    int exp_negative = 0;
+    int exponent = 0;
+    
+    while (isspace(*nptr)) nptr++;
+    
+    if (*nptr == '-') {
+        negative = 1;
+        nptr++;
+    } else if (*nptr == '+') {
+        nptr++;
+    }
+    
+    /* Handle infinity and NaN */
+    if (strncmp(nptr, "inf", 3) == 0 || strncmp(nptr, "Inf", 3) == 0 ||
+        strncmp(nptr, "INF", 3) == 0) {
+        if (endptr) *endptr = (char *)(nptr + 3);
+        return negative ? -__builtin_inf() : __builtin_inf();
+    }
+    if (strncmp(nptr, "nan", 3) == 0 || strncmp(nptr, "NaN", 3) == 0 ||
+        strncmp(nptr, "NAN", 3) == 0) {
+        if (endptr) *endptr = (char *)(nptr + 3);
+        return __builtin_nan("");
+    }
+    
+    while (*nptr) {
+        if (*nptr == '.') {
+            if (in_fraction || in_exponent) break;
+            in_fraction = 1;
+            nptr++;
+            continue;
+        }
+        if (*nptr == 'e' || *nptr == 'E') {
+            if (in_exponent) break;
+            in_exponent = 1;
+            nptr++;
+            if (*nptr == '-') {
+                exp_negative = 1;
+                nptr++;
+            } else if (*nptr == '+') {
+                nptr++;
+            }
+            continue;
+        }
+        if (!isdigit(*nptr)) break;
+        
+        if (in_exponent) {
+            exponent = exponent * 10 + (*nptr - '0');
+        } else if (in_fraction) {
+            fraction += (*nptr - '0') / divisor;
+            divisor *= 10.0;
+        } else {
+            result = result * 10.0 + (*nptr - '0');
+        }
+        nptr++;
+    }
+    
+    result += fraction;
+    
+    /* Apply exponent */
+    if (exponent != 0) {
+        double exp_mult = 1.0;
+        for (int i = 0; i < exponent; i++) {
+            exp_mult *= 10.0;
+        }
+        if (exp_negative) {
+            result /= exp_mult;
+        } else {
+            result *= exp_mult;
+        }
+    }
+    
+    if (endptr) *endptr = (char *)nptr;
+    return negative ? -result : result;
+}
+
+/* quickjs.c js_ecvt (shortest mode): bisect on the digit count, formatting
+ * with printf and reading back with strtod each step. */
+static int search_ecvt(double d, char *buf, int *decpt)
+{
+    char tmp[64];
+    int lo = 1, hi = 17;
+    while (lo < hi) {
+        int n = (lo + hi) / 2;
+        snprintf(tmp, sizeof(tmp), "%+.*e", n - 1, d);
+        if (strtod(tmp, NULL) == d)
+            hi = n;
+        else
+            lo = n + 1;
+    }
+    snprintf(tmp, sizeof(tmp), "%+.*e", hi - 1, d);
+    buf[0] = tmp[1];
+    if (hi > 1)
+        memcpy(buf + 1, tmp + 3, hi - 1);
+    int n = hi;
+    while (n >= 2 && buf[n - 1] == '0')
+        n--;
+    buf[n] = '\0';
+    *decpt = atoi(tmp + hi + 2 + (hi > 1)) + 1;
+    return n;
+}
+
+/* ---- workloads ---- */
+
+static uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+static uint64_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static double make_value(int kind)
+{
+    switch (kind) {
+    case 0: /* coordinate-like: full 17-digit doubles */
+        return (double)(next_rand() >> 11) * 0x1p-53 * 360.0 - 180.0;
+    case 1: /* prices / readings: two decimals */
+        return (double)(next_rand() % 10000000) / 100.0;
+    default: /* anything: random finite bit patterns */
+        for (;;) {
+            uint64_t b = next_rand();
+            if (((b >> 52) & 0x7ff) != 0x7ff) {
+                double d;
+                memcpy(&d, &b, sizeof(d));
+                return d;
+            }
+        }
+    }
+}
+
+static const char *const kind_name[] = { "coord", "decimal2", "random_bits" };
+
+/* ---- harness ---- */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Shortest length that round-trips, from the (correct) printf search. */
+static int is_shortest(double d, const char *digits, int n, int decpt)
+{
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%s0.%se%d", d < 0 ? "-" : "", digits, decpt);
+    if (strtod(tmp, NULL) != d)
+        return 0;
+    if (n == 1)
+        return 1;
+    snprintf(tmp, sizeof(tmp), "%.*e", n - 2, d);
+    return strtod(tmp, NULL) != d;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-n=", 3) == 0)
+            n = strtoul(argv[i] + 3, NULL, 10);
+    }
+    if (n < 1)
+        n = 1;
+
+    double *vals = malloc(n * sizeof(*vals));
+    char (*text)[32] = malloc(n * sizeof(*text));
+    if (!vals || !text) {
+        fprintf(stderr, "dtoa_bench: out of memory\n");
+        return 1;
+    }
+
+    printf("# op workload baseline_ns cshim_ns speedup baseline_wrong cshim_wrong\n");
+    volatile double sink = 0;
+    for (int kind = 0; kind < 3; kind++) {
+        for (size_t i = 0; i < n; i++) {
+            vals[i] = make_value(kind);
+            snprintf(text[i], sizeof(text[i]), kind == 1 ? "%.2f" : "%.17g", vals[i]);
+        }
+
+        size_t bad_base = 0, bad_fast = 0;
+        uint64_t t0 = now_ns();
+        for (size_t i = 0; i < n; i++)
+            sink += stub_strtod(text[i], NULL);
+        uint64_t t_base = now_ns() - t0;
+        t0 = now_ns();
+        for (size_t i = 0; i < n; i++)
+            sink += cshim_strtod(text[i], NULL);
+        uint64_t t_fast = now_ns() - t0;
+        for (size_t i = 0; i < n; i++) {
+            double want = strtod(text[i], NULL);
+            bad_base += stub_strtod(text[i], NULL) != want;
+            bad_fast += cshim_strtod(text[i], NULL) != want;
+        }
+        printf("strtod %s %.1f %.1f %.1f %zu %zu\n", kind_name[kind], (double)t_base / (double)n,
+               (double)t_fast / (double)n, (double)t_base / (double)t_fast, bad_base, bad_fast);
+
+        char digits[32];
+        int decpt, len = 0;
+        bad_base = bad_fast = 0;
+        t0 = now_ns();
+        for (size_t i = 0; i < n; i++)
+            len += search_ecvt(vals[i], digits, &decpt);
+        t_base = now_ns() - t0;
+        t0 = now_ns();
+        for (size_t i = 0; i < n; i++)
+            len += cshim_dtoa_shortest(vals[i], digits, &decpt);
+        t_fast = now_ns() - t0;
+        for (size_t i = 0; i < n; i++) {
+            int k = search_ecvt(vals[i], digits, &decpt);
+            bad_base += !is_shortest(vals[i], digits, k, decpt);
+            k = cshim_dtoa_shortest(vals[i], digits, &decpt);
+            bad_fast += !is_shortest(vals[i] < 0 ? -vals[i] : vals[i], digits, k, decpt);
+        }
+        sink += len;
+        printf("shortest %s %.1f %.1f %.1f %zu %zu\n", kind_name[kind], (double)t_base / (double)n,
+               (double)t_fast / (double)n, (double)t_base / (double)t_fast, bad_base, bad_fast);
+    }
+    free(vals);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * mem_bench.c — cshim memcpy/memmove/memset/memcmp versus the byte loops the
+ * qjs/tcc shims used before (copied verbatim below as the baseline).
+ *
+ * Static musl binary; the shim is linked under renamed symbols so it can sit
+ * next to musl's own mem* routines:
+ *
+ *   aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+ *       -D'CSHIM_NAME(n)=cshim_##n' -o mem.o ../mem.c
+ *   aarch64-linux-musl-gcc -static -O2 -fno-builtin \
+ *       -fno-tree-loop-distribute-patterns -o mem_bench mem_bench.c mem.o
+ *
+ * Usage: mem_bench [-mb=N]   (N = MiB moved per size/op pair, default 64)
+ * Output: one line per (op, size): op size_bytes byte_loop_MBps cshim_MBps speedup
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void *cshim_memcpy(void *dest, const void *src, size_t n);
+void *cshim_memmove(void *dest, const void *src, size_t n);
+void *cshim_memset(void *s, int c, size_t n);
+int cshim_memcmp(const void *s1, const void *s2, size_t n);
+
+/* ---- baseline: the pre-cshim stubs.c loops ---- */
+
+static void *byte_memset(void *s, int c, size_t n) {
+    unsigned char *p = (unsigned char *)s;
+    while (n--) {
+        *p++ = (unsigned char)c;
+    }
+    return s;
+}
+
+static void *byte_memcpy(void *dest, const void *src, size_t n) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dest;
+}
+
+static void *byte_memmove(void *dest, const void *src, size_t n) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+    if (d < s) {
+        while (n--) {
+            *d++ = *s++;
+        }
+    } else if (d > s) {
+        d += n;
+        s += n;
+        while (n--) {
+            *--d = *--s;
+        }
+    }
+    return dest;
+}
+
+static int byte_memcmp(const void *s1, const void *s2, size_t n) {
+    const unsigned char *p1 = (const unsigned char *)s1;
+    const unsigned char *p2 = (const unsigned char *)s2;
+    while (n--) {
+        if (*p1 != *p2) {
+            return *p1 - *p2;
+        }
+        p1++;
+        p2++;
+    }
+    return 0;
+}
+
+/* ---- harness ---- */
+
+#define MAX_SIZE (1u << 20)
+
+static unsigned char *buf_a;
+static unsigned char *buf_b;
+static volatile int sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+enum { OP_MEMCPY, OP_MEMMOVE, OP_MEMSET, OP_MEMCMP, OP_COUNT };
+static const char *const op_names[OP_COUNT] = { "memcpy", "memmove", "memset", "memcmp" };
+
+/* MB/s for `iters` calls of op on `size` bytes; impl 0 = byte loop, 1 = cshim. */
+static double run(int op, int impl, size_t size, size_t iters) {
+    /* +1 offsets keep the source misaligned, like most QuickJS string copies. */
+    unsigned char *dst = buf_a;
+    unsigned char *src = buf_b + 1;
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < iters; i++) {
+        switch (op) {
+        case OP_MEMCPY:
+            impl ? cshim_memcpy(dst, src, size) : byte_memcpy(dst, src, size);
+            break;
+        case OP_MEMMOVE:
+            /* Overlapping forward move: the array-splice shape. */
+            impl ? cshim_memmove(dst, dst + 8, size) : byte_memmove(dst, dst + 8, size);
+            break;
+        case OP_MEMSET:
+            impl ? cshim_memset(dst, 0, size) : byte_memset(dst, 0, size);
+            break;
+        case OP_MEMCMP:
+            sink += impl ? cshim_memcmp(dst, buf_b, size) : byte_memcmp(dst, buf_b, size);
+            break;
+        }
+    }
+    uint64_t dt = now_ns() - t0;
+    if (dt == 0)
+        dt = 1;
+    return (double)size * (double)iters * 1e3 / (double)dt;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = 64;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-mb=", 4) == 0)
+            mb = strtoul(argv[i] + 4, NULL, 10);
+    }
+
+    buf_a = malloc(MAX_SIZE + 64);
+    buf_b = malloc(MAX_SIZE + 64);
+    if (!buf_a || !buf_b) {
+        fprintf(stderr, "mem_bench: out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < MAX_SIZE + 64; i++)
+        buf_a[i] = buf_b[i] = (unsigned char)(i * 131);
+
+    printf("# op size_bytes byte_loop_MBps cshim_MBps speedup\n");
+    for (int op = 0; op < OP_COUNT; op++) {
+        for (size_t size = 8; size <= MAX_SIZE; size <<= 1) {
+            size_t iters = (mb << 20) / size;
+            if (iters == 0)
+                iters = 1;
+            if (op == OP_MEMCMP)
+                memcpy(buf_a, buf_b, size); /* equal buffers: full-length compare */
+            double base = run(op, 0, size, iters);
+            double fast = run(op, 1, size, iters);
+            printf("%s %zu %.1f %.1f %.2f\n", op_names[op], size, base, fast, fast / base);
+        }
+    }
+    return 0;
+}
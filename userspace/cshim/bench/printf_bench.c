@@ -0,0 +1,502 @@
+/*
+ * printf_bench.c — cshim vsnprintf versus the two formatters it replaced
+ * (copied verbatim below): the one from quickjs/stubs.c and the
+ * width/precision-aware one from tcc/libc_stubs.c.
+ *
+ * Each workload is one format string of the kind the ports produce: tcc
+ * diagnostics and assembler listings, generated symbol names, qjs memory-usage
+ * rows. Build like mem_bench (see build.sh):
+ *
+ *   aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+ *       -D'CSHIM_NAME(n)=cshim_##n' -o printf.o ../printf.c
+ *   aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+ *       -D'CSHIM_NAME(n)=cshim_##n' -o dtoa.o ../dtoa.c
+ *   aarch64-linux-musl-gcc -static -O2 -fno-builtin \
+ *       -fno-tree-loop-distribute-patterns -o printf_bench printf_bench.c printf.o dtoa.o
+ *
+ * Usage: printf_bench [-n=N]   (N = calls per workload and formatter, default 200000)
+ * Output: one line per workload:
+ *   workload qjs_ns tcc_ns cshim_ns speedup_vs_tcc cshim_matches_musl
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int cshim_vsnprintf(char *str, size_t size, const char *format, va_list ap);
+
+/* ---- baseline: the pre-cshim formatters ---- */
+
+/* quickjs/stubs.c */
+static int qjs_vsnprintf(char *str, size_t size, const char *format, va_list ap) {
+    char *out = str;
+    char *end = str + size - 1;
+    
+    if (size == 0) return 0;
+    
+    while (*format && out < end) {
+        if (*format != '%') {
+            *out++ = *format++;
+            continue;
+        }
+        format++;
+        
+        /* Handle flags */
+        int left_align = 0;
+        int zero_pad = 0;
+        int plus_sign = 0;
+        int space_sign = 0;
+        int hash = 0;
+        
+        while (1) {
+            if (*format == '-') { left_align = 1; format++; }
+            else if (*format == '0') { zero_pad = 1; format++; }
+            else if (*format == '+') { plus_sign = 1; format++; }
+            else if (*format == ' ') { space_sign = 1; format++; }
+            else if (*format == '#') { hash = 1; format++; }
+            else break;
+        }
+        (void)left_align; (void)plus_sign; (void)space_sign; (void)hash;
+        
+        /* Width */
+        int width = 0;
+        if (*format == '*') {
+            width = va_arg(ap, int);
+            format++;
+        } else {
+            while (isdigit(*format)) {
+                width = width * 10 + (*format - '0');
+                format++;
+            }
+        }
+        
+        /* Precision */
+        int precision = -1;
+        if (*format == '.') {
+            format++;
+            precision = 0;
+            if (*format == '*') {
+                precision = va_arg(ap, int);
+                format++;
+            } else {
+                while (isdigit(*format)) {
+                    precision = precision * 10 + (*format - '0');
+                    format++;
+                }
+            }
+        }
+        
+        /* Length modifiers */
+        int is_long = 0;
+        int is_longlong = 0;
+        int is_size_t = 0;
+        if (*format == 'l') {
+            is_long = 1;
+            format++;
+            if (*format == 'l') {
+                is_longlong = 1;
+                format++;
+            }
+        } else if (*format == 'z') {
+            is_size_t = 1;
+            format++;
+        } else if (*format == 'h') {
+            format++;
+            if (*format == 'h') format++;
+        }
+        
+        switch (*format) {
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                if (!s) s = "(null)";
+                int len = strlen(s);
+                if (precision >= 0 && len > precision) len = precision;
+                while (len-- > 0 && out < end) *out++ = *s++;
+                break;
+            }
+            case 'd':
+            case 'i': {
+                long long val;
+                if (is_longlong) val = va_arg(ap, long long);
+                else if (is_long || is_size_t) val = va_arg(ap, long);
+                else val = va_arg(ap, int);
+                
+                char buf[32];
+                int neg = val < 0;
+                if (neg) val = -val;
+                int i = 0;
+                do {
+                    buf[i++] = '0' + (val % 10);
+                    val /= 10;
+                } while (val);
+                if (neg) buf[i++] = '-';
+                while (i < width) buf[i++] = zero_pad ? '0' : ' ';
+                while (i > 0 && out < end) *out++ = buf[--i];
+                break;
+            }
+            case 'u': {
+                unsigned long long val;
+                if (is_longlong) val = va_arg(ap, unsigned long long);
+                else if (is_long || is_size_t) val = va_arg(ap, unsigned long);
+                else val = va_arg(ap, unsigned int);
+                
+                char buf[32];
+                int i = 0;
+                do {
+                    buf[i++] = '0' + (val % 10);
+                    val /= 10;
+                } while (val);
+                while (i < width) buf[i++] = zero_pad ? '0' : ' ';
+                while (i > 0 && out < end) *out++ = buf[--i];
+                break;
+            }
+            case 'x':
+            case 'X': {
+                unsigned long long val;
+                if (is_longlong) val = va_arg(ap, unsigned long long);
+                else if (is_long || is_size_t) val = va_arg(ap, unsigned long);
+                else val = va_arg(ap, unsigned int);
+                
+                const char *hex = (*format == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+                char buf[32];
+                int i = 0;
+                do {
+                    buf[i++] = hex[val & 0xF];
+                    val >>= 4;
+                } while (val);
+                while (i < width) buf[i++] = zero_pad ? '0' : ' ';
+                while (i > 0 && out < end) *out++ = buf[--i];
+                break;
+            }
+            case 'p': {
+                void *ptr = va_arg(ap, void *);
+                unsigned long long val = (unsigned long long)ptr;
+                if (out < end) *out++ = '0';
+                if (out < end) *out++ = 'x';
+                char buf[32];
+                int i = 0;
+                do {
+                    buf[i++] = "0123456789abcdef"[val & 0xF];
+                    val >>= 4;
+                } while (val);
+                while (i > 0 && out < end) *out++ = buf[--i];
+                break;
+            }
+            case 'c': {
+                char c = (char)va_arg(ap, int);
+                if (out < end) *out++ = c;
+                break;
+            }
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G': {
+                double val = va_arg(ap, double);
+                if (isnan(val)) {
+                    const char *s = "nan";
+                    while (*s && out < end) *out++ = *s++;
+                } else if (isinf(val)) {
+                    const char *s = val < 0 ? "-inf" : "inf";
+                    while (*s && out < end) *out++ = *s++;
+                } else {
+                    /* Simple float formatting */
+                    if (val < 0) {
+                        if (out < end) *out++ = '-';
+                        val = -val;
+                    }
+                    long long int_part = (long long)val;
+                    double frac_part = val - int_part;
+                    
+                    char buf[32];
+                    int i = 0;
+                    do {
+                        buf[i++] = '0' + (int_part % 10);
+                        int_part /= 10;
+                    } while (int_part);
+                    while (i > 0 && out < end) *out++ = buf[--i];
+                    
+                    if (precision < 0) precision = 6;
+                    if (precision > 0) {
+                        if (out < end) *out++ = '.';
+                        for (int j = 0; j < precision && out < end; j++) {
+                            frac_part *= 10;
+                            int digit = (int)frac_part;
+                            *out++ = '0' + digit;
+                            frac_part -= digit;
+                        }
+                    }
+                }
+                break;
+            }
+            case '%':
+                if (out < end) *out++ = '%';
+                break;
+            case 'n': {
+                int *ptr = va_arg(ap, int *);
+                *ptr = out - str;
+                break;
+            }
+            default:
+                if (out < end) *out++ = '%';
+                if (out < end) *out++ = *format;
+                break;
+        }
+        format++;
+    }
+    
+    *out = '\0';
+    return out - str;
+}
+
+/* tcc/src/libc_stubs.c */
+static int tcc_vsnprintf(char *str, size_t size, const char *format, va_list ap) {
+    char *out = str;
+    char *end = str + size - 1;
+    if (size == 0) return 0;
+    
+    while (*format && out < end) {
+        if (*format != '%') {
+            *out++ = *format++;
+            continue;
+        }
+        format++;
+        
+        // Handle flags
+        int width = 0;
+        int precision = -1;
+        int zero_pad = 0;
+        int left_justify = 0;
+        
+        if (*format == '-') { left_justify = 1; format++; }
+        if (*format == '0') { zero_pad = 1; format++; }
+        
+        // Width
+        if (*format == '*') {
+            width = va_arg(ap, int);
+            format++;
+        } else {
+            while (isdigit(*format)) { width = width * 10 + (*format - '0'); format++; }
+        }
+        
+        // Precision
+        if (*format == '.') {
+            format++;
+            if (*format == '*') {
+                precision = va_arg(ap, int);
+                format++;
+            } else {
+                precision = 0;
+                while (isdigit(*format)) { precision = precision * 10 + (*format - '0'); format++; }
+            }
+        }
+        
+        int is_long = 0;
+        int is_longlong = 0;
+        if (*format == 'l') { 
+            is_long = 1; format++; 
+            if (*format == 'l') { is_longlong = 1; format++; } 
+        } else if (*format == 'z') {
+            is_long = (sizeof(size_t) == sizeof(long));
+            is_longlong = (sizeof(size_t) == sizeof(long long));
+            format++;
+        }
+        
+        switch (*format) {
+            case 's': {
+                const char *s = va_arg(ap, const char *);
+                if (!s) s = "(null)";
+                int len = 0;
+                while (s[len] && (precision < 0 || len < precision)) len++;
+                
+                int pad = width - len;
+                if (!left_justify) {
+                    while (pad-- > 0 && out < end) *out++ = ' ';
+                }
+                while (*s && (precision < 0 || precision-- > 0) && out < end) *out++ = *s++;
+                if (left_justify) {
+                    while (pad-- > 0 && out < end) *out++ = ' ';
+                }
+                break;
+            }
+            case 'd':
+            case 'i': {
+                long long val;
+                if (is_longlong) val = va_arg(ap, long long);
+                else if (is_long) val = va_arg(ap, long);
+                else val = va_arg(ap, int);
+                
+                char buf[64];
+                int neg = val < 0;
+                unsigned long long uval = neg ? -val : val;
+                int i = 0;
+                do { buf[i++] = '0' + (uval % 10); uval /= 10; } while (uval);
+                if (neg) buf[i++] = '-';
+                
+                int pad = width - i;
+                if (!left_justify) {
+                    while (pad-- > 0 && out < end) *out++ = zero_pad ? '0' : ' ';
+                }
+                while (i > 0 && out < end) *out++ = buf[--i];
+                if (left_justify) {
+                    while (pad-- > 0 && out < end) *out++ = ' ';
+                }
+                break;
+            }
+            case 'u':
+            case 'x': 
+            case 'X':
+            case 'p': {
+                unsigned long long val;
+                const char *hex = (*format == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+                int base = (*format == 'u') ? 10 : 16;
+                
+                if (*format == 'p') {
+                    val = (unsigned long long)va_arg(ap, void*);
+                    if (out < end) *out++ = '0';
+                    if (out < end) *out++ = 'x';
+                    width -= 2;
+                } else {
+                    if (is_longlong) val = va_arg(ap, unsigned long long);
+                    else if (is_long) val = va_arg(ap, unsigned long);
+                    else val = va_arg(ap, unsigned int);
+                }
+                
+                char buf[64];
+                int i = 0;
+                do { 
+                    buf[i++] = hex[val % base];
+                    val /= base; 
+                } while (val);
+                
+                int pad = width - i;
+                if (!left_justify) {
+                    while (pad-- > 0 && out < end) *out++ = zero_pad ? '0' : ' ';
+                }
+                while (i > 0 && out < end) *out++ = buf[--i];
+                if (left_justify) {
+                    while (pad-- > 0 && out < end) *out++ = ' ';
+                }
+                break;
+            }
+            case 'c': {
+                char c = (char)va_arg(ap, int);
+                if (out < end) *out++ = c;
+                break;
+            }
+            case '%': {
+                if (out < end) *out++ = '%';
+                break;
+            }
+            default:
+                if (out < end) *out++ = '%';
+                if (out < end && *format) *out++ = *format;
+                break;
+        }
+        if (*format) format++;
+    }
+    *out = '\0';
+    return out - str;
+}
+
+/* ---- harness ---- */
+
+typedef int (*vsnprintf_fn)(char *, size_t, const char *, va_list);
+
+static char out[256];
+static volatile unsigned sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int call(vsnprintf_fn f, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = f(out, sizeof(out), fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+enum { W_DIAG, W_LISTING, W_SYMNAME, W_PSTRCAT, W_MEMUSAGE, W_INTS, W_FLOAT, W_COUNT };
+static const char *const workload_names[W_COUNT] = {
+    "diag", "asm_listing", "sym_name", "pstrcat", "mem_usage", "ints", "float",
+};
+
+/* One formatted line of workload w, iteration i */
+static void format_one(vsnprintf_fn f, int w, unsigned i) {
+    switch (w) {
+    case W_DIAG:
+        call(f, "%s:%d: error: '%s' undeclared (first use in this function)\n", "src/parser.c", (int)(i % 5000),
+             "token_buf");
+        break;
+    case W_LISTING:
+        call(f, "%08x %02x %02x %02x %02x  %s\n", i * 4, i & 0xff, (i >> 8) & 0xff, (i >> 3) & 0xff, 0xd6, "ret");
+        break;
+    case W_SYMNAME:
+        call(f, "L.%u", i);
+        break;
+    case W_PSTRCAT:
+        call(f, "%s%s", "/usr/include/", "stdio.h");
+        break;
+    case W_MEMUSAGE:
+        call(f, "%-20s %8lld %8lld\n", "atoms", (long long)(i * 37), (long long)i * 1311);
+        break;
+    case W_INTS:
+        call(f, "%d %d %d %d %ld", (int)i, -(int)(i * 7919), 2147483647, (int)(i % 100), (long)i * 1000003);
+        break;
+    case W_FLOAT:
+        call(f, "%.3f %.1f", i * 0.001, 99.5 + i);
+        break;
+    }
+}
+
+static double run(vsnprintf_fn f, int w, unsigned n) {
+    uint64_t t0 = now_ns();
+    for (unsigned i = 0; i < n; i++) {
+        format_one(f, w, i);
+        sink += (unsigned char)out[0];
+    }
+    uint64_t dt = now_ns() - t0;
+    return (double)dt / (double)n;
+}
+
+/* Whether cshim's output equals musl's for the first 1000 iterations */
+static int matches_musl(int w) {
+    char want[sizeof(out)];
+    for (unsigned i = 0; i < 1000; i++) {
+        format_one(vsnprintf, w, i);
+        memcpy(want, out, sizeof(out));
+        format_one(cshim_vsnprintf, w, i);
+        if (strcmp(want, out) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    unsigned n = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-n=", 3) == 0)
+            n = (unsigned)strtoul(argv[i] + 3, NULL, 10);
+    }
+    if (n == 0)
+        n = 1;
+
+    printf("# workload qjs_ns tcc_ns cshim_ns speedup_vs_tcc cshim_matches_musl\n");
+    for (int w = 0; w < W_COUNT; w++) {
+        double q = run(qjs_vsnprintf, w, n);
+        double t = run(tcc_vsnprintf, w, n);
+        double c = run(cshim_vsnprintf, w, n);
+        printf("%s %.1f %.1f %.1f %.2f %s\n", workload_names[w], q, t, c, t / c, matches_musl(w) ? "yes" : "no");
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * qsort_bench.c — cshim pdqsort versus the two qsorts it replaced (copied
+ * verbatim below): the insertion sort from quickjs/stubs.c and the all-pairs
+ * exchange sort from tcc/libc_stubs.c.
+ *
+ * The headline workload is the one tcc's linker runs: a 5000-entry Elf64_Sym
+ * table (24-byte elements) ordered by name through the string table. Integer
+ * workloads cover the 4/8/16-byte swap paths. Build like mem_bench (see
+ * build.sh):
+ *
+ *   aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+ *       -D'CSHIM_NAME(n)=cshim_##n' -o qsort.o ../qsort.c
+ *   aarch64-linux-musl-gcc -static -O2 -fno-builtin \
+ *       -fno-tree-loop-distribute-patterns -o qsort_bench qsort_bench.c qsort.o
+ *
+ * Usage: qsort_bench [-syms=N]   (N = symbol table entries, default 5000)
+ * Output: one line per (workload, n):
+ *   workload n insertion_us exchange_us cshim_us speedup_vs_tcc
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void cshim_qsort(void *base, size_t nmemb, size_t size,
+                 int (*compar)(const void *, const void *));
+
+/* ---- baseline: the pre-cshim qsorts ---- */
+
+/* quickjs/stubs.c */
+static void insertion_qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *)) {
+    char *arr = (char *)base;
+    char temp[256];
+
+    if (size > sizeof(temp)) return;
+
+    for (size_t i = 1; i < nmemb; i++) {
+        memcpy(temp, arr + i * size, size);
+        size_t j = i;
+        while (j > 0 && compar(arr + (j-1) * size, temp) > 0) {
+            memcpy(arr + j * size, arr + (j-1) * size, size);
+            j--;
+        }
+        memcpy(arr + j * size, temp, size);
+    }
+}
+
+/* tcc/src/libc_stubs.c */
+static void exchange_qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *)) {
+    char *arr = (char *)base;
+    char temp[256]; /* Assumes elements are smaller than 256 bytes */
+
+    if (size > sizeof(temp)) return; // Too large to copy
+
+    for (size_t i = 0; i < nmemb; i++) {
+        for (size_t j = i + 1; j < nmemb; j++) {
+            if (compar(arr + i * size, arr + j * size) > 0) {
+                memcpy(temp, arr + i * size, size);
+                memcpy(arr + i * size, arr + j * size, size);
+                memcpy(arr + j * size, temp, size);
+            }
+        }
+    }
+}
+
+/* ---- workloads ---- */
+
+typedef struct {
+    uint32_t st_name;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+} Elf64_Sym;
+
+static char *strtab;
+
+static int cmp_sym_name(const void *a, const void *b) {
+    const Elf64_Sym *x = a, *y = b;
+    return strcmp(strtab + x->st_name, strtab + y->st_name);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* 16-byte {key, payload}, e.g. an offset/relocation pair. */
+static int cmp_pair16(const void *a, const void *b) {
+    return cmp_u64(a, b);
+}
+
+static uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+static uint64_t next_rand(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* Symbol names shaped like a big C translation unit: a few prefixes, numeric
+ * suffixes, emitted in definition (not name) order. */
+static Elf64_Sym *make_symtab(size_t n) {
+    static const char *const prefix[] = { "fn_", "var_", "tcc_", "gen_", "parse_", "__str_" };
+    Elf64_Sym *syms = calloc(n, sizeof(*syms));
+    strtab = malloc(n * 24 + 1);
+    if (!syms || !strtab)
+        return NULL;
+    size_t off = 1;
+    strtab[0] = '\0';
+    for (size_t i = 0; i < n; i++) {
+        syms[i].st_name = (uint32_t)off;
+        off += (size_t)sprintf(strtab + off, "%s%u_%zu", prefix[next_rand() % 6],
+                               (unsigned)(next_rand() % 1000), i) + 1;
+        syms[i].st_info = (i & 1) ? 0x12 : 0x11; /* GLOBAL FUNC / GLOBAL OBJECT */
+        syms[i].st_shndx = (uint16_t)(1 + i % 8);
+        syms[i].st_value = i * 16;
+    }
+    return syms;
+}
+
+/* ---- harness ---- */
+
+typedef void (*sort_fn)(void *, size_t, size_t, int (*)(const void *, const void *));
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Microseconds per sort of a fresh copy of `src`, or -1 if the result is not
+ * ordered. */
+static double run(sort_fn sort, const void *src, void *work, size_t n, size_t es,
+                  int (*cmp)(const void *, const void *)) {
+    size_t reps = 20000 / n + 1;
+    uint64_t total = 0;
+    for (size_t r = 0; r < reps; r++) {
+        memcpy(work, src, n * es);
+        uint64_t t0 = now_ns();
+        sort(work, n, es, cmp);
+        total += now_ns() - t0;
+    }
+    for (size_t i = 1; i < n; i++) {
+        if (cmp((char *)work + (i - 1) * es, (char *)work + i * es) > 0)
+            return -1;
+    }
+    return (double)total / 1e3 / (double)reps;
+}
+
+static void report(const char *name, const void *src, size_t n, size_t es,
+                   int (*cmp)(const void *, const void *)) {
+    void *work = malloc(n * es);
+    if (!work) {
+        fprintf(stderr, "qsort_bench: out of memory\n");
+        exit(1);
+    }
+    double ins = run(insertion_qsort, src, work, n, es, cmp);
+    double exch = run(exchange_qsort, src, work, n, es, cmp);
+    double fast = run(cshim_qsort, src, work, n, es, cmp);
+    printf("%s %zu %.1f %.1f %.1f %.1f\n", name, n, ins, exch, fast, fast > 0 ? exch / fast : 0.0);
+    free(work);
+}
+
+int main(int argc, char **argv) {
+    size_t nsyms = 5000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-syms=", 6) == 0)
+            nsyms = strtoul(argv[i] + 6, NULL, 10);
+    }
+    if (nsyms < 2)
+        nsyms = 2;
+
+    printf("# workload n insertion_us exchange_us cshim_us speedup_vs_tcc\n");
+
+    Elf64_Sym *syms = make_symtab(nsyms);
+    if (!syms) {
+        fprintf(stderr, "qsort_bench: out of memory\n");
+        return 1;
+    }
+    report("symtab_by_name", syms, nsyms, sizeof(Elf64_Sym), cmp_sym_name);
+
+    static const size_t sizes[] = { 16, 100, 1000, 5000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        uint64_t *buf = malloc(n * 16);
+        if (!buf) {
+            fprintf(stderr, "qsort_bench: out of memory\n");
+            return 1;
+        }
+        uint32_t *u32 = (uint32_t *)buf;
+        for (size_t i = 0; i < n; i++)
+            u32[i] = (uint32_t)next_rand();
+        report("u32_random", buf, n, 4, cmp_u32);
+        for (size_t i = 0; i < n; i++)
+            buf[i] = next_rand();
+        report("u64_random", buf, n, 8, cmp_u64);
+        for (size_t i = 0; i < n; i++)
+            buf[i] = i + (next_rand() % 16 == 0 ? next_rand() % n : 0);
+        report("u64_nearly_sorted", buf, n, 8, cmp_u64);
+        for (size_t i = 0; i < n; i++) {
+            buf[2 * i] = next_rand() % 64;
+            buf[2 * i + 1] = i;
+        }
+        report("pair16_dupkeys", buf, n, 16, cmp_pair16);
+        free(buf);
+    }
+    return 0;
+}
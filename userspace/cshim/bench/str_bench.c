@@ -0,0 +1,204 @@
+/*
+ * str_bench.c — cshim string scanners versus the byte loops the qjs/tcc shims
+ * used before (copied verbatim below as the baseline).
+ *
+ * The haystack is JSON-shaped text (keys, quotes, digits, commas), the input
+ * our qjs ingest scripts scan. Build like mem_bench (see build.sh):
+ *
+ *   aarch64-linux-musl-gcc -static -O2 -c -ffreestanding -fno-builtin \
+ *       -D'CSHIM_NAME(n)=cshim_##n' -o string.o ../string.c
+ *   aarch64-linux-musl-gcc -static -O2 -fno-builtin \
+ *       -fno-tree-loop-distribute-patterns -o str_bench str_bench.c string.o
+ *
+ * Usage: str_bench [-mb=N]   (N = MiB scanned per size/op pair, default 64)
+ * Output: one line per (op, size): op size_bytes byte_loop_MBps cshim_MBps speedup
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+size_t cshim_strlen(const char *s);
+char *cshim_strchr(const char *s, int c);
+char *cshim_strrchr(const char *s, int c);
+void *cshim_memchr(const void *s, int c, size_t n);
+char *cshim_strstr(const char *haystack, const char *needle);
+size_t cshim_strcspn(const char *s, const char *reject);
+int cshim_strcmp(const char *s1, const char *s2);
+
+/* ---- baseline: the pre-cshim stubs.c loops ---- */
+
+static size_t byte_strlen(const char *s) {
+    const char *p = s;
+    while (*p) p++;
+    return p - s;
+}
+
+static int byte_strncmp(const char *s1, const char *s2, size_t n) {
+    while (n && *s1 && *s1 == *s2) {
+        s1++;
+        s2++;
+        n--;
+    }
+    if (n == 0) return 0;
+    return (unsigned char)*s1 - (unsigned char)*s2;
+}
+
+static int byte_strcmp(const char *s1, const char *s2) {
+    while (*s1 && *s1 == *s2) {
+        s1++;
+        s2++;
+    }
+    return (unsigned char)*s1 - (unsigned char)*s2;
+}
+
+static char *byte_strchr(const char *s, int c) {
+    while (*s) {
+        if (*s == (char)c) return (char *)s;
+        s++;
+    }
+    return (c == '\0') ? (char *)s : NULL;
+}
+
+static char *byte_strrchr(const char *s, int c) {
+    const char *last = NULL;
+    while (*s) {
+        if (*s == (char)c) last = s;
+        s++;
+    }
+    return (c == '\0') ? (char *)s : (char *)last;
+}
+
+static void *byte_memchr(const void *s, int c, size_t n) {
+    const unsigned char *p = (const unsigned char *)s;
+    while (n--) {
+        if (*p == (unsigned char)c) return (void *)p;
+        p++;
+    }
+    return 0;
+}
+
+static char *byte_strstr(const char *haystack, const char *needle) {
+    size_t needle_len = byte_strlen(needle);
+    if (needle_len == 0) return (char *)haystack;
+    while (*haystack) {
+        if (byte_strncmp(haystack, needle, needle_len) == 0) {
+            return (char *)haystack;
+        }
+        haystack++;
+    }
+    return NULL;
+}
+
+static size_t byte_strcspn(const char *s, const char *reject) {
+    const char *p = s;
+    while (*p) {
+        const char *r = reject;
+        while (*r) {
+            if (*p == *r) return p - s;
+            r++;
+        }
+        p++;
+    }
+    return p - s;
+}
+
+/* ---- harness ---- */
+
+#define MAX_SIZE (1u << 20)
+
+static char *text;
+/* Copy of text differing only in its last byte, for strcmp */
+static char *text2;
+static volatile uintptr_t sink;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+enum { OP_STRLEN, OP_STRCHR, OP_STRRCHR, OP_MEMCHR, OP_STRSTR, OP_STRCSPN, OP_STRCMP, OP_COUNT };
+static const char *const op_names[OP_COUNT] = {
+    "strlen", "strchr", "strrchr", "memchr", "strstr", "strcspn", "strcmp",
+};
+
+/* Every op scans the whole `size`-byte string: the searched byte/needle (or
+ * the difference, for strcmp) only occurs at its very end. */
+static double run(int op, int impl, size_t size, size_t iters) {
+    char *s = text + MAX_SIZE - size;
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < iters; i++) {
+        uintptr_t r = 0;
+        switch (op) {
+        case OP_STRLEN:
+            r = impl ? cshim_strlen(s) : byte_strlen(s);
+            break;
+        case OP_STRCHR:
+            r = (uintptr_t)(impl ? cshim_strchr(s, '~') : byte_strchr(s, '~'));
+            break;
+        case OP_STRRCHR:
+            r = (uintptr_t)(impl ? cshim_strrchr(s, '{') : byte_strrchr(s, '{'));
+            break;
+        case OP_MEMCHR:
+            r = (uintptr_t)(impl ? cshim_memchr(s, '~', size) : byte_memchr(s, '~', size));
+            break;
+        case OP_STRSTR:
+            r = (uintptr_t)(impl ? cshim_strstr(s, "\"needle\"") : byte_strstr(s, "\"needle\""));
+            break;
+        case OP_STRCSPN:
+            r = impl ? cshim_strcspn(s, "~\\") : byte_strcspn(s, "~\\");
+            break;
+        case OP_STRCMP: {
+            const char *s2 = text2 + MAX_SIZE - size;
+            r = (uintptr_t)(impl ? cshim_strcmp(s, s2) : byte_strcmp(s, s2));
+            break;
+        }
+        }
+        sink += r;
+    }
+    uint64_t dt = now_ns() - t0;
+    if (dt == 0)
+        dt = 1;
+    return (double)size * (double)iters * 1e3 / (double)dt;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = 64;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-mb=", 4) == 0)
+            mb = strtoul(argv[i] + 4, NULL, 10);
+    }
+
+    text = malloc(MAX_SIZE + 1);
+    text2 = malloc(MAX_SIZE + 2);
+    if (!text || !text2) {
+        fprintf(stderr, "str_bench: out of memory\n");
+        return 1;
+    }
+    static const char record[] = "{\"id\":12345,\"name\":\"item\",\"tags\":[\"a\",\"b\"],\"v\":3.25},";
+    for (size_t i = 0; i < MAX_SIZE; i++)
+        text[i] = record[i % (sizeof(record) - 1)];
+    /* Tail: the needle as the last 8 bytes, with the '~' target just before. */
+    memcpy(text + MAX_SIZE - 9, "~\"needle\"", 9);
+    text[MAX_SIZE] = '\0';
+    /* Offset by one so the two strings are not aligned alike */
+    text2++;
+    memcpy(text2, text, MAX_SIZE + 1);
+    text2[MAX_SIZE - 1] = '?';
+
+    printf("# op size_bytes byte_loop_MBps cshim_MBps speedup\n");
+    for (int op = 0; op < OP_COUNT; op++) {
+        for (size_t size = 16; size <= MAX_SIZE; size <<= 1) {
+            size_t iters = (mb << 20) / size;
+            if (iters == 0)
+                iters = 1;
+            double base = run(op, 0, size, iters);
+            double fast = run(op, 1, size, iters);
+            printf("%s %zu %.1f %.1f %.2f\n", op_names[op], size, base, fast, fast / base);
+        }
+    }
+    return 0;
+}
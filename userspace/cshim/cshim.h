@@ -0,0 +1,126 @@
+/*
+ * cshim.h — shared internals for the freestanding C routines linked by the
+ * userspace C ports (qjs, tcc) in place of their hand-rolled byte loops.
+ *
+ * Includes nothing on purpose: each consumer compiles with -nostdinc against
+ * its own header set (the quickjs/ shims, musl for tcc), so every type used
+ * here comes straight from the compiler.
+ */
+#ifndef CSHIM_H
+#define CSHIM_H
+
+typedef __SIZE_TYPE__ size_t;
+typedef __UINTPTR_TYPE__ uintptr_t;
+typedef __UINT64_TYPE__ uint64_t;
+typedef __UINT32_TYPE__ uint32_t;
+typedef __UINT16_TYPE__ uint16_t;
+typedef __UINT8_TYPE__ uint8_t;
+typedef __INT64_TYPE__ int64_t;
+typedef __INT32_TYPE__ int32_t;
+
+/*
+ * Exported symbol name. Benchmarks and host tests link the shim next to a real
+ * libc, so they rename it on the command line: -D'CSHIM_NAME(n)=cshim_##n'.
+ */
+#ifndef CSHIM_NAME
+#define CSHIM_NAME(n) n
+#endif
+
+/*
+ * GCC turns block-store loops back into memset/memcpy calls even under
+ * -ffreestanding, which recurses straight into the function being defined.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+#endif
+
+/*
+ * Unaligned, alias-anything scalar and 16-byte vector views. EL0 data accesses
+ * may be unaligned on normal memory; the vector type lowers to q-registers on
+ * AArch64 and back-to-back pairs of it to ldp/stp.
+ */
+typedef uint64_t cs_u64 __attribute__((aligned(1), may_alias));
+typedef uint32_t cs_u32 __attribute__((aligned(1), may_alias));
+typedef uint16_t cs_u16 __attribute__((aligned(1), may_alias));
+typedef uint8_t cs_v16 __attribute__((vector_size(16), aligned(1), may_alias));
+/* Naturally aligned views: a 16-byte-aligned load never crosses a page. */
+typedef uint8_t cs_v16a __attribute__((vector_size(16), may_alias));
+typedef uint64_t cs_v2u64 __attribute__((vector_size(16)));
+
+#define CS_INLINE static inline __attribute__((always_inline))
+
+CS_INLINE uint64_t cs_ld64(const void *p) { return *(const cs_u64 *)p; }
+CS_INLINE uint32_t cs_ld32(const void *p) { return *(const cs_u32 *)p; }
+CS_INLINE uint16_t cs_ld16(const void *p) { return *(const cs_u16 *)p; }
+CS_INLINE cs_v16 cs_ldv(const void *p) { return *(const cs_v16 *)p; }
+
+CS_INLINE void cs_st64(void *p, uint64_t v) { *(cs_u64 *)p = v; }
+CS_INLINE void cs_st32(void *p, uint32_t v) { *(cs_u32 *)p = v; }
+CS_INLINE void cs_st16(void *p, uint16_t v) { *(cs_u16 *)p = v; }
+CS_INLINE void cs_stv(void *p, cs_v16 v) { *(cs_v16 *)p = v; }
+
+/*
+ * Byte-lane match set of a 16-byte vector compare, as two little-endian words
+ * (lane i is byte i of lo for i < 8, byte i-8 of hi otherwise; 0xff = match).
+ */
+typedef struct {
+    uint64_t lo, hi;
+} cs_mask;
+
+CS_INLINE cs_mask cs_mask_of(cs_v16 eq)
+{
+    cs_v2u64 w = (cs_v2u64)eq;
+    cs_mask m = { w[0], w[1] };
+    return m;
+}
+
+CS_INLINE int cs_mask_any(cs_mask m) { return (m.lo | m.hi) != 0; }
+
+/* Index of the lowest / highest matching lane; the mask must be non-empty. */
+CS_INLINE unsigned cs_mask_first(cs_mask m)
+{
+    return m.lo ? (unsigned)__builtin_ctzll(m.lo) >> 3 : 8 + ((unsigned)__builtin_ctzll(m.hi) >> 3);
+}
+
+CS_INLINE unsigned cs_mask_last(cs_mask m)
+{
+    return m.hi ? 15 - ((unsigned)__builtin_clzll(m.hi) >> 3) : 7 - ((unsigned)__builtin_clzll(m.lo) >> 3);
+}
+
+/* Keep only lanes >= from (0..15). */
+CS_INLINE cs_mask cs_mask_from(cs_mask m, unsigned from)
+{
+    if (from >= 8) {
+        m.lo = 0;
+        m.hi &= ~0ull << ((from - 8) * 8);
+    } else {
+        m.lo &= ~0ull << (from * 8);
+    }
+    return m;
+}
+
+/* Keep only lanes <= upto (0..15). */
+CS_INLINE cs_mask cs_mask_upto(cs_mask m, unsigned upto)
+{
+    if (upto >= 8) {
+        if (upto < 15)
+            m.hi &= ~0ull >> ((15 - upto) * 8);
+    } else {
+        m.hi = 0;
+        if (upto < 7)
+            m.lo &= ~0ull >> ((7 - upto) * 8);
+    }
+    return m;
+}
+
+CS_INLINE cs_mask cs_mask_and(cs_mask a, cs_mask b)
+{
+    cs_mask m = { a.lo & b.lo, a.hi & b.hi };
+    return m;
+}
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "cshim lane masks assume a little-endian target"
+#endif
+
+#endif /* CSHIM_H */
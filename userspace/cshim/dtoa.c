@@ -0,0 +1,858 @@
+/*
+ * dtoa.c — decimal <-> double conversion for the freestanding userspace ports.
+ *
+ * strtod is correctly rounded (round to nearest, ties to even):
+ *   - Clinger's fast path when the significand and 10^|q| are both exact
+ *     doubles (up to 15-16 digits with a small exponent);
+ *   - Eisel-Lemire otherwise: one 64x128-bit multiply against a table of
+ *     powers of ten, exact whenever the significand fits in 19 digits;
+ *   - longer inputs whose dropped digits could change the result fall back
+ *     to exact decimal arithmetic (the shift-based method of Go's strconv);
+ *   - C99 hex floats ("0x1.8p3") are exact in binary: the first 64 bits of
+ *     the significand plus a sticky bit are rounded once.
+ *
+ * Printing never goes through a format string:
+ *   - cshim_dtoa_shortest is Schubfach (R. Giulietti): the shortest digits
+ *     that round-trip, from three 64x128 multiplies on the same table;
+ *   - cshim_dtoa_fixed / cshim_dtoa_frac round the exact decimal expansion
+ *     of the double, so ties are real ties and go away from zero as
+ *     ECMAScript toPrecision/toExponential/toFixed require;
+ *   - cshim_dtoa_even rounds the same expansion half to even for printf.c,
+ *     starting from the Schubfach digits when those settle the result.
+ *
+ * The table lives in dtoa_data.h, generated by tools/gen_dtoa_data.py.
+ * errno is not set on overflow or underflow.
+ */
+
+#include "cshim.h"
+#include "dtoa.h"
+#include "dtoa_data.h"
+
+typedef unsigned __int128 u128;
+
+#define SIGN_BIT 0x8000000000000000ull
+#define INF_BITS 0x7ff0000000000000ull
+#define FRAC_MASK ((1ull << 52) - 1)
+
+typedef union {
+    double f;
+    uint64_t i;
+} dbits;
+
+CS_INLINE uint64_t asuint64(double x)
+{
+    dbits u = { x };
+    return u.i;
+}
+
+CS_INLINE double asdouble(uint64_t i)
+{
+    dbits u;
+    u.i = i;
+    return u.f;
+}
+
+CS_INLINE int is_digit(char c) { return (unsigned char)(c - '0') < 10; }
+
+/* ---- exact decimal arithmetic (slow paths) ---- */
+
+/* Enough for the exact expansion of any double (at most 767 significant
+ * digits) and for correctly rounding any longer input. */
+#define DEC_MAX_DIGITS 800
+/* Largest shift whose running value n * 10 + 9 still fits in 64 bits. */
+#define DEC_MAX_SHIFT 60
+
+/* 0.d[0]d[1]...d[nd-1] * 10^dp; digits are values 0-9. trunc records that
+ * nonzero digits were dropped past DEC_MAX_DIGITS. */
+typedef struct {
+    int nd, dp, trunc;
+    uint8_t d[DEC_MAX_DIGITS];
+} decimal;
+
+static void dec_trim(decimal *a)
+{
+    while (a->nd > 0 && a->d[a->nd - 1] == 0)
+        a->nd--;
+    if (a->nd == 0)
+        a->dp = 0;
+}
+
+static void dec_assign(decimal *a, uint64_t v)
+{
+    uint8_t buf[20];
+    int n = 0;
+    while (v) {
+        buf[n++] = (uint8_t)(v % 10);
+        v /= 10;
+    }
+    a->nd = 0;
+    while (n > 0)
+        a->d[a->nd++] = buf[--n];
+    a->dp = a->nd;
+    a->trunc = 0;
+    dec_trim(a);
+}
+
+static void dec_rshift(decimal *a, unsigned k)
+{
+    int r = 0, w = 0;
+    uint64_t n = 0, mask = (1ull << k) - 1;
+
+    /* Pick up enough leading digits to cover the first shift. */
+    for (; n >> k == 0; r++) {
+        if (r >= a->nd) {
+            if (n == 0) {
+                a->nd = 0;
+                return;
+            }
+            while (n >> k == 0) {
+                n *= 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + a->d[r];
+    }
+    a->dp -= r - 1;
+
+    for (; r < a->nd; r++) {
+        uint64_t c = a->d[r];
+        a->d[w++] = (uint8_t)(n >> k);
+        n = (n & mask) * 10 + c;
+    }
+    while (n) {
+        uint64_t dig = n >> k;
+        n &= mask;
+        if (w < DEC_MAX_DIGITS)
+            a->d[w++] = (uint8_t)dig;
+        else if (dig)
+            a->trunc = 1;
+        n *= 10;
+    }
+    a->nd = w;
+    dec_trim(a);
+}
+
+static void dec_lshift(decimal *a, unsigned k)
+{
+    /* Shifting by k bits adds at most floor(k*log10(2)) + 1 digits; write
+     * from the right into that much room and close the gap afterwards. */
+    int delta = (int)((k * 1233) >> 12) + 1;
+    int top = a->nd + delta;
+    int r = a->nd, w = top;
+    uint64_t n = 0;
+
+    while (--r >= 0) {
+        n += (uint64_t)a->d[r] << k;
+        uint64_t quo = n / 10, rem = n - 10 * quo;
+        if (--w < DEC_MAX_DIGITS)
+            a->d[w] = (uint8_t)rem;
+        else if (rem)
+            a->trunc = 1;
+        n = quo;
+    }
+    while (n) {
+        uint64_t quo = n / 10, rem = n - 10 * quo;
+        if (--w < DEC_MAX_DIGITS)
+            a->d[w] = (uint8_t)rem;
+        else if (rem)
+            a->trunc = 1;
+        n = quo;
+    }
+
+    int end = top < DEC_MAX_DIGITS ? top : DEC_MAX_DIGITS;
+    for (int i = w; i < end; i++)
+        a->d[i - w] = a->d[i];
+    a->nd = end - w;
+    a->dp += delta - w;
+    dec_trim(a);
+}
+
+/* Multiply by 2^k. */
+static void dec_shift(decimal *a, int k)
+{
+    if (a->nd == 0)
+        return;
+    for (; k > DEC_MAX_SHIFT; k -= DEC_MAX_SHIFT)
+        dec_lshift(a, DEC_MAX_SHIFT);
+    for (; k < -DEC_MAX_SHIFT; k += DEC_MAX_SHIFT)
+        dec_rshift(a, DEC_MAX_SHIFT);
+    if (k > 0)
+        dec_lshift(a, (unsigned)k);
+    else if (k < 0)
+        dec_rshift(a, (unsigned)-k);
+}
+
+/* Keep nd digits, rounding half away from zero, or half to even when `even`
+ * is set (the value is exact, so a 5 followed by nothing is a real tie). */
+static void dec_round_mode(decimal *a, int nd, int even)
+{
+    if (nd >= a->nd)
+        return;
+    if (nd < 0) {
+        a->nd = 0;
+        a->dp = 0;
+        return;
+    }
+    int up = a->d[nd] >= 5;
+    if (even && a->d[nd] == 5 && nd + 1 == a->nd)
+        up = nd > 0 && (a->d[nd - 1] & 1);
+    a->nd = nd;
+    if (up) {
+        int i = nd - 1;
+        while (i >= 0 && a->d[i] == 9)
+            i--;
+        if (i < 0) { /* all nines, or nothing kept: becomes 1 at dp + 1 */
+            a->d[0] = 1;
+            a->nd = 1;
+            a->dp++;
+            return;
+        }
+        a->d[i]++;
+        a->nd = i + 1;
+    }
+    dec_trim(a);
+}
+
+static void dec_round(decimal *a, int nd)
+{
+    dec_round_mode(a, nd, 0);
+}
+
+/* Integer part rounded half-to-even (trunc counts as above half). */
+static uint64_t dec_rounded_integer(const decimal *a)
+{
+    if (a->dp > 20)
+        return ~0ull;
+    int i;
+    uint64_t n = 0;
+    for (i = 0; i < a->dp && i < a->nd; i++)
+        n = n * 10 + a->d[i];
+    for (; i < a->dp; i++)
+        n *= 10;
+    int dp = a->dp;
+    if (dp >= 0 && dp < a->nd) {
+        if (a->d[dp] == 5 && dp + 1 == a->nd)
+            n += a->trunc || (dp > 0 && (a->d[dp - 1] & 1));
+        else
+            n += a->d[dp] >= 5;
+    }
+    return n;
+}
+
+/* Correctly rounded IEEE bits of the (positive) decimal. Clobbers a. */
+static uint64_t dec_to_bits(decimal *a)
+{
+    static const uint8_t powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+    int exp = 0;
+
+    if (a->nd == 0 || a->dp < -330)
+        return 0;
+    if (a->dp > 310)
+        return INF_BITS;
+
+    /* Scale by powers of two into [0.5, 1). */
+    while (a->dp > 0) {
+        int n = a->dp >= 9 ? 27 : powtab[a->dp];
+        dec_shift(a, -n);
+        exp += n;
+    }
+    while (a->dp < 0 || (a->dp == 0 && a->d[0] < 5)) {
+        int n = -a->dp >= 9 ? 27 : powtab[-a->dp];
+        dec_shift(a, n);
+        exp -= n;
+    }
+    exp--; /* [0.5, 1) -> [1, 2) */
+
+    /* Subnormal: move up to the minimum exponent, losing precision. */
+    if (exp < -1022) {
+        int n = -1022 - exp;
+        dec_shift(a, -n);
+        exp += n;
+    }
+    if (exp + 1023 >= 0x7ff)
+        return INF_BITS;
+
+    dec_shift(a, 53);
+    uint64_t mant = dec_rounded_integer(a);
+    if (mant == 2ull << 52) { /* rounding carried into a new bit */
+        mant >>= 1;
+        exp++;
+        if (exp + 1023 >= 0x7ff)
+            return INF_BITS;
+    }
+    if (!(mant & (1ull << 52)))
+        exp = -1023;
+    return ((uint64_t)(exp + 1023) << 52) | (mant & FRAC_MASK);
+}
+
+static void dec_from_double(decimal *a, uint64_t bits)
+{
+    int be = (int)(bits >> 52) & 0x7ff;
+    uint64_t m = bits & FRAC_MASK;
+    if (be)
+        m |= 1ull << 52;
+    dec_assign(a, m);
+    dec_shift(a, (be ? be : 1) - 1075);
+}
+
+/* ---- strtod ---- */
+
+/*
+ * w * 10^q rounded to nearest-even, for exact w != 0 (Eisel-Lemire, as in
+ * fast_float; the table's rounding makes the 128-bit product sufficient).
+ */
+static uint64_t eisel_lemire(uint64_t w, int q)
+{
+    if (q < POW10_MIN)
+        return 0;
+    if (q > 308)
+        return INF_BITS;
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    const uint64_t *t = pow10_128[q - POW10_MIN];
+    u128 p = (u128)w * t[0];
+    uint64_t hi = (uint64_t)(p >> 64), lo = (uint64_t)p;
+    if ((hi & 0x1ff) == 0x1ff) { /* low bits are all ones: refine */
+        uint64_t p2 = (uint64_t)(((u128)w * t[1]) >> 64);
+        lo += p2;
+        hi += lo < p2;
+    }
+
+    int upper = (int)(hi >> 63);
+    int shift = upper + 64 - 52 - 3;
+    uint64_t m = hi >> shift;
+    /* floor(q * log2(10)) + 63, biased */
+    int e2 = ((217706 * q) >> 16) + 63 + upper - lz + 1023;
+
+    if (e2 <= 0) { /* subnormal */
+        if (-e2 + 1 >= 64)
+            return 0;
+        m >>= -e2 + 1;
+        m += m & 1;
+        m >>= 1;
+        /* rounding up may have produced the smallest normal */
+        return m;
+    }
+    /* An exact halfway case can only come from a small power of ten; let it
+     * round to even rather than up. */
+    if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << shift) == hi)
+        m &= ~1ull;
+    m += m & 1;
+    m >>= 1;
+    if (m >= 2ull << 52) {
+        m = 1ull << 52;
+        e2++;
+    }
+    if (e2 >= 0x7ff)
+        return INF_BITS;
+    return ((uint64_t)e2 << 52) | (m & FRAC_MASK);
+}
+
+/* Parse an unsigned decimal number starting at s (validated by the caller)
+ * into a, exactly. */
+static void dec_parse(decimal *a, const char *s, long exp10)
+{
+    a->nd = 0;
+    a->dp = 0;
+    a->trunc = 0;
+    int int_digits = 0, seen_dot = 0;
+    for (;; s++) {
+        if (*s == '.' && !seen_dot) {
+            seen_dot = 1;
+            continue;
+        }
+        if (!is_digit(*s))
+            break;
+        int c = *s - '0';
+        if (a->nd == 0 && c == 0) { /* leading zero */
+            if (seen_dot)
+                a->dp--;
+            continue;
+        }
+        if (!seen_dot)
+            int_digits++;
+        if (a->nd < DEC_MAX_DIGITS)
+            a->d[a->nd++] = (uint8_t)c;
+        else if (c)
+            a->trunc = 1;
+    }
+    if (exp10 > 100000)
+        exp10 = 100000;
+    else if (exp10 < -100000)
+        exp10 = -100000;
+    a->dp += int_digits + (int)exp10;
+    dec_trim(a);
+}
+
+CS_INLINE int hex_val(char c)
+{
+    if (is_digit(c))
+        return c - '0';
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/* m * 2^e2 rounded to nearest-even; `sticky` marks nonzero bits below m. */
+static uint64_t bin_to_bits(uint64_t m, int sticky, long e2)
+{
+    if (m == 0)
+        return 0;
+    int lz = __builtin_clzll(m);
+    m <<= lz;
+    e2 -= lz;
+    /* biased exponent of the leading bit */
+    long be = e2 + 63 + 1023;
+    if (be >= 0x7ff)
+        return INF_BITS;
+    int shift = 11;
+    if (be < 1) { /* subnormal */
+        if (1 - be > 53)
+            return 0;
+        shift += (int)(1 - be);
+        be = 1;
+    }
+    uint64_t mant = shift == 64 ? 0 : m >> shift;
+    uint64_t rem = shift == 64 ? m : m & ((1ull << shift) - 1);
+    uint64_t half = 1ull << (shift - 1);
+    if (rem > half || (rem == half && (sticky || (mant & 1))))
+        mant++;
+    /* mant carries the implicit bit, so a carry out of it bumps the exponent
+     * and a subnormal that rounds up becomes the smallest normal */
+    uint64_t bits = ((uint64_t)(be - 1) << 52) + mant;
+    return bits >= INF_BITS ? INF_BITS : bits;
+}
+
+/* Hex float digits after the "0x" at p into *bits; returns the end of the
+ * number, or 0 when no hex digit follows (then only the "0" is read). */
+static const char *hex_parse(const char *p, uint64_t *bits)
+{
+    uint64_t m = 0;
+    int any = 0, sticky = 0, d;
+    long e2 = 0;
+    for (; (d = hex_val(*p)) >= 0; p++) {
+        any = 1;
+        if (m >> 60 == 0) {
+            m = m << 4 | (uint64_t)d;
+        } else {
+            e2 += 4;
+            sticky |= d != 0;
+        }
+    }
+    if (*p == '.') {
+        for (p++; (d = hex_val(*p)) >= 0; p++) {
+            any = 1;
+            if (m >> 60 == 0) {
+                m = m << 4 | (uint64_t)d;
+                e2 -= 4;
+            } else {
+                sticky |= d != 0;
+            }
+        }
+    }
+    if (!any)
+        return 0;
+    if ((*p | 0x20) == 'p') {
+        const char *e = p + 1;
+        int eneg = 0;
+        long exp2 = 0;
+        if (*e == '-' || *e == '+')
+            eneg = *e++ == '-';
+        if (is_digit(*e)) {
+            for (; is_digit(*e); e++) {
+                if (exp2 < 100000)
+                    exp2 = exp2 * 10 + (*e - '0');
+            }
+            e2 += eneg ? -exp2 : exp2;
+            p = e;
+        }
+    }
+    *bits = bin_to_bits(m, sticky, e2);
+    return p;
+}
+
+/* Case-insensitive prefix match against a lower-case word. */
+static int match_word(const char *s, const char *word)
+{
+    for (; *word; s++, word++) {
+        if ((*s | 0x20) != *word)
+            return 0;
+    }
+    return 1;
+}
+
+double CSHIM_NAME(strtod)(const char *nptr, char **endptr)
+{
+    /* Exactly representable powers of ten for the fast path. */
+    static const double exact_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    const char *p = nptr;
+    int neg = 0;
+
+    while (*p == ' ' || (unsigned char)(*p - '\t') < 5)
+        p++;
+    if (*p == '-' || *p == '+')
+        neg = *p++ == '-';
+
+    if (match_word(p, "inf")) {
+        p += match_word(p, "infinity") ? 8 : 3;
+        if (endptr)
+            *endptr = (char *)p;
+        return neg ? -__builtin_inf() : __builtin_inf();
+    }
+    if (match_word(p, "nan")) {
+        p += 3;
+        if (*p == '(') { /* nan(n-char-sequence) */
+            const char *q = p + 1;
+            while (is_digit(*q) || ((*q | 0x20) >= 'a' && (*q | 0x20) <= 'z') || *q == '_')
+                q++;
+            if (*q == ')')
+                p = q + 1;
+        }
+        if (endptr)
+            *endptr = (char *)p;
+        return neg ? -__builtin_nan("") : __builtin_nan("");
+    }
+    if (p[0] == '0' && (p[1] | 0x20) == 'x') {
+        uint64_t bits;
+        const char *end = hex_parse(p + 2, &bits);
+        if (end) {
+            if (endptr)
+                *endptr = (char *)end;
+            return neg ? -asdouble(bits) : asdouble(bits);
+        }
+    }
+
+    /* Up to 19 significant digits go into w; the rest only move the
+     * exponent and set trunc. */
+    const char *digits = p;
+    uint64_t w = 0;
+    int nd = 0, any = 0, trunc = 0;
+    long q = 0;
+    for (; is_digit(*p); p++) {
+        int c = *p - '0';
+        any = 1;
+        if (nd == 0 && c == 0)
+            continue;
+        if (nd < 19) {
+            w = w * 10 + (uint64_t)c;
+            nd++;
+        } else {
+            q++;
+            trunc |= c != 0;
+        }
+    }
+    if (*p == '.') {
+        for (p++; is_digit(*p); p++) {
+            int c = *p - '0';
+            any = 1;
+            if (nd == 0 && c == 0) {
+                q--;
+            } else if (nd < 19) {
+                w = w * 10 + (uint64_t)c;
+                nd++;
+                q--;
+            } else {
+                trunc |= c != 0;
+            }
+        }
+    }
+    if (!any) {
+        if (endptr)
+            *endptr = (char *)nptr;
+        return 0.0;
+    }
+
+    long exp10 = 0;
+    if ((*p | 0x20) == 'e') {
+        const char *e = p + 1;
+        int eneg = 0;
+        if (*e == '-' || *e == '+')
+            eneg = *e++ == '-';
+        if (is_digit(*e)) {
+            for (; is_digit(*e); e++) {
+                if (exp10 < 100000)
+                    exp10 = exp10 * 10 + (*e - '0');
+            }
+            if (eneg)
+                exp10 = -exp10;
+            p = e;
+        }
+    }
+    if (endptr)
+        *endptr = (char *)p;
+
+    double r;
+    q += exp10;
+    if (w == 0) {
+        r = 0.0;
+    } else if (!trunc && q >= -22 && q <= 22 && w <= 1ull << 53) {
+        /* Both operands exact: one correctly rounded operation. */
+        r = q < 0 ? (double)w / exact_pow10[-q] : (double)w * exact_pow10[q];
+    } else {
+        int qi = q < -100000 ? -100000 : q > 100000 ? 100000 : (int)q;
+        uint64_t bits = eisel_lemire(w, qi);
+        /* With digits dropped the value lies in [w, w+1) * 10^q; if both
+         * ends round the same way so does the value. */
+        if (trunc && eisel_lemire(w + 1, qi) != bits) {
+            decimal a;
+            dec_parse(&a, digits, exp10);
+            bits = dec_to_bits(&a);
+        }
+        r = asdouble(bits);
+    }
+    return neg ? -r : r;
+}
+
+/* Rounded through double; the extra rounding can be off by one ulp of the
+ * float on exact ties. */
+float CSHIM_NAME(strtof)(const char *nptr, char **endptr)
+{
+    return (float)CSHIM_NAME(strtod)(nptr, endptr);
+}
+
+/* ---- printing ---- */
+
+/* floor((a * 2^128 + b) * cp / 2^128) with the discarded bits folded into
+ * the lowest bit (round to odd). */
+CS_INLINE uint64_t round_to_odd(uint64_t g_hi, uint64_t g_lo, uint64_t cp)
+{
+    u128 x = (u128)g_lo * cp;
+    u128 y = (u128)g_hi * cp;
+    uint64_t z0 = (uint64_t)y + (uint64_t)(x >> 64);
+    uint64_t z1 = (uint64_t)(y >> 64) + (z0 < (uint64_t)y);
+    return z1 | (z0 > 1);
+}
+
+/*
+ * Schubfach: the shortest decimal s * 10^*k in the rounding interval of the
+ * positive finite double with the given bits, closest to it on a tie in
+ * length, ties to even. s may have trailing zeros.
+ */
+static uint64_t shortest_decimal(uint64_t bits, int *k_out)
+{
+    uint64_t fr = bits & FRAC_MASK;
+    int be = (int)(bits >> 52);
+    uint64_t c;
+    int q;
+
+    if (be) {
+        c = fr | (1ull << 52);
+        q = be - 1075;
+        /* Small integers are their own shortest form. */
+        if (q <= 0 && q > -53 && !(c & ((1ull << -q) - 1))) {
+            *k_out = 0;
+            return c >> -q;
+        }
+    } else {
+        c = fr;
+        q = -1074;
+    }
+
+    int even = !(c & 1);
+    /* At a power of two the gap below is half the gap above. */
+    int lower_closer = fr == 0 && be > 1;
+    uint64_t cbl = 4 * c - 2 + (uint64_t)lower_closer;
+    uint64_t cb = 4 * c;
+    uint64_t cbr = 4 * c + 2;
+
+    /* k = floor(log10(2^q)), or floor(log10(3/4 * 2^q)) */
+    int k = lower_closer ? (q * 1262611 - 524031) >> 22 : (q * 1262611) >> 22;
+    /* h = q + floor(log2(10^-k)) + 1, in [1, 4] */
+    int h = q + ((-k * 1741647) >> 19) + 1;
+
+    /* 10^-k rounded up to 128 bits */
+    const uint64_t *t = pow10_128[-k - POW10_MIN];
+    uint64_t adj = (-k > 55 || -k < -27) ? 1 : 0;
+    uint64_t g_lo = t[1] + adj;
+    uint64_t g_hi = t[0] + (g_lo < adj);
+
+    uint64_t vbl = round_to_odd(g_hi, g_lo, cbl << h);
+    uint64_t vb = round_to_odd(g_hi, g_lo, cb << h);
+    uint64_t vbr = round_to_odd(g_hi, g_lo, cbr << h);
+    uint64_t lower = vbl + !even;
+    uint64_t upper = vbr - !even;
+
+    uint64_t s = vb / 4;
+    if (s >= 10) { /* try one digit fewer */
+        uint64_t sp = s / 10;
+        int up_inside = lower <= 40 * sp;
+        int wp_inside = 40 * sp + 40 <= upper;
+        if (up_inside != wp_inside) {
+            *k_out = k + 1;
+            return sp + (uint64_t)wp_inside;
+        }
+    }
+    int u_inside = lower <= 4 * s;
+    int w_inside = 4 * s + 4 <= upper;
+    *k_out = k;
+    if (u_inside != w_inside)
+        return s + (uint64_t)w_inside;
+    uint64_t mid = 4 * s + 2;
+    return s + (vb > mid || (vb == mid && (s & 1)));
+}
+
+int cshim_dtoa_shortest(double d, char *buf, int *decpt)
+{
+    uint64_t bits = asuint64(d) & ~SIGN_BIT;
+    if (bits == 0) {
+        buf[0] = '0';
+        buf[1] = '\0';
+        *decpt = 1;
+        return 1;
+    }
+
+    int k;
+    uint64_t s = shortest_decimal(bits, &k);
+    while (s % 10 == 0) {
+        s /= 10;
+        k++;
+    }
+    char tmp[20];
+    int n = 0;
+    while (s) {
+        tmp[n++] = (char)('0' + s % 10);
+        s /= 10;
+    }
+    for (int i = 0; i < n; i++)
+        buf[i] = tmp[n - 1 - i];
+    buf[n] = '\0';
+    *decpt = n + k;
+    return n;
+}
+
+int cshim_dtoa_fixed(double d, int n_digits, char *buf, int *decpt)
+{
+    decimal a;
+    int i = 0;
+
+    dec_from_double(&a, asuint64(d) & ~SIGN_BIT);
+    if (a.nd == 0) {
+        *decpt = 1;
+    } else {
+        dec_round(&a, n_digits);
+        for (; i < a.nd; i++)
+            buf[i] = (char)('0' + a.d[i]);
+        *decpt = a.dp;
+    }
+    for (; i < n_digits; i++)
+        buf[i] = '0';
+    buf[n_digits] = '\0';
+    return n_digits;
+}
+
+int cshim_dtoa_frac(double d, int n_frac, char *buf, int buf_size)
+{
+    decimal a;
+    uint64_t bits = asuint64(d);
+    int len = 0;
+
+#define PUT(ch)                            \
+    do {                                   \
+        if (len < buf_size - 1)            \
+            buf[len++] = (char)(ch);       \
+    } while (0)
+
+    if (buf_size <= 0)
+        return 0;
+    dec_from_double(&a, bits & ~SIGN_BIT);
+    if (a.nd)
+        dec_round(&a, a.dp + n_frac);
+
+    if (bits >> 63)
+        PUT('-');
+    if (a.dp <= 0)
+        PUT('0');
+    for (int i = 0; i < a.dp; i++)
+        PUT(i < a.nd ? '0' + a.d[i] : '0');
+    if (n_frac > 0) {
+        PUT('.');
+        for (int i = a.dp; i < a.dp + n_frac; i++)
+            PUT(i >= 0 && i < a.nd ? '0' + a.d[i] : '0');
+    }
+    buf[len] = '\0';
+    return len;
+#undef PUT
+}
+
+/*
+ * cshim_dtoa_even from the shortest digits S (which read back as d) when that
+ * provably gives the exact answer, else -1. Rounding S at `keep` digits
+ * matches rounding d unless a halfway point lies between them; such a point
+ * has keep + 1 digits and would itself read back as d, so Schubfach would
+ * have returned it (or something shorter) unless S has exactly keep + 1
+ * digits ending in 5. Keeping all of S is right when an ulp of d is below
+ * the last kept place, so S and d are in the same half of it.
+ */
+static int even_from_shortest(double d, int n, int after_point, char *buf, int *decpt)
+{
+    char s[20];
+    int dp;
+    int k = cshim_dtoa_shortest(d, s, &dp);
+    int keep = after_point ? dp + n : n;
+
+    if (keep >= k) {
+        uint64_t bits = asuint64(d);
+        int be = (int)(bits >> 52) & 0x7ff;
+        int64_t e2 = (be ? be : 1) - 1075;
+        /* ulp = 2^e2 < 10^m, with log2(10) rounded toward failing */
+        int64_t m = dp - keep;
+        if (e2 * 1000 >= (m >= 0 ? m * 3321 : m * 3322))
+            return -1;
+        for (int i = 0; i <= k; i++)
+            buf[i] = s[i];
+        *decpt = dp;
+        return k;
+    }
+    if (keep == k - 1 && s[keep] == '5')
+        return -1;
+    if (keep < 0) {
+        buf[0] = '\0';
+        *decpt = 1;
+        return 0;
+    }
+    int up = s[keep] >= '5';
+    int len = keep;
+    for (int i = 0; i < len; i++)
+        buf[i] = s[i];
+    if (up) {
+        while (len > 0 && buf[len - 1] == '9')
+            len--;
+        if (len == 0) {
+            buf[len++] = '1';
+            dp++;
+        } else {
+            buf[len - 1]++;
+        }
+    } else {
+        while (len > 0 && buf[len - 1] == '0')
+            len--;
+    }
+    buf[len] = '\0';
+    *decpt = len ? dp : 1;
+    return len;
+}
+
+int cshim_dtoa_even(double d, int n, int after_point, char *buf, int buf_size, int *decpt)
+{
+    decimal a;
+    int i = 0;
+
+    d = __builtin_fabs(d);
+    if (d != 0 && buf_size > 20) {
+        int r = even_from_shortest(d, n, after_point, buf, decpt);
+        if (r >= 0)
+            return r;
+    }
+    dec_from_double(&a, asuint64(d) & ~SIGN_BIT);
+    if (a.nd)
+        dec_round_mode(&a, after_point ? a.dp + n : n, 1);
+    for (; i < a.nd && i < buf_size - 1; i++)
+        buf[i] = (char)('0' + a.d[i]);
+    buf[i] = '\0';
+    *decpt = a.nd ? a.dp : 1;
+    return i;
+}
@@ -0,0 +1,42 @@
+/*
+ * dtoa.h — number formatting entry points of cshim/dtoa.c, for callers that
+ * want digits directly rather than going through printf.
+ *
+ * Digits come back as ASCII with the decimal point implied: |d| is
+ * 0.<digits> * 10^*decpt. Zero is "0" (or n_digits zeros) with *decpt = 1.
+ * The sign is the caller's business: only |d| is converted.
+ */
+#ifndef CSHIM_DTOA_H
+#define CSHIM_DTOA_H
+
+/*
+ * Shortest digit string that reads back as d, picking the closest such string
+ * (ties to even) as ECMAScript Number::toString requires. d finite; buf holds
+ * at least 18 bytes. Returns the digit count.
+ */
+int cshim_dtoa_shortest(double d, char *buf, int *decpt);
+
+/*
+ * Exactly n_digits significant digits (1 <= n_digits), correctly rounded with
+ * ties away from zero (toPrecision/toExponential). d finite; buf holds
+ * n_digits + 1 bytes. Returns n_digits.
+ */
+int cshim_dtoa_fixed(double d, int n_digits, char *buf, int *decpt);
+
+/*
+ * "[-]ddd.fff" with n_frac digits after the point (none and no point when
+ * n_frac is 0), ties away from zero (toFixed). d finite. Writes at most
+ * buf_size - 1 characters plus a NUL and returns the length written.
+ */
+int cshim_dtoa_frac(double d, int n_frac, char *buf, int buf_size);
+
+/*
+ * printf's digits: |d| rounded half to even (C's default rounding mode) to n
+ * significant digits, or with after_point set to n digits after the decimal
+ * point. d finite. Trailing zeros are not written: returns the digit count
+ * (0 if d rounds to zero, with *decpt = 1) and NUL-terminates. A 768-byte
+ * buf holds every digit of any double.
+ */
+int cshim_dtoa_even(double d, int n, int after_point, char *buf, int buf_size, int *decpt);
+
+#endif /* CSHIM_DTOA_H */
@@ -0,0 +1,1171 @@
+/*
+ * math.c — libm for the freestanding userspace ports.
+ *
+ * sqrt and the rounding family are single AArch64 instructions (fsqrt,
+ * frint*, fcvta*, fminnm/fmaxnm). The transcendental functions carry an
+ * extra double of precision (hi + lo) through reduction and are accurate to
+ * about 1 ulp:
+ *   - exp/exp2/expm1: x = k*ln2/128 + r, 2^(k/128) from a 128-entry table, a
+ *     degree-6 polynomial for exp(r).
+ *   - log/log2/log10/log1p: z*invc - 1 computed exactly against a 128-entry
+ *     1/c table, a degree-10 log1p polynomial, log(c) as hi + lo.
+ *   - pow: the hi + lo log fed through y into the exp kernel.
+ *   - sin/cos/tan: Cody-Waite reduction by pi/2 below 2^20*pi/2, Payne-Hanek
+ *     against the bits of 2/pi above that.
+ *   - atan/atan2/asin/acos: atan(x) = atan(k/8) + atan(t), |t| <= 1/16.
+ *
+ * Tables and coefficients are generated into math_data.h by
+ * tools/gen_math_data.py. errno and the floating-point exception flags are
+ * not maintained. Host builds need -mfma (or equivalent) and
+ * -fno-math-errno so that fma and sqrt stay inline.
+ */
+
+#include "cshim.h"
+#include "math_data.h"
+
+/*
+ * The double-double steps below rely on every product and sum rounding
+ * exactly where it is written: a contracted a*b + c silently breaks them.
+ */
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#define SIGN_BIT 0x8000000000000000ull
+#define INF_BITS 0x7ff0000000000000ull
+
+#define FMA(a, b, c) __builtin_fma((a), (b), (c))
+
+typedef union {
+    double f;
+    uint64_t i;
+} dbits;
+
+CS_INLINE uint64_t asuint64(double x)
+{
+    dbits u = { x };
+    return u.i;
+}
+
+CS_INLINE double asdouble(uint64_t i)
+{
+    dbits u;
+    u.i = i;
+    return u.f;
+}
+
+CS_INLINE unsigned top12(double x) { return (unsigned)(asuint64(x) >> 52); }
+
+/* a + b = s + *err exactly. */
+CS_INLINE double two_sum(double a, double b, double *err)
+{
+    double s = a + b;
+    double bb = s - a;
+    *err = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+/* As two_sum, for |a| >= |b| (or a == 0). */
+CS_INLINE double fast_two_sum(double a, double b, double *err)
+{
+    double s = a + b;
+    *err = b - (s - a);
+    return s;
+}
+
+/* ---- single-instruction operations ---- */
+
+#if defined(__aarch64__)
+
+#define FP_UNARY(insn, x)                                   \
+    double r_;                                              \
+    __asm__(insn " %d0, %d1" : "=w"(r_) : "w"(x));          \
+    return r_
+
+CS_INLINE double frintn(double x) { FP_UNARY("frintn", x); } /* nearest, ties even */
+CS_INLINE double frintm(double x) { FP_UNARY("frintm", x); } /* toward -inf */
+CS_INLINE double frintp(double x) { FP_UNARY("frintp", x); } /* toward +inf */
+CS_INLINE double frintz(double x) { FP_UNARY("frintz", x); } /* toward zero */
+CS_INLINE double frinta(double x) { FP_UNARY("frinta", x); } /* nearest, ties away */
+CS_INLINE double frintx(double x) { FP_UNARY("frintx", x); } /* current mode */
+CS_INLINE double frinti(double x) { FP_UNARY("frinti", x); } /* current mode, quiet */
+CS_INLINE double fsqrt(double x) { FP_UNARY("fsqrt", x); }
+
+CS_INLINE double fminnm(double x, double y)
+{
+    double r;
+    __asm__("fminnm %d0, %d1, %d2" : "=w"(r) : "w"(x), "w"(y));
+    return r;
+}
+
+CS_INLINE double fmaxnm(double x, double y)
+{
+    double r;
+    __asm__("fmaxnm %d0, %d1, %d2" : "=w"(r) : "w"(x), "w"(y));
+    return r;
+}
+
+CS_INLINE int64_t fcvt_round(double x) /* lround */
+{
+    int64_t r;
+    __asm__("fcvtas %x0, %d1" : "=r"(r) : "w"(x));
+    return r;
+}
+
+CS_INLINE int64_t fcvt_rint(double x) /* lrint */
+{
+    int64_t r;
+    __asm__("fcvtzs %x0, %d1" : "=r"(r) : "w"(frintx(x)));
+    return r;
+}
+
+#else /* portable fallbacks, for host builds of the benchmarks */
+
+CS_INLINE double frintn(double x)
+{
+    uint64_t u = asuint64(x);
+    if ((u >> 52 & 0x7ff) >= 0x3ff + 52)
+        return x;
+    /* Adding and removing 2^52 rounds to an integer in the current mode. */
+    double y = (u >> 63) ? (x - 0x1p52) + 0x1p52 : (x + 0x1p52) - 0x1p52;
+    return y == 0 ? asdouble(u & SIGN_BIT) : y;
+}
+
+CS_INLINE double frintz(double x)
+{
+    uint64_t u = asuint64(x);
+    int e = (int)(u >> 52 & 0x7ff) - 0x3ff + 12;
+    if (e >= 52 + 12)
+        return x;
+    if (e < 12)
+        e = 1;
+    uint64_t m = ~0ull >> e;
+    return (u & m) ? asdouble(u & ~m) : x;
+}
+
+CS_INLINE double frintm(double x)
+{
+    double y = frintn(x);
+    return y > x ? y - 1.0 : y;
+}
+
+CS_INLINE double frintp(double x)
+{
+    double y = frintn(x);
+    return y < x ? y + 1.0 : y;
+}
+
+CS_INLINE double frinta(double x)
+{
+    double t = frintz(x);
+    double d = x - t; /* exact */
+    if (d >= 0.5)
+        t += 1.0;
+    else if (d <= -0.5)
+        t -= 1.0;
+    return t;
+}
+
+CS_INLINE double frintx(double x) { return frintn(x); }
+CS_INLINE double frinti(double x) { return frintn(x); }
+CS_INLINE double fsqrt(double x) { return __builtin_sqrt(x); }
+
+CS_INLINE double fminnm(double x, double y)
+{
+    if (x != x)
+        return y;
+    if (y != y)
+        return x;
+    if (x == y)
+        return (asuint64(x) >> 63) ? x : y;
+    return x < y ? x : y;
+}
+
+CS_INLINE double fmaxnm(double x, double y)
+{
+    if (x != x)
+        return y;
+    if (y != y)
+        return x;
+    if (x == y)
+        return (asuint64(x) >> 63) ? y : x;
+    return x > y ? x : y;
+}
+
+CS_INLINE int64_t fcvt_round(double x) { return (int64_t)frinta(x); }
+CS_INLINE int64_t fcvt_rint(double x) { return (int64_t)frintx(x); }
+
+#endif
+
+double CSHIM_NAME(floor)(double x) { return frintm(x); }
+double CSHIM_NAME(ceil)(double x) { return frintp(x); }
+double CSHIM_NAME(trunc)(double x) { return frintz(x); }
+double CSHIM_NAME(round)(double x) { return frinta(x); }
+double CSHIM_NAME(rint)(double x) { return frintx(x); }
+double CSHIM_NAME(nearbyint)(double x) { return frinti(x); }
+double CSHIM_NAME(sqrt)(double x) { return fsqrt(x); }
+double CSHIM_NAME(fmin)(double x, double y) { return fminnm(x, y); }
+double CSHIM_NAME(fmax)(double x, double y) { return fmaxnm(x, y); }
+long CSHIM_NAME(lrint)(double x) { return (long)fcvt_rint(x); }
+long long CSHIM_NAME(llrint)(double x) { return (long long)fcvt_rint(x); }
+long CSHIM_NAME(lround)(double x) { return (long)fcvt_round(x); }
+long long CSHIM_NAME(llround)(double x) { return (long long)fcvt_round(x); }
+
+/* ---- bit manipulation ---- */
+
+double CSHIM_NAME(fabs)(double x) { return asdouble(asuint64(x) & ~SIGN_BIT); }
+
+float CSHIM_NAME(fabsf)(float x)
+{
+    union {
+        float f;
+        uint32_t i;
+    } u = { x };
+    u.i &= 0x7fffffffu;
+    return u.f;
+}
+
+double CSHIM_NAME(copysign)(double x, double y)
+{
+    return asdouble((asuint64(x) & ~SIGN_BIT) | (asuint64(y) & SIGN_BIT));
+}
+
+double CSHIM_NAME(scalbn)(double x, int n)
+{
+    double y = x;
+    if (n > 1023) {
+        y *= 0x1p1023;
+        n -= 1023;
+        if (n > 1023) {
+            y *= 0x1p1023;
+            n -= 1023;
+            if (n > 1023)
+                n = 1023;
+        }
+    } else if (n < -1022) {
+        /* Keep the final scale below 2^-53 so a subnormal result is rounded
+         * only once. */
+        y *= 0x1p-1022 * 0x1p53;
+        n += 1022 - 53;
+        if (n < -1022) {
+            y *= 0x1p-1022 * 0x1p53;
+            n += 1022 - 53;
+            if (n < -1022)
+                n = -1022;
+        }
+    }
+    return y * asdouble((uint64_t)(0x3ff + n) << 52);
+}
+
+double CSHIM_NAME(ldexp)(double x, int exp) { return CSHIM_NAME(scalbn)(x, exp); }
+
+double CSHIM_NAME(frexp)(double x, int *exp)
+{
+    uint64_t u = asuint64(x);
+    int e = (int)(u >> 52 & 0x7ff);
+    if (e == 0) {
+        if (x == 0) {
+            *exp = 0;
+            return x;
+        }
+        x = CSHIM_NAME(frexp)(x * 0x1p64, exp);
+        *exp -= 64;
+        return x;
+    }
+    if (e == 0x7ff) {
+        *exp = 0;
+        return x;
+    }
+    *exp = e - 0x3fe;
+    return asdouble((u & 0x800fffffffffffffull) | 0x3fe0000000000000ull);
+}
+
+double CSHIM_NAME(modf)(double x, double *iptr)
+{
+    double t = frintz(x);
+    *iptr = t;
+    if ((asuint64(x) & ~SIGN_BIT) >= INF_BITS)
+        return (asuint64(x) & ~SIGN_BIT) == INF_BITS ? CSHIM_NAME(copysign)(0.0, x) : x;
+    return CSHIM_NAME(copysign)(x - t, x);
+}
+
+/* Exact remainder by shift-and-subtract on the significands. */
+double CSHIM_NAME(fmod)(double x, double y)
+{
+    uint64_t ux = asuint64(x), uy = asuint64(y);
+    int ex = (int)(ux >> 52 & 0x7ff), ey = (int)(uy >> 52 & 0x7ff);
+    uint64_t sx = ux & SIGN_BIT;
+    uint64_t i;
+
+    if (uy << 1 == 0 || (uy & ~SIGN_BIT) > INF_BITS || ex == 0x7ff)
+        return (x * y) / (x * y);
+    if (ux << 1 <= uy << 1) {
+        if (ux << 1 == uy << 1)
+            return 0 * x;
+        return x;
+    }
+
+    if (!ex) {
+        for (i = ux << 12; i >> 63 == 0; ex--, i <<= 1)
+            ;
+        ux <<= -ex + 1;
+    } else {
+        ux &= ~0ull >> 12;
+        ux |= 1ull << 52;
+    }
+    if (!ey) {
+        for (i = uy << 12; i >> 63 == 0; ey--, i <<= 1)
+            ;
+        uy <<= -ey + 1;
+    } else {
+        uy &= ~0ull >> 12;
+        uy |= 1ull << 52;
+    }
+
+    for (; ex > ey; ex--) {
+        i = ux - uy;
+        if (i >> 63 == 0) {
+            if (i == 0)
+                return 0 * x;
+            ux = i;
+        }
+        ux <<= 1;
+    }
+    i = ux - uy;
+    if (i >> 63 == 0) {
+        if (i == 0)
+            return 0 * x;
+        ux = i;
+    }
+    for (; ux >> 52 == 0; ux <<= 1, ex--)
+        ;
+
+    if (ex > 0) {
+        ux -= 1ull << 52;
+        ux |= (uint64_t)ex << 52;
+    } else {
+        ux >>= -ex + 1;
+    }
+    return asdouble(ux | sx);
+}
+
+/* ---- log ---- */
+
+/*
+ * log of the positive normal double with bits ix (the exponent field may be
+ * biased below zero for pre-scaled subnormals), as hi + *lo with ~2^-68
+ * relative error.
+ */
+static double log_inline(uint64_t ix, double *lo)
+{
+    uint64_t tmp = ix - 0x3fe6000000000000ull;
+    int i = (int)(tmp >> (52 - LOG_TABLE_BITS)) & ((1 << LOG_TABLE_BITS) - 1);
+    int64_t k = (int64_t)tmp >> 52;
+    double z = asdouble(ix - (tmp & 0xfffull << 52));
+    double kd = (double)k;
+    double invc = log_table[i].invc;
+
+    /* r = z*invc - 1 exactly, as rhi + rlo (p - 1 is exact: p is near 1). */
+    double p = z * invc;
+    double pe = FMA(z, invc, -p);
+    double rlo, rhi = fast_two_sum(p - 1.0, pe, &rlo);
+
+    double e1, e2, e3;
+    double s = two_sum(kd * LN2_HI, log_table[i].logc, &e1);
+    s = two_sum(s, rhi, &e2);
+    double ar = -0.5 * rhi;
+    double ar2 = ar * rhi;
+    double ar2lo = FMA(ar, rhi, -ar2);
+    s = two_sum(s, ar2, &e3);
+
+    double r2 = rhi * rhi;
+    double poly = r2 * rhi *
+                  (LOG_C3 + rhi * (LOG_C4 + rhi * (LOG_C5 + rhi * (LOG_C6 + rhi * (LOG_C7 +
+                  rhi * (LOG_C8 + rhi * (LOG_C9 + rhi * LOG_C10)))))));
+    double t = kd * LN2_LO + log_table[i].logctail + (e1 + e2 + e3) + ar2lo + rlo * (1.0 - rhi) + poly;
+    return fast_two_sum(s, t, lo);
+}
+
+double CSHIM_NAME(log)(double x)
+{
+    uint64_t ix = asuint64(x);
+    unsigned top = (unsigned)(ix >> 48);
+    if (top - 0x0010 >= 0x7ff0 - 0x0010) {
+        /* x < 0x1p-1022 or inf or nan. */
+        if (ix << 1 == 0)
+            return -__builtin_inf();
+        if (ix == INF_BITS)
+            return x;
+        if ((top & 0x8000) || (top & 0x7ff0) == 0x7ff0)
+            return (x - x) / (x - x);
+        /* subnormal: normalize */
+        ix = asuint64(x * 0x1p52) - (52ull << 52);
+    }
+    double lo;
+    return log_inline(ix, &lo);
+}
+
+/* log(x) * (scale_hi + scale_lo), carrying the log's low word through. */
+static double log_scaled(double x, double scale_hi, double scale_lo)
+{
+    uint64_t ix = asuint64(x);
+    unsigned top = (unsigned)(ix >> 48);
+    if (top - 0x0010 >= 0x7ff0 - 0x0010) {
+        if (ix << 1 == 0)
+            return -__builtin_inf();
+        if (ix == INF_BITS)
+            return x;
+        if ((top & 0x8000) || (top & 0x7ff0) == 0x7ff0)
+            return (x - x) / (x - x);
+        ix = asuint64(x * 0x1p52) - (52ull << 52);
+    }
+    double lo, hi = log_inline(ix, &lo);
+    double ph = hi * scale_hi;
+    double pl = FMA(hi, scale_hi, -ph) + (hi * scale_lo + lo * scale_hi);
+    return ph + pl;
+}
+
+double CSHIM_NAME(log2)(double x) { return log_scaled(x, INVLN2_HI, INVLN2_LO); }
+double CSHIM_NAME(log10)(double x) { return log_scaled(x, INVLN10_HI, INVLN10_LO); }
+
+double CSHIM_NAME(log1p)(double x)
+{
+    uint64_t ax = asuint64(x) & ~SIGN_BIT;
+    if (ax < 0x3ca0000000000000ull) /* |x| < 2^-53 */
+        return x;
+    if (ax >= INF_BITS)
+        return (asuint64(x) == (INF_BITS | SIGN_BIT)) ? (x - x) / (x - x) : x + x;
+    if (x <= -1.0)
+        return x == -1.0 ? -__builtin_inf() : (x - x) / (x - x);
+    if (x >= 0x1p53)
+        return CSHIM_NAME(log)(x);
+    /* log(u) for u = 1 + x rounded, plus log(1 + c/u) ~= c/u for the
+     * rounding error c. */
+    double c, u = two_sum(1.0, x, &c);
+    double lo, hi = log_inline(asuint64(u), &lo);
+    return hi + (lo + c / u);
+}
+
+/* ---- exp ---- */
+
+/*
+ * Reduce exp(x + xtail) = 2^(k/128) * (1 + *tmp), |x| < 1024: returns the
+ * bits of 2^(k/128) with the exponent added in wrapping unsigned arithmetic
+ * (callers rebias when it fell outside the normal range) and k in *ki.
+ */
+CS_INLINE uint64_t exp_reduce(double x, double xtail, double *tmp, int64_t *ki)
+{
+    double kd = frintn(EXP_INVLN2N * x);
+    int64_t k = (int64_t)kd;
+    /* x - kd*EXP_LN2HI_N is exact: the product is exact and near x. */
+    double r = ((x - kd * EXP_LN2HI_N) - kd * EXP_LN2LO_N) + xtail;
+    uint64_t idx = (uint64_t)k & ((1 << EXP_TABLE_BITS) - 1);
+    double r2 = r * r;
+    *tmp = exp_table[idx].tail + r + r2 * (EXP_C2 + r * EXP_C3) +
+           r2 * r2 * (EXP_C4 + r * EXP_C5 + r2 * EXP_C6);
+    *ki = k;
+    return asuint64(exp_table[idx].hi) + (((uint64_t)k - idx) << (52 - EXP_TABLE_BITS));
+}
+
+/* 512 <= |x| < 1024: the scale's exponent is out of range, rebias it. */
+static double exp_special(double tmp, uint64_t sbits, int64_t ki)
+{
+    double scale, y;
+    if (ki > 0) {
+        sbits -= 1009ull << 52;
+        scale = asdouble(sbits);
+        return 0x1p1009 * (scale + scale * tmp);
+    }
+    sbits += 1022ull << 52;
+    scale = asdouble(sbits);
+    y = scale + scale * tmp;
+    if (y < 1.0) {
+        /* Round to 53 bits before scaling into the subnormal range, so the
+         * result is rounded once. */
+        double lo = scale - y + scale * tmp;
+        double hi = 1.0 + y;
+        lo = 1.0 - hi + y + lo;
+        y = (hi + lo) - 1.0;
+        if (y == 0.0)
+            y = 0.0;
+    }
+    return 0x1p-1022 * y;
+}
+
+/* exp(x + xtail), |xtail| <= 2^-50 |x|. */
+static double exp_inline(double x, double xtail)
+{
+    unsigned abstop = top12(x) & 0x7ff;
+    int special = 0;
+    if (abstop - 0x3c9 >= 0x408 - 0x3c9) {
+        if (abstop < 0x3c9) /* |x| < 2^-54 */
+            return 1.0 + x;
+        if (abstop >= 0x409) { /* |x| >= 1024 */
+            if (asuint64(x) == (INF_BITS | SIGN_BIT))
+                return 0.0;
+            if (abstop >= 0x7ff)
+                return 1.0 + x;
+            return (asuint64(x) >> 63) ? 0x1p-1022 * 0x1p-1022 : 0x1p1023 * 0x1p1023;
+        }
+        special = 1; /* 512 <= |x| < 1024 */
+    }
+    double tmp;
+    int64_t ki;
+    uint64_t sbits = exp_reduce(x, xtail, &tmp, &ki);
+    if (special)
+        return exp_special(tmp, sbits, ki);
+    double scale = asdouble(sbits);
+    return scale + scale * tmp;
+}
+
+double CSHIM_NAME(exp)(double x) { return exp_inline(x, 0.0); }
+
+double CSHIM_NAME(exp2)(double x)
+{
+    double hi = x * LN2_DBL;
+    double lo = FMA(x, LN2_DBL, -hi) + x * LN2_DBL_LO;
+    return exp_inline(hi, lo);
+}
+
+double CSHIM_NAME(expm1)(double x)
+{
+    uint64_t ax = asuint64(x) & ~SIGN_BIT;
+    if (ax < 0x3c90000000000000ull) /* |x| < 2^-54 */
+        return x;
+    if (ax >= 0x4044000000000000ull) { /* |x| >= 40, inf, nan */
+        if (ax > INF_BITS)
+            return x + x;
+        return (asuint64(x) >> 63) ? -1.0 : exp_inline(x, 0.0);
+    }
+    /* As exp_reduce, but with r kept as hi + lo: scale*(1 + tmp) - 1 is
+     * summed as (scale - 1) + scale*r + scale*(rest), the first two exactly,
+     * so results near the table's own 2^(k/128) - 1 stay accurate. */
+    double kd = frintn(EXP_INVLN2N * x);
+    int64_t k = (int64_t)kd;
+    double rl, r = two_sum(x - kd * EXP_LN2HI_N, -(kd * EXP_LN2LO_N), &rl);
+    uint64_t idx = (uint64_t)k & ((1 << EXP_TABLE_BITS) - 1);
+    double tail = exp_table[idx].tail;
+    double scale = asdouble(asuint64(exp_table[idx].hi) +
+                            (((uint64_t)k - idx) << (52 - EXP_TABLE_BITS)));
+    double r2 = r * r;
+    double q = r2 * (EXP_C2 + r * EXP_C3) + r2 * r2 * (EXP_C4 + r * EXP_C5 + r2 * EXP_C6);
+
+    double e1, s = two_sum(scale, -1.0, &e1);
+    double p = scale * r;
+    double pl = FMA(scale, r, -p);
+    double e2;
+    s = two_sum(s, p, &e2);
+    return s + ((e1 + e2 + pl) + scale * (rl + q + tail * (1.0 + r)));
+}
+
+/* ---- pow ---- */
+
+/* 0: not an integer, 1: odd integer, 2: even integer. */
+static int checkint(uint64_t iy)
+{
+    int e = (int)(iy >> 52 & 0x7ff);
+    if (e < 0x3ff)
+        return 0;
+    if (e > 0x3ff + 52)
+        return 2;
+    if (iy & ((1ull << (0x3ff + 52 - e)) - 1))
+        return 0;
+    if (iy & (1ull << (0x3ff + 52 - e)))
+        return 1;
+    return 2;
+}
+
+CS_INLINE int zeroinfnan(uint64_t i) { return 2 * i - 1 >= 2 * INF_BITS - 1; }
+
+double CSHIM_NAME(pow)(double x, double y)
+{
+    uint64_t ix = asuint64(x), iy = asuint64(y);
+    unsigned topx = top12(x), topy = top12(y);
+    int neg = 0;
+
+    if (topx - 0x001 >= 0x7ff - 0x001 || (topy & 0x7ff) - 0x3be >= 0x43e - 0x3be) {
+        /* x is subnormal, zero, negative, inf or nan, or |y| is tiny (< 2^-65),
+         * huge (>= 2^63), inf or nan. */
+        if (zeroinfnan(iy)) {
+            if (2 * iy == 0)
+                return 1.0;
+            if (ix == asuint64(1.0))
+                return 1.0;
+            if (2 * ix > 2 * INF_BITS || 2 * iy > 2 * INF_BITS)
+                return x + y;
+            if (2 * ix == 2 * asuint64(1.0))
+                return 1.0;
+            if ((2 * ix < 2 * asuint64(1.0)) == !(iy >> 63))
+                return 0.0; /* |x| < 1 && y == inf, or |x| > 1 && y == -inf */
+            return y * y;
+        }
+        if (zeroinfnan(ix)) {
+            double x2 = x * x;
+            if ((ix >> 63) && checkint(iy) == 1)
+                x2 = -x2;
+            return (iy >> 63) ? 1.0 / x2 : x2;
+        }
+        /* x and y are non-zero finite. */
+        if (ix >> 63) {
+            int yint = checkint(iy);
+            if (yint == 0)
+                return (x - x) / (x - x);
+            if (yint == 1)
+                neg = 1;
+            ix &= ~SIGN_BIT;
+            topx &= 0x7ff;
+        }
+        if ((topy & 0x7ff) - 0x3be >= 0x43e - 0x3be) {
+            if (ix == asuint64(1.0))
+                return neg ? -1.0 : 1.0;
+            if ((topy & 0x7ff) < 0x3be) /* |y| tiny: 1 +- y rounds right */
+                return ix > asuint64(1.0) ? 1.0 + y : 1.0 - y;
+            return (ix > asuint64(1.0)) == (topy < 0x800) ? 0x1p1023 * 0x1p1023 : 0.0;
+        }
+        if (topx == 0) {
+            /* subnormal x: normalize, biasing the exponent below zero */
+            ix = asuint64(asdouble(ix) * 0x1p52);
+            ix -= 52ull << 52;
+        }
+    }
+
+    double lo, hi = log_inline(ix, &lo);
+    double ehi = y * hi;
+    double elo = FMA(y, hi, -ehi) + y * lo;
+    double r = exp_inline(ehi, elo);
+    return neg ? -r : r;
+}
+
+/* ---- trigonometric ---- */
+
+/* sin(x + y) on |x| <= pi/4, y a tail much smaller than x, as hi + *lo. */
+static double ksin_dd(double x, double y, double *lo)
+{
+    double z = x * x, w = z * z;
+    double r = SIN_S2 + z * (SIN_S3 + z * SIN_S4) +
+               z * w * (SIN_S5 + z * (SIN_S6 + z * (SIN_S7 + z * SIN_S8)));
+    double v = z * x;
+    return fast_two_sum(x, -((z * (0.5 * y - v * r) - y) - v * SIN_S1), lo);
+}
+
+/* cos(x + y) on |x| <= pi/4, as hi + *lo. 1 - x^2/2 is formed so its rounding
+ * error is recovered. */
+static double kcos_dd(double x, double y, double *lo)
+{
+    double z = x * x, w = z * z;
+    double r = z * (COS_C1 + z * (COS_C2 + z * COS_C3)) +
+               w * w * (COS_C4 + z * (COS_C5 + z * (COS_C6 + z * COS_C7)));
+    double hz = 0.5 * z;
+    double h = 1.0 - hz;
+    return fast_two_sum(h, ((1.0 - h) - hz) + (z * r - x * y), lo);
+}
+
+CS_INLINE double ksin(double x, double y)
+{
+    double lo, hi = ksin_dd(x, y, &lo);
+    return hi + lo;
+}
+
+CS_INLINE double kcos(double x, double y)
+{
+    double lo, hi = kcos_dd(x, y, &lo);
+    return hi + lo;
+}
+
+/* (ah + al) / (bh + bl) */
+CS_INLINE double div_dd(double ah, double al, double bh, double bl)
+{
+    double q = ah / bh;
+    double r = (FMA(-q, bh, ah) + al) - q * bl;
+    return q + r / bh;
+}
+
+/* 64 bits of the 256-bit little-endian integer p starting at bit pos. */
+CS_INLINE uint64_t bits_at(const uint64_t *p, int pos)
+{
+    int w = pos >> 6, sh = pos & 63;
+    uint64_t v = p[w] >> sh;
+    if (sh && w < 3)
+        v |= p[w + 1] << (64 - sh);
+    return v;
+}
+
+/*
+ * Payne-Hanek: x mod pi/2 for |x| >= 2^20*pi/2, x positive. Only the bits of
+ * 2/pi that can land in the integer part mod 4 or the top 128 fraction bits
+ * of x*2/pi matter, so a 192-bit window of them is multiplied by the 53-bit
+ * significand.
+ */
+static int rem_pio2_large(double x, double *y)
+{
+    uint64_t ix = asuint64(x);
+    int e = (int)(ix >> 52) - 0x3ff; /* x = m * 2^(e-52) */
+    uint64_t m = (ix & ((1ull << 52) - 1)) | (1ull << 52);
+
+    /* Bits of 2/pi numbered from 1 after the point: bit i weighs m*2^(e-52-i),
+     * which is a multiple of 4 for i <= e-54. */
+    int i0 = e - 53 > 1 ? e - 53 : 1;
+    int a = i0 - 1, w = a >> 6, sh = a & 63;
+    uint64_t b[3];
+    for (int k = 0; k < 3; k++) {
+        b[k] = two_over_pi[w + k] << sh;
+        if (sh)
+            b[k] |= two_over_pi[w + k + 1] >> (64 - sh);
+    }
+
+    /* p = m * window (b[0] is most significant), 245 bits. */
+    unsigned __int128 t0 = (unsigned __int128)m * b[2];
+    unsigned __int128 t1 = (unsigned __int128)m * b[1] + (uint64_t)(t0 >> 64);
+    unsigned __int128 t2 = (unsigned __int128)m * b[0] + (uint64_t)(t1 >> 64);
+    uint64_t p[4] = { (uint64_t)t0, (uint64_t)t1, (uint64_t)t2, (uint64_t)(t2 >> 64) };
+
+    /* x*2/pi = p / 2^s, mod 4. */
+    int s = i0 + 243 - e;
+    int n = (int)(bits_at(p, s) & 3);
+    uint64_t fhi = bits_at(p, s - 64), flo = bits_at(p, s - 128);
+
+    /* Fraction as a signed 128-bit fixed-point number in [-1/2, 1/2). */
+    int64_t th = (int64_t)fhi;
+    if (fhi >> 63)
+        n++;
+    double hi = (double)(th >> 11) * 0x1p-53; /* exact */
+    double lo = (double)(th & 0x7ff) * 0x1p-64 + (double)flo * 0x1p-128;
+    double fl, fh = fast_two_sum(hi, lo, &fl);
+
+    /* times pi/2 */
+    double r = fh * PIO2_HI;
+    double rl = FMA(fh, PIO2_HI, -r) + (fh * PIO2_LO + fl * PIO2_HI);
+    y[0] = r + rl;
+    y[1] = (r - y[0]) + rl;
+    return n;
+}
+
+/* x = n*pi/2 + y[0] + y[1] with |y[0]| <= ~pi/4. x is finite. */
+static int rem_pio2(double x, double *y)
+{
+    double ax = CSHIM_NAME(fabs)(x);
+    if (ax < 0x1.921fb54442d18p+20) {
+        double fn = frintn(x * INV_PIO2);
+        /* fn*PIO2_k are exact (33-bit pieces, |fn| <= 2^20). */
+        double t = x - fn * PIO2_1;
+        double e1, e2;
+        t = two_sum(t, -(fn * PIO2_2), &e1);
+        t = two_sum(t, -(fn * PIO2_3), &e2);
+        double lo = (e1 + e2) - fn * PIO2_3T;
+        y[0] = t + lo;
+        y[1] = (t - y[0]) + lo;
+        return (int)fn;
+    }
+    int n = rem_pio2_large(ax, y);
+    if (x < 0) {
+        y[0] = -y[0];
+        y[1] = -y[1];
+        n = -n;
+    }
+    return n;
+}
+
+double CSHIM_NAME(sin)(double x)
+{
+    uint64_t ax = asuint64(x) & ~SIGN_BIT;
+    double y[2];
+    if (ax <= asuint64(PIO4)) {
+        if (ax < 0x3e50000000000000ull) /* |x| < 2^-26 */
+            return x;
+        return ksin(x, 0.0);
+    }
+    if (ax >= INF_BITS)
+        return x - x;
+    switch (rem_pio2(x, y) & 3) {
+    case 0:
+        return ksin(y[0], y[1]);
+    case 1:
+        return kcos(y[0], y[1]);
+    case 2:
+        return -ksin(y[0], y[1]);
+    default:
+        return -kcos(y[0], y[1]);
+    }
+}
+
+double CSHIM_NAME(cos)(double x)
+{
+    uint64_t ax = asuint64(x) & ~SIGN_BIT;
+    double y[2];
+    if (ax <= asuint64(PIO4)) {
+        if (ax < 0x3e46a09e667f3bcdull) /* |x| < 2^-27 * sqrt(2) */
+            return 1.0;
+        return kcos(x, 0.0);
+    }
+    if (ax >= INF_BITS)
+        return x - x;
+    switch (rem_pio2(x, y) & 3) {
+    case 0:
+        return kcos(y[0], y[1]);
+    case 1:
+        return -ksin(y[0], y[1]);
+    case 2:
+        return -kcos(y[0], y[1]);
+    default:
+        return ksin(y[0], y[1]);
+    }
+}
+
+double CSHIM_NAME(tan)(double x)
+{
+    uint64_t ax = asuint64(x) & ~SIGN_BIT;
+    double y[2];
+    int n;
+    if (ax <= asuint64(PIO4)) {
+        if (ax < 0x3e40000000000000ull) /* |x| < 2^-27 */
+            return x;
+        y[0] = x;
+        y[1] = 0.0;
+        n = 0;
+    } else if (ax >= INF_BITS) {
+        return x - x;
+    } else {
+        n = rem_pio2(x, y);
+    }
+    double sl, sh = ksin_dd(y[0], y[1], &sl);
+    double cl, ch = kcos_dd(y[0], y[1], &cl);
+    return (n & 1) ? -div_dd(ch, cl, sh, sl) : div_dd(sh, sl, ch, cl);
+}
+
+/* ---- inverse trigonometric ---- */
+
+/* atan(x + xl) for 0 <= x <= 1, as hi + *lo. */
+static double atan_reduced(double x, double xl, double *lo)
+{
+    int k = (int)(x * 8.0 + 0.5);
+    double t, tl;
+    if (k == 0) {
+        t = x;
+        tl = xl;
+    } else {
+        /* atan(x) = atan(c) + atan((x - c) / (1 + x*c)), c = k/8 */
+        double c = k * 0.125;
+        double num = x - c; /* exact */
+        double den = FMA(x, c, 1.0);
+        double den_lo = FMA(x, c, 1.0 - den); /* 1 - den is exact */
+        t = num / den;
+        tl = (FMA(-t, den, num) - t * den_lo + xl * (1.0 + c * c) / den) / den;
+    }
+    double t2 = t * t;
+    double p = t * t2 *
+               (ATAN_A1 + t2 * (ATAN_A2 + t2 * (ATAN_A3 + t2 * (ATAN_A4 + t2 * (ATAN_A5 +
+               t2 * (ATAN_A6 + t2 * ATAN_A7))))));
+    double e, hi = two_sum(atan_table[k].hi, t, &e);
+    *lo = e + (atan_table[k].lo + tl * (1.0 - t2) + p);
+    return hi;
+}
+
+/* atan(x + xl) for finite x >= 0, as hi + *lo. */
+static double atan_dd(double x, double xl, double *lo)
+{
+    if (x <= 1.0)
+        return atan_reduced(x, xl, lo);
+    /* atan(x) = pi/2 - atan(1/x) */
+    double inv = 1.0 / x;
+    double invl = (FMA(-inv, x, 1.0) - inv * xl) / x;
+    double l, h = atan_reduced(inv, invl, &l);
+    double e, s = two_sum(PIO2_HI, -h, &e);
+    *lo = e + (PIO2_LO - l);
+    return s;
+}
+
+double CSHIM_NAME(atan)(double x)
+{
+    uint64_t ix = asuint64(x), ax = ix & ~SIGN_BIT;
+    double r;
+    if (ax >= 0x4350000000000000ull) { /* |x| >= 2^54, inf, nan */
+        if (ax > INF_BITS)
+            return x + x;
+        r = PIO2_HI;
+    } else if (ax < 0x3e40000000000000ull) { /* |x| < 2^-27 */
+        return x;
+    } else {
+        double lo, hi = atan_dd(asdouble(ax), 0.0, &lo);
+        r = hi + lo;
+    }
+    return (ix >> 63) ? -r : r;
+}
+
+double CSHIM_NAME(atan2)(double y, double x)
+{
+    uint64_t ix = asuint64(x), iy = asuint64(y);
+    uint64_t ax = ix & ~SIGN_BIT, ay = iy & ~SIGN_BIT;
+    int sx = (int)(ix >> 63), sy = (int)(iy >> 63);
+    double hi, lo;
+
+    if (ax > INF_BITS || ay > INF_BITS)
+        return x + y;
+    if (ay == 0) /* atan2(+-0, x): +-0 for x >= +0, +-pi for x <= -0 */
+        return sx ? (sy ? -PI_HI : PI_HI) : y;
+    if (ax == 0)
+        return sy ? -PIO2_HI : PIO2_HI;
+    if (ax == INF_BITS) {
+        if (ay == INF_BITS)
+            hi = sx ? PI3O4 : PIO4;
+        else
+            hi = sx ? PI_HI : 0.0;
+        return sy ? -hi : hi;
+    }
+    if (ay == INF_BITS)
+        return sy ? -PIO2_HI : PIO2_HI;
+
+    double fx = asdouble(ax), fy = asdouble(ay);
+    int ex = (int)(ax >> 52), ey = (int)(ay >> 52);
+    if (ey - ex > 60) { /* |y/x| > 2^60 */
+        hi = PIO2_HI;
+        lo = PIO2_LO;
+    } else if (ex - ey > 60) { /* |y/x| < 2^-60: atan(q) = q */
+        hi = fy / fx;
+        lo = 0.0;
+    } else {
+        double q = fy / fx;
+        double ql = FMA(-q, fx, fy) / fx;
+        hi = atan_dd(q, ql, &lo);
+    }
+    if (sx) { /* pi - atan(|y/x|) */
+        double e, s = two_sum(PI_HI, -hi, &e);
+        lo = e + (PI_LO - lo);
+        hi = s;
+    }
+    double r = hi + lo;
+    return sy ? -r : r;
+}
+
+/* sqrt(1 - a*a) for 0 <= a < 1, as hi + *lo. */
+static double sqrt_1mx2(double a, double *lo)
+{
+    double d, dl;
+    if (a < 0.5) {
+        double a2 = a * a;
+        double a2l = FMA(a, a, -a2);
+        d = fast_two_sum(1.0, -a2, &dl);
+        dl -= a2l;
+    } else {
+        double u = 1.0 - a; /* exact */
+        double vl, v = two_sum(1.0, a, &vl);
+        d = u * v;
+        dl = FMA(u, v, -d) + u * vl;
+    }
+    double s = fsqrt(d);
+    *lo = (FMA(-s, s, d) + dl) / (2.0 * s);
+    return s;
+}
+
+double CSHIM_NAME(asin)(double x)
+{
+    uint64_t ix = asuint64(x), ax = ix & ~SIGN_BIT;
+    if (ax >= asuint64(1.0)) {
+        if (ax == asuint64(1.0))
+            return (ix >> 63) ? -PIO2_HI : PIO2_HI;
+        return (x - x) / (x - x);
+    }
+    if (ax < 0x3e40000000000000ull) /* |x| < 2^-27 */
+        return x;
+    /* asin(a) = atan(a / sqrt(1 - a^2)) */
+    double a = asdouble(ax);
+    double sl, s = sqrt_1mx2(a, &sl);
+    double q = a / s;
+    double ql = (FMA(-q, s, a) - q * sl) / s;
+    double lo, hi = atan_dd(q, ql, &lo);
+    double r = hi + lo;
+    return (ix >> 63) ? -r : r;
+}
+
+double CSHIM_NAME(acos)(double x)
+{
+    uint64_t ix = asuint64(x), ax = ix & ~SIGN_BIT;
+    if (ax >= asuint64(1.0)) {
+        if (ax == asuint64(1.0))
+            return (ix >> 63) ? PI_HI : 0.0;
+        return (x - x) / (x - x);
+    }
+    if (ax < 0x3c90000000000000ull) /* |x| < 2^-54 */
+        return PIO2_HI;
+    /* acos(a) = atan(sqrt(1 - a^2) / a), acos(-a) = pi - acos(a) */
+    double a = asdouble(ax);
+    double sl, s = sqrt_1mx2(a, &sl);
+    double q = s / a;
+    double ql = (FMA(-q, a, s) + sl) / a;
+    double lo, hi = atan_dd(q, ql, &lo);
+    if (ix >> 63) {
+        double e, t = two_sum(PI_HI, -hi, &e);
+        lo = e + (PI_LO - lo);
+        hi = t;
+    }
+    return hi + lo;
+}
+
+/* ---- hyperbolic ---- */
+
+/* exp(a)/2 = exp(a - ln2), which overflows exactly when the result does.
+ * Inf and NaN pass through. */
+static double exp_halved(double a)
+{
+    double e, hi = two_sum(a, -LN2_DBL, &e);
+    return exp_inline(hi, e - LN2_DBL_LO);
+}
+
+double CSHIM_NAME(sinh)(double x)
+{
+    double a = CSHIM_NAME(fabs)(x);
+    double h = (asuint64(x) >> 63) ? -0.5 : 0.5;
+    if (a < 22.0) {
+        if (a < 0x1p-26)
+            return x;
+        double t = CSHIM_NAME(expm1)(a);
+        if (a < 1.0)
+            return h * (2.0 * t - t * t / (t + 1.0));
+        return h * (t + t / (t + 1.0));
+    }
+    double r = exp_halved(a);
+    return h < 0 ? -r : r;
+}
+
+double CSHIM_NAME(cosh)(double x)
+{
+    double a = CSHIM_NAME(fabs)(x);
+    if (a < 0.6931471805599453) {
+        if (a < 0x1p-26)
+            return 1.0;
+        double t = CSHIM_NAME(expm1)(a);
+        return 1.0 + t * t / (2.0 * (1.0 + t));
+    }
+    if (a < 22.0) {
+        double t = exp_inline(a, 0.0);
+        return 0.5 * (t + 1.0 / t);
+    }
+    return exp_halved(a);
+}
+
+double CSHIM_NAME(tanh)(double x)
+{
+    double a = CSHIM_NAME(fabs)(x), t;
+    if (a > 22.0) {
+        t = 1.0;
+    } else if (a > 0.55) {
+        t = CSHIM_NAME(expm1)(2.0 * a);
+        t = 1.0 - 2.0 / (t + 2.0);
+    } else if (a > 0x1p-28) {
+        t = CSHIM_NAME(expm1)(-2.0 * a);
+        t = -t / (t + 2.0);
+    } else {
+        return x; /* tiny or nan */
+    }
+    return (asuint64(x) >> 63) ? -t : t;
+}
+
+double CSHIM_NAME(asinh)(double x)
+{
+    double a = CSHIM_NAME(fabs)(x), r;
+    if (a >= 0x1p26)
+        r = CSHIM_NAME(log)(a) + LN2_DBL; /* also inf, nan */
+    else if (a >= 2.0)
+        r = CSHIM_NAME(log)(2.0 * a + 1.0 / (fsqrt(a * a + 1.0) + a));
+    else if (a >= 0x1p-26)
+        r = CSHIM_NAME(log1p)(a + a * a / (fsqrt(a * a + 1.0) + 1.0));
+    else
+        return x;
+    return (asuint64(x) >> 63) ? -r : r;
+}
+
+double CSHIM_NAME(acosh)(double x)
+{
+    if (!(x >= 1.0))
+        return (x - x) / (x - x); /* x < 1 or nan */
+    if (x < 2.0) {
+        double t = x - 1.0; /* exact */
+        return CSHIM_NAME(log1p)(t + fsqrt(2.0 * t + t * t));
+    }
+    if (x < 0x1p26)
+        return CSHIM_NAME(log)(2.0 * x - 1.0 / (x + fsqrt(x * x - 1.0)));
+    return CSHIM_NAME(log)(x) + LN2_DBL;
+}
+
+double CSHIM_NAME(atanh)(double x)
+{
+    double a = CSHIM_NAME(fabs)(x), r;
+    if (a < 0x1p-28)
+        return x;
+    if (a < 0.5)
+        r = 0.5 * CSHIM_NAME(log1p)(2.0 * a + 2.0 * a * a / (1.0 - a));
+    else
+        r = 0.5 * CSHIM_NAME(log1p)(2.0 * a / (1.0 - a)); /* a >= 1: inf/nan */
+    return (asuint64(x) >> 63) ? -r : r;
+}
+
+/* ---- roots ---- */
+
+double CSHIM_NAME(cbrt)(double x)
+{
+    uint64_t ix = asuint64(x), sign = ix & SIGN_BIT, ax = ix ^ sign;
+    if (ax >= INF_BITS || ax == 0)
+        return x + x;
+    double a = asdouble(ax), scale = 1.0;
+    if (ax < 0x0010000000000000ull) { /* subnormal */
+        a *= 0x1p54;
+        scale = 0x1p-18;
+    } else if (ax >= 0x7fe0000000000000ull) { /* a + a would overflow */
+        a *= 0x1p-54;
+        scale = 0x1p18;
+    }
+
+    /* ~5-bit guess from dividing the exponent by 3, three Halley steps
+     * (5 -> 15 -> 45 -> 53 bits), then one Newton step on the exact residual
+     * t^3 - a. */
+    double t = asdouble(asuint64(a) / 3 + (0x2a9f7893ull << 32));
+    for (int i = 0; i < 3; i++) {
+        double t3 = t * t * t;
+        t *= (t3 + a + a) / (t3 + t3 + a);
+    }
+    double t2 = t * t;
+    double t2l = FMA(t, t, -t2);
+    double res = FMA(t2, t, -a) + t2l * t;
+    t -= res / (3.0 * t2);
+
+    t *= scale;
+    return sign ? -t : t;
+}
+
+double CSHIM_NAME(hypot)(double x, double y)
+{
+    uint64_t ux = asuint64(x) & ~SIGN_BIT, uy = asuint64(y) & ~SIGN_BIT;
+    if (ux < uy) {
+        uint64_t t = ux;
+        ux = uy;
+        uy = t;
+    }
+    if (ux >= INF_BITS) {
+        if (ux == INF_BITS || uy == INF_BITS)
+            return __builtin_inf();
+        return x + y; /* nan */
+    }
+    double a = asdouble(ux), b = asdouble(uy);
+    if (uy == 0 || (ux >> 52) - (uy >> 52) > 64)
+        return a + b;
+
+    double scale = 1.0;
+    if ((ux >> 52) > 0x3ff + 510) {
+        a *= 0x1p-700;
+        b *= 0x1p-700;
+        scale = 0x1p700;
+    } else if ((uy >> 52) < 0x3ff - 450) {
+        a *= 0x1p700;
+        b *= 0x1p700;
+        scale = 0x1p-700;
+    }
+    /* a^2 + b^2 as hi + lo, then one Newton correction of its sqrt. */
+    double a2 = a * a, a2l = FMA(a, a, -a2);
+    double b2 = b * b, b2l = FMA(b, b, -b2);
+    double sl, s = fast_two_sum(a2, b2, &sl);
+    sl += a2l + b2l;
+    double h = fsqrt(s);
+    h += (FMA(-h, h, s) + sl) / (2.0 * h);
+    return h * scale;
+}
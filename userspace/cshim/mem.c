@@ -0,0 +1,270 @@
+/*
+ * mem.c — memcpy/memmove/memset/memcmp for the freestanding userspace ports.
+ *
+ * Every size class is handled without a byte loop: up to 128 bytes with a few
+ * overlapping 16/8/4-byte accesses, larger blocks with a 16-byte-aligned
+ * destination and 64-byte ldp/stp bodies. Large zero fills use DC ZVA.
+ */
+
+#include "cshim.h"
+
+/* DC ZVA only pays off (and only risks the TCG misroute trap the kernel
+ * emulates in src/exceptions.rs) for fills well past a few cache lines. */
+#define CSHIM_ZVA_MIN 2048
+
+/*
+ * Copy 0..128 bytes. All loads happen before any store, so the result is
+ * correct for overlapping buffers too — memmove relies on this.
+ */
+CS_INLINE void copy_upto128(unsigned char *d, const unsigned char *s, size_t n)
+{
+    if (n <= 16) {
+        if (n >= 8) {
+            uint64_t a = cs_ld64(s), b = cs_ld64(s + n - 8);
+            cs_st64(d, a);
+            cs_st64(d + n - 8, b);
+        } else if (n >= 4) {
+            uint32_t a = cs_ld32(s), b = cs_ld32(s + n - 4);
+            cs_st32(d, a);
+            cs_st32(d + n - 4, b);
+        } else if (n) {
+            /* 1..3 bytes: first, middle and last cover every length. */
+            unsigned char a = s[0], b = s[n >> 1], c = s[n - 1];
+            d[0] = a;
+            d[n >> 1] = b;
+            d[n - 1] = c;
+        }
+        return;
+    }
+    if (n <= 32) {
+        cs_v16 a = cs_ldv(s), b = cs_ldv(s + n - 16);
+        cs_stv(d, a);
+        cs_stv(d + n - 16, b);
+        return;
+    }
+    if (n <= 64) {
+        cs_v16 a = cs_ldv(s), b = cs_ldv(s + 16);
+        cs_v16 c = cs_ldv(s + n - 32), e = cs_ldv(s + n - 16);
+        cs_stv(d, a);
+        cs_stv(d + 16, b);
+        cs_stv(d + n - 32, c);
+        cs_stv(d + n - 16, e);
+        return;
+    }
+    cs_v16 a = cs_ldv(s), b = cs_ldv(s + 16), c = cs_ldv(s + 32), e = cs_ldv(s + 48);
+    cs_v16 f = cs_ldv(s + n - 64), g = cs_ldv(s + n - 48);
+    cs_v16 h = cs_ldv(s + n - 32), i = cs_ldv(s + n - 16);
+    cs_stv(d, a);
+    cs_stv(d + 16, b);
+    cs_stv(d + 32, c);
+    cs_stv(d + 48, e);
+    cs_stv(d + n - 64, f);
+    cs_stv(d + n - 48, g);
+    cs_stv(d + n - 32, h);
+    cs_stv(d + n - 16, i);
+}
+
+/* One 64-byte block, loads before stores (ldp q,q x2 / stp q,q x2). */
+CS_INLINE void copy64(unsigned char *d, const unsigned char *s)
+{
+    cs_v16 a = cs_ldv(s), b = cs_ldv(s + 16), c = cs_ldv(s + 32), e = cs_ldv(s + 48);
+    cs_stv(d, a);
+    cs_stv(d + 16, b);
+    cs_stv(d + 32, c);
+    cs_stv(d + 48, e);
+}
+
+void *CSHIM_NAME(memcpy)(void *restrict dest, const void *restrict src, size_t n)
+{
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+
+    if (n <= 128) {
+        copy_upto128(d, s, n);
+        return dest;
+    }
+
+    /* Unaligned head, then realign the destination to 16 bytes. */
+    size_t skew = 16 - ((uintptr_t)d & 15);
+    cs_stv(d, cs_ldv(s));
+    d += skew;
+    s += skew;
+    n -= skew;
+
+    while (n > 64) {
+        copy64(d, s);
+        d += 64;
+        s += 64;
+        n -= 64;
+    }
+    /* Last 1..64 bytes: one block ending exactly at the end, overlapping
+     * bytes already written (the source is untouched, so that is harmless). */
+    copy64(d + n - 64, s + n - 64);
+    return dest;
+}
+
+void *CSHIM_NAME(memmove)(void *dest, const void *src, size_t n)
+{
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+
+    if (d == s)
+        return dest;
+    if (n <= 128) {
+        copy_upto128(d, s, n);
+        return dest;
+    }
+    /* Disjoint buffers take the memcpy fast path. */
+    if ((uintptr_t)d - (uintptr_t)s >= n && (uintptr_t)s - (uintptr_t)d >= n)
+        return CSHIM_NAME(memcpy)(dest, src, n);
+
+    if (d < s) {
+        /* Forward: each block is read before the (lower) destination of the
+         * same block is written, so unread source bytes are never clobbered. */
+        while (n >= 64) {
+            copy64(d, s);
+            d += 64;
+            s += 64;
+            n -= 64;
+        }
+        copy_upto128(d, s, n);
+    } else {
+        unsigned char *de = d + n;
+        const unsigned char *se = s + n;
+        while (n >= 64) {
+            de -= 64;
+            se -= 64;
+            copy64(de, se);
+            n -= 64;
+        }
+        copy_upto128(d, s, n);
+    }
+    return dest;
+}
+
+#if defined(__aarch64__)
+/* DC ZVA block size in bytes, or 0 when DCZID_EL0.DZP prohibits it. */
+static size_t zva_block_size(void)
+{
+    static size_t cached = (size_t)-1;
+    if (cached == (size_t)-1) {
+        uint64_t dczid;
+        __asm__ volatile("mrs %0, dczid_el0" : "=r"(dczid));
+        cached = (dczid & 16) ? 0 : (size_t)4 << (dczid & 15);
+    }
+    return cached;
+}
+#endif
+
+void *CSHIM_NAME(memset)(void *s, int c, size_t n)
+{
+    unsigned char *d = s;
+    unsigned char b = (unsigned char)c;
+
+    if (n <= 16) {
+        if (n >= 8) {
+            uint64_t v = b * 0x0101010101010101ull;
+            cs_st64(d, v);
+            cs_st64(d + n - 8, v);
+        } else if (n >= 4) {
+            uint32_t v = b * 0x01010101u;
+            cs_st32(d, v);
+            cs_st32(d + n - 4, v);
+        } else if (n) {
+            d[0] = b;
+            d[n >> 1] = b;
+            d[n - 1] = b;
+        }
+        return s;
+    }
+
+    cs_v16 v = (cs_v16){0} + b;
+    if (n <= 32) {
+        cs_stv(d, v);
+        cs_stv(d + n - 16, v);
+        return s;
+    }
+    if (n <= 64) {
+        cs_stv(d, v);
+        cs_stv(d + 16, v);
+        cs_stv(d + n - 32, v);
+        cs_stv(d + n - 16, v);
+        return s;
+    }
+
+    unsigned char *end = d + n;
+    cs_stv(d, v);
+    unsigned char *p = (unsigned char *)(((uintptr_t)d + 16) & ~(uintptr_t)15);
+
+#if defined(__aarch64__)
+    if (b == 0 && n >= CSHIM_ZVA_MIN) {
+        size_t zs = zva_block_size();
+        if (zs >= 16 && zs <= 2048 && n >= 2 * zs) {
+            unsigned char *z = (unsigned char *)(((uintptr_t)p + zs - 1) & ~(uintptr_t)(zs - 1));
+            while (p < z) {
+                cs_stv(p, v);
+                p += 16;
+            }
+            while ((size_t)(end - p) >= zs) {
+                __asm__ volatile("dc zva, %0" : : "r"(p) : "memory");
+                p += zs;
+            }
+        }
+    }
+#endif
+
+    while (end - p > 64) {
+        cs_stv(p, v);
+        cs_stv(p + 16, v);
+        cs_stv(p + 32, v);
+        cs_stv(p + 48, v);
+        p += 64;
+    }
+    cs_stv(end - 64, v);
+    cs_stv(end - 48, v);
+    cs_stv(end - 32, v);
+    cs_stv(end - 16, v);
+    return s;
+}
+
+/* Sign of the first differing byte of two unequal 8-byte words. */
+CS_INLINE int diff64(uint64_t a, uint64_t b)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    a = __builtin_bswap64(a);
+    b = __builtin_bswap64(b);
+#endif
+    return a < b ? -1 : 1;
+}
+
+int CSHIM_NAME(memcmp)(const void *s1, const void *s2, size_t n)
+{
+    const unsigned char *p1 = s1;
+    const unsigned char *p2 = s2;
+
+    while (n >= 16) {
+        uint64_t a0 = cs_ld64(p1), b0 = cs_ld64(p2);
+        uint64_t a1 = cs_ld64(p1 + 8), b1 = cs_ld64(p2 + 8);
+        if ((a0 ^ b0) | (a1 ^ b1))
+            return a0 != b0 ? diff64(a0, b0) : diff64(a1, b1);
+        p1 += 16;
+        p2 += 16;
+        n -= 16;
+    }
+    if (n >= 8) {
+        uint64_t a = cs_ld64(p1), b = cs_ld64(p2);
+        if (a != b)
+            return diff64(a, b);
+        /* Re-check the last 8 bytes, overlapping what was just compared. */
+        a = cs_ld64(p1 + n - 8);
+        b = cs_ld64(p2 + n - 8);
+        return a == b ? 0 : diff64(a, b);
+    }
+    while (n--) {
+        if (*p1 != *p2)
+            return *p1 - *p2;
+        p1++;
+        p2++;
+    }
+    return 0;
+}
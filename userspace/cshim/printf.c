@@ -0,0 +1,618 @@
+/*
+ * printf.c — vsnprintf/snprintf/vsprintf/sprintf for the freestanding
+ * userspace ports; their printf/fprintf wrappers format through these.
+ *
+ * Literal runs are copied up to the next '%' in one go, and a bare %d, %s,
+ * %x or %u (no flags, width, precision or length) skips the spec parser.
+ * Decimal conversion emits two digits per division from a 00..99 table.
+ * Floating point (%f %e %g) is rounded half to even from the exact decimal
+ * expansion (cshim_dtoa_even in dtoa.c). The return value is the length the
+ * full output would have had (C99), whatever `size` is.
+ */
+
+#include "cshim.h"
+#include "dtoa.h"
+
+typedef __builtin_va_list cs_va_list;
+#define cs_va_start(ap, last) __builtin_va_start(ap, last)
+#define cs_va_end(ap) __builtin_va_end(ap)
+#define cs_va_arg(ap, type) __builtin_va_arg(ap, type)
+
+/* Widest integer conversion: 22 octal digits of a 64-bit value */
+#define INT_BUF 24
+
+static const char digit_pairs[200] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hex_lower[16] = "0123456789abcdef";
+static const char hex_upper[16] = "0123456789ABCDEF";
+
+/* Output cursor: writes stop at `end` (room for the NUL), `n` counts everything */
+typedef struct {
+    char *p, *end;
+    size_t n;
+} out_t;
+
+CS_INLINE void put(out_t *o, char c)
+{
+    if (o->p < o->end)
+        *o->p++ = c;
+    o->n++;
+}
+
+CS_INLINE char *copy_bytes(char *d, const char *s, size_t k)
+{
+    while (k >= 8) {
+        cs_st64(d, cs_ld64(s));
+        d += 8;
+        s += 8;
+        k -= 8;
+    }
+    while (k--)
+        *d++ = *s++;
+    return d;
+}
+
+CS_INLINE char *fill_bytes(char *d, char c, size_t k)
+{
+    uint64_t fill = 0x0101010101010101ull * (unsigned char)c;
+    while (k >= 8) {
+        cs_st64(d, fill);
+        d += 8;
+        k -= 8;
+    }
+    while (k--)
+        *d++ = c;
+    return d;
+}
+
+CS_INLINE size_t room(const out_t *o)
+{
+    return (size_t)(o->end - o->p);
+}
+
+CS_INLINE void putn(out_t *o, const char *s, size_t len)
+{
+    size_t r = room(o);
+    o->p = copy_bytes(o->p, s, len < r ? len : r);
+    o->n += len;
+}
+
+static void pad(out_t *o, char c, int count)
+{
+    if (count <= 0)
+        return;
+    size_t r = room(o);
+    o->p = fill_bytes(o->p, c, (size_t)count < r ? (size_t)count : r);
+    o->n += (size_t)count;
+}
+
+/* Decimal digits of v ending at `end`; returns the first digit */
+static char *utoa10(char *end, uint64_t v)
+{
+    char *p = end;
+    while (v >= 100) {
+        unsigned r = (unsigned)(v % 100);
+        v /= 100;
+        p -= 2;
+        cs_st16(p, cs_ld16(digit_pairs + 2 * r));
+    }
+    if (v >= 10) {
+        p -= 2;
+        cs_st16(p, cs_ld16(digit_pairs + 2 * v));
+    } else {
+        *--p = (char)('0' + v);
+    }
+    return p;
+}
+
+static char *utoa16(char *end, uint64_t v, const char *digits)
+{
+    char *p = end;
+    do {
+        *--p = digits[v & 15];
+        v >>= 4;
+    } while (v);
+    return p;
+}
+
+static char *utoa8(char *end, uint64_t v)
+{
+    char *p = end;
+    do {
+        *--p = (char)('0' + (v & 7));
+        v >>= 3;
+    } while (v);
+    return p;
+}
+
+enum { F_LEFT = 1, F_ZERO = 2, F_PLUS = 4, F_SPACE = 8, F_ALT = 16 };
+
+typedef struct {
+    int flags;
+    int width;
+    int prec; /* -1: none */
+} spec_t;
+
+/*
+ * Emit a converted field: sign/prefix, then `body`, padded per the spec.
+ * `zeros` leading zeros go between the prefix and the body (integer
+ * precision); zero padding to the width also lands there.
+ */
+CS_INLINE void emit(out_t *o, const spec_t *sp, const char *prefix, int prefix_len, int zeros, const char *body,
+                 int body_len)
+{
+    int len = prefix_len + zeros + body_len;
+    int fill = sp->width > len ? sp->width - len : 0;
+    size_t total = (size_t)len + (size_t)fill;
+    if (total <= room(o)) {
+        /* The whole field fits: no clipping on the way */
+        char *d = o->p;
+        if (!(sp->flags & (F_LEFT | F_ZERO)))
+            d = fill_bytes(d, ' ', (size_t)fill);
+        d = copy_bytes(d, prefix, (size_t)prefix_len);
+        if ((sp->flags & (F_LEFT | F_ZERO)) == F_ZERO)
+            d = fill_bytes(d, '0', (size_t)fill);
+        d = fill_bytes(d, '0', (size_t)zeros);
+        d = copy_bytes(d, body, (size_t)body_len);
+        if (sp->flags & F_LEFT)
+            d = fill_bytes(d, ' ', (size_t)fill);
+        o->p = d;
+        o->n += total;
+        return;
+    }
+    if (!(sp->flags & F_LEFT) && !(sp->flags & F_ZERO))
+        pad(o, ' ', fill);
+    putn(o, prefix, (size_t)prefix_len);
+    if (!(sp->flags & F_LEFT) && (sp->flags & F_ZERO))
+        pad(o, '0', fill);
+    pad(o, '0', zeros);
+    putn(o, body, (size_t)body_len);
+    if (sp->flags & F_LEFT)
+        pad(o, ' ', fill);
+}
+
+CS_INLINE void fmt_int(out_t *o, spec_t *sp, char conv, uint64_t v, int neg)
+{
+    char buf[INT_BUF];
+    char *end = buf + sizeof(buf);
+    char *p;
+    char prefix[2] = { 0, 0 };
+    int prefix_len = 0;
+
+    if (conv == 'x' || conv == 'X' || conv == 'p')
+        p = utoa16(end, v, conv == 'X' ? hex_upper : hex_lower);
+    else if (conv == 'o')
+        p = utoa8(end, v);
+    else
+        p = utoa10(end, v);
+    int len = (int)(end - p);
+
+    if (sp->prec >= 0) {
+        /* A precision overrides zero padding; precision 0 prints 0 as nothing */
+        sp->flags &= ~F_ZERO;
+        if (sp->prec == 0 && v == 0)
+            len = 0;
+    }
+    int zeros = sp->prec > len ? sp->prec - len : 0;
+
+    if (neg)
+        prefix[prefix_len++] = '-';
+    else if (sp->flags & F_PLUS)
+        prefix[prefix_len++] = '+';
+    else if (sp->flags & F_SPACE)
+        prefix[prefix_len++] = ' ';
+    if (conv == 'p' || ((sp->flags & F_ALT) && v != 0 && (conv == 'x' || conv == 'X'))) {
+        prefix[0] = '0';
+        prefix[1] = conv == 'X' ? 'X' : 'x';
+        prefix_len = 2;
+    } else if ((sp->flags & F_ALT) && conv == 'o' && zeros == 0 && (len == 0 || *p != '0')) {
+        zeros = 1;
+    }
+    emit(o, sp, prefix, prefix_len, zeros, p, len);
+}
+
+/*
+ * A float body from its digits (0.<digits> * 10^decpt, trailing zeros
+ * implied) with `frac` digits after the point: fixed style, or when `e_char`
+ * is set one digit before the point and an exponent of at least two digits.
+ */
+typedef struct {
+    const char *digits;
+    int n, decpt, frac, point;
+    char e_char;
+    int exp;
+} float_body;
+
+static int float_len(const float_body *f)
+{
+    int len = f->point + f->frac;
+    if (f->e_char) {
+        int e = f->exp < 0 ? -f->exp : f->exp;
+        len += 1 + 2 + (e >= 100 ? 3 : 2);
+    } else {
+        len += f->decpt > 0 ? f->decpt : 1;
+    }
+    return len;
+}
+
+/* digits[from..from+count) of the expansion, zeros past the last stored one */
+static void put_digits(out_t *o, const float_body *f, int from, int count)
+{
+    if (count <= 0)
+        return;
+    if (from < 0) {
+        int z = -from < count ? -from : count;
+        pad(o, '0', z);
+        from += z;
+        count -= z;
+    }
+    if (from < f->n) {
+        int k = f->n - from < count ? f->n - from : count;
+        putn(o, f->digits + from, (size_t)k);
+        count -= k;
+    }
+    pad(o, '0', count);
+}
+
+static void put_float(out_t *o, const float_body *f)
+{
+    if (f->e_char) {
+        put(o, f->n ? f->digits[0] : '0');
+        if (f->point)
+            put(o, '.');
+        put_digits(o, f, 1, f->frac);
+        char buf[INT_BUF];
+        char *end = buf + sizeof(buf);
+        char *p = utoa10(end, (uint64_t)(f->exp < 0 ? -f->exp : f->exp));
+        if (end - p < 2)
+            *--p = '0';
+        *--p = f->exp < 0 ? '-' : '+';
+        *--p = f->e_char;
+        putn(o, p, (size_t)(end - p));
+    } else {
+        if (f->decpt > 0)
+            put_digits(o, f, 0, f->decpt);
+        else
+            put(o, '0');
+        if (f->point)
+            put(o, '.');
+        put_digits(o, f, f->decpt, f->frac);
+    }
+}
+
+__attribute__((noinline)) static void fmt_float(out_t *o, spec_t *sp, char conv, double d)
+{
+    /* Every significant digit of a double */
+    char digits[768];
+    char prefix[1] = { 0 };
+    int prefix_len = 0;
+    int upper = conv == 'F' || conv == 'E' || conv == 'G';
+    uint64_t bits;
+
+    __builtin_memcpy(&bits, &d, sizeof(bits));
+    if (bits >> 63)
+        prefix[prefix_len++] = '-';
+    else if (sp->flags & F_PLUS)
+        prefix[prefix_len++] = '+';
+    else if (sp->flags & F_SPACE)
+        prefix[prefix_len++] = ' ';
+    d = __builtin_fabs(d);
+
+    if (d != d || d == __builtin_inf()) {
+        sp->flags &= ~F_ZERO;
+        const char *s = d != d ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+        emit(o, sp, prefix, prefix_len, 0, s, 3);
+        return;
+    }
+
+    int prec = sp->prec < 0 ? 6 : sp->prec;
+    int alt = (sp->flags & F_ALT) != 0;
+    char lc = (char)(conv | 0x20);
+    float_body f = { digits, 0, 0, prec, 0, 0, 0 };
+
+    if (lc == 'f') {
+        f.n = cshim_dtoa_even(d, prec, 1, digits, sizeof(digits), &f.decpt);
+    } else {
+        /* %g keeps P significant digits and picks the style from the
+         * exponent they round to; %e keeps prec + 1 */
+        int n_sig = lc == 'e' ? prec + 1 : (prec == 0 ? 1 : prec);
+        f.n = cshim_dtoa_even(d, n_sig, 0, digits, sizeof(digits), &f.decpt);
+        int exp = f.n ? f.decpt - 1 : 0;
+        if (lc == 'e' || exp < -4 || exp >= n_sig) {
+            f.e_char = upper ? 'E' : 'e';
+            f.exp = exp;
+            f.frac = n_sig - 1;
+            if (lc == 'g' && !alt)
+                f.frac = f.n > 1 ? f.n - 1 : 0;
+        } else {
+            f.decpt = exp + 1;
+            f.frac = n_sig - 1 - exp;
+            if (!alt)
+                f.frac = f.n > f.decpt ? f.n - f.decpt : 0;
+        }
+    }
+    f.point = f.frac > 0 || alt;
+
+    int len = prefix_len + float_len(&f);
+    int fill = sp->width > len ? sp->width - len : 0;
+    if (!(sp->flags & F_LEFT) && !(sp->flags & F_ZERO))
+        pad(o, ' ', fill);
+    putn(o, prefix, (size_t)prefix_len);
+    if (!(sp->flags & F_LEFT) && (sp->flags & F_ZERO))
+        pad(o, '0', fill);
+    put_float(o, &f);
+    if (sp->flags & F_LEFT)
+        pad(o, ' ', fill);
+}
+
+static size_t cstrlen(const char *s, int max)
+{
+    size_t n = 0;
+    if (max < 0) {
+        while (s[n])
+            n++;
+    } else {
+        while (n < (size_t)max && s[n])
+            n++;
+    }
+    return n;
+}
+
+int CSHIM_NAME(vsnprintf)(char *str, size_t size, const char *fmt, cs_va_list ap)
+{
+    char dummy;
+    out_t o;
+    if (size == 0) {
+        /* Count only */
+        o.p = o.end = &dummy;
+    } else {
+        /* sprintf passes an unbounded size: clamp the end to the address space */
+        uintptr_t room = ~(uintptr_t)0 - (uintptr_t)str;
+        o.p = str;
+        o.end = str + (size - 1 < room ? size - 1 : room);
+    }
+    o.n = 0;
+
+    for (;;) {
+        const char *lit = fmt;
+        while (*fmt && *fmt != '%')
+            fmt++;
+        if (fmt != lit)
+            putn(&o, lit, (size_t)(fmt - lit));
+        if (!*fmt)
+            break;
+        fmt++;
+
+        /* Fast path: a bare conversion with no flags, width or length */
+        char c = *fmt;
+        if (c == 'd' || c == 'i') {
+            int v = cs_va_arg(ap, int);
+            char buf[INT_BUF];
+            char *end = buf + sizeof(buf);
+            char *p = utoa10(end, v < 0 ? -(uint64_t)(int64_t)v : (uint64_t)v);
+            if (v < 0)
+                *--p = '-';
+            putn(&o, p, (size_t)(end - p));
+            fmt++;
+            continue;
+        }
+        if (c == 'u' || c == 'x') {
+            unsigned v = cs_va_arg(ap, unsigned);
+            char buf[INT_BUF];
+            char *end = buf + sizeof(buf);
+            char *p = c == 'u' ? utoa10(end, v) : utoa16(end, v, hex_lower);
+            putn(&o, p, (size_t)(end - p));
+            fmt++;
+            continue;
+        }
+        if (c == 's') {
+            const char *s = cs_va_arg(ap, const char *);
+            if (!s)
+                s = "(null)";
+            putn(&o, s, cstrlen(s, -1));
+            fmt++;
+            continue;
+        }
+
+        spec_t sp = { 0, 0, -1 };
+        for (;; fmt++) {
+            if (*fmt == '-')
+                sp.flags |= F_LEFT;
+            else if (*fmt == '0')
+                sp.flags |= F_ZERO;
+            else if (*fmt == '+')
+                sp.flags |= F_PLUS;
+            else if (*fmt == ' ')
+                sp.flags |= F_SPACE;
+            else if (*fmt == '#')
+                sp.flags |= F_ALT;
+            else
+                break;
+        }
+        if (*fmt == '*') {
+            sp.width = cs_va_arg(ap, int);
+            if (sp.width < 0) {
+                sp.flags |= F_LEFT;
+                sp.width = -sp.width;
+            }
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9')
+                sp.width = sp.width * 10 + (*fmt++ - '0');
+        }
+        if (*fmt == '.') {
+            fmt++;
+            sp.prec = 0;
+            if (*fmt == '*') {
+                sp.prec = cs_va_arg(ap, int);
+                if (sp.prec < 0)
+                    sp.prec = -1;
+                fmt++;
+            } else {
+                while (*fmt >= '0' && *fmt <= '9')
+                    sp.prec = sp.prec * 10 + (*fmt++ - '0');
+            }
+        }
+        if (sp.flags & F_LEFT)
+            sp.flags &= ~F_ZERO;
+
+        /* Length: 'H' hh, 'h', 'l', 'q' ll/j, 'z' size_t/ptrdiff_t, 'L' long double */
+        char len = 0;
+        switch (*fmt) {
+        case 'h':
+            len = 'h';
+            if (*++fmt == 'h') {
+                len = 'H';
+                fmt++;
+            }
+            break;
+        case 'l':
+            len = 'l';
+            if (*++fmt == 'l') {
+                len = 'q';
+                fmt++;
+            }
+            break;
+        case 'j':
+        case 'q':
+            len = 'q';
+            fmt++;
+            break;
+        case 'z':
+        case 't':
+            len = 'z';
+            fmt++;
+            break;
+        case 'L':
+            len = 'L';
+            fmt++;
+            break;
+        }
+
+        c = *fmt;
+        switch (c) {
+        case 'd':
+        case 'i': {
+            int64_t v;
+            if (len == 'q')
+                v = cs_va_arg(ap, long long);
+            else if (len == 'l')
+                v = cs_va_arg(ap, long);
+            else if (len == 'z')
+                v = (int64_t)cs_va_arg(ap, __PTRDIFF_TYPE__);
+            else if (len == 'h')
+                v = (short)cs_va_arg(ap, int);
+            else if (len == 'H')
+                v = (signed char)cs_va_arg(ap, int);
+            else
+                v = cs_va_arg(ap, int);
+            fmt_int(&o, &sp, c, v < 0 ? -(uint64_t)v : (uint64_t)v, v < 0);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            uint64_t v;
+            if (len == 'q')
+                v = cs_va_arg(ap, unsigned long long);
+            else if (len == 'l')
+                v = cs_va_arg(ap, unsigned long);
+            else if (len == 'z')
+                v = cs_va_arg(ap, size_t);
+            else if (len == 'h')
+                v = (unsigned short)cs_va_arg(ap, unsigned);
+            else if (len == 'H')
+                v = (unsigned char)cs_va_arg(ap, unsigned);
+            else
+                v = cs_va_arg(ap, unsigned);
+            sp.flags &= ~(F_PLUS | F_SPACE);
+            fmt_int(&o, &sp, c, v, 0);
+            break;
+        }
+        case 'p':
+            sp.flags &= ~(F_PLUS | F_SPACE);
+            fmt_int(&o, &sp, 'p', (uint64_t)(uintptr_t)cs_va_arg(ap, void *), 0);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G': {
+            double d = len == 'L' ? (double)cs_va_arg(ap, long double) : cs_va_arg(ap, double);
+            fmt_float(&o, &sp, c, d);
+            break;
+        }
+        case 's': {
+            const char *s = cs_va_arg(ap, const char *);
+            if (!s)
+                s = "(null)";
+            sp.flags &= ~F_ZERO;
+            emit(&o, &sp, "", 0, 0, s, (int)cstrlen(s, sp.prec));
+            break;
+        }
+        case 'c': {
+            char ch = (char)cs_va_arg(ap, int);
+            sp.flags &= ~F_ZERO;
+            emit(&o, &sp, "", 0, 0, &ch, 1);
+            break;
+        }
+        case 'n': {
+            void *ptr = cs_va_arg(ap, void *);
+            if (len == 'q' || len == 'l' || len == 'z')
+                *(int64_t *)ptr = (int64_t)o.n;
+            else if (len == 'h')
+                *(short *)ptr = (short)o.n;
+            else if (len == 'H')
+                *(signed char *)ptr = (signed char)o.n;
+            else
+                *(int *)ptr = (int)o.n;
+            break;
+        }
+        case '%':
+            put(&o, '%');
+            break;
+        case '\0':
+            /* Lone '%' at the end of the format */
+            fmt--;
+            break;
+        default:
+            /* Unknown conversion: print it as written */
+            put(&o, '%');
+            put(&o, c);
+            break;
+        }
+        fmt++;
+    }
+
+    if (size)
+        *o.p = '\0';
+    return (int)o.n;
+}
+
+int CSHIM_NAME(vsprintf)(char *str, const char *fmt, cs_va_list ap)
+{
+    return CSHIM_NAME(vsnprintf)(str, ~(size_t)0, fmt, ap);
+}
+
+int CSHIM_NAME(snprintf)(char *str, size_t size, const char *fmt, ...)
+{
+    cs_va_list ap;
+    cs_va_start(ap, fmt);
+    int n = CSHIM_NAME(vsnprintf)(str, size, fmt, ap);
+    cs_va_end(ap);
+    return n;
+}
+
+int CSHIM_NAME(sprintf)(char *str, const char *fmt, ...)
+{
+    cs_va_list ap;
+    cs_va_start(ap, fmt);
+    int n = CSHIM_NAME(vsnprintf)(str, ~(size_t)0, fmt, ap);
+    cs_va_end(ap);
+    return n;
+}
@@ -0,0 +1,328 @@
+/*
+ * qsort.c — pattern-defeating quicksort (Orson Peters' pdqsort) for the
+ * freestanding userspace ports.
+ *
+ * O(n log n) worst case: median-of-3 (ninther above 128 elements) pivots,
+ * insertion sort below 24, pivot shuffling on unbalanced partitions and a
+ * heapsort fallback once too many of them occur. Runs of equal keys are
+ * collapsed by partitioning equal elements to the left, and already-sorted
+ * inputs finish in linear time via a bounded partial insertion sort.
+ *
+ * Elements only ever move by swapping in place, so there is no temporary
+ * element buffer and no element-size limit.
+ */
+
+#include "cshim.h"
+
+#define INSERTION_SORT_THRESHOLD 24
+#define NINTHER_THRESHOLD 128
+#define PARTIAL_INSERTION_SORT_LIMIT 8
+
+typedef int (*cmp_fn)(const void *, const void *);
+typedef void (*swap_fn)(unsigned char *, unsigned char *, size_t);
+
+typedef struct {
+    size_t es;
+    cmp_fn cmp;
+    swap_fn swap;
+} sort_ctx;
+
+/* Swap kernels: the element sizes qsort callers almost always use get a
+ * fixed-width path, everything else goes 8 bytes at a time. */
+static void swap4(unsigned char *a, unsigned char *b, size_t es)
+{
+    (void)es;
+    uint32_t t = cs_ld32(a);
+    cs_st32(a, cs_ld32(b));
+    cs_st32(b, t);
+}
+
+static void swap8(unsigned char *a, unsigned char *b, size_t es)
+{
+    (void)es;
+    uint64_t t = cs_ld64(a);
+    cs_st64(a, cs_ld64(b));
+    cs_st64(b, t);
+}
+
+static void swap16(unsigned char *a, unsigned char *b, size_t es)
+{
+    (void)es;
+    cs_v16 t = cs_ldv(a);
+    cs_stv(a, cs_ldv(b));
+    cs_stv(b, t);
+}
+
+static void swap_any(unsigned char *a, unsigned char *b, size_t es)
+{
+    while (es >= 8) {
+        uint64_t t = cs_ld64(a);
+        cs_st64(a, cs_ld64(b));
+        cs_st64(b, t);
+        a += 8;
+        b += 8;
+        es -= 8;
+    }
+    while (es--) {
+        unsigned char t = *a;
+        *a++ = *b;
+        *b++ = t;
+    }
+}
+
+#define EL(base, i) ((base) + (i) * c->es)
+#define LESS(a, b) (c->cmp((a), (b)) < 0)
+#define SWAP(a, b) c->swap((a), (b), c->es)
+
+static void insertion_sort(unsigned char *base, size_t n, const sort_ctx *c)
+{
+    for (size_t i = 1; i < n; i++) {
+        for (size_t j = i; j > 0 && LESS(EL(base, j), EL(base, j - 1)); j--)
+            SWAP(EL(base, j), EL(base, j - 1));
+    }
+}
+
+/*
+ * Insertion sort that gives up after PARTIAL_INSERTION_SORT_LIMIT element
+ * moves. Returns 1 when the range ended up sorted.
+ */
+static int partial_insertion_sort(unsigned char *base, size_t n, const sort_ctx *c)
+{
+    size_t moves = 0;
+    for (size_t i = 1; i < n; i++) {
+        size_t j = i;
+        while (j > 0 && LESS(EL(base, j), EL(base, j - 1))) {
+            SWAP(EL(base, j), EL(base, j - 1));
+            j--;
+        }
+        moves += i - j;
+        if (moves > PARTIAL_INSERTION_SORT_LIMIT)
+            return 0;
+    }
+    return 1;
+}
+
+static void sift_down(unsigned char *base, size_t root, size_t n, const sort_ctx *c)
+{
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n)
+            return;
+        if (child + 1 < n && LESS(EL(base, child), EL(base, child + 1)))
+            child++;
+        if (!LESS(EL(base, root), EL(base, child)))
+            return;
+        SWAP(EL(base, root), EL(base, child));
+        root = child;
+    }
+}
+
+static void heap_sort(unsigned char *base, size_t n, const sort_ctx *c)
+{
+    for (size_t i = n / 2; i-- > 0;)
+        sift_down(base, i, n, c);
+    for (size_t end = n - 1; end > 0; end--) {
+        SWAP(EL(base, 0), EL(base, end));
+        sift_down(base, 0, end, c);
+    }
+}
+
+/* Order *a <= *b <= *c by at most three swaps. */
+static void sort3(unsigned char *a, unsigned char *b, unsigned char *d, const sort_ctx *c)
+{
+    if (LESS(b, a))
+        SWAP(a, b);
+    if (LESS(d, b))
+        SWAP(b, d);
+    if (LESS(b, a))
+        SWAP(a, b);
+}
+
+/*
+ * Partition around the pivot at base[0]: elements < pivot to the left, the
+ * rest to the right. Returns the pivot's final index and sets *already when
+ * no element had to move. base[0] stays put until the final swap, so it is
+ * compared in place instead of copied out.
+ */
+static size_t partition_right(unsigned char *base, size_t n, int *already, const sort_ctx *c)
+{
+    unsigned char *pivot = base;
+    unsigned char *first = base;
+    unsigned char *last = EL(base, n);
+
+    /* base[n-1] >= pivot (median selection), so this scan is bounded. */
+    do
+        first += c->es;
+    while (LESS(first, pivot));
+
+    if (first - c->es == base) {
+        while (first < last) {
+            last -= c->es;
+            if (LESS(last, pivot))
+                break;
+        }
+    } else {
+        /* Some element in (base, first) is < pivot: bounded as well. */
+        do
+            last -= c->es;
+        while (!LESS(last, pivot));
+    }
+
+    *already = first >= last;
+    while (first < last) {
+        SWAP(first, last);
+        do
+            first += c->es;
+        while (LESS(first, pivot));
+        do
+            last -= c->es;
+        while (!LESS(last, pivot));
+    }
+
+    unsigned char *pos = first - c->es;
+    if (pos != base)
+        SWAP(base, pos);
+    return (size_t)(pos - base) / c->es;
+}
+
+/*
+ * Partition with elements equal to the pivot going left. Used when the pivot
+ * equals the element just before this range, i.e. the range starts with a run
+ * of keys that are all in their final position once grouped.
+ */
+static size_t partition_left(unsigned char *base, size_t n, const sort_ctx *c)
+{
+    unsigned char *pivot = base;
+    unsigned char *first = base;
+    unsigned char *last = EL(base, n);
+
+    do
+        last -= c->es;
+    while (LESS(pivot, last));
+
+    if (last + c->es == EL(base, n)) {
+        while (first < last) {
+            first += c->es;
+            if (LESS(pivot, first))
+                break;
+        }
+    } else {
+        do
+            first += c->es;
+        while (!LESS(pivot, first));
+    }
+
+    while (first < last) {
+        SWAP(first, last);
+        do
+            last -= c->es;
+        while (LESS(pivot, last));
+        do
+            first += c->es;
+        while (!LESS(pivot, first));
+    }
+
+    if (last != base)
+        SWAP(base, last);
+    return (size_t)(last - base) / c->es;
+}
+
+static void pdq_loop(unsigned char *base, size_t n, int bad_allowed, int leftmost,
+                     const sort_ctx *c)
+{
+    for (;;) {
+        if (n < INSERTION_SORT_THRESHOLD) {
+            insertion_sort(base, n, c);
+            return;
+        }
+
+        /* Move the median (of 3, or the ninther) to base[0]. */
+        size_t s2 = n / 2;
+        if (n > NINTHER_THRESHOLD) {
+            sort3(EL(base, 0), EL(base, s2), EL(base, n - 1), c);
+            sort3(EL(base, 1), EL(base, s2 - 1), EL(base, n - 2), c);
+            sort3(EL(base, 2), EL(base, s2 + 1), EL(base, n - 3), c);
+            sort3(EL(base, s2 - 1), EL(base, s2), EL(base, s2 + 1), c);
+            SWAP(EL(base, 0), EL(base, s2));
+        } else {
+            sort3(EL(base, s2), EL(base, 0), EL(base, n - 1), c);
+        }
+
+        /* base[-1] is the pivot of an enclosing partition and <= everything
+         * here. If it equals our pivot, group the equal keys and skip them. */
+        if (!leftmost && !LESS(base - c->es, base)) {
+            size_t p = partition_left(base, n, c);
+            base = EL(base, p + 1);
+            n -= p + 1;
+            continue;
+        }
+
+        int already;
+        size_t p = partition_right(base, n, &already, c);
+        size_t ls = p, rs = n - p - 1;
+        unsigned char *right = EL(base, p + 1);
+
+        if (ls < n / 8 || rs < n / 8) {
+            /* Unbalanced: a bad pivot pattern. Fall back to heapsort if this
+             * keeps happening, otherwise break the pattern up. */
+            if (--bad_allowed == 0) {
+                heap_sort(base, n, c);
+                return;
+            }
+            if (ls >= INSERTION_SORT_THRESHOLD) {
+                SWAP(EL(base, 0), EL(base, ls / 4));
+                SWAP(EL(base, p - 1), EL(base, p - ls / 4));
+                if (ls > NINTHER_THRESHOLD) {
+                    SWAP(EL(base, 1), EL(base, ls / 4 + 1));
+                    SWAP(EL(base, 2), EL(base, ls / 4 + 2));
+                    SWAP(EL(base, p - 2), EL(base, p - (ls / 4 + 1)));
+                    SWAP(EL(base, p - 3), EL(base, p - (ls / 4 + 2)));
+                }
+            }
+            if (rs >= INSERTION_SORT_THRESHOLD) {
+                SWAP(EL(right, 0), EL(right, rs / 4));
+                SWAP(EL(right, rs - 1), EL(right, rs - rs / 4));
+                if (rs > NINTHER_THRESHOLD) {
+                    SWAP(EL(right, 1), EL(right, rs / 4 + 1));
+                    SWAP(EL(right, 2), EL(right, rs / 4 + 2));
+                    SWAP(EL(right, rs - 2), EL(right, rs - (rs / 4 + 1)));
+                    SWAP(EL(right, rs - 3), EL(right, rs - (rs / 4 + 2)));
+                }
+            }
+        } else if (already && partial_insertion_sort(base, ls, c) &&
+                   partial_insertion_sort(right, rs, c)) {
+            /* Input was (nearly) sorted: done in linear time. */
+            return;
+        }
+
+        /* Recurse into the smaller side, loop on the larger: O(log n) stack. */
+        if (ls < rs) {
+            pdq_loop(base, ls, bad_allowed, leftmost, c);
+            base = right;
+            n = rs;
+            leftmost = 0;
+        } else {
+            pdq_loop(right, rs, bad_allowed, 0, c);
+            n = ls;
+        }
+    }
+}
+
+void CSHIM_NAME(qsort)(void *base, size_t nmemb, size_t size,
+                       int (*compar)(const void *, const void *))
+{
+    if (nmemb < 2 || size == 0)
+        return;
+
+    sort_ctx ctx = { size, compar, swap_any };
+    if (size == 4)
+        ctx.swap = swap4;
+    else if (size == 8)
+        ctx.swap = swap8;
+    else if (size == 16)
+        ctx.swap = swap16;
+
+    /* log2(n) unbalanced partitions before switching to heapsort. */
+    int bad_allowed = 64 - __builtin_clzll((unsigned long long)nmemb);
+    pdq_loop(base, nmemb, bad_allowed, 1, &ctx);
+}
@@ -0,0 +1,344 @@
+/*
+ * string.c — strlen/strchr/strrchr/memchr/strcmp/strncmp/strstr/memmem/strspn/
+ * strcspn for the freestanding userspace ports.
+ *
+ * Scanners step 16 bytes at a time over naturally aligned blocks: the first
+ * load is rounded down to a 16-byte boundary and the lanes before the string
+ * are masked off, so no load ever crosses into a page the string does not
+ * touch. Matches come out as a byte-lane mask (cshim.h).
+ */
+
+#include "cshim.h"
+
+CS_INLINE const unsigned char *align16(const void *p)
+{
+    return (const unsigned char *)((uintptr_t)p & ~(uintptr_t)15);
+}
+
+CS_INLINE cs_v16a ld_aligned(const unsigned char *p)
+{
+    return *(const cs_v16a *)p;
+}
+
+CS_INLINE cs_mask lanes_eq(cs_v16a v, unsigned char c)
+{
+    return cs_mask_of((cs_v16)(v == c));
+}
+
+CS_INLINE cs_mask lanes_eq2(cs_v16a v, unsigned char a, unsigned char b)
+{
+    return cs_mask_of((cs_v16)((v == a) | (v == b)));
+}
+
+size_t CSHIM_NAME(strlen)(const char *s)
+{
+    const unsigned char *p = align16(s);
+    cs_mask m = cs_mask_from(lanes_eq(ld_aligned(p), 0), (uintptr_t)s & 15);
+    while (!cs_mask_any(m)) {
+        p += 16;
+        m = lanes_eq(ld_aligned(p), 0);
+    }
+    return (size_t)(p + cs_mask_first(m) - (const unsigned char *)s);
+}
+
+/* First occurrence of ch (non-zero) or of the terminator, whichever is first. */
+static const unsigned char *chr_or_nul(const char *s, unsigned char ch)
+{
+    const unsigned char *p = align16(s);
+    cs_mask m = cs_mask_from(lanes_eq2(ld_aligned(p), ch, 0), (uintptr_t)s & 15);
+    while (!cs_mask_any(m)) {
+        p += 16;
+        m = lanes_eq2(ld_aligned(p), ch, 0);
+    }
+    return p + cs_mask_first(m);
+}
+
+char *CSHIM_NAME(strchr)(const char *s, int c)
+{
+    unsigned char ch = (unsigned char)c;
+    if (ch == 0)
+        return (char *)s + CSHIM_NAME(strlen)(s);
+    const unsigned char *p = chr_or_nul(s, ch);
+    return *p == ch ? (char *)p : 0;
+}
+
+char *CSHIM_NAME(strrchr)(const char *s, int c)
+{
+    unsigned char ch = (unsigned char)c;
+    if (ch == 0)
+        return (char *)s + CSHIM_NAME(strlen)(s);
+
+    const unsigned char *p = align16(s);
+    const unsigned char *last = 0;
+    unsigned from = (uintptr_t)s & 15;
+    for (;;) {
+        cs_v16a v = ld_aligned(p);
+        cs_mask hit = cs_mask_from(lanes_eq(v, ch), from);
+        cs_mask nul = cs_mask_from(lanes_eq(v, 0), from);
+        if (cs_mask_any(nul)) {
+            hit = cs_mask_upto(hit, cs_mask_first(nul));
+            if (cs_mask_any(hit))
+                last = p + cs_mask_last(hit);
+            return (char *)last;
+        }
+        if (cs_mask_any(hit))
+            last = p + cs_mask_last(hit);
+        p += 16;
+        from = 0;
+    }
+}
+
+void *CSHIM_NAME(memchr)(const void *s, int c, size_t n)
+{
+    unsigned char ch = (unsigned char)c;
+    if (n == 0)
+        return 0;
+
+    /* Callers may pass SIZE_MAX as "unbounded"; clamp instead of wrapping. */
+    if (n > (uintptr_t)-1 - (uintptr_t)s)
+        n = (uintptr_t)-1 - (uintptr_t)s;
+    const unsigned char *end = (const unsigned char *)s + n; /* one past the last byte */
+    const unsigned char *p = align16(s);
+    cs_mask m = cs_mask_from(lanes_eq(ld_aligned(p), ch), (uintptr_t)s & 15);
+    for (;;) {
+        /* Lanes past `end` in the final block are ignored; the aligned load
+         * itself stays inside the block (and page) holding the last byte. */
+        if ((size_t)(end - p) <= 16) {
+            m = cs_mask_upto(m, (unsigned)(end - p - 1));
+            return cs_mask_any(m) ? (void *)(p + cs_mask_first(m)) : 0;
+        }
+        if (cs_mask_any(m))
+            return (void *)(p + cs_mask_first(m));
+        p += 16;
+        m = lanes_eq(ld_aligned(p), ch);
+    }
+}
+
+/*
+ * strcmp/strncmp: the two strings are rarely aligned alike, so blocks are
+ * loaded unaligned, 16 bytes of each at a time, whenever neither load
+ * reaches into the next page; near a page edge they step byte by byte
+ * until both are clear of it. A block stops the compare at its first
+ * differing or terminating lane.
+ */
+CS_INLINE int in_page16(const unsigned char *p)
+{
+    return ((uintptr_t)p & 4095) <= 4096 - 16;
+}
+
+CS_INLINE cs_mask lanes_diff_or_nul(const unsigned char *a, const unsigned char *b)
+{
+    cs_v16 va = cs_ldv(a), vb = cs_ldv(b);
+    return cs_mask_of((cs_v16)((va != vb) | (va == 0)));
+}
+
+int CSHIM_NAME(strcmp)(const char *s1, const char *s2)
+{
+    const unsigned char *a = (const unsigned char *)s1;
+    const unsigned char *b = (const unsigned char *)s2;
+    for (;;) {
+        if (in_page16(a) && in_page16(b)) {
+            cs_mask m = lanes_diff_or_nul(a, b);
+            if (cs_mask_any(m)) {
+                unsigned i = cs_mask_first(m);
+                return a[i] - b[i];
+            }
+            a += 16;
+            b += 16;
+        } else {
+            if (*a != *b || !*a)
+                return *a - *b;
+            a++;
+            b++;
+        }
+    }
+}
+
+int CSHIM_NAME(strncmp)(const char *s1, const char *s2, size_t n)
+{
+    const unsigned char *a = (const unsigned char *)s1;
+    const unsigned char *b = (const unsigned char *)s2;
+    while (n) {
+        if (n >= 16 && in_page16(a) && in_page16(b)) {
+            cs_mask m = lanes_diff_or_nul(a, b);
+            if (cs_mask_any(m)) {
+                unsigned i = cs_mask_first(m);
+                return a[i] - b[i];
+            }
+            a += 16;
+            b += 16;
+            n -= 16;
+        } else {
+            if (*a != *b || !*a)
+                return *a - *b;
+            a++;
+            b++;
+            n--;
+        }
+    }
+    return 0;
+}
+
+/* 256-bit byte-class bitmap for strspn/strcspn. */
+typedef struct {
+    uint64_t w[4];
+} byteset;
+
+CS_INLINE void byteset_build(byteset *set, const unsigned char *chars)
+{
+    set->w[0] = set->w[1] = set->w[2] = set->w[3] = 0;
+    for (; *chars; chars++)
+        set->w[*chars >> 6] |= 1ull << (*chars & 63);
+}
+
+CS_INLINE int byteset_has(const byteset *set, unsigned char c)
+{
+    return (set->w[c >> 6] >> (c & 63)) & 1;
+}
+
+size_t CSHIM_NAME(strspn)(const char *s, const char *accept)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    const unsigned char *a = (const unsigned char *)accept;
+
+    if (!a[0])
+        return 0;
+    if (!a[1]) {
+        while (*p == a[0])
+            p++;
+        return (size_t)(p - (const unsigned char *)s);
+    }
+    byteset set;
+    byteset_build(&set, a);
+    /* NUL is never in the set, so the loop stops at the terminator. */
+    while (byteset_has(&set, *p))
+        p++;
+    return (size_t)(p - (const unsigned char *)s);
+}
+
+size_t CSHIM_NAME(strcspn)(const char *s, const char *reject)
+{
+    const unsigned char *r = (const unsigned char *)reject;
+
+    if (!r[0])
+        return CSHIM_NAME(strlen)(s);
+    if (!r[1])
+        return (size_t)(chr_or_nul(s, r[0]) - (const unsigned char *)s);
+    byteset set;
+    byteset_build(&set, r);
+    set.w[0] |= 1; /* stop at the terminator too */
+    const unsigned char *p = (const unsigned char *)s;
+    while (!byteset_has(&set, *p))
+        p++;
+    return (size_t)(p - (const unsigned char *)s);
+}
+
+/*
+ * strstr: vector prefilter on the needle's first two bytes, then a byte
+ * compare at each candidate. The compare stops at the haystack terminator on
+ * its own (a NUL never equals a needle byte), so the haystack length is never
+ * needed up front and an early match costs nothing extra.
+ */
+char *CSHIM_NAME(strstr)(const char *haystack, const char *needle)
+{
+    const unsigned char *n = (const unsigned char *)needle;
+    unsigned char first = n[0], second;
+
+    if (!first)
+        return (char *)haystack;
+    second = n[1];
+    if (!second)
+        return CSHIM_NAME(strchr)(haystack, first);
+
+    const unsigned char *p = align16(haystack);
+    unsigned from = (uintptr_t)haystack & 15;
+    for (;;) {
+        cs_v16a v = ld_aligned(p);
+        cs_mask nul = cs_mask_from(lanes_eq(v, 0), from);
+        cs_mask cand;
+        if (!cs_mask_any(nul)) {
+            /* No terminator in this block, so byte p + 16 is still part of
+             * the string and the shifted (unaligned) load is safe. */
+            cs_v16 next = cs_ldv(p + 1);
+            cand = cs_mask_of((cs_v16)((v == first) & (next == second)));
+        } else {
+            cand = cs_mask_upto(lanes_eq(v, first), cs_mask_first(nul));
+        }
+        cand = cs_mask_from(cand, from);
+
+        while (cs_mask_any(cand)) {
+            unsigned lane = cs_mask_first(cand);
+            const unsigned char *h = p + lane;
+            size_t i = 1;
+            while (n[i] && h[i] == n[i])
+                i++;
+            if (!n[i])
+                return (char *)h;
+            /* The haystack ended inside this candidate: nothing can match. */
+            if (!h[i])
+                return 0;
+            if (lane == 15)
+                break;
+            cand = cs_mask_from(cand, lane + 1);
+        }
+        if (cs_mask_any(nul))
+            return 0;
+        p += 16;
+        from = 0;
+    }
+}
+
+/*
+ * memmem: the strstr prefilter over a counted haystack. Candidates stop at
+ * the last position where the whole needle still fits, and the shifted load
+ * for the second byte is only used while byte p + 16 is inside the haystack.
+ */
+void *CSHIM_NAME(memmem)(const void *haystack, size_t hlen,
+                         const void *needle, size_t nlen)
+{
+    const unsigned char *hay = (const unsigned char *)haystack;
+    const unsigned char *n = (const unsigned char *)needle;
+
+    if (nlen == 0)
+        return (void *)hay;
+    if (nlen > hlen)
+        return 0;
+    if (nlen == 1)
+        return CSHIM_NAME(memchr)(hay, n[0], hlen);
+
+    const unsigned char *end = hay + hlen;
+    const unsigned char *last = end - nlen; /* last start that fits */
+    unsigned char first = n[0], second = n[1];
+    const unsigned char *p = align16(hay);
+    unsigned from = (uintptr_t)hay & 15;
+    for (;;) {
+        cs_v16a v = ld_aligned(p);
+        cs_mask cand;
+        if (end - p > 16) {
+            cs_v16 next = cs_ldv(p + 1);
+            cand = cs_mask_of((cs_v16)((v == first) & (next == second)));
+        } else {
+            cand = lanes_eq(v, first);
+        }
+        cand = cs_mask_from(cand, from);
+        if (last - p < 16)
+            cand = cs_mask_upto(cand, (unsigned)(last - p));
+
+        while (cs_mask_any(cand)) {
+            unsigned lane = cs_mask_first(cand);
+            const unsigned char *h = p + lane;
+            size_t i = 1;
+            while (i < nlen && h[i] == n[i])
+                i++;
+            if (i == nlen)
+                return (void *)h;
+            if (lane == 15)
+                break;
+            cand = cs_mask_from(cand, lane + 1);
+        }
+        p += 16;
+        from = 0;
+        if (p > last)
+            return 0;
+    }
+}
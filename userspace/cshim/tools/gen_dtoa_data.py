@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Generate cshim/dtoa_data.h: the 128-bit powers of ten behind dtoa.c.
+
+Exact integer arithmetic only, so the output is reproducible anywhere:
+
+    python3 tools/gen_dtoa_data.py > dtoa_data.h
+"""
+
+POW10_MIN = -342  # below this, any 64-bit significand rounds to zero
+POW10_MAX = 324   # shortest output for the smallest subnormal needs 10^324
+
+
+def eisel_lemire_entry(q):
+    """10^q normalized to [2^127, 2^128), rounded as in fast_float's table:
+    truncated for q >= 0, truncated-plus-one for q < 0."""
+    if q >= 0:
+        p = 5 ** q
+        while p < 1 << 127:
+            p <<= 1
+        while p >= 1 << 128:
+            p >>= 1
+        return p
+    p5 = 5 ** -q
+    z = p5.bit_length() if p5 & (p5 - 1) else p5.bit_length() - 1
+    if q >= -27:
+        return (1 << (z + 127)) // p5 + 1
+    c = (1 << (2 * z + 128)) // p5 + 1
+    while c >= 1 << 128:
+        c >>= 1
+    return c
+
+
+def ceil_entry(q):
+    """10^q normalized to [2^127, 2^128), rounded up (exact when it fits)."""
+    if q >= 0:
+        num, den = 10 ** q, 1
+    else:
+        num, den = 1, 10 ** -q
+    e = 127 - (num.bit_length() - den.bit_length())
+    while True:
+        n, d = (num << e, den) if e >= 0 else (num, den << -e)
+        if n >= d << 128:
+            e -= 1
+        elif n < d << 127:
+            e += 1
+        else:
+            return -(-n // d)
+
+
+def ceil_adjust(q):
+    """What dtoa.c adds to an entry to get ceil_entry(q)."""
+    return 1 if q > 55 or q < -27 else 0
+
+
+def main():
+    out = []
+    w = out.append
+    w("/*")
+    w(" * dtoa_data.h — powers of ten for dtoa.c.")
+    w(" * Generated by tools/gen_dtoa_data.py; do not edit by hand.")
+    w(" */")
+    w("#ifndef CSHIM_DTOA_DATA_H")
+    w("#define CSHIM_DTOA_DATA_H")
+    w("")
+    w("#define POW10_MIN (%d)" % POW10_MIN)
+    w("#define POW10_MAX %d" % POW10_MAX)
+    w("")
+    w("/*")
+    w(" * 10^q scaled into [2^127, 2^128) as { high, low } 64-bit halves, for")
+    w(" * q = POW10_MIN..POW10_MAX. Rounded as Eisel-Lemire parsing requires")
+    w(" * (truncated for q >= 0, truncated plus one for q < 0); adding 1 when")
+    w(" * q > 55 or q < -27 gives the rounded-up value shortest printing needs.")
+    w(" */")
+    w("static const uint64_t pow10_128[%d][2] = {" % (POW10_MAX - POW10_MIN + 1))
+    for q in range(POW10_MIN, POW10_MAX + 1):
+        v = eisel_lemire_entry(q)
+        assert 1 << 127 <= v < 1 << 128
+        assert v + ceil_adjust(q) == ceil_entry(q), q
+        w("    { 0x%016x, 0x%016x }, /* %d */" % (v >> 64, v & (2 ** 64 - 1), q))
+    w("};")
+    w("")
+    w("#endif /* CSHIM_DTOA_DATA_H */")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+"""Generate cshim/math_data.h: the lookup tables and constants behind math.c.
+
+Everything is computed with the standard-library decimal module at ~1600 bits
+and rounded once to double, so the output is reproducible without mpmath:
+
+    python3 tools/gen_math_data.py > math_data.h
+"""
+
+import struct
+from decimal import Decimal as D, getcontext
+
+getcontext().prec = 500
+
+LOG_TABLE_BITS = 7
+EXP_TABLE_BITS = 7
+TWO_OVER_PI_WORDS = 20  # 1280 bits: enough for any exponent up to 1023
+
+
+def bits(f):
+    return struct.unpack("<Q", struct.pack("<d", f))[0]
+
+
+def from_bits(u):
+    return struct.unpack("<d", struct.pack("<Q", u))[0]
+
+
+def dbl(d):
+    """Round a Decimal to the nearest double (float(str) rounds correctly)."""
+    return float(d)
+
+
+def split(d):
+    """(hi, lo) with hi = round(d) and lo = round(d - hi)."""
+    hi = dbl(d)
+    return hi, dbl(d - D(hi))
+
+
+def truncate(f, sig_bits):
+    """Clear all but the top sig_bits significant bits of f."""
+    return from_bits(bits(f) & ~((1 << (53 - sig_bits)) - 1))
+
+
+def split_bits(d, sig_bits):
+    """(hi, lo): hi keeps sig_bits significant bits, so k*hi is exact for small k."""
+    hi = truncate(dbl(d), sig_bits)
+    return hi, dbl(d - D(hi))
+
+
+def atan(x):
+    """atan for 0 <= x <= 1: halve the argument twice, then Taylor."""
+    for _ in range(2):
+        x = x / (1 + (1 + x * x).sqrt())
+    s, term, n, x2 = D(0), x, 1, x * x
+    eps = D(10) ** -(getcontext().prec - 5)
+    while abs(term) > eps:
+        s += term / n
+        term = -term * x2
+        n += 2
+    return 4 * s
+
+
+def pi():
+    return 16 * atan(D(1) / 5) - 4 * atan(D(1) / 239)
+
+
+def h(f):
+    return f.hex() if f != 0 else "0x0p+0"
+
+
+def factorial(n):
+    r = 1
+    for i in range(2, n + 1):
+        r *= i
+    return r
+
+
+def main():
+    PI = pi()
+    LN2 = D(2).ln()
+    out = []
+    w = out.append
+
+    w("/*")
+    w(" * math_data.h — tables and constants for math.c.")
+    w(" * Generated by tools/gen_math_data.py; do not edit by hand.")
+    w(" */")
+    w("#ifndef CSHIM_MATH_DATA_H")
+    w("#define CSHIM_MATH_DATA_H")
+    w("")
+
+    # ---- log ----
+    n = 1 << LOG_TABLE_BITS
+    w("#define LOG_TABLE_BITS %d" % LOG_TABLE_BITS)
+    w("")
+    w("/*")
+    w(" * log: z in [0x1.6p-1, 0x1.6p0) is split into %d subintervals by the top" % n)
+    w(" * %d bits of (bits(z) - bits(0x1.6p-1)). invc ~= 1/c for each subinterval's" % LOG_TABLE_BITS)
+    w(" * midpoint c (exactly 1 for the two touching 1.0), logc = -log(invc) as hi+lo.")
+    w(" */")
+    w("static const struct {")
+    w("    double invc, logc, logctail;")
+    w("} log_table[%d] = {" % n)
+    off = D("0.6875")
+    for i in range(n):
+        # Subintervals below 1.0 are half as wide (exponent -1).
+        if i < 80:
+            lo = off + D(i) / 256
+            c = lo + D(1) / 512
+        else:
+            lo = 1 + D(i - 80) / 128
+            c = lo + D(1) / 256
+        if i in (79, 80):
+            invc = 1.0
+        else:
+            invc = dbl(1 / c)
+        logc = -D(invc).ln()
+        hi, tail = split(logc)
+        w("    { %s, %s, %s }," % (h(invc), h(hi), h(tail)))
+    w("};")
+    w("")
+
+    ln2hi, ln2lo = split_bits(LN2, 42)
+    w("/* ln2 with a 42-bit head: k*LN2_HI is exact for any binary exponent k. */")
+    w("#define LN2_HI %s" % h(ln2hi))
+    w("#define LN2_LO %s" % h(ln2lo))
+    w("")
+    w("/* log1p(r) = r - r^2/2 + r^3*(LOG_C3 + r*LOG_C4 + ... ), |r| <= 2^-7. */")
+    for k in range(3, 11):
+        w("#define LOG_C%d %s" % (k, h(dbl(D((-1) ** (k + 1)) / k))))
+    w("")
+
+    # ---- exp ----
+    n = 1 << EXP_TABLE_BITS
+    w("#define EXP_TABLE_BITS %d" % EXP_TABLE_BITS)
+    w("")
+    w("/* exp: 2^(j/%d) rounded, plus the relative rounding error as tail. */" % n)
+    w("static const struct {")
+    w("    double tail, hi;")
+    w("} exp_table[%d] = {" % n)
+    for j in range(n):
+        v = D(2) ** (D(j) / n)
+        hi = dbl(v)
+        tail = dbl((v - D(hi)) / D(hi))
+        w("    { %s, %s }," % (h(tail), h(hi)))
+    w("};")
+    w("")
+    inv = dbl(n / LN2)
+    hiN, loN = split_bits(LN2 / n, 35)
+    w("#define EXP_INVLN2N %s" % h(inv))
+    w("/* ln2/%d with a 35-bit head: k*EXP_LN2HI_N is exact for |k| < 2^18. */" % n)
+    w("#define EXP_LN2HI_N %s" % h(hiN))
+    w("#define EXP_LN2LO_N %s" % h(loN))
+    w("/* exp(r) - 1 = r + r^2*(EXP_C2 + r*EXP_C3 + ...), |r| <= ln2/%d. */" % (2 * n))
+    for k in range(2, 7):
+        w("#define EXP_C%d %s" % (k, h(dbl(D(1) / factorial(k)))))
+    w("")
+
+    # ---- log2/log10/exp2 scaling ----
+    a, b = split(1 / LN2)
+    w("#define INVLN2_HI %s" % h(a))
+    w("#define INVLN2_LO %s" % h(b))
+    a, b = split(1 / D(10).ln())
+    w("#define INVLN10_HI %s" % h(a))
+    w("#define INVLN10_LO %s" % h(b))
+    a, b = split(LN2)
+    w("#define LN2_DBL %s" % h(a))
+    w("#define LN2_DBL_LO %s" % h(b))
+    w("")
+
+    # ---- trig ----
+    a, b = split(PI / 2)
+    w("#define PIO2_HI %s" % h(a))
+    w("#define PIO2_LO %s" % h(b))
+    a, b = split(PI)
+    w("#define PI_HI %s" % h(a))
+    w("#define PI_LO %s" % h(b))
+    w("#define PIO4 %s" % h(dbl(PI / 4)))
+    w("#define PI3O4 %s" % h(dbl(3 * PI / 4)))
+    w("#define INV_PIO2 %s" % h(dbl(2 / PI)))
+    w("")
+    w("/* pi/2 in 33-bit pieces for Cody-Waite reduction: n*PIO2_k is exact for")
+    w(" * n < 2^20. */")
+    rest = PI / 2
+    for k in (1, 2, 3):
+        p = truncate(dbl(rest), 33)
+        w("#define PIO2_%d %s" % (k, h(p)))
+        rest -= D(p)
+    w("#define PIO2_3T %s" % h(dbl(rest)))
+    w("")
+    w("/* Bits of 2/pi after the binary point, most significant first, for")
+    w(" * Payne-Hanek reduction of huge arguments. */")
+    w("static const uint64_t two_over_pi[%d] = {" % TWO_OVER_PI_WORDS)
+    frac = 2 / PI
+    words = []
+    for _ in range(TWO_OVER_PI_WORDS):
+        frac *= 1 << 64
+        word = int(frac)
+        frac -= word
+        words.append(word)
+    for i in range(0, TWO_OVER_PI_WORDS, 2):
+        w("    " + " ".join("0x%016x," % x for x in words[i:i + 2]))
+    w("};")
+    w("")
+    w("/* Taylor coefficients on |x| <= pi/4: sin = x + x^3*(SIN_S1 + x^2*SIN_S2 ...),")
+    w(" * cos = 1 - x^2/2 + x^4*(COS_C1 + x^2*COS_C2 ...). */")
+    for k in range(1, 9):
+        w("#define SIN_S%d %s" % (k, h(dbl(D((-1) ** k) / factorial(2 * k + 1)))))
+    for k in range(1, 8):
+        w("#define COS_C%d %s" % (k, h(dbl(D((-1) ** (k + 1)) / factorial(2 * k + 2)))))
+    w("")
+    w("/* atan(k/8) as hi+lo, k = 0..8. */")
+    w("static const struct {")
+    w("    double hi, lo;")
+    w("} atan_table[9] = {")
+    for k in range(9):
+        a, b = split(atan(D(k) / 8)) if k else (0.0, 0.0)
+        w("    { %s, %s }," % (h(a), h(b)))
+    w("};")
+    w("/* atan(t) = t + t^3*(ATAN_A1 + t^2*ATAN_A2 ...), |t| <= 1/16. */")
+    for k in range(1, 8):
+        w("#define ATAN_A%d %s" % (k, h(dbl(D((-1) ** k) / (2 * k + 1)))))
+    w("")
+    w("#endif /* CSHIM_MATH_DATA_H */")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
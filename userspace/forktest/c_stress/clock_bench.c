@@ -0,0 +1,218 @@
+/*
+ * clock_bench.c — cost of one clock read, trapping vs the kernel time page.
+ *
+ *   svc        clock_gettime(CLOCK_MONOTONIC) as a raw `svc #0`: what every
+ *              clock read cost before TIME_PAGE_ENABLED
+ *   libc       musl clock_gettime. Akuma has no ELF vDSO, so this is the
+ *              svc path plus musl's wrapper
+ *   timepage   MONOTONIC from the read-only page named by AT_AKUMA_TIMEPAGE:
+ *              seqlock read of CNTFRQ + `mrs cntvct_el0` + two divisions,
+ *              the same code libakuma and rumpuser's clock.rs run
+ *   realtime   the same for CLOCK_REALTIME (page offset + counter)
+ *   cntvct     a bare `mrs cntvct_el0`, the floor
+ *   pmccntr    a bare `mrs pmccntr_el0`, when the kernel grants the cycle
+ *              counter (prctl PR_AKUMA_EL0_COUNTERS via akuma_timing.h)
+ *
+ * Then `agree` interleaves svc and timepage reads and counts how often time
+ * went backwards between them (must be 0: both use the same exact
+ * counter-to-ns split).
+ *
+ * Without the auxv entry (older kernel, TIME_PAGE_ENABLED = false) the
+ * timepage rows are skipped; with EL0VCTEN clear the cntvct row would trap,
+ * so it is only run when the page is present.
+ *
+ * -hist times every svc and timepage call on its own with akt_now() and
+ * prints a log2 latency histogram per method (cshim/akuma_timing.h).
+ *
+ * Static, musl:
+ *   aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -I../../cshim -o clock_bench clock_bench.c
+ *
+ * Usage:
+ *   clock_bench [-iters=1000000] [-hist]
+ *
+ * Output: '#' header lines (kernel release, column names), then one row per
+ * method:
+ *   method iters secs ns_per_call
+ * and a final `agree pairs backwards max_skew_ns` row, then with -hist
+ * the histograms (akt_hist_print format, ns).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/auxv.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "akuma_timing.h"
+
+#define AT_AKUMA_TIMEPAGE 0x414B0001UL
+#define TIME_PAGE_MAGIC 0x50544B41U
+#define TP_REALTIME_VALID 1ULL
+
+/* Mirror of akuma_exec::timepage::TimePage. */
+struct time_page {
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t seq;
+    uint32_t pad;
+    volatile uint64_t cntfrq;
+    volatile uint64_t realtime_off_ns;
+    volatile uint64_t flags;
+};
+
+static const struct time_page *tp;
+static volatile uint64_t sink;
+
+static uint64_t ts_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static uint64_t read_svc(void) {
+    struct timespec ts;
+#ifdef __aarch64__
+    register long x8 __asm__("x8") = SYS_clock_gettime;
+    register long x0 __asm__("x0") = CLOCK_MONOTONIC;
+    register long x1 __asm__("x1") = (long)&ts;
+    __asm__ volatile("svc #0" : "+r"(x0) : "r"(x8), "r"(x1) : "memory");
+#else
+    syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts);
+#endif
+    return ts_ns(&ts);
+}
+
+static uint64_t read_libc(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts_ns(&ts);
+}
+
+static uint64_t cntvct(void) {
+#ifdef __aarch64__
+    uint64_t c;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(c) :: "memory");
+    return c;
+#else
+    return 0;
+#endif
+}
+
+/* The kernel's counter_to_ns: exact, no mult/shift rounding. */
+static uint64_t counter_to_ns(uint64_t cnt, uint64_t freq) {
+    return (cnt / freq) * 1000000000ULL + (cnt % freq) * 1000000000ULL / freq;
+}
+
+static uint64_t read_page(int realtime) {
+    for (;;) {
+        uint32_t seq = tp->seq;
+        if (seq & 1)
+            continue;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t freq = tp->cntfrq, off = tp->realtime_off_ns, flags = tp->flags;
+        uint64_t cnt = cntvct();
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (tp->seq != seq)
+            continue;
+        if (freq == 0 || (realtime && !(flags & TP_REALTIME_VALID)))
+            return 0;
+        return counter_to_ns(cnt, freq) + (realtime ? off : 0);
+    }
+}
+
+static uint64_t read_timepage(void) { return read_page(0); }
+static uint64_t pmccntr(void) { return akt_pmccntr(); }
+static uint64_t read_realtime(void) { return read_page(1); }
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void bench(const char *method, uint64_t (*fn)(void), long iters) {
+    uint64_t acc = 0;
+    double t0 = now_s();
+    for (long i = 0; i < iters; i++)
+        acc += fn();
+    double secs = now_s() - t0;
+    sink = acc;
+    printf("%s %ld %.4f %.1f\n", method, iters, secs, secs * 1e9 / (double)iters);
+    fflush(stdout);
+}
+
+/* Per-call latency of fn, each call bracketed by two akt_now() reads. */
+static void hist(const char *method, uint64_t (*fn)(void), long iters) {
+    struct akt_hist h;
+    uint64_t acc = 0;
+    akt_hist_init(&h);
+    for (long i = 0; i < iters; i++) {
+        akt_u64 t0 = akt_now();
+        acc += fn();
+        akt_hist_add(&h, akt_to_ns(akt_now() - t0));
+    }
+    sink = acc;
+    akt_hist_print(&h, method, printf);
+}
+
+static void agree(long pairs) {
+    long backwards = 0;
+    uint64_t max_skew = 0;
+    for (long i = 0; i < pairs; i++) {
+        uint64_t a = read_svc(), b = read_timepage(), c = read_svc();
+        uint64_t skew = b < a ? a - b : c < b ? b - c : 0;
+        if (skew) {
+            backwards++;
+            if (skew > max_skew) max_skew = skew;
+        }
+    }
+    printf("agree %ld %ld %llu\n", pairs, backwards, (unsigned long long)max_skew);
+}
+
+int main(int argc, char **argv) {
+    long iters = 1000000;
+    int want_hist = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-iters=", 7) == 0 && atol(argv[i] + 7) > 0) {
+            iters = atol(argv[i] + 7);
+        } else if (strcmp(argv[i], "-hist") == 0) {
+            want_hist = 1;
+        } else {
+            fprintf(stderr, "usage: clock_bench [-iters=N] [-hist]\n");
+            return 2;
+        }
+    }
+
+    unsigned long va = getauxval(AT_AKUMA_TIMEPAGE);
+    if (va > 1 && ((const struct time_page *)va)->magic == TIME_PAGE_MAGIC)
+        tp = (const struct time_page *)va;
+
+    struct utsname u;
+    if (uname(&u) == 0)
+        printf("# kernel %s %s\n", u.release, u.version);
+    printf("# timepage %s\n", tp ? "yes" : "no (timepage rows skipped)");
+    /* Without the page, CNTVCT may trap: only ask for counters alongside it. */
+    int src = tp ? akt_init() : AKT_SRC_NONE;
+    printf("# counter %s %llu Hz\n", akt_source_name(), akt_freq());
+    printf("# method iters secs ns_per_call\n");
+
+    bench("svc", read_svc, iters);
+    bench("libc", read_libc, iters);
+    if (tp) {
+        bench("timepage", read_timepage, iters);
+        if (tp->flags & TP_REALTIME_VALID)
+            bench("realtime", read_realtime, iters);
+        bench("cntvct", cntvct, iters);
+        if (src == AKT_SRC_PMCCNTR)
+            bench("pmccntr", pmccntr, iters);
+        agree(iters / 10 > 0 ? iters / 10 : 1);
+    }
+    if (want_hist && src != AKT_SRC_NONE) {
+        printf("# histograms: ns per call\n");
+        hist("svc", read_svc, iters);
+        hist("timepage", read_timepage, iters);
+    }
+    return 0;
+}
@@ -0,0 +1,342 @@
+/*
+ * mmap_bench.c — throughput numbers for the paths mmap_stress.c and
+ * mmap_file.c only crash-test: anonymous mmap/munmap and first touch, and
+ * file-backed demand paging with its readahead.
+ *
+ *   mmap_munmap   N pairs of mmap+munmap, untouched, per size (4K and 64K are
+ *                 under MMAP_EAGER_MAX_PAGES and so committed at mmap time;
+ *                 1M is lazy)
+ *   anon_touch    mmap MB, memset it (one fault per page), munmap
+ *   file_seq      mmap the file, read one byte per page in order, munmap
+ *   file_rand     the same in a shuffled page order
+ *   ra_run        shuffled runs of R consecutive pages, R = 1..1024. The kernel
+ *                 reads an adaptive window per file fault (256 pages at first,
+ *                 doubling while faults stay sequential, halving otherwise), so
+ *                 pages/fault and MBps against R show what it buys and wastes
+ *   anon_touch_mt T CLONE_VM threads (pthreads) first-touching slices of one
+ *                 mapping, T = 1, 2, 4 .. -threads
+ *   file_seq_mt   T threads touching interleaved 64-page chunks of one file
+ *                 mapping, so they fault inside each other's readahead window
+ *                 (the race test_readahead_race_phantom_frames covers)
+ *
+ * Faults come from getrusage(RUSAGE_SELF) ru_minflt + ru_majflt; the Akuma
+ * kernel fills ru_minflt with the thread group's demand-paging faults.
+ *
+ * Static, musl:
+ *   aarch64-linux-musl-gcc -static -O2 -Wall -Wextra -o mmap_bench mmap_bench.c -lpthread
+ *
+ * Usage:
+ *   mmap_bench [-mb=64] [-file=PATH] [-file_mb=64] [-iters=20000] [-threads=4]
+ *              [-only=TEST]
+ * Without -file a scratch file of -file_mb MiB is written to /tmp and removed.
+ *
+ * Output: '#' header lines (kernel release, column names), then one row per
+ * measurement, whitespace separated, so runs on different kernels can be
+ * diffed or charted directly:
+ *   test param threads MB secs ops_per_s MBps faults faults_per_s pages_per_fault
+ * param is the size in KiB for mmap_munmap, the run length for ra_run, and the
+ * MiB mapped otherwise. Columns that do not apply are 0.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PAGE_SIZE 4096UL
+#define MT_CHUNK_PAGES 64
+#define MAX_THREADS 64
+
+static const char *only;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long faults(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return ru.ru_minflt + ru.ru_majflt;
+}
+
+static int parse_kv(const char *arg, const char *key, const char **val) {
+    size_t klen = strlen(key);
+    if (strncmp(arg, key, klen) != 0) return 0;
+    if (arg[klen] != '=') return 0;
+    *val = arg + klen + 1;
+    return 1;
+}
+
+static int want(const char *test) {
+    return only == NULL || strcmp(only, test) == 0;
+}
+
+/* One measurement: `ops` calls and `bytes` touched over `secs`, `nf` faults. */
+static void row(const char *test, long param, int threads, size_t bytes,
+                double secs, long ops, long nf) {
+    double mb = (double)bytes / (1024.0 * 1024.0);
+    double pages = (double)bytes / PAGE_SIZE;
+    if (secs <= 0) secs = 1e-9;
+    printf("%s %ld %d %.1f %.4f %.0f %.1f %ld %.0f %.1f\n",
+           test, param, threads, mb, secs, ops / secs, mb / secs,
+           nf, nf / secs, nf > 0 ? pages / nf : 0.0);
+    fflush(stdout);
+}
+
+/* Small xorshift so shuffles are the same on every kernel. */
+static uint64_t rng = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_rand(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static void shuffle(size_t *v, size_t n) {
+    for (size_t i = n; i > 1; i--) {
+        size_t j = (size_t)(next_rand() % i);
+        size_t t = v[i - 1];
+        v[i - 1] = v[j];
+        v[j] = t;
+    }
+}
+
+static volatile unsigned long sink;
+
+static void bench_mmap_munmap(long iters) {
+    static const size_t sizes[] = { 4096, 64 * 1024, 1024 * 1024 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        long f0 = faults();
+        double t0 = now_s();
+        for (long i = 0; i < iters; i++) {
+            void *p = mmap(NULL, sizes[s], PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                fprintf(stderr, "mmap_bench: mmap(%zu) failed\n", sizes[s]);
+                exit(2);
+            }
+            munmap(p, sizes[s]);
+        }
+        row("mmap_munmap", (long)(sizes[s] / 1024), 1, 0, now_s() - t0,
+            2 * iters, faults() - f0);
+    }
+}
+
+static void bench_anon_touch(size_t size) {
+    long f0 = faults();
+    double t0 = now_s();
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "mmap_bench: mmap(%zu) failed\n", size);
+        exit(2);
+    }
+    memset(p, 1, size);
+    munmap(p, size);
+    row("anon_touch", (long)(size >> 20), 1, size, now_s() - t0, 0, faults() - f0);
+}
+
+/* Map the file, touch `order[0..n)` runs of `run` pages, unmap. */
+static void touch_file(const char *test, long param, int fd, size_t size,
+                       const size_t *order, size_t n, size_t run) {
+    size_t npages = size / PAGE_SIZE, touched = 0;
+    long f0 = faults();
+    double t0 = now_s();
+    const volatile unsigned char *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "mmap_bench: mmap(file, %zu) failed\n", size);
+        exit(2);
+    }
+    unsigned long sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t pg = order[i] * run; pg < (order[i] + 1) * run && pg < npages; pg++) {
+            sum += p[pg * PAGE_SIZE];
+            touched++;
+        }
+    }
+    sink += sum;
+    munmap((void *)p, size);
+    row(test, param, 1, touched * PAGE_SIZE, now_s() - t0, 0, faults() - f0);
+}
+
+static void bench_file(int fd, size_t size) {
+    size_t npages = size / PAGE_SIZE;
+    size_t *order = malloc(npages * sizeof(*order));
+    if (order == NULL) return;
+
+    for (size_t i = 0; i < npages; i++) order[i] = i;
+    if (want("file_seq"))
+        touch_file("file_seq", (long)(size >> 20), fd, size, order, npages, 1);
+    if (want("file_rand")) {
+        shuffle(order, npages);
+        touch_file("file_rand", (long)(size >> 20), fd, size, order, npages, 1);
+    }
+    if (want("ra_run")) {
+        static const size_t runs[] = { 1, 4, 16, 64, 256, 1024 };
+        for (size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++) {
+            size_t nruns = (npages + runs[r] - 1) / runs[r];
+            for (size_t i = 0; i < nruns; i++) order[i] = i;
+            shuffle(order, nruns);
+            touch_file("ra_run", (long)runs[r], fd, size, order, nruns, runs[r]);
+        }
+    }
+    free(order);
+}
+
+/* ---- CLONE_VM scaling ---- */
+
+struct mt_arg {
+    volatile unsigned char *base;
+    size_t npages;
+    int index, nthreads, file;
+    pthread_barrier_t *start;
+};
+
+static void *mt_worker(void *v) {
+    struct mt_arg *a = v;
+    unsigned long sum = 0;
+    pthread_barrier_wait(a->start);
+    if (a->file) {
+        /* chunk c belongs to thread c % T: neighbours fault into the same
+         * 256-page readahead window at the same time */
+        for (size_t c = (size_t)a->index; c * MT_CHUNK_PAGES < a->npages; c += (size_t)a->nthreads)
+            for (size_t pg = c * MT_CHUNK_PAGES; pg < (c + 1) * MT_CHUNK_PAGES && pg < a->npages; pg++)
+                sum += a->base[pg * PAGE_SIZE];
+    } else {
+        size_t per = a->npages / (size_t)a->nthreads;
+        memset((void *)(a->base + (size_t)a->index * per * PAGE_SIZE), 1, per * PAGE_SIZE);
+    }
+    sink += sum;
+    return NULL;
+}
+
+static void bench_mt(const char *test, int fd, size_t size, int nthreads) {
+    pthread_t tid[MAX_THREADS];
+    struct mt_arg args[MAX_THREADS];
+    pthread_barrier_t start;
+    int file = fd >= 0;
+
+    void *p = mmap(NULL, size, file ? PROT_READ : PROT_READ | PROT_WRITE,
+                   file ? MAP_PRIVATE : MAP_PRIVATE | MAP_ANONYMOUS, fd, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "mmap_bench: %s mmap(%zu) failed\n", test, size);
+        exit(2);
+    }
+    pthread_barrier_init(&start, NULL, (unsigned)nthreads + 1);
+    for (int i = 0; i < nthreads; i++) {
+        args[i] = (struct mt_arg){ p, size / PAGE_SIZE, i, nthreads, file, &start };
+        if (pthread_create(&tid[i], NULL, mt_worker, &args[i]) != 0) {
+            fprintf(stderr, "mmap_bench: pthread_create failed\n");
+            exit(2);
+        }
+    }
+    long f0 = faults();
+    double t0 = now_s();
+    pthread_barrier_wait(&start);
+    for (int i = 0; i < nthreads; i++) pthread_join(tid[i], NULL);
+    double secs = now_s() - t0;
+    long nf = faults() - f0;
+    munmap(p, size);
+    pthread_barrier_destroy(&start);
+    row(test, (long)(size >> 20), nthreads, size, secs, 0, nf);
+}
+
+/* Write a scratch file of `size` bytes (every page distinct). */
+static int make_file(const char *path, size_t size) {
+    static unsigned char buf[64 * 1024];
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    for (size_t off = 0; off < size; off += sizeof(buf)) {
+        for (size_t i = 0; i < sizeof(buf); i += PAGE_SIZE)
+            memcpy(buf + i, &(uint64_t){ off + i }, sizeof(uint64_t));
+        if (write(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+            close(fd);
+            unlink(path);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    size_t anon_mb = 64, file_mb = 64;
+    long iters = 20000;
+    int max_threads = 4;
+    const char *path = NULL;
+    const char *scratch = "/tmp/mmap_bench.dat";
+
+    for (int i = 1; i < argc; i++) {
+        const char *v = NULL;
+        if (parse_kv(argv[i], "-mb", &v)) {
+            if (atoi(v) > 0) anon_mb = (size_t)atoi(v);
+        } else if (parse_kv(argv[i], "-file_mb", &v)) {
+            if (atoi(v) > 0) file_mb = (size_t)atoi(v);
+        } else if (parse_kv(argv[i], "-file", &v)) {
+            path = v;
+        } else if (parse_kv(argv[i], "-iters", &v)) {
+            if (atol(v) > 0) iters = atol(v);
+        } else if (parse_kv(argv[i], "-threads", &v)) {
+            int t = atoi(v);
+            if (t > 0) max_threads = t > MAX_THREADS ? MAX_THREADS : t;
+        } else if (parse_kv(argv[i], "-only", &v)) {
+            only = v;
+        } else {
+            fprintf(stderr, "usage: mmap_bench [-mb=N] [-file=PATH] [-file_mb=N] "
+                    "[-iters=N] [-threads=N] [-only=TEST]\n");
+            return 2;
+        }
+    }
+
+    int fd;
+    size_t fsize;
+    if (path != NULL) {
+        struct stat st;
+        fd = open(path, O_RDONLY);
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            fprintf(stderr, "mmap_bench: cannot open %s\n", path);
+            return 2;
+        }
+        fsize = (size_t)st.st_size & ~(PAGE_SIZE - 1);
+    } else {
+        fsize = file_mb << 20;
+        fd = make_file(scratch, fsize);
+        if (fd < 0) {
+            fprintf(stderr, "mmap_bench: cannot write %s\n", scratch);
+            return 2;
+        }
+    }
+
+    struct utsname u;
+    if (uname(&u) == 0)
+        printf("# kernel %s %s %s\n", u.sysname, u.release, u.version);
+    printf("# anon_mb=%zu file_mb=%zu iters=%ld threads=%d\n",
+           anon_mb, fsize >> 20, iters, max_threads);
+    printf("# test param threads MB secs ops_per_s MBps faults faults_per_s pages_per_fault\n");
+    fflush(stdout);
+
+    if (want("mmap_munmap")) bench_mmap_munmap(iters);
+    if (want("anon_touch")) bench_anon_touch(anon_mb << 20);
+    if (fsize > 0) bench_file(fd, fsize);
+    for (int t = 1;; t *= 2) {
+        if (t > max_threads) t = max_threads;
+        if (want("anon_touch_mt")) bench_mt("anon_touch_mt", -1, anon_mb << 20, t);
+        if (want("file_seq_mt") && fsize > 0) bench_mt("file_seq_mt", fd, fsize, t);
+        if (t == max_threads) break;
+    }
+
+    close(fd);
+    if (path == NULL) unlink(scratch);
+    return 0;
+}
@@ -14,28 +14,70 @@
  * parent) — the kernel itself must stay up. If the file fits, we read it all and
  * exit 0. We never write, so MAP_PRIVATE is just a read-only view of the file.
  *
+ * An optional second argument picks how the mapping is loaded, and the touch
+ * loop is timed, so the same file can be compared across modes:
+ *
+ *   normal      no hint: the kernel's adaptive readahead window (the default)
+ *   sequential  madvise(MADV_SEQUENTIAL): maximum window from the first fault
+ *   random      madvise(MADV_RANDOM): one page per fault
+ *   willneed    madvise(MADV_WILLNEED) over the whole mapping before touching
+ *   populate    mmap(MAP_POPULATE): read in by mmap itself
+ *
+ * For willneed and populate the reported time includes the madvise/mmap call.
+ * Faults come from getrusage(RUSAGE_SELF), as in mmap_bench.c.
+ *
  * Static, musl, no Go runtime — a pure-C control so a crash is unambiguously the
  * kernel's fault.
  *
- * Usage: mmap_file /models/qwen3.5-0.8b-q4.gguf
+ * Usage: mmap_file /models/qwen3.5-0.8b-q4.gguf [normal|sequential|random|willneed|populate]
  */
 
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #define PAGE_SIZE 4096UL
 
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long faults(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return ru.ru_minflt + ru.ru_majflt;
+}
+
 int main(int argc, char **argv) {
     if (argc < 2) {
-        fprintf(stderr, "mmap_file: usage: mmap_file <path>\n");
+        fprintf(stderr, "mmap_file: usage: mmap_file <path> "
+                "[normal|sequential|random|willneed|populate]\n");
         return 2;
     }
     const char *path = argv[1];
+    const char *mode = argc > 2 ? argv[2] : "normal";
+    int advice = -1, map_flags = MAP_PRIVATE;
+    if (strcmp(mode, "sequential") == 0) {
+        advice = MADV_SEQUENTIAL;
+    } else if (strcmp(mode, "random") == 0) {
+        advice = MADV_RANDOM;
+    } else if (strcmp(mode, "willneed") == 0) {
+        advice = MADV_WILLNEED;
+    } else if (strcmp(mode, "populate") == 0) {
+        map_flags |= MAP_POPULATE;
+    } else if (strcmp(mode, "normal") != 0) {
+        fprintf(stderr, "mmap_file: unknown mode %s\n", mode);
+        return 2;
+    }
 
     int fd = open(path, O_RDONLY);
     if (fd < 0) {
@@ -51,16 +93,22 @@ int main(int argc, char **argv) {
     }
     size_t size = (size_t)st.st_size;
 
-    void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    long f0 = faults();
+    double t0 = now_s();
+    void *p = mmap(NULL, size, PROT_READ, map_flags, fd, 0);
     if (p == MAP_FAILED) {
         fprintf(stderr, "mmap_file: mmap(%zu) failed\n", size);
         close(fd);
         return 2;
     }
+    if (advice >= 0 && madvise(p, size, advice) != 0) {
+        fprintf(stderr, "mmap_file: madvise(%s) failed\n", mode);
+    }
 
     /* Sentinel so the kernel log shows we got past mmap and into the touch loop
      * (the SIGSEGV, if it comes, lands somewhere in here). */
-    fprintf(stdout, "mmap_file: mapped %zu bytes of %s, touching every page\n", size, path);
+    fprintf(stdout, "mmap_file: mapped %zu bytes of %s (%s), touching every page\n",
+            size, path, mode);
     fflush(stdout);
 
     volatile unsigned long sink = 0;
@@ -69,8 +117,15 @@ int main(int argc, char **argv) {
         sink += base[off];
     }
 
+    double secs = now_s() - t0;
+    long nfaults = faults() - f0;
+
     fprintf(stdout, "mmap_file: touched all pages, sink=%lu (file fit in RAM)\n",
             (unsigned long)sink);
+    fprintf(stdout, "mmap_file: mode=%s MB=%.1f secs=%.3f MBps=%.1f faults=%ld pages_per_fault=%.1f\n",
+            mode, (double)size / (1024 * 1024), secs,
+            secs > 0 ? (double)size / (1024 * 1024) / secs : 0.0, nfaults,
+            nfaults > 0 ? (double)((size + PAGE_SIZE - 1) / PAGE_SIZE) / (double)nfaults : 0.0);
     fflush(stdout);
 
     munmap(p, size);
@@ -7,19 +7,45 @@
  *   /bin/pattern2_parent -num_children=1 -duration=10s -mmap_alloc_mb=70
  * C parent + Go child (quadrant vs Go parent + C child — GO_FORKTEST_DEBUG.md):
  *   /bin/pattern2_parent -child=forktest …   # exec /bin/forktest_child -mmap_test=true …
+ *
+ * Spawn-latency benchmark (no epoll, no mmap_stress):
+ *   /bin/pattern2_parent -bench_spawn=200 [-parent_mb=100] [-spawn=fork,vfork,posix_spawn]
+ *                        [-exec=PATH]
+ * The parent first touches -parent_mb MiB of heap (the address space a plain fork
+ * has to CoW-share and a vfork/posix_spawn child does not), then for each spawn
+ * method runs N rounds of spawn + exec + child exit + waitpid, timing each round.
+ * The child execs PATH (default: this binary, which exits at once when given
+ * -exit_now). musl's posix_spawn and vfork are clone(CLONE_VM|CLONE_VFORK), which
+ * the kernel serves without copying the parent's page tables
+ * (config::VFORK_FASTPATH_ENABLED). Output, one row per method:
+ *   # method parent_mb n p50_us p90_us p99_us max_us mean_us
+ *
+ * Epoll benchmark (no children), one row per interest-list size:
+ *   /bin/pattern2_parent -bench_epoll=10,1000,10000 [-epoll_rounds=1000]
+ *   # fds rounds p50_us p99_us max_us mean_us events_per_s
+ * Wakeup latency (write on one pipe -> blocked epoll_wait returns) and the
+ * event rate with 16 of N pipes ready; see bench_epoll_one below.
  */
 
+#define _GNU_SOURCE
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <spawn.h>
 #include <stdint.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+extern char **environ;
+
 #ifndef EPOLLONESHOT
 #define EPOLLONESHOT (1u << 30)
 #endif
@@ -52,6 +78,250 @@ static int parse_kv_duration(const char *arg, const char *key, long *out) {
     return 1;
 }
 
+static int parse_kv_str(const char *arg, const char *key, const char **out) {
+    size_t klen = strlen(key);
+    if (strncmp(arg, key, klen) != 0) return 0;
+    if (arg[klen] != '=') return 0;
+    *out = arg + klen + 1;
+    return 1;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+enum { SPAWN_FORK, SPAWN_VFORK, SPAWN_POSIX_SPAWN };
+static const char *const spawn_names[] = { "fork", "vfork", "posix_spawn" };
+
+/* One round: start a child that execs `path`, wait for it to exit. */
+static int spawn_and_wait(int method, const char *path) {
+    char exit_now[] = "-exit_now";
+    char *av[] = { (char *)path, exit_now, NULL };
+    pid_t pid;
+
+    if (method == SPAWN_POSIX_SPAWN) {
+        int rc = posix_spawn(&pid, path, NULL, NULL, av, environ);
+        if (rc != 0) {
+            errno = rc;
+            return -1;
+        }
+    } else {
+        pid = method == SPAWN_VFORK ? vfork() : fork();
+        if (pid < 0) return -1;
+        if (pid == 0) {
+            execv(path, av);
+            _exit(127);
+        }
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/* -bench_spawn: spawn latency percentiles per method, with a parent_mb parent. */
+static int bench_spawn(int rounds, int parent_mb, const char *methods, const char *path) {
+    size_t ballast_len = (size_t)parent_mb << 20;
+    char *ballast = ballast_len ? malloc(ballast_len) : NULL;
+    if (ballast_len && !ballast) {
+        fprintf(stderr, "pattern2_parent: cannot allocate %d MiB parent\n", parent_mb);
+        return 1;
+    }
+    /* Touch every page so a fork has a fully populated parent to CoW-share. */
+    for (size_t off = 0; off < ballast_len; off += 4096) ballast[off] = (char)off;
+
+    double *lat = malloc((size_t)rounds * sizeof(double));
+    if (!lat) {
+        fprintf(stderr, "pattern2_parent: malloc failed\n");
+        return 1;
+    }
+    printf("# method parent_mb n p50_us p90_us p99_us max_us mean_us\n");
+    for (int m = SPAWN_FORK; m <= SPAWN_POSIX_SPAWN; m++) {
+        if (!strstr(methods, spawn_names[m])) continue;
+        /* One untimed round so the exec'd binary is in the page cache. */
+        if (spawn_and_wait(m, path) != 0) {
+            fprintf(stderr, "pattern2_parent: %s + exec %s failed: %s\n",
+                    spawn_names[m], path, strerror(errno));
+            continue;
+        }
+        double sum = 0;
+        int n = 0;
+        for (int i = 0; i < rounds; i++) {
+            double t0 = now_us();
+            if (spawn_and_wait(m, path) != 0) break;
+            lat[n] = now_us() - t0;
+            sum += lat[n++];
+        }
+        if (n == 0) continue;
+        qsort(lat, (size_t)n, sizeof(double), cmp_double);
+        printf("%s %d %d %.1f %.1f %.1f %.1f %.1f\n", spawn_names[m], parent_mb, n,
+               lat[n / 2], lat[n * 90 / 100], lat[n * 99 / 100], lat[n - 1], sum / n);
+        fflush(stdout);
+    }
+    free(lat);
+    free(ballast);
+    return 0;
+}
+
+/*
+ * -bench_epoll: epoll_wait cost against interest-list size. For each size N,
+ * N pipes are registered (read ends, EPOLLIN, level-triggered) and:
+ *   latency  a writer thread writes an 8-byte timestamp to one random pipe
+ *            while the main thread is blocked in epoll_wait(-1); the row
+ *            gets write-to-return percentiles over -epoll_rounds wakeups
+ *   rate     single thread: write one byte to 16 pipes (fewer when N < 16),
+ *            epoll_wait(0) until all 16 are harvested and read, repeat; the
+ *            row gets events/s. With an O(interest list) epoll_wait this
+ *            falls with N; with the kernel's ready list it should not
+ * Each pipe is two fds, so N needs 2N + slack under RLIMIT_NOFILE; the soft
+ * limit is raised to the hard one and a size that runs out of fds is skipped
+ * with a note.
+ */
+struct epoll_bench {
+    int epfd;
+    int n;
+    int (*pipes)[2];
+    int armed;
+    int stop;
+};
+
+static void *epoll_bench_writer(void *arg) {
+    struct epoll_bench *b = arg;
+    unsigned seed = 1;
+    for (;;) {
+        while (!__atomic_exchange_n(&b->armed, 0, __ATOMIC_ACQUIRE)) {
+            if (__atomic_load_n(&b->stop, __ATOMIC_ACQUIRE)) return NULL;
+            sched_yield();
+        }
+        usleep(200); /* let the main thread block in epoll_wait */
+        double t0 = now_us();
+        if (write(b->pipes[rand_r(&seed) % b->n][1], &t0, sizeof(t0)) != sizeof(t0)) return NULL;
+    }
+}
+
+static int bench_epoll_one(int n, int rounds) {
+    struct epoll_bench b = { .n = n };
+    b.pipes = calloc((size_t)n, sizeof(*b.pipes));
+    double *lat = malloc((size_t)rounds * sizeof(double));
+    struct epoll_event evs[64];
+    int made = 0, rc = 1;
+
+    b.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (!b.pipes || !lat || b.epfd < 0) {
+        fprintf(stderr, "pattern2_parent: epoll bench setup failed: %s\n", strerror(errno));
+        goto out;
+    }
+    for (; made < n; made++) {
+        if (pipe2(b.pipes[made], O_NONBLOCK | O_CLOEXEC) < 0) {
+            if (errno == EMFILE || errno == ENFILE) {
+                printf("# skip fds=%d: out of fds after %d pipes (RLIMIT_NOFILE)\n", n, made);
+                rc = 0;
+            } else {
+                fprintf(stderr, "pattern2_parent: pipe %d/%d: %s\n", made, n, strerror(errno));
+            }
+            goto out;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)made };
+        if (epoll_ctl(b.epfd, EPOLL_CTL_ADD, b.pipes[made][0], &ev) < 0) {
+            made++;
+            perror("epoll_ctl ADD");
+            goto out;
+        }
+    }
+    /* The first wait after the ADDs checks every fd once. */
+    (void)epoll_wait(b.epfd, evs, 64, 0);
+
+    pthread_t writer;
+    if (pthread_create(&writer, NULL, epoll_bench_writer, &b) != 0) {
+        fprintf(stderr, "pattern2_parent: pthread_create failed\n");
+        goto out;
+    }
+    double sum = 0;
+    int got = 0;
+    while (got < rounds) {
+        __atomic_store_n(&b.armed, 1, __ATOMIC_RELEASE);
+        int k = epoll_wait(b.epfd, evs, 64, 1000);
+        if (k < 0 && errno == EINTR) continue;
+        if (k <= 0) {
+            fprintf(stderr, "pattern2_parent: epoll_wait(fds=%d) returned %d: %s\n",
+                    n, k, k < 0 ? strerror(errno) : "timeout");
+            break;
+        }
+        double t1 = now_us(), t0;
+        for (int i = 0; i < k; i++) {
+            if (read(b.pipes[evs[i].data.u32][0], &t0, sizeof(t0)) == sizeof(t0) && got < rounds) {
+                lat[got] = t1 - t0;
+                sum += lat[got++];
+            }
+        }
+    }
+    __atomic_store_n(&b.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+
+    int burst = n < 16 ? n : 16;
+    long events = 0;
+    char byte = 0, sink[64];
+    double r0 = now_us();
+    for (int r = 0, base = 0; r < rounds; r++, base = (base + 97) % n) {
+        for (int j = 0; j < burst; j++)
+            if (write(b.pipes[(base + j) % n][1], &byte, 1) != 1) goto out;
+        for (int left = burst; left > 0;) {
+            int k = epoll_wait(b.epfd, evs, 64, 0);
+            for (int i = 0; i < k; i++) {
+                if (read(b.pipes[evs[i].data.u32][0], sink, sizeof(sink)) > 0) left--;
+            }
+            events += k > 0 ? k : 0;
+        }
+    }
+    double secs = (now_us() - r0) / 1e6;
+
+    if (got > 0) {
+        qsort(lat, (size_t)got, sizeof(double), cmp_double);
+        printf("%d %d %.1f %.1f %.1f %.1f %.0f\n", n, got, lat[got / 2], lat[got * 99 / 100],
+               lat[got - 1], sum / got, secs > 0 ? (double)events / secs : 0.0);
+        fflush(stdout);
+        rc = 0;
+    }
+out:
+    for (int i = 0; i < made; i++) {
+        close(b.pipes[i][0]);
+        close(b.pipes[i][1]);
+    }
+    if (b.epfd >= 0) close(b.epfd);
+    free(lat);
+    free(b.pipes);
+    return rc;
+}
+
+static int bench_epoll(const char *sizes, int rounds) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        (void)setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    printf("# fds rounds p50_us p99_us max_us mean_us events_per_s\n");
+    int rc = 0;
+    for (const char *p = sizes; *p;) {
+        int n = atoi(p);
+        if (n > 0 && bench_epoll_one(n, rounds) != 0) {
+            rc = 1;
+        }
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+    return rc;
+}
+
 typedef struct {
     int read_fd;
     pid_t pid;
@@ -81,10 +351,30 @@ int main(int argc, char **argv) {
     long duration_s = 10;
     int mmap_mb = 70;
     int use_forktest_child = 0;
+    int bench_rounds = 0;
+    int parent_mb = 100;
+    const char *spawn_methods = "fork,vfork,posix_spawn";
+    const char *epoll_sizes = NULL;
+    int epoll_rounds = 1000;
+    const char *exec_path = strchr(argv[0], '/') ? argv[0] : "/bin/pattern2_parent";
+
+    if (argc > 1 && strcmp(argv[1], "-exit_now") == 0) return 0;
 
     for (int i = 1; i < argc; i++) {
         int v;
         if (parse_kv_child_mode(argv[i], &use_forktest_child)) {
+        } else if (parse_kv_int(argv[i], "-bench_spawn", &v) || parse_kv_int(argv[i], "--bench_spawn", &v)) {
+            if (v >= 1) bench_rounds = v;
+        } else if (parse_kv_str(argv[i], "-bench_epoll", &epoll_sizes) ||
+                   parse_kv_str(argv[i], "--bench_epoll", &epoll_sizes)) {
+        } else if (parse_kv_int(argv[i], "-epoll_rounds", &v) || parse_kv_int(argv[i], "--epoll_rounds", &v)) {
+            if (v >= 1) epoll_rounds = v;
+        } else if (parse_kv_int(argv[i], "-parent_mb", &v) || parse_kv_int(argv[i], "--parent_mb", &v)) {
+            if (v >= 0) parent_mb = v;
+        } else if (parse_kv_str(argv[i], "-spawn", &spawn_methods) ||
+                   parse_kv_str(argv[i], "--spawn", &spawn_methods)) {
+        } else if (parse_kv_str(argv[i], "-exec", &exec_path) ||
+                   parse_kv_str(argv[i], "--exec", &exec_path)) {
         } else if (parse_kv_int(argv[i], "-num_children", &v) || parse_kv_int(argv[i], "--num_children", &v)) {
             if (v >= 1) num_children = v;
         } else if (parse_kv_int(argv[i], "-mmap_alloc_mb", &v) ||
@@ -95,6 +385,9 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (bench_rounds > 0) return bench_spawn(bench_rounds, parent_mb, spawn_methods, exec_path);
+    if (epoll_sizes) return bench_epoll(epoll_sizes, epoll_rounds);
+
     int epfd = epoll_create1(EPOLL_CLOEXEC);
     if (epfd < 0) {
         perror("epoll_create1");
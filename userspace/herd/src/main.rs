@@ -134,6 +134,11 @@ struct ServiceConfig {
     /// AF_INET routes to the rumpnet box's rump_server). When set, herd does NOT
     /// register the box or set its stack — the owner owns that.
     join_box: String,
+    /// With `stack = rump`: share the rump stack of this box (by name) instead
+    /// of running a rump_server of its own. The box stays a box of its own
+    /// (namespace, processes); the kernel opens it a separate sysproxy channel
+    /// into the named box's rump_server, which must run with `--chan-fd 4`.
+    net_box: String,
     /// Mount points to create in the box's namespace before spawning (only
     /// "proc"/"tmpfs"). A fresh-root (box_root != "/") box has no /proc unless
     /// mounted here — sshd's interactive bridge needs /proc/<pid>/fd/0.
@@ -169,6 +174,7 @@ impl Default for ServiceConfig {
             stack: String::new(),
             restart: true,
             join_box: String::new(),
+            net_box: String::new(),
             mount_fs: Vec::new(),
             start_delay_ms: 0,
             oneshot: false,
@@ -623,6 +629,7 @@ fn parse_service_config(content: &str) -> Option<ServiceConfig> {
                 }
                 "stack" => config.stack = String::from(value),
                 "restart" => config.restart = value != "false" && value != "0" && value != "no",
+                "net_box" => config.net_box = String::from(value),
                 "join_box" => {
                     config.join_box = String::from(value);
                     config.boxed = true; // a joined service always runs in a box
@@ -858,9 +865,11 @@ fn is_boxed(config: &ServiceConfig) -> bool {
 }
 
 /// Tell the kernel a box uses the NetBSD rump network stack (stack = 1). The
-/// kernel then routes that box's AF_INET syscalls to its rump_server.
-fn set_box_stack_rump(box_id: u64) {
-    libakuma::syscall(SYSCALL_SET_BOX_STACK, box_id, 1, 0, 0, 0, 0);
+/// kernel then routes that box's AF_INET syscalls to its rump_server — or, with
+/// `net_box` set, to that box's rump_server, whose stack it shares.
+fn set_box_stack_rump(box_id: u64, config: &ServiceConfig) {
+    let net_box = if config.net_box.is_empty() { 0 } else { generate_box_id(&config.net_box) };
+    libakuma::syscall(SYSCALL_SET_BOX_STACK, box_id, 1, net_box, 0, 0, 0);
 }
 
 fn generate_box_id(name: &str) -> u64 {
@@ -1144,7 +1153,7 @@ fn start_service(state: &mut HerdState, name: &str, config: &ServiceConfig) {
         // 1. Register box (creates mount namespace in kernel)
         register_box(name, box_id, &root_dir, 0);
         if config.stack == "rump" {
-            set_box_stack_rump(box_id);
+            set_box_stack_rump(box_id, config);
         }
 
         // 2. Set up OCI mounts in the box's namespace
@@ -1166,7 +1175,7 @@ fn start_service(state: &mut HerdState, name: &str, config: &ServiceConfig) {
             // spawn it below. herd owns the rump_server lifecycle (one server,
             // no second kernel-spawned one); the kernel only attaches the
             // channel + drives the proxy.
-            set_box_stack_rump(box_id);
+            set_box_stack_rump(box_id, config);
         }
         setup_fs_mounts(box_id, &config.mount_fs);
         let res = spawn_in_box(box_id, &config.command, &args);
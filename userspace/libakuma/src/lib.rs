@@ -69,8 +69,10 @@ pub mod syscall {
     pub const SENDTO: u64 = 206;
     pub const RECVFROM: u64 = 207;
     pub const SHUTDOWN: u64 = 210;
+    pub const SETSOCKOPT: u64 = 208;
     pub const MUNMAP: u64 = 215;
     pub const MMAP: u64 = 222;
+    pub const MPROTECT: u64 = 226;
     pub const GETDENTS64: u64 = 61;
     pub const MKDIRAT: u64 = 34;
     pub const UNLINKAT: u64 = 35;
@@ -91,6 +93,13 @@ pub mod syscall {
     pub const FACCESSAT: u64 = 48;
     pub const NEWFSTATAT: u64 = 79;
     pub const CLOCK_GETTIME: u64 = 113;
+    pub const EPOLL_CREATE1: u64 = 20;
+    pub const EPOLL_CTL: u64 = 21;
+    pub const EPOLL_PWAIT: u64 = 22;
+    pub const EVENTFD2: u64 = 19;
+    pub const CLONE: u64 = 220;
+    pub const FUTEX: u64 = 98;
+    pub const GETTID: u64 = 178;
     pub const FACCESSAT2: u64 = 439;
     // New Terminal Control Syscalls
     pub const SET_TERMINAL_ATTRIBUTES: u64 = 307;
@@ -209,6 +218,14 @@ pub fn getpid() -> u32 {
     unsafe { (*(PROCESS_INFO_ADDR as *const ProcessInfo)).pid }
 }
 
+/// Get the calling thread's ID
+///
+/// Unlike `getpid`, this differs between threads of one process.
+#[inline]
+pub fn gettid() -> u32 {
+    syscall(syscall::GETTID, 0, 0, 0, 0, 0, 0) as u32
+}
+
 /// Get the parent process ID
 ///
 /// Reads from the kernel-provided process info page.
@@ -449,7 +466,31 @@ pub fn env_all() -> EnvVars {
     }
 }
 
-/// Perform a syscall with up to 6 arguments
+/// Look up an auxiliary vector entry (`AT_*`) by type.
+///
+/// The auxv follows envp's NULL terminator on the initial stack as
+/// `(a_type, a_val)` pairs ending in `AT_NULL`.
+pub fn auxv(a_type: u64) -> Option<u64> {
+    let sp = INITIAL_SP.load(Ordering::Acquire);
+    if sp == 0 { return None; }
+
+    unsafe {
+        let argc = *(sp as *const usize);
+        let mut p = (sp + 8 + (argc + 1) * 8) as *const u64;
+        while *p != 0 {
+            p = p.add(1);
+        }
+        p = p.add(1);
+        while *p != 0 {
+            if *p == a_type {
+                return Some(*p.add(1));
+            }
+            p = p.add(2);
+        }
+    }
+    None
+}
+
 ///
 /// Uses the Linux AArch64 syscall ABI:
 /// - x8: syscall number
@@ -539,6 +580,7 @@ pub fn brk(addr: usize) -> usize {
 pub mod mmap_flags {
     pub const PROT_READ: u32 = 0x1;
     pub const PROT_WRITE: u32 = 0x2;
+    pub const PROT_EXEC: u32 = 0x4;
     pub const MAP_PRIVATE: u32 = 0x02;
     pub const MAP_ANONYMOUS: u32 = 0x20;
 }
@@ -560,6 +602,35 @@ pub fn mmap(addr: usize, len: usize, prot: u32, flags: u32) -> usize {
     result as usize
 }
 
+/// Map `len` bytes of the open file `fd` from `offset` (page aligned)
+///
+/// Returns the mapped address, or a negated errno on failure (a value past
+/// `usize::MAX - 4096`). Pages are read in
+/// on first touch; clean read-only pages can be dropped under memory
+/// pressure and read again later.
+#[inline(always)]
+pub fn mmap_fd(addr: usize, len: usize, prot: u32, flags: u32, fd: i32, offset: usize) -> usize {
+    let result = syscall(
+        syscall::MMAP,
+        addr as u64,
+        len as u64,
+        prot as u64,
+        flags as u64,
+        fd as u64,
+        offset as u64,
+    );
+    result as usize
+}
+
+/// Change the protection of mapped pages (`addr` page aligned)
+///
+/// Returns 0 on success, negative errno on error. Making pages executable
+/// also brings the instruction cache up to date with their contents.
+#[inline(always)]
+pub fn mprotect(addr: usize, len: usize, prot: u32) -> isize {
+    syscall(syscall::MPROTECT, addr as u64, len as u64, prot as u64, 0, 0, 0) as isize
+}
+
 /// Unmap memory pages
 #[inline(always)]
 pub fn munmap(addr: usize, len: usize) -> isize {
@@ -611,9 +682,80 @@ pub fn sleep_ms(milliseconds: u64) {
     syscall(syscall::NANOSLEEP, 0, nanos, 0, 0, 0, 0);
 }
 
+// ============================================================================
+// Time page (syscall-free clocks)
+// ============================================================================
+
+/// Akuma auxv extension: VA of the kernel's read-only time page.
+pub const AT_AKUMA_TIMEPAGE: u64 = 0x414B_0001;
+
+/// Mirror of the kernel's `akuma_exec::timepage::TimePage` (docs/TIME_PAGE.md).
+#[repr(C)]
+struct TimePage {
+    magic: u32,
+    version: u32,
+    seq: u32,
+    _pad: u32,
+    cntfrq: u64,
+    realtime_off_ns: u64,
+    flags: u64,
+}
+
+const TIME_PAGE_MAGIC: u32 = 0x5054_4B41;
+const TP_REALTIME_VALID: u64 = 1;
+
+/// 0 = not looked up yet, 1 = no time page (use syscalls), else its VA.
+static TIME_PAGE: AtomicUsize = AtomicUsize::new(0);
+
+fn time_page() -> Option<&'static TimePage> {
+    let mut va = TIME_PAGE.load(Ordering::Relaxed);
+    if va == 0 {
+        va = match auxv(AT_AKUMA_TIMEPAGE) {
+            Some(v) if v > 1 && unsafe { (*(v as *const TimePage)).magic } == TIME_PAGE_MAGIC => v as usize,
+            _ => 1,
+        };
+        TIME_PAGE.store(va, Ordering::Relaxed);
+    }
+    if va == 1 { None } else { Some(unsafe { &*(va as *const TimePage) }) }
+}
+
+/// Nanoseconds since boot (and, when `realtime`, since the Unix epoch) read
+/// straight from CNTVCT_EL0 and the time page. `None` means "ask the kernel":
+/// no time page, or realtime requested before the wall clock was set.
+fn fast_clock_ns(realtime: bool) -> Option<u64> {
+    let tp = time_page()?;
+    loop {
+        let seq = unsafe { core::ptr::read_volatile(&tp.seq) };
+        if seq & 1 != 0 {
+            core::hint::spin_loop();
+            continue;
+        }
+        core::sync::atomic::fence(Ordering::Acquire);
+        let freq = unsafe { core::ptr::read_volatile(&tp.cntfrq) };
+        let off = unsafe { core::ptr::read_volatile(&tp.realtime_off_ns) };
+        let flags = unsafe { core::ptr::read_volatile(&tp.flags) };
+        let cnt: u64;
+        // ISB: don't let the counter read be speculated ahead of the seq load.
+        unsafe { asm!("isb", "mrs {}, cntvct_el0", out(reg) cnt, options(nomem, nostack)) };
+        core::sync::atomic::fence(Ordering::Acquire);
+        if unsafe { core::ptr::read_volatile(&tp.seq) } != seq {
+            continue;
+        }
+        if freq == 0 || (realtime && flags & TP_REALTIME_VALID == 0) {
+            return None;
+        }
+        // Same exact split as the kernel's counter_to_ns, so both paths agree.
+        let ns = (cnt / freq) * 1_000_000_000 + (cnt % freq) * 1_000_000_000 / freq;
+        return Some(if realtime { off.wrapping_add(ns) } else { ns });
+    }
+}
+
 // returns microseconds, not milliseconds
 #[inline(never)]
 pub fn uptime() -> u64 {
+    if let Some(ns) = fast_clock_ns(false) {
+        return ns / 1_000;
+    }
     syscall(syscall::UPTIME, 0, 0, 0, 0, 0, 0)
 }
 
@@ -622,6 +764,9 @@ pub fn uptime() -> u64 {
 /// Returns 0 if the RTC is not available.
 #[inline(never)]
 pub fn time() -> u64 {
+    if let Some(ns) = fast_clock_ns(true) {
+        return ns / 1_000;
+    }
     syscall(syscall::TIME, 0, 0, 0, 0, 0, 0)
 }
 
@@ -636,7 +781,20 @@ pub const CLOCK_REALTIME: u32 = 0;
 pub const CLOCK_MONOTONIC: u32 = 1;
 
 /// Get the time of the specified clock
+///
+/// REALTIME/MONOTONIC/BOOTTIME and their RAW/COARSE variants are served from
+/// the time page without trapping; anything else goes to the kernel.
 pub fn clock_gettime(clock_id: u32, tp: &mut Timespec) -> i32 {
+    let fast = match clock_id {
+        0 | 5 => fast_clock_ns(true),          // REALTIME, REALTIME_COARSE
+        1 | 4 | 6 | 7 => fast_clock_ns(false), // MONOTONIC, _RAW, _COARSE, BOOTTIME
+        _ => None,
+    };
+    if let Some(ns) = fast {
+        tp.tv_sec = (ns / 1_000_000_000) as i64;
+        tp.tv_nsec = (ns % 1_000_000_000) as i64;
+        return 0;
+    }
     syscall(
         syscall::CLOCK_GETTIME,
         clock_id as u64,
@@ -655,6 +813,7 @@ pub mod socket_const {
     pub const SOCK_STREAM: i32 = 1;
     pub const SOCK_DGRAM: i32 = 2;
     pub const IPPROTO_TCP: i32 = 6;
+    pub const TCP_NODELAY: i32 = 1;
     pub const SHUT_RD: i32 = 0;
     pub const SHUT_WR: i32 = 1;
     pub const SHUT_RDWR: i32 = 2;
@@ -842,6 +1001,19 @@ pub fn shutdown(fd: i32, how: i32) -> i32 {
     ) as i32
 }
 
+/// Set an integer socket option
+pub fn setsockopt(fd: i32, level: i32, optname: i32, val: i32) -> i32 {
+    syscall(
+        syscall::SETSOCKOPT,
+        fd as u64,
+        level as u64,
+        optname as u64,
+        &val as *const i32 as u64,
+        core::mem::size_of::<i32>() as u64,
+        0,
+    ) as i32
+}
+
 /// Close a file descriptor
 pub fn close(fd: i32) -> i32 {
     syscall(
@@ -983,6 +1155,20 @@ pub fn fstat(fd: i32) -> Result<Stat, i32> {
     }
 }
 
+/// Whether `fd` is a terminal (probes `TCGETS`, like libc's `isatty`).
+pub fn isatty(fd: i32) -> bool {
+    const TCGETS: u64 = 0x5401;
+    let mut termios = [0u32; 15];
+    let ret = syscall(
+        syscall::IOCTL,
+        fd as u64,
+        TCGETS,
+        termios.as_mut_ptr() as u64,
+        0, 0, 0,
+    ) as i64;
+    ret == 0
+}
+
 /// Get file status relative to directory
 pub fn fstatat(dirfd: i32, path: &str, flags: u32) -> Result<Stat, i32> {
     let mut stat = Stat::default();
@@ -1024,6 +1210,199 @@ pub fn set_nonblocking(fd: i32, nonblocking: bool) -> i32 {
     syscall(syscall::FCNTL, fd as u64, F_SETFL, arg, 0, 0, 0) as i32
 }
 
+/// epoll event bits and `epoll_ctl` operations
+pub mod epoll {
+    pub const EPOLLIN: u32 = 0x001;
+    pub const EPOLLOUT: u32 = 0x004;
+    pub const EPOLLERR: u32 = 0x008;
+    pub const EPOLLHUP: u32 = 0x010;
+    pub const EPOLL_CTL_ADD: i32 = 1;
+    pub const EPOLL_CTL_DEL: i32 = 2;
+    pub const EPOLL_CTL_MOD: i32 = 3;
+    pub const EPOLL_CLOEXEC: u32 = 0o2000000;
+}
+
+/// One `epoll_pwait` result (AArch64 layout: no packing)
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct EpollEvent {
+    pub events: u32,
+    pub _pad: u32,
+    pub data: u64,
+}
+
+/// Create an epoll instance; returns the fd or negative errno
+pub fn epoll_create1(flags: u32) -> i32 {
+    syscall(syscall::EPOLL_CREATE1, flags as u64, 0, 0, 0, 0, 0) as i32
+}
+
+/// Add, change or remove `fd` in the interest list of `epfd`
+pub fn epoll_ctl(epfd: i32, op: i32, fd: i32, events: u32, data: u64) -> i32 {
+    let ev = EpollEvent { events, _pad: 0, data };
+    syscall(
+        syscall::EPOLL_CTL,
+        epfd as u64,
+        op as u64,
+        fd as u64,
+        &ev as *const EpollEvent as u64,
+        0, 0,
+    ) as i32
+}
+
+/// Wait up to `timeout_ms` (-1: forever, 0: poll) for events on `epfd`;
+/// returns the number of `events` filled in or negative errno
+pub fn epoll_wait(epfd: i32, events: &mut [EpollEvent], timeout_ms: i32) -> i32 {
+    syscall(
+        syscall::EPOLL_PWAIT,
+        epfd as u64,
+        events.as_mut_ptr() as u64,
+        events.len() as u64,
+        timeout_ms as i64 as u64,
+        0, 0,
+    ) as i32
+}
+
+/// Create an eventfd (`EFD_*` flags); returns the fd or negative errno
+pub fn eventfd(initval: u32, flags: u32) -> i32 {
+    syscall(syscall::EVENTFD2, initval as u64, flags as u64, 0, 0, 0, 0) as i32
+}
+
+/// `eventfd` flags
+pub mod eventfd_flags {
+    pub const EFD_NONBLOCK: u32 = 0o4000;
+    pub const EFD_CLOEXEC: u32 = 0o2000000;
+}
+
+// ============================================================================
+// Threads
+// ============================================================================
+
+const FUTEX_WAIT_PRIVATE: u64 = 128;
+const FUTEX_WAKE_PRIVATE: u64 = 129;
+
+/// Block while `word` still holds `expected`, for at most `timeout_us` when
+/// given. Returns 0 when woken, or negative errno (`-EAGAIN`: the value had
+/// already changed, `-ETIMEDOUT`).
+pub fn futex_wait(word: &core::sync::atomic::AtomicU32, expected: u32, timeout_us: Option<u64>) -> i32 {
+    let ts;
+    let ts_ptr = match timeout_us {
+        Some(us) => {
+            ts = Timespec {
+                tv_sec: (us / 1_000_000) as i64,
+                tv_nsec: ((us % 1_000_000) * 1000) as i64,
+            };
+            &ts as *const Timespec as u64
+        }
+        None => 0,
+    };
+    syscall(
+        syscall::FUTEX,
+        word.as_ptr() as u64,
+        FUTEX_WAIT_PRIVATE,
+        expected as u64,
+        ts_ptr,
+        0, 0,
+    ) as i32
+}
+
+/// Wake up to `count` threads waiting on `word`; returns how many woke
+pub fn futex_wake(word: &core::sync::atomic::AtomicU32, count: i32) -> i32 {
+    syscall(syscall::FUTEX, word.as_ptr() as u64, FUTEX_WAKE_PRIVATE, count as u64, 0, 0, 0) as i32
+}
+
+/// A thread started with [`spawn_thread`]
+pub struct Thread {
+    /// Thread id until the thread exits; the kernel clears it and wakes
+    /// futex waiters (`CLONE_CHILD_CLEARTID`)
+    tid: alloc::boxed::Box<core::sync::atomic::AtomicU32>,
+    stack: usize,
+    stack_size: usize,
+}
+
+impl Thread {
+    pub fn id(&self) -> u32 {
+        self.tid.load(Ordering::Acquire)
+    }
+
+    /// Wait for the thread to return from its entry function, then release
+    /// its stack
+    pub fn join(self) {
+        loop {
+            let tid = self.tid.load(Ordering::Acquire);
+            if tid == 0 {
+                break;
+            }
+            futex_wait(&self.tid, tid, None);
+        }
+        munmap(self.stack, self.stack_size);
+    }
+}
+
+/// Run `entry(arg)` on a new thread sharing this process's memory and fds,
+/// with a freshly mapped stack of `stack_size` bytes. The thread exits when
+/// `entry` returns. Returns negative errno on failure.
+pub fn spawn_thread(stack_size: usize, entry: extern "C" fn(usize), arg: usize) -> Result<Thread, i32> {
+    use mmap_flags::*;
+    const CLONE_VM: u64 = 0x100;
+    const CLONE_FS: u64 = 0x200;
+    const CLONE_FILES: u64 = 0x400;
+    const CLONE_SIGHAND: u64 = 0x800;
+    const CLONE_THREAD: u64 = 0x10000;
+    const CLONE_SYSVSEM: u64 = 0x40000;
+    const CLONE_PARENT_SETTID: u64 = 0x100000;
+    const CLONE_CHILD_CLEARTID: u64 = 0x200000;
+    const FLAGS: u64 = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD
+        | CLONE_SYSVSEM | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID;
+
+    let stack_size = (stack_size + 4095) & !4095;
+    let stack = mmap(0, stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS);
+    if stack == 0 || (stack as isize) < 0 {
+        return Err(-12); // ENOMEM
+    }
+    let tid = alloc::boxed::Box::new(core::sync::atomic::AtomicU32::new(0));
+    let tid_ptr = tid.as_ptr() as u64;
+    let top = ((stack + stack_size) & !15) as u64;
+    let ret: u64;
+    // The child resumes after the `svc` with x0 = 0 on the new stack and
+    // every other register copied from the parent, so it finds `entry` and
+    // `arg` in x9/x10. It never returns into Rust code: after `entry` it
+    // calls exit (93), which ends only this thread.
+    unsafe {
+        asm!(
+            "svc #0",
+            "cbnz x0, 2f",
+            "mov x0, x10",
+            "blr x9",
+            "mov x0, #0",
+            "mov x8, #93",
+            "svc #0",
+            "2:",
+            in("x8") syscall::CLONE,
+            inout("x0") FLAGS => ret,
+            in("x1") top,
+            in("x2") tid_ptr,
+            in("x3") 0u64,
+            in("x4") tid_ptr,
+            in("x9") entry as usize,
+            in("x10") arg,
+            options(nostack)
+        );
+    }
+    if (ret as i64) < 0 {
+        munmap(stack, stack_size);
+        return Err(ret as i64 as i32);
+    }
+    Ok(Thread { tid, stack, stack_size })
+}
+
+/// Exit every thread in the process
+pub fn exit_group(code: i32) -> ! {
+    syscall(syscall::EXIT_GROUP, code as u64, 0, 0, 0, 0, 0);
+    loop {
+        unsafe { asm!("wfi") };
+    }
+}
+
 /// Deliver EOF to a spawned child's stdin (`CLOSE_CHILD_STDIN`). A shell reading
 /// a piped script (busybox `sh`) blocks for more input until it sees EOF; the
 /// SSH-into-box bridge calls this on the client's CHANNEL_EOF so the shell
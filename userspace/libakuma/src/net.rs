@@ -247,6 +247,16 @@ impl TcpStream {
         }
     }
 
+    /// Sets TCP_NODELAY (disables Nagle) on this connection.
+    pub fn set_nodelay(&self, nodelay: bool) -> Result<(), Error> {
+        let ret = crate::setsockopt(self.fd, socket_const::IPPROTO_TCP, socket_const::TCP_NODELAY, nodelay as i32);
+        if ret < 0 {
+            Err(Error::from_errno(-ret))
+        } else {
+            Ok(())
+        }
+    }
+
     /// Read data from the stream
     pub fn read(&self, buf: &mut [u8]) -> Result<usize, Error> {
         let ret = crate::recv(self.fd, buf, 0);
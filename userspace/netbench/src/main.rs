@@ -0,0 +1,486 @@
+//! netbench - HTTP load generator and bulk TCP benchmark
+//!
+//! Measures the network stack of the box it runs in. Run it once in a plain
+//! (smoltcp) box and once in a `stack = rump` box against the same server and
+//! the two reports are the A/B comparison of the stacks (see README.md).
+//!
+//! Usage:
+//!   netbench http <ip:port> [-c N] [-d SECS] [-p PATH]
+//!       N concurrent keep-alive clients issue GET PATH for SECS seconds.
+//!       Reports requests/s, p50/p99/max latency, reconnects and CPU time.
+//!   netbench bulk <ip:port> [-c N] [-d SECS] [-p PATH]
+//!       N streams fetch PATH back to back for SECS seconds; reports KB/s.
+//!   netbench serve [port]
+//!       Keep-alive HTTP/1.1 server for the above, thread per connection:
+//!       `/bytes/<n>` answers n bytes, anything else a 64-byte body.
+//!
+//! A server that closes after each response (httpd is HTTP/1.0,
+//! `Connection: close`) still works: the client reconnects, and the report's
+//! connect count shows that the numbers include a handshake per request.
+
+#![no_std]
+#![no_main]
+
+extern crate alloc;
+
+use alloc::boxed::Box;
+use alloc::format;
+use alloc::string::String;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, Ordering};
+
+use libakuma::net::{ErrorKind, TcpListener, TcpStream};
+use libakuma::{arg, argc, exit, get_cpu_stats, getpid, print, sleep_ms, spawn_thread, uptime};
+use libakuma::{Thread, ThreadCpuStat};
+
+const DEFAULT_CLIENTS: usize = 4;
+const DEFAULT_SECS: u64 = 10;
+const DEFAULT_SERVE_PORT: u16 = 8090;
+/// Latency samples kept per client; beyond this only counts are updated
+const MAX_SAMPLES: usize = 1 << 18;
+const THREAD_STACK: usize = 64 * 1024;
+const IO_BUF: usize = 16 * 1024;
+/// Matches the kernel's thread table (config::MAX_THREADS)
+const MAX_THREADS: usize = 64;
+
+static STOP: AtomicBool = AtomicBool::new(false);
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Mode {
+    Http,
+    Bulk,
+}
+
+/// One client thread's settings and results
+struct Client {
+    addr: String,
+    request: Vec<u8>,
+    mode: Mode,
+    requests: u64,
+    errors: u64,
+    connects: u64,
+    bytes: u64,
+    lat_us: Vec<u32>,
+}
+
+#[no_mangle]
+pub extern "C" fn main() {
+    let sub = arg(1).unwrap_or("");
+    match sub {
+        "http" => run_clients(Mode::Http),
+        "bulk" => run_clients(Mode::Bulk),
+        "serve" => serve(),
+        _ => {
+            print("usage: netbench http|bulk <ip:port> [-c N] [-d SECS] [-p PATH]\n");
+            print("       netbench serve [port]\n");
+            exit(2);
+        }
+    }
+    exit(0);
+}
+
+// ============================================================================
+// Client side
+// ============================================================================
+
+fn run_clients(mode: Mode) {
+    let addr = match arg(2) {
+        Some(a) => a,
+        None => {
+            print("netbench: missing <ip:port>\n");
+            exit(2);
+        }
+    };
+    let mut clients = DEFAULT_CLIENTS;
+    let mut secs = DEFAULT_SECS;
+    let mut path = if mode == Mode::Bulk { "/bytes/1048576" } else { "/" };
+    let mut i = 3;
+    while i < argc() {
+        let val = arg(i + 1).unwrap_or("");
+        match arg(i).unwrap_or("") {
+            "-c" => clients = val.parse().unwrap_or(clients).clamp(1, MAX_THREADS / 2),
+            "-d" => secs = val.parse().unwrap_or(secs).max(1),
+            "-p" => path = val,
+            other => {
+                print(&format!("netbench: unknown option {}\n", other));
+                exit(2);
+            }
+        }
+        i += 2;
+    }
+
+    let host = addr.split(':').next().unwrap_or(addr);
+    let request = format!(
+        "GET {} HTTP/1.1\r\nHost: {}\r\nUser-Agent: netbench\r\nConnection: keep-alive\r\n\r\n",
+        path, host
+    )
+    .into_bytes();
+    let label = if mode == Mode::Bulk { "bulk" } else { "http" };
+    print(&format!(
+        "netbench: {} {}{} clients={} duration={}s\n",
+        label, addr, path, clients, secs
+    ));
+
+    let mut workers: Vec<Box<Client>> = Vec::with_capacity(clients);
+    for _ in 0..clients {
+        workers.push(Box::new(Client {
+            addr: String::from(addr),
+            request: request.clone(),
+            mode,
+            requests: 0,
+            errors: 0,
+            connects: 0,
+            bytes: 0,
+            lat_us: Vec::new(),
+        }));
+    }
+
+    let cpu_before = cpu_snapshot();
+    let t0 = uptime();
+    let mut threads: Vec<Thread> = Vec::with_capacity(clients);
+    for w in workers.iter_mut() {
+        let ptr = &mut **w as *mut Client as usize;
+        match spawn_thread(THREAD_STACK, client_main, ptr) {
+            Ok(t) => threads.push(t),
+            Err(e) => {
+                print(&format!("netbench: cannot start client thread ({})\n", e));
+                STOP.store(true, Ordering::Release);
+                break;
+            }
+        }
+    }
+    sleep_ms(secs * 1000);
+    STOP.store(true, Ordering::Release);
+    for t in threads {
+        t.join();
+    }
+    let elapsed_us = uptime().saturating_sub(t0).max(1);
+    let cpu_after = cpu_snapshot();
+
+    report(&mut workers, mode, elapsed_us);
+    report_cpu(&cpu_before, &cpu_after, elapsed_us);
+}
+
+extern "C" fn client_main(arg: usize) {
+    // SAFETY: main keeps the Client alive until it has joined this thread
+    let c = unsafe { &mut *(arg as *mut Client) };
+    let mut buf = vec![0u8; IO_BUF];
+    let mut conn: Option<TcpStream> = None;
+
+    while !STOP.load(Ordering::Acquire) {
+        if conn.is_none() {
+            match TcpStream::connect(&c.addr) {
+                Ok(s) => {
+                    // Small requests must not sit behind Nagle; failure only
+                    // costs latency, so it is not an error.
+                    let _ = s.set_nodelay(true);
+                    c.connects += 1;
+                    conn = Some(s);
+                }
+                Err(_) => {
+                    c.errors += 1;
+                    sleep_ms(10);
+                    continue;
+                }
+            }
+        }
+        let s = conn.as_ref().unwrap();
+        let t = uptime();
+        match exchange(s, &c.request, &mut buf, c.mode) {
+            Ok((body, keep)) => {
+                c.requests += 1;
+                c.bytes += body;
+                if c.lat_us.len() < MAX_SAMPLES {
+                    c.lat_us.push(uptime().saturating_sub(t).min(u32::MAX as u64) as u32);
+                }
+                if !keep {
+                    conn = None;
+                }
+            }
+            Err(ExchangeError::Stopped) => break,
+            Err(_) => {
+                c.errors += 1;
+                conn = None;
+            }
+        }
+    }
+}
+
+/// A request failed; `Stopped` = the run ended mid-body (not an error)
+enum ExchangeError {
+    Stopped,
+    Io,
+}
+
+/// Send one request and read the whole response. Returns the body length and
+/// whether the connection may be reused.
+fn exchange(s: &TcpStream, req: &[u8], buf: &mut [u8], mode: Mode) -> Result<(u64, bool), ExchangeError> {
+    s.write_all(req).map_err(|_| ExchangeError::Io)?;
+
+    // Read until the end of the headers; the rest of buf is body.
+    let mut have = 0;
+    let hdr_end = loop {
+        if have == buf.len() {
+            return Err(ExchangeError::Io);
+        }
+        let n = read_some(s, &mut buf[have..])?;
+        if n == 0 {
+            return Err(ExchangeError::Io);
+        }
+        have += n;
+        if let Some(p) = find(&buf[..have], b"\r\n\r\n") {
+            break p + 4;
+        }
+    };
+    let head = core::str::from_utf8(&buf[..hdr_end]).map_err(|_| ExchangeError::Io)?;
+    let http10 = head.starts_with("HTTP/1.0");
+    let mut length: Option<u64> = None;
+    let mut close = http10;
+    for line in head.lines().skip(1) {
+        let Some((k, v)) = line.split_once(':') else { continue };
+        let v = v.trim();
+        if k.eq_ignore_ascii_case("content-length") {
+            length = v.parse().ok();
+        } else if k.eq_ignore_ascii_case("connection") {
+            close = v.eq_ignore_ascii_case("close") || (http10 && !v.eq_ignore_ascii_case("keep-alive"));
+        }
+    }
+
+    let mut body = (have - hdr_end) as u64;
+    loop {
+        if length.is_some_and(|l| body >= l) {
+            break;
+        }
+        // bulk streams stop mid-body at the deadline; request/response does not
+        if mode == Mode::Bulk && STOP.load(Ordering::Acquire) {
+            return Err(ExchangeError::Stopped);
+        }
+        let n = read_some(s, buf)?;
+        if n == 0 {
+            if length.is_some() {
+                return Err(ExchangeError::Io);
+            }
+            close = true; // body delimited by EOF
+            break;
+        }
+        body += n as u64;
+    }
+    Ok((body, !close && length.is_some()))
+}
+
+fn read_some(s: &TcpStream, buf: &mut [u8]) -> Result<usize, ExchangeError> {
+    loop {
+        match s.read(buf) {
+            Ok(n) => return Ok(n),
+            Err(e) if e.kind == ErrorKind::WouldBlock || e.kind == ErrorKind::Interrupted => continue,
+            Err(_) => return Err(ExchangeError::Io),
+        }
+    }
+}
+
+fn find(hay: &[u8], needle: &[u8]) -> Option<usize> {
+    hay.windows(needle.len()).position(|w| w == needle)
+}
+
+fn report(workers: &mut [Box<Client>], mode: Mode, elapsed_us: u64) {
+    let mut requests = 0u64;
+    let mut errors = 0u64;
+    let mut connects = 0u64;
+    let mut bytes = 0u64;
+    let mut lat: Vec<u32> = Vec::new();
+    for w in workers.iter_mut() {
+        requests += w.requests;
+        errors += w.errors;
+        connects += w.connects;
+        bytes += w.bytes;
+        lat.append(&mut w.lat_us);
+    }
+    lat.sort_unstable();
+
+    print(&format!(
+        "netbench: {} requests, {} errors, {} connects in {} ms\n",
+        requests,
+        errors,
+        connects,
+        elapsed_us / 1000
+    ));
+    if mode == Mode::Http {
+        print(&format!(
+            "netbench: rps={} p50={}us p99={}us max={}us\n",
+            requests * 1_000_000 / elapsed_us,
+            percentile(&lat, 50),
+            percentile(&lat, 99),
+            lat.last().copied().unwrap_or(0)
+        ));
+    }
+    // bulk counts the partial last body too, so bytes/elapsed is the stream rate
+    print(&format!(
+        "netbench: throughput={} KB/s ({} bytes of body)\n",
+        bytes * 1000 / elapsed_us,
+        bytes
+    ));
+}
+
+/// Nearest-rank percentile of sorted samples
+fn percentile(sorted: &[u32], pct: usize) -> u32 {
+    if sorted.is_empty() {
+        return 0;
+    }
+    let rank = (sorted.len() * pct).div_ceil(100).max(1);
+    sorted[rank - 1]
+}
+
+// ============================================================================
+// CPU accounting
+// ============================================================================
+
+fn cpu_snapshot() -> Vec<ThreadCpuStat> {
+    let mut stats = vec![ThreadCpuStat::default(); MAX_THREADS];
+    let n = get_cpu_stats(&mut stats);
+    stats.truncate(n);
+    stats
+}
+
+/// CPU time used during the run: this process, every other box with threads
+/// that ran, and threads owned by no process (kernel threads, including the
+/// boot/idle thread 0, so compare that column between runs, not absolutely).
+fn report_cpu(before: &[ThreadCpuStat], after: &[ThreadCpuStat], elapsed_us: u64) {
+    let me = getpid();
+    let mut own = 0u64;
+    let mut kernel = 0u64;
+    let mut boxes: Vec<(u64, u64)> = Vec::new();
+    for a in after {
+        // a slot reused by a new thread counts from zero
+        let b = before.iter().find(|b| b.tid == a.tid && b.pid == a.pid);
+        let d = a.total_time_us.saturating_sub(b.map_or(0, |b| b.total_time_us));
+        if d == 0 {
+            continue;
+        }
+        if a.pid == me {
+            own += d;
+        } else if a.pid == 0 {
+            kernel += d;
+        } else if let Some(e) = boxes.iter_mut().find(|e| e.0 == a.box_id) {
+            e.1 += d;
+        } else {
+            boxes.push((a.box_id, d));
+        }
+    }
+    let mut line = format!(
+        "netbench: cpu self={}ms ({}%)",
+        own / 1000,
+        own * 100 / elapsed_us
+    );
+    boxes.sort_unstable();
+    for (id, d) in boxes {
+        line.push_str(&format!(" box{}={}ms ({}%)", id, d / 1000, d * 100 / elapsed_us));
+    }
+    line.push_str(&format!(" kthreads={}ms\n", kernel / 1000));
+    print(&line);
+}
+
+// ============================================================================
+// Server side
+// ============================================================================
+
+fn serve() {
+    let port = arg(2)
+        .and_then(|s| s.trim().parse::<u16>().ok())
+        .unwrap_or(DEFAULT_SERVE_PORT);
+    let listener = match TcpListener::bind(&format!("0.0.0.0:{}", port)) {
+        Ok(l) => l,
+        Err(e) => {
+            print(&format!("netbench: bind failed: {:?}\n", e));
+            exit(1);
+        }
+    };
+    print(&format!("netbench: serving on port {}\n", port));
+
+    loop {
+        match listener.accept() {
+            Ok((stream, _addr)) => {
+                // The tail of a /bytes body is a small segment too.
+                let _ = stream.set_nodelay(true);
+                let ptr = Box::into_raw(Box::new(stream)) as usize;
+                // Threads are not joined: each exits when its peer closes.
+                // Their stacks stay mapped, bounded by the thread table.
+                match spawn_thread(THREAD_STACK, conn_main, ptr) {
+                    Ok(t) => core::mem::forget(t),
+                    Err(_) => {
+                        // SAFETY: the thread did not start, so we still own it
+                        drop(unsafe { Box::from_raw(ptr as *mut TcpStream) });
+                        sleep_ms(10);
+                    }
+                }
+            }
+            Err(e) => {
+                if e.kind != ErrorKind::WouldBlock {
+                    print(&format!("netbench: accept error: {:?}\n", e));
+                }
+                sleep_ms(1);
+            }
+        }
+    }
+}
+
+extern "C" fn conn_main(arg: usize) {
+    // SAFETY: handed over by serve() via Box::into_raw
+    let s = unsafe { Box::from_raw(arg as *mut TcpStream) };
+    let mut buf = vec![0u8; IO_BUF];
+    let fill = vec![b'x'; IO_BUF];
+    let mut have = 0;
+    loop {
+        // serve every complete request in the buffer (pipelining works too)
+        while let Some(end) = find(&buf[..have], b"\r\n\r\n") {
+            let len = request_len(&buf[..end]);
+            let ok = respond(&s, len, &fill);
+            buf.copy_within(end + 4..have, 0);
+            have -= end + 4;
+            if !ok {
+                return;
+            }
+        }
+        if have == buf.len() {
+            return; // oversized request head
+        }
+        match read_some(&s, &mut buf[have..]) {
+            Ok(0) | Err(_) => return,
+            Ok(n) => have += n,
+        }
+    }
+}
+
+/// Body length for a request head: `/bytes/<n>` or 64.
+fn request_len(head: &[u8]) -> u64 {
+    let line = head.split(|&b| b == b'\r').next().unwrap_or(&[]);
+    let path = line.split(|&b| b == b' ').nth(1).unwrap_or(&[]);
+    path.strip_prefix(b"/bytes/")
+        .and_then(|n| core::str::from_utf8(n).ok())
+        .and_then(|n| n.parse().ok())
+        .unwrap_or(64)
+}
+
+fn respond(s: &TcpStream, len: u64, fill: &[u8]) -> bool {
+    // Head and first chunk in one write: a separate small head write would
+    // wait out the peer's delayed ACK (Nagle) on every keep-alive request.
+    let mut first = format!(
+        "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: {}\r\n\r\n",
+        len
+    )
+    .into_bytes();
+    let n = len.min(fill.len() as u64) as usize;
+    first.extend_from_slice(&fill[..n]);
+    if s.write_all(&first).is_err() {
+        return false;
+    }
+    let mut left = len - n as u64;
+    while left > 0 {
+        let n = left.min(fill.len() as u64) as usize;
+        if s.write_all(&fill[..n]).is_err() {
+            return false;
+        }
+        left -= n as u64;
+    }
+    true
+}
@@ -0,0 +1,41 @@
+// bigint_bench.js — BigInt multiplication up to 1M decimal digits, where
+// libbf's NTT runs each modulus on its own thread.
+//
+// Usage: qjs /bin/bigint_bench.js   (copied to /bin by build.sh --with-bench)
+// Run it on VMs with 1, 2 and 4 vCPUs. Output: one line per operand size,
+// with the best of REPS products checked modulo a small prime:
+//   mul digits D ms T
+// The operands are powers of 7, built once per size before timing.
+
+const SIZES = [10000, 100000, 1000000];
+const REPS = 5;
+const CHECK = 1000003n;
+
+function modpow(b, e, m) {
+    let r = 1n;
+    b %= m;
+    while (e > 0n) {
+        if (e & 1n) r = r * b % m;
+        b = b * b % m;
+        e >>= 1n;
+    }
+    return r;
+}
+
+for (const digits of SIZES) {
+    // 7^e has about e * log10(7) digits
+    const ea = BigInt(Math.ceil(digits / Math.log10(7)));
+    const eb = ea * 9n / 10n;
+    const a = 7n ** ea;
+    const b = 7n ** eb + 1n;
+    const want = modpow(7n, ea, CHECK) * ((modpow(7n, eb, CHECK) + 1n) % CHECK) % CHECK;
+    let best = Infinity;
+    let ok = true;
+    for (let i = 0; i < REPS; i++) {
+        const start = Date.now();
+        const p = a * b;
+        best = Math.min(best, Date.now() - start);
+        ok = ok && p % CHECK === want;
+    }
+    console.log(`mul digits ${digits} ms ${best}${ok ? "" : " MISMATCH"}`);
+}
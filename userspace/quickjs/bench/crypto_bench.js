@@ -0,0 +1,148 @@
+// crypto_bench.js — Akuma.crypto throughput (SHA-256, SHA-1, CRC32C, AES-CTR)
+// against a plain-JS SHA-256 over a Uint8Array.
+//
+// Usage: qjs /bin/crypto_bench.js        (copied to /bin by build.sh --with-bench)
+//        QJS_CRYPTO_HW=0 qjs /bin/crypto_bench.js   for the portable Rust code
+// Output: known-answer checks, which paths use the ARMv8 extensions, then one
+// line per operation:
+//   op bytes reps ms MBps
+
+const MIN_MS = 200;
+const crypto = Akuma.crypto;
+
+function hex(buf) {
+    return Array.from(new Uint8Array(buf), b => b.toString(16).padStart(2, "0")).join("");
+}
+
+function bytes(s) {
+    return new Uint8Array(Array.from(s, c => c.charCodeAt(0)));
+}
+
+function unhex(s) {
+    const out = new Uint8Array(s.length / 2);
+    for (let i = 0; i < out.length; i++)
+        out[i] = parseInt(s.substr(2 * i, 2), 16);
+    return out;
+}
+
+// The SP 800-38A F.5.1 vector, fed in two uneven chunks
+function ctrVector() {
+    const c = crypto.createCipher("aes-ctr", unhex("2b7e151628aed2a6abf7158809cf4f3c"),
+        unhex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+    const pt = unhex("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51");
+    return hex(c.update(pt.subarray(0, 5))) + hex(c.update(pt.subarray(5)));
+}
+
+const checks = [
+    ["sha256('abc')", hex(crypto.sha256(bytes("abc"))),
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"],
+    ["sha1('abc')", hex(crypto.sha1(bytes("abc"))), "a9993e364706816aba3e25717850c26c9cd0d89d"],
+    ["crc32c('123456789')", crypto.crc32c(bytes("123456789")), 0xe3069283],
+    ["crc32c chained", crypto.crc32c(bytes("6789"), crypto.crc32c(bytes("12345"))), 0xe3069283],
+    ["createHash('sha256') chunked",
+        hex(crypto.createHash("sha256").update(bytes("ab")).update(bytes("c").buffer).digest()),
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"],
+    ["aes-128-ctr", ctrVector(),
+        "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"],
+];
+
+let failed = 0;
+for (const [expr, got, want] of checks) {
+    if (got !== want) {
+        console.log("FAIL " + expr + " = " + got + ", want " + want);
+        failed++;
+    }
+}
+console.log("# known answers: " + (checks.length - failed) + "/" + checks.length + " ok");
+const hw = crypto.hardware;
+console.log("# hardware: " + (Object.keys(hw).filter(k => hw[k]).join(",") || "none"));
+
+// Plain-JS SHA-256, the way scripts hashed before Akuma.crypto
+const K = new Uint32Array([
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+]);
+
+function sha256js(data) {
+    const len = data.length;
+    const padded = new Uint8Array(((len + 9 + 63) >> 6) << 6);
+    padded.set(data);
+    padded[len] = 0x80;
+    const dv = new DataView(padded.buffer);
+    dv.setUint32(padded.length - 8, Math.floor(len / 0x20000000));
+    dv.setUint32(padded.length - 4, len << 3);
+    const h = new Uint32Array([0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19]);
+    const w = new Uint32Array(64);
+    for (let off = 0; off < padded.length; off += 64) {
+        for (let i = 0; i < 16; i++)
+            w[i] = dv.getUint32(off + 4 * i);
+        for (let i = 16; i < 64; i++) {
+            const a = w[i - 15], b = w[i - 2];
+            const s0 = (a >>> 7 | a << 25) ^ (a >>> 18 | a << 14) ^ (a >>> 3);
+            const s1 = (b >>> 17 | b << 15) ^ (b >>> 19 | b << 13) ^ (b >>> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        let [a, b, c, d, e, f, g, hh] = h;
+        for (let i = 0; i < 64; i++) {
+            const s1 = (e >>> 6 | e << 26) ^ (e >>> 11 | e << 21) ^ (e >>> 25 | e << 7);
+            const t1 = (hh + s1 + ((e & f) ^ (~e & g)) + K[i] + w[i]) | 0;
+            const s0 = (a >>> 2 | a << 30) ^ (a >>> 13 | a << 19) ^ (a >>> 22 | a << 10);
+            const t2 = (s0 + ((a & b) ^ (a & c) ^ (b & c))) | 0;
+            hh = g; g = f; f = e; e = (d + t1) | 0;
+            d = c; c = b; b = a; a = (t1 + t2) | 0;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+    const out = new DataView(new ArrayBuffer(32));
+    h.forEach((v, i) => out.setUint32(4 * i, v));
+    return out.buffer;
+}
+
+if (hex(sha256js(bytes("abc"))) !== checks[0][2])
+    console.log("FAIL sha256js('abc')");
+
+function time(fn) {
+    let reps = 1;
+    for (;;) {
+        const t0 = Date.now();
+        for (let i = 0; i < reps; i++)
+            fn();
+        const ms = Date.now() - t0;
+        if (ms >= MIN_MS)
+            return [reps, ms];
+        reps *= ms > 0 ? Math.min(8, Math.ceil(MIN_MS * 1.2 / ms)) : 8;
+    }
+}
+
+function report(op, bytes, fn) {
+    const [reps, ms] = time(fn);
+    console.log(op + " " + bytes + " " + reps + " " + ms + " " + (bytes * reps / ms / 1000).toFixed(2));
+}
+
+const big = new Uint8Array(1 << 20);
+for (let i = 0; i < big.length; i++)
+    big[i] = (i * 2654435761) >>> 24;
+const small = big.subarray(0, 64 * 1024);
+const key = big.subarray(0, 32), iv = big.subarray(32, 48);
+
+console.log("# op bytes reps ms MBps");
+report("sha256-js", small.length, () => sha256js(small));
+report("sha256", big.length, () => crypto.sha256(big));
+report("sha1", big.length, () => crypto.sha1(big));
+report("crc32c", big.length, () => crypto.crc32c(big));
+report("aes-256-ctr", big.length, () => crypto.createCipher("aes-ctr", key, iv).update(big));
+// Streaming in 4 KB chunks, the shape of hashing a file read piecewise
+report("sha256-4k", big.length, () => {
+    const h = crypto.createHash("sha256");
+    for (let off = 0; off < big.length; off += 4096)
+        h.update(big.subarray(off, off + 4096));
+    h.digest();
+});
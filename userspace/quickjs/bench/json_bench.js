@@ -0,0 +1,104 @@
+// json_bench.js — number-heavy JSON.parse / JSON.stringify under qjs (number
+// conversion is cshim/dtoa.c: Eisel-Lemire strtod, Schubfach shortest dtoa).
+//
+// Usage: qjs json_bench.js              (copied to /bin by build.sh --with-bench)
+// Output: spot checks, a round-trip count, then one line per operation:
+//   op bytes reps ms MBps
+
+const MIN_MS = 200;
+
+const checks = [
+    ["String(0.1)", String(0.1), "0.1"],
+    ["String(0.1 + 0.2)", String(0.1 + 0.2), "0.30000000000000004"],
+    ["String(1e21)", String(1e21), "1e+21"],
+    ["String(123456789012345680000)", String(123456789012345680000), "123456789012345680000"],
+    ["String(5e-324)", String(5e-324), "5e-324"],
+    ["String(-1.7976931348623157e308)", String(-1.7976931348623157e308), "-1.7976931348623157e+308"],
+    ["String(1e-7)", String(1e-7), "1e-7"],
+    ["String(0.000001)", String(0.000001), "0.000001"],
+    ["(1.005).toFixed(2)", (1.005).toFixed(2), "1.00"],
+    ["(0.5).toFixed(0)", (0.5).toFixed(0), "1"],
+    ["(2.5).toPrecision(1)", (2.5).toPrecision(1), "3"],
+    ["(123.456).toExponential(2)", (123.456).toExponential(2), "1.23e+2"],
+    ["(0).toPrecision(3)", (0).toPrecision(3), "0.00"],
+    ["parseFloat('2.2250738585072011e-308')", parseFloat("2.2250738585072011e-308"), 2.225073858507201e-308],
+    ["Number('9007199254740993')", Number("9007199254740993"), 9007199254740992],
+    // 1 + 2^-53 exactly: a tie, rounds to even; one digit more is not
+    ["Number('1.00000000000000011102230246251565404236316680908203125')",
+        Number("1.00000000000000011102230246251565404236316680908203125"), 1],
+    ["Number('1.000000000000000111022302462515654042363166809082031251')",
+        Number("1.000000000000000111022302462515654042363166809082031251"), 1.0000000000000002],
+    ["JSON.parse('[1e400,-0.0]')[0]", JSON.parse("[1e400,-0.0]")[0], Infinity],
+];
+
+let failed = 0;
+for (const [expr, got, want] of checks) {
+    if (got !== want) {
+        console.log("FAIL " + expr + " = " + got + ", want " + want);
+        failed++;
+    }
+}
+console.log("# spot check: " + (checks.length - failed) + "/" + checks.length + " ok");
+
+// Random doubles from random bits: every one must survive String -> Number.
+let seed = 0x2545f491;
+function rand32() {
+    seed ^= seed << 13;
+    seed ^= seed >>> 17;
+    seed ^= seed << 5;
+    return seed >>> 0;
+}
+const f64 = new Float64Array(1);
+const u32 = new Uint32Array(f64.buffer);
+let bad = 0;
+const N_ROUNDTRIP = 20000;
+for (let i = 0; i < N_ROUNDTRIP; i++) {
+    u32[0] = rand32();
+    u32[1] = rand32();
+    const d = f64[0];
+    if (d === d && Number(String(d)) !== d) {
+        if (bad++ < 5)
+            console.log("FAIL round trip " + String(d));
+    }
+}
+console.log("# round trip: " + (N_ROUNDTRIP - bad) + "/" + N_ROUNDTRIP + " ok");
+
+// A telemetry-shaped payload: mostly fractional doubles, some integers and
+// exponents, little string content.
+const rows = [];
+for (let i = 0; i < 2000; i++) {
+    rows.push({
+        id: i,
+        t: 1700000000 + i * 0.25,
+        lat: (rand32() / 4294967296) * 180 - 90,
+        lon: (rand32() / 4294967296) * 360 - 180,
+        v: [rand32() / 65536, -(rand32() % 1000) / 7, (rand32() % 100) * 1e-9],
+        ok: (i & 1) === 0,
+    });
+}
+const text = JSON.stringify(rows);
+
+function time(fn) {
+    let reps = 1;
+    for (;;) {
+        const t0 = Date.now();
+        for (let i = 0; i < reps; i++)
+            fn();
+        const ms = Date.now() - t0;
+        if (ms >= MIN_MS)
+            return [reps, ms];
+        reps *= ms > 0 ? Math.min(8, Math.ceil(MIN_MS * 1.2 / ms)) : 8;
+    }
+}
+
+function report(op, bytes, fn) {
+    const [reps, ms] = time(fn);
+    console.log(op + " " + bytes + " " + reps + " " + ms + " " + (bytes * reps / ms / 1000).toFixed(2));
+}
+
+console.log("# op bytes reps ms MBps");
+let parsed;
+report("parse", text.length, () => { parsed = JSON.parse(text); });
+report("stringify", text.length, () => JSON.stringify(parsed));
+if (JSON.stringify(parsed) !== text)
+    console.log("FAIL parse/stringify round trip");
@@ -0,0 +1,96 @@
+// math_bench.js — Math.* throughput under qjs (backed by userspace/cshim/math.c).
+//
+// Usage: qjs math_bench.js              (copied to /bin by build.sh --with-bench)
+// Output: a spot check of known values, then one line per function:
+//   fn calls ms ns_per_call
+// Date.now() has millisecond resolution, so each function runs for at least
+// MIN_MS and the call count is scaled up until it does.
+
+const MIN_MS = 200;
+
+// Values with exactly known doubles; stubs.c-era libm got most of these wrong
+// (pow with a fractional exponent returned 0, sqrt was a fixed Newton loop).
+const checks = [
+    ["Math.sqrt(2)", Math.sqrt(2), 1.4142135623730951],
+    ["Math.pow(2, 0.5)", Math.pow(2, 0.5), 1.4142135623730951],
+    ["Math.pow(10, -2.5)", Math.pow(10, -2.5), 0.0031622776601683794],
+    ["Math.exp(1)", Math.exp(1), 2.718281828459045],
+    ["Math.log(10)", Math.log(10), 2.302585092994046],
+    ["Math.sin(1e6)", Math.sin(1e6), -0.34999350217129294],
+    ["Math.cos(Math.PI)", Math.cos(Math.PI), -1],
+    ["Math.atan2(1, -1)", Math.atan2(1, -1), 2.356194490192345],
+    ["Math.floor(2 ** 63 + 2048)", Math.floor(2 ** 63 + 2048), 9223372036854778000],
+    ["Math.round(-2.5)", Math.round(-2.5), -2],
+    ["Math.cbrt(27)", Math.cbrt(27), 3],
+    ["Math.hypot(3, 4)", Math.hypot(3, 4), 5],
+];
+
+let failed = 0;
+for (const [expr, got, want] of checks) {
+    if (got !== want) {
+        console.log("FAIL " + expr + " = " + got + ", want " + want);
+        failed++;
+    }
+}
+console.log("# spot check: " + (checks.length - failed) + "/" + checks.length + " ok");
+
+// Inputs cycle through a small table so the loop body is the call, not the
+// argument computation.
+const N_ARGS = 256;
+const args = new Float64Array(N_ARGS);
+const pos = new Float64Array(N_ARGS);
+const unit = new Float64Array(N_ARGS);
+let seed = 12345;
+for (let i = 0; i < N_ARGS; i++) {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    const r = seed / 0x7fffffff;
+    args[i] = (r - 0.5) * 200;
+    pos[i] = r * 1000 + 1e-3;
+    unit[i] = r * 2 - 1;
+}
+
+const benches = [
+    ["sqrt", pos, Math.sqrt],
+    ["floor", args, Math.floor],
+    ["round", args, Math.round],
+    ["trunc", args, Math.trunc],
+    ["exp", args, Math.exp],
+    ["log", pos, Math.log],
+    ["log2", pos, Math.log2],
+    ["sin", args, Math.sin],
+    ["cos", args, Math.cos],
+    ["tan", args, Math.tan],
+    ["atan", args, Math.atan],
+    ["asin", unit, Math.asin],
+    ["tanh", args, Math.tanh],
+    ["cbrt", args, Math.cbrt],
+    ["pow", pos, (x) => Math.pow(x, 1.7)],
+    ["atan2", args, (x) => Math.atan2(x, 3.5)],
+    ["hypot", args, (x) => Math.hypot(x, 3.5)],
+];
+
+function run(fn, input, calls) {
+    let acc = 0;
+    for (let i = 0; i < calls; i++)
+        acc += fn(input[i & (N_ARGS - 1)]);
+    return acc;
+}
+
+let sink = 0;
+console.log("# fn calls ms ns_per_call");
+for (const [name, input, fn] of benches) {
+    let calls = 1 << 14;
+    let ms;
+    for (;;) {
+        const t0 = Date.now();
+        sink += run(fn, input, calls);
+        ms = Date.now() - t0;
+        if (ms >= MIN_MS)
+            break;
+        calls *= ms > 0 ? Math.min(8, Math.ceil(MIN_MS * 1.2 / ms)) : 8;
+    }
+    console.log(name + " " + calls + " " + ms + " " + (ms * 1e6 / calls).toFixed(1));
+}
+// Keep the results observable so no call is skipped.
+if (sink !== sink)
+    console.log("# (NaN checksum)");
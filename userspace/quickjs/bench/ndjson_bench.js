@@ -0,0 +1,61 @@
+// ndjson_bench.js — record streaming with Akuma.jsonStream against parsing the
+// whole input at once.
+//
+// Usage: qjs /bin/ndjson_bench.js   (copied to /bin by build.sh --with-bench)
+// Builds RECORDS records of NDJSON in memory, then parses them by splitting
+// the whole string, through jsonStream in 64 KB chunks, and as one
+// top-level array with { elements: true }. Output: one line per way:
+//   op bytes records ms MBps
+
+const RECORDS = 50000;
+const CHUNK = 64 * 1024;
+
+function record(i) {
+    return JSON.stringify({ id: i, name: "item-" + i, tags: ["a", "b", i & 7], score: i * 0.5, ok: (i & 1) === 0 });
+}
+
+function row(op, bytes, records, ms) {
+    console.log(op + " " + bytes + " " + records + " " + ms + " " + (bytes / Math.max(ms, 1) / 1000).toFixed(2));
+}
+
+console.log("# op bytes records ms MBps");
+
+function runGenerated() {
+    const lines = [];
+    for (let i = 0; i < RECORDS; i++)
+        lines.push(record(i));
+    const text = lines.join("\n") + "\n";
+    lines.length = 0;
+
+    // Whole input: one string, split, every record parsed and kept
+    let t0 = Date.now();
+    const all = text.split("\n").filter(l => l !== "").map(l => JSON.parse(l));
+    row("split+parse", text.length, all.length, Date.now() - t0);
+
+    // Streaming: 64 KB chunks, each record dropped after use
+    t0 = Date.now();
+    const js = Akuma.jsonStream();
+    let n = 0;
+    for (let off = 0; off < text.length; off += CHUNK) {
+        for (const rec of js.push(text.slice(off, off + CHUNK)))
+            n += rec.id === n ? 1 : 0;
+    }
+    n += js.end().length;
+    row("jsonStream", text.length, n, Date.now() - t0);
+    if (n !== all.length)
+        console.log("FAIL jsonStream saw " + n + " records, want " + all.length);
+
+    // The same records wrapped in one top-level array
+    const arr = "[" + text.trim().split("\n").join(",\n") + "]";
+    t0 = Date.now();
+    const ja = Akuma.jsonStream({ elements: true });
+    n = 0;
+    for (let off = 0; off < arr.length; off += CHUNK)
+        n += ja.push(arr.slice(off, off + CHUNK)).length;
+    n += ja.end().length;
+    row("jsonStream-array", arr.length, n, Date.now() - t0);
+    if (n !== all.length)
+        console.log("FAIL elements saw " + n + " records, want " + all.length);
+}
+
+runGenerated();
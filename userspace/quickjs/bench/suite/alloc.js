@@ -0,0 +1,20 @@
+// Short-lived objects, arrays and closures, with a small surviving tree
+let keep = [];
+
+function node(depth) {
+    if (depth === 0)
+        return { leaf: true };
+    return { left: node(depth - 1), right: node(depth - 1) };
+}
+
+function bench() {
+    let n = 0;
+    for (let i = 0; i < 5000; i++) {
+        const o = { a: i, b: [i, i + 1, i + 2], f: () => i };
+        n += o.b.length + o.f();
+    }
+    keep.push(node(8));
+    if (keep.length > 16)
+        keep = [];
+    return n;
+}
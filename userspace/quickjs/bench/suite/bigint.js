@@ -0,0 +1,10 @@
+// Multiply 2000-digit BigInts and reduce the product
+const a = 7n ** 2400n;
+const b = 3n ** 4200n;
+
+function bench() {
+    let r = 0n;
+    for (let i = 0; i < 20; i++)
+        r += (a * (b + BigInt(i))) % 1000003n;
+    return Number(r);
+}
@@ -0,0 +1,19 @@
+// JSON.parse + JSON.stringify of a 200-record, 30 KB document
+const records = [];
+for (let i = 0; i < 200; i++) {
+    records.push({
+        id: i,
+        name: "user" + i,
+        email: "user" + i + "@example.org",
+        score: i * 1.25,
+        active: (i & 1) === 0,
+        tags: ["a", "bb", "ccc"].slice(0, 1 + i % 3),
+        pos: { x: i / 7, y: -i / 3 },
+    });
+}
+const text = JSON.stringify(records);
+
+function bench() {
+    const doc = JSON.parse(text);
+    return JSON.stringify(doc).length;
+}
@@ -0,0 +1,21 @@
+// Scan a 35 KB log for request lines and extract their fields
+const methods = ["GET", "POST", "PUT", "DELETE"];
+const lines = [];
+for (let i = 0; i < 800; i++) {
+    if (i % 4 === 3)
+        lines.push("debug: cache miss for key " + i.toString(16));
+    else
+        lines.push("10.0." + (i & 255) + "." + (i % 7) + " " + methods[i % 4] +
+                   " /api/v1/items/" + i + "?q=" + i * 3 + " " + (200 + i % 5) + " " + i * 17);
+}
+const log = lines.join("\n");
+const re = /^(\d+\.\d+\.\d+\.\d+) (GET|POST|PUT|DELETE) (\S+) (\d{3}) (\d+)$/gm;
+
+function bench() {
+    let bytes = 0;
+    re.lastIndex = 0;
+    let m;
+    while ((m = re.exec(log)) !== null)
+        bytes += +m[5];
+    return bytes;
+}
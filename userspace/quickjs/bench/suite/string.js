@@ -0,0 +1,10 @@
+// Build a 60 KB string by concatenation, template literals and join
+function bench() {
+    let s = "";
+    for (let i = 0; i < 2000; i++)
+        s += `<li id="item-${i}">` + i.toString(36) + "</li>\n";
+    const parts = [];
+    for (let i = 0; i < 2000; i++)
+        parts.push(String.fromCharCode(97 + i % 26).repeat(1 + i % 8));
+    return s.length + parts.join(",").length;
+}
@@ -0,0 +1,20 @@
+// Float64Array dot product and Uint8Array histogram over 64K elements
+const N = 65536;
+const x = new Float64Array(N), y = new Float64Array(N);
+const bytes = new Uint8Array(N);
+for (let i = 0; i < N; i++) {
+    x[i] = i * 0.5;
+    y[i] = 1 / (i + 1);
+    bytes[i] = (i * 2654435761) >>> 24;
+}
+const hist = new Uint32Array(256);
+
+function bench() {
+    let dot = 0;
+    for (let i = 0; i < N; i++)
+        dot += x[i] * y[i];
+    hist.fill(0);
+    for (let i = 0; i < N; i++)
+        hist[bytes[i]]++;
+    return dot + hist[0];
+}
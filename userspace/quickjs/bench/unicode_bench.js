@@ -0,0 +1,47 @@
+// unicode_bench.js — case conversion, localeCompare and case-insensitive
+// regexps over ASCII, Latin-1 and mixed-script text under qjs (backed by
+// the libunicode lookup tables that build.rs generates).
+//
+// Usage: qjs /bin/unicode_bench.js   (copied to /bin by build.sh --with-bench)
+// Output: one line per operation and text, the best of REPS runs:
+//   op text MB ms T
+// "mixed" has Greek and Cyrillic words, so it is a 16 bit string.
+
+const MB = 10;
+const REPS = 3;
+
+const samples = {
+    ascii: "The Quick Brown Fox Jumps Over The Lazy Dog, 42 TIMES; ",
+    latin1: "Ça Fait Déjà L'Été À Zürich, Señor Ångström Ôte Ñandú; ",
+    mixed: "Hello Wörld, Καλημέρα Κόσμε, Привет Мир, ASCII Text Again; ",
+};
+
+function build(sample) {
+    return sample.repeat(Math.ceil(MB * 1024 * 1024 / sample.length)).slice(0, MB * 1024 * 1024);
+}
+
+function time(fn) {
+    let best = Infinity;
+    let result;
+    for (let i = 0; i < REPS; i++) {
+        const start = Date.now();
+        result = fn();
+        best = Math.min(best, Date.now() - start);
+    }
+    return [best, result];
+}
+
+for (const name of Object.keys(samples)) {
+    const text = build(samples[name]);
+    const [lowerMs, lower] = time(() => text.toLowerCase());
+    console.log(`toLowerCase ${name} MB ${MB} ms ${lowerMs}`);
+    const [upperMs, upper] = time(() => text.toUpperCase());
+    console.log(`toUpperCase ${name} MB ${MB} ms ${upperMs}`);
+    // Same length both ways here (no ß), so the conversions must round-trip
+    if (upper.toLowerCase() !== lower) console.log(`MISMATCH ${name}`);
+    const [cmpMs] = time(() => lower.localeCompare(text));
+    console.log(`localeCompare ${name} MB ${MB} ms ${cmpMs}`);
+    const re = /lazy|été|κόσμε|again/gi;
+    const [reMs, n] = time(() => text.match(re).length);
+    console.log(`regexp/i ${name} MB ${MB} ms ${reMs} matches ${n}`);
+}
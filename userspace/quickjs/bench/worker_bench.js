@@ -0,0 +1,99 @@
+// worker_bench.js — CPU-bound map-reduce across qjs Workers, plus a 16 MB
+// ArrayBuffer round trip by transfer.
+//
+// Usage: qjs /bin/worker_bench.js   (copied to /bin by build.sh --with-bench)
+// Run it on VMs with 1, 2 and 4 vCPUs. Each Worker loads this same file
+// from SCRIPT. Output: the single-threaded time, one line per worker count,
+// then the transfer timing:
+//   serial primes P ms T
+//   workers N primes P ms T speedup S
+//   transfer MB ms T
+
+const LIMIT = 2000000;
+const CHUNKS = 16;
+const BUF_MB = 16;
+const MAX_WORKERS = 4;
+const SCRIPT = "/bin/worker_bench.js";
+
+function countPrimes(lo, hi) {
+    let n = 0;
+    for (let i = Math.max(lo, 2); i < hi; i++) {
+        let prime = true;
+        for (let d = 2; d * d <= i; d++) {
+            if (i % d === 0) { prime = false; break; }
+        }
+        if (prime) n++;
+    }
+    return n;
+}
+
+// Inside a Worker (which has a global postMessage): count one chunk per
+// message; echo ArrayBuffers back
+if (typeof postMessage === "function") {
+    onmessage = (e) => {
+        const m = e.data;
+        if (m.buf) { postMessage({ buf: m.buf }, [m.buf]); return; }
+        if (m.done) { close(); return; }
+        postMessage({ count: countPrimes(m.lo, m.hi) });
+    };
+} else {
+    main();
+}
+
+function run(nworkers, done) {
+    const start = Date.now();
+    const workers = [];
+    let next = 0, pending = 0, total = 0;
+    const step = LIMIT / CHUNKS;
+    function feed(w) {
+        if (next >= CHUNKS) return false;
+        w.postMessage({ lo: next * step, hi: (next + 1) * step });
+        next++; pending++;
+        return true;
+    }
+    for (let i = 0; i < nworkers; i++) {
+        const w = new Worker(SCRIPT);
+        w.onmessage = (e) => {
+            total += e.data.count;
+            pending--;
+            if (!feed(w) && pending === 0) {
+                workers.forEach((x) => x.postMessage({ done: true }));
+                done(total, Date.now() - start);
+            }
+        };
+        workers.push(w);
+    }
+    workers.forEach((w) => feed(w));
+}
+
+function transfer(done) {
+    const w = new Worker(SCRIPT);
+    const buf = new ArrayBuffer(BUF_MB * 1024 * 1024);
+    new Uint8Array(buf)[0] = 7;
+    const start = Date.now();
+    w.onmessage = (e) => {
+        const ms = Date.now() - start;
+        const ok = buf.byteLength === 0 && new Uint8Array(e.data.buf)[0] === 7;
+        console.log(`transfer ${BUF_MB} ms ${ms}${ok ? "" : " FAILED"}`);
+        w.terminate();
+        done();
+    };
+    w.postMessage({ buf }, [buf]);
+}
+
+function main() {
+    const serialStart = Date.now();
+    const expect = countPrimes(0, LIMIT);
+    const serialMs = Date.now() - serialStart;
+    console.log(`serial primes ${expect} ms ${serialMs}`);
+    const counts = [];
+    for (let n = 1; n <= MAX_WORKERS; n *= 2) counts.push(n);
+    (function next(i) {
+        if (i === counts.length) { transfer(() => {}); return; }
+        run(counts[i], (total, ms) => {
+            const speedup = (serialMs / ms).toFixed(2);
+            console.log(`workers ${counts[i]} primes ${total}${total === expect ? "" : " MISMATCH"} ms ${ms} speedup ${speedup}`);
+            next(i + 1);
+        });
+    })(0);
+}
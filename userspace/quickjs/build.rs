@@ -3,6 +3,10 @@
 //! This compiles the QuickJS engine with flags suitable for
 //! a no_std environment without OS support.
 
+use std::env;
+use std::path::PathBuf;
+use std::process::Command;
+
 fn main() {
     println!("cargo:rerun-if-changed=quickjs/quickjs.c");
     println!("cargo:rerun-if-changed=quickjs/quickjs.h");
@@ -10,7 +14,29 @@ fn main() {
     println!("cargo:rerun-if-changed=quickjs/libbf.c");
     println!("cargo:rerun-if-changed=quickjs/libregexp.c");
     println!("cargo:rerun-if-changed=quickjs/libunicode.c");
+    println!("cargo:rerun-if-changed=quickjs/libunicode-table.h");
+    println!("cargo:rerun-if-changed=quickjs/unicode_fast_gen.c");
     println!("cargo:rerun-if-changed=quickjs/stubs.c");
+    println!("cargo:rerun-if-changed=../cshim");
+
+    // Shared freestanding mem*/str*/qsort/libm/strtod/printf routines (userspace/cshim).
+    // Built at -O2 regardless of the size-optimized release profile: these are
+    // the hottest loops in the engine (string concat, array growth, GC
+    // compaction, Math.*, number parsing and printing).
+    cc::Build::new()
+        .file("../cshim/mem.c")
+        .file("../cshim/string.c")
+        .file("../cshim/qsort.c")
+        .file("../cshim/math.c")
+        .file("../cshim/dtoa.c")
+        .file("../cshim/printf.c")
+        .file("../cshim/setjmp.S")
+        .include("../cshim")
+        .flag("-ffreestanding")
+        .flag("-fno-builtin")
+        .flag("-nostdinc")
+        .opt_level(2)
+        .compile("cshim");
 
     // Compile our stubs first
     cc::Build::new()
@@ -22,6 +48,9 @@ fn main() {
         .flag("-w")
         .compile("stubs");
 
+    let out_dir = PathBuf::from(env::var("OUT_DIR").unwrap());
+    gen_unicode_fast(&out_dir);
+
     // Compile QuickJS with our custom headers
     cc::Build::new()
         .file("quickjs/quickjs.c")
@@ -31,6 +60,10 @@ fn main() {
         .file("quickjs/libunicode.c")
         // Use our shim headers
         .include("quickjs")
+        // cshim/dtoa.h: number <-> string conversion for js_ecvt/js_fcvt
+        .include("../cshim")
+        // libunicode-fast.h from gen_unicode_fast
+        .include(&out_dir)
         // No standard includes - use our shims
         .flag("-nostdinc")
         // Freestanding environment flags
@@ -44,5 +77,40 @@ fn main() {
         .define("CONFIG_BIGNUM", None)
         // Disable features that require OS support
         .define("EMSCRIPTEN", None)
+        // EMSCRIPTEN also turns the stack check off, but it only compares
+        // the frame address with the limit from JS_SetMaxStackSize, so deep
+        // recursion throws a RangeError instead of running off the stack.
+        .define("CONFIG_STACK_CHECK", None)
+        // EMSCRIPTEN turns atomics off; stubs.c provides real futex-backed
+        // pthread mutexes and condition variables, so Atomics.* and
+        // SharedArrayBuffer are safe across Worker threads.
+        .define("CONFIG_ATOMICS", None)
         .compile("quickjs");
 }
+
+/// Build and run the host tool quickjs/unicode_fast_gen.c, which writes the
+/// two-level BMP lookup tables of libunicode-fast.h into `out_dir`. It
+/// includes libunicode.c itself, so the tables always match
+/// libunicode-table.h. `-iquote` keeps the shim headers away from the
+/// host's libc.
+fn gen_unicode_fast(out_dir: &PathBuf) {
+    let host = env::var("HOST").unwrap();
+    let gen = out_dir.join("unicode_fast_gen");
+    let status = cc::Build::new()
+        .host(&host)
+        .target(&host)
+        .opt_level(2)
+        .cargo_metadata(false)
+        .get_compiler()
+        .to_command()
+        .args(["-w", "-iquote", "quickjs", "quickjs/unicode_fast_gen.c", "quickjs/cutils.c", "-o"])
+        .arg(&gen)
+        .status()
+        .expect("failed to run the host C compiler");
+    assert!(status.success(), "compiling unicode_fast_gen failed");
+    let status = Command::new(&gen)
+        .arg(out_dir.join("libunicode-fast.h"))
+        .status()
+        .expect("failed to run unicode_fast_gen");
+    assert!(status.success(), "unicode_fast_gen failed");
+}
@@ -38,5 +38,6 @@ extern int errno;
 #define EPIPE 32
 #define EDOM 33
 #define ERANGE 34
+#define ETIMEDOUT 110
 
 #endif /* _ERRNO_H */
@@ -42,6 +42,14 @@
 #define USE_FFT_MUL
 /* enable decimal floating point support */
 #define USE_BF_DEC
+#ifdef CONFIG_ATOMICS
+/* run the NTT convolutions of large products on several threads */
+#define USE_FFT_THREADS
+#endif
+#endif
+
+#ifdef USE_FFT_THREADS
+#include <pthread.h>
 #endif
 
 //#define inline __attribute__((always_inline))
@@ -7976,6 +7984,131 @@ static int ntt_conv(BFNTTState *s, NTTLimb *buf1, NTTLimb *buf2,
     return 0;
 }
 
+#ifdef USE_FFT_THREADS
+
+/* fft_len_log2 from which fft_mul() convolves each modulus on its own
+   thread */
+#define FFT_THREADS_LOG2_MIN 15
+
+/* Allocator shared by the jobs of a parallel convolution: the context
+   allocator, serialized (QuickJS accounts for its memory in the runtime
+   without locking) */
+typedef struct {
+    pthread_mutex_t lock;
+    bf_context_t *ctx;
+} NTTThreadAlloc;
+
+/* One modulus of a parallel convolution. The job has private copies of
+   the context and NTT state that allocate through NTTThreadAlloc; the
+   trig tables are shared read-only. */
+typedef struct {
+    bf_context_t ctx;
+    BFNTTState state;
+    NTTLimb *buf1, *buf2;
+    int k;
+    int m_idx;
+    int ret;
+} NTTConvJob;
+
+static void *ntt_thread_realloc(void *opaque, void *ptr, size_t size)
+{
+    NTTThreadAlloc *a = opaque;
+    void *ret;
+
+    pthread_mutex_lock(&a->lock);
+    ret = bf_realloc(a->ctx, ptr, size);
+    pthread_mutex_unlock(&a->lock);
+    return ret;
+}
+
+/* compute the trig tables used by ntt_conv() so that it does not modify
+   the NTT state */
+static int ntt_prepare_trig(BFNTTState *s, int k, int m_idx)
+{
+    int k1, l, inverse;
+
+    while (k > 0) {
+        if (k <= NTT_TRIG_K_MAX)
+            k1 = k;
+        else
+            k1 = bf_min(k / 2, NTT_TRIG_K_MAX);
+        for(inverse = 0; inverse < 2; inverse++) {
+            for(l = 2; l <= k1; l++) {
+                if (!get_trig(s, l, inverse, m_idx))
+                    return -1;
+            }
+        }
+        k -= k1;
+    }
+    return 0;
+}
+
+static void *ntt_conv_thread(void *opaque)
+{
+    NTTConvJob *job = opaque;
+    job->ret = ntt_conv(&job->state, job->buf1, job->buf2,
+                        job->k, job->k, job->m_idx);
+    return NULL;
+}
+
+/* ntt_conv() of the nb_mods moduli stored one after the other in buf1
+   and buf2. The calling thread does the first modulus and any modulus
+   whose thread cannot be started. */
+static int ntt_conv_parallel(BFNTTState *s, NTTLimb *buf1, NTTLimb *buf2,
+                             int k, int first_m_idx, int nb_mods)
+{
+    NTTThreadAlloc alloc;
+    NTTConvJob *jobs, *job;
+    pthread_t threads[NB_MODS];
+    BOOL started[NB_MODS];
+    limb_t fft_len;
+    int j, ret;
+
+    for(j = 0; j < nb_mods; j++) {
+        if (ntt_prepare_trig(s, k, first_m_idx + j))
+            return -1;
+    }
+    jobs = ntt_malloc(s, sizeof(jobs[0]) * nb_mods);
+    if (!jobs)
+        return -1;
+    pthread_mutex_init(&alloc.lock, NULL);
+    alloc.ctx = s->ctx;
+    fft_len = (limb_t)1 << k;
+    for(j = 0; j < nb_mods; j++) {
+        job = &jobs[j];
+        job->ctx = *s->ctx;
+        job->ctx.realloc_opaque = &alloc;
+        job->ctx.realloc_func = ntt_thread_realloc;
+        job->ctx.ntt_state = &job->state;
+        job->state = *s;
+        job->state.ctx = &job->ctx;
+        job->buf1 = buf1 + fft_len * j;
+        job->buf2 = buf2 + fft_len * j;
+        job->k = k;
+        job->m_idx = first_m_idx + j;
+        job->ret = 0;
+    }
+    started[0] = FALSE;
+    for(j = 1; j < nb_mods; j++) {
+        started[j] = (pthread_create(&threads[j], NULL,
+                                     ntt_conv_thread, &jobs[j]) == 0);
+    }
+    for(j = 0; j < nb_mods; j++) {
+        if (!started[j])
+            ntt_conv_thread(&jobs[j]);
+    }
+    ret = 0;
+    for(j = 0; j < nb_mods; j++) {
+        if (started[j])
+            pthread_join(threads[j], NULL);
+        ret |= jobs[j].ret;
+    }
+    pthread_mutex_destroy(&alloc.lock);
+    ntt_free(s, jobs);
+    return ret;
+}
+
+#endif /* USE_FFT_THREADS */
 
 static no_inline void limb_to_ntt(BFNTTState *s,
                                   NTTLimb *tabr, limb_t fft_len,
@@ -8367,7 +8500,7 @@ static no_inline int fft_mul(bf_context_t *s1,
                              limb_t *b_tab, limb_t b_len, int mul_flags)
 {
     BFNTTState *s;
-    int dpl, fft_len_log2, j, nb_mods, reduced_mem;
+    int dpl, fft_len_log2, j, nb_mods, reduced_mem, parallel;
     slimb_t len, fft_len;
     NTTLimb *buf1, *buf2, *ptr;
 #if defined(USE_MUL_CHECK)
@@ -8411,10 +8544,24 @@ static no_inline int fft_mul(bf_context_t *s1,
             bf_resize(res, 0);
     }
     reduced_mem = (fft_len_log2 >= 14);
-    if (!reduced_mem) {
+    parallel = FALSE;
+#ifdef USE_FFT_THREADS
+    /* the threads need all the moduli of 'b' at once; fall back to
+       the reduced memory version if they do not fit */
+    if (fft_len_log2 >= FFT_THREADS_LOG2_MIN) {
         buf2 = ntt_malloc(s, sizeof(NTTLimb) * fft_len * nb_mods);
-        if (!buf2)
-            goto fail;
+        if (buf2) {
+            parallel = TRUE;
+            reduced_mem = FALSE;
+        }
+    }
+#endif
+    if (!reduced_mem) {
+        if (!parallel) {
+            buf2 = ntt_malloc(s, sizeof(NTTLimb) * fft_len * nb_mods);
+            if (!buf2)
+                goto fail;
+        }
         limb_to_ntt(s, buf2, fft_len, b_tab, b_len, dpl,
                     NB_MODS - nb_mods, nb_mods);
         if (!(mul_flags & FFT_MUL_R_NORESIZE))
@@ -8424,6 +8571,13 @@ static no_inline int fft_mul(bf_context_t *s1,
         if (!buf2)
             goto fail;
     }
+#ifdef USE_FFT_THREADS
+    if (parallel) {
+        if (ntt_conv_parallel(s, buf1, buf2, fft_len_log2,
+                              NB_MODS - nb_mods, nb_mods))
+            goto fail;
+    } else
+#endif
     for(j = 0; j < nb_mods; j++) {
         if (reduced_mem) {
             limb_to_ntt(s, buf2, fft_len, b_tab, b_len, dpl,
@@ -103,6 +103,18 @@ static const REOpCode reopcode_info[REOP_COUNT] = {
 
 #define RE_HEADER_LEN 7
 
+/* REOP_prefilter payload: flags, literal length, a bitmap of the chars
+   < 256 a match can start with, then the literal */
+#define RE_PREFILTER_FLAGS   0
+#define RE_PREFILTER_LIT_LEN 1
+#define RE_PREFILTER_BITMAP  2
+#define RE_PREFILTER_LIT     (RE_PREFILTER_BITMAP + 32)
+
+#define RE_PREFILTER_HIGH    (1 << 0) /* may also start with a char >= 256 */
+#define RE_PREFILTER_LITERAL (1 << 1) /* the regexp is just the literal */
+
+#define RE_PREFILTER_LIT_MAX 64
+
 static inline int is_digit(int c) {
     return c >= '0' && c <= '9';
 }
@@ -326,6 +338,15 @@ static __maybe_unused void lre_dump_bytecode(const uint8_t *buf,
                 }
             }
             break;
+        case REOP_prefilter:
+            {
+                const uint8_t *pf = buf + pos + 3;
+                len += get_u16(buf + pos + 1);
+                printf(" flags=%d literal=\"%.*s\"", pf[RE_PREFILTER_FLAGS],
+                       pf[RE_PREFILTER_LIT_LEN],
+                       (const char *)pf + RE_PREFILTER_LIT);
+            }
+            break;
         default:
             break;
         }
@@ -1729,12 +1750,145 @@ static int compute_stack_size(const uint8_t *bc_buf, int bc_buf_len)
             val = get_u16(bc_buf + pos + 1);
             len += val * 8;
             break;
+        case REOP_prefilter:
+            len += get_u16(bc_buf + pos + 1);
+            break;
         }
         pos += len;
     }
     return stack_size_max;
 }
 
+static void re_prefilter_set(uint8_t *bitmap, int c)
+{
+    bitmap[c >> 3] |= 1 << (c & 7);
+}
+
+/* Chars < 256 the first atom at 'pc' accepts, for an atom that is a char
+   or a class. Return FALSE for other atoms. */
+static BOOL re_prefilter_atom(REParseState *s, uint8_t *pf, const uint8_t *pc)
+{
+    uint8_t *bitmap = pf + RE_PREFILTER_BITMAP;
+    uint32_t low, high;
+    int c, c1, i, n;
+
+    switch(pc[0]) {
+    case REOP_char:
+    case REOP_char32:
+        c = pc[0] == REOP_char ? get_u16(pc + 1) : get_u32(pc + 1);
+        for(c1 = 0; c1 < 256; c1++) {
+            if ((s->ignore_case ? lre_canonicalize(c1, s->is_utf16) : c1) == c)
+                re_prefilter_set(bitmap, c1);
+        }
+        break;
+    case REOP_range:
+    case REOP_range32:
+        /* inclusive intervals; for REOP_range a last high of 0xffff
+           means no upper bound */
+        n = get_u16(pc + 1);
+        for(c1 = 0; c1 < 256; c1++) {
+            c = s->ignore_case ? lre_canonicalize(c1, s->is_utf16) : c1;
+            for(i = 0; i < n; i++) {
+                if (pc[0] == REOP_range) {
+                    low = get_u16(pc + 3 + i * 4);
+                    high = get_u16(pc + 3 + i * 4 + 2);
+                } else {
+                    low = get_u32(pc + 3 + i * 8);
+                    high = get_u32(pc + 3 + i * 8 + 4);
+                }
+                if (c >= low && c <= high) {
+                    re_prefilter_set(bitmap, c1);
+                    break;
+                }
+            }
+        }
+        break;
+    default:
+        return FALSE;
+    }
+    /* under case folding chars >= 256 may map to any of these, and the
+       scan for them is cheap anyway */
+    pf[RE_PREFILTER_FLAGS] |= RE_PREFILTER_HIGH;
+    return TRUE;
+}
+
+/* Find what every match must start with, reading the body of the regexp
+   from 'pos' (after 'save_start 0'): the literal chars it begins with, or
+   else the chars its first atom accepts. Only the ops all matches go
+   through in order are read, so a position that fails the prefilter cannot
+   start a match. Return the payload length, 0 if nothing useful was
+   found. */
+static int re_compute_prefilter(REParseState *s, uint8_t *pf, int pos)
+{
+    const uint8_t *bc = s->byte_code.buf;
+    uint8_t *bitmap = pf + RE_PREFILTER_BITMAP;
+    int lit_len, opcode, c, i;
+    BOOL zero_width;
+
+    memset(pf, 0, RE_PREFILTER_LIT);
+    lit_len = 0;
+    zero_width = FALSE;
+    for(;;) {
+        opcode = bc[pos];
+        switch(opcode) {
+        case REOP_char:
+            c = get_u16(bc + pos + 1);
+            if (s->ignore_case || c >= 256 || lit_len == RE_PREFILTER_LIT_MAX)
+                goto done;
+            pf[RE_PREFILTER_LIT + lit_len++] = c;
+            break;
+        case REOP_save_start:
+        case REOP_save_end:
+        case REOP_save_reset:
+        case REOP_word_boundary:
+        case REOP_not_word_boundary:
+        case REOP_line_start:
+        case REOP_line_end:
+            /* consume nothing */
+            zero_width = TRUE;
+            break;
+        default:
+            goto done;
+        }
+        pos += reopcode_info[opcode].size;
+    }
+ done:
+    if (lit_len > 0) {
+        re_prefilter_set(bitmap, pf[RE_PREFILTER_LIT]);
+        if (!zero_width && bc[pos] == REOP_save_end && bc[pos + 1] == 0 &&
+            bc[pos + 2] == REOP_match)
+            pf[RE_PREFILTER_FLAGS] |= RE_PREFILTER_LITERAL;
+    } else {
+        if (!re_prefilter_atom(s, pf, bc + pos))
+            return 0;
+        for(i = 0; i < 32 && bitmap[i] == 0xff; i++)
+            continue;
+        if (i == 32)
+            return 0;
+    }
+    pf[RE_PREFILTER_LIT_LEN] = lit_len;
+    return RE_PREFILTER_LIT + lit_len;
+}
+
+/* insert REOP_prefilter in front of the search loop */
+static void re_emit_prefilter(REParseState *s, int pos)
+{
+    uint8_t pf[RE_PREFILTER_LIT + RE_PREFILTER_LIT_MAX];
+    uint8_t *p;
+    int len;
+
+    len = re_compute_prefilter(s, pf, pos);
+    if (len == 0)
+        return;
+    /* the regexp works without it if there is no memory */
+    if (dbuf_insert(&s->byte_code, RE_HEADER_LEN, 3 + len))
+        return;
+    p = s->byte_code.buf + RE_HEADER_LEN;
+    p[0] = REOP_prefilter;
+    put_u16(p + 1, len);
+    memcpy(p + 3, pf, len);
+}
+
 /* 'buf' must be a zero terminated UTF-8 string of length buf_len.
    Return NULL if error and allocate an error message in *perror_msg,
    otherwise the compiled bytecode and its length in plen.
@@ -1744,7 +1898,7 @@ uint8_t *lre_compile(int *plen, char *error_msg, int error_msg_size,
                      void *opaque)
 {
     REParseState s_s, *s = &s_s;
-    int stack_size;
+    int stack_size, body_pos;
     BOOL is_sticky;
     
     memset(s, 0, sizeof(*s));
@@ -1779,6 +1933,7 @@ uint8_t *lre_compile(int *plen, char *error_msg, int error_msg_size,
         re_emit_op_u32(s, REOP_goto, -(5 + 1 + 5));
     }
     re_emit_op_u8(s, REOP_save_start, 0);
+    body_pos = s->byte_code.size;
 
     if (re_parse_disjunction(s, FALSE)) {
     error:
@@ -1808,6 +1963,10 @@ uint8_t *lre_compile(int *plen, char *error_msg, int error_msg_size,
         re_parse_error(s, "too many imbricated quantifiers");
         goto error;
     }
+
+    /* a sticky regexp is only tried at one position */
+    if (!is_sticky)
+        re_emit_prefilter(s, body_pos);
     
     s->byte_code.buf[RE_HEADER_CAPTURE_COUNT] = s->capture_count;
     s->byte_code.buf[RE_HEADER_STACK_SIZE] = stack_size;
@@ -2412,6 +2571,78 @@ static intptr_t lre_exec_backtrack(REExecContext *s, uint8_t **capture,
     }
 }
 
+/* first position >= pos where the prefilter 'pf' lets a match start, or
+   -1 */
+static int lre_prefilter_find(REExecContext *s, const uint8_t *pf,
+                              int cindex, int pos, int clen)
+{
+    const uint8_t *bitmap = pf + RE_PREFILTER_BITMAP;
+    int lit_len = pf[RE_PREFILTER_LIT_LEN];
+    BOOL high = (pf[RE_PREFILTER_FLAGS] & RE_PREFILTER_HIGH) != 0;
+    const uint8_t *p;
+    const uint16_t *p16;
+    int c;
+
+    if (pos >= clen)
+        return -1;
+    if (s->cbuf_type == 0) {
+        if (lit_len >= 2) {
+            p = memmem(s->cbuf + pos, clen - pos, pf + RE_PREFILTER_LIT, lit_len);
+        } else if (lit_len == 1) {
+            p = memchr(s->cbuf + pos, pf[RE_PREFILTER_LIT], clen - pos);
+        } else {
+            for(; pos < clen; pos++) {
+                c = s->cbuf[pos];
+                if (bitmap[c >> 3] & (1 << (c & 7)))
+                    return pos;
+            }
+            return -1;
+        }
+        return p ? p - s->cbuf : -1;
+    }
+    p16 = (const uint16_t *)s->cbuf;
+    for(; pos < clen; pos++) {
+        c = p16[pos];
+        if (c < 256 ? !(bitmap[c >> 3] & (1 << (c & 7))) : !high)
+            continue;
+        /* in unicode mode the search loop steps over whole surrogate
+           pairs, so it never starts on the second half of one */
+        if (s->cbuf_type == 2 && pos > cindex && c >= 0xdc00 && c < 0xe000 &&
+            p16[pos - 1] >= 0xd800 && p16[pos - 1] < 0xdc00)
+            continue;
+        return pos;
+    }
+    return -1;
+}
+
+/* same result as running the search loop, but only trying the positions
+   that pass the prefilter. 'pc' is the body after the search loop. */
+static intptr_t lre_exec_prefiltered(REExecContext *s, uint8_t **capture,
+                                     StackInt *stack_buf, const uint8_t *pf,
+                                     const uint8_t *pc, int cindex, int clen)
+{
+    int pos, i, shift;
+    intptr_t ret;
+
+    shift = s->cbuf_type != 0;
+    for(pos = cindex;; pos++) {
+        pos = lre_prefilter_find(s, pf, cindex, pos, clen);
+        if (pos < 0)
+            return 0;
+        if ((pf[RE_PREFILTER_FLAGS] & RE_PREFILTER_LITERAL) && shift == 0) {
+            capture[0] = (uint8_t *)s->cbuf + pos;
+            capture[1] = capture[0] + pf[RE_PREFILTER_LIT_LEN];
+            return 1;
+        }
+        ret = lre_exec_backtrack(s, capture, stack_buf, 0, pc,
+                                 s->cbuf + (pos << shift), FALSE);
+        if (ret != 0)
+            return ret;
+        for(i = 0; i < s->capture_count * 2; i++)
+            capture[i] = NULL;
+    }
+}
+
 /* Return 1 if match, 0 if not match or -1 if error. cindex is the
    starting position of the match and must be such as 0 <= cindex <=
    clen. */
@@ -2422,6 +2653,7 @@ int lre_exec(uint8_t **capture,
     REExecContext s_s, *s = &s_s;
     int re_flags, i, alloca_size, ret;
     StackInt *stack_buf;
+    const uint8_t *pc;
     
     re_flags = bc_buf[RE_HEADER_FLAGS];
     s->multi_line = (re_flags & LRE_FLAG_MULTILINE) != 0;
@@ -2447,8 +2679,16 @@ int lre_exec(uint8_t **capture,
         capture[i] = NULL;
     alloca_size = s->stack_size_max * sizeof(stack_buf[0]);
     stack_buf = alloca(alloca_size);
-    ret = lre_exec_backtrack(s, capture, stack_buf, 0, bc_buf + RE_HEADER_LEN,
-                             cbuf + (cindex << cbuf_type), FALSE);
+    pc = bc_buf + RE_HEADER_LEN;
+    if (*pc == REOP_prefilter) {
+        /* skip the search loop (split_goto_first, any, goto) */
+        ret = lre_exec_prefiltered(s, capture, stack_buf, pc + 3,
+                                   pc + 3 + get_u16(pc + 1) + 11,
+                                   cindex, clen);
+    } else {
+        ret = lre_exec_backtrack(s, capture, stack_buf, 0, pc,
+                                 cbuf + (cindex << cbuf_type), FALSE);
+    }
     lre_realloc(s->opaque, s->state_stack, 0);
     return ret;
 }
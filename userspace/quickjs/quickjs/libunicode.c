@@ -30,6 +30,15 @@
 #include "cutils.h"
 #include "libunicode.h"
 #include "libunicode-table.h"
+#ifndef LRE_NO_FAST_TABLES
+/* two-level tables for the BMP, generated from libunicode-table.h by
+   unicode_fast_gen.c when building */
+#include "libunicode-fast.h"
+
+#define UNICODE_FAST_GET(name, c)                                         \
+    name ## _data[(name ## _index[(c) >> UNICODE_FAST_SHIFT] <<           \
+                   UNICODE_FAST_SHIFT) | ((c) & ((1 << UNICODE_FAST_SHIFT) - 1))]
+#endif
 
 enum {
     RUN_TYPE_U,
@@ -169,6 +178,18 @@ int lre_case_conv(uint32_t *res, uint32_t c, int conv_type)
         uint32_t v, code, len;
         int idx, idx_min, idx_max;
         
+#ifndef LRE_NO_FAST_TABLES
+        if (c < 0x10000 && conv_type != 2) {
+            if (conv_type)
+                v = UNICODE_FAST_GET(unicode_fast_lower, c);
+            else
+                v = UNICODE_FAST_GET(unicode_fast_upper, c);
+            if (v != UNICODE_FAST_DELTA_SLOW) {
+                res[0] = (c + v) & 0xffff;
+                return 1;
+            }
+        }
+#endif
         idx_min = 0;
         idx_max = countof(case_conv_table1) - 1;
         while (idx_min <= idx_max) {
@@ -241,6 +262,16 @@ int lre_canonicalize(uint32_t c, BOOL is_unicode)
         uint32_t v, code, len;
         int idx, idx_min, idx_max;
         
+#ifndef LRE_NO_FAST_TABLES
+        if (c < 0x10000) {
+            if (is_unicode)
+                v = UNICODE_FAST_GET(unicode_fast_canon_u, c);
+            else
+                v = UNICODE_FAST_GET(unicode_fast_canon, c);
+            if (v != UNICODE_FAST_DELTA_SLOW)
+                return (c + v) & 0xffff;
+        }
+#endif
         idx_min = 0;
         idx_max = countof(case_conv_table1) - 1;
         while (idx_min <= idx_max) {
@@ -345,6 +376,10 @@ BOOL lre_is_cased(uint32_t c)
     uint32_t v, code, len;
     int idx, idx_min, idx_max;
         
+#ifndef LRE_NO_FAST_TABLES
+    if (c < 0x10000)
+        return (UNICODE_FAST_GET(unicode_fast_props, c) & UNICODE_FAST_CASED) != 0;
+#endif
     idx_min = 0;
     idx_max = countof(case_conv_table1) - 1;
     while (idx_min <= idx_max) {
@@ -367,6 +402,10 @@ BOOL lre_is_cased(uint32_t c)
 
 BOOL lre_is_case_ignorable(uint32_t c)
 {
+#ifndef LRE_NO_FAST_TABLES
+    if (c < 0x10000)
+        return (UNICODE_FAST_GET(unicode_fast_props, c) & UNICODE_FAST_CASE_IGNORABLE) != 0;
+#endif
     return lre_is_in_table(c, unicode_prop_Case_Ignorable_table,
                            unicode_prop_Case_Ignorable_index,
                            sizeof(unicode_prop_Case_Ignorable_index) / 3);
@@ -537,6 +576,10 @@ int cr_invert(CharRange *cr)
 
 BOOL lre_is_id_start(uint32_t c)
 {
+#ifndef LRE_NO_FAST_TABLES
+    if (c < 0x10000)
+        return (UNICODE_FAST_GET(unicode_fast_props, c) & UNICODE_FAST_ID_START) != 0;
+#endif
     return lre_is_in_table(c, unicode_prop_ID_Start_table,
                            unicode_prop_ID_Start_index,
                            sizeof(unicode_prop_ID_Start_index) / 3);
@@ -544,6 +587,10 @@ BOOL lre_is_id_start(uint32_t c)
 
 BOOL lre_is_id_continue(uint32_t c)
 {
+#ifndef LRE_NO_FAST_TABLES
+    if (c < 0x10000)
+        return (UNICODE_FAST_GET(unicode_fast_props, c) & UNICODE_FAST_ID_CONTINUE) != 0;
+#endif
     return lre_is_id_start(c) ||
         lre_is_in_table(c, unicode_prop_ID_Continue1_table,
                         unicode_prop_ID_Continue1_index,
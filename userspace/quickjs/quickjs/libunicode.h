@@ -41,6 +41,9 @@ typedef enum {
 } UnicodeNormalizationEnum;
 
 int lre_case_conv(uint32_t *res, uint32_t c, int conv_type);
+/* lre_case_conv() of the Latin-1 characters for conv_type 0 (to upper)
+   and 1 (to lower); 0xffff when the result is several characters */
+extern const uint16_t lre_latin1_case_conv[2][256];
 int lre_canonicalize(uint32_t c, BOOL is_unicode);
 LRE_BOOL lre_is_cased(uint32_t c);
 LRE_BOOL lre_is_case_ignorable(uint32_t c);
@@ -1,19 +1,24 @@
-/* Minimal pthread.h stub for QuickJS */
+/* Minimal pthread.h for QuickJS */
 #ifndef _PTHREAD_H
 #define _PTHREAD_H
 
-/* We run single-threaded, so pthread is mostly no-op */
+#include "time.h"
+
+/* Mutexes and condition variables are futex words (see stubs.c); threads
+ * run on libakuma::spawn_thread through the Rust runtime. */
 
 typedef unsigned long pthread_t;
-typedef struct { int dummy; } pthread_mutex_t;
+typedef struct { int dummy; } pthread_attr_t;
+/* 0: unlocked, 1: locked, 2: locked with waiters */
+typedef struct { int state; } pthread_mutex_t;
 typedef struct { int dummy; } pthread_mutexattr_t;
-typedef struct { int dummy; } pthread_cond_t;
+/* Bumped by every signal/broadcast; waiters sleep on it */
+typedef struct { unsigned int seq; } pthread_cond_t;
 typedef struct { int dummy; } pthread_condattr_t;
 
 #define PTHREAD_MUTEX_INITIALIZER { 0 }
 #define PTHREAD_COND_INITIALIZER { 0 }
 
-/* Stub declarations */
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
 int pthread_mutex_destroy(pthread_mutex_t *mutex);
 int pthread_mutex_lock(pthread_mutex_t *mutex);
@@ -22,9 +27,15 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex);
 int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
 int pthread_cond_destroy(pthread_cond_t *cond);
 int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime);
 int pthread_cond_signal(pthread_cond_t *cond);
 int pthread_cond_broadcast(pthread_cond_t *cond);
 
+/* Joinable threads only; attr is ignored */
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                   void *(*start_routine)(void *), void *arg);
+int pthread_join(pthread_t thread, void **retval);
 pthread_t pthread_self(void);
 
 #endif /* _PTHREAD_H */
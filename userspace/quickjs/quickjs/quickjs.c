@@ -45,6 +45,7 @@
 #include "quickjs.h"
 #include "libregexp.h"
 #include "libbf.h"
+#include "dtoa.h"
 
 #define OPTIMIZE         1
 #define SHORT_OPCODES    1
@@ -60,11 +61,6 @@
 #define MALLOC_OVERHEAD  8
 #endif
 
-#if !defined(_WIN32)
-/* define it if printf uses the RNDN rounding mode instead of RNDNA */
-#define CONFIG_PRINTF_RNDN
-#endif
-
 /* define to include Atomics.* operations which depend on the OS
    threads */
 #if !defined(EMSCRIPTEN)
@@ -258,6 +254,10 @@ struct JSRuntime {
     struct list_head tmp_obj_list; /* used during GC */
     JSGCPhaseEnum gc_phase : 8;
     size_t malloc_gc_threshold;
+    /* lower bound for malloc_gc_threshold after a GC (JS_SetGCThreshold) */
+    size_t gc_threshold_min;
+    int64_t gc_count; /* JS_RunGC() calls */
+    int64_t gc_time; /* time spent in JS_RunGC(), in clock() ticks */
 #ifdef DUMP_LEAKS
     struct list_head string_list; /* list of JSString.link */
 #endif
@@ -274,6 +274,7 @@ struct JSRuntime {
 
     JSInterruptHandler *interrupt_handler;
     void *interrupt_opaque;
+    int interrupt_interval; /* interrupt checks between handler calls */
 
     JSHostPromiseRejectionTracker *host_promise_rejection_tracker;
     void *host_promise_rejection_tracker_opaque;
@@ -403,8 +404,20 @@ typedef enum {
     JS_AUTOINIT_ID_PROTOTYPE,
     JS_AUTOINIT_ID_MODULE_NS,
     JS_AUTOINIT_ID_PROP,
+    JS_AUTOINIT_ID_INTRINSIC,
 } JSAutoInitIDEnum;
 
+/* number of intrinsic groups JS_AddLazyIntrinsics() can defer */
+#define JS_LAZY_INTRINSIC_COUNT 4
+
+#define JS_REGEXP_CACHE_SIZE 16 /* must be a power of two */
+
+typedef struct JSRegExpCacheEntry {
+    JSString *pattern; /* NULL if the entry is free */
+    JSString *bytecode;
+    int flags;
+} JSRegExpCacheEntry;
+
 /* must be large enough to have a negligible runtime cost and small
    enough to call the interrupt callback often. */
 #define JS_INTERRUPT_COUNTER_INIT 10000
@@ -435,6 +448,14 @@ struct JSContext {
     JSValue global_obj; /* global object */
     JSValue global_var_obj; /* contains the global let/const definitions */
 
+    /* bit i set: lazy intrinsic group i is not instantiated yet */
+    uint8_t lazy_intrinsics_pending;
+    /* object holding the globals of each instantiated lazy group */
+    JSValue lazy_intrinsics[JS_LAZY_INTRINSIC_COUNT];
+
+    /* bytecode of RegExps compiled at run time, by pattern and flags */
+    JSRegExpCacheEntry regexp_cache[JS_REGEXP_CACHE_SIZE];
+
     uint64_t random_state;
     bf_context_t *bf_ctx;   /* points to rt->bf_ctx, shared by all contexts */
 #ifdef CONFIG_BIGNUM
@@ -1188,6 +1209,9 @@ static JSValue js_array_buffer_constructor3(JSContext *ctx,
                                             JSFreeArrayBufferDataFunc *free_func,
                                             void *opaque, BOOL alloc_flag);
 static JSArrayBuffer *js_get_array_buffer(JSContext *ctx, JSValueConst obj);
+static void js_array_buffer_free(JSRuntime *rt, void *opaque, void *ptr);
+static void array_buffer_detach(JSRuntime *rt, JSArrayBuffer *abuf,
+                                BOOL free_data);
 static JSValue js_typed_array_constructor(JSContext *ctx,
                                           JSValueConst this_val,
                                           int argc, JSValueConst *argv,
@@ -1273,6 +1297,9 @@ static JSValue js_module_ns_autoinit(JSContext *ctx, JSObject *p, JSAtom atom,
                                  void *opaque);
 static JSValue JS_InstantiateFunctionListItem2(JSContext *ctx, JSObject *p,
                                                JSAtom atom, void *opaque);
+static JSValue js_lazy_intrinsic_autoinit(JSContext *ctx, JSObject *p,
+                                          JSAtom atom, void *opaque);
+static void js_lazy_intrinsic_need_class(JSContext *ctx, JSClassID class_id);
 void JS_SetUncatchableError(JSContext *ctx, JSValueConst val, BOOL flag);
 static JSValue js_object_groupBy(JSContext *ctx, JSValueConst this_val,
                                  int argc, JSValueConst *argv, int is_map);
@@ -1300,6 +1327,8 @@ static void js_trigger_gc(JSRuntime *rt, size_t size)
         JS_RunGC(rt);
         rt->malloc_gc_threshold = rt->malloc_state.malloc_size +
             (rt->malloc_state.malloc_size >> 1);
+        if (rt->malloc_gc_threshold < rt->gc_threshold_min)
+            rt->malloc_gc_threshold = rt->gc_threshold_min;
     }
 }
 
@@ -1672,6 +1701,7 @@ JSRuntime *JS_NewRuntime2(const JSMallocFunctions *mf, void *opaque)
         goto fail;
 
     rt->stack_size = JS_DEFAULT_STACK_SIZE;
+    rt->interrupt_interval = JS_INTERRUPT_COUNTER_INIT;
     JS_UpdateStackTop(rt);
 
     rt->current_exception = JS_NULL;
@@ -1782,10 +1812,13 @@ void JS_SetMemoryLimit(JSRuntime *rt, size_t limit)
     rt->malloc_state.malloc_limit = limit;
 }
 
-/* use -1 to disable automatic GC */
+/* use -1 to disable automatic GC. The threshold is also kept as a
+   floor: after a GC the next one runs at 1.5 times the surviving heap
+   or 'gc_threshold', whichever is larger. */
 void JS_SetGCThreshold(JSRuntime *rt, size_t gc_threshold)
 {
     rt->malloc_gc_threshold = gc_threshold;
+    rt->gc_threshold_min = gc_threshold;
 }
 
 #define malloc(s) malloc_is_forbidden(s)
@@ -1798,6 +1831,11 @@ void JS_SetInterruptHandler(JSRuntime *rt, JSInterruptHandler *cb, void *opaque)
     rt->interrupt_opaque = opaque;
 }
 
+void JS_SetInterruptInterval(JSRuntime *rt, int interval)
+{
+    rt->interrupt_interval = max_int(interval, 1);
+}
+
 void JS_SetCanBlock(JSRuntime *rt, BOOL can_block)
 {
     rt->can_block = can_block;
@@ -2147,6 +2185,8 @@ JSContext *JS_NewContextRaw(JSRuntime *rt)
     ctx->array_ctor = JS_NULL;
     ctx->regexp_ctor = JS_NULL;
     ctx->promise_ctor = JS_NULL;
+    for(i = 0; i < JS_LAZY_INTRINSIC_COUNT; i++)
+        ctx->lazy_intrinsics[i] = JS_UNDEFINED;
     init_list_head(&ctx->loaded_modules);
 
     JS_AddIntrinsicBasicObjects(ctx);
@@ -2206,6 +2246,8 @@ JSValue JS_GetClassProto(JSContext *ctx, JSClassID class_id)
 {
     JSRuntime *rt = ctx->rt;
     assert(class_id < rt->class_count);
+    if (unlikely(ctx->lazy_intrinsics_pending))
+        js_lazy_intrinsic_need_class(ctx, class_id);
     return JS_DupValue(ctx, ctx->class_proto[class_id]);
 }
 
@@ -2267,6 +2309,9 @@ static void JS_MarkContext(JSRuntime *rt, JSContext *ctx,
     JS_MarkValue(rt, ctx->regexp_ctor, mark_func);
     JS_MarkValue(rt, ctx->function_ctor, mark_func);
     JS_MarkValue(rt, ctx->function_proto, mark_func);
+    for(i = 0; i < JS_LAZY_INTRINSIC_COUNT; i++) {
+        JS_MarkValue(rt, ctx->lazy_intrinsics[i], mark_func);
+    }
 
     if (ctx->array_shape)
         mark_func(rt, &ctx->array_shape->header);
@@ -2331,6 +2376,16 @@ void JS_FreeContext(JSContext *ctx)
     JS_FreeValue(ctx, ctx->regexp_ctor);
     JS_FreeValue(ctx, ctx->function_ctor);
     JS_FreeValue(ctx, ctx->function_proto);
+    for(i = 0; i < JS_LAZY_INTRINSIC_COUNT; i++) {
+        JS_FreeValue(ctx, ctx->lazy_intrinsics[i]);
+    }
+    for(i = 0; i < JS_REGEXP_CACHE_SIZE; i++) {
+        JSRegExpCacheEntry *e = &ctx->regexp_cache[i];
+        if (e->pattern) {
+            JS_FreeValue(ctx, JS_MKPTR(JS_TAG_STRING, e->pattern));
+            JS_FreeValue(ctx, JS_MKPTR(JS_TAG_STRING, e->bytecode));
+        }
+    }
 
     js_free_shape_null(ctx->rt, ctx->array_shape);
 
@@ -4916,6 +4971,8 @@ static int JS_SetObjectData(JSContext *ctx, JSValueConst obj, JSValue val)
 
 JSValue JS_NewObjectClass(JSContext *ctx, int class_id)
 {
+    if (unlikely(ctx->lazy_intrinsics_pending))
+        js_lazy_intrinsic_need_class(ctx, class_id);
     return JS_NewObjectProtoClass(ctx, ctx->class_proto[class_id], class_id);
 }
 
@@ -5835,6 +5892,8 @@ static void gc_free_cycles(JSRuntime *rt)
 
 void JS_RunGC(JSRuntime *rt)
 {
+    clock_t start = clock();
+
     /* decrement the reference of the children of each object. mark =
        1 after this pass. */
     gc_decref(rt);
@@ -5844,6 +5903,9 @@ void JS_RunGC(JSRuntime *rt)
 
     /* free the GC objects in a cycle */
     gc_free_cycles(rt);
+
+    rt->gc_count++;
+    rt->gc_time += clock() - start;
 }
 
 /* Return false if not an object or if the object has already been
@@ -5948,6 +6010,8 @@ void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s)
     s->malloc_count = rt->malloc_state.malloc_count;
     s->malloc_size = rt->malloc_state.malloc_size;
     s->malloc_limit = rt->malloc_state.malloc_limit;
+    s->gc_count = rt->gc_count;
+    s->gc_time = rt->gc_time;
 
     s->memory_used_count = 2; /* rt + rt->class_array */
     s->memory_used_size = sizeof(JSRuntime) + sizeof(JSValue) * rt->class_count;
@@ -6353,6 +6417,10 @@ void JS_DumpMemoryUsage(FILE *fp, const JSMemoryUsage *s, JSRuntime *rt)
         fprintf(fp, "%-20s %8"PRId64" %8"PRId64"\n",
                 "binary objects", s->binary_object_count, s->binary_object_size);
     }
+    if (s->gc_count) {
+        fprintf(fp, "%-20s %8"PRId64"  (%0.3f s)\n", "GC cycles", s->gc_count,
+                (double)s->gc_time / CLOCKS_PER_SEC);
+    }
 }
 
 JSValue JS_GetGlobalObject(JSContext *ctx)
@@ -6585,6 +6653,57 @@ static void build_backtrace(JSContext *ctx, JSValueConst error_obj,
                            JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE);
 }
 
+/* for profilers: called from the interrupt handler, it neither
+   allocates nor runs JS code. The atoms belong to the functions. */
+int JS_GetStackFrames(JSContext *ctx, JSStackFrameInfo *frames, int max_frames)
+{
+    JSStackFrame *sf;
+    JSObject *p;
+    JSProperty *pr;
+    JSShapeProperty *prs;
+    JSString *str;
+    JSStackFrameInfo *fi;
+    int n;
+
+    n = 0;
+    for(sf = ctx->rt->current_stack_frame; sf != NULL && n < max_frames;
+        sf = sf->prev_frame) {
+        if (JS_VALUE_GET_TAG(sf->cur_func) != JS_TAG_OBJECT)
+            continue;
+        p = JS_VALUE_GET_OBJ(sf->cur_func);
+        fi = &frames[n++];
+        fi->func_name = JS_ATOM_NULL;
+        fi->filename = JS_ATOM_NULL;
+        fi->func_line_num = -1;
+        fi->line_num = -1;
+        if (js_class_has_bytecode(p->class_id)) {
+            JSFunctionBytecode *b = p->u.func.function_bytecode;
+            fi->func_name = b->func_name;
+            if (b->has_debug) {
+                fi->filename = b->debug.filename;
+                fi->func_line_num = b->debug.line_num;
+                if (sf->cur_pc)
+                    fi->line_num = find_line_num(ctx, b,
+                                                 sf->cur_pc - b->byte_code_buf - 1);
+                /* no line table: the function fits on its first line */
+                if (fi->line_num == -1)
+                    fi->line_num = fi->func_line_num;
+            }
+        } else {
+            /* native function: its 'name' is an atom string, see
+               js_function_set_properties() */
+            prs = find_own_property(&pr, p, JS_ATOM_name);
+            if (prs && (prs->flags & JS_PROP_TMASK) == JS_PROP_NORMAL &&
+                JS_VALUE_GET_TAG(pr->u.value) == JS_TAG_STRING) {
+                str = JS_VALUE_GET_STRING(pr->u.value);
+                if (str->atom_type == JS_ATOM_TYPE_STRING)
+                    fi->func_name = js_get_atom_index(ctx->rt, str);
+            }
+        }
+    }
+    return n;
+}
+
 /* Note: it is important that no exception is returned by this function */
 static BOOL is_backtrace_needed(JSContext *ctx, JSValueConst obj)
 {
@@ -6811,7 +6930,7 @@ static JSValue JS_ThrowTypeErrorInvalidClass(JSContext *ctx, int class_id)
 static no_inline __exception int __js_poll_interrupts(JSContext *ctx)
 {
     JSRuntime *rt = ctx->rt;
-    ctx->interrupt_counter = JS_INTERRUPT_COUNTER_INIT;
+    ctx->interrupt_counter = rt->interrupt_interval;
     if (rt->interrupt_handler) {
         if (rt->interrupt_handler(rt, rt->interrupt_opaque)) {
             /* XXX: should set a specific flag to avoid catching */
@@ -6832,6 +6951,21 @@ static inline __exception int js_poll_interrupts(JSContext *ctx)
     }
 }
 
+/* same as js_poll_interrupts() for the branches of the interpreter loop:
+   the PC is saved first so that the handler sees the current line in
+   JS_GetStackFrames() */
+static inline __exception int js_poll_interrupts_pc(JSContext *ctx,
+                                                    JSStackFrame *sf,
+                                                    const uint8_t *pc)
+{
+    if (unlikely(--ctx->interrupt_counter <= 0)) {
+        sf->cur_pc = pc;
+        return __js_poll_interrupts(ctx);
+    } else {
+        return 0;
+    }
+}
+
 /* return -1 (exception) or TRUE/FALSE */
 static int JS_SetPrototypeInternal(JSContext *ctx, JSValueConst obj,
                                    JSValueConst proto_val,
@@ -7083,6 +7217,7 @@ static JSAutoInitFunc *js_autoinit_func_table[] = {
     js_instantiate_prototype, /* JS_AUTOINIT_ID_PROTOTYPE */
     js_module_ns_autoinit, /* JS_AUTOINIT_ID_MODULE_NS */
     JS_InstantiateFunctionListItem2, /* JS_AUTOINIT_ID_PROP */
+    js_lazy_intrinsic_autoinit, /* JS_AUTOINIT_ID_INTRINSIC */
 };
 
 /* warning: 'prs' is reallocated after it */
@@ -11338,134 +11473,26 @@ static char *i64toa(char *buf_end, int64_t n, unsigned int base)
     return q;
 }
 
-/* buf1 contains the printf result */
-static void js_ecvt1(double d, int n_digits, int *decpt, int *sign, char *buf,
-                     int rounding_mode, char *buf1, int buf1_size)
-{
-    if (rounding_mode != FE_TONEAREST)
-        fesetround(rounding_mode);
-    snprintf(buf1, buf1_size, "%+.*e", n_digits - 1, d);
-    if (rounding_mode != FE_TONEAREST)
-        fesetround(FE_TONEAREST);
-    *sign = (buf1[0] == '-');
-    /* mantissa */
-    buf[0] = buf1[1];
-    if (n_digits > 1)
-        memcpy(buf + 1, buf1 + 3, n_digits - 1);
-    buf[n_digits] = '\0';
-    /* exponent */
-    *decpt = atoi(buf1 + n_digits + 2 + (n_digits > 1)) + 1;
-}
-
 /* maximum buffer size for js_dtoa */
 #define JS_DTOA_BUF_SIZE 128
 
-/* needed because ecvt usually limits the number of digits to
-   17. Return the number of digits. */
+/* Digits come straight from cshim/dtoa.c rather than a printf/strtod
+   search: shortest round-trip digits, or exactly n_digits rounded with
+   ties away from zero (RNDNA) as the JS spec requires. Return the number
+   of digits. */
 static int js_ecvt(double d, int n_digits, int *decpt, int *sign, char *buf,
                    BOOL is_fixed)
 {
-    int rounding_mode;
-    char buf_tmp[JS_DTOA_BUF_SIZE];
-
-    if (!is_fixed) {
-        unsigned int n_digits_min, n_digits_max;
-        /* find the minimum amount of digits (XXX: inefficient but simple) */
-        n_digits_min = 1;
-        n_digits_max = 17;
-        while (n_digits_min < n_digits_max) {
-            n_digits = (n_digits_min + n_digits_max) / 2;
-            js_ecvt1(d, n_digits, decpt, sign, buf, FE_TONEAREST,
-                     buf_tmp, sizeof(buf_tmp));
-            if (strtod(buf_tmp, NULL) == d) {
-                /* no need to keep the trailing zeros */
-                while (n_digits >= 2 && buf[n_digits - 1] == '0')
-                    n_digits--;
-                n_digits_max = n_digits;
-            } else {
-                n_digits_min = n_digits + 1;
-            }
-        }
-        n_digits = n_digits_max;
-        rounding_mode = FE_TONEAREST;
-    } else {
-        rounding_mode = FE_TONEAREST;
-#ifdef CONFIG_PRINTF_RNDN
-        {
-            char buf1[JS_DTOA_BUF_SIZE], buf2[JS_DTOA_BUF_SIZE];
-            int decpt1, sign1, decpt2, sign2;
-            /* The JS rounding is specified as round to nearest ties away
-               from zero (RNDNA), but in printf the "ties" case is not
-               specified (for example it is RNDN for glibc, RNDNA for
-               Windows), so we must round manually. */
-            js_ecvt1(d, n_digits + 1, &decpt1, &sign1, buf1, FE_TONEAREST,
-                     buf_tmp, sizeof(buf_tmp));
-            /* XXX: could use 2 digits to reduce the average running time */
-            if (buf1[n_digits] == '5') {
-                js_ecvt1(d, n_digits + 1, &decpt1, &sign1, buf1, FE_DOWNWARD,
-                         buf_tmp, sizeof(buf_tmp));
-                js_ecvt1(d, n_digits + 1, &decpt2, &sign2, buf2, FE_UPWARD,
-                         buf_tmp, sizeof(buf_tmp));
-                if (memcmp(buf1, buf2, n_digits + 1) == 0 && decpt1 == decpt2) {
-                    /* exact result: round away from zero */
-                    if (sign1)
-                        rounding_mode = FE_DOWNWARD;
-                    else
-                        rounding_mode = FE_UPWARD;
-                }
-            }
-        }
-#endif /* CONFIG_PRINTF_RNDN */
-    }
-    js_ecvt1(d, n_digits, decpt, sign, buf, rounding_mode,
-             buf_tmp, sizeof(buf_tmp));
-    return n_digits;
-}
-
-static int js_fcvt1(char *buf, int buf_size, double d, int n_digits,
-                    int rounding_mode)
-{
-    int n;
-    if (rounding_mode != FE_TONEAREST)
-        fesetround(rounding_mode);
-    n = snprintf(buf, buf_size, "%.*f", n_digits, d);
-    if (rounding_mode != FE_TONEAREST)
-        fesetround(FE_TONEAREST);
-    assert(n < buf_size);
-    return n;
+    *sign = signbit(d) != 0;
+    if (!is_fixed)
+        return cshim_dtoa_shortest(d, buf, decpt);
+    return cshim_dtoa_fixed(d, n_digits, buf, decpt);
 }
 
+/* [-]ddd.ddd with n_digits fractional digits, rounded RNDNA */
 static void js_fcvt(char *buf, int buf_size, double d, int n_digits)
 {
-    int rounding_mode;
-    rounding_mode = FE_TONEAREST;
-#ifdef CONFIG_PRINTF_RNDN
-    {
-        int n1, n2;
-        char buf1[JS_DTOA_BUF_SIZE];
-        char buf2[JS_DTOA_BUF_SIZE];
-
-        /* The JS rounding is specified as round to nearest ties away from
-           zero (RNDNA), but in printf the "ties" case is not specified
-           (for example it is RNDN for glibc, RNDNA for Windows), so we
-           must round manually. */
-        n1 = js_fcvt1(buf1, sizeof(buf1), d, n_digits + 1, FE_TONEAREST);
-        rounding_mode = FE_TONEAREST;
-        /* XXX: could use 2 digits to reduce the average running time */
-        if (buf1[n1 - 1] == '5') {
-            n1 = js_fcvt1(buf1, sizeof(buf1), d, n_digits + 1, FE_DOWNWARD);
-            n2 = js_fcvt1(buf2, sizeof(buf2), d, n_digits + 1, FE_UPWARD);
-            if (n1 == n2 && memcmp(buf1, buf2, n1) == 0) {
-                /* exact result: round away from zero */
-                if (buf1[0] == '-')
-                    rounding_mode = FE_DOWNWARD;
-                else
-                    rounding_mode = FE_UPWARD;
-            }
-        }
-    }
-#endif /* CONFIG_PRINTF_RNDN */
-    js_fcvt1(buf, buf_size, d, n_digits, rounding_mode);
+    cshim_dtoa_frac(d, n_digits, buf, buf_size);
 }
 
 /* radix != 10 is only supported with flags = JS_DTOA_VAR_FORMAT */
@@ -17115,18 +17142,18 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
 
         CASE(OP_goto):
             pc += (int32_t)get_u32(pc);
-            if (unlikely(js_poll_interrupts(ctx)))
+            if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                 goto exception;
             BREAK;
 #if SHORT_OPCODES
         CASE(OP_goto16):
             pc += (int16_t)get_u16(pc);
-            if (unlikely(js_poll_interrupts(ctx)))
+            if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                 goto exception;
             BREAK;
         CASE(OP_goto8):
             pc += (int8_t)pc[0];
-            if (unlikely(js_poll_interrupts(ctx)))
+            if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                 goto exception;
             BREAK;
 #endif
@@ -17146,7 +17173,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (res) {
                     pc += (int32_t)get_u32(pc - 4) - 4;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -17166,7 +17193,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (!res) {
                     pc += (int32_t)get_u32(pc - 4) - 4;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -17187,7 +17214,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (res) {
                     pc += (int8_t)pc[-1] - 1;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -17207,7 +17234,7 @@ static JSValue JS_CallInternal(JSContext *caller_ctx, JSValueConst func_obj,
                 if (!res) {
                     pc += (int8_t)pc[-1] - 1;
                 }
-                if (unlikely(js_poll_interrupts(ctx)))
+                if (unlikely(js_poll_interrupts_pc(ctx, sf, pc)))
                     goto exception;
             }
             BREAK;
@@ -18641,6 +18668,8 @@ static JSValue js_create_from_ctor(JSContext *ctx, JSValueConst ctor,
     JSContext *realm;
     
     if (JS_IsUndefined(ctor)) {
+        if (unlikely(ctx->lazy_intrinsics_pending))
+            js_lazy_intrinsic_need_class(ctx, class_id);
         proto = JS_DupValue(ctx, ctx->class_proto[class_id]);
     } else {
         proto = JS_GetProperty(ctx, ctor, JS_ATOM_prototype);
@@ -18651,6 +18680,8 @@ static JSValue js_create_from_ctor(JSContext *ctx, JSValueConst ctor,
             realm = JS_GetFunctionRealm(ctx, ctor);
             if (!realm)
                 return JS_EXCEPTION;
+            if (unlikely(realm->lazy_intrinsics_pending))
+                js_lazy_intrinsic_need_class(realm, class_id);
             proto = JS_DupValue(ctx, realm->class_proto[class_id]);
         }
     }
@@ -34545,6 +34576,7 @@ typedef enum BCTagEnum {
     BC_TAG_DATE,
     BC_TAG_OBJECT_VALUE,
     BC_TAG_OBJECT_REFERENCE,
+    BC_TAG_ARRAY_BUFFER_TRANSFER,
 } BCTagEnum;
 
 #ifdef CONFIG_BIGNUM
@@ -34577,6 +34609,10 @@ typedef struct BCWriterState {
     int sab_tab_size;
     /* list of referenced objects (used if allow_reference = TRUE) */
     JSObjectList object_list;
+    /* ArrayBuffers whose data is moved instead of copied */
+    JSValueConst *transfer;
+    int transfer_len;
+    uint8_t *transfer_done;
 } BCWriterState;
 
 #ifdef DUMP_READ_OBJECT
@@ -34603,6 +34639,7 @@ static const char * const bc_tag_str[] = {
     "Date",
     "ObjectValue",
     "ObjectReference",
+    "ArrayBufferTransfer",
 };
 #endif
 
@@ -35191,14 +35228,61 @@ static int JS_WriteTypedArray(BCWriterState *s, JSValueConst obj)
     return 0;
 }
 
+/* index of 'p' in the transfer list or -1 */
+static int bc_find_transfer(BCWriterState *s, JSObject *p)
+{
+    int i;
+    for(i = 0; i < s->transfer_len; i++) {
+        if (JS_VALUE_GET_OBJ(s->transfer[i]) == p)
+            return i;
+    }
+    return -1;
+}
+
+/* The data pointer of a transferred buffer is written instead of its
+   contents. Buffers from the runtime heap ('kind' 0) are adopted by the
+   reader's heap accounting; others ('kind' 1) keep their free function,
+   which must not depend on the runtime. Buffers without a free function
+   do not own their data and are copied. */
+static int JS_WriteArrayBufferTransfer(BCWriterState *s, JSArrayBuffer *abuf,
+                                       int idx)
+{
+    if (s->transfer_done[idx]) {
+        JS_ThrowTypeError(s->ctx, "transferred ArrayBuffer is referenced twice");
+        return -1;
+    }
+    s->transfer_done[idx] = 1;
+    if (!abuf->free_func)
+        return 1;
+    bc_put_u8(s, BC_TAG_ARRAY_BUFFER_TRANSFER);
+    bc_put_leb128(s, abuf->byte_length);
+    if (abuf->free_func == js_array_buffer_free) {
+        bc_put_u8(s, 0);
+        bc_put_u64(s, (uintptr_t)abuf->data);
+    } else {
+        bc_put_u8(s, 1);
+        bc_put_u64(s, (uintptr_t)abuf->data);
+        bc_put_u64(s, (uintptr_t)abuf->free_func);
+        bc_put_u64(s, (uintptr_t)abuf->opaque);
+    }
+    return 0;
+}
+
 static int JS_WriteArrayBuffer(BCWriterState *s, JSValueConst obj)
 {
     JSObject *p = JS_VALUE_GET_OBJ(obj);
     JSArrayBuffer *abuf = p->u.array_buffer;
+    int idx, ret;
     if (abuf->detached) {
         JS_ThrowTypeErrorDetachedArrayBuffer(s->ctx);
         return -1;
     }
+    idx = bc_find_transfer(s, p);
+    if (idx >= 0) {
+        ret = JS_WriteArrayBufferTransfer(s, abuf, idx);
+        if (ret <= 0)
+            return ret;
+    }
     bc_put_u8(s, BC_TAG_ARRAY_BUFFER);
     bc_put_leb128(s, abuf->byte_length);
     dbuf_put(&s->dbuf, abuf->data, abuf->byte_length);
@@ -35398,13 +35482,84 @@ static int JS_WriteObjectAtoms(BCWriterState *s)
     return -1;
 }
 
-uint8_t *JS_WriteObject2(JSContext *ctx, size_t *psize, JSValueConst obj,
-                         int flags, uint8_t ***psab_tab, size_t *psab_tab_len)
+/* number of bytes charged to the malloc state for 'ptr' */
+static size_t js_malloc_charge_rt(JSRuntime *rt, const void *ptr)
+{
+    if (rt->mf.js_malloc_charge)
+        return rt->mf.js_malloc_charge(ptr);
+    return rt->mf.js_malloc_usable_size(ptr) + MALLOC_OVERHEAD;
+}
+
+static int bc_check_transfer(JSContext *ctx, JSValueConst *transfer,
+                             int transfer_len)
+{
+    JSArrayBuffer *abuf;
+    int i, j;
+
+    for(i = 0; i < transfer_len; i++) {
+        abuf = JS_GetOpaque(transfer[i], JS_CLASS_ARRAY_BUFFER);
+        if (!abuf) {
+            JS_ThrowTypeError(ctx, "only ArrayBuffers can be transferred");
+            return -1;
+        }
+        if (abuf->detached) {
+            JS_ThrowTypeErrorDetachedArrayBuffer(ctx);
+            return -1;
+        }
+        for(j = 0; j < i; j++) {
+            if (JS_VALUE_GET_OBJ(transfer[j]) == JS_VALUE_GET_OBJ(transfer[i])) {
+                JS_ThrowTypeError(ctx, "duplicate ArrayBuffer in transfer list");
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* The buffers now belong to the serialized data: detach them without
+   freeing what was transferred. Heap data leaves this runtime's accounting;
+   the reader charges it again. Entries absent from the object are freed. */
+static void bc_detach_transfer(BCWriterState *s)
+{
+    JSRuntime *rt = s->ctx->rt;
+    JSArrayBuffer *abuf;
+    int i;
+
+    for(i = 0; i < s->transfer_len; i++) {
+        abuf = JS_GetOpaque(s->transfer[i], JS_CLASS_ARRAY_BUFFER);
+        if (!s->transfer_done[i] || !abuf->free_func) {
+            array_buffer_detach(rt, abuf, TRUE);
+            continue;
+        }
+        if (abuf->free_func == js_array_buffer_free) {
+            rt->malloc_state.malloc_count--;
+            rt->malloc_state.malloc_size -= js_malloc_charge_rt(rt, abuf->data);
+        }
+        array_buffer_detach(rt, abuf, FALSE);
+    }
+}
+
+/* Like JS_WriteObject2(), and moves the data of the ArrayBuffers listed in
+   'transfer' into the output instead of copying it. On success the buffers
+   are detached. The output must be read back with JS_READ_OBJ_TRANSFER in
+   the same process, exactly once: it owns the transferred memory. */
+uint8_t *JS_WriteObjectTransfer(JSContext *ctx, size_t *psize, JSValueConst obj,
+                                int flags, uint8_t ***psab_tab, size_t *psab_tab_len,
+                                JSValueConst *transfer, int transfer_len)
 {
     BCWriterState ss, *s = &ss;
 
     memset(s, 0, sizeof(*s));
     s->ctx = ctx;
+    if (transfer_len > 0) {
+        if (bc_check_transfer(ctx, transfer, transfer_len))
+            goto fail_transfer;
+        s->transfer_done = js_mallocz(ctx, transfer_len);
+        if (!s->transfer_done)
+            goto fail_transfer;
+        s->transfer = transfer;
+        s->transfer_len = transfer_len;
+    }
     /* XXX: byte swapped output is untested */
     s->byte_swap = ((flags & JS_WRITE_OBJ_BSWAP) != 0);
     s->allow_bytecode = ((flags & JS_WRITE_OBJ_BYTECODE) != 0);
@@ -35425,6 +35580,10 @@ uint8_t *JS_WriteObject2(JSContext *ctx, size_t *psize, JSValueConst obj,
     js_object_list_end(ctx, &s->object_list);
     js_free(ctx, s->atom_to_idx);
     js_free(ctx, s->idx_to_atom);
+    if (s->transfer_len > 0) {
+        bc_detach_transfer(s);
+        js_free(ctx, s->transfer_done);
+    }
     *psize = s->dbuf.size;
     if (psab_tab)
         *psab_tab = s->sab_tab;
@@ -35435,7 +35594,9 @@ uint8_t *JS_WriteObject2(JSContext *ctx, size_t *psize, JSValueConst obj,
     js_object_list_end(ctx, &s->object_list);
     js_free(ctx, s->atom_to_idx);
     js_free(ctx, s->idx_to_atom);
+    js_free(ctx, s->transfer_done);
     dbuf_free(&s->dbuf);
+ fail_transfer:
     *psize = 0;
     if (psab_tab)
         *psab_tab = NULL;
@@ -35444,6 +35605,13 @@ uint8_t *JS_WriteObject2(JSContext *ctx, size_t *psize, JSValueConst obj,
     return NULL;
 }
 
+uint8_t *JS_WriteObject2(JSContext *ctx, size_t *psize, JSValueConst obj,
+                         int flags, uint8_t ***psab_tab, size_t *psab_tab_len)
+{
+    return JS_WriteObjectTransfer(ctx, psize, obj, flags, psab_tab, psab_tab_len,
+                                  NULL, 0);
+}
+
 uint8_t *JS_WriteObject(JSContext *ctx, size_t *psize, JSValueConst obj,
                         int flags)
 {
@@ -35461,6 +35629,7 @@ typedef struct BCReaderState {
     BOOL allow_bytecode : 8;
     BOOL is_rom_data : 8;
     BOOL allow_reference : 8;
+    BOOL allow_transfer : 8;
     /* object references */
     JSObject **objects;
     int objects_count;
@@ -36339,6 +36508,48 @@ static JSValue JS_ReadArrayBuffer(BCReaderState *s)
     return JS_EXCEPTION;
 }
 
+static JSValue JS_ReadArrayBufferTransfer(BCReaderState *s)
+{
+    JSContext *ctx = s->ctx;
+    JSRuntime *rt = ctx->rt;
+    uint32_t byte_length;
+    uint8_t kind;
+    uint64_t data, free_func, opaque;
+    JSFreeArrayBufferDataFunc *func;
+    JSValue obj;
+
+    if (!s->allow_transfer)
+        return JS_ThrowSyntaxError(ctx, "transferred ArrayBuffers are not allowed");
+    if (bc_get_leb128(s, &byte_length) || bc_get_u8(s, &kind) ||
+        bc_get_u64(s, &data))
+        return JS_EXCEPTION;
+    if (kind == 0) {
+        func = js_array_buffer_free;
+        opaque = 0;
+        rt->malloc_state.malloc_count++;
+        rt->malloc_state.malloc_size +=
+            js_malloc_charge_rt(rt, (void *)(uintptr_t)data);
+    } else {
+        if (bc_get_u64(s, &free_func) || bc_get_u64(s, &opaque))
+            return JS_EXCEPTION;
+        func = (JSFreeArrayBufferDataFunc *)(uintptr_t)free_func;
+    }
+    bc_read_trace(s, "len=%u kind=%u\n", byte_length, kind);
+    obj = js_array_buffer_constructor3(ctx, JS_UNDEFINED, byte_length,
+                                       JS_CLASS_ARRAY_BUFFER,
+                                       (uint8_t *)(uintptr_t)data, func,
+                                       (void *)(uintptr_t)opaque, FALSE);
+    if (JS_IsException(obj)) {
+        func(rt, (void *)(uintptr_t)opaque, (void *)(uintptr_t)data);
+        return obj;
+    }
+    if (BC_add_object_ref(s, obj)) {
+        JS_FreeValue(ctx, obj);
+        return JS_EXCEPTION;
+    }
+    return obj;
+}
+
 static JSValue JS_ReadSharedArrayBuffer(BCReaderState *s)
 {
     JSContext *ctx = s->ctx;
@@ -36379,6 +36590,8 @@ static JSValue JS_ReadDate(BCReaderState *s)
         JS_ThrowTypeError(ctx, "Number tag expected for date");
         goto fail;
     }
+    if (unlikely(ctx->lazy_intrinsics_pending))
+        js_lazy_intrinsic_need_class(ctx, JS_CLASS_DATE);
     obj = JS_NewObjectProtoClass(ctx, ctx->class_proto[JS_CLASS_DATE],
                                  JS_CLASS_DATE);
     if (JS_IsException(obj))
@@ -36489,6 +36702,9 @@ static JSValue JS_ReadObjectRec(BCReaderState *s)
     case BC_TAG_ARRAY_BUFFER:
         obj = JS_ReadArrayBuffer(s);
         break;
+    case BC_TAG_ARRAY_BUFFER_TRANSFER:
+        obj = JS_ReadArrayBufferTransfer(s);
+        break;
     case BC_TAG_SHARED_ARRAY_BUFFER:
         if (!s->allow_sab || !ctx->rt->sab_funcs.sab_dup)
             goto invalid_tag;
@@ -36602,6 +36818,7 @@ JSValue JS_ReadObject(JSContext *ctx, const uint8_t *buf, size_t buf_len,
     s->is_rom_data = ((flags & JS_READ_OBJ_ROM_DATA) != 0);
     s->allow_sab = ((flags & JS_READ_OBJ_SAB) != 0);
     s->allow_reference = ((flags & JS_READ_OBJ_REFERENCE) != 0);
+    s->allow_transfer = ((flags & JS_READ_OBJ_TRANSFER) != 0);
     if (s->allow_bytecode)
         s->first_atom = JS_ATOM_END;
     else
@@ -42423,6 +42640,44 @@ static BOOL test_final_sigma(JSString *p, int sigma_pos)
     return !lre_is_cased(c1);
 }
 
+/* Case conversion of an 8 bit string into an 8 bit string: always
+   possible to lower case, and to upper case unless the string contains
+   one of the few Latin-1 letters whose upper case is not (U+00B5, U+00DF,
+   U+00FF). Consumes 'val', except when returning JS_UNDEFINED if the
+   result does not fit. */
+static JSValue js_string_case_conv8(JSContext *ctx, JSValue val, int to_lower)
+{
+    const uint16_t *tab = lre_latin1_case_conv[to_lower];
+    JSString *p, *r;
+    int i, c;
+
+    p = JS_VALUE_GET_STRING(val);
+    for(i = 0; i < p->len; i++) {
+        if (tab[p->u.str8[i]] != p->u.str8[i])
+            break;
+    }
+    /* already in the requested case */
+    if (i == p->len)
+        return val;
+    r = js_alloc_string(ctx, p->len, 0);
+    if (!r) {
+        JS_FreeValue(ctx, val);
+        return JS_EXCEPTION;
+    }
+    memcpy(r->u.str8, p->u.str8, i);
+    for(; i < p->len; i++) {
+        c = tab[p->u.str8[i]];
+        if (c > 0xff) {
+            js_free_string(ctx->rt, r);
+            return JS_UNDEFINED;
+        }
+        r->u.str8[i] = c;
+    }
+    r->u.str8[p->len] = '\0';
+    JS_FreeValue(ctx, val);
+    return JS_MKPTR(JS_TAG_STRING, r);
+}
+
 static JSValue js_string_toLowerCase(JSContext *ctx, JSValueConst this_val,
                                      int argc, JSValueConst *argv, int to_lower)
 {
@@ -42438,6 +42693,11 @@ static JSValue js_string_toLowerCase(JSContext *ctx, JSValueConst this_val,
     p = JS_VALUE_GET_STRING(val);
     if (p->len == 0)
         return val;
+    if (!p->is_wide_char) {
+        JSValue ret = js_string_case_conv8(ctx, val, to_lower);
+        if (!JS_IsUndefined(ret))
+            return ret;
+    }
     if (string_buffer_init(ctx, b, p->len))
         goto fail;
     for(i = 0; i < p->len;) {
@@ -42601,11 +42861,27 @@ static int js_UTF32_compare(const uint32_t *buf1, int buf1_len,
     return res;
 }
 
+/* TRUE if all the characters are below U+0300, the first combining
+   mark: such text is its own NFC form */
+static BOOL js_string_below_combining(const JSString *p)
+{
+    int i;
+
+    if (!p->is_wide_char)
+        return TRUE;
+    for(i = 0; i < p->len; i++) {
+        if (p->u.str16[i] >= 0x300)
+            return FALSE;
+    }
+    return TRUE;
+}
+
 static JSValue js_string_localeCompare(JSContext *ctx, JSValueConst this_val,
                                        int argc, JSValueConst *argv)
 {
     JSValue a, b;
-    int cmp, a_len, b_len;
+    JSString *pa, *pb;
+    int cmp, a_len, b_len, i, len;
     uint32_t *a_buf, *b_buf;
     
     a = JS_ToStringCheckObject(ctx, this_val);
@@ -42616,6 +42892,21 @@ static JSValue js_string_localeCompare(JSContext *ctx, JSValueConst this_val,
         JS_FreeValue(ctx, a);
         return JS_EXCEPTION;
     }
+    pa = JS_VALUE_GET_STRING(a);
+    pb = JS_VALUE_GET_STRING(b);
+    if (js_string_below_combining(pa) && js_string_below_combining(pb)) {
+        /* already in NFC: same result as js_UTF32_compare() without
+           the copies */
+        len = min_int(pa->len, pb->len);
+        cmp = 0;
+        for(i = 0; i < len && cmp == 0; i++)
+            cmp = string_get(pa, i) - string_get(pb, i);
+        if (cmp == 0)
+            cmp = (pa->len > pb->len) - (pa->len < pb->len);
+        JS_FreeValue(ctx, a);
+        JS_FreeValue(ctx, b);
+        return JS_NewInt32(ctx, cmp);
+    }
     a_len = js_string_normalize1(ctx, &a_buf, a, UNICODE_NFC);
     JS_FreeValue(ctx, a);
     if (a_len < 0) {
@@ -43271,6 +43562,14 @@ static void js_regexp_finalizer(JSRuntime *rt, JSValue val)
     JS_FreeValueRT(rt, JS_MKPTR(JS_TAG_STRING, re->pattern));
 }
 
+/* the cache entry for a pattern and its flags */
+static JSRegExpCacheEntry *js_regexp_cache_entry(JSContext *ctx,
+                                                 JSString *p, int re_flags)
+{
+    uint32_t h = hash_string(p, re_flags);
+    return &ctx->regexp_cache[h & (JS_REGEXP_CACHE_SIZE - 1)];
+}
+
 /* create a string containing the RegExp bytecode */
 static JSValue js_compile_regexp(JSContext *ctx, JSValueConst pattern,
                                  JSValueConst flags)
@@ -43282,6 +43581,8 @@ static JSValue js_compile_regexp(JSContext *ctx, JSValueConst pattern,
     int re_bytecode_len;
     JSValue ret;
     char error_msg[64];
+    JSRegExpCacheEntry *e;
+    JSString *p;
 
     re_flags = 0;
     if (!JS_IsUndefined(flags)) {
@@ -43325,6 +43626,19 @@ static JSValue js_compile_regexp(JSContext *ctx, JSValueConst pattern,
         JS_FreeCString(ctx, str);
     }
 
+    /* 'new RegExp(str)' in a loop compiles the same pattern each time */
+    e = NULL;
+    if (JS_VALUE_GET_TAG(pattern) == JS_TAG_STRING) {
+        p = JS_VALUE_GET_STRING(pattern);
+        e = js_regexp_cache_entry(ctx, p, re_flags);
+        if (e->pattern && e->flags == re_flags &&
+            (e->pattern == p ||
+             (e->pattern->len == p->len &&
+              js_string_memcmp(e->pattern, p, p->len) == 0))) {
+            return JS_DupValue(ctx, JS_MKPTR(JS_TAG_STRING, e->bytecode));
+        }
+    }
+
     str = JS_ToCStringLen2(ctx, &len, pattern, !(re_flags & LRE_FLAG_UTF16));
     if (!str)
         return JS_EXCEPTION;
@@ -43338,6 +43652,15 @@ static JSValue js_compile_regexp(JSContext *ctx, JSValueConst pattern,
 
     ret = js_new_string8(ctx, re_bytecode_buf, re_bytecode_len);
     js_free(ctx, re_bytecode_buf);
+    if (e && !JS_IsException(ret)) {
+        if (e->pattern) {
+            JS_FreeValue(ctx, JS_MKPTR(JS_TAG_STRING, e->pattern));
+            JS_FreeValue(ctx, JS_MKPTR(JS_TAG_STRING, e->bytecode));
+        }
+        e->pattern = JS_VALUE_GET_STRING(JS_DupValue(ctx, pattern));
+        e->bytecode = JS_VALUE_GET_STRING(JS_DupValue(ctx, ret));
+        e->flags = re_flags;
+    }
     return ret;
 }
 
@@ -52744,15 +53067,13 @@ static JSValue js_array_buffer_get_byteLength(JSContext *ctx,
     return JS_NewUint32(ctx, abuf->byte_length);
 }
 
-void JS_DetachArrayBuffer(JSContext *ctx, JSValueConst obj)
+static void array_buffer_detach(JSRuntime *rt, JSArrayBuffer *abuf,
+                                BOOL free_data)
 {
-    JSArrayBuffer *abuf = JS_GetOpaque(obj, JS_CLASS_ARRAY_BUFFER);
     struct list_head *el;
 
-    if (!abuf || abuf->detached)
-        return;
-    if (abuf->free_func)
-        abuf->free_func(ctx->rt, abuf->opaque, abuf->data);
+    if (free_data && abuf->free_func)
+        abuf->free_func(rt, abuf->opaque, abuf->data);
     abuf->data = NULL;
     abuf->byte_length = 0;
     abuf->detached = TRUE;
@@ -52771,6 +53092,15 @@ void JS_DetachArrayBuffer(JSContext *ctx, JSValueConst obj)
     }
 }
 
+void JS_DetachArrayBuffer(JSContext *ctx, JSValueConst obj)
+{
+    JSArrayBuffer *abuf = JS_GetOpaque(obj, JS_CLASS_ARRAY_BUFFER);
+
+    if (!abuf || abuf->detached)
+        return;
+    array_buffer_detach(ctx->rt, abuf, TRUE);
+}
+
 /* get an ArrayBuffer or SharedArrayBuffer */
 static JSArrayBuffer *js_get_array_buffer(JSContext *ctx, JSValueConst obj)
 {
@@ -55544,3 +55874,95 @@ void JS_AddIntrinsicTypedArrays(JSContext *ctx)
     JS_AddIntrinsicAtomics(ctx);
 #endif
 }
+
+/* Lazy intrinsics */
+
+typedef struct JSLazyIntrinsic {
+    void (*add)(JSContext *ctx);
+    /* class protos created by 'add', or 0 */
+    JSClassID class_first, class_last;
+    /* global names defined by 'add', each '\0' terminated */
+    const char *names;
+} JSLazyIntrinsic;
+
+static const JSLazyIntrinsic js_lazy_intrinsics[JS_LAZY_INTRINSIC_COUNT] = {
+    { JS_AddIntrinsicDate, JS_CLASS_DATE, JS_CLASS_DATE, "Date\0" },
+    { JS_AddIntrinsicProxy, 0, 0, "Proxy\0" },
+    { JS_AddIntrinsicMapSet, JS_CLASS_MAP, JS_CLASS_SET_ITERATOR,
+      "Map\0Set\0WeakMap\0WeakSet\0" },
+    { JS_AddIntrinsicTypedArrays, JS_CLASS_ARRAY_BUFFER, JS_CLASS_DATAVIEW,
+      "ArrayBuffer\0SharedArrayBuffer\0Uint8ClampedArray\0Int8Array\0"
+      "Uint8Array\0Int16Array\0Uint16Array\0Int32Array\0Uint32Array\0"
+      "BigInt64Array\0BigUint64Array\0Float32Array\0Float64Array\0"
+      "DataView\0"
+#ifdef CONFIG_ATOMICS
+      "Atomics\0"
+#endif
+    },
+};
+
+/* Run the 'add' function of group 'i' against a scratch object standing
+   in for the global object, so the real global keeps its autoinit
+   properties until each one is read. */
+static void js_lazy_intrinsic_init(JSContext *ctx, int i)
+{
+    JSValue global_obj;
+
+    if (!(ctx->lazy_intrinsics_pending & (1 << i)))
+        return;
+    ctx->lazy_intrinsics_pending &= ~(1 << i);
+    global_obj = ctx->global_obj;
+    ctx->global_obj = JS_NewObject(ctx);
+    js_lazy_intrinsics[i].add(ctx);
+    ctx->lazy_intrinsics[i] = ctx->global_obj;
+    ctx->global_obj = global_obj;
+}
+
+static JSValue js_lazy_intrinsic_autoinit(JSContext *ctx, JSObject *p,
+                                          JSAtom atom, void *opaque)
+{
+    int i = (const JSLazyIntrinsic *)opaque - js_lazy_intrinsics;
+
+    js_lazy_intrinsic_init(ctx, i);
+    return JS_GetProperty(ctx, ctx->lazy_intrinsics[i], atom);
+}
+
+/* instantiate the group owning 'class_id' before its prototype is used
+   without going through the global constructor (bytecode reader,
+   JS_NewArrayBuffer, ...) */
+static void js_lazy_intrinsic_need_class(JSContext *ctx, JSClassID class_id)
+{
+    int i;
+
+    for(i = 0; i < JS_LAZY_INTRINSIC_COUNT; i++) {
+        if (class_id >= js_lazy_intrinsics[i].class_first &&
+            class_id <= js_lazy_intrinsics[i].class_last &&
+            js_lazy_intrinsics[i].class_first != 0) {
+            js_lazy_intrinsic_init(ctx, i);
+            return;
+        }
+    }
+}
+
+/* Define Date, Proxy, Map/Set and the typed arrays as global properties
+   that are only instantiated when first accessed. Use instead of the
+   corresponding JS_AddIntrinsicXXX() on a JS_NewContextRaw() context. */
+void JS_AddLazyIntrinsics(JSContext *ctx)
+{
+    const char *name;
+    JSAtom atom;
+    int i;
+
+    for(i = 0; i < JS_LAZY_INTRINSIC_COUNT; i++) {
+        ctx->lazy_intrinsics_pending |= 1 << i;
+        for(name = js_lazy_intrinsics[i].names; *name != '\0';
+            name += strlen(name) + 1) {
+            atom = JS_NewAtom(ctx, name);
+            JS_DefineAutoInitProperty(ctx, ctx->global_obj, atom,
+                                      JS_AUTOINIT_ID_INTRINSIC,
+                                      (void *)&js_lazy_intrinsics[i],
+                                      JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE);
+            JS_FreeAtom(ctx, atom);
+        }
+    }
+}
@@ -327,6 +327,10 @@ typedef struct JSMallocFunctions {
     void (*js_free)(JSMallocState *s, void *ptr);
     void *(*js_realloc)(JSMallocState *s, void *ptr, size_t size);
     size_t (*js_malloc_usable_size)(const void *ptr);
+    /* optional: bytes 'js_malloc' added to malloc_size for 'ptr'. Used to
+       move a transferred ArrayBuffer between runtimes; defaults to the
+       usable size plus a fixed overhead */
+    size_t (*js_malloc_charge)(const void *ptr);
 } JSMallocFunctions;
 
 typedef struct JSGCObjectHeader JSGCObjectHeader;
@@ -376,6 +380,8 @@ void JS_AddIntrinsicPromise(JSContext *ctx);
 void JS_AddIntrinsicBigInt(JSContext *ctx);
 void JS_AddIntrinsicBigFloat(JSContext *ctx);
 void JS_AddIntrinsicBigDecimal(JSContext *ctx);
+/* Date, Proxy, Map/Set and typed arrays, instantiated on first use */
+void JS_AddLazyIntrinsics(JSContext *ctx);
 /* enable operator overloading */
 void JS_AddIntrinsicOperators(JSContext *ctx);
 /* enable "use math" */
@@ -413,6 +419,7 @@ typedef struct JSMemoryUsage {
     int64_t c_func_count, array_count;
     int64_t fast_array_count, fast_array_elements;
     int64_t binary_object_count, binary_object_size;
+    int64_t gc_count, gc_time; /* JS_RunGC() calls, clock() ticks in them */
 } JSMemoryUsage;
 
 void JS_ComputeMemoryUsage(JSRuntime *rt, JSMemoryUsage *s);
@@ -853,8 +860,23 @@ void JS_SetHostPromiseRejectionTracker(JSRuntime *rt, JSHostPromiseRejectionTrac
 /* return != 0 if the JS code needs to be interrupted */
 typedef int JSInterruptHandler(JSRuntime *rt, void *opaque);
 void JS_SetInterruptHandler(JSRuntime *rt, JSInterruptHandler *cb, void *opaque);
+/* number of interrupt checks (branches and calls) between two handler
+   calls, 10000 by default */
+void JS_SetInterruptInterval(JSRuntime *rt, int interval);
 /* if can_block is TRUE, Atomics.wait() can be used */
 void JS_SetCanBlock(JSRuntime *rt, JS_BOOL can_block);
+
+typedef struct JSStackFrameInfo {
+    JSAtom func_name; /* JS_ATOM_NULL if anonymous */
+    JSAtom filename; /* JS_ATOM_NULL for native functions */
+    int func_line_num; /* line of the definition, -1 if unknown */
+    int line_num; /* current line, -1 if unknown */
+} JSStackFrameInfo;
+
+/* fill 'frames' with the current call stack, innermost first; return the
+   number of frames, at most max_frames */
+int JS_GetStackFrames(JSContext *ctx, JSStackFrameInfo *frames, int max_frames);
+
 /* set the [IsHTMLDDA] internal slot */
 void JS_SetIsHTMLDDA(JSContext *ctx, JSValueConst obj);
 
@@ -896,11 +918,17 @@ uint8_t *JS_WriteObject(JSContext *ctx, size_t *psize, JSValueConst obj,
                         int flags);
 uint8_t *JS_WriteObject2(JSContext *ctx, size_t *psize, JSValueConst obj,
                          int flags, uint8_t ***psab_tab, size_t *psab_tab_len);
+/* move the data of the ArrayBuffers in 'transfer' instead of copying it and
+   detach them; read back once with JS_READ_OBJ_TRANSFER in this process */
+uint8_t *JS_WriteObjectTransfer(JSContext *ctx, size_t *psize, JSValueConst obj,
+                                int flags, uint8_t ***psab_tab, size_t *psab_tab_len,
+                                JSValueConst *transfer, int transfer_len);
 
 #define JS_READ_OBJ_BYTECODE  (1 << 0) /* allow function/module */
 #define JS_READ_OBJ_ROM_DATA  (1 << 1) /* avoid duplicating 'buf' data */
 #define JS_READ_OBJ_SAB       (1 << 2) /* allow SharedArrayBuffer */
 #define JS_READ_OBJ_REFERENCE (1 << 3) /* allow object references */
+#define JS_READ_OBJ_TRANSFER  (1 << 4) /* allow transferred ArrayBuffers */
 JSValue JS_ReadObject(JSContext *ctx, const uint8_t *buf, size_t buf_len,
                       int flags);
 /* instantiate and evaluate a bytecode function. Only used when
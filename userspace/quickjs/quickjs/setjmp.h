@@ -1,14 +1,15 @@
-/* Minimal setjmp.h stub for QuickJS */
+/* Minimal setjmp.h for QuickJS */
 #ifndef _SETJMP_H
 #define _SETJMP_H
 
-/* jmp_buf needs to be large enough to store registers */
+/* AArch64 callee-saved state; see ../../cshim/setjmp.S for the layout */
 typedef long jmp_buf[22];
 typedef long sigjmp_buf[22];
 
-int setjmp(jmp_buf env);
-void longjmp(jmp_buf env, int val);
+int setjmp(jmp_buf env) __attribute__((returns_twice));
+void longjmp(jmp_buf env, int val) __attribute__((noreturn));
 
+/* No signal mask to save */
 #define sigsetjmp(env, save) setjmp(env)
 #define siglongjmp(env, val) longjmp(env, val)
 
@@ -1,69 +1,68 @@
-/* Minimal stdatomic.h stub for QuickJS */
+/* Minimal stdatomic.h for QuickJS */
 #ifndef _STDATOMIC_H
 #define _STDATOMIC_H
 
-/* We run single-threaded, so atomics can be regular operations */
+/* Real atomics: Workers run QuickJS runtimes on several threads, and
+ * Atomics.* operates on SharedArrayBuffer memory they all see. Maps the C11
+ * generic functions onto the compiler builtins (Clang's __c11 builtins take
+ * the _Atomic-qualified pointers QuickJS passes, GCC's __atomic ones accept
+ * them too). Every operation is sequentially consistent. */
 
-typedef int atomic_int;
-typedef unsigned int atomic_uint;
-typedef _Bool atomic_bool;
-typedef unsigned long atomic_uintptr_t;
+typedef _Atomic int atomic_int;
+typedef _Atomic unsigned int atomic_uint;
+typedef _Atomic _Bool atomic_bool;
+typedef _Atomic unsigned long atomic_uintptr_t;
 
-#define ATOMIC_VAR_INIT(value) (value)
-
-#define atomic_init(obj, value) (*(obj) = (value))
-#define atomic_load(obj) (*(obj))
-#define atomic_store(obj, value) (*(obj) = (value))
-#define atomic_exchange(obj, value) ({ \
-    __typeof__(*(obj)) __old = *(obj); \
-    *(obj) = (value); \
-    __old; \
-})
-
-#define atomic_fetch_add(obj, arg) ({ \
-    __typeof__(*(obj)) __old = *(obj); \
-    *(obj) += (arg); \
-    __old; \
-})
-
-#define atomic_fetch_sub(obj, arg) ({ \
-    __typeof__(*(obj)) __old = *(obj); \
-    *(obj) -= (arg); \
-    __old; \
-})
+#define memory_order_relaxed __ATOMIC_RELAXED
+#define memory_order_consume __ATOMIC_CONSUME
+#define memory_order_acquire __ATOMIC_ACQUIRE
+#define memory_order_release __ATOMIC_RELEASE
+#define memory_order_acq_rel __ATOMIC_ACQ_REL
+#define memory_order_seq_cst __ATOMIC_SEQ_CST
 
-#define atomic_fetch_or(obj, arg) ({ \
-    __typeof__(*(obj)) __old = *(obj); \
-    *(obj) |= (arg); \
-    __old; \
-})
-
-#define atomic_fetch_and(obj, arg) ({ \
-    __typeof__(*(obj)) __old = *(obj); \
-    *(obj) &= (arg); \
-    __old; \
-})
-
-#define atomic_compare_exchange_strong(obj, expected, desired) ({ \
-    _Bool __success = (*(obj) == *(expected)); \
-    if (__success) *(obj) = (desired); \
-    else *(expected) = *(obj); \
-    __success; \
-})
-
-#define atomic_compare_exchange_weak atomic_compare_exchange_strong
+#define ATOMIC_VAR_INIT(value) (value)
 
-/* Memory orders - ignored in single-threaded mode */
-#define memory_order_relaxed 0
-#define memory_order_consume 1
-#define memory_order_acquire 2
-#define memory_order_release 3
-#define memory_order_acq_rel 4
-#define memory_order_seq_cst 5
+#if defined(__clang__)
+#define atomic_init(obj, value) __c11_atomic_init(obj, value)
+#define atomic_load_explicit(obj, order) __c11_atomic_load(obj, order)
+#define atomic_store_explicit(obj, value, order) __c11_atomic_store(obj, value, order)
+#define atomic_exchange_explicit(obj, value, order) __c11_atomic_exchange(obj, value, order)
+#define atomic_compare_exchange_strong_explicit(obj, expected, desired, succ, fail) \
+    __c11_atomic_compare_exchange_strong(obj, expected, desired, succ, fail)
+#define atomic_compare_exchange_weak_explicit(obj, expected, desired, succ, fail) \
+    __c11_atomic_compare_exchange_weak(obj, expected, desired, succ, fail)
+#define atomic_fetch_add_explicit(obj, arg, order) __c11_atomic_fetch_add(obj, arg, order)
+#define atomic_fetch_sub_explicit(obj, arg, order) __c11_atomic_fetch_sub(obj, arg, order)
+#define atomic_fetch_or_explicit(obj, arg, order) __c11_atomic_fetch_or(obj, arg, order)
+#define atomic_fetch_xor_explicit(obj, arg, order) __c11_atomic_fetch_xor(obj, arg, order)
+#define atomic_fetch_and_explicit(obj, arg, order) __c11_atomic_fetch_and(obj, arg, order)
+#else
+#define atomic_init(obj, value) __atomic_store_n(obj, value, __ATOMIC_RELAXED)
+#define atomic_load_explicit(obj, order) __atomic_load_n(obj, order)
+#define atomic_store_explicit(obj, value, order) __atomic_store_n(obj, value, order)
+#define atomic_exchange_explicit(obj, value, order) __atomic_exchange_n(obj, value, order)
+#define atomic_compare_exchange_strong_explicit(obj, expected, desired, succ, fail) \
+    __atomic_compare_exchange_n(obj, expected, desired, 0, succ, fail)
+#define atomic_compare_exchange_weak_explicit(obj, expected, desired, succ, fail) \
+    __atomic_compare_exchange_n(obj, expected, desired, 1, succ, fail)
+#define atomic_fetch_add_explicit(obj, arg, order) __atomic_fetch_add(obj, arg, order)
+#define atomic_fetch_sub_explicit(obj, arg, order) __atomic_fetch_sub(obj, arg, order)
+#define atomic_fetch_or_explicit(obj, arg, order) __atomic_fetch_or(obj, arg, order)
+#define atomic_fetch_xor_explicit(obj, arg, order) __atomic_fetch_xor(obj, arg, order)
+#define atomic_fetch_and_explicit(obj, arg, order) __atomic_fetch_and(obj, arg, order)
+#endif
 
-#define atomic_load_explicit(obj, order) atomic_load(obj)
-#define atomic_store_explicit(obj, value, order) atomic_store(obj, value)
-#define atomic_fetch_add_explicit(obj, arg, order) atomic_fetch_add(obj, arg)
-#define atomic_fetch_sub_explicit(obj, arg, order) atomic_fetch_sub(obj, arg)
+#define atomic_load(obj) atomic_load_explicit(obj, __ATOMIC_SEQ_CST)
+#define atomic_store(obj, value) atomic_store_explicit(obj, value, __ATOMIC_SEQ_CST)
+#define atomic_exchange(obj, value) atomic_exchange_explicit(obj, value, __ATOMIC_SEQ_CST)
+#define atomic_compare_exchange_strong(obj, expected, desired) \
+    atomic_compare_exchange_strong_explicit(obj, expected, desired, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define atomic_compare_exchange_weak(obj, expected, desired) \
+    atomic_compare_exchange_weak_explicit(obj, expected, desired, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define atomic_fetch_add(obj, arg) atomic_fetch_add_explicit(obj, arg, __ATOMIC_SEQ_CST)
+#define atomic_fetch_sub(obj, arg) atomic_fetch_sub_explicit(obj, arg, __ATOMIC_SEQ_CST)
+#define atomic_fetch_or(obj, arg) atomic_fetch_or_explicit(obj, arg, __ATOMIC_SEQ_CST)
+#define atomic_fetch_xor(obj, arg) atomic_fetch_xor_explicit(obj, arg, __ATOMIC_SEQ_CST)
+#define atomic_fetch_and(obj, arg) atomic_fetch_and_explicit(obj, arg, __ATOMIC_SEQ_CST)
 
 #endif /* _STDATOMIC_H */
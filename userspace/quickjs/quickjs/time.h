@@ -6,6 +6,16 @@
 
 typedef long time_t;
 typedef long clock_t;
+typedef int clockid_t;
+
+struct timespec {
+    time_t tv_sec;
+    long tv_nsec;
+};
+
+/* Both read the uptime clock, like time() and gettimeofday() */
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
 
 struct tm {
     int tm_sec;
@@ -30,6 +40,7 @@ size_t strftime(char *s, size_t max, const char *format, const struct tm *tm);
 clock_t clock(void);
 time_t mktime(struct tm *tm);
 double difftime(time_t time1, time_t time0);
+int clock_gettime(clockid_t clk_id, struct timespec *tp);
 
 #define CLOCKS_PER_SEC 1000000
 
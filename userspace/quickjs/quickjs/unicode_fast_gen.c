@@ -0,0 +1,166 @@
+/*
+ * Generator of libunicode-fast.h
+ *
+ * A host tool run by build.rs (not part of the engine). It evaluates the
+ * run-length lookups of libunicode.c for every BMP code point and emits
+ * two-level tables for the per-character queries made while running
+ * scripts: simple case conversion, regexp canonicalization and the
+ * ID_Start, ID_Continue, Cased and Case_Ignorable properties.
+ *
+ * Each table is split into blocks of 1 << UNICODE_FAST_SHIFT code points;
+ * identical blocks are stored once and an index maps every block of the
+ * BMP to its data.
+ */
+#define LRE_NO_FAST_TABLES
+#include "libunicode.c"
+
+#include <stdio.h>
+
+#define SHIFT 5
+#define BLOCK_LEN (1 << SHIFT)
+#define NB_BLOCKS (0x10000 >> SHIFT)
+/* case conversion deltas are stored modulo 2^16; this one marks code
+   points left to the slow path (multi-character results) */
+#define DELTA_SLOW 0x8000
+
+static uint32_t tab[0x10000];
+
+static void dump_table(FILE *f, const char *name, const char *type,
+                       int width)
+{
+    /* block_num[b]: position of block b's data among the unique blocks */
+    static int block_first[NB_BLOCKS], block_num[NB_BLOCKS];
+    int nb_unique, b, i, j;
+
+    nb_unique = 0;
+    for(b = 0; b < NB_BLOCKS; b++) {
+        for(i = 0; i < nb_unique; i++) {
+            if (!memcmp(&tab[block_first[i] * BLOCK_LEN], &tab[b * BLOCK_LEN],
+                        sizeof(tab[0]) * BLOCK_LEN))
+                break;
+        }
+        if (i == nb_unique)
+            block_first[nb_unique++] = b;
+        block_num[b] = i;
+    }
+    if (nb_unique > 256) {
+        fprintf(stderr, "%s: %d unique blocks\n", name, nb_unique);
+        exit(1);
+    }
+
+    fprintf(f, "static const uint8_t %s_index[%d] = {", name, NB_BLOCKS);
+    for(b = 0; b < NB_BLOCKS; b++) {
+        if ((b % 16) == 0)
+            fprintf(f, "\n   ");
+        fprintf(f, " %3d,", block_num[b]);
+    }
+    fprintf(f, "\n};\n\n");
+
+    fprintf(f, "static const %s %s_data[%d] = {", type, name,
+            nb_unique * BLOCK_LEN);
+    for(j = 0; j < nb_unique * BLOCK_LEN; j++) {
+        if ((j % 8) == 0)
+            fprintf(f, "\n   ");
+        fprintf(f, " 0x%0*x,", width,
+                tab[block_first[j / BLOCK_LEN] * BLOCK_LEN + j % BLOCK_LEN]);
+    }
+    fprintf(f, "\n};\n\n");
+}
+
+/* delta from c to its single character conversion, or DELTA_SLOW */
+static uint32_t case_delta(uint32_t c, int conv_type)
+{
+    uint32_t res[LRE_CC_RES_LEN_MAX];
+    uint32_t d;
+
+    if (lre_case_conv(res, c, conv_type) != 1 || res[0] >= 0x10000)
+        return DELTA_SLOW;
+    d = (res[0] - c) & 0xffff;
+    if (d == DELTA_SLOW) {
+        fprintf(stderr, "U+%04X: delta collides with DELTA_SLOW\n", c);
+        exit(1);
+    }
+    return d;
+}
+
+static uint32_t canon_delta(uint32_t c, BOOL is_unicode)
+{
+    uint32_t r = lre_canonicalize(c, is_unicode);
+    uint32_t d;
+
+    if (r >= 0x10000)
+        return DELTA_SLOW;
+    d = (r - c) & 0xffff;
+    if (d == DELTA_SLOW) {
+        fprintf(stderr, "U+%04X: delta collides with DELTA_SLOW\n", c);
+        exit(1);
+    }
+    return d;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    uint32_t c, res[LRE_CC_RES_LEN_MAX];
+    int conv_type;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: unicode_fast_gen libunicode-fast.h\n");
+        return 1;
+    }
+    f = fopen(argv[1], "w");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    fprintf(f, "/* Generated by unicode_fast_gen.c from libunicode-table.h - do not edit */\n\n");
+    fprintf(f, "#define UNICODE_FAST_SHIFT %d\n", SHIFT);
+    fprintf(f, "#define UNICODE_FAST_DELTA_SLOW 0x%x\n\n", DELTA_SLOW);
+    fprintf(f, "enum {\n"
+            "    UNICODE_FAST_ID_START = 1 << 0,\n"
+            "    UNICODE_FAST_ID_CONTINUE = 1 << 1,\n"
+            "    UNICODE_FAST_CASED = 1 << 2,\n"
+            "    UNICODE_FAST_CASE_IGNORABLE = 1 << 3,\n"
+            "};\n\n");
+
+    for(c = 0; c < 0x10000; c++)
+        tab[c] = case_delta(c, 0);
+    dump_table(f, "unicode_fast_upper", "uint16_t", 4);
+    for(c = 0; c < 0x10000; c++)
+        tab[c] = case_delta(c, 1);
+    dump_table(f, "unicode_fast_lower", "uint16_t", 4);
+    for(c = 0; c < 0x10000; c++)
+        tab[c] = canon_delta(c, FALSE);
+    dump_table(f, "unicode_fast_canon", "uint16_t", 4);
+    for(c = 0; c < 0x10000; c++)
+        tab[c] = canon_delta(c, TRUE);
+    dump_table(f, "unicode_fast_canon_u", "uint16_t", 4);
+    for(c = 0; c < 0x10000; c++) {
+        tab[c] = (lre_is_id_start(c) ? 1 << 0 : 0) |
+            (lre_is_id_continue(c) ? 1 << 1 : 0) |
+            (lre_is_cased(c) ? 1 << 2 : 0) |
+            (lre_is_case_ignorable(c) ? 1 << 3 : 0);
+    }
+    dump_table(f, "unicode_fast_props", "uint8_t", 2);
+
+    /* flat Latin-1 tables for the 8 bit string fast paths */
+    fprintf(f, "const uint16_t lre_latin1_case_conv[2][256] = {");
+    for(conv_type = 0; conv_type < 2; conv_type++) {
+        fprintf(f, "\n    {");
+        for(c = 0; c < 256; c++) {
+            if ((c % 8) == 0)
+                fprintf(f, "\n       ");
+            if (lre_case_conv(res, c, conv_type) != 1)
+                res[0] = 0xffff;
+            fprintf(f, " 0x%04x,", res[0]);
+        }
+        fprintf(f, "\n    },");
+    }
+    fprintf(f, "\n};\n");
+
+    if (fclose(f)) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+//! Benchmark suite (`qjs --bench [name...]`)
+//!
+//! A fixed set of workloads, each run in a fresh runtime: the script in
+//! `bench/suite/` is evaluated once, then its global `bench()` is called
+//! until `QJS_BENCH_MS` (default 1000) milliseconds have passed. `startup`
+//! times runtime creation plus a trivial script instead.
+//!
+//! Results go to stdout as one JSON object per line, so a harness can
+//! collect them over SSH and compare runs with
+//! `scripts/qjs_bench_compare.py`:
+//!
+//! ```text
+//! {"bench":"json","ops":412,"ms":1001.250,"ops_per_sec":411.5,"peak_heap_kb":1520,"gc_cycles":3,"gc_ms":2.125}
+//! ```
+//!
+//! `peak_heap_kb` is the slab's high-water mark over the timed calls and
+//! the GC figures cover those calls only; the one warm-up call and the
+//! script's setup are not counted.
+
+use alloc::string::String;
+
+use libakuma::{arg, uptime};
+
+use crate::runtime::{self, JSValue, Limits, Runtime};
+use crate::slab;
+
+/// The workloads, in run order
+const SUITE: &[(&str, &str)] = &[
+    ("json", include_str!("../bench/suite/json.js")),
+    ("regex", include_str!("../bench/suite/regex.js")),
+    ("string", include_str!("../bench/suite/string.js")),
+    ("alloc", include_str!("../bench/suite/alloc.js")),
+    ("bigint", include_str!("../bench/suite/bigint.js")),
+    ("typedarray", include_str!("../bench/suite/typedarray.js")),
+];
+
+/// Default time per workload, in milliseconds
+const DEFAULT_MS: u64 = 1000;
+
+/// One workload's measurements
+struct Sample {
+    ops: u64,
+    us: u64,
+    peak_bytes: usize,
+    gc_cycles: i64,
+    gc_us: i64,
+}
+
+/// Run the workloads named by the arguments from `first`, or all of them;
+/// returns the exit code
+pub fn run(limits: &Limits, first: u32) -> i32 {
+    let target_us = match libakuma::env("QJS_BENCH_MS") {
+        Some(v) => match v.parse::<u64>() {
+            Ok(ms) if ms > 0 => ms * 1000,
+            _ => {
+                crate::print_error("Error: QJS_BENCH_MS must be a positive number of ms: ", v);
+                return 1;
+            }
+        },
+        None => DEFAULT_MS * 1000,
+    };
+    let mut names = alloc::vec::Vec::new();
+    let mut i = first;
+    while let Some(name) = arg(i) {
+        if name != "startup" && !SUITE.iter().any(|&(n, _)| n == name) {
+            crate::print_error("Error: unknown benchmark (try startup, json, regex, string, alloc, bigint, typedarray): ", name);
+            return 1;
+        }
+        names.push(name);
+        i += 1;
+    }
+    let selected = |name: &str| names.is_empty() || names.contains(&name);
+
+    let mut code = 0;
+    if selected("startup") {
+        report("startup", &startup(limits, target_us));
+    }
+    for &(name, script) in SUITE {
+        if !selected(name) {
+            continue;
+        }
+        match workload(limits, name, script, target_us) {
+            Ok(s) => report(name, &s),
+            Err(e) => {
+                let line = alloc::format!("{{\"bench\":\"{}\",\"error\":\"{}\"}}\n", name, escape(&e));
+                crate::print(&line);
+                code = 1;
+            }
+        }
+    }
+    code
+}
+
+/// Create a runtime, set up the globals and run an empty script, as a
+/// bare `qjs` invocation would
+fn startup(limits: &Limits, target_us: u64) -> Sample {
+    let mut s = Sample { ops: 0, us: 0, peak_bytes: 0, gc_cycles: 0, gc_us: 0 };
+    slab::reset_peak();
+    let start = uptime();
+    while s.ops == 0 || s.us < target_us {
+        let rt = match Runtime::new(limits) {
+            Some(r) => r,
+            None => break,
+        };
+        crate::setup_console(&rt);
+        crate::setup_akuma(&rt);
+        if let Ok(v) = rt.eval("0", "<startup>") {
+            rt.free_value(v);
+        }
+        let usage = rt.memory_usage();
+        s.gc_cycles += usage.gc_count;
+        s.gc_us += usage.gc_time;
+        drop(rt);
+        s.ops += 1;
+        s.us = uptime() - start;
+    }
+    s.peak_bytes = slab::stats().peak_live_bytes;
+    s
+}
+
+/// Evaluate `script` in a new runtime and time calls to its `bench()`
+fn workload(limits: &Limits, name: &str, script: &str, target_us: u64) -> Result<Sample, String> {
+    let rt = Runtime::new(limits).ok_or_else(|| String::from("failed to create runtime"))?;
+    crate::setup_console(&rt);
+    crate::setup_akuma(&rt);
+    let filename = alloc::format!("<bench/{}>", name);
+    let v = rt.eval(script, &filename)?;
+    rt.free_value(v);
+
+    let ctx = rt.context();
+    let global = rt.global_object();
+    let func = unsafe { runtime::JS_GetPropertyStr(ctx, global, c"bench".as_ptr()) };
+    rt.free_value(global);
+    if unsafe { runtime::JS_IsFunction(ctx, func) } == 0 {
+        rt.free_value(func);
+        return Err(String::from("script defines no bench() function"));
+    }
+    let call = || -> Result<(), String> {
+        let ret = unsafe { runtime::JS_Call(ctx, func, JSValue::undefined(), 0, core::ptr::null_mut()) };
+        if ret.is_exception() {
+            return Err(rt.take_exception());
+        }
+        rt.free_value(ret);
+        Ok(())
+    };
+
+    // Warm up: the first call builds shapes, lazy intrinsics and regexps
+    let result = call().and_then(|()| {
+        let before = rt.memory_usage();
+        slab::reset_peak();
+        let mut s = Sample { ops: 0, us: 0, peak_bytes: 0, gc_cycles: 0, gc_us: 0 };
+        let start = uptime();
+        while s.ops == 0 || s.us < target_us {
+            call()?;
+            s.ops += 1;
+            s.us = uptime() - start;
+        }
+        let after = rt.memory_usage();
+        s.peak_bytes = slab::stats().peak_live_bytes;
+        s.gc_cycles = after.gc_count - before.gc_count;
+        s.gc_us = after.gc_time - before.gc_time;
+        Ok(s)
+    });
+    rt.free_value(func);
+    result
+}
+
+fn report(name: &str, s: &Sample) {
+    let ops_per_sec = s.ops as f64 * 1_000_000.0 / s.us.max(1) as f64;
+    let line = alloc::format!(
+        "{{\"bench\":\"{}\",\"ops\":{},\"ms\":{}.{:03},\"ops_per_sec\":{:.1},\"peak_heap_kb\":{},\
+         \"gc_cycles\":{},\"gc_ms\":{}.{:03}}}\n",
+        name,
+        s.ops,
+        s.us / 1000,
+        s.us % 1000,
+        ops_per_sec,
+        s.peak_bytes / 1024,
+        s.gc_cycles,
+        s.gc_us / 1000,
+        s.gc_us % 1000,
+    );
+    crate::print(&line);
+}
+
+/// `s` as the body of a JSON string
+fn escape(s: &str) -> String {
+    let mut out = String::with_capacity(s.len());
+    for c in s.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            c if (c as u32) < 0x20 => out.push_str(&alloc::format!("\\u{:04x}", c as u32)),
+            c => out.push(c),
+        }
+    }
+    out
+}
@@ -0,0 +1,146 @@
+//! Precompiled bytecode files (`.qbc`) and the on-disk compile cache
+//!
+//! Both hold QuickJS `JS_WriteObject` output behind a small header recording
+//! which source it was compiled from:
+//!
+//! ```text
+//! "QJBC"  format:u32  src_size:u64  src_mtime:i64  src_mtime_nsec:i64
+//! path_len:u32  path[path_len]  bytecode...        (little-endian)
+//! ```
+//!
+//! `qjs -c` writes one next to the script. `qjs file` runs any file that
+//! starts with the magic as bytecode, whatever its name. With `--cache` (or
+//! `QJS_CACHE_DIR` set) compiled scripts are also kept under the cache
+//! directory, keyed by absolute path, mtime and size, so repeat runs of an
+//! unchanged script skip parsing entirely. ES modules it imports are cached
+//! the same way, one entry per file (see `module_loader.rs`).
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use libakuma::Stat;
+
+use crate::runtime;
+
+const MAGIC: &[u8; 4] = b"QJBC";
+/// Bumped when the header layout changes. QuickJS's own bytecode version is
+/// checked by `JS_ReadObject`, which rejects output of another engine build.
+const FORMAT: u32 = 1;
+/// Cache directory when `--cache` is given without `QJS_CACHE_DIR`.
+pub const DEFAULT_CACHE_DIR: &str = "/tmp/qjs-cache";
+
+/// What a compiled file was built from; a cached entry is used only while the
+/// source still matches.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub struct SourceKey {
+    pub size: u64,
+    pub mtime: i64,
+    pub mtime_nsec: i64,
+}
+
+impl SourceKey {
+    pub fn from_stat(stat: &Stat) -> Self {
+        SourceKey {
+            size: stat.st_size as u64,
+            mtime: stat.st_mtime,
+            mtime_nsec: stat.st_mtime_nsec,
+        }
+    }
+}
+
+/// A decoded `.qbc` file
+pub struct Qbc<'a> {
+    pub key: SourceKey,
+    pub path: &'a [u8],
+    pub bytecode: &'a [u8],
+}
+
+/// Whether `data` is a `.qbc` file
+pub fn is_qbc(data: &[u8]) -> bool {
+    data.starts_with(MAGIC)
+}
+
+pub fn encode(key: SourceKey, path: &str, bytecode: &[u8]) -> Vec<u8> {
+    let mut out = Vec::with_capacity(40 + path.len() + bytecode.len());
+    out.extend_from_slice(MAGIC);
+    out.extend_from_slice(&FORMAT.to_le_bytes());
+    out.extend_from_slice(&key.size.to_le_bytes());
+    out.extend_from_slice(&key.mtime.to_le_bytes());
+    out.extend_from_slice(&key.mtime_nsec.to_le_bytes());
+    out.extend_from_slice(&(path.len() as u32).to_le_bytes());
+    out.extend_from_slice(path.as_bytes());
+    out.extend_from_slice(bytecode);
+    out
+}
+
+pub fn decode(data: &[u8]) -> Option<Qbc<'_>> {
+    fn take<'a, const N: usize>(data: &mut &'a [u8]) -> Option<[u8; N]> {
+        let (head, rest) = (data.get(..N)?, data.get(N..)?);
+        *data = rest;
+        head.try_into().ok()
+    }
+    let mut rest = data.strip_prefix(MAGIC)?;
+    if u32::from_le_bytes(take(&mut rest)?) != FORMAT {
+        return None;
+    }
+    let key = SourceKey {
+        size: u64::from_le_bytes(take(&mut rest)?),
+        mtime: i64::from_le_bytes(take(&mut rest)?),
+        mtime_nsec: i64::from_le_bytes(take(&mut rest)?),
+    };
+    let path_len = u32::from_le_bytes(take(&mut rest)?) as usize;
+    let path = rest.get(..path_len)?;
+    let bytecode = rest.get(path_len..)?;
+    Some(Qbc { key, path, bytecode })
+}
+
+/// `path` made absolute against the working directory, so the cache key does
+/// not depend on where qjs was started from
+pub fn absolute_path(path: &str) -> String {
+    if path.starts_with('/') {
+        return String::from(path);
+    }
+    let cwd = libakuma::getcwd();
+    let rel = path.strip_prefix("./").unwrap_or(path);
+    if cwd.ends_with('/') {
+        alloc::format!("{}{}", cwd, rel)
+    } else {
+        alloc::format!("{}/{}", cwd, rel)
+    }
+}
+
+/// Cache file for an absolute script path: FNV-1a of the path, so one entry
+/// per script is rewritten in place as the script changes.
+fn cache_file(dir: &str, abs_path: &str) -> String {
+    let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+    for &b in abs_path.as_bytes() {
+        h = (h ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    alloc::format!("{}/{:016x}.qbc", dir, h)
+}
+
+/// Cached bytecode for `abs_path`, if an entry exists and still matches `key`
+pub fn load_cached(dir: &str, abs_path: &str, key: SourceKey) -> Option<Vec<u8>> {
+    let (data, _) = runtime::read_file_bytes(&cache_file(dir, abs_path)).ok()?;
+    let qbc = decode(&data)?;
+    if qbc.key != key || qbc.path != abs_path.as_bytes() {
+        return None;
+    }
+    Some(qbc.bytecode.to_vec())
+}
+
+/// Store bytecode for `abs_path`. Written to a temporary name and renamed, so
+/// a concurrent run never reads a partial entry. Failures are ignored: the
+/// cache is only an accelerator.
+pub fn store_cached(dir: &str, abs_path: &str, key: SourceKey, bytecode: &[u8]) {
+    if !libakuma::mkdir_p(dir) {
+        return;
+    }
+    let file = cache_file(dir, abs_path);
+    let tmp = alloc::format!("{}.{}.tmp", file, libakuma::getpid());
+    if runtime::write_file(&tmp, &encode(key, abs_path, bytecode)).is_ok()
+        && libakuma::rename(&tmp, &file) < 0
+    {
+        libakuma::unlink(&tmp);
+    }
+}
@@ -0,0 +1,897 @@
+//! `Akuma.crypto`: SHA-256, SHA-1, CRC32C and AES-CTR over ArrayBuffers
+//!
+//! `sha256(buf)`, `sha1(buf)` and `crc32c(buf[, crc])` hash one buffer.
+//! `createHash(name)` and `createCipher("aes-ctr", key, iv)` return objects
+//! whose `update(buf)` takes one chunk at a time, so input larger than
+//! memory can be fed in pieces (say, windows of an `Akuma.mapFile` buffer).
+//! Any ArrayBuffer or TypedArray is accepted; the bytes are read in place.
+//!
+//! On ARMv8 the work runs on the crypto extensions (`SHA256H`/`SHA1C`,
+//! `AESE`/`AESMC`, `CRC32CX`) when AT_HWCAP advertises them, and on portable
+//! Rust otherwise. `QJS_CRYPTO_HW=0` forces the portable code for A/B runs;
+//! `Akuma.crypto.hardware` says which paths are in use.
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use core::ffi::{c_int, c_void};
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+
+#[cfg(target_arch = "aarch64")]
+use core::arch::aarch64::*;
+
+use crate::runtime::{self, JSClassDef, JSContext, JSRuntime, JSValue, Runtime};
+
+// ============================================================================
+// Hardware detection
+// ============================================================================
+
+const AT_HWCAP: u64 = 16;
+const HWCAP_AES: u64 = 1 << 3;
+const HWCAP_SHA1: u64 = 1 << 5;
+const HWCAP_SHA2: u64 = 1 << 6;
+const HWCAP_CRC32: u64 = 1 << 7;
+
+/// AT_HWCAP as read on first use; all ones until then
+static HWCAP: AtomicU64 = AtomicU64::new(u64::MAX);
+
+/// Whether the CPU has every extension in `bits` and the portable path has
+/// not been forced
+fn has(bits: u64) -> bool {
+    let mut caps = HWCAP.load(Ordering::Relaxed);
+    if caps == u64::MAX {
+        caps = if libakuma::env("QJS_CRYPTO_HW") == Some("0") {
+            0
+        } else {
+            libakuma::auxv(AT_HWCAP).unwrap_or(0)
+        };
+        HWCAP.store(caps, Ordering::Relaxed);
+    }
+    cfg!(target_arch = "aarch64") && caps & bits == bits
+}
+
+// ============================================================================
+// SHA-256 and SHA-1
+// ============================================================================
+
+/// Block buffering and length padding shared by SHA-256 and SHA-1, which
+/// both take 64-byte blocks and a big-endian bit count
+#[derive(Clone)]
+struct BlockBuf {
+    buf: [u8; 64],
+    len: usize,
+    total: u64,
+}
+
+impl BlockBuf {
+    const fn new() -> Self {
+        BlockBuf { buf: [0; 64], len: 0, total: 0 }
+    }
+
+    /// Pass whole blocks of `data` to `compress`, keeping the remainder
+    fn update(&mut self, mut data: &[u8], mut compress: impl FnMut(&[u8])) {
+        self.total = self.total.wrapping_add(data.len() as u64);
+        if self.len > 0 {
+            let n = data.len().min(64 - self.len);
+            self.buf[self.len..self.len + n].copy_from_slice(&data[..n]);
+            self.len += n;
+            data = &data[n..];
+            if self.len < 64 {
+                return;
+            }
+            compress(&self.buf);
+            self.len = 0;
+        }
+        let whole = data.len() & !63;
+        if whole > 0 {
+            compress(&data[..whole]);
+        }
+        let rest = &data[whole..];
+        self.buf[..rest.len()].copy_from_slice(rest);
+        self.len = rest.len();
+    }
+
+    /// Append the padding and the length and compress the final block(s)
+    fn finish(&mut self, mut compress: impl FnMut(&[u8])) {
+        let bits = self.total.wrapping_mul(8);
+        self.buf[self.len] = 0x80;
+        self.len += 1;
+        if self.len > 56 {
+            self.buf[self.len..].fill(0);
+            compress(&self.buf);
+            self.len = 0;
+        }
+        self.buf[self.len..56].fill(0);
+        self.buf[56..].copy_from_slice(&bits.to_be_bytes());
+        compress(&self.buf);
+    }
+}
+
+const SHA256_K: [u32; 64] = [
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+];
+
+const SHA256_IV: [u32; 8] = [
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+];
+
+#[derive(Clone)]
+pub struct Sha256 {
+    state: [u32; 8],
+    block: BlockBuf,
+}
+
+impl Sha256 {
+    pub const fn new() -> Self {
+        Sha256 { state: SHA256_IV, block: BlockBuf::new() }
+    }
+
+    pub fn update(&mut self, data: &[u8]) {
+        let state = &mut self.state;
+        self.block.update(data, |blocks| sha256_blocks(state, blocks));
+    }
+
+    pub fn finish(mut self) -> [u8; 32] {
+        let state = &mut self.state;
+        self.block.finish(|blocks| sha256_blocks(state, blocks));
+        let mut out = [0; 32];
+        for (o, w) in out.chunks_exact_mut(4).zip(self.state) {
+            o.copy_from_slice(&w.to_be_bytes());
+        }
+        out
+    }
+}
+
+fn sha256_blocks(state: &mut [u32; 8], blocks: &[u8]) {
+    #[cfg(target_arch = "aarch64")]
+    if has(HWCAP_SHA2) {
+        return unsafe { sha256_blocks_hw(state, blocks) };
+    }
+    sha256_blocks_soft(state, blocks);
+}
+
+fn sha256_blocks_soft(state: &mut [u32; 8], blocks: &[u8]) {
+    for block in blocks.chunks_exact(64) {
+        let mut w = [0u32; 64];
+        for (i, word) in block.chunks_exact(4).enumerate() {
+            w[i] = u32::from_be_bytes([word[0], word[1], word[2], word[3]]);
+        }
+        for i in 16..64 {
+            let s0 = w[i - 15].rotate_right(7) ^ w[i - 15].rotate_right(18) ^ (w[i - 15] >> 3);
+            let s1 = w[i - 2].rotate_right(17) ^ w[i - 2].rotate_right(19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16].wrapping_add(s0).wrapping_add(w[i - 7]).wrapping_add(s1);
+        }
+        let [mut a, mut b, mut c, mut d, mut e, mut f, mut g, mut h] = *state;
+        for i in 0..64 {
+            let s1 = e.rotate_right(6) ^ e.rotate_right(11) ^ e.rotate_right(25);
+            let ch = (e & f) ^ (!e & g);
+            let t1 = h.wrapping_add(s1).wrapping_add(ch).wrapping_add(SHA256_K[i]).wrapping_add(w[i]);
+            let s0 = a.rotate_right(2) ^ a.rotate_right(13) ^ a.rotate_right(22);
+            let maj = (a & b) ^ (a & c) ^ (b & c);
+            let t2 = s0.wrapping_add(maj);
+            h = g;
+            g = f;
+            f = e;
+            e = d.wrapping_add(t1);
+            d = c;
+            c = b;
+            b = a;
+            a = t1.wrapping_add(t2);
+        }
+        for (s, v) in state.iter_mut().zip([a, b, c, d, e, f, g, h]) {
+            *s = s.wrapping_add(v);
+        }
+    }
+}
+
+/// Four rounds per `SHA256H`/`SHA256H2` pair; `SHA256SU0`/`SU1` extend the
+/// message schedule four words at a time
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "sha2")]
+unsafe fn sha256_blocks_hw(state: &mut [u32; 8], blocks: &[u8]) {
+    let mut abcd = vld1q_u32(state.as_ptr());
+    let mut efgh = vld1q_u32(state.as_ptr().add(4));
+    for block in blocks.chunks_exact(64) {
+        let (abcd0, efgh0) = (abcd, efgh);
+        let p = block.as_ptr();
+        let mut m = [
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p))),
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(16)))),
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(32)))),
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(48)))),
+        ];
+        for i in 0..16 {
+            let wk = vaddq_u32(m[i % 4], vld1q_u32(SHA256_K.as_ptr().add(4 * i)));
+            let abcd_in = abcd;
+            abcd = vsha256hq_u32(abcd, efgh, wk);
+            efgh = vsha256h2q_u32(efgh, abcd_in, wk);
+            if i < 12 {
+                m[i % 4] = vsha256su1q_u32(vsha256su0q_u32(m[i % 4], m[(i + 1) % 4]), m[(i + 2) % 4], m[(i + 3) % 4]);
+            }
+        }
+        abcd = vaddq_u32(abcd, abcd0);
+        efgh = vaddq_u32(efgh, efgh0);
+    }
+    vst1q_u32(state.as_mut_ptr(), abcd);
+    vst1q_u32(state.as_mut_ptr().add(4), efgh);
+}
+
+const SHA1_K: [u32; 4] = [0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6];
+
+const SHA1_IV: [u32; 5] = [0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0];
+
+#[derive(Clone)]
+pub struct Sha1 {
+    state: [u32; 5],
+    block: BlockBuf,
+}
+
+impl Sha1 {
+    pub const fn new() -> Self {
+        Sha1 { state: SHA1_IV, block: BlockBuf::new() }
+    }
+
+    pub fn update(&mut self, data: &[u8]) {
+        let state = &mut self.state;
+        self.block.update(data, |blocks| sha1_blocks(state, blocks));
+    }
+
+    pub fn finish(mut self) -> [u8; 20] {
+        let state = &mut self.state;
+        self.block.finish(|blocks| sha1_blocks(state, blocks));
+        let mut out = [0; 20];
+        for (o, w) in out.chunks_exact_mut(4).zip(self.state) {
+            o.copy_from_slice(&w.to_be_bytes());
+        }
+        out
+    }
+}
+
+fn sha1_blocks(state: &mut [u32; 5], blocks: &[u8]) {
+    #[cfg(target_arch = "aarch64")]
+    if has(HWCAP_SHA1) {
+        return unsafe { sha1_blocks_hw(state, blocks) };
+    }
+    sha1_blocks_soft(state, blocks);
+}
+
+fn sha1_blocks_soft(state: &mut [u32; 5], blocks: &[u8]) {
+    for block in blocks.chunks_exact(64) {
+        let mut w = [0u32; 80];
+        for (i, word) in block.chunks_exact(4).enumerate() {
+            w[i] = u32::from_be_bytes([word[0], word[1], word[2], word[3]]);
+        }
+        for i in 16..80 {
+            w[i] = (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16]).rotate_left(1);
+        }
+        let [mut a, mut b, mut c, mut d, mut e] = *state;
+        for (i, &wi) in w.iter().enumerate() {
+            let f = match i / 20 {
+                0 => (b & c) | (!b & d),
+                2 => (b & c) | (b & d) | (c & d),
+                _ => b ^ c ^ d,
+            };
+            let t = a.rotate_left(5).wrapping_add(f).wrapping_add(e).wrapping_add(SHA1_K[i / 20]).wrapping_add(wi);
+            e = d;
+            d = c;
+            c = b.rotate_left(30);
+            b = a;
+            a = t;
+        }
+        for (s, v) in state.iter_mut().zip([a, b, c, d, e]) {
+            *s = s.wrapping_add(v);
+        }
+    }
+}
+
+/// Four rounds per `SHA1C`/`SHA1P`/`SHA1M`, with `SHA1H` carrying E
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "sha2")]
+unsafe fn sha1_blocks_hw(state: &mut [u32; 5], blocks: &[u8]) {
+    let mut abcd = vld1q_u32(state.as_ptr());
+    let mut e = state[4];
+    for block in blocks.chunks_exact(64) {
+        let (abcd0, e0) = (abcd, e);
+        let p = block.as_ptr();
+        let mut m = [
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p))),
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(16)))),
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(32)))),
+            vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p.add(48)))),
+        ];
+        for i in 0..20 {
+            let wk = vaddq_u32(m[i % 4], vdupq_n_u32(SHA1_K[i / 5]));
+            let e_next = vsha1h_u32(vgetq_lane_u32::<0>(abcd));
+            abcd = match i / 5 {
+                0 => vsha1cq_u32(abcd, e, wk),
+                2 => vsha1mq_u32(abcd, e, wk),
+                _ => vsha1pq_u32(abcd, e, wk),
+            };
+            e = e_next;
+            if i < 16 {
+                m[i % 4] = vsha1su1q_u32(vsha1su0q_u32(m[i % 4], m[(i + 1) % 4], m[(i + 2) % 4]), m[(i + 3) % 4]);
+            }
+        }
+        abcd = vaddq_u32(abcd, abcd0);
+        e = e.wrapping_add(e0);
+    }
+    vst1q_u32(state.as_mut_ptr(), abcd);
+    state[4] = e;
+}
+
+// ============================================================================
+// CRC32C
+// ============================================================================
+
+/// Reflected Castagnoli polynomial
+const CRC32C_POLY: u32 = 0x82f6_3b78;
+
+const CRC32C_TABLE: [u32; 256] = {
+    let mut table = [0u32; 256];
+    let mut i = 0;
+    while i < 256 {
+        let mut c = i as u32;
+        let mut k = 0;
+        while k < 8 {
+            c = if c & 1 != 0 { (c >> 1) ^ CRC32C_POLY } else { c >> 1 };
+            k += 1;
+        }
+        table[i] = c;
+        i += 1;
+    }
+    table
+};
+
+/// CRC32C of `data` continuing from `crc` (0 to start), so that
+/// `crc32c(b, crc32c(a, 0))` is the CRC of `a` followed by `b`
+pub fn crc32c(crc: u32, data: &[u8]) -> u32 {
+    #[cfg(target_arch = "aarch64")]
+    if has(HWCAP_CRC32) {
+        return !unsafe { crc32c_hw(!crc, data) };
+    }
+    !crc32c_soft(!crc, data)
+}
+
+fn crc32c_soft(mut crc: u32, data: &[u8]) -> u32 {
+    for &b in data {
+        crc = CRC32C_TABLE[((crc ^ b as u32) & 0xff) as usize] ^ (crc >> 8);
+    }
+    crc
+}
+
+/// `CRC32CX` over the 8-byte-aligned middle (the target is strict-align),
+/// `CRC32CB` over the ends
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "crc")]
+unsafe fn crc32c_hw(mut crc: u32, data: &[u8]) -> u32 {
+    let (head, words, tail) = data.align_to::<u64>();
+    for &b in head {
+        crc = __crc32cb(crc, b);
+    }
+    for &w in words {
+        crc = __crc32cd(crc, w);
+    }
+    for &b in tail {
+        crc = __crc32cb(crc, b);
+    }
+    crc
+}
+
+// ============================================================================
+// AES-CTR
+// ============================================================================
+
+const AES_SBOX: [u8; 256] = [
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+];
+
+/// Maximum rounds (AES-256)
+const AES_MAX_ROUNDS: usize = 14;
+
+/// AES in counter mode: the 16-byte IV is the initial counter block and is
+/// incremented as one big-endian 128-bit number, as in NIST SP 800-38A and
+/// OpenSSL's `aes-*-ctr`. Encryption and decryption are the same operation.
+pub struct AesCtr {
+    round_keys: [[u8; 16]; AES_MAX_ROUNDS + 1],
+    rounds: usize,
+    counter: [u8; 16],
+    /// Keystream of the last partial block and how much of it is used
+    keystream: [u8; 16],
+    used: usize,
+}
+
+impl AesCtr {
+    /// A 16-, 24- or 32-byte key and a 16-byte IV
+    pub fn new(key: &[u8], iv: &[u8]) -> Option<Self> {
+        if !matches!(key.len(), 16 | 24 | 32) || iv.len() != 16 {
+            return None;
+        }
+        let nk = key.len() / 4;
+        let rounds = nk + 6;
+        let mut w = [[0u8; 4]; 4 * (AES_MAX_ROUNDS + 1)];
+        for (i, word) in key.chunks_exact(4).enumerate() {
+            w[i].copy_from_slice(word);
+        }
+        let mut rcon = 1u8;
+        for i in nk..4 * (rounds + 1) {
+            let mut t = w[i - 1];
+            if i % nk == 0 {
+                t = [AES_SBOX[t[1] as usize] ^ rcon, AES_SBOX[t[2] as usize], AES_SBOX[t[3] as usize], AES_SBOX[t[0] as usize]];
+                rcon = xtime(rcon);
+            } else if nk > 6 && i % nk == 4 {
+                t = t.map(|b| AES_SBOX[b as usize]);
+            }
+            for j in 0..4 {
+                w[i][j] = w[i - nk][j] ^ t[j];
+            }
+        }
+        let mut round_keys = [[0u8; 16]; AES_MAX_ROUNDS + 1];
+        for (r, rk) in round_keys.iter_mut().enumerate().take(rounds + 1) {
+            for c in 0..4 {
+                rk[4 * c..4 * c + 4].copy_from_slice(&w[4 * r + c]);
+            }
+        }
+        let mut counter = [0u8; 16];
+        counter.copy_from_slice(iv);
+        Some(AesCtr { round_keys, rounds, counter, keystream: [0; 16], used: 16 })
+    }
+
+    /// XOR the keystream into `data`, continuing where the last call stopped
+    pub fn apply(&mut self, data: &mut [u8]) {
+        let mut i = 0;
+        while self.used < 16 && i < data.len() {
+            data[i] ^= self.keystream[self.used];
+            self.used += 1;
+            i += 1;
+        }
+        let whole = (data.len() - i) & !15;
+        self.apply_blocks(&mut data[i..i + whole]);
+        i += whole;
+        if i < data.len() {
+            let mut ks = self.counter;
+            self.encrypt_blocks(core::slice::from_mut(&mut ks));
+            self.keystream = ks;
+            increment(&mut self.counter);
+            self.used = 0;
+            for b in &mut data[i..] {
+                *b ^= self.keystream[self.used];
+                self.used += 1;
+            }
+        }
+    }
+
+    /// Whole blocks of keystream, XORed in
+    fn apply_blocks(&mut self, data: &mut [u8]) {
+        #[cfg(target_arch = "aarch64")]
+        if has(HWCAP_AES) {
+            return unsafe { self.apply_blocks_hw(data) };
+        }
+        for block in data.chunks_exact_mut(16) {
+            let mut ks = self.counter;
+            self.encrypt_blocks(core::slice::from_mut(&mut ks));
+            increment(&mut self.counter);
+            for (b, k) in block.iter_mut().zip(ks) {
+                *b ^= k;
+            }
+        }
+    }
+
+    fn encrypt_blocks(&self, blocks: &mut [[u8; 16]]) {
+        #[cfg(target_arch = "aarch64")]
+        if has(HWCAP_AES) {
+            return unsafe { self.encrypt_blocks_hw(blocks) };
+        }
+        for block in blocks {
+            self.encrypt_soft(block);
+        }
+    }
+
+    fn encrypt_soft(&self, s: &mut [u8; 16]) {
+        xor_block(s, &self.round_keys[0]);
+        for r in 1..=self.rounds {
+            // SubBytes and ShiftRows: row `i` of column `c` comes from column
+            // `c + i`
+            let t = *s;
+            for c in 0..4 {
+                for i in 0..4 {
+                    s[4 * c + i] = AES_SBOX[t[4 * ((c + i) % 4) + i] as usize];
+                }
+            }
+            if r < self.rounds {
+                for col in s.chunks_exact_mut(4) {
+                    let [a0, a1, a2, a3] = [col[0], col[1], col[2], col[3]];
+                    let all = a0 ^ a1 ^ a2 ^ a3;
+                    col[0] ^= all ^ xtime(a0 ^ a1);
+                    col[1] ^= all ^ xtime(a1 ^ a2);
+                    col[2] ^= all ^ xtime(a2 ^ a3);
+                    col[3] ^= all ^ xtime(a3 ^ a0);
+                }
+            }
+            xor_block(s, &self.round_keys[r]);
+        }
+    }
+
+    /// `AESE` (AddRoundKey, SubBytes, ShiftRows) and `AESMC` per round
+    #[cfg(target_arch = "aarch64")]
+    #[target_feature(enable = "aes")]
+    unsafe fn encrypt_blocks_hw(&self, blocks: &mut [[u8; 16]]) {
+        let rk = self.load_round_keys();
+        for block in blocks {
+            let s = aes_encrypt_hw(&rk, self.rounds, vld1q_u8(block.as_ptr()));
+            vst1q_u8(block.as_mut_ptr(), s);
+        }
+    }
+
+    /// Four counter blocks in flight at a time, so the `AESE`/`AESMC` pairs
+    /// of independent blocks overlap in the pipeline
+    #[cfg(target_arch = "aarch64")]
+    #[target_feature(enable = "aes")]
+    unsafe fn apply_blocks_hw(&mut self, data: &mut [u8]) {
+        let rk = self.load_round_keys();
+        let mut chunks = data.chunks_exact_mut(64);
+        for chunk in &mut chunks {
+            let mut s = [vdupq_n_u8(0); 4];
+            for b in &mut s {
+                *b = vld1q_u8(self.counter.as_ptr());
+                increment(&mut self.counter);
+            }
+            for r in 0..self.rounds - 1 {
+                for b in &mut s {
+                    *b = vaesmcq_u8(vaeseq_u8(*b, rk[r]));
+                }
+            }
+            for (j, b) in s.iter().enumerate() {
+                let ks = veorq_u8(vaeseq_u8(*b, rk[self.rounds - 1]), rk[self.rounds]);
+                let p = chunk.as_mut_ptr().add(16 * j);
+                vst1q_u8(p, veorq_u8(vld1q_u8(p), ks));
+            }
+        }
+        for block in chunks.into_remainder().chunks_exact_mut(16) {
+            let ks = aes_encrypt_hw(&rk, self.rounds, vld1q_u8(self.counter.as_ptr()));
+            increment(&mut self.counter);
+            vst1q_u8(block.as_mut_ptr(), veorq_u8(vld1q_u8(block.as_ptr()), ks));
+        }
+    }
+
+    #[cfg(target_arch = "aarch64")]
+    #[target_feature(enable = "aes")]
+    unsafe fn load_round_keys(&self) -> [uint8x16_t; AES_MAX_ROUNDS + 1] {
+        let mut rk = [vdupq_n_u8(0); AES_MAX_ROUNDS + 1];
+        for (v, k) in rk.iter_mut().zip(&self.round_keys).take(self.rounds + 1) {
+            *v = vld1q_u8(k.as_ptr());
+        }
+        rk
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+#[target_feature(enable = "aes")]
+unsafe fn aes_encrypt_hw(rk: &[uint8x16_t; AES_MAX_ROUNDS + 1], rounds: usize, mut s: uint8x16_t) -> uint8x16_t {
+    for k in &rk[..rounds - 1] {
+        s = vaesmcq_u8(vaeseq_u8(s, *k));
+    }
+    veorq_u8(vaeseq_u8(s, rk[rounds - 1]), rk[rounds])
+}
+
+fn xtime(b: u8) -> u8 {
+    (b << 1) ^ if b & 0x80 != 0 { 0x1b } else { 0 }
+}
+
+fn xor_block(s: &mut [u8; 16], k: &[u8; 16]) {
+    for (a, b) in s.iter_mut().zip(k) {
+        *a ^= b;
+    }
+}
+
+/// Add one to a big-endian 128-bit counter
+fn increment(counter: &mut [u8; 16]) {
+    for b in counter.iter_mut().rev() {
+        *b = b.wrapping_add(1);
+        if *b != 0 {
+            break;
+        }
+    }
+}
+
+// ============================================================================
+// JS bindings
+// ============================================================================
+
+/// Class IDs of `createHash` and `createCipher` objects, shared by every
+/// runtime
+static HASH_CLASS: AtomicU32 = AtomicU32::new(0);
+static CIPHER_CLASS: AtomicU32 = AtomicU32::new(0);
+
+/// State behind a `createHash` object, held as an `Option` that `digest()`
+/// empties
+enum Hasher {
+    Sha256(Sha256),
+    Sha1(Sha1),
+    Crc32c(u32),
+}
+
+unsafe fn string_arg(ctx: *mut JSContext, val: JSValue) -> Option<String> {
+    let mut len = 0;
+    let cstr = runtime::JS_ToCStringLen2(ctx, &mut len, val, 0);
+    if cstr.is_null() {
+        return None;
+    }
+    let s = String::from_utf8_lossy(core::slice::from_raw_parts(cstr as *const u8, len)).into_owned();
+    runtime::JS_FreeCString(ctx, cstr);
+    Some(s)
+}
+
+fn new_u32(v: u32) -> JSValue {
+    match i32::try_from(v) {
+        Ok(i) => JSValue::int32(i),
+        Err(_) => JSValue::float64(v as f64),
+    }
+}
+
+/// `Akuma.crypto.sha256(buf)`: the digest as a 32-byte ArrayBuffer
+unsafe extern "C" fn js_sha256(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"sha256: buffer expected".as_ptr());
+    }
+    let data = match runtime::buffer_bytes(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let mut h = Sha256::new();
+    h.update(data);
+    let out = h.finish();
+    runtime::JS_NewArrayBufferCopy(ctx, out.as_ptr(), out.len())
+}
+
+/// `Akuma.crypto.sha1(buf)`: the digest as a 20-byte ArrayBuffer
+unsafe extern "C" fn js_sha1(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"sha1: buffer expected".as_ptr());
+    }
+    let data = match runtime::buffer_bytes(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let mut h = Sha1::new();
+    h.update(data);
+    let out = h.finish();
+    runtime::JS_NewArrayBufferCopy(ctx, out.as_ptr(), out.len())
+}
+
+/// `Akuma.crypto.crc32c(buf[, crc])`: the CRC as an unsigned number,
+/// continuing from a previous result `crc`
+unsafe extern "C" fn js_crc32c(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"crc32c: buffer expected".as_ptr());
+    }
+    let mut crc = 0.0;
+    if argc > 1 && runtime::JS_ToFloat64(ctx, &mut crc, *argv.add(1)) < 0 {
+        return JSValue::exception();
+    }
+    // Convert before borrowing the bytes: JS_ToFloat64 may run JS
+    let data = match runtime::buffer_bytes(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    new_u32(crc32c(crc as u32, data))
+}
+
+/// `Akuma.crypto.createHash(name)`: a hash over chunks passed to
+/// `update(buf)`, ended by `digest()`. `name` is "sha256", "sha1" or
+/// "crc32c".
+unsafe extern "C" fn js_create_hash(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"createHash: algorithm expected".as_ptr());
+    }
+    let name = match string_arg(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let hasher = match name.as_str() {
+        "sha256" => Hasher::Sha256(Sha256::new()),
+        "sha1" => Hasher::Sha1(Sha1::new()),
+        "crc32c" => Hasher::Crc32c(0),
+        _ => {
+            let msg = alloc::format!("createHash: unknown algorithm: {}\0", name);
+            return runtime::JS_ThrowTypeError(ctx, c"%s".as_ptr(), msg.as_ptr());
+        }
+    };
+    let obj = runtime::JS_NewObjectClass(ctx, HASH_CLASS.load(Ordering::Relaxed) as c_int);
+    if obj.is_exception() {
+        return obj;
+    }
+    runtime::JS_SetOpaque(obj, Box::into_raw(Box::new(Some(hasher))) as *mut c_void);
+    obj
+}
+
+unsafe fn hash_state<'a>(ctx: *mut JSContext, this: JSValue) -> Option<&'a mut Option<Hasher>> {
+    let state = runtime::JS_GetOpaque2(ctx, this, HASH_CLASS.load(Ordering::Relaxed)) as *mut Option<Hasher>;
+    state.as_mut()
+}
+
+/// `hash.update(buf)`: add a chunk; returns the hash for chaining
+unsafe extern "C" fn js_hash_update(ctx: *mut JSContext, this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let state = match hash_state(ctx, this) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"update: buffer expected".as_ptr());
+    }
+    let data = match runtime::buffer_bytes(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    match state {
+        Some(Hasher::Sha256(h)) => h.update(data),
+        Some(Hasher::Sha1(h)) => h.update(data),
+        Some(Hasher::Crc32c(crc)) => *crc = crc32c(*crc, data),
+        None => return runtime::JS_ThrowTypeError(ctx, c"update: digest already called".as_ptr()),
+    }
+    runtime::dup_value(this)
+}
+
+/// `hash.digest()`: the result as an ArrayBuffer (the CRC big-endian, like
+/// its usual hex form); the hash cannot be used afterwards
+unsafe extern "C" fn js_hash_digest(ctx: *mut JSContext, this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    let state = match hash_state(ctx, this) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    match state.take() {
+        Some(Hasher::Sha256(h)) => {
+            let out = h.finish();
+            runtime::JS_NewArrayBufferCopy(ctx, out.as_ptr(), out.len())
+        }
+        Some(Hasher::Sha1(h)) => {
+            let out = h.finish();
+            runtime::JS_NewArrayBufferCopy(ctx, out.as_ptr(), out.len())
+        }
+        Some(Hasher::Crc32c(crc)) => runtime::JS_NewArrayBufferCopy(ctx, crc.to_be_bytes().as_ptr(), 4),
+        None => runtime::JS_ThrowTypeError(ctx, c"digest: digest already called".as_ptr()),
+    }
+}
+
+unsafe extern "C" fn hash_finalizer(_rt: *mut JSRuntime, val: JSValue) {
+    let state = runtime::JS_GetOpaque(val, HASH_CLASS.load(Ordering::Relaxed)) as *mut Option<Hasher>;
+    if !state.is_null() {
+        drop(Box::from_raw(state));
+    }
+}
+
+static HASH_CLASS_DEF: JSClassDef = JSClassDef {
+    class_name: c"Hash".as_ptr(),
+    finalizer: Some(hash_finalizer),
+    gc_mark: core::ptr::null(),
+    call: core::ptr::null(),
+    exotic: core::ptr::null(),
+};
+
+/// `Akuma.crypto.createCipher("aes-ctr", key, iv)`: AES-128/192/256 (by key
+/// length) in counter mode with a 16-byte initial counter block.
+/// `update(buf)` returns the chunk encrypted (or decrypted) as a new
+/// ArrayBuffer; chunks need not be multiples of the block size.
+unsafe extern "C" fn js_create_cipher(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 3 {
+        return runtime::JS_ThrowTypeError(ctx, c"createCipher: algorithm, key and iv expected".as_ptr());
+    }
+    let name = match string_arg(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    if name != "aes-ctr" {
+        let msg = alloc::format!("createCipher: unknown algorithm: {}\0", name);
+        return runtime::JS_ThrowTypeError(ctx, c"%s".as_ptr(), msg.as_ptr());
+    }
+    let key = match runtime::buffer_bytes(ctx, *argv.add(1)) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let iv = match runtime::buffer_bytes(ctx, *argv.add(2)) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let cipher = match AesCtr::new(key, iv) {
+        Some(c) => c,
+        None => return runtime::JS_ThrowTypeError(ctx, c"createCipher: key must be 16, 24 or 32 bytes and iv 16".as_ptr()),
+    };
+    let obj = runtime::JS_NewObjectClass(ctx, CIPHER_CLASS.load(Ordering::Relaxed) as c_int);
+    if obj.is_exception() {
+        return obj;
+    }
+    runtime::JS_SetOpaque(obj, Box::into_raw(Box::new(cipher)) as *mut c_void);
+    obj
+}
+
+/// `cipher.update(buf)`
+unsafe extern "C" fn js_cipher_update(ctx: *mut JSContext, this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let cipher = runtime::JS_GetOpaque2(ctx, this, CIPHER_CLASS.load(Ordering::Relaxed)) as *mut AesCtr;
+    let cipher = match cipher.as_mut() {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"update: buffer expected".as_ptr());
+    }
+    let data = match runtime::buffer_bytes(ctx, *argv) {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let out = runtime::JS_NewArrayBufferCopy(ctx, data.as_ptr(), data.len());
+    if out.is_exception() {
+        return out;
+    }
+    let mut size = 0;
+    let ptr = runtime::JS_GetArrayBuffer(ctx, &mut size, out);
+    cipher.apply(core::slice::from_raw_parts_mut(ptr, size));
+    out
+}
+
+unsafe extern "C" fn cipher_finalizer(_rt: *mut JSRuntime, val: JSValue) {
+    let cipher = runtime::JS_GetOpaque(val, CIPHER_CLASS.load(Ordering::Relaxed)) as *mut AesCtr;
+    if !cipher.is_null() {
+        drop(Box::from_raw(cipher));
+    }
+}
+
+static CIPHER_CLASS_DEF: JSClassDef = JSClassDef {
+    class_name: c"Cipher".as_ptr(),
+    finalizer: Some(cipher_finalizer),
+    gc_mark: core::ptr::null(),
+    call: core::ptr::null(),
+    exotic: core::ptr::null(),
+};
+
+/// Register the hash and cipher classes on `rt` and install `crypto` on
+/// the `Akuma` object
+pub fn setup(rt: &Runtime, akuma: JSValue) {
+    unsafe {
+        let ctx = rt.context();
+        let hash_class = runtime::JS_NewClassID(HASH_CLASS.as_ptr());
+        runtime::JS_NewClass(rt.runtime(), hash_class, &HASH_CLASS_DEF);
+        let proto = runtime::JS_NewObject(ctx);
+        rt.set_property_str(proto, "update", rt.new_c_function(js_hash_update, "update", 1));
+        rt.set_property_str(proto, "digest", rt.new_c_function(js_hash_digest, "digest", 0));
+        runtime::JS_SetClassProto(ctx, hash_class, proto);
+
+        let cipher_class = runtime::JS_NewClassID(CIPHER_CLASS.as_ptr());
+        runtime::JS_NewClass(rt.runtime(), cipher_class, &CIPHER_CLASS_DEF);
+        let proto = runtime::JS_NewObject(ctx);
+        rt.set_property_str(proto, "update", rt.new_c_function(js_cipher_update, "update", 1));
+        runtime::JS_SetClassProto(ctx, cipher_class, proto);
+
+        let crypto = runtime::JS_NewObject(ctx);
+        rt.set_property_str(crypto, "sha256", rt.new_c_function(js_sha256, "sha256", 1));
+        rt.set_property_str(crypto, "sha1", rt.new_c_function(js_sha1, "sha1", 1));
+        rt.set_property_str(crypto, "crc32c", rt.new_c_function(js_crc32c, "crc32c", 2));
+        rt.set_property_str(crypto, "createHash", rt.new_c_function(js_create_hash, "createHash", 1));
+        rt.set_property_str(crypto, "createCipher", rt.new_c_function(js_create_cipher, "createCipher", 3));
+        let hardware = runtime::JS_NewObject(ctx);
+        for (name, bits) in [("sha256", HWCAP_SHA2), ("sha1", HWCAP_SHA1), ("crc32c", HWCAP_CRC32), ("aes", HWCAP_AES)] {
+            rt.set_property_str(hardware, name, JSValue::bool(has(bits)));
+        }
+        rt.set_property_str(crypto, "hardware", hardware);
+        rt.set_property_str(akuma, "crypto", crypto);
+    }
+}
@@ -0,0 +1,878 @@
+//! Event loop: timers and Promise-based file and socket I/O for qjs
+//!
+//! After the script (or `-e` code) finishes, `run` keeps the process alive
+//! while anything is pending: Promise jobs, `setTimeout`/`setInterval`
+//! timers, and the operations started by the `Akuma.readFile`, `connect`,
+//! `accept`, `read` and `write` functions. Sockets are non-blocking and
+//! watched through one level-triggered epoll instance; the loop sleeps in
+//! `epoll_pwait` until an fd is ready or the nearest timer is due.
+//!
+//! The kernel's aio calls are stubs, so `readFile` reads in 64 KB chunks,
+//! one chunk per loop iteration, and other work keeps running between them.
+//! Host names passed to `connect` are resolved with the (blocking)
+//! `resolve_host` syscall; dotted IPv4 addresses skip it.
+//!
+//! Other modules can watch their own fds with [`add_source`]; Worker
+//! message ports use this to wake the loop on an eventfd.
+//!
+//! Each runtime has its own loop (Worker threads run one each), kept behind
+//! a `Spinlock` in the runtime's opaque pointer. The lock is never held
+//! across a call into JS, since callbacks may start or cancel more work.
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::ffi::{c_char, c_int, c_void};
+
+use libakuma::epoll::{EPOLLERR, EPOLLHUP, EPOLLIN, EPOLLOUT, EPOLL_CLOEXEC, EPOLL_CTL_ADD, EPOLL_CTL_DEL, EPOLL_CTL_MOD};
+use libakuma::{open, open_flags, read_fd, uptime, EpollEvent, SocketAddrV4, Spinlock};
+
+use crate::runtime::{self, JSContext, JSRuntime, JSValue, Runtime};
+use crate::stdio;
+
+const EAGAIN: i32 = 11;
+const EINPROGRESS: i32 = 115;
+const AF_INET: i32 = 2;
+const SOCK_STREAM: i32 = 1;
+const SOCK_NONBLOCK: i32 = 0x800;
+
+/// Bytes `readFile` reads per loop iteration
+const FILE_CHUNK: usize = 64 * 1024;
+/// Default and largest `Akuma.read` request
+const READ_MAX: usize = 64 * 1024;
+/// Events taken per `epoll_pwait`
+const MAX_EVENTS: usize = 16;
+
+struct Timer {
+    id: i32,
+    deadline: u64,
+    /// Period in µs for `setInterval`
+    interval: Option<u64>,
+    func: JSValue,
+    args: Vec<JSValue>,
+}
+
+enum OpKind {
+    Connect,
+    Accept,
+    Read { max: usize },
+    Write { data: Vec<u8>, done: usize },
+}
+
+impl OpKind {
+    fn events(&self) -> u32 {
+        match self {
+            OpKind::Connect | OpKind::Write { .. } => EPOLLOUT,
+            OpKind::Accept | OpKind::Read { .. } => EPOLLIN,
+        }
+    }
+}
+
+/// A Promise waiting on a socket
+struct Op {
+    fd: i32,
+    kind: OpKind,
+    resolve: JSValue,
+    reject: JSValue,
+}
+
+/// A `readFile` in progress
+struct FileRead {
+    fd: i32,
+    data: Vec<u8>,
+    resolve: JSValue,
+    reject: JSValue,
+}
+
+/// An fd watched for another module, such as a Worker message port. The
+/// loop calls `ready` when `fd` is readable, drops the source once
+/// `finished` says so, and, while nothing else is pending, keeps running
+/// as long as some source `keeps_alive`. `free` releases `data` when the
+/// source is dropped or the loop is torn down.
+#[derive(Clone, Copy)]
+pub struct Source {
+    pub fd: i32,
+    pub data: usize,
+    pub ready: unsafe fn(*mut JSContext, usize) -> Result<(), ()>,
+    pub finished: unsafe fn(*mut JSContext, usize) -> bool,
+    pub keeps_alive: unsafe fn(*mut JSContext, usize) -> bool,
+    pub free: unsafe fn(*mut JSContext, usize),
+}
+
+/// What finishing an operation does to its Promise
+enum Settle {
+    Resolve(Outcome),
+    Reject(String),
+}
+
+enum Outcome {
+    Int(i32),
+    Bytes(Vec<u8>),
+}
+
+struct Loop {
+    /// Created on the first socket operation; -1 until then
+    epfd: i32,
+    next_timer: i32,
+    timers: Vec<Timer>,
+    ops: Vec<Op>,
+    files: Vec<FileRead>,
+    sources: Vec<Source>,
+    /// Rejected promises without a handler yet: (promise, reason)
+    unhandled: Vec<(JSValue, JSValue)>,
+    /// Set by [`stop`]: `run` returns with work still pending
+    stopped: bool,
+}
+
+// A loop is only used by the thread running its runtime; the lock keeps
+// the state coherent between the native functions and `run`.
+unsafe impl Send for Loop {}
+
+/// The loop of the runtime `ctx` belongs to
+unsafe fn state(ctx: *mut JSContext) -> &'static Spinlock<Loop> {
+    state_rt(runtime::JS_GetRuntime(ctx))
+}
+
+unsafe fn state_rt(rt: *mut JSRuntime) -> &'static Spinlock<Loop> {
+    &*(runtime::JS_GetRuntimeOpaque(rt) as *const Spinlock<Loop>)
+}
+
+impl Loop {
+    const fn new() -> Self {
+        Loop {
+            epfd: -1,
+            next_timer: 1,
+            timers: Vec::new(),
+            ops: Vec::new(),
+            files: Vec::new(),
+            sources: Vec::new(),
+            unhandled: Vec::new(),
+            stopped: false,
+        }
+    }
+
+    fn epfd(&mut self) -> i32 {
+        if self.epfd < 0 {
+            self.epfd = libakuma::epoll_create1(EPOLL_CLOEXEC);
+        }
+        self.epfd
+    }
+
+    /// Events the pending operations on `fd` wait for
+    fn interest(&self, fd: i32) -> u32 {
+        self.ops.iter().filter(|op| op.fd == fd).fold(0, |ev, op| ev | op.kind.events())
+    }
+
+    /// Bring the epoll registration of `fd` in line with its operations
+    /// (`before` is the interest prior to the change)
+    fn sync_fd(&mut self, fd: i32, before: u32) {
+        let after = self.interest(fd);
+        if after == before {
+            return;
+        }
+        let epfd = self.epfd();
+        let op = match (before, after) {
+            (0, _) => EPOLL_CTL_ADD,
+            (_, 0) => EPOLL_CTL_DEL,
+            _ => EPOLL_CTL_MOD,
+        };
+        libakuma::epoll_ctl(epfd, op, fd, after, fd as u64);
+    }
+
+    fn add_op(&mut self, op: Op) {
+        let fd = op.fd;
+        let before = self.interest(fd);
+        self.ops.push(op);
+        self.sync_fd(fd, before);
+    }
+
+    /// Remove and return the operations on `fd`
+    fn take_ops(&mut self, fd: i32) -> Vec<Op> {
+        let before = self.interest(fd);
+        let mut taken = Vec::new();
+        let mut i = 0;
+        while i < self.ops.len() {
+            if self.ops[i].fd == fd {
+                taken.push(self.ops.remove(i));
+            } else {
+                i += 1;
+            }
+        }
+        self.sync_fd(fd, before);
+        taken
+    }
+
+    fn idle(&self) -> bool {
+        self.timers.is_empty() && self.ops.is_empty() && self.files.is_empty()
+    }
+
+    /// Whether anything is registered with epoll
+    fn watching(&self) -> bool {
+        self.epfd >= 0 && !(self.ops.is_empty() && self.sources.is_empty())
+    }
+}
+
+// ============================================================================
+// Promise helpers
+// ============================================================================
+
+/// A new Promise and its (resolve, reject) functions
+unsafe fn new_promise(ctx: *mut JSContext) -> (JSValue, JSValue, JSValue) {
+    let mut funcs = [JSValue::undefined(); 2];
+    let promise = runtime::JS_NewPromiseCapability(ctx, funcs.as_mut_ptr());
+    (promise, funcs[0], funcs[1])
+}
+
+unsafe fn new_string(ctx: *mut JSContext, bytes: &[u8]) -> JSValue {
+    runtime::JS_NewStringLen(ctx, bytes.as_ptr() as *const c_char, bytes.len())
+}
+
+/// An `Error` carrying `msg`
+unsafe fn new_error(ctx: *mut JSContext, msg: &str) -> JSValue {
+    let err = runtime::JS_NewError(ctx);
+    runtime::JS_SetPropertyStr(ctx, err, c"message".as_ptr(), new_string(ctx, msg.as_bytes()));
+    err
+}
+
+/// Call `func(arg)` and drop the result; consumes `arg`
+unsafe fn call1(ctx: *mut JSContext, func: JSValue, mut arg: JSValue) -> Result<(), ()> {
+    let ret = runtime::JS_Call(ctx, func, JSValue::undefined(), 1, &mut arg);
+    runtime::free_value(ctx, arg);
+    let failed = ret.is_exception();
+    runtime::free_value(ctx, ret);
+    if failed { Err(()) } else { Ok(()) }
+}
+
+/// Resolve or reject a Promise and release its functions
+unsafe fn settle(ctx: *mut JSContext, resolve: JSValue, reject: JSValue, how: Settle) -> Result<(), ()> {
+    let r = match how {
+        Settle::Resolve(Outcome::Int(v)) => call1(ctx, resolve, JSValue::int32(v)),
+        Settle::Resolve(Outcome::Bytes(b)) => call1(ctx, resolve, new_string(ctx, &b)),
+        Settle::Reject(msg) => call1(ctx, reject, new_error(ctx, &msg)),
+    };
+    runtime::free_value(ctx, resolve);
+    runtime::free_value(ctx, reject);
+    r
+}
+
+/// Reject a Promise that never got queued (bad arguments, failed syscall)
+unsafe fn rejected(ctx: *mut JSContext, msg: &str) -> JSValue {
+    let (promise, resolve, reject) = new_promise(ctx);
+    if settle(ctx, resolve, reject, Settle::Reject(String::from(msg))).is_err() {
+        runtime::free_value(ctx, promise);
+        return JSValue::exception();
+    }
+    promise
+}
+
+unsafe fn arg_string(ctx: *mut JSContext, val: JSValue) -> Option<String> {
+    let mut len: usize = 0;
+    let cstr = runtime::JS_ToCStringLen2(ctx, &mut len, val, 0);
+    if cstr.is_null() {
+        return None;
+    }
+    let s = String::from_utf8_lossy(core::slice::from_raw_parts(cstr as *const u8, len)).into_owned();
+    runtime::JS_FreeCString(ctx, cstr);
+    Some(s)
+}
+
+unsafe fn arg_int(ctx: *mut JSContext, argc: c_int, argv: *mut JSValue, i: c_int, default: i32) -> Option<i32> {
+    if argc <= i {
+        return Some(default);
+    }
+    let mut v = 0;
+    if runtime::JS_ToInt32(ctx, &mut v, *argv.add(i as usize)) < 0 {
+        return None;
+    }
+    Some(v)
+}
+
+/// Queue an operation on `fd` and return its Promise
+unsafe fn start_op(ctx: *mut JSContext, fd: i32, kind: OpKind) -> JSValue {
+    let (promise, resolve, reject) = new_promise(ctx);
+    state(ctx).lock().add_op(Op { fd, kind, resolve, reject });
+    promise
+}
+
+// ============================================================================
+// Timers
+// ============================================================================
+
+unsafe fn add_timer(ctx: *mut JSContext, argc: c_int, argv: *mut JSValue, repeat: bool) -> JSValue {
+    if argc < 1 || runtime::JS_IsFunction(ctx, *argv) == 0 {
+        return runtime::JS_ThrowTypeError(ctx, c"timer callback must be a function".as_ptr());
+    }
+    let mut ms = 0f64;
+    if argc > 1 && runtime::JS_ToFloat64(ctx, &mut ms, *argv.add(1)) < 0 {
+        return JSValue::exception();
+    }
+    // NaN and negative delays run on the next iteration, like a 0 delay
+    let delay = if ms > 0.0 { (ms * 1000.0) as u64 } else { 0 };
+    let args = (2..argc.max(2)).map(|i| runtime::dup_value(*argv.add(i as usize))).collect();
+    let mut lp = state(ctx).lock();
+    let id = lp.next_timer;
+    lp.next_timer = lp.next_timer.wrapping_add(1).max(1);
+    lp.timers.push(Timer {
+        id,
+        deadline: uptime() + delay,
+        interval: if repeat { Some(delay.max(1000)) } else { None },
+        func: runtime::dup_value(*argv),
+        args,
+    });
+    JSValue::int32(id)
+}
+
+unsafe fn free_timer(ctx: *mut JSContext, t: Timer) {
+    runtime::free_value(ctx, t.func);
+    for a in t.args {
+        runtime::free_value(ctx, a);
+    }
+}
+
+unsafe extern "C" fn js_set_timeout(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    add_timer(ctx, argc, argv, false)
+}
+
+unsafe extern "C" fn js_set_interval(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    add_timer(ctx, argc, argv, true)
+}
+
+/// `clearTimeout` and `clearInterval`
+unsafe extern "C" fn js_clear_timer(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let id = match arg_int(ctx, argc, argv, 0, 0) {
+        Some(id) => id,
+        None => return JSValue::exception(),
+    };
+    let timer = {
+        let mut lp = state(ctx).lock();
+        lp.timers.iter().position(|t| t.id == id).map(|i| lp.timers.remove(i))
+    };
+    if let Some(t) = timer {
+        free_timer(ctx, t);
+    }
+    JSValue::undefined()
+}
+
+/// Run the earliest due timer, if any; returns whether one ran
+unsafe fn fire_timer(ctx: *mut JSContext, now: u64) -> Result<bool, ()> {
+    // The timer's own references for a one-shot, fresh ones for an interval;
+    // released after the call either way
+    let (func, mut args) = {
+        let mut lp = state(ctx).lock();
+        let due = lp
+            .timers
+            .iter()
+            .enumerate()
+            .filter(|(_, t)| t.deadline <= now)
+            .min_by_key(|(_, t)| t.deadline)
+            .map(|(i, _)| i);
+        let i = match due {
+            Some(i) => i,
+            None => return Ok(false),
+        };
+        match lp.timers[i].interval {
+            // Rescheduled before the call so the callback can clear it
+            Some(period) => {
+                let t = &mut lp.timers[i];
+                t.deadline = now + period;
+                let args = t.args.iter().map(|a| runtime::dup_value(*a)).collect();
+                (runtime::dup_value(t.func), args)
+            }
+            None => {
+                let t = lp.timers.remove(i);
+                (t.func, t.args)
+            }
+        }
+    };
+    let ret = runtime::JS_Call(ctx, func, JSValue::undefined(), args.len() as c_int, args.as_mut_ptr());
+    let failed = ret.is_exception();
+    runtime::free_value(ctx, ret);
+    free_timer(ctx, Timer { id: 0, deadline: 0, interval: None, func, args });
+    if failed { Err(()) } else { Ok(true) }
+}
+
+// ============================================================================
+// Files
+// ============================================================================
+
+/// `Akuma.readFile(path)`: Promise of the file's contents as a string
+unsafe extern "C" fn js_read_file(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"readFile: path expected".as_ptr());
+    }
+    let path = match arg_string(ctx, *argv) {
+        Some(p) => p,
+        None => return JSValue::exception(),
+    };
+    let fd = open(&path, open_flags::O_RDONLY);
+    if fd < 0 {
+        return rejected(ctx, &alloc::format!("readFile: cannot open {}", path));
+    }
+    let (promise, resolve, reject) = new_promise(ctx);
+    state(ctx).lock().files.push(FileRead { fd, data: Vec::new(), resolve, reject });
+    promise
+}
+
+/// Read one chunk of every pending `readFile`, settling those that finish
+unsafe fn step_files(ctx: *mut JSContext) -> Result<(), ()> {
+    let mut finished = Vec::new();
+    {
+        let mut lp = state(ctx).lock();
+        let mut i = 0;
+        while i < lp.files.len() {
+            let f = &mut lp.files[i];
+            let len = f.data.len();
+            f.data.resize(len + FILE_CHUNK, 0);
+            let n = read_fd(f.fd, &mut f.data[len..]);
+            f.data.truncate(len + n.max(0) as usize);
+            if n > 0 {
+                i += 1;
+                continue;
+            }
+            let f = lp.files.remove(i);
+            libakuma::close(f.fd);
+            finished.push((f, n));
+        }
+    }
+    let mut result = Ok(());
+    for (f, n) in finished {
+        let how = if n == 0 {
+            Settle::Resolve(Outcome::Bytes(f.data))
+        } else {
+            Settle::Reject(alloc::format!("readFile: read failed ({})", n))
+        };
+        if settle(ctx, f.resolve, f.reject, how).is_err() {
+            result = Err(());
+        }
+    }
+    result
+}
+
+// ============================================================================
+// Sockets
+// ============================================================================
+
+fn parse_ipv4(s: &str) -> Option<[u8; 4]> {
+    let mut ip = [0u8; 4];
+    let mut parts = s.split('.');
+    for b in ip.iter_mut() {
+        *b = parts.next()?.parse().ok()?;
+    }
+    if parts.next().is_some() {
+        return None;
+    }
+    Some(ip)
+}
+
+/// `Akuma.connect(host, port)`: Promise of a connected socket fd
+unsafe extern "C" fn js_connect(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 2 {
+        return runtime::JS_ThrowTypeError(ctx, c"connect: host and port expected".as_ptr());
+    }
+    let host = match arg_string(ctx, *argv) {
+        Some(h) => h,
+        None => return JSValue::exception(),
+    };
+    let port = match arg_int(ctx, argc, argv, 1, 0) {
+        Some(p) => p as u16,
+        None => return JSValue::exception(),
+    };
+    let ip = match parse_ipv4(&host).map(Ok).unwrap_or_else(|| libakuma::resolve_host(&host)) {
+        Ok(ip) => ip,
+        Err(_) => return rejected(ctx, &alloc::format!("connect: cannot resolve {}", host)),
+    };
+    let fd = libakuma::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if fd < 0 {
+        return rejected(ctx, "connect: socket failed");
+    }
+    let ret = libakuma::connect(fd, &SocketAddrV4::new(ip, port));
+    if ret == 0 {
+        let (promise, resolve, reject) = new_promise(ctx);
+        return match settle(ctx, resolve, reject, Settle::Resolve(Outcome::Int(fd))) {
+            Ok(()) => promise,
+            Err(()) => JSValue::exception(),
+        };
+    }
+    if ret != -EINPROGRESS && ret != -EAGAIN {
+        libakuma::close(fd);
+        return rejected(ctx, &alloc::format!("connect: {}:{} failed ({})", host, port, ret));
+    }
+    start_op(ctx, fd, OpKind::Connect)
+}
+
+/// `Akuma.listen(port[, backlog])`: a listening socket fd (synchronous)
+unsafe extern "C" fn js_listen(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let (port, backlog) = match (arg_int(ctx, argc, argv, 0, 0), arg_int(ctx, argc, argv, 1, 16)) {
+        (Some(p), Some(b)) => (p as u16, b),
+        _ => return JSValue::exception(),
+    };
+    let fd = libakuma::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if fd < 0 {
+        return runtime::JS_ThrowTypeError(ctx, c"listen: socket failed".as_ptr());
+    }
+    if libakuma::bind(fd, &SocketAddrV4::new([0, 0, 0, 0], port)) < 0 || libakuma::listen(fd, backlog) < 0 {
+        libakuma::close(fd);
+        return runtime::JS_ThrowTypeError(ctx, c"listen: cannot listen on port %d".as_ptr(), port as c_int);
+    }
+    JSValue::int32(fd)
+}
+
+/// `Akuma.accept(fd)`: Promise of the next connection's fd
+unsafe extern "C" fn js_accept(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    match arg_int(ctx, argc, argv, 0, -1) {
+        Some(fd) => start_op(ctx, fd, OpKind::Accept),
+        None => JSValue::exception(),
+    }
+}
+
+/// `Akuma.read(fd[, max])`: Promise of the next bytes as a string, "" at EOF
+unsafe extern "C" fn js_read(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    match (arg_int(ctx, argc, argv, 0, -1), arg_int(ctx, argc, argv, 1, READ_MAX as i32)) {
+        (Some(fd), Some(max)) => {
+            let max = (max.max(1) as usize).min(READ_MAX);
+            start_op(ctx, fd, OpKind::Read { max })
+        }
+        _ => JSValue::exception(),
+    }
+}
+
+/// `Akuma.write(fd, data)`: Promise of the byte count once all of `data` (a
+/// string or ArrayBuffer) is written
+unsafe extern "C" fn js_write(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 2 {
+        return runtime::JS_ThrowTypeError(ctx, c"write: fd and data expected".as_ptr());
+    }
+    let fd = match arg_int(ctx, argc, argv, 0, -1) {
+        Some(fd) => fd,
+        None => return JSValue::exception(),
+    };
+    let val = *argv.add(1);
+    let mut size: usize = 0;
+    let buf = if val.get_tag() == runtime::JS_TAG_OBJECT {
+        runtime::JS_GetArrayBuffer(ctx, &mut size, val)
+    } else {
+        core::ptr::null_mut()
+    };
+    let data = if !buf.is_null() {
+        core::slice::from_raw_parts(buf, size).to_vec()
+    } else {
+        // Not an ArrayBuffer (JS_GetArrayBuffer threw): write it as a string
+        let exc = runtime::JS_GetException(ctx);
+        runtime::free_value(ctx, exc);
+        match arg_string(ctx, val) {
+            Some(s) => s.into_bytes(),
+            None => return JSValue::exception(),
+        }
+    };
+    start_op(ctx, fd, OpKind::Write { data, done: 0 })
+}
+
+/// `Akuma.close(fd)`: close a socket, rejecting its pending operations
+unsafe extern "C" fn js_close(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let fd = match arg_int(ctx, argc, argv, 0, -1) {
+        Some(fd) => fd,
+        None => return JSValue::exception(),
+    };
+    let cancelled = state(ctx).lock().take_ops(fd);
+    libakuma::close(fd);
+    for op in cancelled {
+        if settle(ctx, op.resolve, op.reject, Settle::Reject(String::from("fd closed"))).is_err() {
+            return JSValue::exception();
+        }
+    }
+    JSValue::undefined()
+}
+
+/// Advance an operation whose fd is ready; `None` to keep waiting
+fn try_op(op: &mut Op, events: u32) -> Option<Settle> {
+    let failed = events & (EPOLLERR | EPOLLHUP) != 0;
+    match &mut op.kind {
+        OpKind::Connect if failed => Some(Settle::Reject(String::from("connect: connection refused"))),
+        OpKind::Connect => Some(Settle::Resolve(Outcome::Int(op.fd))),
+        OpKind::Accept => {
+            let fd = libakuma::accept(op.fd);
+            if fd == -EAGAIN {
+                return None;
+            }
+            if fd < 0 {
+                return Some(Settle::Reject(alloc::format!("accept failed ({})", fd)));
+            }
+            libakuma::set_nonblocking(fd, true);
+            Some(Settle::Resolve(Outcome::Int(fd)))
+        }
+        OpKind::Read { max } => {
+            let mut buf = alloc::vec![0u8; *max];
+            let n = libakuma::recv(op.fd, &mut buf, 0);
+            if n == -(EAGAIN as isize) {
+                return None;
+            }
+            if n < 0 {
+                return Some(Settle::Reject(alloc::format!("read failed ({})", n)));
+            }
+            buf.truncate(n as usize);
+            Some(Settle::Resolve(Outcome::Bytes(buf)))
+        }
+        OpKind::Write { data, done } => {
+            while *done < data.len() {
+                let n = libakuma::send(op.fd, &data[*done..], 0);
+                if n == -(EAGAIN as isize) {
+                    return None;
+                }
+                if n <= 0 {
+                    return Some(Settle::Reject(alloc::format!("write failed ({})", n)));
+                }
+                *done += n as usize;
+            }
+            Some(Settle::Resolve(Outcome::Int(data.len() as i32)))
+        }
+    }
+}
+
+/// Progress the operations on `fd` after epoll reported `events`
+unsafe fn dispatch(ctx: *mut JSContext, fd: i32, events: u32) -> Result<(), ()> {
+    let mut done = Vec::new();
+    {
+        let mut lp = state(ctx).lock();
+        let before = lp.interest(fd);
+        let mut i = 0;
+        while i < lp.ops.len() {
+            let ready = lp.ops[i].fd == fd
+                && (events & (lp.ops[i].kind.events() | EPOLLERR | EPOLLHUP)) != 0;
+            match if ready { try_op(&mut lp.ops[i], events) } else { None } {
+                Some(how) => done.push((lp.ops.remove(i), how)),
+                None => i += 1,
+            }
+        }
+        lp.sync_fd(fd, before);
+    }
+    let mut result = Ok(());
+    for (op, how) in done {
+        if settle(ctx, op.resolve, op.reject, how).is_err() {
+            result = Err(());
+        }
+    }
+    result
+}
+
+// ============================================================================
+// Loop
+// ============================================================================
+
+/// `JSHostPromiseRejectionTracker`: remember unhandled rejections until the
+/// job queue drains, so a handler attached later in the same turn cancels
+/// the report
+unsafe extern "C" fn rejection_tracker(
+    ctx: *mut JSContext,
+    promise: JSValue,
+    reason: JSValue,
+    is_handled: c_int,
+    _opaque: *mut c_void,
+) {
+    let found = {
+        let mut lp = state(ctx).lock();
+        if is_handled == 0 {
+            lp.unhandled.push((runtime::dup_value(promise), runtime::dup_value(reason)));
+            return;
+        }
+        let ptr = promise.u.ptr;
+        lp.unhandled.iter().position(|(p, _)| p.u.ptr == ptr).map(|i| lp.unhandled.remove(i))
+    };
+    if let Some((p, r)) = found {
+        runtime::free_value(ctx, p);
+        runtime::free_value(ctx, r);
+    }
+}
+
+fn report_unhandled(rt: &Runtime) {
+    let pending = core::mem::take(&mut unsafe { state_rt(rt.runtime()) }.lock().unhandled);
+    for (promise, reason) in pending {
+        let msg = alloc::format!("Possibly unhandled promise rejection: {}\n", rt.value_to_string(reason));
+        stdio::write(libakuma::fd::STDERR, msg.as_bytes());
+        rt.free_value(promise);
+        rt.free_value(reason);
+    }
+}
+
+/// Run queued Promise jobs; Err with the message of the first that throws
+fn run_jobs(rt: &Runtime) -> Result<(), String> {
+    loop {
+        let mut ctx: *mut JSContext = core::ptr::null_mut();
+        match unsafe { runtime::JS_ExecutePendingJob(rt.runtime(), &mut ctx) } {
+            0 => return Ok(()),
+            r if r < 0 => return Err(rt.take_exception()),
+            _ => {}
+        }
+    }
+}
+
+/// Milliseconds until the next timer is due, or -1 with none
+fn next_timeout(lp: &Loop, now: u64) -> i32 {
+    if !lp.files.is_empty() {
+        return 0;
+    }
+    match lp.timers.iter().map(|t| t.deadline).min() {
+        Some(d) if d <= now => 0,
+        // Rounded up so the timer is due when the wait ends
+        Some(d) => ((d - now + 999) / 1000).min(i32::MAX as u64) as i32,
+        None => -1,
+    }
+}
+
+/// Watch `src.fd` for readability on the loop of `ctx`'s runtime
+pub unsafe fn add_source(ctx: *mut JSContext, src: Source) {
+    let mut lp = state(ctx).lock();
+    let epfd = lp.epfd();
+    libakuma::epoll_ctl(epfd, EPOLL_CTL_ADD, src.fd, EPOLLIN, src.fd as u64);
+    lp.sources.push(src);
+}
+
+/// Make `run` return at its next step, abandoning pending work (a Worker's
+/// `close()` or `terminate()`)
+pub unsafe fn stop(ctx: *mut JSContext) {
+    state(ctx).lock().stopped = true;
+}
+
+/// Run `ready` for the source on `fd`; false if there is none
+unsafe fn dispatch_source(ctx: *mut JSContext, fd: i32) -> Result<bool, ()> {
+    let src = state(ctx).lock().sources.iter().find(|s| s.fd == fd).copied();
+    match src {
+        Some(src) => (src.ready)(ctx, src.data).map(|_| true),
+        None => Ok(false),
+    }
+}
+
+/// Drop the finished sources; returns whether one still keeps the loop
+/// alive
+unsafe fn sweep_sources(ctx: *mut JSContext) -> bool {
+    let sources = state(ctx).lock().sources.clone();
+    let mut alive = false;
+    for src in sources {
+        if (src.finished)(ctx, src.data) {
+            {
+                let mut lp = state(ctx).lock();
+                lp.sources.retain(|s| s.fd != src.fd);
+                libakuma::epoll_ctl(lp.epfd, EPOLL_CTL_DEL, src.fd, 0, 0);
+            }
+            (src.free)(ctx, src.data);
+        } else if (src.keeps_alive)(ctx, src.data) {
+            alive = true;
+        }
+    }
+    alive
+}
+
+/// Run until no jobs, timers, I/O or live sources remain. Err carries the
+/// message of an exception thrown by a callback, which ends the loop like
+/// an error in the script itself.
+pub fn run(rt: &Runtime) -> Result<(), String> {
+    let ctx = rt.context();
+    let lp = unsafe { state(ctx) };
+    let mut events = [EpollEvent::default(); MAX_EVENTS];
+    loop {
+        run_jobs(rt)?;
+        report_unhandled(rt);
+
+        let now = uptime();
+        while unsafe { fire_timer(ctx, now) }.map_err(|_| rt.take_exception())? {
+            run_jobs(rt)?;
+        }
+        unsafe { step_files(ctx) }.map_err(|_| rt.take_exception())?;
+        run_jobs(rt)?;
+        report_unhandled(rt);
+
+        let sources_alive = unsafe { sweep_sources(ctx) };
+        let (idle, epfd, watching, timeout) = {
+            let lp = lp.lock();
+            if lp.stopped {
+                return Ok(());
+            }
+            (lp.idle(), lp.epfd, lp.watching(), next_timeout(&lp, uptime()))
+        };
+        if idle && !sources_alive {
+            return Ok(());
+        }
+        // stdout is fully buffered when it is not a tty; push it out before
+        // blocking so a piped reader sees output produced so far.
+        if timeout != 0 {
+            stdio::flush();
+        }
+        if !watching {
+            if timeout > 0 {
+                libakuma::sleep_ms(timeout as u64);
+            }
+            continue;
+        }
+        let n = libakuma::epoll_wait(epfd, &mut events, timeout);
+        for ev in &events[..n.max(0) as usize] {
+            let fd = ev.data as i32;
+            let handled = unsafe { dispatch_source(ctx, fd) }.map_err(|_| rt.take_exception())?;
+            if !handled {
+                unsafe { dispatch(ctx, fd, ev.events) }.map_err(|_| rt.take_exception())?;
+            }
+        }
+    }
+}
+
+/// Create the loop for `rt`, and install the timer globals, the `Akuma` I/O
+/// functions on `akuma`, and the rejection tracker
+pub fn setup(rt: &Runtime, global: JSValue, akuma: JSValue) {
+    let lp = Box::new(Spinlock::new(Loop::new()));
+    unsafe { runtime::JS_SetRuntimeOpaque(rt.runtime(), Box::into_raw(lp) as *mut c_void) };
+    let timers: [(&str, unsafe extern "C" fn(*mut JSContext, JSValue, c_int, *mut JSValue) -> JSValue, c_int); 4] = [
+        ("setTimeout", js_set_timeout, 2),
+        ("setInterval", js_set_interval, 2),
+        ("clearTimeout", js_clear_timer, 1),
+        ("clearInterval", js_clear_timer, 1),
+    ];
+    for (name, func, len) in timers {
+        rt.set_property_str(global, name, rt.new_c_function(func, name, len));
+    }
+    let io: [(&str, unsafe extern "C" fn(*mut JSContext, JSValue, c_int, *mut JSValue) -> JSValue, c_int); 7] = [
+        ("readFile", js_read_file, 1),
+        ("connect", js_connect, 2),
+        ("listen", js_listen, 2),
+        ("accept", js_accept, 1),
+        ("read", js_read, 2),
+        ("write", js_write, 2),
+        ("close", js_close, 1),
+    ];
+    for (name, func, len) in io {
+        rt.set_property_str(akuma, name, rt.new_c_function(func, name, len));
+    }
+    unsafe {
+        runtime::JS_SetHostPromiseRejectionTracker(rt.runtime(), Some(rejection_tracker), core::ptr::null_mut());
+    }
+}
+
+/// Release everything the loop of `rt` still holds, before the runtime is
+/// freed. Sockets and files of abandoned operations are closed. Only needed
+/// for runtimes that do not live until the process exits (Workers).
+pub fn teardown(rt: &Runtime) {
+    let ctx = rt.context();
+    let lp = unsafe { Box::from_raw(runtime::JS_GetRuntimeOpaque(rt.runtime()) as *mut Spinlock<Loop>) };
+    unsafe { runtime::JS_SetRuntimeOpaque(rt.runtime(), core::ptr::null_mut()) };
+    let lp = core::mem::replace(&mut *lp.lock(), Loop::new());
+    for t in lp.timers {
+        unsafe { free_timer(ctx, t) };
+    }
+    for op in lp.ops {
+        libakuma::close(op.fd);
+        rt.free_value(op.resolve);
+        rt.free_value(op.reject);
+    }
+    for f in lp.files {
+        libakuma::close(f.fd);
+        rt.free_value(f.resolve);
+        rt.free_value(f.reject);
+    }
+    for src in lp.sources {
+        unsafe { (src.free)(ctx, src.data) };
+    }
+    for (promise, reason) in lp.unhandled {
+        rt.free_value(promise);
+        rt.free_value(reason);
+    }
+    if lp.epfd >= 0 {
+        libakuma::close(lp.epfd);
+    }
+}
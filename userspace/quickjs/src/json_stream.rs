@@ -0,0 +1,314 @@
+//! Incremental JSON: top-level values split out of a byte stream
+//!
+//! [`Splitter`] takes input in arbitrary chunks and finds where each
+//! complete top-level value ends, tracking only nesting depth and whether
+//! it is inside a string. Each value is then handed to `JS_ParseJSON` on
+//! its own. Values may be separated by whitespace (NDJSON, or several
+//! documents back to back). With `elements`, a top-level array is unwrapped
+//! and its elements come out one by one, so a file holding one large array
+//! of records streams the same way.
+//!
+//! Only the value being scanned and the unscanned input are kept, so memory
+//! is bounded by the largest single value rather than the whole stream.
+//! `Akuma.jsonStream()` exposes this to JS; `Akuma.stdin.json()` runs it
+//! over stdin.
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::ffi::{c_char, c_int, c_void};
+use core::ops::Range;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use crate::runtime::{self, JSClassDef, JSContext, JSRuntime, JSValue, Runtime};
+
+/// Finds the byte ranges of complete top-level JSON values in a stream
+pub struct Splitter {
+    data: Vec<u8>,
+    /// Next byte to scan
+    pos: usize,
+    /// Start of the value being scanned, if any
+    start: Option<usize>,
+    depth: u32,
+    in_string: bool,
+    escape: bool,
+    /// The value in progress is a bare number or literal, which ends at the
+    /// first delimiter
+    bare: bool,
+    /// Unwrap top-level arrays
+    elements: bool,
+    in_wrapper: bool,
+    /// `data[..value end]` copied with a NUL, for JS_ParseJSON
+    scratch: Vec<u8>,
+}
+
+impl Splitter {
+    pub fn new(elements: bool) -> Self {
+        Splitter {
+            data: Vec::new(),
+            pos: 0,
+            start: None,
+            depth: 0,
+            in_string: false,
+            escape: false,
+            bare: false,
+            elements,
+            in_wrapper: false,
+            scratch: Vec::new(),
+        }
+    }
+
+    /// Append input, first dropping what has already been returned
+    pub fn feed(&mut self, bytes: &[u8]) {
+        let keep = self.start.unwrap_or(self.pos);
+        if keep > 0 {
+            self.data.drain(..keep);
+            self.pos -= keep;
+            if let Some(s) = self.start.as_mut() {
+                *s -= keep;
+            }
+        }
+        self.data.extend_from_slice(bytes);
+    }
+
+    /// The next complete value, or `None` if more input is needed. `eof`
+    /// says no more will come: a trailing bare value is complete and an
+    /// unfinished one is an error.
+    pub fn next(&mut self, eof: bool) -> Result<Option<Range<usize>>, &'static str> {
+        while self.pos < self.data.len() {
+            let b = self.data[self.pos];
+            if let Some(s) = self.start {
+                if self.bare {
+                    if is_delimiter(b) {
+                        self.start = None;
+                        self.bare = false;
+                        return Ok(Some(s..self.pos));
+                    }
+                    self.pos += 1;
+                    continue;
+                }
+                self.pos += 1;
+                if self.in_string {
+                    if self.escape {
+                        self.escape = false;
+                    } else if b == b'\\' {
+                        self.escape = true;
+                    } else if b == b'"' {
+                        self.in_string = false;
+                        if self.depth == 0 {
+                            self.start = None;
+                            return Ok(Some(s..self.pos));
+                        }
+                    }
+                    continue;
+                }
+                match b {
+                    b'"' => self.in_string = true,
+                    b'{' | b'[' => self.depth += 1,
+                    b'}' | b']' => {
+                        self.depth -= 1;
+                        if self.depth == 0 {
+                            self.start = None;
+                            return Ok(Some(s..self.pos));
+                        }
+                    }
+                    _ => {}
+                }
+                continue;
+            }
+            // Between values
+            match b {
+                b' ' | b'\t' | b'\n' | b'\r' => {}
+                b',' if self.in_wrapper => {}
+                b']' if self.in_wrapper => self.in_wrapper = false,
+                b'[' if self.elements && !self.in_wrapper => self.in_wrapper = true,
+                b'{' | b'[' => {
+                    self.start = Some(self.pos);
+                    self.depth = 1;
+                }
+                b'"' => {
+                    self.start = Some(self.pos);
+                    self.in_string = true;
+                }
+                b'}' | b']' | b',' | b':' => return Err("unexpected character between values"),
+                _ => {
+                    self.start = Some(self.pos);
+                    self.bare = true;
+                }
+            }
+            self.pos += 1;
+        }
+        if !eof {
+            return Ok(None);
+        }
+        match self.start {
+            Some(s) if self.bare => {
+                self.start = None;
+                self.bare = false;
+                Ok(Some(s..self.pos))
+            }
+            Some(_) => Err("unexpected end of input inside a value"),
+            None if self.in_wrapper => Err("unexpected end of input inside the top-level array"),
+            None => Ok(None),
+        }
+    }
+
+    /// Parse the value at `range` (from [`next`](Self::next))
+    pub unsafe fn parse(&mut self, ctx: *mut JSContext, range: Range<usize>) -> JSValue {
+        self.scratch.clear();
+        self.scratch.extend_from_slice(&self.data[range]);
+        self.scratch.push(0);
+        runtime::JS_ParseJSON(
+            ctx,
+            self.scratch.as_ptr() as *const c_char,
+            self.scratch.len() - 1,
+            c"<json>".as_ptr(),
+        )
+    }
+}
+
+/// Bytes that end a bare number or literal
+fn is_delimiter(b: u8) -> bool {
+    matches!(b, b' ' | b'\t' | b'\n' | b'\r' | b',' | b']' | b'}' | b'[' | b'{' | b'"' | b':')
+}
+
+/// Throw a SyntaxError for a splitter error
+pub unsafe fn throw(ctx: *mut JSContext, msg: &str) -> JSValue {
+    let msg = alloc::format!("JSON stream: {}\0", msg);
+    runtime::JS_ThrowSyntaxError(ctx, c"%s".as_ptr(), msg.as_ptr())
+}
+
+// ============================================================================
+// Akuma.jsonStream
+// ============================================================================
+
+/// Class ID of `jsonStream` objects, shared by every runtime
+static STREAM_CLASS: AtomicU32 = AtomicU32::new(0);
+
+/// The values completed so far as a JS array
+unsafe fn drain(ctx: *mut JSContext, sp: &mut Splitter, eof: bool) -> JSValue {
+    let arr = runtime::JS_NewArray(ctx);
+    let mut n = 0;
+    loop {
+        let range = match sp.next(eof) {
+            Ok(Some(r)) => r,
+            Ok(None) => return arr,
+            Err(e) => {
+                runtime::free_value(ctx, arr);
+                return throw(ctx, e);
+            }
+        };
+        let val = sp.parse(ctx, range);
+        if val.is_exception() {
+            runtime::free_value(ctx, arr);
+            return val;
+        }
+        runtime::JS_SetPropertyUint32(ctx, arr, n, val);
+        n += 1;
+    }
+}
+
+unsafe fn stream_state<'a>(ctx: *mut JSContext, this: JSValue) -> Option<&'a mut Splitter> {
+    let sp = runtime::JS_GetOpaque2(ctx, this, STREAM_CLASS.load(Ordering::Relaxed)) as *mut Splitter;
+    sp.as_mut()
+}
+
+/// `Akuma.jsonStream([{ elements }])`: an incremental JSON parser.
+/// `push(chunk)` returns the array of values the chunk completed and
+/// `end()` those left at end of input. `chunk` is a string, ArrayBuffer or
+/// TypedArray; chunks may split values (and UTF-8 sequences) anywhere.
+unsafe extern "C" fn js_json_stream(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let elements = match option_bool(ctx, argc, argv, "elements") {
+        Some(v) => v,
+        None => return JSValue::exception(),
+    };
+    let obj = runtime::JS_NewObjectClass(ctx, STREAM_CLASS.load(Ordering::Relaxed) as c_int);
+    if obj.is_exception() {
+        return obj;
+    }
+    runtime::JS_SetOpaque(obj, Box::into_raw(Box::new(Splitter::new(elements))) as *mut c_void);
+    obj
+}
+
+/// `opts[name]` of an optional options object in `argv[0]`, as a boolean
+pub unsafe fn option_bool(ctx: *mut JSContext, argc: c_int, argv: *mut JSValue, name: &str) -> Option<bool> {
+    if argc < 1 || (*argv).get_tag() != runtime::JS_TAG_OBJECT {
+        return Some(false);
+    }
+    let mut cname = alloc::vec![0u8; name.len() + 1];
+    cname[..name.len()].copy_from_slice(name.as_bytes());
+    let v = runtime::JS_GetPropertyStr(ctx, *argv, cname.as_ptr() as *const c_char);
+    if v.is_exception() {
+        return None;
+    }
+    let b = runtime::JS_ToBool(ctx, v);
+    runtime::free_value(ctx, v);
+    if b < 0 {
+        None
+    } else {
+        Some(b > 0)
+    }
+}
+
+/// `stream.push(chunk)`
+unsafe extern "C" fn js_stream_push(ctx: *mut JSContext, this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let sp = match stream_state(ctx, this) {
+        Some(s) => s,
+        None => return JSValue::exception(),
+    };
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"push: chunk expected".as_ptr());
+    }
+    let val = *argv;
+    if val.get_tag() == runtime::JS_TAG_STRING {
+        let mut len = 0;
+        let cstr = runtime::JS_ToCStringLen2(ctx, &mut len, val, 0);
+        if cstr.is_null() {
+            return JSValue::exception();
+        }
+        sp.feed(core::slice::from_raw_parts(cstr as *const u8, len));
+        runtime::JS_FreeCString(ctx, cstr);
+    } else {
+        match runtime::buffer_bytes(ctx, val) {
+            Some(b) => sp.feed(b),
+            None => return JSValue::exception(),
+        }
+    }
+    drain(ctx, sp, false)
+}
+
+/// `stream.end()`
+unsafe extern "C" fn js_stream_end(ctx: *mut JSContext, this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    match stream_state(ctx, this) {
+        Some(sp) => drain(ctx, sp, true),
+        None => JSValue::exception(),
+    }
+}
+
+unsafe extern "C" fn stream_finalizer(_rt: *mut JSRuntime, val: JSValue) {
+    let sp = runtime::JS_GetOpaque(val, STREAM_CLASS.load(Ordering::Relaxed)) as *mut Splitter;
+    if !sp.is_null() {
+        drop(Box::from_raw(sp));
+    }
+}
+
+static STREAM_CLASS_DEF: JSClassDef = JSClassDef {
+    class_name: c"JSONStream".as_ptr(),
+    finalizer: Some(stream_finalizer),
+    gc_mark: core::ptr::null(),
+    call: core::ptr::null(),
+    exotic: core::ptr::null(),
+};
+
+/// Register the `jsonStream` class on `rt` and install `Akuma.jsonStream`
+pub fn setup(rt: &Runtime, akuma: JSValue) {
+    unsafe {
+        let ctx = rt.context();
+        let class_id = runtime::JS_NewClassID(STREAM_CLASS.as_ptr());
+        runtime::JS_NewClass(rt.runtime(), class_id, &STREAM_CLASS_DEF);
+        let proto = runtime::JS_NewObject(ctx);
+        rt.set_property_str(proto, "push", rt.new_c_function(js_stream_push, "push", 1));
+        rt.set_property_str(proto, "end", rt.new_c_function(js_stream_end, "end", 0));
+        runtime::JS_SetClassProto(ctx, class_id, proto);
+        rt.set_property_str(akuma, "jsonStream", rt.new_c_function(js_json_stream, "jsonStream", 1));
+    }
+}
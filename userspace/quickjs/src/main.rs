@@ -9,14 +9,32 @@ extern crate alloc;
 
 use core::ffi::c_int;
 
-use libakuma::{arg, argc, exit, print, read, fd};
+use libakuma::{arg, argc, fd, uptime};
 
-use alloc::vec::Vec;
 use alloc::string::String;
 
+mod bench;
+mod bytecode;
+mod crypto;
+mod event_loop;
+mod json_stream;
+mod mapfile;
+mod module_loader;
+mod profiler;
 mod runtime;
-
-use runtime::{JSContext, JSValue, Runtime};
+mod slab;
+mod stdio;
+mod stdin;
+mod worker;
+
+use mapfile::FileData;
+use runtime::{JSContext, JSValue, Limits, Runtime};
+use stdio::exit;
+
+/// Print to stdout through the qjs output buffer
+fn print(s: &str) {
+    stdio::write(fd::STDOUT, s.as_bytes());
+}
 
 // ============================================================================
 // Debug Configuration
@@ -53,7 +71,7 @@ unsafe extern "C" fn js_print(
 
         if !cstr.is_null() {
             let bytes = core::slice::from_raw_parts(cstr as *const u8, len);
-            libakuma::write(libakuma::fd::STDOUT, bytes);
+            stdio::write(fd::STDOUT, bytes);
             runtime::JS_FreeCString(ctx, cstr);
         }
     }
@@ -62,35 +80,268 @@ unsafe extern "C" fn js_print(
     JSValue::undefined()
 }
 
-/// Native readStdin function - reads all available data from stdin
-unsafe extern "C" fn js_read_stdin(
-    ctx: *mut JSContext,
-    _this_val: JSValue,
-    _argc: c_int,
-    _argv: *mut JSValue,
-) -> JSValue {
-    let mut data = Vec::new();
-    let mut buf = [0u8; 1024];
-    
-    loop {
-        let n = read(fd::STDIN, &mut buf);
-        if n <= 0 {
-            break;
+/// Print the allocator counters to stderr (`--alloc-stats`)
+fn print_alloc_stats() {
+    let st = slab::stats();
+    let slab_kb = st.peak_chunk_bytes / 1024;
+    let malloc_kb = libakuma::total_allocated() / 1024;
+    let line = alloc::format!(
+        "alloc-stats: slab={} allocs={} (slab {}, malloc {}) frees={} in_place_reallocs={} \
+         peak_live_kb={} mapped_kb={} (slab {}, malloc {})\n",
+        if st.enabled { "on" } else { "off" },
+        st.slab_allocs + st.large_allocs,
+        st.slab_allocs,
+        st.large_allocs,
+        st.frees,
+        st.in_place_reallocs,
+        st.peak_live_bytes / 1024,
+        slab_kb + malloc_kb,
+        slab_kb,
+        malloc_kb,
+    );
+    stdio::write(fd::STDERR, line.as_bytes());
+}
+
+/// Print a heap summary to stderr at exit (`--mem-stats` / `QJS_MEM_STATS`)
+fn print_mem_stats(rt: &Runtime, limits: &Limits) {
+    let usage = rt.memory_usage();
+    let limit = if limits.memory_limit == 0 {
+        String::from("none")
+    } else {
+        alloc::format!("{}", limits.memory_limit / 1024)
+    };
+    let line = alloc::format!(
+        "mem-stats: heap_kb={} peak_heap_kb={} limit_kb={} objects={} strings={} \
+         gc_cycles={} gc_ms={}.{:03}\n",
+        usage.malloc_size / 1024,
+        slab::stats().peak_live_bytes / 1024,
+        limit,
+        usage.obj_count,
+        usage.str_count,
+        usage.gc_count,
+        usage.gc_time / 1000,
+        usage.gc_time % 1000,
+    );
+    stdio::write(fd::STDERR, line.as_bytes());
+}
+
+/// Parse a byte count with an optional `k`, `m` or `g` suffix (`64m`,
+/// `512K`, `1048576`)
+fn parse_size(s: &str) -> Option<usize> {
+    let (digits, shift) = match s.as_bytes().last()? {
+        b'k' | b'K' => (&s[..s.len() - 1], 10),
+        b'm' | b'M' => (&s[..s.len() - 1], 20),
+        b'g' | b'G' => (&s[..s.len() - 1], 30),
+        _ => (s, 0),
+    };
+    let n: usize = digits.parse().ok()?;
+    n.checked_mul(1 << shift)
+}
+
+/// Size from `--flag value` or the environment; exits on a malformed value
+fn size_option(name: &str, value: Option<&str>) -> usize {
+    match value.and_then(parse_size) {
+        Some(n) => n,
+        None => {
+            print_error("Error: expected a size like 512k or 16m for ", name);
+            exit(1);
         }
-        data.extend_from_slice(&buf[..n as usize]);
     }
-    
-    // Convert to string (lossy UTF-8)
-    let s = match core::str::from_utf8(&data) {
-        Ok(s) => String::from(s),
-        Err(_) => {
-            // Try to convert as lossy UTF-8
-            String::from_utf8_lossy(&data).into_owned()
+}
+
+/// Limits from `QJS_MEMORY_LIMIT`, `QJS_GC_THRESHOLD` and `QJS_STACK_SIZE`;
+/// the command-line flags override them
+fn limits_from_env() -> Limits {
+    let mut limits = Limits::default();
+    if let Some(v) = libakuma::env("QJS_MEMORY_LIMIT") {
+        limits.memory_limit = size_option("QJS_MEMORY_LIMIT", Some(v));
+    }
+    if let Some(v) = libakuma::env("QJS_GC_THRESHOLD") {
+        limits.gc_threshold = Some(size_option("QJS_GC_THRESHOLD", Some(v)));
+    }
+    if let Some(v) = libakuma::env("QJS_STACK_SIZE") {
+        limits.stack_size = size_option("QJS_STACK_SIZE", Some(v));
+    }
+    limits
+}
+
+// ============================================================================
+// Script Loading
+// ============================================================================
+
+/// How `run_file` loads scripts
+struct LoadOptions {
+    /// Compile cache directory (`--cache` / `QJS_CACHE_DIR`)
+    cache_dir: Option<String>,
+    /// Print per-phase startup times to stderr (`--timing`)
+    timing: bool,
+}
+
+fn print_error(prefix: &str, e: &str) {
+    print(prefix);
+    print(e);
+    print("\n");
+}
+
+/// Compile a loaded script, parsing it in place when the contents are
+/// already NUL-terminated; prints the error on failure. A module is named
+/// by its absolute path, as its imports resolve against it.
+fn compile_data(rt: &Runtime, data: &FileData, path: &str) -> Option<JSValue> {
+    let code = match runtime::script_source(data) {
+        Ok(c) => c,
+        Err(e) => {
+            print_error("Error reading file: ", e);
+            return None;
         }
     };
-    
-    // Create JS string
-    runtime::JS_NewStringLen(ctx, s.as_ptr(), s.len())
+    let module = module_loader::is_module(path, code);
+    let abs_path;
+    let name = if module {
+        abs_path = module_loader::resolve("", path);
+        &abs_path
+    } else {
+        path
+    };
+    let result = if data.nul_terminated() {
+        // SAFETY: `code` ends where `data` does, and the byte after is 0
+        unsafe { rt.compile_terminated(code, name, module) }
+    } else {
+        rt.compile(code, name, module)
+    };
+    match result {
+        Ok(f) => Some(f),
+        Err(e) => {
+            print_error("Error: ", &e);
+            None
+        }
+    }
+}
+
+/// Run a script or `.qbc` file; returns the exit code
+fn run_file(rt: &Runtime, path: &str, opts: &LoadOptions) -> i32 {
+    let t_start = uptime();
+    debug("qjs: reading file\n");
+    let (data, stat) = match mapfile::load(path, false) {
+        Ok(r) => r,
+        Err(e) => {
+            print_error("Error reading file: ", e);
+            return 1;
+        }
+    };
+    let t_read = uptime();
+
+    // Get the function object: from a .qbc file, from the cache, or by
+    // compiling the source
+    let mut how = "compile";
+    let fun = if bytecode::is_qbc(&data) {
+        how = "qbc";
+        let qbc = match bytecode::decode(&data) {
+            Some(q) => q,
+            None => {
+                print_error("Error: unsupported bytecode file: ", path);
+                return 1;
+            }
+        };
+        match rt.read_bytecode(qbc.bytecode) {
+            Ok(f) => f,
+            Err(e) => {
+                print_error("Error loading bytecode (recompile with qjs -c): ", &e);
+                return 1;
+            }
+        }
+    } else {
+        let key = bytecode::SourceKey::from_stat(&stat);
+        let abs_path = bytecode::absolute_path(path);
+        let cached = opts.cache_dir.as_deref().and_then(|dir| {
+            let bc = bytecode::load_cached(dir, &abs_path, key)?;
+            // A stale engine build's entry fails here and is recompiled
+            rt.read_bytecode(&bc).ok()
+        });
+        match cached {
+            Some(f) => {
+                how = "cached";
+                f
+            }
+            None => {
+                let f = match compile_data(rt, &data, path) {
+                    Some(f) => f,
+                    None => return 1,
+                };
+                if let Some(dir) = opts.cache_dir.as_deref() {
+                    if let Some(bc) = rt.write_bytecode(f) {
+                        bytecode::store_cached(dir, &abs_path, key, &bc);
+                    }
+                }
+                f
+            }
+        }
+    };
+    let t_load = uptime();
+    // The function holds no reference to the file; release its pages
+    drop(data);
+
+    // Execute the script
+    debug("qjs: evaluating\n");
+    let code = match rt.eval_function(fun) {
+        Ok(result) => {
+            rt.free_value(result);
+            0
+        }
+        Err(e) => {
+            print_error("Error: ", &e);
+            1
+        }
+    };
+
+    if opts.timing {
+        let line = alloc::format!(
+            "timing: read={}us {}={}us run={}us total={}us\n",
+            t_read - t_start,
+            how,
+            t_load - t_read,
+            uptime() - t_load,
+            uptime() - t_start,
+        );
+        stdio::write(fd::STDERR, line.as_bytes());
+    }
+    code
+}
+
+/// `qjs -c script.js [-o out.qbc]`: compile to a bytecode file
+fn compile_file(rt: &Runtime, path: &str, out: &str) -> i32 {
+    let (data, stat) = match mapfile::load(path, false) {
+        Ok(r) => r,
+        Err(e) => {
+            print_error("Error reading file: ", e);
+            return 1;
+        }
+    };
+    let fun = match compile_data(rt, &data, path) {
+        Some(f) => f,
+        None => return 1,
+    };
+    let bc = rt.write_bytecode(fun);
+    rt.free_value(fun);
+    let bc = match bc {
+        Some(b) => b,
+        None => {
+            print("Error: failed to serialize bytecode\n");
+            return 1;
+        }
+    };
+    let key = bytecode::SourceKey::from_stat(&stat);
+    let file = bytecode::encode(key, &bytecode::absolute_path(path), &bc);
+    if let Err(e) = runtime::write_file(out, &file) {
+        print_error("Error writing output: ", e);
+        return 1;
+    }
+    0
+}
+
+/// Default `-c` output: the script path with `.js` replaced by `.qbc`
+fn default_qbc_path(path: &str) -> String {
+    let stem = path.strip_suffix(".js").unwrap_or(path);
+    alloc::format!("{}.qbc", stem)
 }
 
 /// Setup the console object with log method
@@ -132,7 +383,7 @@ fn setup_console(rt: &Runtime) {
         rt.set_property_str(global, "print", print_fn);
         
         // Add readStdin function for reading from stdin (useful for CGI)
-        let read_stdin_fn = rt.new_c_function(js_read_stdin, "readStdin", 0);
+        let read_stdin_fn = rt.new_c_function(stdin::js_read_stdin, "readStdin", 1);
         rt.set_property_str(global, "readStdin", read_stdin_fn);
 
         debug("qjs: freeing global\n");
@@ -142,6 +393,69 @@ fn setup_console(rt: &Runtime) {
 }
 
 
+/// `Akuma.mapFile(path[, writable])`: an ArrayBuffer over a private
+/// mapping of the file, outside the JS heap and unmapped when the buffer is
+/// collected. The buffer is read-only (writes fault) unless `writable`, in
+/// which case changes stay in this process and never reach the file.
+unsafe extern "C" fn js_map_file(
+    ctx: *mut JSContext,
+    _this_val: JSValue,
+    argc: c_int,
+    argv: *mut JSValue,
+) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"mapFile: path expected".as_ptr());
+    }
+    let mut len: usize = 0;
+    let cstr = runtime::JS_ToCStringLen2(ctx, &mut len, *argv, 0);
+    if cstr.is_null() {
+        return JSValue::exception();
+    }
+    let path = core::str::from_utf8(core::slice::from_raw_parts(cstr as *const u8, len))
+        .map(String::from)
+        .unwrap_or_default();
+    runtime::JS_FreeCString(ctx, cstr);
+    let writable = argc > 1 && runtime::JS_ToBool(ctx, *argv.add(1)) > 0;
+
+    match mapfile::load(&path, writable) {
+        Ok((FileData::Mapped(m), _)) => {
+            let (ptr, len) = m.into_raw();
+            runtime::JS_NewArrayBuffer(
+                ctx,
+                ptr,
+                len,
+                Some(mapfile::free_array_buffer),
+                len as *mut core::ffi::c_void,
+                0,
+            )
+        }
+        Ok((data @ FileData::Heap(_), _)) => runtime::JS_NewArrayBufferCopy(ctx, data.as_ptr(), data.len()),
+        Err(e) => {
+            let msg = alloc::format!("mapFile: {}: {}\0", e, path);
+            runtime::JS_ThrowTypeError(ctx, c"%s".as_ptr(), msg.as_ptr())
+        }
+    }
+}
+
+/// Setup the `Akuma` object with the OS-specific helpers, `Akuma.crypto`
+/// and the stdin streams, the timer globals and `Worker`
+fn setup_akuma(rt: &Runtime) {
+    unsafe {
+        let global = rt.global_object();
+        let akuma = runtime::JS_NewObject(rt.context());
+        let map_file_fn = rt.new_c_function(js_map_file, "mapFile", 2);
+        rt.set_property_str(akuma, "mapFile", map_file_fn);
+        crypto::setup(rt, akuma);
+        json_stream::setup(rt, akuma);
+        stdin::setup(rt, global, akuma);
+        event_loop::setup(rt, global, akuma);
+        worker::setup(rt, global);
+        module_loader::setup(rt);
+        rt.set_property_str(global, "Akuma", akuma);
+        rt.free_value(global);
+    }
+}
+
 // ============================================================================
 // Main Entry Point
 // ============================================================================
@@ -149,18 +463,88 @@ fn setup_console(rt: &Runtime) {
 #[no_mangle]
 pub extern "C" fn main() {
     debug("qjs: starting\n");
-    
+
+    // Leading options
+    let mut argi = 1;
+    let mut no_buffer = false;
+    let mut alloc_stats = false;
+    let mut mem_stats = libakuma::env("QJS_MEM_STATS").is_some();
+    let mut prof_out: Option<&str> = None;
+    let mut limits = limits_from_env();
+    let mut load = LoadOptions {
+        cache_dir: libakuma::env("QJS_CACHE_DIR").map(String::from),
+        timing: false,
+    };
+    while let Some(opt) = arg(argi) {
+        match opt {
+            "--no-buffer" => no_buffer = true,
+            "--no-slab" => slab::disable(),
+            "--eager-intrinsics" => runtime::set_eager_intrinsics(true),
+            "--alloc-stats" => alloc_stats = true,
+            "--mem-stats" => mem_stats = true,
+            "--memory-limit" => {
+                argi += 1;
+                limits.memory_limit = size_option(opt, arg(argi));
+            }
+            "--gc-threshold" => {
+                argi += 1;
+                limits.gc_threshold = Some(size_option(opt, arg(argi)));
+            }
+            "--stack-size" => {
+                argi += 1;
+                limits.stack_size = size_option(opt, arg(argi));
+            }
+            "--cache" => {
+                if load.cache_dir.is_none() {
+                    load.cache_dir = Some(String::from(bytecode::DEFAULT_CACHE_DIR));
+                }
+            }
+            "--timing" => load.timing = true,
+            "--prof" => {
+                argi += 1;
+                match arg(argi) {
+                    Some(p) => prof_out = Some(p),
+                    None => {
+                        print("Error: --prof requires an output path\n");
+                        exit(1);
+                    }
+                }
+            }
+            _ => break,
+        }
+        argi += 1;
+    }
+    stdio::init(no_buffer);
+
     // Check command line arguments
-    if argc() < 2 {
+    if argc() < argi + 1 {
         print("QuickJS for Akuma\n");
-        print("Usage: qjs <script.js>\n");
-        print("       qjs -e \"<code>\"\n");
+        print("Usage: qjs [options] <script.js>\n");
+        print("       qjs [options] -e \"<code>\"\n");
+        print("       qjs -c <script.js> [-o <script.qbc>]\n");
+        print("  -c             compile to QuickJS bytecode; run the .qbc like a script\n");
+        print("  --cache        reuse compiled bytecode across runs (dir: $QJS_CACHE_DIR,\n");
+        print("                 default /tmp/qjs-cache; setting QJS_CACHE_DIR also enables it)\n");
+        print("  --timing       print read/compile/run times to stderr\n");
+        print("  --no-buffer    write output immediately instead of buffering stdout\n");
+        print("  --no-slab      allocate every QuickJS object with malloc (A/B runs)\n");
+        print("  --alloc-stats  print allocation counts and peak memory at exit\n");
+        print("  --memory-limit N  fail allocations past N bytes (k/m/g suffix; $QJS_MEMORY_LIMIT)\n");
+        print("  --gc-threshold N  collect garbage every N allocated bytes ($QJS_GC_THRESHOLD)\n");
+        print("  --stack-size N    JS stack limit, default 256k, 0 = none ($QJS_STACK_SIZE)\n");
+        print("  --mem-stats    print heap, peak and GC summary at exit ($QJS_MEM_STATS)\n");
+        print("  --prof FILE    sample the JS stack at 1 kHz; write folded stacks (for\n");
+        print("                 flamegraph.pl) to FILE and a hot-function summary to stderr\n");
+        print("  --eager-intrinsics  build Date, Map/Set, Proxy and typed arrays at\n");
+        print("                 startup instead of on first use\n");
+        print("  --bench [name...]  run the benchmark suite (startup json regex string\n");
+        print("                 alloc bigint typedarray), one JSON line each ($QJS_BENCH_MS)\n");
         exit(1);
     }
 
     debug("qjs: parsing args\n");
-    
-    let first_arg = match arg(1) {
+
+    let first_arg = match arg(argi) {
         Some(a) => a,
         None => {
             print("Error: Failed to get argument\n");
@@ -169,9 +553,19 @@ pub extern "C" fn main() {
     };
 
     debug("qjs: creating runtime\n");
+    worker::configure(&limits, load.cache_dir.as_deref());
+    module_loader::configure(load.cache_dir.as_deref());
+    if first_arg == "--bench" {
+        // Each workload gets its own runtime
+        let code = bench::run(&limits, argi + 1);
+        if alloc_stats {
+            print_alloc_stats();
+        }
+        exit(code);
+    }
     
     // Initialize the runtime
-    let rt = match Runtime::new() {
+    let rt = match Runtime::new(&limits) {
         Some(r) => r,
         None => {
             print("Error: Failed to create JavaScript runtime\n");
@@ -183,18 +577,40 @@ pub extern "C" fn main() {
 
     // Setup console object
     setup_console(&rt);
+    setup_akuma(&rt);
+    if let Some(out) = prof_out {
+        profiler::start(&rt, out);
+    }
 
     debug("qjs: checking args\n");
     
     // Check if we're evaluating inline code or a file
-    let code = if first_arg == "-e" {
+    let code = if first_arg == "-c" {
+        // Compile to bytecode
+        let src = match arg(argi + 1) {
+            Some(s) => s,
+            None => {
+                print("Error: -c requires a script argument\n");
+                exit(1);
+            }
+        };
+        let out = match (arg(argi + 2), arg(argi + 3)) {
+            (Some("-o"), Some(o)) => String::from(o),
+            (Some("-o"), None) => {
+                print("Error: -o requires an output path\n");
+                exit(1);
+            }
+            _ => default_qbc_path(src),
+        };
+        compile_file(&rt, src, &out)
+    } else if first_arg == "-e" {
         // Inline code execution
-        if argc() < 3 {
+        if argc() < argi + 2 {
             print("Error: -e requires code argument\n");
             exit(1);
         }
 
-        let code = match arg(2) {
+        let code = match arg(argi + 1) {
             Some(c) => c,
             None => {
                 print("Error: Failed to get code argument\n");
@@ -228,45 +644,28 @@ pub extern "C" fn main() {
             print(script_path);
             print("\n");
         }
-
-        // Read the script file
-        debug("qjs: reading file\n");
-        let code = match runtime::read_file(script_path) {
-            Ok(c) => c,
-            Err(e) => {
-                print("Error reading file: ");
-                print(e);
-                print("\n");
-                exit(1);
-            }
-        };
-        if DEBUG {
-            debug("qjs: file read, code=");
-            // Print code as a simple check
-            if code.len() < 100 {
-                print(&code);
-            } else {
-                print("<long>");
-            }
-            print("\n");
-        }
-
-        // Execute the script
-        debug("qjs: evaluating\n");
-        match rt.eval(&code, script_path) {
-            Ok(result) => {
-                debug("qjs: eval ok, freeing result\n");
-                rt.free_value(result);
-                debug("qjs: done\n");
-                0
-            }
+        run_file(&rt, script_path, &load)
+    };
+    // Timers, pending I/O and Promise jobs the script left behind
+    let code = if first_arg == "-c" || code != 0 {
+        code
+    } else {
+        match event_loop::run(&rt) {
+            Ok(()) => 0,
             Err(e) => {
-                print("Error: ");
-                print(&e);
-                print("\n");
+                print_error("Error: ", &e);
                 1
             }
         }
     };
+    if prof_out.is_some() {
+        profiler::finish(&rt);
+    }
+    if alloc_stats {
+        print_alloc_stats();
+    }
+    if mem_stats {
+        print_mem_stats(&rt, &limits);
+    }
     exit(code);
 }
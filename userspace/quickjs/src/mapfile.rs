@@ -0,0 +1,122 @@
+//! mmap-backed file loading for qjs
+//!
+//! Scripts, `.qbc` files and `Akuma.mapFile` buffers are mapped from the
+//! file instead of read into the heap. The kernel faults pages in on first
+//! touch, and clean read-only pages can be dropped under memory pressure and
+//! read again, so a multi-MB file costs only the pages in use. JS_Eval
+//! parses the source in place: it needs a NUL after the last byte, which the
+//! zero-filled tail of the final page provides whenever the file does not
+//! end exactly on a page boundary.
+
+use alloc::vec::Vec;
+use core::ffi::c_void;
+use core::ops::Deref;
+
+use libakuma::mmap_flags::{MAP_PRIVATE, PROT_READ, PROT_WRITE};
+use libakuma::{close, fstat, open, open_flags, Stat};
+
+use crate::runtime::{self, JSRuntime};
+
+const PAGE_SIZE: usize = 4096;
+
+fn page_round(len: usize) -> usize {
+    (len + PAGE_SIZE - 1) & !(PAGE_SIZE - 1)
+}
+
+/// A private mapping of a whole file, unmapped on drop
+pub struct Mapping {
+    addr: usize,
+    len: usize,
+}
+
+impl Mapping {
+    /// Map `len` (non-zero) bytes of `fd`. Read-only unless `writable`, in
+    /// which case writes stay private to the process and pin their pages.
+    fn map(fd: i32, len: usize, writable: bool) -> Option<Self> {
+        let prot = if writable { PROT_READ | PROT_WRITE } else { PROT_READ };
+        let addr = libakuma::mmap_fd(0, len, prot, MAP_PRIVATE, fd, 0);
+        if addr == 0 || addr > usize::MAX - PAGE_SIZE {
+            return None;
+        }
+        Some(Mapping { addr, len })
+    }
+
+    /// Give up ownership of the mapping; release it with [`free_array_buffer`]
+    /// (as a `JS_NewArrayBuffer` free callback) or `munmap`.
+    pub fn into_raw(self) -> (*mut u8, usize) {
+        let raw = (self.addr as *mut u8, self.len);
+        core::mem::forget(self);
+        raw
+    }
+}
+
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        libakuma::munmap(self.addr, page_round(self.len));
+    }
+}
+
+/// Contents of a loaded file
+pub enum FileData {
+    Mapped(Mapping),
+    /// Read into the heap when the file cannot be mapped (empty, or not a
+    /// regular file). Holds one extra trailing NUL.
+    Heap(Vec<u8>),
+}
+
+impl FileData {
+    /// Whether the byte after the contents is readable and zero, so the
+    /// buffer can go to JS_Eval without a copy
+    pub fn nul_terminated(&self) -> bool {
+        match self {
+            FileData::Mapped(m) => m.len % PAGE_SIZE != 0,
+            FileData::Heap(_) => true,
+        }
+    }
+}
+
+impl Deref for FileData {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        match self {
+            FileData::Mapped(m) => unsafe { core::slice::from_raw_parts(m.addr as *const u8, m.len) },
+            FileData::Heap(v) => &v[..v.len() - 1],
+        }
+    }
+}
+
+/// Load `path`, mapping it when possible; returns its contents and `fstat`
+/// result
+pub fn load(path: &str, writable: bool) -> Result<(FileData, Stat), &'static str> {
+    let fd = open(path, open_flags::O_RDONLY);
+    if fd < 0 {
+        return Err("Failed to open file");
+    }
+    let stat = match fstat(fd) {
+        Ok(s) => s,
+        Err(_) => {
+            close(fd);
+            return Err("Failed to stat file");
+        }
+    };
+    let size = stat.st_size as usize;
+    let mapping = if size > 0 { Mapping::map(fd, size, writable) } else { None };
+    let data = match mapping {
+        Some(m) => FileData::Mapped(m),
+        None => {
+            let mut content = runtime::read_open_file(fd, size);
+            content.push(0);
+            FileData::Heap(content)
+        }
+    };
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    Ok((data, stat))
+}
+
+/// `JSFreeArrayBufferDataFunc` for buffers over a [`Mapping::into_raw`]
+/// mapping; `opaque` carries the length
+pub unsafe extern "C" fn free_array_buffer(_rt: *mut JSRuntime, opaque: *mut c_void, ptr: *mut c_void) {
+    libakuma::munmap(ptr as usize, page_round(opaque as usize));
+}
@@ -0,0 +1,165 @@
+//! ES module loading
+//!
+//! A script is run as a module when its name ends in `.mjs` or its first
+//! statement is an `import` or `export` (`JS_DetectModule`). Its imports,
+//! and `import()` from any script, resolve through the hooks registered
+//! here: a specifier starting with `.` is relative to the importing file,
+//! and every name is made absolute with `.` and `..` folded, so each file
+//! is one module per runtime however it is spelled. QuickJS keeps loaded
+//! modules by that name and compiles each only once.
+//!
+//! With the compile cache on (`--cache` / `QJS_CACHE_DIR`) each module's
+//! bytecode is kept under its path like a main script's, so an unchanged
+//! dependency graph loads without parsing.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::ffi::{c_char, c_void, CStr};
+use core::ptr;
+
+use libakuma::Spinlock;
+
+use crate::bytecode::{self, SourceKey};
+use crate::mapfile;
+use crate::runtime::{self, JSContext, JSModuleDef, Runtime, JS_TAG_MODULE};
+
+/// Compile cache directory shared by every runtime's loader
+static CACHE_DIR: Spinlock<Option<String>> = Spinlock::new(None);
+
+/// Set the cache directory modules use. Call before the main script runs.
+pub fn configure(cache_dir: Option<&str>) {
+    *CACHE_DIR.lock() = cache_dir.map(String::from);
+}
+
+/// Register the loader on a new runtime
+pub fn setup(rt: &Runtime) {
+    unsafe { runtime::JS_SetModuleLoaderFunc(rt.runtime(), Some(normalize), Some(load), ptr::null_mut()) };
+}
+
+/// Whether a script at `path` with source `code` is a module
+pub fn is_module(path: &str, code: &str) -> bool {
+    path.ends_with(".mjs") || unsafe { runtime::JS_DetectModule(code.as_ptr() as *const c_char, code.len()) != 0 }
+}
+
+/// Absolute name of the module `name` imported from `base`; an empty
+/// `base` resolves against the working directory
+pub fn resolve(base: &str, name: &str) -> String {
+    let joined = if name.starts_with('/') {
+        String::from(name)
+    } else if name.starts_with('.') {
+        let base = bytecode::absolute_path(base);
+        let dir = &base[..base.rfind('/').unwrap_or(0)];
+        alloc::format!("{}/{}", dir, name)
+    } else {
+        // Bare names are looked up from the working directory
+        bytecode::absolute_path(name)
+    };
+    let mut parts: Vec<&str> = Vec::new();
+    for part in joined.split('/') {
+        match part {
+            "" | "." => {}
+            ".." => {
+                parts.pop();
+            }
+            p => parts.push(p),
+        }
+    }
+    let mut out = String::with_capacity(joined.len());
+    for p in parts {
+        out.push('/');
+        out.push_str(p);
+    }
+    if out.is_empty() {
+        out.push('/');
+    }
+    out
+}
+
+/// `JSModuleNormalizeFunc`: the result is freed by QuickJS with `js_free`
+unsafe extern "C" fn normalize(
+    ctx: *mut JSContext,
+    base: *const c_char,
+    name: *const c_char,
+    _opaque: *mut c_void,
+) -> *mut c_char {
+    let base = CStr::from_ptr(base).to_str().unwrap_or("");
+    let name = match CStr::from_ptr(name).to_str() {
+        Ok(n) => n,
+        Err(_) => {
+            runtime::JS_ThrowReferenceError(ctx, c"module name is not valid UTF-8".as_ptr());
+            return ptr::null_mut();
+        }
+    };
+    let path = resolve(base, name);
+    let out = runtime::js_malloc(ctx, path.len() + 1) as *mut u8;
+    if !out.is_null() {
+        ptr::copy_nonoverlapping(path.as_ptr(), out, path.len());
+        *out.add(path.len()) = 0;
+    }
+    out as *mut c_char
+}
+
+/// `JSModuleLoaderFunc`: compile (or read from the cache) the module at
+/// the normalized `name`; null with an exception pending on failure
+unsafe extern "C" fn load(ctx: *mut JSContext, name: *const c_char, _opaque: *mut c_void) -> *mut JSModuleDef {
+    let path = CStr::from_ptr(name).to_str().unwrap_or("");
+    match load_module(ctx, path) {
+        Ok(m) => m,
+        Err(Some(e)) => {
+            let msg = alloc::format!("could not load module '{}': {}\0", path, e);
+            runtime::JS_ThrowReferenceError(ctx, c"%s".as_ptr(), msg.as_ptr());
+            ptr::null_mut()
+        }
+        // The compile error is already pending
+        Err(None) => ptr::null_mut(),
+    }
+}
+
+unsafe fn load_module(ctx: *mut JSContext, path: &str) -> Result<*mut JSModuleDef, Option<&'static str>> {
+    let (data, stat) = mapfile::load(path, false).map_err(Some)?;
+    let cache_dir = CACHE_DIR.lock().clone();
+    let key = SourceKey::from_stat(&stat);
+    if let Some(bc) = cache_dir.as_deref().and_then(|dir| bytecode::load_cached(dir, path, key)) {
+        let obj = runtime::JS_ReadObject(ctx, bc.as_ptr(), bc.len(), runtime::JS_READ_OBJ_BYTECODE);
+        if obj.get_tag() == JS_TAG_MODULE {
+            // The loaded-module list keeps its own reference
+            runtime::free_value(ctx, obj);
+            return Ok(obj.u.ptr as *mut JSModuleDef);
+        }
+        // A stale engine build's entry: drop it and recompile
+        let exc = runtime::JS_GetException(ctx);
+        runtime::free_value(ctx, exc);
+        runtime::free_value(ctx, obj);
+    }
+
+    let code = runtime::script_source(&data).map_err(Some)?;
+    let mut name = Vec::with_capacity(path.len() + 1);
+    name.extend_from_slice(path.as_bytes());
+    name.push(0);
+    let flags = runtime::compile_flags(true);
+    // Compiling resolves (and so loads) the module's own imports
+    let obj = if data.nul_terminated() {
+        runtime::JS_Eval(ctx, code.as_ptr() as *const c_char, code.len(), name.as_ptr() as *const c_char, flags)
+    } else {
+        let mut buf = Vec::with_capacity(code.len() + 1);
+        buf.extend_from_slice(code.as_bytes());
+        buf.push(0);
+        runtime::JS_Eval(ctx, buf.as_ptr() as *const c_char, code.len(), name.as_ptr() as *const c_char, flags)
+    };
+    if obj.is_exception() {
+        return Err(None);
+    }
+    if let Some(dir) = cache_dir.as_deref() {
+        let mut size = 0;
+        let buf = runtime::JS_WriteObject(ctx, &mut size, obj, runtime::JS_WRITE_OBJ_BYTECODE);
+        if buf.is_null() {
+            let exc = runtime::JS_GetException(ctx);
+            runtime::free_value(ctx, exc);
+        } else {
+            bytecode::store_cached(dir, path, key, core::slice::from_raw_parts(buf, size));
+            runtime::js_free(ctx, buf as *mut c_void);
+        }
+    }
+    runtime::free_value(ctx, obj);
+    Ok(obj.u.ptr as *mut JSModuleDef)
+}
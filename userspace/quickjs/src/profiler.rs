@@ -0,0 +1,262 @@
+//! Sampling profiler (`qjs --prof out.txt`)
+//!
+//! The engine calls the runtime's interrupt handler every so many branches
+//! and calls. The handler reads `uptime()`, and once a sample period
+//! (1 ms) has passed it walks the JS stack with `JS_GetStackFrames`. The
+//! interrupt interval is retuned after every call so the handler runs
+//! about four times per period, keeping the clock reads cheap however fast
+//! the script's loops are.
+//!
+//! At exit the samples are written as folded stacks, one
+//! `outer;...;inner count` line per distinct stack, ready for
+//! `flamegraph.pl`. A per-function and per-line summary goes to stderr.
+//!
+//! Samples are only taken while the interpreter runs: time in a long
+//! native call is charged to the next sample at most once, and time
+//! waiting in the event loop is not counted. Workers are not sampled.
+
+use alloc::boxed::Box;
+use alloc::collections::BTreeMap;
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::ffi::{c_int, c_void};
+use core::ptr;
+
+use libakuma::{fd, uptime};
+
+use crate::runtime::{self, JSAtom, JSContext, JSRuntime, JSStackFrameInfo, Runtime, JS_ATOM_NULL};
+use crate::stdio;
+
+/// Time between samples, in microseconds (1 kHz)
+const PERIOD_US: u64 = 1000;
+/// How often the interrupt handler should run
+const CALL_US: u64 = PERIOD_US / 4;
+/// Bounds for the interrupt interval, in interrupt checks
+const MIN_INTERVAL: u64 = 64;
+const MAX_INTERVAL: u64 = 1 << 20;
+/// Deeper stacks keep their innermost frames
+const MAX_FRAMES: usize = 64;
+/// Rows in each table of the stderr summary
+const REPORT_ROWS: usize = 10;
+
+/// A function seen in a sample
+struct Frame {
+    /// Duplicated atoms, released by `finish`
+    name_atom: JSAtom,
+    file_atom: JSAtom,
+    /// `name (file:line)` with the definition line, or `name (native)`
+    label: String,
+    /// `file` alone, for the per-line table
+    file: String,
+}
+
+struct Profiler {
+    ctx: *mut JSContext,
+    out: String,
+    start: u64,
+    last_call: u64,
+    next_sample: u64,
+    interval: u64,
+    samples: u64,
+    frames: Vec<Frame>,
+    frame_ids: BTreeMap<(JSAtom, JSAtom, c_int), u32>,
+    /// Frame ids innermost first -> samples
+    stacks: BTreeMap<Vec<u32>, u64>,
+    /// (innermost frame id, current line) -> samples
+    lines: BTreeMap<(u32, c_int), u64>,
+    info: [JSStackFrameInfo; MAX_FRAMES],
+    key: Vec<u32>,
+}
+
+/// Owned by the runtime's interrupt handler between `start` and `finish`
+static mut PROFILER: *mut Profiler = ptr::null_mut();
+
+/// Start sampling the main runtime; the profile goes to `out` at `finish`
+pub fn start(rt: &Runtime, out: &str) {
+    let now = uptime();
+    let prof = Box::new(Profiler {
+        ctx: rt.context(),
+        out: String::from(out),
+        start: now,
+        last_call: now,
+        next_sample: now + PERIOD_US,
+        interval: 1000,
+        samples: 0,
+        frames: Vec::new(),
+        frame_ids: BTreeMap::new(),
+        stacks: BTreeMap::new(),
+        lines: BTreeMap::new(),
+        info: [JSStackFrameInfo::default(); MAX_FRAMES],
+        key: Vec::with_capacity(MAX_FRAMES),
+    });
+    unsafe {
+        PROFILER = Box::into_raw(prof);
+        runtime::JS_SetInterruptInterval(rt.runtime(), 1000);
+        runtime::JS_SetInterruptHandler(rt.runtime(), Some(interrupt), PROFILER as *mut c_void);
+    }
+}
+
+unsafe extern "C" fn interrupt(rt: *mut JSRuntime, opaque: *mut c_void) -> c_int {
+    let prof = &mut *(opaque as *mut Profiler);
+    let now = uptime();
+    // Scale the interval toward one call per CALL_US, moving half way so a
+    // single slow step (a GC, an idle wait) does not swing it
+    let dt = (now - prof.last_call).max(1);
+    let target = prof.interval * CALL_US / dt;
+    prof.interval = ((prof.interval + target) / 2).clamp(MIN_INTERVAL, MAX_INTERVAL);
+    runtime::JS_SetInterruptInterval(rt, prof.interval as c_int);
+    prof.last_call = now;
+
+    if now >= prof.next_sample && prof.sample() {
+        prof.next_sample = now + PERIOD_US;
+    }
+    0
+}
+
+impl Profiler {
+    /// Record the current stack; false when no JS is running
+    unsafe fn sample(&mut self) -> bool {
+        let n = runtime::JS_GetStackFrames(self.ctx, self.info.as_mut_ptr(), MAX_FRAMES as c_int);
+        if n <= 0 {
+            return false;
+        }
+        self.key.clear();
+        for i in 0..n as usize {
+            let info = self.info[i];
+            let id = self.intern(&info);
+            self.key.push(id);
+        }
+        match self.stacks.get_mut(self.key.as_slice()) {
+            Some(count) => *count += 1,
+            None => {
+                self.stacks.insert(self.key.clone(), 1);
+            }
+        }
+        *self.lines.entry((self.key[0], self.info[0].line_num)).or_insert(0) += 1;
+        self.samples += 1;
+        true
+    }
+
+    /// Id of a frame's function, resolving its name the first time
+    unsafe fn intern(&mut self, info: &JSStackFrameInfo) -> u32 {
+        let k = (info.func_name, info.filename, info.func_line_num);
+        if let Some(&id) = self.frame_ids.get(&k) {
+            return id;
+        }
+        // Hold the atoms so they cannot be reused for other names
+        let name_atom = runtime::JS_DupAtom(self.ctx, info.func_name);
+        let file_atom = runtime::JS_DupAtom(self.ctx, info.filename);
+        let mut name = self.atom_string(name_atom);
+        if name.is_empty() {
+            name = String::from("<anonymous>");
+        }
+        let file = self.atom_string(file_atom);
+        let label = if info.filename == JS_ATOM_NULL {
+            alloc::format!("{} (native)", name)
+        } else {
+            alloc::format!("{} ({}:{})", name, file, info.func_line_num)
+        };
+        let id = self.frames.len() as u32;
+        self.frames.push(Frame { name_atom, file_atom, label, file });
+        self.frame_ids.insert(k, id);
+        id
+    }
+
+    /// An atom's text, with the folded format's separators replaced
+    unsafe fn atom_string(&self, atom: JSAtom) -> String {
+        if atom == JS_ATOM_NULL {
+            return String::new();
+        }
+        let cstr = runtime::JS_AtomToCString(self.ctx, atom);
+        if cstr.is_null() {
+            return String::new();
+        }
+        let s = core::ffi::CStr::from_ptr(cstr)
+            .to_string_lossy()
+            .replace(|c: char| c == ';' || c == '\n', "_");
+        runtime::JS_FreeCString(self.ctx, cstr);
+        s
+    }
+}
+
+/// One tenth of a percent of `total`
+fn permille(n: u64, total: u64) -> u64 {
+    n * 1000 / total.max(1)
+}
+
+/// Stop sampling, write the folded stacks and print the summary
+pub fn finish(rt: &Runtime) {
+    let prof = unsafe {
+        if PROFILER.is_null() {
+            return;
+        }
+        runtime::JS_SetInterruptHandler(rt.runtime(), None, ptr::null_mut());
+        // Back to the engine's default
+        runtime::JS_SetInterruptInterval(rt.runtime(), 10000);
+        let p = Box::from_raw(PROFILER);
+        PROFILER = ptr::null_mut();
+        p
+    };
+    let elapsed_ms = (uptime() - prof.start) / 1000;
+
+    // Folded stacks, outermost frame first
+    let mut folded = String::new();
+    let mut self_samples = alloc::vec![0u64; prof.frames.len()];
+    let mut total_samples = alloc::vec![0u64; prof.frames.len()];
+    for (stack, &count) in &prof.stacks {
+        for (i, &id) in stack.iter().rev().enumerate() {
+            if i > 0 {
+                folded.push(';');
+            }
+            folded.push_str(&prof.frames[id as usize].label);
+        }
+        folded.push_str(&alloc::format!(" {}\n", count));
+        self_samples[stack[0] as usize] += count;
+        // Count recursive functions once per stack
+        for (i, &id) in stack.iter().enumerate() {
+            if !stack[..i].contains(&id) {
+                total_samples[id as usize] += count;
+            }
+        }
+    }
+    let written = runtime::write_file(&prof.out, folded.as_bytes());
+
+    let mut report = match written {
+        Ok(()) => alloc::format!(
+            "prof: {} samples over {} ms, folded stacks in {}\n",
+            prof.samples, elapsed_ms, prof.out
+        ),
+        Err(e) => alloc::format!("prof: {} samples over {} ms, {}: {}\n", prof.samples, elapsed_ms, e, prof.out),
+    };
+    let mut by_self: Vec<usize> = (0..prof.frames.len()).collect();
+    by_self.sort_by(|&a, &b| self_samples[b].cmp(&self_samples[a]).then(a.cmp(&b)));
+    report.push_str("  self%  total%  function\n");
+    for &id in by_self.iter().take(REPORT_ROWS) {
+        let (s, t) = (permille(self_samples[id], prof.samples), permille(total_samples[id], prof.samples));
+        report.push_str(&alloc::format!(
+            "  {:3}.{}  {:4}.{}  {}\n",
+            s / 10, s % 10, t / 10, t % 10, prof.frames[id].label
+        ));
+    }
+    let mut by_line: Vec<(&(u32, c_int), &u64)> = prof.lines.iter().collect();
+    by_line.sort_by(|a, b| b.1.cmp(a.1).then(a.0.cmp(b.0)));
+    report.push_str("  self%  line\n");
+    for (&(id, line), &count) in by_line.into_iter().take(REPORT_ROWS) {
+        let f = &prof.frames[id as usize];
+        let s = permille(count, prof.samples);
+        let at = if f.file.is_empty() {
+            String::from("native")
+        } else {
+            alloc::format!("{}:{}", f.file, line)
+        };
+        report.push_str(&alloc::format!("  {:3}.{}  {} in {}\n", s / 10, s % 10, at, f.label));
+    }
+    stdio::write(fd::STDERR, report.as_bytes());
+
+    for f in &prof.frames {
+        unsafe {
+            runtime::JS_FreeAtom(prof.ctx, f.name_atom);
+            runtime::JS_FreeAtom(prof.ctx, f.file_atom);
+        }
+    }
+}
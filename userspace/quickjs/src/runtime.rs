@@ -6,12 +6,14 @@
 #![allow(dead_code)]
 
 use alloc::alloc::{alloc, dealloc, realloc as rust_realloc, Layout};
+use alloc::boxed::Box;
 use alloc::string::String;
 use alloc::vec::Vec;
 use core::ffi::{c_char, c_int, c_void};
 use core::ptr;
+use core::sync::atomic::{AtomicBool, Ordering};
 
-use libakuma::{close, fstat, open, open_flags, read_fd};
+use libakuma::{close, fstat, open, open_flags, read_fd, write_fd, Stat};
 
 // Debug configuration
 const DEBUG: bool = false;
@@ -103,17 +105,73 @@ pub extern "C" fn akuma_uptime() -> u64 {
 /// Exit the process - called by C stubs
 #[no_mangle]
 pub extern "C" fn akuma_exit(code: c_int) {
-    libakuma::exit(code);
+    crate::stdio::exit(code);
 }
 
-/// Print to stdout - called by C stubs
+/// Print to stdout (buffered) - called by C stubs
 #[no_mangle]
 pub unsafe extern "C" fn akuma_print(s: *const c_char, len: usize) {
+    akuma_write(libakuma::fd::STDOUT as c_int, s, len);
+}
+
+/// Write to fd 1 (buffered) or 2 (unbuffered) - called by C stubs
+#[no_mangle]
+pub unsafe extern "C" fn akuma_write(fd: c_int, s: *const c_char, len: usize) {
     if s.is_null() {
         return;
     }
     let bytes = core::slice::from_raw_parts(s as *const u8, len);
-    libakuma::write(libakuma::fd::STDOUT, bytes);
+    crate::stdio::write(fd as u64, bytes);
+}
+
+/// Flush buffered stdout - called by C stubs' fflush
+#[no_mangle]
+pub extern "C" fn akuma_flush() {
+    crate::stdio::flush();
+}
+
+/// Futex wait for the C stubs' pthread mutexes and condition variables;
+/// `timeout_us < 0` waits forever. Returns 0 or `-ETIMEDOUT`.
+#[no_mangle]
+pub unsafe extern "C" fn akuma_futex_wait(word: *mut u32, expected: u32, timeout_us: i64) -> c_int {
+    let word = &*(word as *const core::sync::atomic::AtomicU32);
+    let timeout = if timeout_us < 0 { None } else { Some(timeout_us as u64) };
+    match libakuma::futex_wait(word, expected, timeout) {
+        -110 => -110,
+        _ => 0,
+    }
+}
+
+/// Futex wake - called by C stubs
+#[no_mangle]
+pub unsafe extern "C" fn akuma_futex_wake(word: *mut u32, count: c_int) {
+    libakuma::futex_wake(&*(word as *const core::sync::atomic::AtomicU32), count);
+}
+
+/// Stack for threads started by the C stubs' pthread_create (libbf's
+/// multiplication helpers)
+const C_THREAD_STACK: usize = 256 * 1024;
+
+/// Start `entry(arg)` on a new thread for the C stubs' pthread_create;
+/// returns a handle for `akuma_thread_join`, or null
+#[no_mangle]
+pub extern "C" fn akuma_thread_spawn(entry: extern "C" fn(usize), arg: usize) -> *mut c_void {
+    match libakuma::spawn_thread(C_THREAD_STACK, entry, arg) {
+        Ok(thread) => Box::into_raw(Box::new(thread)) as *mut c_void,
+        Err(_) => ptr::null_mut(),
+    }
+}
+
+/// Wait for a thread from `akuma_thread_spawn` and release it
+#[no_mangle]
+pub unsafe extern "C" fn akuma_thread_join(thread: *mut c_void) {
+    Box::from_raw(thread as *mut libakuma::Thread).join();
+}
+
+/// Calling thread's ID, for the C stubs' pthread_self
+#[no_mangle]
+pub extern "C" fn akuma_gettid() -> u64 {
+    libakuma::gettid() as u64
 }
 
 // ============================================================================
@@ -132,6 +190,67 @@ pub struct JSContext {
     _private: [u8; 0],
 }
 
+/// Opaque ES module record
+#[repr(C)]
+pub struct JSModuleDef {
+    _private: [u8; 0],
+}
+
+/// Allocator bookkeeping QuickJS passes to the JSMallocFunctions
+#[repr(C)]
+pub struct JSMallocState {
+    pub malloc_count: usize,
+    pub malloc_size: usize,
+    pub malloc_limit: usize,
+    pub opaque: *mut c_void,
+}
+
+/// Custom allocator table for JS_NewRuntime2
+#[repr(C)]
+pub struct JSMallocFunctions {
+    pub js_malloc: unsafe extern "C" fn(s: *mut JSMallocState, size: usize) -> *mut c_void,
+    pub js_free: unsafe extern "C" fn(s: *mut JSMallocState, ptr: *mut c_void),
+    pub js_realloc:
+        unsafe extern "C" fn(s: *mut JSMallocState, ptr: *mut c_void, size: usize) -> *mut c_void,
+    pub js_malloc_usable_size: unsafe extern "C" fn(ptr: *const c_void) -> usize,
+    pub js_malloc_charge: Option<unsafe extern "C" fn(ptr: *const c_void) -> usize>,
+}
+
+/// Heap statistics filled in by JS_ComputeMemoryUsage
+#[repr(C)]
+#[derive(Default)]
+pub struct JSMemoryUsage {
+    pub malloc_size: i64,
+    pub malloc_limit: i64,
+    pub memory_used_size: i64,
+    pub malloc_count: i64,
+    pub memory_used_count: i64,
+    pub atom_count: i64,
+    pub atom_size: i64,
+    pub str_count: i64,
+    pub str_size: i64,
+    pub obj_count: i64,
+    pub obj_size: i64,
+    pub prop_count: i64,
+    pub prop_size: i64,
+    pub shape_count: i64,
+    pub shape_size: i64,
+    pub js_func_count: i64,
+    pub js_func_size: i64,
+    pub js_func_code_size: i64,
+    pub js_func_pc2line_count: i64,
+    pub js_func_pc2line_size: i64,
+    pub c_func_count: i64,
+    pub array_count: i64,
+    pub fast_array_count: i64,
+    pub fast_array_elements: i64,
+    pub binary_object_count: i64,
+    pub binary_object_size: i64,
+    /// JS_RunGC calls and the microseconds spent in them
+    pub gc_count: i64,
+    pub gc_time: i64,
+}
+
 /// Reference count header - first field of all ref-counted objects
 #[repr(C)]
 pub struct JSRefCountHeader {
@@ -163,11 +282,30 @@ pub const JS_TAG_UNDEFINED: i64 = 3;
 pub const JS_TAG_EXCEPTION: i64 = 6;
 pub const JS_TAG_FLOAT64: i64 = 7;
 pub const JS_TAG_STRING: i64 = -7;
+pub const JS_TAG_MODULE: i64 = -3;
 pub const JS_TAG_OBJECT: i64 = -1;
 
 // JS_Eval flags
 pub const JS_EVAL_TYPE_GLOBAL: c_int = 0;
+pub const JS_EVAL_TYPE_MODULE: c_int = 1 << 0;
 pub const JS_EVAL_FLAG_STRICT: c_int = 1 << 3;
+pub const JS_EVAL_FLAG_COMPILE_ONLY: c_int = 1 << 5;
+
+// JS_WriteObject / JS_ReadObject flags
+pub const JS_WRITE_OBJ_BYTECODE: c_int = 1 << 0;
+pub const JS_WRITE_OBJ_SAB: c_int = 1 << 2;
+pub const JS_WRITE_OBJ_REFERENCE: c_int = 1 << 3;
+pub const JS_READ_OBJ_BYTECODE: c_int = 1 << 0;
+pub const JS_READ_OBJ_SAB: c_int = 1 << 2;
+pub const JS_READ_OBJ_REFERENCE: c_int = 1 << 3;
+pub const JS_READ_OBJ_TRANSFER: c_int = 1 << 4;
+
+// JS_DefineProperty flags
+pub const JS_PROP_CONFIGURABLE: c_int = 1 << 0;
+pub const JS_PROP_WRITABLE: c_int = 1 << 1;
+
+// JS_PromiseState results
+pub const JS_PROMISE_REJECTED: c_int = 2;
 
 impl JSValue {
     /// Create undefined value
@@ -178,6 +316,42 @@ impl JSValue {
         }
     }
 
+    pub fn null() -> Self {
+        JSValue {
+            u: JSValueUnion { int32: 0 },
+            tag: JS_TAG_NULL,
+        }
+    }
+
+    pub fn int32(v: i32) -> Self {
+        JSValue {
+            u: JSValueUnion { int32: v },
+            tag: JS_TAG_INT,
+        }
+    }
+
+    pub fn float64(v: f64) -> Self {
+        JSValue {
+            u: JSValueUnion { float64: v },
+            tag: JS_TAG_FLOAT64,
+        }
+    }
+
+    pub fn bool(v: bool) -> Self {
+        JSValue {
+            u: JSValueUnion { int32: v as i32 },
+            tag: JS_TAG_BOOL,
+        }
+    }
+
+    /// The exception marker a native function returns after throwing
+    pub fn exception() -> Self {
+        JSValue {
+            u: JSValueUnion { int32: 0 },
+            tag: JS_TAG_EXCEPTION,
+        }
+    }
+
     /// Check if this is an exception
     pub fn is_exception(&self) -> bool {
         self.tag == JS_TAG_EXCEPTION
@@ -196,11 +370,16 @@ impl JSValue {
 extern "C" {
     // Runtime management
     pub fn JS_NewRuntime() -> *mut JSRuntime;
+    pub fn JS_NewRuntime2(mf: *const JSMallocFunctions, opaque: *mut c_void) -> *mut JSRuntime;
     pub fn JS_FreeRuntime(rt: *mut JSRuntime);
     pub fn JS_SetMaxStackSize(rt: *mut JSRuntime, stack_size: usize);
+    pub fn JS_SetMemoryLimit(rt: *mut JSRuntime, limit: usize);
+    pub fn JS_SetGCThreshold(rt: *mut JSRuntime, gc_threshold: usize);
+    pub fn JS_ComputeMemoryUsage(rt: *mut JSRuntime, s: *mut JSMemoryUsage);
 
     // Context management
     pub fn JS_NewContext(rt: *mut JSRuntime) -> *mut JSContext;
+    pub fn JS_NewContextRaw(rt: *mut JSRuntime) -> *mut JSContext;
     pub fn JS_FreeContext(ctx: *mut JSContext);
 
     // Intrinsics
@@ -216,6 +395,7 @@ extern "C" {
     pub fn JS_AddIntrinsicTypedArrays(ctx: *mut JSContext);
     pub fn JS_AddIntrinsicPromise(ctx: *mut JSContext);
     pub fn JS_AddIntrinsicBigInt(ctx: *mut JSContext);
+    pub fn JS_AddLazyIntrinsics(ctx: *mut JSContext);
 
     // Evaluation
     pub fn JS_Eval(
@@ -226,6 +406,30 @@ extern "C" {
         eval_flags: c_int,
     ) -> JSValue;
 
+    // Bytecode serialization
+    pub fn JS_WriteObject(
+        ctx: *mut JSContext,
+        psize: *mut usize,
+        obj: JSValue,
+        flags: c_int,
+    ) -> *mut u8;
+    pub fn JS_ReadObject(ctx: *mut JSContext, buf: *const u8, buf_len: usize, flags: c_int) -> JSValue;
+    pub fn JS_EvalFunction(ctx: *mut JSContext, fun_obj: JSValue) -> JSValue;
+    pub fn js_malloc(ctx: *mut JSContext, size: usize) -> *mut c_void;
+    pub fn js_free(ctx: *mut JSContext, ptr: *mut c_void);
+
+    // ES modules
+    pub fn JS_DetectModule(input: *const c_char, input_len: usize) -> c_int;
+    pub fn JS_SetModuleLoaderFunc(
+        rt: *mut JSRuntime,
+        module_normalize: Option<unsafe extern "C" fn(*mut JSContext, *const c_char, *const c_char, *mut c_void) -> *mut c_char>,
+        module_loader: Option<unsafe extern "C" fn(*mut JSContext, *const c_char, *mut c_void) -> *mut JSModuleDef>,
+        opaque: *mut c_void,
+    );
+    pub fn JS_ResolveModule(ctx: *mut JSContext, obj: JSValue) -> c_int;
+    pub fn JS_PromiseState(ctx: *mut JSContext, promise: JSValue) -> c_int;
+    pub fn JS_PromiseResult(ctx: *mut JSContext, promise: JSValue) -> JSValue;
+
     // Value management - use internal names since the public ones are static inline
     #[link_name = "__JS_FreeValue"]
     pub fn JS_FreeValue(ctx: *mut JSContext, v: JSValue);
@@ -235,6 +439,34 @@ extern "C" {
 
     pub fn JS_DupValue(ctx: *mut JSContext, v: JSValue) -> JSValue;
 
+    // Promises and the job queue
+    pub fn JS_NewPromiseCapability(ctx: *mut JSContext, resolving_funcs: *mut JSValue) -> JSValue;
+    pub fn JS_ExecutePendingJob(rt: *mut JSRuntime, pctx: *mut *mut JSContext) -> c_int;
+    pub fn JS_SetHostPromiseRejectionTracker(
+        rt: *mut JSRuntime,
+        cb: Option<unsafe extern "C" fn(*mut JSContext, JSValue, JSValue, c_int, *mut c_void)>,
+        opaque: *mut c_void,
+    );
+    pub fn JS_Call(
+        ctx: *mut JSContext,
+        func_obj: JSValue,
+        this_obj: JSValue,
+        argc: c_int,
+        argv: *mut JSValue,
+    ) -> JSValue;
+    pub fn JS_IsFunction(ctx: *mut JSContext, val: JSValue) -> c_int;
+    pub fn JS_NewError(ctx: *mut JSContext) -> JSValue;
+    pub fn JS_ToInt32(ctx: *mut JSContext, pres: *mut i32, val: JSValue) -> c_int;
+    pub fn JS_ToFloat64(ctx: *mut JSContext, pres: *mut f64, val: JSValue) -> c_int;
+    pub fn JS_GetArrayBuffer(ctx: *mut JSContext, psize: *mut usize, obj: JSValue) -> *mut u8;
+    pub fn JS_GetTypedArrayBuffer(
+        ctx: *mut JSContext,
+        obj: JSValue,
+        pbyte_offset: *mut usize,
+        pbyte_length: *mut usize,
+        pbytes_per_element: *mut usize,
+    ) -> JSValue;
+
     // String conversion
     pub fn JS_ToCStringLen2(
         ctx: *mut JSContext,
@@ -275,15 +507,252 @@ extern "C" {
 
     // New object
     pub fn JS_NewObject(ctx: *mut JSContext) -> JSValue;
+
+    // ArrayBuffers over memory owned elsewhere; `free_func` runs when the
+    // buffer is collected
+    pub fn JS_NewArrayBuffer(
+        ctx: *mut JSContext,
+        buf: *mut u8,
+        len: usize,
+        free_func: Option<unsafe extern "C" fn(*mut JSRuntime, *mut c_void, *mut c_void)>,
+        opaque: *mut c_void,
+        is_shared: c_int,
+    ) -> JSValue;
+    pub fn JS_NewArrayBufferCopy(ctx: *mut JSContext, buf: *const u8, len: usize) -> JSValue;
+
+    // Errors and conversions
+    pub fn JS_ThrowTypeError(ctx: *mut JSContext, fmt: *const c_char, ...) -> JSValue;
+    pub fn JS_ThrowSyntaxError(ctx: *mut JSContext, fmt: *const c_char, ...) -> JSValue;
+    pub fn JS_ThrowReferenceError(ctx: *mut JSContext, fmt: *const c_char, ...) -> JSValue;
+    pub fn JS_ToBool(ctx: *mut JSContext, val: JSValue) -> c_int;
+
+    // Per-runtime and per-context state
+    pub fn JS_GetRuntime(ctx: *mut JSContext) -> *mut JSRuntime;
+    pub fn JS_GetRuntimeOpaque(rt: *mut JSRuntime) -> *mut c_void;
+    pub fn JS_SetRuntimeOpaque(rt: *mut JSRuntime, opaque: *mut c_void);
+    pub fn JS_GetContextOpaque(ctx: *mut JSContext) -> *mut c_void;
+    pub fn JS_SetContextOpaque(ctx: *mut JSContext, opaque: *mut c_void);
+    pub fn JS_SetCanBlock(rt: *mut JSRuntime, can_block: c_int);
+    pub fn JS_SetInterruptHandler(
+        rt: *mut JSRuntime,
+        cb: Option<unsafe extern "C" fn(*mut JSRuntime, *mut c_void) -> c_int>,
+        opaque: *mut c_void,
+    );
+    pub fn JS_SetInterruptInterval(rt: *mut JSRuntime, interval: c_int);
+
+    // Stack sampling for the profiler; atoms are borrowed from the functions
+    pub fn JS_GetStackFrames(ctx: *mut JSContext, frames: *mut JSStackFrameInfo, max_frames: c_int) -> c_int;
+    pub fn JS_DupAtom(ctx: *mut JSContext, atom: JSAtom) -> JSAtom;
+    pub fn JS_FreeAtom(ctx: *mut JSContext, atom: JSAtom);
+    pub fn JS_AtomToCString(ctx: *mut JSContext, atom: JSAtom) -> *const c_char;
+
+    // Native classes
+    pub fn JS_NewClassID(pclass_id: *mut u32) -> u32;
+    pub fn JS_NewClass(rt: *mut JSRuntime, class_id: u32, class_def: *const JSClassDef) -> c_int;
+    pub fn JS_NewObjectClass(ctx: *mut JSContext, class_id: c_int) -> JSValue;
+    pub fn JS_SetClassProto(ctx: *mut JSContext, class_id: u32, obj: JSValue);
+    pub fn JS_SetConstructor(ctx: *mut JSContext, func_obj: JSValue, proto: JSValue);
+    pub fn JS_SetOpaque(obj: JSValue, opaque: *mut c_void);
+    pub fn JS_GetOpaque(obj: JSValue, class_id: u32) -> *mut c_void;
+    pub fn JS_GetOpaque2(ctx: *mut JSContext, obj: JSValue, class_id: u32) -> *mut c_void;
+
+    // Property reads
+    pub fn JS_GetPropertyStr(ctx: *mut JSContext, this_obj: JSValue, prop: *const c_char) -> JSValue;
+    pub fn JS_GetPropertyUint32(ctx: *mut JSContext, this_obj: JSValue, idx: u32) -> JSValue;
+
+    // Arrays, JSON and symbol-keyed properties for the stdin iterators
+    pub fn JS_NewArray(ctx: *mut JSContext) -> JSValue;
+    pub fn JS_SetPropertyUint32(ctx: *mut JSContext, this_obj: JSValue, idx: u32, val: JSValue) -> c_int;
+    pub fn JS_ParseJSON(ctx: *mut JSContext, buf: *const c_char, buf_len: usize, filename: *const c_char) -> JSValue;
+    pub fn JS_ValueToAtom(ctx: *mut JSContext, val: JSValue) -> JSAtom;
+    pub fn JS_DefinePropertyValue(ctx: *mut JSContext, this_obj: JSValue, prop: JSAtom, val: JSValue, flags: c_int)
+        -> c_int;
+
+    // Structured clone for Worker messages: SharedArrayBuffers are shared
+    // and transferred ArrayBuffers moved, both by pointer
+    pub fn JS_WriteObjectTransfer(
+        ctx: *mut JSContext,
+        psize: *mut usize,
+        obj: JSValue,
+        flags: c_int,
+        psab_tab: *mut *mut *mut u8,
+        psab_tab_len: *mut usize,
+        transfer: *mut JSValue,
+        transfer_len: c_int,
+    ) -> *mut u8;
+    pub fn JS_SetSharedArrayBufferFunctions(rt: *mut JSRuntime, sf: *const JSSharedArrayBufferFunctions);
+}
+
+/// Interned string or symbol; 0 is JS_ATOM_NULL
+pub type JSAtom = u32;
+pub const JS_ATOM_NULL: JSAtom = 0;
+
+/// One frame from JS_GetStackFrames
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct JSStackFrameInfo {
+    /// JS_ATOM_NULL if anonymous
+    pub func_name: JSAtom,
+    /// JS_ATOM_NULL for native functions
+    pub filename: JSAtom,
+    /// Line of the definition, -1 if unknown
+    pub func_line_num: c_int,
+    /// Current line, -1 if unknown
+    pub line_num: c_int,
 }
 
 // JS_CFUNC_GENERIC constant
 pub const JS_CFUNC_GENERIC: c_int = 0;
+pub const JS_CFUNC_CONSTRUCTOR: c_int = 2;
+
+/// Native class description for JS_NewClass
+#[repr(C)]
+pub struct JSClassDef {
+    pub class_name: *const c_char,
+    pub finalizer: Option<unsafe extern "C" fn(*mut JSRuntime, JSValue)>,
+    pub gc_mark: *const c_void,
+    pub call: *const c_void,
+    pub exotic: *const c_void,
+}
+
+// Class definitions are immutable statics, only read by JS_NewClass
+unsafe impl Sync for JSClassDef {}
+
+/// Allocator hooks for SharedArrayBuffer memory, which outlives any one
+/// runtime once shared with a Worker
+#[repr(C)]
+pub struct JSSharedArrayBufferFunctions {
+    pub sab_alloc: Option<unsafe extern "C" fn(*mut c_void, usize) -> *mut c_void>,
+    pub sab_free: Option<unsafe extern "C" fn(*mut c_void, *mut c_void)>,
+    pub sab_dup: Option<unsafe extern "C" fn(*mut c_void, *mut c_void)>,
+    pub sab_opaque: *mut c_void,
+}
+
+// The table is immutable and its functions must be thread-safe
+unsafe impl Sync for JSSharedArrayBufferFunctions {}
+
+/// Whether `val` points at a ref-counted header
+fn has_ref_count(val: JSValue) -> bool {
+    // JS_TAG_FIRST = -11, values with tag >= JS_TAG_FIRST (as unsigned) have ref counts
+    // This means negative tags (objects, strings, etc.) need freeing
+    // Positive tags (int, bool, null, undefined, float64) don't need freeing
+    const JS_TAG_FIRST: i64 = -11;
+    (val.tag as u64) >= (JS_TAG_FIRST as u64) && unsafe { !val.u.ptr.is_null() }
+}
+
+/// `JS_FreeValue`: drop one reference, freeing the value at zero
+pub fn free_value(ctx: *mut JSContext, val: JSValue) {
+    if has_ref_count(val) {
+        unsafe {
+            let ptr = val.u.ptr as *mut JSRefCountHeader;
+            (*ptr).ref_count -= 1;
+            if (*ptr).ref_count <= 0 {
+                JS_FreeValue(ctx, val);
+            }
+        }
+    }
+}
+
+/// `JS_DupValue`: take another reference
+pub fn dup_value(val: JSValue) -> JSValue {
+    if has_ref_count(val) {
+        unsafe { (*(val.u.ptr as *mut JSRefCountHeader)).ref_count += 1 };
+    }
+    val
+}
+
+/// The bytes of an ArrayBuffer or TypedArray argument, read in place. The
+/// slice is only valid until the next call into JS. Throws and returns
+/// `None` for anything else.
+pub unsafe fn buffer_bytes<'a>(ctx: *mut JSContext, val: JSValue) -> Option<&'a [u8]> {
+    let mut size = 0;
+    let ptr = JS_GetArrayBuffer(ctx, &mut size, val);
+    if !ptr.is_null() {
+        return Some(core::slice::from_raw_parts(ptr, size));
+    }
+    free_value(ctx, JS_GetException(ctx));
+    let (mut offset, mut len) = (0, 0);
+    let buf = JS_GetTypedArrayBuffer(ctx, val, &mut offset, &mut len, core::ptr::null_mut());
+    if buf.is_exception() {
+        free_value(ctx, JS_GetException(ctx));
+        JS_ThrowTypeError(ctx, c"ArrayBuffer or TypedArray expected".as_ptr());
+        return None;
+    }
+    // The view keeps the buffer alive
+    let ptr = JS_GetArrayBuffer(ctx, &mut size, buf);
+    free_value(ctx, buf);
+    if ptr.is_null() {
+        return None;
+    }
+    Some(core::slice::from_raw_parts(ptr.add(offset), len))
+}
 
 // ============================================================================
 // Runtime Wrapper
 // ============================================================================
 
+/// JS_Eval flags for `Runtime::compile`
+pub fn compile_flags(module: bool) -> c_int {
+    let ty = if module { JS_EVAL_TYPE_MODULE } else { JS_EVAL_TYPE_GLOBAL };
+    ty | JS_EVAL_FLAG_COMPILE_ONLY
+}
+
+/// Build contexts with every intrinsic instantiated up front
+/// (`--eager-intrinsics`) instead of deferring the big, rarely used ones.
+static EAGER_INTRINSICS: AtomicBool = AtomicBool::new(false);
+
+pub fn set_eager_intrinsics(eager: bool) {
+    EAGER_INTRINSICS.store(eager, Ordering::Relaxed);
+}
+
+/// New context with the intrinsics every script needs added eagerly
+/// (objects, functions, errors, eval, RegExp, JSON, Promise, BigInt) and
+/// Date, Proxy, Map/Set and the typed arrays defined as lazy globals that
+/// are built on first use. Most scripts never touch the typed arrays, which
+/// alone are about a third of `JS_NewContext`'s time.
+unsafe fn new_context(rt: *mut JSRuntime) -> *mut JSContext {
+    if EAGER_INTRINSICS.load(Ordering::Relaxed) {
+        return JS_NewContext(rt);
+    }
+    let ctx = JS_NewContextRaw(rt);
+    if ctx.is_null() {
+        return ctx;
+    }
+    JS_AddIntrinsicBaseObjects(ctx);
+    JS_AddIntrinsicEval(ctx);
+    JS_AddIntrinsicStringNormalize(ctx);
+    JS_AddIntrinsicRegExp(ctx);
+    JS_AddIntrinsicJSON(ctx);
+    JS_AddIntrinsicPromise(ctx);
+    JS_AddIntrinsicBigInt(ctx);
+    JS_AddLazyIntrinsics(ctx);
+    ctx
+}
+
+/// Heap and stack limits for a new runtime (`--memory-limit`,
+/// `--gc-threshold`, `--stack-size` and their `QJS_*` variables)
+#[derive(Clone, Copy)]
+pub struct Limits {
+    /// Bytes the engine may allocate before throwing out-of-memory; 0 for
+    /// no limit
+    pub memory_limit: usize,
+    /// Allocated bytes that trigger a GC, kept as a floor as the heap grows;
+    /// `None` for QuickJS's default (256 KB, then 1.5x the live heap)
+    pub gc_threshold: Option<usize>,
+    /// JS stack depth in bytes before "stack overflow"; 0 for no check
+    pub stack_size: usize,
+}
+
+impl Default for Limits {
+    fn default() -> Self {
+        Limits {
+            memory_limit: 0,
+            gc_threshold: None,
+            stack_size: 256 * 1024,
+        }
+    }
+}
+
 /// QuickJS Runtime wrapper
 pub struct Runtime {
     rt: *mut JSRuntime,
@@ -292,27 +761,34 @@ pub struct Runtime {
 
 impl Runtime {
     /// Create a new QuickJS runtime with a context
-    pub fn new() -> Option<Self> {
+    pub fn new(limits: &Limits) -> Option<Self> {
         unsafe {
-            debug("qjs: JS_NewRuntime\n");
-            let rt = JS_NewRuntime();
+            debug("qjs: JS_NewRuntime2\n");
+            // QuickJS's own allocations go through the size-class slab in slab.rs
+            crate::slab::runtime_created();
+            let rt = JS_NewRuntime2(&crate::slab::MALLOC_FUNCTIONS, ptr::null_mut());
             if rt.is_null() {
-                debug("qjs: JS_NewRuntime returned NULL\n");
+                debug("qjs: JS_NewRuntime2 returned NULL\n");
+                crate::slab::runtime_freed();
                 return None;
             }
-            debug("qjs: JS_NewRuntime OK\n");
+            debug("qjs: JS_NewRuntime2 OK\n");
 
-            // Set a reasonable stack size
-            JS_SetMaxStackSize(rt, 256 * 1024);
-            debug("qjs: JS_SetMaxStackSize OK\n");
+            JS_SetMaxStackSize(rt, limits.stack_size);
+            if limits.memory_limit != 0 {
+                JS_SetMemoryLimit(rt, limits.memory_limit);
+            }
+            if let Some(threshold) = limits.gc_threshold {
+                JS_SetGCThreshold(rt, threshold);
+            }
+            debug("qjs: limits set\n");
 
             debug("qjs: JS_NewContext\n");
-            // JS_NewContext internally calls JS_NewContextRaw + all JS_AddIntrinsic* functions
-            // So we don't need to add intrinsics manually
-            let ctx = JS_NewContext(rt);
+            let ctx = new_context(rt);
             if ctx.is_null() {
                 debug("qjs: JS_NewContext returned NULL\n");
                 JS_FreeRuntime(rt);
+                crate::slab::runtime_freed();
                 return None;
             }
             debug("qjs: JS_NewContext OK\n");
@@ -326,44 +802,139 @@ impl Runtime {
         self.ctx
     }
 
+    /// Current heap statistics, including GC cycles and time
+    pub fn memory_usage(&self) -> JSMemoryUsage {
+        let mut usage = JSMemoryUsage::default();
+        unsafe { JS_ComputeMemoryUsage(self.rt, &mut usage) };
+        usage
+    }
+
     /// Evaluate JavaScript code
     pub fn eval(&self, code: &str, filename: &str) -> Result<JSValue, String> {
-        unsafe {
-            debug("qjs: eval() enter\n");
-            
-            // Create null-terminated code string
-            let mut code_buf = alloc::vec![0u8; code.len() + 1];
-            code_buf[..code.len()].copy_from_slice(code.as_bytes());
-            
-            // Create null-terminated filename
-            let mut filename_buf = alloc::vec![0u8; filename.len() + 1];
-            filename_buf[..filename.len()].copy_from_slice(filename.as_bytes());
-
-            debug("qjs: calling JS_Eval\n");
-            let result = JS_Eval(
-                self.ctx,
-                code_buf.as_ptr() as *const c_char,
-                code.len(),
-                filename_buf.as_ptr() as *const c_char,
-                JS_EVAL_TYPE_GLOBAL,
-            );
-            debug("qjs: JS_Eval returned\n");
+        self.eval_flags(code, filename, JS_EVAL_TYPE_GLOBAL)
+    }
 
-            if result.is_exception() {
-                debug("qjs: got exception\n");
-                // Get the exception
+    /// Compile a script (or, with `module`, an ES module and the modules
+    /// it imports) without running it; returns the function or module
+    /// object for `write_bytecode` / `eval_function`
+    pub fn compile(&self, code: &str, filename: &str, module: bool) -> Result<JSValue, String> {
+        self.eval_flags(code, filename, compile_flags(module))
+    }
+
+    /// `compile` for source whose bytes are followed in memory by a NUL, as
+    /// JS_Eval requires, without copying it (e.g. a file mapping)
+    ///
+    /// # Safety
+    /// `code.as_ptr().add(code.len())` must be readable and hold 0.
+    pub unsafe fn compile_terminated(&self, code: &str, filename: &str, module: bool) -> Result<JSValue, String> {
+        self.eval_raw(code.as_ptr(), code.len(), filename, compile_flags(module))
+    }
+
+    fn eval_flags(&self, code: &str, filename: &str, flags: c_int) -> Result<JSValue, String> {
+        debug("qjs: eval() enter\n");
+
+        // Create null-terminated code string
+        let mut code_buf = alloc::vec![0u8; code.len() + 1];
+        code_buf[..code.len()].copy_from_slice(code.as_bytes());
+
+        unsafe { self.eval_raw(code_buf.as_ptr(), code.len(), filename, flags) }
+    }
+
+    /// JS_Eval over `len` bytes at `code`, which must be followed by a NUL
+    unsafe fn eval_raw(&self, code: *const u8, len: usize, filename: &str, flags: c_int) -> Result<JSValue, String> {
+        // Create null-terminated filename
+        let mut filename_buf = alloc::vec![0u8; filename.len() + 1];
+        filename_buf[..filename.len()].copy_from_slice(filename.as_bytes());
+
+        debug("qjs: calling JS_Eval\n");
+        let result = JS_Eval(
+            self.ctx,
+            code as *const c_char,
+            len,
+            filename_buf.as_ptr() as *const c_char,
+            flags,
+        );
+        debug("qjs: JS_Eval returned\n");
+
+        if result.is_exception() {
+            debug("qjs: got exception\n");
+            return Err(self.take_exception());
+        }
+
+        debug("qjs: eval success\n");
+        Ok(result)
+    }
+
+    /// Serialize a compiled function (from `compile`) to bytecode
+    pub fn write_bytecode(&self, fun: JSValue) -> Option<Vec<u8>> {
+        unsafe {
+            let mut size: usize = 0;
+            let buf = JS_WriteObject(self.ctx, &mut size, fun, JS_WRITE_OBJ_BYTECODE);
+            if buf.is_null() {
+                // Clear the pending exception (out of memory)
                 let exc = JS_GetException(self.ctx);
-                let err_str = self.value_to_string(exc);
-                JS_FreeValue(self.ctx, exc);
-                return Err(err_str);
+                free_value(self.ctx, exc);
+                return None;
+            }
+            let bytes = core::slice::from_raw_parts(buf, size).to_vec();
+            js_free(self.ctx, buf as *mut c_void);
+            Some(bytes)
+        }
+    }
+
+    /// Load bytecode written by `write_bytecode`; returns the function object.
+    /// Fails (without running anything) on bytecode from another QuickJS build.
+    pub fn read_bytecode(&self, bytecode: &[u8]) -> Result<JSValue, String> {
+        unsafe {
+            let fun = JS_ReadObject(self.ctx, bytecode.as_ptr(), bytecode.len(), JS_READ_OBJ_BYTECODE);
+            if fun.is_exception() {
+                return Err(self.take_exception());
             }
+            Ok(fun)
+        }
+    }
 
-            debug("qjs: eval success\n");
+    /// Run a function or module object from `compile` or `read_bytecode`
+    /// (consumes it). A module evaluates to a promise; one already rejected
+    /// (by a throw outside any top-level `await`) is returned as the error.
+    pub fn eval_function(&self, fun: JSValue) -> Result<JSValue, String> {
+        unsafe {
+            let module = fun.get_tag() == JS_TAG_MODULE;
+            // A module read back from bytecode loads its imports here
+            if module && JS_ResolveModule(self.ctx, fun) < 0 {
+                free_value(self.ctx, fun);
+                return Err(self.take_exception());
+            }
+            let result = JS_EvalFunction(self.ctx, fun);
+            if result.is_exception() {
+                return Err(self.take_exception());
+            }
+            if module && JS_PromiseState(self.ctx, result) == JS_PROMISE_REJECTED {
+                let reason = JS_PromiseResult(self.ctx, result);
+                let msg = self.value_to_string(reason);
+                free_value(self.ctx, reason);
+                free_value(self.ctx, result);
+                return Err(msg);
+            }
             Ok(result)
         }
     }
 
-    /// Convert a JSValue to a Rust String
+    /// Fetch and clear the pending exception as a string
+    pub fn take_exception(&self) -> String {
+        unsafe {
+            let exc = JS_GetException(self.ctx);
+            let err_str = self.value_to_string(exc);
+            free_value(self.ctx, exc);
+            err_str
+        }
+    }
+
+    /// The underlying JSRuntime
+    pub fn runtime(&self) -> *mut JSRuntime {
+        self.rt
+    }
+
     pub fn value_to_string(&self, val: JSValue) -> String {
         unsafe {
             let mut len: usize = 0;
@@ -389,24 +960,7 @@ impl Runtime {
     /// 2. Decrements ref count
     /// 3. Only calls __JS_FreeValue if ref count reaches 0
     pub fn free_value(&self, val: JSValue) {
-        // JS_TAG_FIRST = -11, values with tag >= JS_TAG_FIRST (as unsigned) have ref counts
-        // This means negative tags (objects, strings, etc.) need freeing
-        // Positive tags (int, bool, null, undefined, float64) don't need freeing
-        const JS_TAG_FIRST: i64 = -11;
-        if (val.tag as u64) >= (JS_TAG_FIRST as u64) {
-            unsafe {
-                // Get the pointer to the object header (contains ref count)
-                let ptr = val.u.ptr as *mut JSRefCountHeader;
-                if !ptr.is_null() {
-                    // Decrement ref count
-                    (*ptr).ref_count -= 1;
-                    // Only free if ref count reached 0
-                    if (*ptr).ref_count <= 0 {
-                        JS_FreeValue(self.ctx, val);
-                    }
-                }
-            }
-        }
+        free_value(self.ctx, val);
     }
 
     /// Get the global object
@@ -452,6 +1006,7 @@ impl Drop for Runtime {
             JS_FreeContext(self.ctx);
             debug("qjs: JS_FreeRuntime\n");
             JS_FreeRuntime(self.rt);
+            crate::slab::runtime_freed();
             debug("qjs: Runtime dropped\n");
         }
     }
@@ -463,6 +1018,12 @@ impl Drop for Runtime {
 
 /// Read a file into a String
 pub fn read_file(path: &str) -> Result<String, &'static str> {
+    let (content, _) = read_file_bytes(path)?;
+    source_from_bytes(content)
+}
+
+/// Read a whole file, returning its contents and `fstat` result
+pub fn read_file_bytes(path: &str) -> Result<(Vec<u8>, Stat), &'static str> {
     let fd = open(path, open_flags::O_RDONLY);
     if fd < 0 {
         return Err("Failed to open file");
@@ -476,8 +1037,17 @@ pub fn read_file(path: &str) -> Result<String, &'static str> {
         }
     };
 
-    let size = stat.st_size as usize;
-    let mut content: Vec<u8> = alloc::vec![0u8; size];
+    let content = read_open_file(fd, stat.st_size as usize);
+    close(fd);
+
+    Ok((content, stat))
+}
+
+/// Read up to `size` bytes from the start of an open file. One spare byte
+/// of capacity is reserved so callers can NUL-terminate without regrowing.
+pub fn read_open_file(fd: i32, size: usize) -> Vec<u8> {
+    let mut content: Vec<u8> = Vec::with_capacity(size + 1);
+    content.resize(size, 0);
 
     let mut total_read = 0;
     while total_read < size {
@@ -488,17 +1058,14 @@ pub fn read_file(path: &str) -> Result<String, &'static str> {
         total_read += n as usize;
     }
 
-    close(fd);
-
-    let s = match String::from_utf8(content) {
-        Ok(s) => s,
-        Err(_) => return Err("File is not valid UTF-8"),
-    };
+    content.truncate(total_read);
+    content
+}
 
-    // We want to ignore shebang and associated comments if they are present
-    // at the beginning of the file (lines starting with #)
+/// Script source within file contents: leading `#` lines (a shebang and
+/// its comments) are skipped and the rest must be UTF-8
+pub fn script_source(bytes: &[u8]) -> Result<&str, &'static str> {
     let mut start_index = 0;
-    let bytes = s.as_bytes();
     while start_index < bytes.len() && bytes[start_index] == b'#' {
         // Skip until end of line
         while start_index < bytes.len() && bytes[start_index] != b'\n' {
@@ -510,9 +1077,29 @@ pub fn read_file(path: &str) -> Result<String, &'static str> {
         }
     }
 
-    if start_index > 0 {
-        Ok(String::from(&s[start_index..]))
-    } else {
-        Ok(s)
+    core::str::from_utf8(&bytes[start_index..]).map_err(|_| "File is not valid UTF-8")
+}
+
+/// Script source from file contents, with any leading `#` lines dropped
+pub fn source_from_bytes(content: Vec<u8>) -> Result<String, &'static str> {
+    script_source(&content).map(String::from)
+}
+
+/// Write `data` to `path`, replacing any existing file
+pub fn write_file(path: &str, data: &[u8]) -> Result<(), &'static str> {
+    let fd = open(path, open_flags::O_WRONLY | open_flags::O_CREAT | open_flags::O_TRUNC);
+    if fd < 0 {
+        return Err("Failed to create file");
     }
+    let mut written = 0;
+    while written < data.len() {
+        let n = write_fd(fd, &data[written..]);
+        if n <= 0 {
+            close(fd);
+            return Err("Failed to write file");
+        }
+        written += n as usize;
+    }
+    close(fd);
+    Ok(())
 }
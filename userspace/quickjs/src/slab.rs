@@ -0,0 +1,400 @@
+//! Size-class slab allocator for the QuickJS heap
+//!
+//! QuickJS allocates huge numbers of small objects (shapes, atoms, property
+//! and JSValue arrays, mostly 16-256 bytes). Sending each one through the
+//! header-prefixed `malloc` in `runtime.rs` costs an 8-byte header, a rebuilt
+//! `Layout` and a trip through the global allocator, and `realloc` always
+//! copies. Here small requests are rounded up to one of a few size classes
+//! and served from per-class free lists carved out of 64 KB chunks; anything
+//! larger than `MAX_SMALL` still takes the `malloc` path.
+//!
+//! Chunks come from 4 MB arenas mapped straight from the kernel (demand-paged,
+//! so an arena only costs the chunks actually carved from it). A pointer's
+//! size class is found from its arena's chunk table, so small objects carry
+//! no header, `js_malloc_usable_size` reports the real class size (letting
+//! QuickJS grow strings and arrays in place), and a `realloc` that still fits
+//! the class returns the same pointer. When the last runtime is freed every
+//! arena is unmapped in one go.
+//!
+//! Plugged in through `JS_NewRuntime2`; `--no-slab` sends everything down
+//! the `malloc` path for A/B measurements.
+
+use core::ffi::c_void;
+use core::ptr;
+
+use libakuma::mmap_flags::{MAP_ANONYMOUS, MAP_PRIVATE, PROT_READ, PROT_WRITE};
+use libakuma::Spinlock;
+
+use crate::runtime::{free, malloc, realloc, JSMallocFunctions, JSMallocState};
+
+/// Size of one kernel mapping.
+const ARENA_SIZE: usize = 4 << 20;
+/// Unit handed to a size class.
+const CHUNK_SIZE: usize = 64 << 10;
+const CHUNK_SHIFT: u32 = 16;
+const CHUNKS_PER_ARENA: usize = ARENA_SIZE / CHUNK_SIZE;
+/// Past this many arenas (256 MB of small objects) requests fall back to malloc.
+const MAX_ARENAS: usize = 64;
+
+/// Largest request served from a size class.
+const MAX_SMALL: usize = 2048;
+
+/// Class sizes: 16-byte steps up to 128, then four classes per doubling.
+const CLASS_SIZES: [usize; 24] = [
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896,
+    1024, 1280, 1536, 1792, 2048,
+];
+const NUM_CLASSES: usize = CLASS_SIZES.len();
+/// `chunks[i]` value for a chunk not yet given to a class.
+const NO_CLASS: u8 = u8::MAX;
+
+/// Size class for each 16-byte granule count `(size + 15) / 16`, 0..=128.
+const CLASS_OF_GRANULE: [u8; MAX_SMALL / 16 + 1] = {
+    let mut table = [0u8; MAX_SMALL / 16 + 1];
+    let mut g = 0;
+    let mut c = 0;
+    while g < table.len() {
+        while CLASS_SIZES[c] < g * 16 {
+            c += 1;
+        }
+        table[g] = c as u8;
+        g += 1;
+    }
+    table
+};
+
+/// Header in front of `malloc`-path blocks (`runtime::malloc` stores the size
+/// there).
+const LARGE_HEADER: usize = 8;
+
+#[derive(Clone, Copy)]
+struct Arena {
+    base: usize,
+    /// Chunks carved so far; chunks are handed out in address order.
+    used: usize,
+    /// Size class of each carved chunk.
+    chunks: [u8; CHUNKS_PER_ARENA],
+}
+
+#[derive(Clone, Copy)]
+struct Class {
+    /// Intrusive free list: each free object's first word links the next.
+    free: usize,
+    /// Bump range in the class's newest chunk.
+    next: usize,
+    end: usize,
+}
+
+/// Allocation counters, readable with [`stats`].
+#[derive(Clone, Copy, Default)]
+pub struct Stats {
+    /// Requests served from a size class / by the malloc path.
+    pub slab_allocs: usize,
+    pub large_allocs: usize,
+    pub frees: usize,
+    /// `realloc` calls that kept their pointer because the class still fit.
+    pub in_place_reallocs: usize,
+    /// Bytes handed out (usable sizes), now and at the high-water mark.
+    pub live_bytes: usize,
+    pub peak_live_bytes: usize,
+    /// Chunks carved from arenas: the slab's worst-case resident footprint.
+    pub peak_chunk_bytes: usize,
+    /// Whether the slab is in use at all (off under `--no-slab`).
+    pub enabled: bool,
+}
+
+struct Heap {
+    arenas: [Arena; MAX_ARENAS],
+    num_arenas: usize,
+    classes: [Class; NUM_CLASSES],
+    /// Live runtimes; the arenas go away with the last one.
+    runtimes: usize,
+    stats: Stats,
+}
+
+static HEAP: Spinlock<Heap> = Spinlock::new(Heap {
+    arenas: [Arena { base: 0, used: 0, chunks: [NO_CLASS; CHUNKS_PER_ARENA] }; MAX_ARENAS],
+    num_arenas: 0,
+    classes: [Class { free: 0, next: 0, end: 0 }; NUM_CLASSES],
+    runtimes: 0,
+    stats: Stats {
+        slab_allocs: 0,
+        large_allocs: 0,
+        frees: 0,
+        in_place_reallocs: 0,
+        live_bytes: 0,
+        peak_live_bytes: 0,
+        peak_chunk_bytes: 0,
+        enabled: true,
+    },
+});
+
+impl Heap {
+    /// Size class holding `ptr`, or None for a malloc-path block.
+    fn class_of(&self, ptr: usize) -> Option<usize> {
+        for arena in self.arenas[..self.num_arenas].iter().rev() {
+            let off = ptr.wrapping_sub(arena.base);
+            if off < ARENA_SIZE {
+                return Some(arena.chunks[off >> CHUNK_SHIFT] as usize);
+            }
+        }
+        None
+    }
+
+    /// Give a fresh chunk to class `c`; false when out of arenas or memory.
+    fn refill(&mut self, c: usize) -> bool {
+        if self.num_arenas == 0 || self.arenas[self.num_arenas - 1].used == CHUNKS_PER_ARENA {
+            if self.num_arenas == MAX_ARENAS {
+                return false;
+            }
+            let base = libakuma::mmap(0, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS);
+            if base == usize::MAX || base == 0 {
+                return false;
+            }
+            self.arenas[self.num_arenas] =
+                Arena { base, used: 0, chunks: [NO_CLASS; CHUNKS_PER_ARENA] };
+            self.num_arenas += 1;
+        }
+        let arena = &mut self.arenas[self.num_arenas - 1];
+        let chunk = arena.base + arena.used * CHUNK_SIZE;
+        arena.chunks[arena.used] = c as u8;
+        arena.used += 1;
+
+        let class = &mut self.classes[c];
+        class.next = chunk;
+        // Objects never straddle the chunk end, so a class size that does not
+        // divide 64 KB leaves a small tail unused.
+        class.end = chunk + CHUNK_SIZE / CLASS_SIZES[c] * CLASS_SIZES[c];
+
+        let carved = self.arenas[..self.num_arenas].iter().map(|a| a.used).sum::<usize>();
+        self.stats.peak_chunk_bytes = self.stats.peak_chunk_bytes.max(carved * CHUNK_SIZE);
+        true
+    }
+
+    unsafe fn alloc_small(&mut self, c: usize) -> *mut c_void {
+        let class = &mut self.classes[c];
+        if class.free != 0 {
+            let obj = class.free;
+            class.free = *(obj as *const usize);
+            return obj as *mut c_void;
+        }
+        if class.next == class.end && !self.refill(c) {
+            return ptr::null_mut();
+        }
+        let class = &mut self.classes[c];
+        let obj = class.next;
+        class.next += CLASS_SIZES[c];
+        obj as *mut c_void
+    }
+
+    unsafe fn alloc(&mut self, size: usize) -> *mut c_void {
+        if self.stats.enabled && size <= MAX_SMALL {
+            let c = CLASS_OF_GRANULE[(size + 15) >> 4] as usize;
+            let p = self.alloc_small(c);
+            if !p.is_null() {
+                self.stats.slab_allocs += 1;
+                self.account_alloc(CLASS_SIZES[c]);
+                return p;
+            }
+        }
+        let p = malloc(size);
+        if !p.is_null() {
+            self.stats.large_allocs += 1;
+            self.account_alloc(size);
+        }
+        p
+    }
+
+    unsafe fn free(&mut self, ptr: *mut c_void) {
+        self.stats.frees += 1;
+        self.release_block(ptr);
+    }
+
+    unsafe fn release_block(&mut self, ptr: *mut c_void) {
+        match self.class_of(ptr as usize) {
+            Some(c) => {
+                let class = &mut self.classes[c];
+                *(ptr as *mut usize) = class.free;
+                class.free = ptr as usize;
+                self.stats.live_bytes -= CLASS_SIZES[c];
+            }
+            None => {
+                self.stats.live_bytes -= large_size(ptr);
+                free(ptr);
+            }
+        }
+    }
+
+    unsafe fn realloc(&mut self, ptr: *mut c_void, size: usize) -> *mut c_void {
+        let (old_size, large) = match self.class_of(ptr as usize) {
+            Some(c) => (CLASS_SIZES[c], false),
+            None => (large_size(ptr), true),
+        };
+        if !large && size <= old_size {
+            self.stats.in_place_reallocs += 1;
+            return ptr;
+        }
+        if large && (size > MAX_SMALL || !self.stats.enabled) {
+            let p = realloc(ptr, size);
+            if !p.is_null() {
+                self.stats.live_bytes = self.stats.live_bytes - old_size + size;
+                self.stats.peak_live_bytes = self.stats.peak_live_bytes.max(self.stats.live_bytes);
+            }
+            return p;
+        }
+        let p = self.alloc(size);
+        if !p.is_null() {
+            ptr::copy_nonoverlapping(ptr as *const u8, p as *mut u8, old_size.min(size));
+            self.release_block(ptr);
+        }
+        p
+    }
+
+    fn account_alloc(&mut self, size: usize) {
+        self.stats.live_bytes += size;
+        self.stats.peak_live_bytes = self.stats.peak_live_bytes.max(self.stats.live_bytes);
+    }
+
+    fn usable_size(&self, ptr: *const c_void) -> usize {
+        match self.class_of(ptr as usize) {
+            Some(c) => CLASS_SIZES[c],
+            None => unsafe { large_size(ptr) },
+        }
+    }
+
+    /// Unmap every arena. Only with no runtime left holding slab memory.
+    fn release_arenas(&mut self) {
+        for arena in &self.arenas[..self.num_arenas] {
+            libakuma::munmap(arena.base, ARENA_SIZE);
+        }
+        self.num_arenas = 0;
+        self.classes = [Class { free: 0, next: 0, end: 0 }; NUM_CLASSES];
+    }
+}
+
+/// Size of a malloc-path block, from the header `runtime::malloc` wrote.
+unsafe fn large_size(ptr: *const c_void) -> usize {
+    *((ptr as *const u8).sub(LARGE_HEADER) as *const usize)
+}
+
+/// Bytes QuickJS charges against its memory limit and GC threshold for a
+/// block of `usable` bytes.
+fn charged(heap: &Heap, ptr: *const c_void, usable: usize) -> usize {
+    if heap.class_of(ptr as usize).is_some() {
+        usable
+    } else {
+        usable + LARGE_HEADER
+    }
+}
+
+// ============================================================================
+// JSMallocFunctions
+// ============================================================================
+
+unsafe extern "C" fn js_slab_malloc(s: *mut JSMallocState, size: usize) -> *mut c_void {
+    let s = &mut *s;
+    if s.malloc_size + size > s.malloc_limit {
+        return ptr::null_mut();
+    }
+    let mut heap = HEAP.lock();
+    let p = heap.alloc(size);
+    if !p.is_null() {
+        s.malloc_count += 1;
+        s.malloc_size += charged(&heap, p, heap.usable_size(p));
+    }
+    p
+}
+
+unsafe extern "C" fn js_slab_free(s: *mut JSMallocState, ptr: *mut c_void) {
+    if ptr.is_null() {
+        return;
+    }
+    let s = &mut *s;
+    let mut heap = HEAP.lock();
+    s.malloc_count -= 1;
+    s.malloc_size -= charged(&heap, ptr, heap.usable_size(ptr));
+    heap.free(ptr);
+}
+
+unsafe extern "C" fn js_slab_realloc(
+    s: *mut JSMallocState,
+    ptr: *mut c_void,
+    size: usize,
+) -> *mut c_void {
+    if ptr.is_null() {
+        if size == 0 {
+            return ptr::null_mut();
+        }
+        return js_slab_malloc(s, size);
+    }
+    if size == 0 {
+        js_slab_free(s, ptr);
+        return ptr::null_mut();
+    }
+    let s = &mut *s;
+    let mut heap = HEAP.lock();
+    let old = charged(&heap, ptr, heap.usable_size(ptr));
+    if (s.malloc_size + size).saturating_sub(old) > s.malloc_limit {
+        return ptr::null_mut();
+    }
+    let p = heap.realloc(ptr, size);
+    if !p.is_null() {
+        s.malloc_size = s.malloc_size - old + charged(&heap, p, heap.usable_size(p));
+    }
+    p
+}
+
+unsafe extern "C" fn js_slab_malloc_usable_size(ptr: *const c_void) -> usize {
+    if ptr.is_null() {
+        return 0;
+    }
+    HEAP.lock().usable_size(ptr)
+}
+
+/// What `js_slab_malloc` charged for `ptr`, so a transferred ArrayBuffer
+/// moves between runtimes at its exact cost.
+unsafe extern "C" fn js_slab_malloc_charge(ptr: *const c_void) -> usize {
+    let heap = HEAP.lock();
+    charged(&heap, ptr, heap.usable_size(ptr))
+}
+
+/// The allocator table for `JS_NewRuntime2`.
+pub static MALLOC_FUNCTIONS: JSMallocFunctions = JSMallocFunctions {
+    js_malloc: js_slab_malloc,
+    js_free: js_slab_free,
+    js_realloc: js_slab_realloc,
+    js_malloc_usable_size: js_slab_malloc_usable_size,
+    js_malloc_charge: Some(js_slab_malloc_charge),
+};
+
+/// Route every allocation through malloc (`--no-slab`). Call before the
+/// first runtime is created.
+pub fn disable() {
+    HEAP.lock().stats.enabled = false;
+}
+
+/// A runtime using [`MALLOC_FUNCTIONS`] is about to be created.
+pub fn runtime_created() {
+    HEAP.lock().runtimes += 1;
+}
+
+/// A runtime using [`MALLOC_FUNCTIONS`] has been freed by `JS_FreeRuntime`;
+/// once none is left, hand every arena back to the kernel.
+pub fn runtime_freed() {
+    let mut heap = HEAP.lock();
+    heap.runtimes -= 1;
+    if heap.runtimes == 0 {
+        heap.release_arenas();
+    }
+}
+
+/// Restart the high-water mark from the bytes live now.
+pub fn reset_peak() {
+    let mut heap = HEAP.lock();
+    heap.stats.peak_live_bytes = heap.stats.live_bytes;
+}
+
+/// Snapshot of the allocation counters.
+pub fn stats() -> Stats {
+    HEAP.lock().stats
+}
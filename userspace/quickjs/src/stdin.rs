@@ -0,0 +1,343 @@
+//! Streaming stdin for qjs pipelines
+//!
+//! `readStdin()` returns all of stdin up to EOF as one string, which for
+//! `cat big.json | qjs filter.js` means the whole input and then the parsed
+//! tree in memory at once. Everything else here reads 64 KB at a time and
+//! keeps only the unconsumed part, so a line or record filter runs in
+//! memory bounded by its longest line or record:
+//!
+//! - `readStdin(n)` / `Akuma.stdin.read(n)`: up to `n` bytes as a string,
+//!   `""` at EOF. A UTF-8 sequence split by the limit is held back for the
+//!   next call.
+//! - `Akuma.stdin.readLine()`: the next line without its `\n` (or `\r\n`),
+//!   `null` at EOF.
+//! - `Akuma.stdin.chunks([n])`, `lines()` and `json([{ elements }])`:
+//!   iterators over the same, usable with both `for...of` and
+//!   `for await...of`. `json()` runs the [`json_stream`](crate::json_stream)
+//!   splitter over the raw bytes, so NDJSON, concatenated documents and
+//!   (with `elements`) one big top-level array all come out a value at a
+//!   time.
+//!
+//! Reads block the thread, as `readStdin()` always has; stdin is usually a
+//! pipe that the script has nothing better to do than wait for. All of
+//! these share one buffer, so they can be mixed (read a header line, then
+//! stream the records).
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::ffi::{c_char, c_int, c_void, CStr};
+use core::ops::Range;
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use libakuma::{fd, read, Spinlock};
+
+use crate::json_stream::{self, Splitter};
+use crate::runtime::{self, JSClassDef, JSContext, JSRuntime, JSValue, Runtime};
+use crate::stdio;
+
+/// Bytes asked of each `read` from stdin
+const STDIN_CHUNK: usize = 64 * 1024;
+
+/// Unconsumed stdin: `buf[start..]`
+struct Stdin {
+    buf: Vec<u8>,
+    start: usize,
+    /// How far from `start` a line search has already looked for `\n`
+    scanned: usize,
+    eof: bool,
+}
+
+static STDIN: Spinlock<Stdin> = Spinlock::new(Stdin { buf: Vec::new(), start: 0, scanned: 0, eof: false });
+
+impl Stdin {
+    fn pending(&self) -> &[u8] {
+        &self.buf[self.start..]
+    }
+
+    /// Read one more chunk onto the buffer, dropping consumed bytes first;
+    /// false at EOF
+    fn fill(&mut self) -> bool {
+        if self.eof {
+            return false;
+        }
+        if self.start > 0 {
+            self.buf.drain(..self.start);
+            self.start = 0;
+        }
+        // Show any pending prompt before blocking on input
+        stdio::flush();
+        let old = self.buf.len();
+        self.buf.resize(old + STDIN_CHUNK, 0);
+        let n = read(fd::STDIN, &mut self.buf[old..]);
+        self.buf.truncate(old + n.max(0) as usize);
+        if n <= 0 {
+            self.eof = true;
+        }
+        n > 0
+    }
+
+    /// Consume `len` bytes, returning their range in `buf`
+    fn consume(&mut self, len: usize) -> Range<usize> {
+        let r = self.start..self.start + len;
+        self.start += len;
+        self.scanned = 0;
+        r
+    }
+
+    /// Up to `max` bytes, cut before a UTF-8 sequence the limit or the end
+    /// of the data read so far would split; `None` at EOF
+    fn chunk(&mut self, max: usize) -> Option<Range<usize>> {
+        loop {
+            let avail = self.pending().len();
+            if avail == 0 && !self.fill() {
+                return None;
+            }
+            let p = self.pending();
+            let avail = p.len();
+            let mut len = avail.min(max);
+            if !(self.eof && len == avail) {
+                len = utf8_boundary(&p[..len]);
+            }
+            // Only part of one character so far, or `max` too small for it
+            if len == 0 {
+                if avail < max && self.fill() {
+                    continue;
+                }
+                len = avail.min(max);
+            }
+            return Some(self.consume(len));
+        }
+    }
+
+    /// The next line without its terminator; `None` at EOF
+    fn line(&mut self) -> Option<Range<usize>> {
+        loop {
+            let p = self.pending();
+            if let Some(i) = p[self.scanned..].iter().position(|&b| b == b'\n') {
+                let end = self.scanned + i;
+                let r = self.consume(end + 1);
+                let mut line = r.start..r.end - 1;
+                if line.end > line.start && self.buf[line.end - 1] == b'\r' {
+                    line.end -= 1;
+                }
+                return Some(line);
+            }
+            self.scanned = p.len();
+            if !self.fill() {
+                let rest = self.pending().len();
+                return if rest > 0 { Some(self.consume(rest)) } else { None };
+            }
+        }
+    }
+
+    /// Everything up to EOF
+    fn all(&mut self) -> Range<usize> {
+        while self.fill() {}
+        let rest = self.pending().len();
+        self.consume(rest)
+    }
+}
+
+/// The length of the longest prefix of `b` that does not end inside a
+/// UTF-8 sequence
+fn utf8_boundary(b: &[u8]) -> usize {
+    // Look back at most 3 bytes for the lead byte of the last sequence
+    for back in 1..=b.len().min(4) {
+        let c = b[b.len() - back];
+        if c & 0xc0 == 0x80 {
+            continue;
+        }
+        let need = match c {
+            0x00..=0x7f => 1,
+            0xc0..=0xdf => 2,
+            0xe0..=0xef => 3,
+            _ => 4,
+        };
+        return if back >= need { b.len() } else { b.len() - back };
+    }
+    b.len()
+}
+
+unsafe fn new_string(ctx: *mut JSContext, bytes: &[u8]) -> JSValue {
+    runtime::JS_NewStringLen(ctx, bytes.as_ptr() as *const c_char, bytes.len())
+}
+
+/// `readStdin([n])`: all of stdin, or up to `n` bytes of it, as a string;
+/// `""` at EOF
+pub unsafe extern "C" fn js_read_stdin(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 || (*argv).get_tag() == runtime::JS_TAG_UNDEFINED {
+        let mut stdin = STDIN.lock();
+        let r = stdin.all();
+        return new_string(ctx, &stdin.buf[r]);
+    }
+    let mut n = 0;
+    if runtime::JS_ToInt32(ctx, &mut n, *argv) < 0 {
+        return JSValue::exception();
+    }
+    let mut stdin = STDIN.lock();
+    match stdin.chunk(n.max(1) as usize) {
+        Some(r) => new_string(ctx, &stdin.buf[r]),
+        None => new_string(ctx, b""),
+    }
+}
+
+/// `Akuma.stdin.readLine()`
+unsafe extern "C" fn js_read_line(ctx: *mut JSContext, _this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    let mut stdin = STDIN.lock();
+    match stdin.line() {
+        Some(r) => new_string(ctx, &stdin.buf[r]),
+        None => JSValue::null(),
+    }
+}
+
+// ============================================================================
+// Iterators
+// ============================================================================
+
+/// Class ID of the `chunks`/`lines`/`json` iterators, shared by every
+/// runtime
+static ITER_CLASS: AtomicU32 = AtomicU32::new(0);
+
+enum Iter {
+    Chunks(usize),
+    Lines,
+    Json(Splitter),
+}
+
+/// The next value of `it`; `None` when done. Throws and returns
+/// `Some(exception)` on a JSON error.
+unsafe fn iter_next(ctx: *mut JSContext, it: &mut Iter) -> Option<JSValue> {
+    match it {
+        Iter::Chunks(max) => {
+            let mut stdin = STDIN.lock();
+            stdin.chunk(*max).map(|r| new_string(ctx, &stdin.buf[r]))
+        }
+        Iter::Lines => {
+            let mut stdin = STDIN.lock();
+            stdin.line().map(|r| new_string(ctx, &stdin.buf[r]))
+        }
+        Iter::Json(sp) => loop {
+            let eof = {
+                let stdin = STDIN.lock();
+                stdin.eof && stdin.pending().is_empty()
+            };
+            match sp.next(eof) {
+                Ok(Some(r)) => return Some(sp.parse(ctx, r)),
+                Ok(None) if eof => return None,
+                Ok(None) => {}
+                Err(e) => return Some(json_stream::throw(ctx, e)),
+            }
+            let mut stdin = STDIN.lock();
+            if stdin.pending().is_empty() {
+                stdin.fill();
+            }
+            let rest = stdin.pending().len();
+            let r = stdin.consume(rest);
+            sp.feed(&stdin.buf[r]);
+        },
+    }
+}
+
+/// `iterator.next()`: `{ value, done }`. Returned as a plain object rather
+/// than a Promise; `for await` awaits it all the same.
+unsafe extern "C" fn js_iter_next(ctx: *mut JSContext, this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    let it = runtime::JS_GetOpaque2(ctx, this, ITER_CLASS.load(Ordering::Relaxed)) as *mut Iter;
+    let it = match it.as_mut() {
+        Some(it) => it,
+        None => return JSValue::exception(),
+    };
+    let (value, done) = match iter_next(ctx, it) {
+        Some(v) if v.is_exception() => return v,
+        Some(v) => (v, false),
+        None => (JSValue::undefined(), true),
+    };
+    let result = runtime::JS_NewObject(ctx);
+    runtime::JS_SetPropertyStr(ctx, result, c"value".as_ptr(), value);
+    runtime::JS_SetPropertyStr(ctx, result, c"done".as_ptr(), JSValue::bool(done));
+    result
+}
+
+/// `iterator[Symbol.iterator]()` and `[Symbol.asyncIterator]()`
+unsafe extern "C" fn js_iter_self(_ctx: *mut JSContext, this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    runtime::dup_value(this)
+}
+
+unsafe fn new_iter(ctx: *mut JSContext, it: Iter) -> JSValue {
+    let obj = runtime::JS_NewObjectClass(ctx, ITER_CLASS.load(Ordering::Relaxed) as c_int);
+    if obj.is_exception() {
+        return obj;
+    }
+    runtime::JS_SetOpaque(obj, Box::into_raw(Box::new(it)) as *mut c_void);
+    obj
+}
+
+/// `Akuma.stdin.chunks([n])`: strings of up to `n` (64 KB) bytes
+unsafe extern "C" fn js_chunks(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let mut n = STDIN_CHUNK as i32;
+    if argc > 0 && (*argv).get_tag() != runtime::JS_TAG_UNDEFINED && runtime::JS_ToInt32(ctx, &mut n, *argv) < 0 {
+        return JSValue::exception();
+    }
+    new_iter(ctx, Iter::Chunks(n.max(1) as usize))
+}
+
+/// `Akuma.stdin.lines()`
+unsafe extern "C" fn js_lines(ctx: *mut JSContext, _this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    new_iter(ctx, Iter::Lines)
+}
+
+/// `Akuma.stdin.json([{ elements }])`: parsed top-level values
+unsafe extern "C" fn js_json(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    match json_stream::option_bool(ctx, argc, argv, "elements") {
+        Some(elements) => new_iter(ctx, Iter::Json(Splitter::new(elements))),
+        None => JSValue::exception(),
+    }
+}
+
+unsafe extern "C" fn iter_finalizer(_rt: *mut JSRuntime, val: JSValue) {
+    let it = runtime::JS_GetOpaque(val, ITER_CLASS.load(Ordering::Relaxed)) as *mut Iter;
+    if !it.is_null() {
+        drop(Box::from_raw(it));
+    }
+}
+
+static ITER_CLASS_DEF: JSClassDef = JSClassDef {
+    class_name: c"StdinIterator".as_ptr(),
+    finalizer: Some(iter_finalizer),
+    gc_mark: core::ptr::null(),
+    call: core::ptr::null(),
+    exotic: core::ptr::null(),
+};
+
+/// Define `obj[Symbol[name]]` as `val`
+unsafe fn define_symbol_property(ctx: *mut JSContext, global: JSValue, obj: JSValue, name: &CStr, val: JSValue) {
+    let symbol_ctor = runtime::JS_GetPropertyStr(ctx, global, c"Symbol".as_ptr());
+    let symbol = runtime::JS_GetPropertyStr(ctx, symbol_ctor, name.as_ptr());
+    let atom = runtime::JS_ValueToAtom(ctx, symbol);
+    runtime::JS_DefinePropertyValue(ctx, obj, atom, val, runtime::JS_PROP_CONFIGURABLE | runtime::JS_PROP_WRITABLE);
+    runtime::JS_FreeAtom(ctx, atom);
+    runtime::free_value(ctx, symbol);
+    runtime::free_value(ctx, symbol_ctor);
+}
+
+/// Register the iterator class on `rt` and install `Akuma.stdin`
+pub fn setup(rt: &Runtime, global: JSValue, akuma: JSValue) {
+    unsafe {
+        let ctx = rt.context();
+        let class_id = runtime::JS_NewClassID(ITER_CLASS.as_ptr());
+        runtime::JS_NewClass(rt.runtime(), class_id, &ITER_CLASS_DEF);
+        let proto = runtime::JS_NewObject(ctx);
+        rt.set_property_str(proto, "next", rt.new_c_function(js_iter_next, "next", 0));
+        for (symbol, name) in [(c"iterator", "[Symbol.iterator]"), (c"asyncIterator", "[Symbol.asyncIterator]")] {
+            define_symbol_property(ctx, global, proto, symbol, rt.new_c_function(js_iter_self, name, 0));
+        }
+        runtime::JS_SetClassProto(ctx, class_id, proto);
+
+        let stdin = runtime::JS_NewObject(ctx);
+        rt.set_property_str(stdin, "read", rt.new_c_function(js_read_stdin, "read", 1));
+        rt.set_property_str(stdin, "readLine", rt.new_c_function(js_read_line, "readLine", 0));
+        rt.set_property_str(stdin, "chunks", rt.new_c_function(js_chunks, "chunks", 1));
+        rt.set_property_str(stdin, "lines", rt.new_c_function(js_lines, "lines", 0));
+        rt.set_property_str(stdin, "json", rt.new_c_function(js_json, "json", 1));
+        rt.set_property_str(akuma, "stdin", stdin);
+    }
+}
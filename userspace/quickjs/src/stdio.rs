@@ -0,0 +1,106 @@
+//! Buffered standard output for qjs
+//!
+//! `console.log`, `print` and the C stubs' printf/fwrite family all funnel
+//! through here instead of issuing one `write` syscall per fragment. stdout is
+//! line-buffered on a terminal and fully buffered otherwise (pipes, SSH
+//! channels, files); stderr stays unbuffered but flushes stdout first, so the
+//! two streams interleave in program order.
+
+use libakuma::{fd, Spinlock};
+
+/// Buffer size for a non-terminal stdout.
+const BUF_SIZE: usize = 64 * 1024;
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum Mode {
+    /// Every write goes straight to the fd (`--no-buffer`).
+    Unbuffered,
+    /// Flush whenever a newline is written (stdout is a terminal).
+    Line,
+    /// Flush only when the buffer fills, on `fflush` and at exit.
+    Full,
+}
+
+struct Stdout {
+    mode: Mode,
+    len: usize,
+    buf: [u8; BUF_SIZE],
+}
+
+static STDOUT: Spinlock<Stdout> = Spinlock::new(Stdout {
+    mode: Mode::Full,
+    len: 0,
+    buf: [0; BUF_SIZE],
+});
+
+/// Pick the stdout buffering mode. Call once, before any output.
+pub fn init(no_buffer: bool) {
+    let mode = if no_buffer {
+        Mode::Unbuffered
+    } else if libakuma::isatty(fd::STDOUT as i32) {
+        Mode::Line
+    } else {
+        Mode::Full
+    };
+    STDOUT.lock().mode = mode;
+}
+
+/// Write all of `bytes` to `fd`, retrying short writes; gives up on error.
+fn write_all(fd: u64, mut bytes: &[u8]) {
+    while !bytes.is_empty() {
+        let n = libakuma::write(fd, bytes);
+        if n <= 0 {
+            return;
+        }
+        bytes = &bytes[n as usize..];
+    }
+}
+
+impl Stdout {
+    fn flush(&mut self) {
+        write_all(fd::STDOUT, &self.buf[..self.len]);
+        self.len = 0;
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        if self.mode == Mode::Unbuffered {
+            write_all(fd::STDOUT, bytes);
+            return;
+        }
+        if bytes.len() > BUF_SIZE - self.len {
+            self.flush();
+            if bytes.len() >= BUF_SIZE {
+                write_all(fd::STDOUT, bytes);
+                return;
+            }
+        }
+        self.buf[self.len..self.len + bytes.len()].copy_from_slice(bytes);
+        self.len += bytes.len();
+        if self.mode == Mode::Line && bytes.contains(&b'\n') {
+            self.flush();
+        }
+    }
+}
+
+/// Write to stdout (buffered) or any other fd (unbuffered, after flushing
+/// stdout).
+pub fn write(fd: u64, bytes: &[u8]) {
+    let mut out = STDOUT.lock();
+    if fd == fd::STDOUT {
+        out.write(bytes);
+    } else {
+        out.flush();
+        write_all(fd, bytes);
+    }
+}
+
+/// Push any buffered stdout to the fd.
+pub fn flush() {
+    STDOUT.lock().flush();
+}
+
+/// Flush stdout and terminate the process, Worker threads included.
+pub fn exit(code: i32) -> ! {
+    flush();
+    libakuma::exit_group(code)
+}
@@ -0,0 +1,714 @@
+//! Workers: scripts running on their own thread and JSRuntime
+//!
+//! `new Worker(path)` starts a thread (kernel `clone` with a shared address
+//! space) that creates a fresh runtime with the same limits, loads `path`
+//! like the main script and then runs its own event loop. The two sides
+//! share nothing but SharedArrayBuffers and talk through `postMessage` and
+//! `onmessage`.
+//!
+//! A message is a structured clone (`JS_WriteObjectTransfer`) copied into a
+//! heap buffer and handed over through a lock-free single-producer,
+//! single-consumer ring per direction; the receiver's eventfd in its epoll
+//! set wakes it. When a ring is full the sender keeps the messages in a
+//! backlog and the receiver signals back once it has drained the ring.
+//! ArrayBuffers in the transfer list move by pointer and are detached on
+//! the sending side, so large payloads cross without a copy.
+//!
+//! `terminate()` is cooperative: the Worker's loop stops at its next step,
+//! and running JS is interrupted at the engine's next interrupt check.
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::ffi::{c_int, c_void};
+use core::sync::atomic::{fence, AtomicBool, AtomicPtr, AtomicU32, AtomicUsize, Ordering};
+
+use libakuma::eventfd_flags::{EFD_CLOEXEC, EFD_NONBLOCK};
+use libakuma::{Spinlock, Thread};
+
+use crate::event_loop::{self, Source};
+use crate::runtime::{self, JSClassDef, JSContext, JSRuntime, JSSharedArrayBufferFunctions, JSValue, Limits, Runtime};
+use crate::{print_error, LoadOptions};
+
+/// Messages a ring holds before the sender falls back to its backlog
+const RING_SIZE: usize = 256;
+/// Stack for a Worker thread; `--stack-size` must stay below it for the
+/// engine's stack check to throw before the thread runs off its stack.
+const WORKER_STACK: usize = 1024 * 1024;
+
+/// Limits and loading options Workers inherit from the command line
+struct Config {
+    limits: Limits,
+    cache_dir: Option<String>,
+}
+
+static CONFIG: Spinlock<Option<Config>> = Spinlock::new(None);
+
+/// Class ID of `Worker` objects, shared by every runtime
+static WORKER_CLASS: AtomicU32 = AtomicU32::new(0);
+
+/// Remember what new Workers start with. Call before the main script runs.
+pub fn configure(limits: &Limits, cache_dir: Option<&str>) {
+    *CONFIG.lock() = Some(Config { limits: *limits, cache_dir: cache_dir.map(String::from) });
+}
+
+// ============================================================================
+// SharedArrayBuffer memory
+// ============================================================================
+
+/// Size and reference count in front of each SharedArrayBuffer's data, so
+/// it lives until the last runtime holding it lets go
+#[repr(C)]
+struct SabHeader {
+    size: usize,
+    refs: AtomicUsize,
+}
+
+const SAB_HEADER: usize = 16;
+
+fn sab_layout(size: usize) -> core::alloc::Layout {
+    core::alloc::Layout::from_size_align(size + SAB_HEADER, SAB_HEADER).unwrap()
+}
+
+unsafe fn sab_header(ptr: *mut c_void) -> *mut SabHeader {
+    (ptr as *mut u8).sub(SAB_HEADER) as *mut SabHeader
+}
+
+unsafe extern "C" fn sab_alloc(_opaque: *mut c_void, size: usize) -> *mut c_void {
+    let base = alloc::alloc::alloc_zeroed(sab_layout(size));
+    if base.is_null() {
+        return core::ptr::null_mut();
+    }
+    (base as *mut SabHeader).write(SabHeader { size, refs: AtomicUsize::new(1) });
+    base.add(SAB_HEADER) as *mut c_void
+}
+
+unsafe extern "C" fn sab_free(_opaque: *mut c_void, ptr: *mut c_void) {
+    let header = sab_header(ptr);
+    if (*header).refs.fetch_sub(1, Ordering::AcqRel) == 1 {
+        alloc::alloc::dealloc(header as *mut u8, sab_layout((*header).size));
+    }
+}
+
+unsafe extern "C" fn sab_dup(_opaque: *mut c_void, ptr: *mut c_void) {
+    (*sab_header(ptr)).refs.fetch_add(1, Ordering::Relaxed);
+}
+
+static SAB_FUNCTIONS: JSSharedArrayBufferFunctions = JSSharedArrayBufferFunctions {
+    sab_alloc: Some(sab_alloc),
+    sab_free: Some(sab_free),
+    sab_dup: Some(sab_dup),
+    sab_opaque: core::ptr::null_mut(),
+};
+
+// ============================================================================
+// Channels
+// ============================================================================
+
+/// A serialized message in flight
+struct Message {
+    data: Vec<u8>,
+    /// SharedArrayBuffers it references, each holding a reference until the
+    /// message is read
+    sabs: Vec<usize>,
+}
+
+impl Drop for Message {
+    fn drop(&mut self) {
+        for &sab in &self.sabs {
+            unsafe { sab_free(core::ptr::null_mut(), sab as *mut c_void) };
+        }
+    }
+}
+
+/// Single-producer, single-consumer ring of messages. `tail` is only
+/// written by the sender and `head` only by the receiver; the release
+/// store of each publishes the slots it covers to the other side.
+struct Ring {
+    slots: [AtomicPtr<Message>; RING_SIZE],
+    head: AtomicUsize,
+    tail: AtomicUsize,
+}
+
+impl Ring {
+    fn new() -> Self {
+        Ring {
+            slots: core::array::from_fn(|_| AtomicPtr::new(core::ptr::null_mut())),
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+        }
+    }
+
+    /// Producer side; gives the message back when the ring is full
+    fn push(&self, msg: Box<Message>) -> Result<(), Box<Message>> {
+        let tail = self.tail.load(Ordering::Relaxed);
+        if tail.wrapping_sub(self.head.load(Ordering::Acquire)) == RING_SIZE {
+            return Err(msg);
+        }
+        self.slots[tail % RING_SIZE].store(Box::into_raw(msg), Ordering::Relaxed);
+        self.tail.store(tail.wrapping_add(1), Ordering::Release);
+        Ok(())
+    }
+
+    /// Consumer side
+    fn pop(&self) -> Option<Box<Message>> {
+        let head = self.head.load(Ordering::Relaxed);
+        if head == self.tail.load(Ordering::Acquire) {
+            return None;
+        }
+        let msg = self.slots[head % RING_SIZE].load(Ordering::Relaxed);
+        self.head.store(head.wrapping_add(1), Ordering::Release);
+        Some(unsafe { Box::from_raw(msg) })
+    }
+
+    fn is_empty(&self) -> bool {
+        self.head.load(Ordering::Acquire) == self.tail.load(Ordering::Acquire)
+    }
+}
+
+/// One direction of a channel
+struct Queue {
+    ring: Ring,
+    /// Messages the ring had no room for; only touched by the sender
+    backlog: Spinlock<Vec<Box<Message>>>,
+    /// The sender has a backlog and wants a signal once the ring drains
+    blocked: AtomicBool,
+    /// Eventfds of the receiving and the sending side
+    receiver_efd: i32,
+    sender_efd: i32,
+}
+
+fn signal(efd: i32) {
+    libakuma::write(efd as u64, &1u64.to_ne_bytes());
+}
+
+/// Clear an eventfd's counter
+fn consume(efd: i32) {
+    let mut buf = [0u8; 8];
+    libakuma::read_fd(efd, &mut buf);
+}
+
+impl Queue {
+    fn new(receiver_efd: i32, sender_efd: i32) -> Self {
+        Queue {
+            ring: Ring::new(),
+            backlog: Spinlock::new(Vec::new()),
+            blocked: AtomicBool::new(false),
+            receiver_efd,
+            sender_efd,
+        }
+    }
+
+    /// Move backlogged messages into the ring, oldest first, while it has
+    /// room; returns whether a backlog remains
+    fn flush(&self) -> bool {
+        let mut backlog = self.backlog.lock();
+        let mut moved = 0;
+        let mut pending = core::mem::take(&mut *backlog).into_iter();
+        while let Some(msg) = pending.next() {
+            let msg = match self.ring.push(msg) {
+                Ok(()) => {
+                    moved += 1;
+                    continue;
+                }
+                Err(msg) => msg,
+            };
+            // Ask for a wakeup, then look again: the receiver may have
+            // emptied the ring before it could see the request
+            self.blocked.store(true, Ordering::Relaxed);
+            fence(Ordering::SeqCst);
+            if let Err(msg) = self.ring.push(msg) {
+                backlog.push(msg);
+                break;
+            }
+            moved += 1;
+        }
+        backlog.extend(pending);
+        if moved > 0 {
+            signal(self.receiver_efd);
+        }
+        !backlog.is_empty()
+    }
+
+    fn send(&self, msg: Box<Message>) {
+        self.backlog.lock().push(msg);
+        self.flush();
+    }
+
+    fn has_backlog(&self) -> bool {
+        !self.backlog.lock().is_empty()
+    }
+
+    /// Receiver side: the next message, waking a blocked sender once the
+    /// ring is empty
+    fn recv(&self) -> Option<Box<Message>> {
+        let msg = self.ring.pop();
+        if msg.is_none() {
+            fence(Ordering::SeqCst);
+            if self.blocked.swap(false, Ordering::Relaxed) {
+                signal(self.sender_efd);
+            }
+        }
+        msg
+    }
+}
+
+/// Both directions between a Worker and the thread that created it
+struct Channel {
+    to_worker: Queue,
+    to_parent: Queue,
+    parent_efd: i32,
+    worker_efd: i32,
+    /// `terminate()` was called
+    terminated: AtomicBool,
+    /// The Worker called `close()`
+    closed: AtomicBool,
+    /// The Worker thread has freed its runtime and is about to exit
+    done: AtomicBool,
+}
+
+impl Channel {
+    fn new() -> Option<Self> {
+        let flags = EFD_NONBLOCK | EFD_CLOEXEC;
+        let parent_efd = libakuma::eventfd(0, flags);
+        let worker_efd = libakuma::eventfd(0, flags);
+        if parent_efd < 0 || worker_efd < 0 {
+            libakuma::close(parent_efd);
+            libakuma::close(worker_efd);
+            return None;
+        }
+        Some(Channel {
+            to_worker: Queue::new(worker_efd, parent_efd),
+            to_parent: Queue::new(parent_efd, worker_efd),
+            parent_efd,
+            worker_efd,
+            terminated: AtomicBool::new(false),
+            closed: AtomicBool::new(false),
+            done: AtomicBool::new(false),
+        })
+    }
+}
+
+impl Drop for Channel {
+    fn drop(&mut self) {
+        // Unread messages release their SharedArrayBuffers; memory they
+        // transferred is lost (it belonged to a runtime that is gone)
+        for queue in [&self.to_worker, &self.to_parent] {
+            while queue.ring.pop().is_some() {}
+            queue.backlog.lock().clear();
+        }
+        libakuma::close(self.parent_efd);
+        libakuma::close(self.worker_efd);
+    }
+}
+
+// ============================================================================
+// Messages
+// ============================================================================
+
+/// Serialize `argv[0]` with `argv[1]` as the transfer list
+unsafe fn encode(ctx: *mut JSContext, argc: c_int, argv: *mut JSValue) -> Result<Box<Message>, ()> {
+    let value = if argc > 0 { *argv } else { JSValue::undefined() };
+    let mut transfer = Vec::new();
+    if argc > 1 && (*argv.add(1)).get_tag() == runtime::JS_TAG_OBJECT {
+        let list = *argv.add(1);
+        let len_val = runtime::JS_GetPropertyStr(ctx, list, c"length".as_ptr());
+        let mut len = 0;
+        let ok = runtime::JS_ToInt32(ctx, &mut len, len_val) >= 0;
+        runtime::free_value(ctx, len_val);
+        if !ok {
+            return Err(());
+        }
+        for i in 0..len.max(0) as u32 {
+            let item = runtime::JS_GetPropertyUint32(ctx, list, i);
+            if item.is_exception() {
+                transfer.iter().for_each(|v| runtime::free_value(ctx, *v));
+                return Err(());
+            }
+            transfer.push(item);
+        }
+    }
+    let mut size = 0;
+    let mut sab_tab: *mut *mut u8 = core::ptr::null_mut();
+    let mut sab_len = 0;
+    let buf = runtime::JS_WriteObjectTransfer(
+        ctx,
+        &mut size,
+        value,
+        runtime::JS_WRITE_OBJ_SAB | runtime::JS_WRITE_OBJ_REFERENCE,
+        &mut sab_tab,
+        &mut sab_len,
+        transfer.as_mut_ptr(),
+        transfer.len() as c_int,
+    );
+    for v in transfer {
+        runtime::free_value(ctx, v);
+    }
+    if buf.is_null() {
+        return Err(());
+    }
+    let data = core::slice::from_raw_parts(buf, size).to_vec();
+    runtime::js_free(ctx, buf as *mut c_void);
+    let mut sabs = Vec::with_capacity(sab_len);
+    for i in 0..sab_len {
+        let sab = *sab_tab.add(i);
+        sab_dup(core::ptr::null_mut(), sab as *mut c_void);
+        sabs.push(sab as usize);
+    }
+    runtime::js_free(ctx, sab_tab as *mut c_void);
+    Ok(Box::new(Message { data, sabs }))
+}
+
+/// Deserialize a message; takes ownership of whatever it transferred
+unsafe fn decode(ctx: *mut JSContext, msg: Box<Message>) -> JSValue {
+    let flags = runtime::JS_READ_OBJ_SAB | runtime::JS_READ_OBJ_REFERENCE | runtime::JS_READ_OBJ_TRANSFER;
+    runtime::JS_ReadObject(ctx, msg.data.as_ptr(), msg.data.len(), flags)
+}
+
+/// Call `target.onmessage({ data })`, if it is a function
+unsafe fn deliver(ctx: *mut JSContext, target: JSValue, msg: Box<Message>) -> Result<(), ()> {
+    let data = decode(ctx, msg);
+    if data.is_exception() {
+        return Err(());
+    }
+    let func = runtime::JS_GetPropertyStr(ctx, target, c"onmessage".as_ptr());
+    if runtime::JS_IsFunction(ctx, func) == 0 {
+        runtime::free_value(ctx, func);
+        runtime::free_value(ctx, data);
+        return Ok(());
+    }
+    let mut event = runtime::JS_NewObject(ctx);
+    runtime::JS_SetPropertyStr(ctx, event, c"data".as_ptr(), data);
+    let ret = runtime::JS_Call(ctx, func, target, 1, &mut event);
+    runtime::free_value(ctx, event);
+    runtime::free_value(ctx, func);
+    let failed = ret.is_exception();
+    runtime::free_value(ctx, ret);
+    if failed { Err(()) } else { Ok(()) }
+}
+
+/// Read every queued message through `ctx` and drop it, so transferred
+/// memory is released by the runtime that now owns it
+unsafe fn discard(ctx: *mut JSContext, queue: &Queue) {
+    while let Some(msg) = queue.recv() {
+        let val = decode(ctx, msg);
+        if val.is_exception() {
+            let exc = runtime::JS_GetException(ctx);
+            runtime::free_value(ctx, exc);
+        } else {
+            runtime::free_value(ctx, val);
+        }
+    }
+}
+
+unsafe fn post(ctx: *mut JSContext, queue: &Queue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    match encode(ctx, argc, argv) {
+        Ok(msg) => {
+            queue.send(msg);
+            JSValue::undefined()
+        }
+        Err(()) => JSValue::exception(),
+    }
+}
+
+// ============================================================================
+// Parent side: the Worker class
+// ============================================================================
+
+/// Event-loop source for one Worker, seen from the thread that created it.
+/// Holds the Worker object so it stays alive while the thread runs.
+struct ParentPort {
+    chan: Arc<Channel>,
+    obj: JSValue,
+    thread: Option<Thread>,
+}
+
+unsafe fn worker_channel(ctx: *mut JSContext, this: JSValue) -> Option<&'static Channel> {
+    let chan = runtime::JS_GetOpaque2(ctx, this, WORKER_CLASS.load(Ordering::Relaxed)) as *const Channel;
+    chan.as_ref()
+}
+
+unsafe fn parent_ready(ctx: *mut JSContext, data: usize) -> Result<(), ()> {
+    let port = &*(data as *const ParentPort);
+    let chan = &port.chan;
+    consume(chan.parent_efd);
+    chan.to_worker.flush();
+    if chan.terminated.load(Ordering::Acquire) {
+        discard(ctx, &chan.to_parent);
+        return Ok(());
+    }
+    while let Some(msg) = chan.to_parent.recv() {
+        deliver(ctx, port.obj, msg)?;
+    }
+    Ok(())
+}
+
+unsafe fn parent_finished(_ctx: *mut JSContext, data: usize) -> bool {
+    let chan = &(*(data as *const ParentPort)).chan;
+    chan.done.load(Ordering::Acquire) && chan.to_parent.ring.is_empty()
+}
+
+unsafe fn parent_keeps_alive(_ctx: *mut JSContext, _data: usize) -> bool {
+    true
+}
+
+unsafe fn parent_free(ctx: *mut JSContext, data: usize) {
+    let ParentPort { chan, obj, thread } = *Box::from_raw(data as *mut ParentPort);
+    if let Some(thread) = thread {
+        thread.join();
+    }
+    discard(ctx, &chan.to_parent);
+    runtime::free_value(ctx, obj);
+}
+
+/// Arguments for [`worker_main`]
+struct Start {
+    chan: Arc<Channel>,
+    path: String,
+}
+
+/// `new Worker(path)`: run the script at `path` on a new thread
+unsafe extern "C" fn js_worker_ctor(ctx: *mut JSContext, _new_target: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    if argc < 1 {
+        return runtime::JS_ThrowTypeError(ctx, c"Worker: script path expected".as_ptr());
+    }
+    let mut len = 0;
+    let cstr = runtime::JS_ToCStringLen2(ctx, &mut len, *argv, 0);
+    if cstr.is_null() {
+        return JSValue::exception();
+    }
+    let path = String::from_utf8_lossy(core::slice::from_raw_parts(cstr as *const u8, len)).into_owned();
+    runtime::JS_FreeCString(ctx, cstr);
+
+    let chan = match Channel::new() {
+        Some(c) => Arc::new(c),
+        None => return runtime::JS_ThrowTypeError(ctx, c"Worker: cannot create eventfd".as_ptr()),
+    };
+    let obj = runtime::JS_NewObjectClass(ctx, WORKER_CLASS.load(Ordering::Relaxed) as c_int);
+    if obj.is_exception() {
+        return obj;
+    }
+    runtime::JS_SetOpaque(obj, Arc::into_raw(chan.clone()) as *mut c_void);
+
+    let start = Box::into_raw(Box::new(Start { chan: chan.clone(), path }));
+    let thread = match libakuma::spawn_thread(WORKER_STACK, worker_main, start as usize) {
+        Ok(t) => t,
+        Err(e) => {
+            drop(Box::from_raw(start));
+            runtime::free_value(ctx, obj);
+            return runtime::JS_ThrowTypeError(ctx, c"Worker: cannot start thread (%d)".as_ptr(), e);
+        }
+    };
+    let fd = chan.parent_efd;
+    let port = Box::new(ParentPort { chan, obj: runtime::dup_value(obj), thread: Some(thread) });
+    event_loop::add_source(
+        ctx,
+        Source {
+            fd,
+            data: Box::into_raw(port) as usize,
+            ready: parent_ready,
+            finished: parent_finished,
+            keeps_alive: parent_keeps_alive,
+            free: parent_free,
+        },
+    );
+    obj
+}
+
+/// `worker.postMessage(value[, transfer])`
+unsafe extern "C" fn js_worker_post(ctx: *mut JSContext, this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    let chan = match worker_channel(ctx, this) {
+        Some(c) => c,
+        None => return JSValue::exception(),
+    };
+    // Like a browser, posting to a finished Worker does nothing
+    if chan.done.load(Ordering::Acquire) || chan.terminated.load(Ordering::Acquire) {
+        return JSValue::undefined();
+    }
+    post(ctx, &chan.to_worker, argc, argv)
+}
+
+/// `worker.terminate()`
+unsafe extern "C" fn js_worker_terminate(ctx: *mut JSContext, this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    let chan = match worker_channel(ctx, this) {
+        Some(c) => c,
+        None => return JSValue::exception(),
+    };
+    chan.terminated.store(true, Ordering::Release);
+    signal(chan.worker_efd);
+    JSValue::undefined()
+}
+
+unsafe extern "C" fn worker_finalizer(_rt: *mut JSRuntime, val: JSValue) {
+    let chan = runtime::JS_GetOpaque(val, WORKER_CLASS.load(Ordering::Relaxed)) as *const Channel;
+    if !chan.is_null() {
+        drop(Arc::from_raw(chan));
+    }
+}
+
+static WORKER_CLASS_DEF: JSClassDef = JSClassDef {
+    class_name: c"Worker".as_ptr(),
+    finalizer: Some(worker_finalizer),
+    gc_mark: core::ptr::null(),
+    call: core::ptr::null(),
+    exotic: core::ptr::null(),
+};
+
+/// Register the `Worker` class and the SharedArrayBuffer allocator on `rt`
+/// and install the `Worker` constructor on `global`
+pub fn setup(rt: &Runtime, global: JSValue) {
+    unsafe {
+        runtime::JS_SetSharedArrayBufferFunctions(rt.runtime(), &SAB_FUNCTIONS);
+        let ctx = rt.context();
+        let class_id = runtime::JS_NewClassID(WORKER_CLASS.as_ptr());
+        runtime::JS_NewClass(rt.runtime(), class_id, &WORKER_CLASS_DEF);
+        let proto = runtime::JS_NewObject(ctx);
+        rt.set_property_str(proto, "postMessage", rt.new_c_function(js_worker_post, "postMessage", 2));
+        rt.set_property_str(proto, "terminate", rt.new_c_function(js_worker_terminate, "terminate", 0));
+        let ctor = runtime::JS_NewCFunction2(
+            ctx,
+            Some(js_worker_ctor),
+            c"Worker".as_ptr(),
+            1,
+            runtime::JS_CFUNC_CONSTRUCTOR,
+            0,
+        );
+        runtime::JS_SetConstructor(ctx, ctor, proto);
+        runtime::JS_SetClassProto(ctx, class_id, proto);
+        rt.set_property_str(global, "Worker", ctor);
+    }
+}
+
+// ============================================================================
+// Worker side
+// ============================================================================
+
+/// The channel of the Worker running in `ctx`'s thread, stored in the
+/// context opaque by `worker_main`
+unsafe fn own_channel(ctx: *mut JSContext) -> &'static Channel {
+    &*(runtime::JS_GetContextOpaque(ctx) as *const Channel)
+}
+
+unsafe fn worker_ready(ctx: *mut JSContext, _data: usize) -> Result<(), ()> {
+    let chan = own_channel(ctx);
+    consume(chan.worker_efd);
+    chan.to_parent.flush();
+    if chan.terminated.load(Ordering::Acquire) {
+        event_loop::stop(ctx);
+        return Ok(());
+    }
+    let global = runtime::JS_GetGlobalObject(ctx);
+    let mut result = Ok(());
+    while let Some(msg) = chan.to_worker.recv() {
+        result = deliver(ctx, global, msg);
+        if result.is_err() || chan.closed.load(Ordering::Acquire) {
+            break;
+        }
+    }
+    runtime::free_value(ctx, global);
+    result
+}
+
+unsafe fn worker_finished(ctx: *mut JSContext, _data: usize) -> bool {
+    let chan = own_channel(ctx);
+    chan.terminated.load(Ordering::Acquire) || chan.closed.load(Ordering::Acquire)
+}
+
+/// A Worker stays up while it listens for messages or still has some to
+/// deliver or send
+unsafe fn worker_keeps_alive(ctx: *mut JSContext, _data: usize) -> bool {
+    let chan = own_channel(ctx);
+    if !chan.to_worker.ring.is_empty() || chan.to_parent.has_backlog() {
+        return true;
+    }
+    let global = runtime::JS_GetGlobalObject(ctx);
+    let func = runtime::JS_GetPropertyStr(ctx, global, c"onmessage".as_ptr());
+    let listening = runtime::JS_IsFunction(ctx, func) != 0;
+    runtime::free_value(ctx, func);
+    runtime::free_value(ctx, global);
+    listening
+}
+
+unsafe fn worker_free(ctx: *mut JSContext, _data: usize) {
+    discard(ctx, &own_channel(ctx).to_worker);
+}
+
+/// Global `postMessage(value[, transfer])` inside a Worker
+unsafe extern "C" fn js_post_to_parent(ctx: *mut JSContext, _this: JSValue, argc: c_int, argv: *mut JSValue) -> JSValue {
+    post(ctx, &own_channel(ctx).to_parent, argc, argv)
+}
+
+/// Global `close()` inside a Worker: stop once the current callback returns
+unsafe extern "C" fn js_close_worker(ctx: *mut JSContext, _this: JSValue, _argc: c_int, _argv: *mut JSValue) -> JSValue {
+    own_channel(ctx).closed.store(true, Ordering::Release);
+    event_loop::stop(ctx);
+    JSValue::undefined()
+}
+
+/// Interrupt handler: abort running JS once the Worker is terminated
+unsafe extern "C" fn interrupt(_rt: *mut JSRuntime, opaque: *mut c_void) -> c_int {
+    (*(opaque as *const Channel)).terminated.load(Ordering::Relaxed) as c_int
+}
+
+fn setup_scope(rt: &Runtime, chan: &Arc<Channel>) {
+    let ctx = rt.context();
+    let chan_ptr = Arc::as_ptr(chan) as *mut c_void;
+    unsafe {
+        runtime::JS_SetContextOpaque(ctx, chan_ptr);
+        runtime::JS_SetInterruptHandler(rt.runtime(), Some(interrupt), chan_ptr);
+        // Atomics.wait is allowed off the main thread
+        runtime::JS_SetCanBlock(rt.runtime(), 1);
+        let global = rt.global_object();
+        rt.set_property_str(global, "postMessage", rt.new_c_function(js_post_to_parent, "postMessage", 2));
+        rt.set_property_str(global, "close", rt.new_c_function(js_close_worker, "close", 0));
+        rt.free_value(global);
+        event_loop::add_source(
+            ctx,
+            Source {
+                fd: chan.worker_efd,
+                data: 0,
+                ready: worker_ready,
+                finished: worker_finished,
+                keeps_alive: worker_keeps_alive,
+                free: worker_free,
+            },
+        );
+    }
+}
+
+/// Load and run the Worker's script and event loop in a new runtime
+fn run_worker(chan: &Arc<Channel>, path: &str) {
+    let (limits, opts) = match &*CONFIG.lock() {
+        Some(c) => (c.limits, LoadOptions { cache_dir: c.cache_dir.clone(), timing: false }),
+        None => (Limits::default(), LoadOptions { cache_dir: None, timing: false }),
+    };
+    let rt = match Runtime::new(&limits) {
+        Some(r) => r,
+        None => {
+            print_error("Error: Failed to create JavaScript runtime for Worker ", path);
+            return;
+        }
+    };
+    crate::setup_console(&rt);
+    crate::setup_akuma(&rt);
+    setup_scope(&rt, chan);
+    if crate::run_file(&rt, path, &opts) == 0 {
+        if let Err(e) = event_loop::run(&rt) {
+            if !chan.terminated.load(Ordering::Acquire) {
+                print_error("Error: ", &e);
+            }
+        }
+    }
+    event_loop::teardown(&rt);
+}
+
+/// Thread entry for a Worker; `arg` is a `Box<Start>`
+extern "C" fn worker_main(arg: usize) {
+    let start = unsafe { Box::from_raw(arg as *mut Start) };
+    run_worker(&start.chan, &start.path);
+    let chan = start.chan.clone();
+    drop(start);
+    chan.done.store(true, Ordering::Release);
+    signal(chan.parent_efd);
+}
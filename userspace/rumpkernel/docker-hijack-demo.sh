@@ -14,6 +14,12 @@
 #   4. proof: wget prints the page, AND [VIRTIF TX/RX]/[VIRTIF STATS] show the
 #      frames that the NetBSD stack put on / took off the wire.
 #
+# HIJACK_BENCH=1 adds two benchmarks, each also run without the shim as a
+# control: large-file throughput (rumpuser/c_tests/sendfile_bench.c, a
+# read()/write() loop vs sendfile() into a rump socket, to a sink on
+# 10.0.0.1:9000) and small-message ping-pong (c_tests/pingpong_bench.c, the
+# per-call cost of the shim, against an echo server on 10.0.0.1:9001).
+#
 # Needs /dev/net/tun + NET_ADMIN. Prereqs: docker-build.sh, the PIC virtif
 # (libvirtif_pic), and rumpuser built PIC (relocation-model=pic).
 set -eu
@@ -24,6 +30,7 @@ RUMPUSER_A="rumpuser/target/aarch64-unknown-linux-musl/release/librumpuser_akuma
 
 exec docker run --rm --platform linux/arm64 \
     --device /dev/net/tun --cap-add NET_ADMIN \
+    -e HIJACK_BENCH="${HIJACK_BENCH:-0}" \
     -v "${HERE}:/work" -w /work \
     alpine:3.20 sh -euc '
         apk add --no-cache build-base linux-headers iproute2 python3 curl dnsmasq >/dev/null
@@ -87,4 +94,48 @@ exec docker run --rm --platform linux/arm64 \
         else
             echo "[demo] FAIL: see trace above."
         fi
+
+        [ "$HIJACK_BENCH" = 1 ] || exit 0
+        echo "[demo] === bench: 64 MiB file, read/write loop vs sendfile, over rump ==="
+        gcc -O2 -o /tmp/sendfile_bench rumpuser/c_tests/sendfile_bench.c
+        head -c 67108864 /dev/urandom > /tmp/big.bin
+        python3 -c "
+import socket
+s = socket.socket(); s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind((\"10.0.0.1\", 9000)); s.listen(4); b = bytearray(1 << 20)
+while True:
+    c, _ = s.accept(); n = int.from_bytes(c.recv(8, socket.MSG_WAITALL), \"big\")
+    while n > 0:
+        k = c.recv_into(b, min(n, len(b)))
+        if k == 0: break
+        n -= k
+    c.sendall(b\"k\"); c.close()
+" &
+        sleep 1
+        echo "[demo] control (host kernel):"
+        /tmp/sendfile_bench 10.0.0.1 9000 /tmp/big.bin 3
+        echo "[demo] rump stack (hijacked):"
+        RUMP_DHCP=1 LD_PRELOAD=/tmp/hijack.so \
+            /tmp/sendfile_bench 10.0.0.1 9000 /tmp/big.bin 3 2>/tmp/bench.err
+        grep -a "VIRTIF STATS" /tmp/bench.err || true
+
+        echo "[demo] === bench: 64-byte ping-pong, shim call rate ==="
+        gcc -O2 -o /tmp/pingpong_bench rumpuser/c_tests/pingpong_bench.c
+        python3 -c "
+import socket, threading
+s = socket.socket(); s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind((\"10.0.0.1\", 9001)); s.listen(4)
+def echo(c):
+    c.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    while d := c.recv(65536): c.sendall(d)
+while True:
+    threading.Thread(target=echo, args=(s.accept()[0],), daemon=True).start()
+" &
+        sleep 1
+        echo "[demo] control (host kernel):"
+        /tmp/pingpong_bench 10.0.0.1 9001 20000
+        echo "[demo] rump stack (hijacked):"
+        RUMP_DHCP=1 LD_PRELOAD=/tmp/hijack.so \
+            /tmp/pingpong_bench 10.0.0.1 9001 20000 2>/tmp/pingpong.err
+        grep -a "VIRTIF STATS" /tmp/pingpong.err || true
     '
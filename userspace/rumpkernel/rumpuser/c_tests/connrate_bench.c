@@ -0,0 +1,205 @@
+/*
+ * connrate_bench.c — TCP connection rate against a rump stack, to see how
+ * accepting scales with RUMP_NCPU (the pthread backend pins each rump vCPU's
+ * kthreads to a host core; see docs/PHASE2_RUMPUSER.md).
+ *
+ *     connrate_bench -s <port> [threads]          server
+ *     connrate_bench <ip> <port> [secs] [threads] client
+ *
+ * The server is the side under test: run it under LD_PRELOAD=hijack.so so its
+ * sockets are rump ones, with RUMP_NCPU=1..4 and a --no-default-features
+ * staticlib. `threads` threads accept on one listener; each accepted
+ * connection gets one byte and is closed. Without the preload it runs on the
+ * host stack, which is the control.
+ *
+ * The client is the load generator and runs natively. Each of `threads`
+ * threads (default 4) loops for `secs` seconds (default 10): connect, read
+ * the server's byte, close. It prints connections/s and the log2 histogram of
+ * connect-to-byte latency, one line per run:
+ *
+ *     # threads secs conns conns_per_s p50_us p99_us max_us fails
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAXTHREADS	64
+#define BUCKETS		32	/* bucket i: [2^(i-1), 2^i) µs, as virtif_stats.h */
+
+static struct sockaddr_in g_sin;
+static double g_end;
+static int g_listen = -1;
+
+struct worker {
+	pthread_t tid;
+	unsigned long conns, fails;
+	uint64_t max_us;
+	unsigned long hist[BUCKETS];
+};
+
+static double
+now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *
+serve(void *arg)
+{
+	(void)arg;
+	for (;;) {
+		int c = accept(g_listen, NULL, NULL);
+
+		if (c < 0)
+			continue;
+		(void)write(c, "!", 1);
+		close(c);
+	}
+	return NULL;
+}
+
+static void *
+client(void *arg)
+{
+	struct worker *w = arg;
+	struct linger lg = { 1, 0 };	/* RST on close: no TIME_WAIT pile-up */
+	char b;
+
+	while (now_s() < g_end) {
+		double t0 = now_s();
+		uint64_t us;
+		int s = socket(AF_INET, SOCK_STREAM, 0);
+		unsigned i;
+
+		if (s < 0) {
+			w->fails++;
+			continue;
+		}
+		(void)setsockopt(s, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+		if (connect(s, (struct sockaddr *)&g_sin, sizeof(g_sin)) != 0 ||
+		    read(s, &b, 1) != 1) {
+			w->fails++;
+			close(s);
+			continue;
+		}
+		close(s);
+		us = (uint64_t)((now_s() - t0) * 1e6);
+		i = us ? 64 - (unsigned)__builtin_clzll(us) : 0;
+		w->hist[i < BUCKETS ? i : BUCKETS - 1]++;
+		if (us > w->max_us)
+			w->max_us = us;
+		w->conns++;
+	}
+	return NULL;
+}
+
+/* Upper bucket edge holding the pct-th percentile sample. */
+static unsigned long
+pct(const unsigned long *h, unsigned long n, unsigned p)
+{
+	unsigned long rank = (n * p + 99) / 100, seen = 0;
+	int i;
+
+	if (n == 0)
+		return 0;
+	for (i = 0; i < BUCKETS; i++) {
+		seen += h[i];
+		if (seen >= (rank ? rank : 1))
+			break;
+	}
+	return i == 0 ? 0 : 1ul << (i < BUCKETS ? i : BUCKETS - 1);
+}
+
+static int
+run_server(int port, int nthr)
+{
+	struct sockaddr_in sin;
+	pthread_t t;
+	int one = 1, i;
+
+	g_listen = socket(AF_INET, SOCK_STREAM, 0);
+	if (g_listen < 0) {
+		perror("socket");
+		return 1;
+	}
+	(void)setsockopt(g_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons((uint16_t)port);
+	if (bind(g_listen, (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+	    listen(g_listen, 1024) != 0) {
+		perror("bind/listen");
+		return 1;
+	}
+	fprintf(stderr, "connrate_bench: serving :%d with %d thread(s)\n",
+	    port, nthr);
+	for (i = 1; i < nthr; i++)
+		pthread_create(&t, NULL, serve, NULL);
+	serve(NULL);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct worker w[MAXTHREADS];
+	unsigned long hist[BUCKETS] = { 0 }, conns = 0, fails = 0;
+	uint64_t max_us = 0;
+	double secs;
+	int nthr, i, j;
+
+	if (argc >= 3 && strcmp(argv[1], "-s") == 0) {
+		nthr = argc > 3 ? atoi(argv[3]) : 1;
+		return run_server(atoi(argv[2]),
+		    nthr < 1 ? 1 : nthr > MAXTHREADS ? MAXTHREADS : nthr);
+	}
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s -s <port> [threads]\n"
+		    "       %s <ip> <port> [secs] [threads]\n", argv[0], argv[0]);
+		return 2;
+	}
+	secs = argc > 3 ? atof(argv[3]) : 10;
+	nthr = argc > 4 ? atoi(argv[4]) : 4;
+	if (nthr < 1 || nthr > MAXTHREADS)
+		nthr = 4;
+	memset(&g_sin, 0, sizeof(g_sin));
+	g_sin.sin_family = AF_INET;
+	g_sin.sin_port = htons((uint16_t)atoi(argv[2]));
+	if (inet_pton(AF_INET, argv[1], &g_sin.sin_addr) != 1) {
+		fprintf(stderr, "bad address %s\n", argv[1]);
+		return 2;
+	}
+
+	g_end = now_s() + secs;
+	for (i = 0; i < nthr; i++)
+		pthread_create(&w[i].tid, NULL, client, &w[i]);
+	for (i = 0; i < nthr; i++) {
+		pthread_join(w[i].tid, NULL);
+		conns += w[i].conns;
+		fails += w[i].fails;
+		if (w[i].max_us > max_us)
+			max_us = w[i].max_us;
+		for (j = 0; j < BUCKETS; j++)
+			hist[j] += w[i].hist[j];
+	}
+	printf("# threads secs conns conns_per_s p50_us p99_us max_us fails\n");
+	printf("%d %.1f %lu %.0f %lu %lu %llu %lu\n", nthr, secs, conns,
+	    conns / secs, pct(hist, conns, 50), pct(hist, conns, 99),
+	    (unsigned long long)max_us, fails);
+	return 0;
+}
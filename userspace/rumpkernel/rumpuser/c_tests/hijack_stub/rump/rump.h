@@ -0,0 +1,45 @@
+/*
+ * Host-test stand-in for <rump/rump.h>, <rump/rump_syscalls.h> and
+ * <rump/netconfig.h>: just the entry points hijack.c calls, for
+ * c_tests/test_hijack.c, which supplies a fake rump kernel behind them.
+ */
+#ifndef HIJACK_STUB_RUMP_H
+#define HIJACK_STUB_RUMP_H
+
+#include <poll.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+
+int rump_init(void);
+
+int rump_pub_netconfig_ifcreate(const char *);
+int rump_pub_netconfig_ifup(const char *);
+int rump_pub_netconfig_ipv4_ifaddr(const char *, const char *, const char *);
+int rump_pub_netconfig_ipv4_gw(const char *);
+int rump_pub_netconfig_dhcp_ipv4_oneshot(const char *);
+
+int rump_sys_socket(int, int, int);
+int rump_sys_connect(int, const struct sockaddr *, socklen_t);
+ssize_t rump_sys_read(int, void *, size_t);
+ssize_t rump_sys_write(int, const void *, size_t);
+ssize_t rump_sys_readv(int, const struct iovec *, int);
+ssize_t rump_sys_writev(int, const struct iovec *, int);
+ssize_t rump_sys_sendto(int, const void *, size_t, int,
+    const struct sockaddr *, socklen_t);
+ssize_t rump_sys_recvfrom(int, void *, size_t, int, struct sockaddr *,
+    socklen_t *);
+int rump_sys_getsockopt(int, int, int, void *, socklen_t *);
+int rump_sys_setsockopt(int, int, int, const void *, socklen_t);
+int rump_sys_close(int);
+int rump_sys_dup(int);
+int rump_sys_pipe2(int *, int);
+int rump_sys_poll(struct pollfd *, nfds_t, int);
+int rump_sys_fcntl(int, int, ...);
+int rump_sys_kqueue(void);
+int rump_sys_kevent(int, const void *, size_t, void *, size_t,
+    const struct timespec *);
+
+#endif
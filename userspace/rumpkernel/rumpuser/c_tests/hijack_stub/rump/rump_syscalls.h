@@ -0,0 +1 @@
+#include "rump.h"
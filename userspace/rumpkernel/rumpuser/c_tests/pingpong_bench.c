@@ -0,0 +1,122 @@
+/*
+ * pingpong_bench.c — small-message round trips over a hijacked socket, to
+ * measure what the shim itself costs per call (fd dispatch, poll split, the
+ * mixed-set wait) rather than bulk bandwidth. Run under LD_PRELOAD=hijack.so
+ * so the socket is a rump one (docker-hijack-demo.sh with HIJACK_BENCH=1);
+ * without it everything goes through the host kernel, which is the control.
+ *
+ *     pingpong_bench <ip> <port> [msgs] [size]
+ *
+ * The peer echoes every byte back. Three rounds of `msgs` messages of `size`
+ * bytes, each message written and its echo read before the next:
+ *   read/write  write + read                       (2 calls per round trip)
+ *   poll        write + poll(socket) + read        (3)
+ *   poll mixed  write + poll(socket, host pipe) + read (3; the set mixes a
+ *               rump fd with a host fd that never fires)
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double
+now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int
+read_full(int s, char *buf, size_t n)
+{
+	while (n > 0) {
+		ssize_t r = read(s, buf, n);
+
+		if (r <= 0)
+			return -1;
+		buf += r;
+		n -= (size_t)r;
+	}
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const char *const names[] = { "read/write", "poll", "poll mixed" };
+	static const int calls[] = { 2, 3, 3 };
+	struct sockaddr_in sin;
+	struct pollfd pfd[2];
+	int msgs, size, s, p[2], one = 1, mode, i;
+	char *out, *in;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <ip> <port> [msgs] [size]\n", argv[0]);
+		return 2;
+	}
+	msgs = argc > 3 ? atoi(argv[3]) : 10000;
+	size = argc > 4 ? atoi(argv[4]) : 64;
+	if (msgs <= 0 || size <= 0 || (out = malloc(2 * (size_t)size)) == NULL)
+		return 2;
+	in = out + size;
+	memset(out, 'p', (size_t)size);
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons((uint16_t)atoi(argv[2]));
+	if (inet_pton(AF_INET, argv[1], &sin.sin_addr) != 1) {
+		fprintf(stderr, "bad address %s\n", argv[1]);
+		return 2;
+	}
+	if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+	    connect(s, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		perror("connect");
+		return 1;
+	}
+	(void)setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if (pipe(p) < 0) {
+		perror("pipe");
+		return 1;
+	}
+
+	for (mode = 0; mode < 3; mode++) {
+		double t0 = now_s(), dt;
+
+		for (i = 0; i < msgs; i++) {
+			if (write(s, out, (size_t)size) != size)
+				goto fail;
+			if (mode > 0) {
+				pfd[0] = (struct pollfd){ .fd = s, .events = POLLIN };
+				pfd[1] = (struct pollfd){ .fd = p[0], .events = POLLIN };
+				if (poll(pfd, mode == 2 ? 2 : 1, -1) < 1 ||
+				    !(pfd[0].revents & POLLIN))
+					goto fail;
+			}
+			if (read_full(s, in, (size_t)size) < 0)
+				goto fail;
+		}
+		dt = now_s() - t0;
+		printf("[bench] %-10s %d x %d B: %.0f round trips/s, %.1f us each,"
+		    " %.0f shim calls/s\n", names[mode], msgs, size, msgs / dt,
+		    dt * 1e6 / msgs, calls[mode] * msgs / dt);
+	}
+	close(s);
+	free(out);
+	return 0;
+
+fail:
+	perror(names[mode]);
+	return 1;
+}
@@ -37,7 +37,8 @@
 void virtif_dump_stats(void);   /* from rumpcomp_tap.c (best-effort) */
 
 /* serve on a pre-connected fd (kernel-pipe transport); from sp_serve_fd.c */
-extern int rumpuser_sp_init_fd(int, const char *, const char *, const char *);
+extern int rumpuser_sp_init_mux(int, int, const char *, const char *,
+    const char *);
 
 /* rumpuser backend introspection: 1 if rump kthreads are cooperative fibers on
  * one OS thread (else 0 = pthread). _yield runs the fiber scheduler. */
@@ -82,6 +83,7 @@ main(int argc, char **argv)
 	const char *ifname = "virt0";
 	const char *logpath = NULL; /* --log: redirect stdout/stderr to this file */
 	int serve_fd = -1;   /* >=0: serve sysproxy on this inherited fd */
+	int chan_fd = -1;    /* >=0: more boxes' channels announced on this fd */
 	int do_net = 0;      /* --net: bring up virt0 + DHCP over /dev/net/tap0 */
 	int url_given = 0;   /* a positional URL was passed (legacy listen mode) */
 	int rv;
@@ -89,6 +91,8 @@ main(int argc, char **argv)
 	/*
 	 * Modes:
 	 *   rump_server --fd N [--net]     serve on inherited fd N (Akuma kernel-pipe)
+	 *     [--chan-fd M]                 ...and on the channels of boxes sharing
+	 *                                   this stack, whose fds arrive on fd M
 	 *   rump_server [url] [--net]      listen on a URL (container/path tests)
 	 * --net brings the rump stack online (needs RUMP_NIC=1 / a tap); without it
 	 * the stack still serves control-plane syscalls (e.g. socket()).
@@ -96,6 +100,8 @@ main(int argc, char **argv)
 	for (int i = 1; i < argc; i++) {
 		if (!strcmp(argv[i], "--fd") && i + 1 < argc) {
 			serve_fd = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--chan-fd") && i + 1 < argc) {
+			chan_fd = atoi(argv[++i]);
 		} else if (!strcmp(argv[i], "--net")) {
 			do_net = 1;
 		} else if (!strcmp(argv[i], "--if") && i + 1 < argc) {
@@ -129,8 +135,10 @@ main(int argc, char **argv)
 	}
 
 	if (serve_fd >= 0) {
-		rv = rumpuser_sp_init_fd(serve_fd, "NetBSD", "7.99.34", "evbarm64");
-		printf("RUMP_SERVER: rumpuser_sp_init_fd(%d) -> %d\n", serve_fd, rv);
+		rv = rumpuser_sp_init_mux(serve_fd, chan_fd, "NetBSD", "7.99.34",
+		    "evbarm64");
+		printf("RUMP_SERVER: rumpuser_sp_init_mux(%d, %d) -> %d\n",
+		    serve_fd, chan_fd, rv);
 		if (rv != 0) {
 			printf("RUMP_SERVER: FAIL — sp_init_fd rv=%d\n", rv);
 			return 1;
@@ -0,0 +1,167 @@
+/*
+ * sendfile_bench.c — large-file throughput over a hijacked socket: the same
+ * file sent with a read()/write() loop (what an app without sendfile does) and
+ * with sendfile(), which hijack.c serves from a mapped view in HJ_SF_WINDOW
+ * batches. Run under LD_PRELOAD=hijack.so so the socket is a rump one
+ * (docker-hijack-demo.sh with HIJACK_BENCH=1); without it both paths go
+ * through the host kernel, which is the control.
+ *
+ *     sendfile_bench <ip> <port> <file> [reps] [bufsize]
+ *
+ * Each transfer is one connection: an 8-byte big-endian length, the file,
+ * then a 1-byte ack from the sink once it has everything, so the time covers
+ * delivery, not just queueing into the socket buffer. The sink is any server
+ * that does that (the demo uses a python3 one-liner).
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double
+now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int
+write_all(int fd, const void *buf, size_t n)
+{
+	const char *p = buf;
+
+	while (n > 0) {
+		ssize_t w = write(fd, p, n);
+
+		if (w <= 0)
+			return -1;
+		p += w;
+		n -= (size_t)w;
+	}
+	return 0;
+}
+
+static int
+dial(const char *ip, int port, uint64_t size)
+{
+	struct sockaddr_in sin;
+	unsigned char hdr[8];
+	int s, i;
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons((uint16_t)port);
+	if (inet_pton(AF_INET, ip, &sin.sin_addr) != 1)
+		return -1;
+	if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+		return -1;
+	if (connect(s, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		close(s);
+		return -1;
+	}
+	for (i = 0; i < 8; i++)
+		hdr[i] = (unsigned char)(size >> (56 - 8 * i));
+	if (write_all(s, hdr, sizeof(hdr)) < 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+static int
+send_rw(int s, int fd, char *buf, size_t bufsz)
+{
+	ssize_t r;
+
+	if (lseek(fd, 0, SEEK_SET) < 0)
+		return -1;
+	while ((r = read(fd, buf, bufsz)) > 0)
+		if (write_all(s, buf, (size_t)r) < 0)
+			return -1;
+	return r < 0 ? -1 : 0;
+}
+
+static int
+send_sf(int s, int fd, off_t size)
+{
+	off_t off = 0;
+
+	while (off < size) {
+		ssize_t n = sendfile(s, fd, &off, (size_t)(size - off));
+
+		if (n <= 0)
+			return -1;
+	}
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const char *const names[] = { "read/write", "sendfile" };
+	struct stat st;
+	size_t bufsz;
+	char *buf;
+	int reps, fd, mode, i;
+
+	if (argc < 4) {
+		fprintf(stderr,
+		    "usage: %s <ip> <port> <file> [reps] [bufsize]\n", argv[0]);
+		return 2;
+	}
+	reps = argc > 4 ? atoi(argv[4]) : 3;
+	bufsz = argc > 5 ? (size_t)atol(argv[5]) : 64 * 1024;
+	if ((fd = open(argv[3], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+		perror(argv[3]);
+		return 1;
+	}
+	if ((buf = malloc(bufsz)) == NULL)
+		return 1;
+
+	for (mode = 0; mode < 2; mode++) {
+		double best = 0, total = 0;
+
+		for (i = 0; i < reps; i++) {
+			int s = dial(argv[1], atoi(argv[2]), (uint64_t)st.st_size);
+			double t0, dt, mbs;
+			char ack;
+
+			if (s < 0) {
+				perror("connect");
+				return 1;
+			}
+			t0 = now_s();
+			if ((mode == 0 ? send_rw(s, fd, buf, bufsz) :
+			    send_sf(s, fd, st.st_size)) < 0 ||
+			    read(s, &ack, 1) != 1) {
+				perror(names[mode]);
+				return 1;
+			}
+			dt = now_s() - t0;
+			close(s);
+			mbs = (double)st.st_size / (1024 * 1024) / dt;
+			total += mbs;
+			if (mbs > best)
+				best = mbs;
+		}
+		printf("[bench] %-10s %lld bytes x%d: avg %.1f MiB/s, best %.1f MiB/s\n",
+		    names[mode], (long long)st.st_size, reps, total / reps, best);
+	}
+	free(buf);
+	close(fd);
+	return 0;
+}
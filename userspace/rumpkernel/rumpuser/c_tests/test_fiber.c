@@ -7,12 +7,21 @@
  * scheduler directly through the rumpuser_* hypercalls:
  *   Test A: create joinable fibers that cooperatively clock_sleep + exit; join.
  *   Test B: two fibers ping-pong N rounds over a mutex + condvar.
+ *   Test C: the same over the sysproxy pthread-compat shims.
+ *   Test D: ping-pong benchmark with many idle fibers parked alongside — the
+ *           per-switch cost must not grow with the fiber count (run queue).
+ *   Test E: timer benchmark — many fibers with shuffled sleeps must wake in
+ *           deadline order (timer heap).
+ *   Test F: create/join churn must be served from the Thread/stack pool (no
+ *           fresh mmap per fiber once warm).
  *
- * PASS = deterministic interleavings below + "ALL TESTS PASSED".
+ * PASS = deterministic interleavings below + "ALL TESTS PASSED". D/E print
+ * their timings for comparison across scheduler changes.
  * Built static for aarch64-linux-musl; runs in arm64 Linux and Akuma EL0.
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
 
 /* RumpHyperUp layout (src/lib.rs): 13 fn ptrs + hyp_extra[8] = 21 pointers.
  * backend_unschedule is index 2, backend_schedule index 3. */
@@ -34,6 +43,7 @@ extern void rumpuser_mutex_exit(void *m);
 extern void rumpuser_cv_init(void **cvp);
 extern void rumpuser_cv_wait(void *cv, void *m);
 extern void rumpuser_cv_signal(void *cv);
+extern void rumpuser_cv_broadcast(void *cv);
 
 /* Cooperative pthread-compat shims used by the sysproxy C server (fiber.rs). They
  * take the address of the caller's pthread_mutex_t/pthread_cond_t storage and back
@@ -46,6 +56,13 @@ extern int akfiber_sp_cond_wait(void *cv, void *m);
 extern int akfiber_sp_cond_signal(void *cv);
 extern int akfiber_sp_cond_broadcast(void *cv);
 
+/* fiber.rs FiberStats */
+struct akfiber_stats {
+	unsigned long fresh, reused, pooled, unmapped;
+	unsigned long pool_len, pool_hiwat, pool_max;
+};
+extern int rumpuser_akuma_fiber_stats(struct akfiber_stats *out);
+
 #define RUMPUSER_LWP_SET     2
 #define RUMPUSER_CLOCK_RELWALL 0
 
@@ -129,6 +146,79 @@ sp_pinger(void *arg)
 	rumpuser_thread_exit();
 }
 
+/* ── Test D: ping-pong benchmark with idle fibers parked ──
+ * D_IDLE fibers block on a condvar for the whole run, so a scheduler that walks
+ * every thread per switch pays for them on each of the 2*D_ROUNDS handoffs. */
+#define D_ROUNDS 20000
+#define D_IDLE   64
+static void *d_mtx, *d_cv, *d_park;
+static int d_turn, d_rounds, d_release;
+
+static void *
+d_idler(void *arg)
+{
+	(void)arg;
+	rumpuser_mutex_enter(d_mtx);
+	while (!d_release)
+		rumpuser_cv_wait(d_park, d_mtx);
+	rumpuser_mutex_exit(d_mtx);
+	rumpuser_thread_exit();
+}
+
+static void *
+d_pinger(void *arg)
+{
+	int me = (int)(intptr_t)arg;
+	for (int r = 0; r < D_ROUNDS; r++) {
+		rumpuser_mutex_enter(d_mtx);
+		while (d_turn != me)
+			rumpuser_cv_wait(d_cv, d_mtx);
+		d_rounds++;
+		d_turn = !me;
+		rumpuser_cv_signal(d_cv);
+		rumpuser_mutex_exit(d_mtx);
+	}
+	rumpuser_thread_exit();
+}
+
+/* ── Test E: many timers, shuffled deadlines ──
+ * Fiber i sleeps ((i * 7) % E_N + 1) * E_STEP_MS; the stride is coprime with
+ * E_N so every slot is distinct. Each records its slot on wake; the log must be
+ * ascending (deadline order) and all fibers must wake. */
+#define E_N       32
+#define E_STEP_MS 3
+static int e_log[E_N];
+static int e_nlog;
+
+static void *
+e_sleeper(void *arg)
+{
+	int slot = (int)(intptr_t)arg;
+	rumpuser_clock_sleep(RUMPUSER_CLOCK_RELWALL, 0, (long)slot * E_STEP_MS * 1000 * 1000);
+	e_log[e_nlog++] = slot;
+	rumpuser_thread_exit();
+}
+
+/* ── Test F: pool churn ── */
+#define F_ITERS 200
+static int f_ran;
+
+static void *
+f_worker(void *arg)
+{
+	(void)arg;
+	f_ran++;
+	rumpuser_thread_exit();
+}
+
+static int64_t
+mono_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 int
 main(void)
 {
@@ -182,7 +272,74 @@ main(void)
 	printf("[C] sp ping-pong done, rounds=%d (expect %d)\n", sp_rounds, 2 * ROUNDS);
 	fflush(stdout);
 
-	if (cv_rounds == 2 * ROUNDS && sp_rounds == 2 * ROUNDS) {
+	/* ── Test D ── */
+	printf("== Test D: ping-pong benchmark, %d idle fibers ==\n", D_IDLE);
+	fflush(stdout);
+	rumpuser_mutex_init(&d_mtx, 0);
+	rumpuser_cv_init(&d_cv);
+	rumpuser_cv_init(&d_park);
+	void *di[D_IDLE], *dp, *dq;
+	for (int i = 0; i < D_IDLE; i++)
+		rumpuser_thread_create(d_idler, NULL, "idle", 1, 0, 0, &di[i]);
+	int64_t t0 = mono_ns();
+	rumpuser_thread_create(d_pinger, (void *)(intptr_t)0, "dP", 1, 0, 0, &dp);
+	rumpuser_thread_create(d_pinger, (void *)(intptr_t)1, "dQ", 1, 0, 0, &dq);
+	rumpuser_thread_join(dp);
+	rumpuser_thread_join(dq);
+	int64_t dt = mono_ns() - t0;
+	rumpuser_mutex_enter(d_mtx);
+	d_release = 1;
+	rumpuser_cv_broadcast(d_park);
+	rumpuser_mutex_exit(d_mtx);
+	for (int i = 0; i < D_IDLE; i++)
+		rumpuser_thread_join(di[i]);
+	printf("[D] rounds=%d (expect %d), %lld ns total, %lld ns/handoff\n",
+	    d_rounds, 2 * D_ROUNDS, (long long)dt, (long long)(dt / (2 * D_ROUNDS)));
+	fflush(stdout);
+
+	/* ── Test E ── */
+	printf("== Test E: %d timers, shuffled deadlines ==\n", E_N);
+	fflush(stdout);
+	void *ce[E_N];
+	t0 = mono_ns();
+	for (int i = 0; i < E_N; i++)
+		rumpuser_thread_create(e_sleeper, (void *)(intptr_t)((i * 7) % E_N + 1),
+		    "timer", 1, 0, 0, &ce[i]);
+	for (int i = 0; i < E_N; i++)
+		rumpuser_thread_join(ce[i]);
+	dt = mono_ns() - t0;
+	int e_ordered = e_nlog == E_N;
+	for (int i = 1; i < e_nlog; i++)
+		if (e_log[i] < e_log[i - 1])
+			e_ordered = 0;
+	printf("[E] woke=%d (expect %d), %s, %lld ms total (last deadline %d ms)\n",
+	    e_nlog, E_N, e_ordered ? "in deadline order" : "OUT OF ORDER",
+	    (long long)(dt / 1000000), E_N * E_STEP_MS);
+	fflush(stdout);
+
+	/* ── Test F ── */
+	printf("== Test F: %d create/join, Thread+stack pool ==\n", F_ITERS);
+	fflush(stdout);
+	struct akfiber_stats f0, f1;
+	rumpuser_akuma_fiber_stats(&f0);
+	t0 = mono_ns();
+	for (int i = 0; i < F_ITERS; i++) {
+		void *cf;
+		rumpuser_thread_create(f_worker, NULL, "churn", 1, 0, 0, &cf);
+		rumpuser_thread_join(cf);
+	}
+	dt = mono_ns() - t0;
+	rumpuser_akuma_fiber_stats(&f1);
+	/* each join reaps the previous worker on the next switch: at most one
+	 * fiber is in flight, so the pool must absorb all of them */
+	int f_pooled = f_ran == F_ITERS && f1.fresh == f0.fresh;
+	printf("[F] ran=%d, fresh +%lu, reused +%lu, pool %lu/%lu, %lld ns/create+join\n",
+	    f_ran, f1.fresh - f0.fresh, f1.reused - f0.reused, f1.pool_len,
+	    f1.pool_max, (long long)(dt / F_ITERS));
+	fflush(stdout);
+
+	if (cv_rounds == 2 * ROUNDS && sp_rounds == 2 * ROUNDS &&
+	    d_rounds == 2 * D_ROUNDS && e_ordered && f_pooled) {
 		printf("ALL TESTS PASSED\n");
 		return 0;
 	}
@@ -0,0 +1,687 @@
+/*
+ * test_hijack.c — host unit test for hijack.c's Linux <-> NetBSD translation:
+ * errnos, O_/SOCK_/MSG_/POLL flag bits, a non-blocking connect reporting
+ * EINPROGRESS and then SO_ERROR, EAGAIN from empty sockets, and epoll over
+ * rump fds (knote registration, event merging, mixed host + rump sets).
+ *
+ * hijack.c is compiled into this program, so its libc interposers are live
+ * here, and the rump kernel behind them is the fake below: a table of sockets
+ * whose flags, pending error and readiness the tests set directly, and a
+ * kqueue that keeps knotes and reports the ones marked ready. Host fds (the
+ * placeholders, a pipe, the epoll fd) are real. The fake reports the fiber
+ * backend, so mixed waits take the sliced path and no watcher thread starts.
+ *
+ *     gcc -O2 -Wall -Ihijack_stub -o test_hijack test_hijack.c -ldl -lpthread && ./test_hijack
+ *
+ * PASS = "ALL TESTS PASSED".
+ */
+#include "../hijack.c"
+
+static int failures;
+
+#define CHECK(c, ...) do {						\
+	if (!(c)) {							\
+		fprintf(stderr, "FAIL %s:%d: ", __func__, __LINE__);	\
+		fprintf(stderr, __VA_ARGS__);				\
+		fprintf(stderr, "\n");					\
+		failures++;						\
+	}								\
+} while (0)
+
+/* ── fake rump kernel ────────────────────────────────────────────────────── */
+
+#define NB_EAGAIN	35
+#define NB_EINPROGRESS	36
+#define NB_ECONNREFUSED	61
+#define NB_EBADF	9
+
+#define FK_FDS		64
+#define FK_KNOTES	64
+
+struct fk_fd {
+	int used, kq;
+	int type;		/* socket() type as rump saw it */
+	int fl;			/* NetBSD F_GETFL flags */
+	int so_error;		/* NetBSD errno for SO_ERROR */
+	int connected;
+	size_t avail;		/* bytes readable */
+	short ready;		/* NetBSD poll revents */
+	int last_msg;		/* last sendto/recvfrom flags */
+};
+
+struct fk_knote {
+	int used, kq, ident;
+	uint32_t filter, flags;
+	uintptr_t udata;
+	int ready, eof;
+};
+
+static struct fk_fd fk[FK_FDS];
+static struct fk_knote kn[FK_KNOTES];
+static short fk_poll_asked;	/* last events rump_sys_poll saw */
+
+static int
+fk_alloc(void)
+{
+	int i;
+
+	for (i = 3; i < FK_FDS; i++)
+		if (!fk[i].used) {
+			memset(&fk[i], 0, sizeof(fk[i]));
+			fk[i].used = 1;
+			fk[i].fl = 2;	/* O_RDWR */
+			return i;
+		}
+	errno = 24;
+	return -1;
+}
+
+static struct fk_fd *
+fk_get(int fd)
+{
+	if (fd < 0 || fd >= FK_FDS || !fk[fd].used) {
+		errno = NB_EBADF;
+		return NULL;
+	}
+	return &fk[fd];
+}
+
+static struct fk_knote *
+fk_knote(int kq, int ident, uint32_t filter)
+{
+	int i;
+
+	for (i = 0; i < FK_KNOTES; i++)
+		if (kn[i].used && kn[i].kq == kq && kn[i].ident == ident &&
+		    kn[i].filter == filter)
+			return &kn[i];
+	return NULL;
+}
+
+int rump_init(void) { return 0; }
+int rump_pub_netconfig_ifcreate(const char *i) { (void)i; return 0; }
+int rump_pub_netconfig_ifup(const char *i) { (void)i; return 0; }
+int rump_pub_netconfig_ipv4_ifaddr(const char *i, const char *a, const char *m)
+{ (void)i; (void)a; (void)m; return 0; }
+int rump_pub_netconfig_ipv4_gw(const char *g) { (void)g; return 0; }
+int rump_pub_netconfig_dhcp_ipv4_oneshot(const char *i) { (void)i; return 0; }
+void virtif_dump_stats(void) {}
+int rumpuser_akuma_fiber_stats(void *out) { (void)out; return 0; }
+
+int
+rump_sys_socket(int dom, int type, int proto)
+{
+	int fd = fk_alloc();
+
+	(void)dom; (void)proto;
+	if (fd < 0)
+		return -1;
+	fk[fd].type = type;
+	if (type & NETBSD_SOCK_NONBLOCK)
+		fk[fd].fl |= NETBSD_O_NONBLOCK;
+	return fd;
+}
+
+int
+rump_sys_connect(int fd, const struct sockaddr *sa, socklen_t len)
+{
+	const struct nb_sockaddr_in *nb = (const void *)sa;
+	struct fk_fd *s = fk_get(fd);
+
+	if (s == NULL)
+		return -1;
+	if (len != sizeof(*nb) || nb->sin_len != sizeof(*nb) ||
+	    nb->sin_family != 2) {
+		errno = 22;
+		return -1;
+	}
+	if (s->fl & NETBSD_O_NONBLOCK) {
+		errno = NB_EINPROGRESS;
+		return -1;
+	}
+	s->connected = 1;
+	return 0;
+}
+
+static ssize_t
+fk_recv(int fd, size_t n, int nbflags)
+{
+	struct fk_fd *s = fk_get(fd);
+
+	if (s == NULL)
+		return -1;
+	s->last_msg = nbflags;
+	if (s->avail == 0) {
+		if ((s->fl & NETBSD_O_NONBLOCK) ||
+		    (nbflags & NETBSD_MSG_DONTWAIT)) {
+			errno = NB_EAGAIN;
+			return -1;
+		}
+		return 0;
+	}
+	if (n > s->avail)
+		n = s->avail;
+	s->avail -= n;
+	return (ssize_t)n;
+}
+
+ssize_t rump_sys_read(int fd, void *b, size_t n)
+{ (void)b; return fk_recv(fd, n, 0); }
+ssize_t rump_sys_readv(int fd, const struct iovec *iov, int cnt)
+{ (void)cnt; return fk_recv(fd, iov[0].iov_len, 0); }
+ssize_t rump_sys_recvfrom(int fd, void *b, size_t n, int fl,
+    struct sockaddr *sa, socklen_t *len)
+{ (void)b; (void)sa; (void)len; return fk_recv(fd, n, fl); }
+
+ssize_t
+rump_sys_sendto(int fd, const void *b, size_t n, int fl,
+    const struct sockaddr *sa, socklen_t len)
+{
+	struct fk_fd *s = fk_get(fd);
+
+	(void)b; (void)sa; (void)len;
+	if (s == NULL)
+		return -1;
+	s->last_msg = fl;
+	return (ssize_t)n;
+}
+
+ssize_t rump_sys_write(int fd, const void *b, size_t n)
+{ return rump_sys_sendto(fd, b, n, 0, NULL, 0); }
+ssize_t rump_sys_writev(int fd, const struct iovec *iov, int cnt)
+{ (void)cnt; return rump_sys_sendto(fd, NULL, iov[0].iov_len, 0, NULL, 0); }
+
+int
+rump_sys_getsockopt(int fd, int level, int opt, void *val, socklen_t *len)
+{
+	struct fk_fd *s = fk_get(fd);
+
+	if (s == NULL)
+		return -1;
+	if (level != NETBSD_SOL_SOCKET || opt != NETBSD_SO_ERROR ||
+	    *len < sizeof(int)) {
+		errno = 42;
+		return -1;
+	}
+	*(int *)val = s->so_error;
+	s->so_error = 0;
+	return 0;
+}
+
+int rump_sys_setsockopt(int fd, int l, int o, const void *v, socklen_t n)
+{ (void)l; (void)o; (void)v; (void)n; return fk_get(fd) ? 0 : -1; }
+
+int
+rump_sys_close(int fd)
+{
+	int i;
+
+	if (fk_get(fd) == NULL)
+		return -1;
+	for (i = 0; i < FK_KNOTES; i++)
+		if (kn[i].used && (kn[i].ident == fd || kn[i].kq == fd))
+			kn[i].used = 0;
+	fk[fd].used = 0;
+	return 0;
+}
+
+int
+rump_sys_dup(int fd)
+{
+	struct fk_fd *s = fk_get(fd);
+	int nfd;
+
+	if (s == NULL || (nfd = fk_alloc()) < 0)
+		return -1;
+	fk[nfd] = *s;
+	return nfd;
+}
+
+int
+rump_sys_pipe2(int *p, int fl)
+{
+	(void)fl;
+	if ((p[0] = fk_alloc()) < 0 || (p[1] = fk_alloc()) < 0)
+		return -1;
+	return 0;
+}
+
+int
+rump_sys_poll(struct pollfd *p, nfds_t n, int timeout)
+{
+	nfds_t i;
+	int ready = 0;
+
+	(void)timeout;
+	for (i = 0; i < n; i++) {
+		struct fk_fd *s = fk_get(p[i].fd);
+
+		fk_poll_asked = p[i].events;
+		p[i].revents = s ? s->ready & (p[i].events | POLLERR | POLLHUP) :
+		    POLLNVAL;
+		if (p[i].revents)
+			ready++;
+	}
+	return ready;
+}
+
+int
+rump_sys_fcntl(int fd, int cmd, ...)
+{
+	struct fk_fd *s = fk_get(fd);
+	va_list ap;
+
+	if (s == NULL)
+		return -1;
+	if (cmd == LINUX_F_GETFL)
+		return s->fl;
+	if (cmd == LINUX_F_SETFL) {
+		va_start(ap, cmd);
+		s->fl = va_arg(ap, int);
+		va_end(ap);
+		return 0;
+	}
+	errno = 22;
+	return -1;
+}
+
+int
+rump_sys_kqueue(void)
+{
+	int fd = fk_alloc();
+
+	if (fd >= 0)
+		fk[fd].kq = 1;
+	return fd;
+}
+
+int
+rump_sys_kevent(int kq, const void *chg, size_t nchg, void *evl, size_t nev,
+    const struct timespec *ts)
+{
+	const struct nb_kevent *c = chg;
+	struct nb_kevent *out = evl;
+	struct fk_knote *k;
+	size_t i;
+	int j, n = 0;
+
+	(void)ts;
+	if (fk_get(kq) == NULL || !fk[kq].kq)
+		return -1;
+	for (i = 0; i < nchg; i++) {
+		k = fk_knote(kq, (int)c[i].ident, c[i].filter);
+		if (c[i].flags & NB_EV_DELETE) {
+			if (k == NULL) {
+				errno = NB_ENOENT;
+				return -1;
+			}
+			k->used = 0;
+			continue;
+		}
+		if (k == NULL) {
+			for (j = 0; j < FK_KNOTES && kn[j].used; j++)
+				;
+			if (j == FK_KNOTES) {
+				errno = 12;
+				return -1;
+			}
+			k = &kn[j];
+			memset(k, 0, sizeof(*k));
+			k->used = 1;
+			k->kq = kq;
+			k->ident = (int)c[i].ident;
+			k->filter = c[i].filter;
+		}
+		k->flags = c[i].flags & ~NB_EV_ADD;
+		k->udata = c[i].udata;
+	}
+	for (j = 0; j < FK_KNOTES && (size_t)n < nev; j++) {
+		k = &kn[j];
+		if (!k->used || k->kq != kq || !k->ready)
+			continue;
+		out[n] = (struct nb_kevent){ .ident = (uintptr_t)k->ident,
+		    .filter = k->filter, .flags = k->eof ? NB_EV_EOF : 0,
+		    .udata = k->udata };
+		n++;
+		if (k->flags & NB_EV_ONESHOT)
+			k->used = 0;
+	}
+	return n;
+}
+
+/* ── tests ───────────────────────────────────────────────────────────────── */
+
+static void
+test_errno_map(void)
+{
+	CHECK(linux_errno(NB_EAGAIN) == EAGAIN, "EAGAIN %d", linux_errno(35));
+	CHECK(linux_errno(NB_EINPROGRESS) == EINPROGRESS, "EINPROGRESS");
+	CHECK(linux_errno(NB_ECONNREFUSED) == ECONNREFUSED, "ECONNREFUSED");
+	CHECK(linux_errno(65) == EHOSTUNREACH, "EHOSTUNREACH");
+	/* 1..34 are shared; past the table stays as is */
+	CHECK(linux_errno(NB_EBADF) == EBADF, "EBADF");
+	CHECK(linux_errno(0) == 0 && linux_errno(200) == 200, "passthrough");
+	errno = NB_EAGAIN;
+	CHECK(rv_int(-1) == -1 && errno == EAGAIN, "rv_int");
+	errno = NB_EAGAIN;
+	CHECK(rv_int(0) == 0 && errno == NB_EAGAIN, "rv_int success kept errno");
+}
+
+static void
+test_flag_bits(void)
+{
+	CHECK(fl_to_nb(O_RDWR | O_NONBLOCK | O_APPEND) ==
+	    (2 | NETBSD_O_NONBLOCK | NETBSD_O_APPEND), "fl_to_nb");
+	CHECK(fl_from_nb(2 | NETBSD_O_NONBLOCK) == (O_RDWR | O_NONBLOCK),
+	    "fl_from_nb");
+	CHECK(fl_from_nb(fl_to_nb(O_WRONLY | O_APPEND)) == (O_WRONLY | O_APPEND),
+	    "round trip");
+	CHECK(msg_to_nb(MSG_DONTWAIT | MSG_NOSIGNAL | MSG_PEEK) ==
+	    (NETBSD_MSG_DONTWAIT | NETBSD_MSG_NOSIGNAL | MSG_PEEK), "msg_to_nb");
+	/* Linux MSG_DONTWAIT is NetBSD's MSG_WAITALL bit */
+	CHECK(msg_to_nb(MSG_DONTWAIT) == NETBSD_MSG_DONTWAIT, "DONTWAIT %#x",
+	    msg_to_nb(MSG_DONTWAIT));
+	CHECK(msg_to_nb(MSG_WAITALL | MSG_EOR | MSG_OOB) ==
+	    (NETBSD_MSG_WAITALL | NETBSD_MSG_EOR | MSG_OOB), "WAITALL/EOR");
+	CHECK(msg_to_nb(MSG_TRUNC | MSG_CTRUNC) ==
+	    (NETBSD_MSG_TRUNC | NETBSD_MSG_CTRUNC), "TRUNC/CTRUNC");
+	CHECK(poll_to_nb(POLLIN | POLLWRNORM) == (POLLIN | POLLOUT),
+	    "poll_to_nb WRNORM");
+	CHECK(poll_to_nb(POLLWRBAND) == NETBSD_POLLWRBAND, "poll_to_nb WRBAND");
+	CHECK(poll_from_nb(POLLOUT, POLLOUT | POLLWRNORM) ==
+	    (POLLOUT | POLLWRNORM), "poll_from_nb asked WRNORM");
+	CHECK(poll_from_nb(POLLOUT, POLLOUT) == POLLOUT, "poll_from_nb plain");
+	CHECK(poll_from_nb(NETBSD_POLLWRBAND, POLLWRBAND) == POLLWRBAND,
+	    "poll_from_nb WRBAND");
+}
+
+static struct sockaddr_in
+peer(void)
+{
+	struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(80),
+	    .sin_addr.s_addr = htonl(0x0a000001) };
+	return sa;
+}
+
+static void
+test_nonblocking_connect(void)
+{
+	struct sockaddr_in sa = peer();
+	struct pollfd p;
+	socklen_t len;
+	int fd, rfd, err, fl;
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	CHECK(fd >= 0, "socket: %s", strerror(errno));
+	if (fd < 0)
+		return;
+	rfd = hj_rfd(fd);
+	CHECK(rfd >= 0, "not a rump fd");
+	CHECK(fk[rfd].type == (SOCK_STREAM | NETBSD_SOCK_NONBLOCK |
+	    NETBSD_SOCK_CLOEXEC), "type %#x", fk[rfd].type);
+	CHECK(fcntl(fd, F_GETFD) == FD_CLOEXEC, "FD_CLOEXEC on the placeholder");
+	fl = fcntl(fd, F_GETFL);
+	CHECK(fl == (O_RDWR | O_NONBLOCK), "F_GETFL %#x", fl);
+
+	errno = 0;
+	CHECK(connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 &&
+	    errno == EINPROGRESS, "connect errno %d", errno);
+
+	/* POLLOUT becomes ready, SO_ERROR tells the outcome */
+	fk[rfd].ready = POLLOUT;
+	fk[rfd].so_error = NB_ECONNREFUSED;
+	p = (struct pollfd){ .fd = fd, .events = POLLOUT | POLLWRNORM };
+	CHECK(poll(&p, 1, 0) == 1 && p.revents == (POLLOUT | POLLWRNORM),
+	    "poll revents %#x", p.revents);
+	CHECK(fk_poll_asked == POLLOUT, "rump asked %#x", fk_poll_asked);
+	len = sizeof(err);
+	CHECK(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 &&
+	    err == ECONNREFUSED && len == sizeof(err), "SO_ERROR %d", err);
+	CHECK(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0,
+	    "SO_ERROR cleared %d", err);
+	CHECK(close(fd) == 0 && !fk[rfd].used && hj_rfd(fd) == -1, "close");
+}
+
+static void
+test_setfl_and_eagain(void)
+{
+	struct sockaddr_in sa = peer();
+	char buf[16];
+	struct iovec iov = { buf, sizeof(buf) };
+	int fd, rfd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(fd >= 0, "socket");
+	if (fd < 0)
+		return;
+	rfd = hj_rfd(fd);
+	CHECK(fcntl(fd, F_GETFL) == O_RDWR, "blocking F_GETFL");
+
+	/* blocking: MSG_DONTWAIT still gives EAGAIN, translated */
+	errno = 0;
+	CHECK(recv(fd, buf, sizeof(buf), MSG_DONTWAIT) == -1 && errno == EAGAIN,
+	    "recv MSG_DONTWAIT errno %d", errno);
+	CHECK(fk[rfd].last_msg == NETBSD_MSG_DONTWAIT, "flags %#x",
+	    fk[rfd].last_msg);
+	CHECK(send(fd, buf, 4, MSG_NOSIGNAL) == 4 &&
+	    fk[rfd].last_msg == NETBSD_MSG_NOSIGNAL, "send flags %#x",
+	    fk[rfd].last_msg);
+
+	CHECK(fcntl(fd, F_SETFL, O_RDWR | O_NONBLOCK) == 0, "F_SETFL");
+	CHECK(fk[rfd].fl == (2 | NETBSD_O_NONBLOCK), "rump fl %#x", fk[rfd].fl);
+	errno = 0;
+	CHECK(read(fd, buf, sizeof(buf)) == -1 && errno == EAGAIN,
+	    "read errno %d", errno);
+	errno = 0;
+	CHECK(readv(fd, &iov, 1) == -1 && errno == EAGAIN, "readv errno %d",
+	    errno);
+	errno = 0;
+	CHECK(connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == -1 &&
+	    errno == EINPROGRESS, "connect after F_SETFL errno %d", errno);
+	fk[rfd].avail = 3;
+	CHECK(read(fd, buf, sizeof(buf)) == 3, "read data");
+
+	CHECK(fcntl(fd, F_SETFL, O_RDWR) == 0 && fcntl(fd, F_GETFL) == O_RDWR,
+	    "clear O_NONBLOCK");
+	close(fd);
+}
+
+static struct hj_epoll *
+ep_of(int epfd)
+{
+	struct hj_epoll *ep;
+
+	pthread_mutex_lock(&hj_ep_mtx);
+	ep = hj_ep_find(epfd);
+	pthread_mutex_unlock(&hj_ep_mtx);
+	return ep;
+}
+
+static void
+test_epoll_rump(void)
+{
+	struct epoll_event ev, out[8];
+	struct fk_knote *r, *w;
+	struct hj_epoll *ep;
+	int epfd, fd, rfd, kq, n;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	CHECK(epfd >= 0 && fd >= 0, "setup");
+	if (epfd < 0 || fd < 0)
+		return;
+	rfd = hj_rfd(fd);
+	ep = ep_of(epfd);
+	CHECK(ep != NULL && ep->kq == -1, "kqueue made lazily");
+
+	ev = (struct epoll_event){ .events = EPOLLIN | EPOLLOUT | EPOLLET,
+	    .data.u64 = 42 };
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0, "ADD");
+	kq = ep->kq;
+	CHECK(kq >= 0 && ep->nreg == 1, "registered");
+	r = fk_knote(kq, rfd, NB_EVFILT_READ);
+	w = fk_knote(kq, rfd, NB_EVFILT_WRITE);
+	CHECK(r && w && r->flags == NB_EV_CLEAR && w->flags == NB_EV_CLEAR &&
+	    r->udata == 42 && w->udata == 42, "knotes EPOLLET -> EV_CLEAR");
+	errno = 0;
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1 && errno == EEXIST,
+	    "second ADD errno %d", errno);
+
+	/* both directions ready: one merged event */
+	r->ready = w->ready = 1;
+	n = epoll_wait(epfd, out, 8, 0);
+	CHECK(n == 1 && out[0].events == (EPOLLIN | EPOLLOUT) &&
+	    out[0].data.u64 == 42, "merged n=%d ev=%#x", n, out[0].events);
+
+	/* peer closed: EOF on the read knote */
+	w->ready = 0;
+	r->eof = 1;
+	n = epoll_wait(epfd, out, 8, 0);
+	CHECK(n == 1 && out[0].events == (EPOLLIN | EPOLLRDHUP),
+	    "EOF ev=%#x", out[0].events);
+	r->eof = r->ready = 0;
+
+	/* MOD to EPOLLIN only drops the write knote */
+	ev = (struct epoll_event){ .events = EPOLLIN, .data.u64 = 7 };
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0, "MOD");
+	CHECK(fk_knote(kq, rfd, NB_EVFILT_WRITE) == NULL, "write knote gone");
+	r = fk_knote(kq, rfd, NB_EVFILT_READ);
+	CHECK(r && r->flags == 0 && r->udata == 7, "read knote updated");
+	/* MOD again: deleting the absent write knote is not an error */
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == 0, "MOD twice");
+
+	CHECK(epoll_wait(epfd, out, 8, 0) == 0, "nothing ready");
+
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL) == 0 && ep->nreg == 0 &&
+	    fk_knote(kq, rfd, NB_EVFILT_READ) == NULL, "DEL");
+	errno = 0;
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL) == -1 && errno == ENOENT,
+	    "DEL twice errno %d", errno);
+	errno = 0;
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) == -1 && errno == ENOENT,
+	    "MOD unregistered errno %d", errno);
+
+	/* EPOLLONESHOT -> EV_ONESHOT: reported once */
+	ev = (struct epoll_event){ .events = EPOLLIN | EPOLLONESHOT,
+	    .data.u64 = 9 };
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0, "ADD oneshot");
+	r = fk_knote(kq, rfd, NB_EVFILT_READ);
+	CHECK(r && r->flags == NB_EV_ONESHOT, "EV_ONESHOT");
+	if (r)
+		r->ready = 1;
+	CHECK(epoll_wait(epfd, out, 8, 0) == 1 && out[0].data.u64 == 9,
+	    "oneshot fires");
+	CHECK(epoll_wait(epfd, out, 8, 0) == 0, "oneshot fired once");
+
+	/* closing the socket drops it from the set */
+	close(fd);
+	CHECK(ep->nreg == 0, "close forgets the fd");
+	close(epfd);
+	CHECK(ep_of(epfd) == NULL && !fk[kq].used, "epoll close frees the kqueue");
+}
+
+static void
+test_epoll_mixed(void)
+{
+	struct epoll_event ev, out[8];
+	struct fk_knote *r;
+	long t0;
+	int epfd, fd, rfd, p[2], n, i, got_host = 0, got_rump = 0;
+	char c = 'x';
+
+	epfd = epoll_create(1);
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(epfd >= 0 && fd >= 0 && pipe(p) == 0, "setup");
+	rfd = hj_rfd(fd);
+
+	ev = (struct epoll_event){ .events = EPOLLIN, .data.u64 = 1 };
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_ADD, p[0], &ev) == 0, "ADD host");
+	ev = (struct epoll_event){ .events = EPOLLIN, .data.u64 = 2 };
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0, "ADD rump");
+	CHECK(ep_of(epfd)->nhost == 1, "nhost");
+
+	/* both sides ready: host events first, then rump */
+	CHECK(write(p[1], &c, 1) == 1, "pipe write");
+	r = fk_knote(ep_of(epfd)->kq, rfd, NB_EVFILT_READ);
+	if (r)
+		r->ready = 1;
+	n = epoll_wait(epfd, out, 8, 1000);
+	for (i = 0; i < n; i++) {
+		got_host += out[i].data.u64 == 1 && out[i].events == EPOLLIN;
+		got_rump += out[i].data.u64 == 2 && out[i].events == EPOLLIN;
+	}
+	CHECK(n == 2 && got_host == 1 && got_rump == 1, "mixed n=%d", n);
+
+	/* maxevents 1: the host event fills it */
+	n = epoll_wait(epfd, out, 1, 0);
+	CHECK(n == 1 && out[0].data.u64 == 1, "maxevents=1 n=%d", n);
+
+	/* nothing ready: times out in slices */
+	CHECK(read(p[0], &c, 1) == 1, "pipe read");
+	if (r)
+		r->ready = 0;
+	t0 = now_ms();
+	n = epoll_wait(epfd, out, 8, 30);
+	CHECK(n == 0 && now_ms() - t0 >= 25, "timeout n=%d after %ld ms", n,
+	    now_ms() - t0);
+
+	/* rump side alone */
+	if (r)
+		r->ready = 1;
+	n = epoll_wait(epfd, out, 8, 1000);
+	CHECK(n == 1 && out[0].data.u64 == 2, "rump only n=%d", n);
+
+	CHECK(epoll_ctl(epfd, EPOLL_CTL_DEL, p[0], NULL) == 0 &&
+	    ep_of(epfd)->nhost == 0, "DEL host");
+	close(fd);
+	close(p[0]);
+	close(p[1]);
+	close(epfd);
+}
+
+static void
+test_poll_mixed(void)
+{
+	struct pollfd pf[3];
+	int fd, rfd, p[2];
+	char c = 'x';
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	CHECK(fd >= 0 && pipe(p) == 0, "setup");
+	rfd = hj_rfd(fd);
+	CHECK(write(p[1], &c, 1) == 1, "pipe write");
+	fk[rfd].ready = POLLIN;
+
+	pf[0] = (struct pollfd){ .fd = p[0], .events = POLLIN };
+	pf[1] = (struct pollfd){ .fd = -1, .events = POLLIN, .revents = 7 };
+	pf[2] = (struct pollfd){ .fd = fd, .events = POLLIN | POLLOUT };
+	CHECK(poll(pf, 3, 1000) == 2, "two ready");
+	CHECK(pf[0].revents == POLLIN && pf[1].revents == 0 &&
+	    pf[2].revents == POLLIN, "revents %#x %#x %#x", pf[0].revents,
+	    pf[1].revents, pf[2].revents);
+
+	fk[rfd].ready = 0;
+	CHECK(read(p[0], &c, 1) == 1, "pipe read");
+	CHECK(poll(pf, 3, 20) == 0, "timeout");
+	close(fd);
+	close(p[0]);
+	close(p[1]);
+}
+
+int
+main(void)
+{
+	test_errno_map();
+	test_flag_bits();
+	test_nonblocking_connect();
+	test_setfl_and_eagain();
+	test_epoll_rump();
+	test_epoll_mixed();
+	test_poll_mixed();
+	if (failures) {
+		printf("%d FAILURE(S)\n", failures);
+		return 1;
+	}
+	printf("ALL TESTS PASSED\n");
+	return 0;
+}
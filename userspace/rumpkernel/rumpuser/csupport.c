@@ -8,31 +8,145 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /*
- * DIAGNOSTIC: override rump's optimized aarch64 memset (rumpns_memset), which
- * miscomputes its loop bound on a small zero-fill in our environment and walks
- * off the allocation (SIGSEGV in early uvm_init). A trivial byte loop lets us
- * confirm that's the sole blocker. Linked with -Wl,--allow-multiple-definition
- * so this strong definition wins over the one in librump.a. (Proper fix: build
- * librump with the generic libkern memset, or carry this override.)
+ * libkern mem/str overrides: rumpns_{memset,memcpy,memmove,strlen,strcmp,
+ * strncmp}, linked with -Wl,--allow-multiple-definition so these strong
+ * definitions win over the ones in librump.a.
+ *
+ * Why override at all: rump's optimized aarch64 memset miscomputed its loop
+ * bound on a small zero-fill in our environment and walked off the allocation
+ * (SIGSEGV in early uvm_init; strlen/memcpy misbehaved the same way, see
+ * docs/PHASE2_RUMPUSER.md). Byte loops got us booting, but every mbuf copy,
+ * sockbuf move and copyin/copyout then ran a byte per iteration.
+ *
+ * These are wide again but stay inside what was proven safe: plain loads and
+ * stores only (no DC ZVA, no DCZID_EL0 probe), never touching a byte outside
+ * [p, p+len). The one read-ahead is strlen's, which reads aligned 8-byte words
+ * and so never crosses a page the string does not reach. Bulk moves are 64
+ * bytes per iteration in NEON q registers on aarch64, 8-byte words elsewhere;
+ * the destination is word-aligned first and the source may be unaligned
+ * (unaligned loads are fine on normal memory).
  */
-void *
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CS_NEON 1
+#endif
+
+/* Keep GCC from recognising the loops below as memset/memcpy and calling
+ * libc's (or, worse, back into ourselves). */
+#if defined(__GNUC__) && !defined(__clang__)
+#define CS_NOLIBCALL __attribute__((optimize("no-tree-loop-distribute-patterns")))
+#else
+#define CS_NOLIBCALL
+#endif
+
+#define CS_SMALL 16	/* below this, a byte loop beats the setup */
+#define CS_ONES  0x0101010101010101ULL
+#define CS_HIGHS 0x8080808080808080ULL
+
+/* Fixed-size builtin copies: a single (possibly unaligned) ldr/str, no call. */
+static inline uint64_t
+cs_ld64(const unsigned char *p)
+{
+	uint64_t w;
+	__builtin_memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+static inline void
+cs_st64(unsigned char *p, uint64_t w)
+{
+	__builtin_memcpy(p, &w, sizeof(w));
+}
+
+CS_NOLIBCALL void *
 rumpns_memset(void *b, int c, size_t len)
 {
 	unsigned char *p = b;
+	uint64_t w = (unsigned char)c * CS_ONES;
+
+	if (len >= CS_SMALL) {
+		for (; (uintptr_t)p & 7; len--)
+			*p++ = (unsigned char)c;
+#ifdef CS_NEON
+		uint8x16_t v = vdupq_n_u8((uint8_t)c);
+		for (; len >= 64; len -= 64, p += 64) {
+			vst1q_u8(p, v);
+			vst1q_u8(p + 16, v);
+			vst1q_u8(p + 32, v);
+			vst1q_u8(p + 48, v);
+		}
+#endif
+		for (; len >= 8; len -= 8, p += 8)
+			cs_st64(p, w);
+	}
 	while (len--)
 		*p++ = (unsigned char)c;
 	return b;
 }
 
-void *
-rumpns_memcpy(void *d, const void *s, size_t n)
+/* Forward copy; also what memmove uses when d is below s. */
+CS_NOLIBCALL static void
+cs_copy_fwd(unsigned char *dp, const unsigned char *sp, size_t n)
 {
-	unsigned char *dp = d;
-	const unsigned char *sp = s;
+	if (n >= CS_SMALL) {
+		for (; (uintptr_t)dp & 7; n--)
+			*dp++ = *sp++;
+#ifdef CS_NEON
+		for (; n >= 64; n -= 64, dp += 64, sp += 64) {
+			/* all four loads before the stores: safe for d < s overlap */
+			uint8x16_t a = vld1q_u8(sp), b = vld1q_u8(sp + 16);
+			uint8x16_t c = vld1q_u8(sp + 32), d = vld1q_u8(sp + 48);
+			vst1q_u8(dp, a);
+			vst1q_u8(dp + 16, b);
+			vst1q_u8(dp + 32, c);
+			vst1q_u8(dp + 48, d);
+		}
+#endif
+		for (; n >= 8; n -= 8, dp += 8, sp += 8)
+			cs_st64(dp, cs_ld64(sp));
+	}
 	while (n--)
 		*dp++ = *sp++;
+}
+
+/* Backward copy from the ends, for memmove with d above s. */
+CS_NOLIBCALL static void
+cs_copy_bwd(unsigned char *dp, const unsigned char *sp, size_t n)
+{
+	dp += n;
+	sp += n;
+	if (n >= CS_SMALL) {
+		for (; (uintptr_t)dp & 7; n--)
+			*--dp = *--sp;
+#ifdef CS_NEON
+		for (; n >= 64; n -= 64) {
+			dp -= 64;
+			sp -= 64;
+			uint8x16_t a = vld1q_u8(sp), b = vld1q_u8(sp + 16);
+			uint8x16_t c = vld1q_u8(sp + 32), d = vld1q_u8(sp + 48);
+			vst1q_u8(dp, a);
+			vst1q_u8(dp + 16, b);
+			vst1q_u8(dp + 32, c);
+			vst1q_u8(dp + 48, d);
+		}
+#endif
+		for (; n >= 8; n -= 8) {
+			dp -= 8;
+			sp -= 8;
+			cs_st64(dp, cs_ld64(sp));
+		}
+	}
+	while (n--)
+		*--dp = *--sp;
+}
+
+void *
+rumpns_memcpy(void *d, const void *s, size_t n)
+{
+	cs_copy_fwd(d, s, n);
 	return d;
 }
 
@@ -41,15 +155,11 @@ rumpns_memmove(void *d, const void *s, size_t n)
 {
 	unsigned char *dp = d;
 	const unsigned char *sp = s;
-	if (dp < sp) {
-		while (n--)
-			*dp++ = *sp++;
-	} else {
-		dp += n;
-		sp += n;
-		while (n--)
-			*--dp = *--sp;
-	}
+
+	if (dp <= sp || dp >= sp + n)
+		cs_copy_fwd(dp, sp, n);
+	else
+		cs_copy_bwd(dp, sp, n);
 	return d;
 }
 
@@ -57,11 +167,25 @@ size_t
 rumpns_strlen(const char *s)
 {
 	const char *p = s;
-	while (*p)
-		p++;
+	uint64_t v;
+
+	for (; (uintptr_t)p & 7; p++)
+		if (*p == '\0')
+			return (size_t)(p - s);
+	/* a word has a zero byte iff this is nonzero */
+	for (;; p += 8) {
+		v = cs_ld64((const unsigned char *)p);
+		if ((v - CS_ONES) & ~v & CS_HIGHS)
+			break;
+	}
+	for (; *p; p++)
+		;
 	return (size_t)(p - s);
 }
 
+/* strcmp/strncmp stay byte loops: the kernel compares short names (device,
+ * pool, sysctl), where a word loop's alignment setup would not pay. */
+
 int
 rumpns_strcmp(const char *a, const char *b)
 {
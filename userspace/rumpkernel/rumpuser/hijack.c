@@ -12,13 +12,28 @@
  *  - constructor: rump_init() + create/address/up virt0 (the virtif NIC, backed
  *    by the host TAP via the instrumented virtif backend) + default route.
  *  - libc interposition: socket, connect, send, recv, read, write, close, poll,
- *    fcntl, setsockopt are overridden. AF_INET/AF_INET6 sockets are created in the
- *    rump fd space and handed back with a high offset (RUMP_FDOFF) so we can tell
- *    them apart from real libc fds; calls on those fds route to rump_sys_*, and
- *    everything else falls through to the real libc symbol (dlsym RTLD_NEXT).
- *  - Linux sockaddr_in is translated to NetBSD layout (which has sin_len).
+ *    fcntl, dup*, setsockopt, epoll_*, sendfile, splice are overridden.
+ *    AF_INET/AF_INET6 sockets are created in the rump fd space, and each is
+ *    handed back as a host fd of its own whose slot in a flat table names the
+ *    rump fd (see "fd table" below); calls on those fds route to rump_sys_*,
+ *    and everything else falls through to the real libc symbol, looked up
+ *    once at init (dlsym RTLD_NEXT).
+ *  - Linux sockaddr_in is translated to NetBSD layout (which has sin_len), and
+ *    so are the constants that differ: O_NONBLOCK/SOCK_NONBLOCK, MSG_* flags,
+ *    POLLWR*, and the errnos of the network block (EAGAIN, EINPROGRESS, ...).
+ *  - Non-blocking rump sockets behave as on Linux: connect() reports
+ *    EINPROGRESS and getsockopt(SO_ERROR) the outcome.
+ *  - poll() and epoll take sets mixing host and rump fds: poll() splits the
+ *    set and waits on both halves at once (see "poll" below). An epoll
+ *    instance stays a real host epoll fd for its host fds, with a rump kqueue
+ *    beside it for its rump fds (see "epoll" below).
+ *  - sendfile()/splice() into a rump socket hand a regular file to the rump
+ *    stack from a mapped view, a large window per rump_sys_write, instead of
+ *    through the app's buffers (see "sendfile / splice" below).
  *
- * Scope: the wget GET path (no DNS - use an IP URL). Not a complete hijack.
+ * Scope: client paths (no DNS - use an IP URL; no accept). Not a complete hijack.
+ * The translation and epoll paths have a host test against a fake rump kernel,
+ * c_tests/test_hijack.c.
  */
 #define _GNU_SOURCE
 #include <sys/types.h>   /* dev_t / u_long for the rump VFS decls pulled in by rump.h */
@@ -31,7 +46,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/uio.h>
 #include <netinet/in.h>
 
@@ -40,10 +63,7 @@
 #include <rump/netconfig.h>
 
 void virtif_dump_stats(void);   /* from virtif_user_instr.c */
-
-#define RUMP_FDOFF 0x40000000     /* rump fds carry this offset in the app's view */
-#define ISRUMP(fd) ((fd) >= RUMP_FDOFF)
-#define R(fd)      ((fd) - RUMP_FDOFF)
+int rumpuser_akuma_fiber_stats(void *out);   /* -1 on the pthread backend */
 
 /* AF_INET == 2 on both Linux and NetBSD; AF_INET6 differs (Linux 10, NetBSD 24). */
 #define LINUX_AF_INET6  10
@@ -58,7 +78,147 @@ struct nb_sockaddr_in {
 	uint8_t  sin_zero[8];
 };
 
-/* Real libc entry points. */
+/* rump_sys_* leave a NetBSD errno in errno. 1..34 match Linux; the network
+ * block from 35 up is numbered differently. */
+static const unsigned char nb_errno[] = {
+	[35] = EAGAIN,		[36] = EINPROGRESS,	[37] = EALREADY,
+	[38] = ENOTSOCK,	[39] = EDESTADDRREQ,	[40] = EMSGSIZE,
+	[41] = EPROTOTYPE,	[42] = ENOPROTOOPT,	[43] = EPROTONOSUPPORT,
+	[44] = ESOCKTNOSUPPORT,	[45] = EOPNOTSUPP,	[46] = EPFNOSUPPORT,
+	[47] = EAFNOSUPPORT,	[48] = EADDRINUSE,	[49] = EADDRNOTAVAIL,
+	[50] = ENETDOWN,	[51] = ENETUNREACH,	[52] = ENETRESET,
+	[53] = ECONNABORTED,	[54] = ECONNRESET,	[55] = ENOBUFS,
+	[56] = EISCONN,		[57] = ENOTCONN,	[58] = ESHUTDOWN,
+	[59] = ETOOMANYREFS,	[60] = ETIMEDOUT,	[61] = ECONNREFUSED,
+	[62] = ELOOP,		[63] = ENAMETOOLONG,	[64] = EHOSTDOWN,
+	[65] = EHOSTUNREACH,
+};
+
+static int
+linux_errno(int e)
+{
+	if (e > 0 && e < (int)sizeof(nb_errno) && nb_errno[e] != 0)
+		return nb_errno[e];
+	return e;
+}
+
+/* Return a rump_sys_* result, with errno made Linux's on failure. */
+static int
+rv_int(int rv)
+{
+	if (rv == -1)
+		errno = linux_errno(errno);
+	return rv;
+}
+
+static ssize_t
+rv_ssz(ssize_t rv)
+{
+	if (rv == -1)
+		errno = linux_errno(errno);
+	return rv;
+}
+
+/* Flag bits that differ. fcntl: O_NONBLOCK, O_APPEND. socket() type:
+ * SOCK_NONBLOCK, SOCK_CLOEXEC. send/recv: everything above MSG_OOB/PEEK/
+ * DONTROUTE (Linux's 0x40 is MSG_DONTWAIT, NetBSD's is MSG_WAITALL). */
+#define LINUX_O_NONBLOCK	0x800
+#define LINUX_O_APPEND		0x400
+#define NETBSD_O_NONBLOCK	0x4
+#define NETBSD_O_APPEND		0x8
+#define LINUX_SOCK_NONBLOCK	0x800
+#define LINUX_SOCK_CLOEXEC	0x80000
+#define NETBSD_SOCK_NONBLOCK	0x20000000
+#define NETBSD_SOCK_CLOEXEC	0x10000000
+#define LINUX_MSG_CTRUNC	0x8
+#define LINUX_MSG_TRUNC		0x20
+#define LINUX_MSG_DONTWAIT	0x40
+#define LINUX_MSG_EOR		0x80
+#define LINUX_MSG_WAITALL	0x100
+#define LINUX_MSG_NOSIGNAL	0x4000
+#define NETBSD_MSG_EOR		0x8
+#define NETBSD_MSG_TRUNC	0x10
+#define NETBSD_MSG_CTRUNC	0x20
+#define NETBSD_MSG_WAITALL	0x40
+#define NETBSD_MSG_DONTWAIT	0x80
+#define NETBSD_MSG_NOSIGNAL	0x400
+
+static int
+fl_to_nb(long fl)
+{
+	int nb = fl & 3;	/* O_ACCMODE */
+
+	if (fl & LINUX_O_NONBLOCK)
+		nb |= NETBSD_O_NONBLOCK;
+	if (fl & LINUX_O_APPEND)
+		nb |= NETBSD_O_APPEND;
+	return nb;
+}
+
+static int
+fl_from_nb(int nb)
+{
+	int fl = nb & 3;
+
+	if (nb & NETBSD_O_NONBLOCK)
+		fl |= LINUX_O_NONBLOCK;
+	if (nb & NETBSD_O_APPEND)
+		fl |= LINUX_O_APPEND;
+	return fl;
+}
+
+static int
+msg_to_nb(int flags)
+{
+	static const int map[][2] = {
+		{ LINUX_MSG_CTRUNC,	NETBSD_MSG_CTRUNC },
+		{ LINUX_MSG_TRUNC,	NETBSD_MSG_TRUNC },
+		{ LINUX_MSG_DONTWAIT,	NETBSD_MSG_DONTWAIT },
+		{ LINUX_MSG_EOR,	NETBSD_MSG_EOR },
+		{ LINUX_MSG_WAITALL,	NETBSD_MSG_WAITALL },
+		{ LINUX_MSG_NOSIGNAL,	NETBSD_MSG_NOSIGNAL },
+	};
+	int nb = flags & 7;	/* MSG_OOB, MSG_PEEK, MSG_DONTROUTE */
+	size_t i;
+
+	for (i = 0; i < sizeof(map) / sizeof(map[0]); i++)
+		if (flags & map[i][0])
+			nb |= map[i][1];
+	return nb;
+}
+
+/* poll bits: IN/PRI/OUT/ERR/HUP/NVAL/RDNORM/RDBAND match; NetBSD's WRNORM is
+ * POLLOUT and its WRBAND is 0x100 (Linux: 0x100 and 0x200). */
+#define LINUX_POLLWRNORM	0x100
+#define LINUX_POLLWRBAND	0x200
+#define NETBSD_POLLWRBAND	0x100
+
+static short
+poll_to_nb(short ev)
+{
+	short nb = ev & 0xff;
+
+	if (ev & LINUX_POLLWRNORM)
+		nb |= POLLOUT;
+	if (ev & LINUX_POLLWRBAND)
+		nb |= NETBSD_POLLWRBAND;
+	return nb;
+}
+
+static short
+poll_from_nb(short nb, short asked)
+{
+	short ev = nb & 0xff;
+
+	if ((nb & POLLOUT) && (asked & LINUX_POLLWRNORM))
+		ev |= LINUX_POLLWRNORM;
+	if (nb & NETBSD_POLLWRBAND)
+		ev |= LINUX_POLLWRBAND;
+	return ev;
+}
+
+/* Real libc entry points, all looked up once at init. */
+static int  (*real_socket)(int, int, int);
 static int  (*real_connect)(int, const struct sockaddr *, socklen_t);
 static ssize_t (*real_read)(int, void *, size_t);
 static ssize_t (*real_write)(int, const void *, size_t);
@@ -67,10 +227,28 @@ static int  (*real_poll)(struct pollfd *, nfds_t, int);
 static int  (*real_fcntl)(int, int, ...);
 static ssize_t (*real_readv)(int, const struct iovec *, int);
 static ssize_t (*real_writev)(int, const struct iovec *, int);
+static ssize_t (*real_send)(int, const void *, size_t, int);
+static ssize_t (*real_recv)(int, void *, size_t, int);
+static ssize_t (*real_sendto)(int, const void *, size_t, int,
+    const struct sockaddr *, socklen_t);
+static ssize_t (*real_recvfrom)(int, void *, size_t, int, struct sockaddr *,
+    socklen_t *);
+static int  (*real_getsockopt)(int, int, int, void *, socklen_t *);
+static int  (*real_setsockopt)(int, int, int, const void *, socklen_t);
+static int  (*real_dup)(int);
+static int  (*real_dup2)(int, int);
+static int  (*real_dup3)(int, int, int);
+static int  (*real_epoll_create1)(int);
+static int  (*real_epoll_ctl)(int, int, int, struct epoll_event *);
+static int  (*real_epoll_wait)(int, struct epoll_event *, int, int);
+static ssize_t (*real_sendfile)(int, int, off_t *, size_t);
+static ssize_t (*real_splice)(int, loff_t *, int, loff_t *, size_t,
+    unsigned int);
 
 static void
 resolve(void)
 {
+	real_socket  = dlsym(RTLD_NEXT, "socket");
 	real_connect = dlsym(RTLD_NEXT, "connect");
 	real_read    = dlsym(RTLD_NEXT, "read");
 	real_write   = dlsym(RTLD_NEXT, "write");
@@ -79,8 +257,75 @@ resolve(void)
 	real_fcntl   = dlsym(RTLD_NEXT, "fcntl");
 	real_readv   = dlsym(RTLD_NEXT, "readv");
 	real_writev  = dlsym(RTLD_NEXT, "writev");
+	real_send    = dlsym(RTLD_NEXT, "send");
+	real_recv    = dlsym(RTLD_NEXT, "recv");
+	real_sendto  = dlsym(RTLD_NEXT, "sendto");
+	real_recvfrom = dlsym(RTLD_NEXT, "recvfrom");
+	real_getsockopt = dlsym(RTLD_NEXT, "getsockopt");
+	real_setsockopt = dlsym(RTLD_NEXT, "setsockopt");
+	real_dup     = dlsym(RTLD_NEXT, "dup");
+	real_dup2    = dlsym(RTLD_NEXT, "dup2");
+	real_dup3    = dlsym(RTLD_NEXT, "dup3");
+	real_epoll_create1 = dlsym(RTLD_NEXT, "epoll_create1");
+	real_epoll_ctl  = dlsym(RTLD_NEXT, "epoll_ctl");
+	real_epoll_wait = dlsym(RTLD_NEXT, "epoll_wait");
+	real_sendfile = dlsym(RTLD_NEXT, "sendfile");
+	real_splice   = dlsym(RTLD_NEXT, "splice");
 }
 
+/* ── fd table ────────────────────────────────────────────────────────────── */
+/*
+ * Every rump socket owns a host fd in the app's view: an O_PATH placeholder
+ * on "/" (so a call that slips past the shim, e.g. a raw syscall, fails with
+ * EBADF rather than touching some other file), and hj_fdtab[host fd] holds
+ * the rump fd + 1, 0 for a plain host fd. The host kernel keeps fd numbers
+ * dense and unique, so the table is a flat array, the per-call test is a
+ * bounds check and one load, and dup2() of a rump fd over 0/1/2 works: the
+ * target gets a rump_sys_dup of the socket, the placeholder is dup2()'d too.
+ */
+#define HJ_FDMAX 65536
+static int hj_fdtab[HJ_FDMAX];
+
+/* The rump fd behind app fd `fd`, or -1 for a host fd. */
+static inline int
+hj_rfd(int fd)
+{
+	if ((unsigned)fd >= HJ_FDMAX)
+		return -1;
+	return __atomic_load_n(&hj_fdtab[fd], __ATOMIC_RELAXED) - 1;
+}
+
+/* Point app fd `fd` at rump fd `rfd` (-1: a host fd again); returns the rump
+ * fd it had, or -1. */
+static int
+hj_fd_swap(int fd, int rfd)
+{
+	return __atomic_exchange_n(&hj_fdtab[fd], rfd + 1, __ATOMIC_RELAXED) - 1;
+}
+
+/* Give rump fd `rfd` a placeholder host fd and return it; on failure the
+ * rump fd is closed. */
+static int
+hj_fd_bind(int rfd, int cloexec)
+{
+	int fd = open("/", O_PATH | (cloexec ? O_CLOEXEC : 0));
+
+	if (fd >= HJ_FDMAX) {
+		real_close(fd);
+		fd = -1;
+		errno = EMFILE;
+	}
+	if (fd < 0) {
+		rump_sys_close(rfd);
+		return -1;
+	}
+	(void)hj_fd_swap(fd, rfd);
+	return fd;
+}
+
+/* The rumpuser is the fiber backend (one OS thread for the rump kernel). */
+static int hj_fiber;
+
 /* Bring up the rump stack once, before the app's main(). */
 __attribute__((constructor))
 static void
@@ -104,6 +349,7 @@ hijack_init(void)
 		fprintf(stderr, "[hijack] rump_init failed: %d\n", rv);
 		return;
 	}
+	hj_fiber = rumpuser_akuma_fiber_stats(NULL) != -1;
 	rv = rump_pub_netconfig_ifcreate("virt0");
 	fprintf(stderr, "[hijack] ifcreate virt0 -> %d\n", rv);
 
@@ -145,28 +391,32 @@ socket(int domain, int type, int protocol)
 {
 	if (domain == AF_INET || domain == LINUX_AF_INET6) {
 		int nbdom = (domain == LINUX_AF_INET6) ? NETBSD_AF_INET6 : 2;
-		/* Strip Linux-only type bits (SOCK_NONBLOCK=0x800, SOCK_CLOEXEC=0x80000)
-		 * that NetBSD doesn't accept in the type arg. We keep the rump socket
-		 * blocking (fcntl() above ignores O_NONBLOCK) so curl's connect/send/recv
-		 * are synchronous and dodge the nonblocking-connect + getsockopt dance. */
-		int nbtype = type & ~(0x800 | 0x80000);
-		int rfd = rump_sys_socket(nbdom, nbtype, protocol);
+		/* SOCK_NONBLOCK/SOCK_CLOEXEC ride in the type arg on both, at
+		 * different bits. */
+		int nbtype = type & ~(LINUX_SOCK_NONBLOCK | LINUX_SOCK_CLOEXEC);
+		if (type & LINUX_SOCK_NONBLOCK)
+			nbtype |= NETBSD_SOCK_NONBLOCK;
+		if (type & LINUX_SOCK_CLOEXEC)
+			nbtype |= NETBSD_SOCK_CLOEXEC;
+		int rfd = rv_int(rump_sys_socket(nbdom, nbtype, protocol));
 		if (rfd < 0)
 			return -1;
-		return rfd + RUMP_FDOFF;
+		return hj_fd_bind(rfd, type & LINUX_SOCK_CLOEXEC);
 	}
 	/* non-IP sockets stay on the host */
-	int (*real)(int, int, int) = dlsym(RTLD_NEXT, "socket");
-	return real(domain, type, protocol);
+	return real_socket(domain, type, protocol);
 }
 
 int
 connect(int fd, const struct sockaddr *addr, socklen_t len)
 {
-	if (ISRUMP(fd)) {
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0) {
 		struct nb_sockaddr_in nb;
 		socklen_t nblen = xlate_sockaddr(addr, &nb);
-		return rump_sys_connect(R(fd), (struct sockaddr *)&nb, nblen);
+		/* a non-blocking socket fails with EINPROGRESS, as on Linux */
+		return rv_int(rump_sys_connect(rfd, (struct sockaddr *)&nb, nblen));
 	}
 	return real_connect(fd, addr, len);
 }
@@ -174,16 +424,20 @@ connect(int fd, const struct sockaddr *addr, socklen_t len)
 ssize_t
 read(int fd, void *buf, size_t n)
 {
-	if (ISRUMP(fd))
-		return rump_sys_read(R(fd), buf, n);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_read(rfd, buf, n));
 	return real_read(fd, buf, n);
 }
 
 ssize_t
 write(int fd, const void *buf, size_t n)
 {
-	if (ISRUMP(fd))
-		return rump_sys_write(R(fd), buf, n);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_write(rfd, buf, n));
 	return real_write(fd, buf, n);
 }
 
@@ -192,83 +446,457 @@ write(int fd, const void *buf, size_t n)
 ssize_t
 readv(int fd, const struct iovec *iov, int iovcnt)
 {
-	if (ISRUMP(fd))
-		return rump_sys_readv(R(fd), iov, iovcnt);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_readv(rfd, iov, iovcnt));
 	return real_readv(fd, iov, iovcnt);
 }
 
 ssize_t
 writev(int fd, const struct iovec *iov, int iovcnt)
 {
-	if (ISRUMP(fd))
-		return rump_sys_writev(R(fd), iov, iovcnt);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_writev(rfd, iov, iovcnt));
 	return real_writev(fd, iov, iovcnt);
 }
 
 ssize_t
 send(int fd, const void *buf, size_t n, int flags)
 {
-	if (ISRUMP(fd))
-		return rump_sys_sendto(R(fd), buf, n, flags, NULL, 0);
-	ssize_t (*real)(int, const void *, size_t, int) = dlsym(RTLD_NEXT, "send");
-	return real(fd, buf, n, flags);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_sendto(rfd, buf, n, msg_to_nb(flags),
+		    NULL, 0));
+	return real_send(fd, buf, n, flags);
 }
 
 ssize_t
 recv(int fd, void *buf, size_t n, int flags)
 {
-	if (ISRUMP(fd))
-		return rump_sys_recvfrom(R(fd), buf, n, flags, NULL, 0);
-	ssize_t (*real)(int, void *, size_t, int) = dlsym(RTLD_NEXT, "recv");
-	return real(fd, buf, n, flags);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_recvfrom(rfd, buf, n, msg_to_nb(flags),
+		    NULL, 0));
+	return real_recv(fd, buf, n, flags);
+}
+
+static void hj_ep_forget_rump(int rfd);
+static void hj_ep_close(int epfd);
+
+/* Drop app fd `fd`'s rump fd, if it has one (it was closed or dup'd over). */
+static void
+hj_fd_release(int fd)
+{
+	int rfd;
+
+	if ((unsigned)fd >= HJ_FDMAX)
+		return;
+	if ((rfd = hj_fd_swap(fd, -1)) >= 0) {
+		hj_ep_forget_rump(rfd);
+		rump_sys_close(rfd);
+	}
 }
 
 int
 close(int fd)
 {
-	if (ISRUMP(fd))
-		return rump_sys_close(R(fd));
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0) {
+		(void)hj_fd_swap(fd, -1);
+		hj_ep_forget_rump(rfd);
+		if (rv_int(rump_sys_close(rfd)) < 0) {
+			real_close(fd);
+			return -1;
+		}
+	} else
+		hj_ep_close(fd);
 	return real_close(fd);
 }
 
+/* dup/dup2/dup3: a rump fd's copy gets its own rump_sys_dup, so either may be
+ * closed first; a target that was a rump fd drops its socket, as on Linux. */
+static int
+hj_dup_to(int rfd, int newfd)
+{
+	int nr, e;
+
+	if (newfd >= HJ_FDMAX) {
+		real_close(newfd);
+		errno = EMFILE;
+		return -1;
+	}
+	nr = rv_int(rump_sys_dup(rfd));
+	e = errno;
+	hj_fd_release(newfd);
+	if (nr < 0) {
+		real_close(newfd);
+		errno = e;
+		return -1;
+	}
+	(void)hj_fd_swap(newfd, nr);
+	return newfd;
+}
+
+int
+dup(int fd)
+{
+	int rfd = hj_rfd(fd), nfd = real_dup(fd);
+
+	if (rfd < 0 || nfd < 0)
+		return nfd;
+	return hj_dup_to(rfd, nfd);
+}
+
+int
+dup3(int fd, int newfd, int flags)
+{
+	int rfd = hj_rfd(fd), nfd;
+
+	if (fd == newfd) {
+		errno = EINVAL;
+		return -1;
+	}
+	if ((nfd = real_dup3(fd, newfd, flags)) < 0)
+		return -1;
+	if (rfd < 0) {
+		hj_fd_release(nfd);
+		return nfd;
+	}
+	return hj_dup_to(rfd, nfd);
+}
+
+int
+dup2(int fd, int newfd)
+{
+	if (fd == newfd)
+		return real_dup2(fd, newfd);
+	return dup3(fd, newfd, 0);
+}
+
+static long
+now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/* Wait budget left of `timeout` ms started at `start` (-1 = forever), capped
+ * at `slice`. */
+static int
+slice_ms(int timeout, long start, int slice)
+{
+	long left;
+
+	if (timeout < 0)
+		return slice;
+	left = start + timeout - now_ms();
+	if (left <= 0)
+		return 0;
+	return left < slice ? (int)left : slice;
+}
+
+/*
+ * poll. The set is split into a host half and a rump half (compact copies,
+ * plus where each entry came from), each half goes to its own kernel, and the
+ * revents are scattered back, so the caller's array is only written with
+ * results. A set with no rump fd goes straight to the real poll, one with no
+ * host fd straight to rump_sys_poll.
+ *
+ * A mixed set needs both kernels to wait at once, and neither can wake on the
+ * other's fds. With the pthread rumpuser backend they share one blocking
+ * wait: the calling thread blocks in rump_sys_poll over its rump half plus
+ * the read end of a rump pipe, while a watcher thread (one per polling
+ * thread, made on first use) blocks in the host poll over the host half plus
+ * an eventfd. Whichever wakes first wakes the other: the watcher writes the
+ * pipe, the caller the eventfd. The fiber backend runs the rump kernel on one
+ * OS thread, which a watcher must not enter, so there (or if a watcher cannot
+ * be made) the wait blocks in rump in slices of HJ_MIXED_SLICE_MS, which keeps
+ * the rump fibers running, and checks the host half between slices; host
+ * readiness is seen within a slice. epoll_wait waits that way too.
+ */
+#define HJ_MIXED_SLICE_MS 5
+#define HJ_POLL_STACK 32
+
+struct hj_watch {
+	pthread_t thr;
+	pthread_mutex_t mtx;
+	pthread_cond_t cv;
+	int efd;		/* host eventfd: the caller ends the host wait */
+	int wake[2];		/* rump pipe: the watcher ends the rump wait */
+	struct pollfd *hs;	/* host half, hs[nh] = efd; NULL: exit */
+	nfds_t nh;
+	unsigned seq, done;	/* a wait is posted as ++seq, answered as done */
+	int nready;		/* host fds ready (not efd), -1 on error */
+};
+static pthread_key_t hj_watch_key;
+static pthread_once_t hj_watch_once = PTHREAD_ONCE_INIT;
+
+static void *
+hj_watch_main(void *arg)
+{
+	struct hj_watch *w = arg;
+	unsigned seen = 0;
+	sigset_t all;
+	char c = 0;
+	int n;
+
+	sigfillset(&all);	/* the app's signals go to the app's threads */
+	pthread_sigmask(SIG_SETMASK, &all, NULL);
+	pthread_mutex_lock(&w->mtx);
+	for (;;) {
+		while (w->seq == seen)
+			pthread_cond_wait(&w->cv, &w->mtx);
+		seen = w->seq;
+		if (w->hs == NULL)
+			break;
+		pthread_mutex_unlock(&w->mtx);
+		while ((n = real_poll(w->hs, w->nh + 1, -1)) < 0 &&
+		    errno == EINTR)
+			;
+		if (n > 0 && w->hs[w->nh].revents != 0)
+			n--;
+		if (n > 0)
+			(void)rump_sys_write(w->wake[1], &c, 1);
+		pthread_mutex_lock(&w->mtx);
+		w->nready = n;
+		w->done = seen;
+		pthread_cond_signal(&w->cv);
+	}
+	pthread_mutex_unlock(&w->mtx);
+	return NULL;
+}
+
+/* Thread exit: stop and free that thread's watcher. */
+static void
+hj_watch_free(void *arg)
+{
+	struct hj_watch *w = arg;
+
+	pthread_mutex_lock(&w->mtx);
+	w->hs = NULL;
+	w->seq++;
+	pthread_cond_signal(&w->cv);
+	pthread_mutex_unlock(&w->mtx);
+	pthread_join(w->thr, NULL);
+	real_close(w->efd);
+	rump_sys_close(w->wake[0]);
+	rump_sys_close(w->wake[1]);
+	pthread_cond_destroy(&w->cv);
+	pthread_mutex_destroy(&w->mtx);
+	free(w);
+}
+
+static void
+hj_watch_key_init(void)
+{
+	(void)pthread_key_create(&hj_watch_key, hj_watch_free);
+}
+
+/* The calling thread's watcher, made on first use; NULL if it cannot be. */
+static struct hj_watch *
+hj_watch_get(void)
+{
+	struct hj_watch *w;
+
+	pthread_once(&hj_watch_once, hj_watch_key_init);
+	if ((w = pthread_getspecific(hj_watch_key)) != NULL)
+		return w;
+	if ((w = calloc(1, sizeof(*w))) == NULL)
+		return NULL;
+	if ((w->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+		goto fail;
+	if (rump_sys_pipe2(w->wake, NETBSD_O_NONBLOCK) < 0)
+		goto fail_efd;
+	pthread_mutex_init(&w->mtx, NULL);
+	pthread_cond_init(&w->cv, NULL);
+	if (pthread_create(&w->thr, NULL, hj_watch_main, w) != 0)
+		goto fail_pipe;
+	(void)pthread_setspecific(hj_watch_key, w);
+	return w;
+
+fail_pipe:
+	pthread_cond_destroy(&w->cv);
+	pthread_mutex_destroy(&w->mtx);
+	rump_sys_close(w->wake[0]);
+	rump_sys_close(w->wake[1]);
+fail_efd:
+	real_close(w->efd);
+fail:
+	free(w);
+	return NULL;
+}
+
+/* Mixed wait through watcher `w`. hs and rs each have one spare slot at the
+ * end, for the eventfd and the pipe. Returns < 0 with errno on failure. */
+static int
+poll_watched(struct hj_watch *w, struct pollfd *hs, nfds_t nh,
+	struct pollfd *rs, nfds_t nr, int timeout)
+{
+	uint64_t v = 1;
+	char drain[16];
+	int nrump, nhost, e;
+
+	/* Already ready (or not waiting): no handoff. */
+	if ((nhost = real_poll(hs, nh, 0)) < 0 ||
+	    (nrump = rv_int(rump_sys_poll(rs, nr, 0))) < 0)
+		return -1;
+	if (nhost > 0 || nrump > 0 || timeout == 0)
+		return 0;
+
+	hs[nh] = (struct pollfd){ .fd = w->efd, .events = POLLIN };
+	rs[nr] = (struct pollfd){ .fd = w->wake[0], .events = POLLIN };
+	pthread_mutex_lock(&w->mtx);
+	w->hs = hs;
+	w->nh = nh;
+	w->seq++;
+	pthread_cond_signal(&w->cv);
+	pthread_mutex_unlock(&w->mtx);
+
+	nrump = rump_sys_poll(rs, nr + 1, timeout);
+	e = linux_errno(errno);
+
+	pthread_mutex_lock(&w->mtx);
+	if (w->done != w->seq) {
+		(void)real_write(w->efd, &v, sizeof(v));
+		while (w->done != w->seq)
+			pthread_cond_wait(&w->cv, &w->mtx);
+		(void)real_read(w->efd, &v, sizeof(v));
+	}
+	nhost = w->nready;
+	pthread_mutex_unlock(&w->mtx);
+	if (nhost > 0)
+		(void)rump_sys_read(w->wake[0], drain, sizeof(drain));
+	if (nrump < 0 || nhost < 0) {
+		errno = nrump < 0 ? e : EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+/* Mixed wait in slices (see above). */
+static int
+poll_sliced(struct pollfd *hs, nfds_t nh, struct pollfd *rs, nfds_t nr,
+	int timeout)
+{
+	long start = now_ms();
+	int nhost, nrump;
+
+	for (;;) {
+		if ((nhost = real_poll(hs, nh, 0)) < 0)
+			return -1;
+		nrump = rv_int(rump_sys_poll(rs, nr,
+		    nhost > 0 ? 0 : slice_ms(timeout, start, HJ_MIXED_SLICE_MS)));
+		if (nrump < 0)
+			return -1;
+		if (nhost > 0 || nrump > 0 || slice_ms(timeout, start, 1) == 0)
+			return 0;
+	}
+}
+
 int
 poll(struct pollfd *fds, nfds_t nfds, int timeout)
 {
-	/* If any fd is a rump fd, run the whole set through rump (this demo's
-	 * sockets are all rump fds). Translate the offset in/out. */
-	nfds_t i;
-	int anyrump = 0;
+	struct pollfd sbuf[2 * (HJ_POLL_STACK + 1)], *hs = sbuf, *rs;
+	unsigned sidx[2 * HJ_POLL_STACK], *hidx = sidx, *ridx;
+	struct hj_watch *w;
+	nfds_t i, nh = 0, nr = 0;
+	int rfd, n = 0;
+
 	for (i = 0; i < nfds; i++)
-		if (ISRUMP(fds[i].fd)) { anyrump = 1; break; }
-	if (!anyrump)
+		if (hj_rfd(fds[i].fd) >= 0)
+			break;
+	if (i == nfds)
 		return real_poll(fds, nfds, timeout);
-	for (i = 0; i < nfds; i++)
-		if (ISRUMP(fds[i].fd)) fds[i].fd = R(fds[i].fd);
-	int rv = rump_sys_poll(fds, nfds, timeout);
-	for (i = 0; i < nfds; i++)
-		fds[i].fd += RUMP_FDOFF;
-	return rv;
+
+	if (nfds > HJ_POLL_STACK) {
+		hs = malloc(2 * (nfds + 1) * sizeof(*hs) +
+		    2 * nfds * sizeof(*hidx));
+		if (hs == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		hidx = (unsigned *)(hs + 2 * (nfds + 1));
+	}
+	rs = hs + nfds + 1;
+	ridx = hidx + nfds;
+	for (i = 0; i < nfds; i++) {
+		fds[i].revents = 0;
+		if ((rfd = hj_rfd(fds[i].fd)) >= 0) {
+			rs[nr] = (struct pollfd){ .fd = rfd,
+			    .events = poll_to_nb(fds[i].events) };
+			ridx[nr++] = (unsigned)i;
+		} else if (fds[i].fd >= 0) {
+			hs[nh] = fds[i];
+			hidx[nh++] = (unsigned)i;
+		}
+	}
+
+	if (nh == 0)
+		n = rv_int(rump_sys_poll(rs, nr, timeout));
+	else if (!hj_fiber && (w = hj_watch_get()) != NULL)
+		n = poll_watched(w, hs, nh, rs, nr, timeout);
+	else
+		n = poll_sliced(hs, nh, rs, nr, timeout);
+	if (n >= 0) {
+		n = 0;
+		for (i = 0; i < nh; i++)
+			if ((fds[hidx[i]].revents = hs[i].revents) != 0)
+				n++;
+		for (i = 0; i < nr; i++)
+			if ((fds[ridx[i]].revents = poll_from_nb(rs[i].revents,
+			    fds[ridx[i]].events)) != 0)
+				n++;
+	}
+	if (hs != sbuf)
+		free(hs);
+	return n;
 }
 
-/* F_* command numbers happen to match (Linux/NetBSD: GETFD=1 SETFD=2 GETFL=3
- * SETFL=4), but O_NONBLOCK differs (Linux 0x800 vs NetBSD 0x4). Rather than
- * translate flag-by-flag, keep rump sockets BLOCKING and answer fcntl locally:
- * curl then does a blocking connect()/send()/recv() (connect returns 0 on
- * success, no nonblocking+getsockopt dance), which sidesteps every constant
- * mismatch. */
+/* F_* command numbers match (Linux/NetBSD: GETFD=1 SETFD=2 GETFL=3 SETFL=4);
+ * the status flags are translated (O_NONBLOCK is Linux 0x800 vs NetBSD 0x4).
+ * FD_CLOEXEC is per app fd, so it lives on the placeholder, where exec sees
+ * it; F_DUPFD* dup like dup(). Other commands are accepted and ignored. */
+#define LINUX_F_DUPFD 0
+#define LINUX_F_GETFD 1
+#define LINUX_F_SETFD 2
 #define LINUX_F_GETFL 3
+#define LINUX_F_SETFL 4
+#define LINUX_F_DUPFD_CLOEXEC 1030
 int
 fcntl(int fd, int cmd, ...)
 {
 	va_list ap;
 	long arg;
+	int rfd = hj_rfd(fd), rv;
 	va_start(ap, cmd);
 	arg = va_arg(ap, long);
 	va_end(ap);
-	if (ISRUMP(fd)) {
-		if (cmd == LINUX_F_GETFL)
-			return 0x0002;   /* O_RDWR, no O_NONBLOCK */
-		return 0;            /* F_SETFL / F_SETFD / ... : accept, keep blocking */
+	if (rfd >= 0) {
+		switch (cmd) {
+		case LINUX_F_DUPFD:
+		case LINUX_F_DUPFD_CLOEXEC:
+			if ((rv = real_fcntl(fd, cmd, arg)) < 0)
+				return rv;
+			return hj_dup_to(rfd, rv);
+		case LINUX_F_GETFD:
+		case LINUX_F_SETFD:
+			return real_fcntl(fd, cmd, arg);
+		case LINUX_F_GETFL:
+			rv = rv_int(rump_sys_fcntl(rfd, cmd));
+			return rv < 0 ? rv : fl_from_nb(rv);
+		case LINUX_F_SETFL:
+			return rv_int(rump_sys_fcntl(rfd, cmd, fl_to_nb(arg)));
+		default:
+			return 0;
+		}
 	}
 	return real_fcntl(fd, cmd, arg);
 }
@@ -277,48 +905,58 @@ ssize_t
 sendto(int fd, const void *buf, size_t n, int flags,
 	const struct sockaddr *to, socklen_t tolen)
 {
-	if (ISRUMP(fd)) {
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0) {
 		if (to) {
 			struct nb_sockaddr_in nb;
 			socklen_t nblen = xlate_sockaddr(to, &nb);
-			return rump_sys_sendto(R(fd), buf, n, flags,
-			    (struct sockaddr *)&nb, nblen);
+			return rv_ssz(rump_sys_sendto(rfd, buf, n,
+			    msg_to_nb(flags), (struct sockaddr *)&nb, nblen));
 		}
-		return rump_sys_sendto(R(fd), buf, n, flags, NULL, 0);
+		return rv_ssz(rump_sys_sendto(rfd, buf, n, msg_to_nb(flags),
+		    NULL, 0));
 	}
-	ssize_t (*real)(int, const void *, size_t, int,
-	    const struct sockaddr *, socklen_t) = dlsym(RTLD_NEXT, "sendto");
-	return real(fd, buf, n, flags, to, tolen);
+	return real_sendto(fd, buf, n, flags, to, tolen);
 }
 
 ssize_t
 recvfrom(int fd, void *buf, size_t n, int flags,
 	struct sockaddr *from, socklen_t *fromlen)
 {
-	if (ISRUMP(fd))
-		return rump_sys_recvfrom(R(fd), buf, n, flags, NULL, NULL);
-	ssize_t (*real)(int, void *, size_t, int, struct sockaddr *, socklen_t *) =
-	    dlsym(RTLD_NEXT, "recvfrom");
-	return real(fd, buf, n, flags, from, fromlen);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0)
+		return rv_ssz(rump_sys_recvfrom(rfd, buf, n, msg_to_nb(flags),
+		    NULL, NULL));
+	return real_recvfrom(fd, buf, n, flags, from, fromlen);
 }
 
-/* curl checks getsockopt(SO_ERROR) after connect; answer "no error" so it
- * proceeds. (Linux SOL_SOCKET=1, SO_ERROR=4.) */
+/* getsockopt(SO_ERROR) is the outcome of a non-blocking connect: ask rump
+ * (NetBSD SOL_SOCKET=0xffff, SO_ERROR=0x1007) and translate the errno. Other
+ * options answer 0 so wget/curl proceed. (Linux SOL_SOCKET=1, SO_ERROR=4.) */
+#define NETBSD_SOL_SOCKET 0xffff
+#define NETBSD_SO_ERROR   0x1007
 int
 getsockopt(int fd, int level, int optname, void *optval, socklen_t *optlen)
 {
-	if (ISRUMP(fd)) {
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0) {
 		if (level == 1 && optname == 4 && optval && optlen && *optlen >= 4) {
-			*(int *)optval = 0;
+			int err = 0;
+			socklen_t len = sizeof(err);
+			if (rv_int(rump_sys_getsockopt(rfd, NETBSD_SOL_SOCKET,
+			    NETBSD_SO_ERROR, &err, &len)) < 0)
+				return -1;
+			*(int *)optval = linux_errno(err);
 			*optlen = 4;
 		} else if (optval && optlen && *optlen >= 4) {
 			*(int *)optval = 0;
 		}
 		return 0;
 	}
-	int (*real)(int, int, int, void *, socklen_t *) =
-	    dlsym(RTLD_NEXT, "getsockopt");
-	return real(fd, level, optname, optval, optlen);
+	return real_getsockopt(fd, level, optname, optval, optlen);
 }
 
 /* setsockopt/getsockopt: best-effort — route to rump, but never fail the app on
@@ -326,11 +964,548 @@ getsockopt(int fd, int level, int optname, void *optval, socklen_t *optlen)
 int
 setsockopt(int fd, int level, int optname, const void *val, socklen_t len)
 {
-	if (ISRUMP(fd)) {
-		(void)rump_sys_setsockopt(R(fd), level, optname, val, len);
+	int rfd = hj_rfd(fd);
+
+	if (rfd >= 0) {
+		(void)rump_sys_setsockopt(rfd, level, optname, val, len);
+		return 0;
+	}
+	return real_setsockopt(fd, level, optname, val, len);
+}
+
+/*
+ * epoll. An epoll fd is a real host epoll instance: host fds go to it
+ * untouched. Its rump fds go to a rump kqueue created beside it on the first
+ * one, as one knote per direction (EVFILT_READ for EPOLLIN, EVFILT_WRITE for
+ * EPOLLOUT) carrying the caller's epoll_data in udata; EPOLLET maps to
+ * EV_CLEAR and EPOLLONESHOT to EV_ONESHOT. epoll_wait merges the two knotes
+ * of a fd back into one event and, with host fds registered too, waits like
+ * poll_mixed.
+ */
+
+/* NetBSD struct kevent (the pre-10 layout of buildrump's src-netbsd, no ext[])
+ * and the bits used here. */
+struct nb_kevent {
+	uintptr_t ident;
+	uint32_t filter;
+	uint32_t flags;
+	uint32_t fflags;
+	int64_t data;
+	uintptr_t udata;
+};
+#define NB_EVFILT_READ	0
+#define NB_EVFILT_WRITE	1
+#define NB_EV_ADD	0x0001
+#define NB_EV_DELETE	0x0002
+#define NB_EV_ONESHOT	0x0010
+#define NB_EV_CLEAR	0x0020
+#define NB_EV_ERROR	0x4000
+#define NB_EV_EOF	0x8000
+#define NB_ENOENT	2
+
+struct hj_epreg {
+	int rfd;		/* rump fd (no offset) */
+	uint32_t events;	/* as registered, EPOLL* */
+};
+
+struct hj_epoll {
+	int epfd;		/* the host epoll fd */
+	int kq;			/* rump kqueue, or -1 until the first rump fd */
+	int nhost;		/* host fds registered */
+	int nreg, cap;
+	struct hj_epreg *reg;
+	struct hj_epoll *next;
+};
+static struct hj_epoll *hj_eps;
+static pthread_mutex_t hj_ep_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* Caller holds hj_ep_mtx. */
+static struct hj_epoll *
+hj_ep_find(int epfd)
+{
+	struct hj_epoll *ep;
+
+	for (ep = hj_eps; ep != NULL; ep = ep->next)
+		if (ep->epfd == epfd)
+			return ep;
+	return NULL;
+}
+
+static struct hj_epreg *
+hj_ep_reg(struct hj_epoll *ep, int rfd)
+{
+	int i;
+
+	for (i = 0; i < ep->nreg; i++)
+		if (ep->reg[i].rfd == rfd)
+			return &ep->reg[i];
+	return NULL;
+}
+
+/* A closed rump fd leaves every epoll set, as on Linux (kqueue drops its
+ * knotes itself). */
+static void
+hj_ep_forget_rump(int rfd)
+{
+	struct hj_epoll *ep;
+	struct hj_epreg *r;
+
+	pthread_mutex_lock(&hj_ep_mtx);
+	for (ep = hj_eps; ep != NULL; ep = ep->next)
+		if ((r = hj_ep_reg(ep, rfd)) != NULL)
+			*r = ep->reg[--ep->nreg];
+	pthread_mutex_unlock(&hj_ep_mtx);
+}
+
+static void
+hj_ep_close(int epfd)
+{
+	struct hj_epoll **pp, *ep;
+
+	if (hj_eps == NULL)
+		return;
+	pthread_mutex_lock(&hj_ep_mtx);
+	for (pp = &hj_eps; (ep = *pp) != NULL; pp = &ep->next)
+		if (ep->epfd == epfd)
+			break;
+	if (ep != NULL)
+		*pp = ep->next;
+	pthread_mutex_unlock(&hj_ep_mtx);
+	if (ep == NULL)
+		return;
+	if (ep->kq >= 0)
+		rump_sys_close(ep->kq);
+	free(ep->reg);
+	free(ep);
+}
+
+int
+epoll_create1(int flags)
+{
+	struct hj_epoll *ep;
+	int epfd = real_epoll_create1(flags);
+
+	if (epfd < 0)
+		return epfd;
+	if ((ep = calloc(1, sizeof(*ep))) == NULL) {
+		real_close(epfd);
+		errno = ENOMEM;
+		return -1;
+	}
+	ep->epfd = epfd;
+	ep->kq = -1;
+	pthread_mutex_lock(&hj_ep_mtx);
+	ep->next = hj_eps;
+	hj_eps = ep;
+	pthread_mutex_unlock(&hj_ep_mtx);
+	return epfd;
+}
+
+int
+epoll_create(int size)
+{
+	if (size <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return epoll_create1(0);
+}
+
+/* Apply `events` (0 = none) to rfd's two knotes in `kq`. */
+static int
+hj_kq_set(int kq, int rfd, uint32_t events, uint64_t data)
+{
+	uint32_t extra = 0;
+	int f, rv;
+
+	if (events & EPOLLET)
+		extra |= NB_EV_CLEAR;
+	if (events & EPOLLONESHOT)
+		extra |= NB_EV_ONESHOT;
+	for (f = NB_EVFILT_READ; f <= NB_EVFILT_WRITE; f++) {
+		uint32_t want = f == NB_EVFILT_READ ? EPOLLIN : EPOLLOUT;
+		struct nb_kevent kev = {
+			.ident = (uintptr_t)rfd,
+			.filter = (uint32_t)f,
+			.flags = (events & want) ? NB_EV_ADD | extra : NB_EV_DELETE,
+			.udata = (uintptr_t)data,
+		};
+		rv = rump_sys_kevent(kq, (void *)&kev, 1, NULL, 0, NULL);
+		/* deleting a filter that was never added (or fired oneshot) */
+		if (rv < 0 && !(kev.flags == NB_EV_DELETE && errno == NB_ENOENT))
+			return rv_int(rv);
+	}
+	return 0;
+}
+
+int
+epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	struct hj_epoll *ep;
+	struct hj_epreg *r;
+	int rfd = hj_rfd(fd), rv = 0;
+
+	if (rfd < 0) {
+		rv = real_epoll_ctl(epfd, op, fd, event);
+		if (rv == 0 && op != EPOLL_CTL_MOD) {
+			pthread_mutex_lock(&hj_ep_mtx);
+			if ((ep = hj_ep_find(epfd)) != NULL)
+				ep->nhost += op == EPOLL_CTL_ADD ? 1 : -1;
+			pthread_mutex_unlock(&hj_ep_mtx);
+		}
+		return rv;
+	}
+	if (op != EPOLL_CTL_DEL && event == NULL) {
+		errno = EFAULT;
+		return -1;
+	}
+	pthread_mutex_lock(&hj_ep_mtx);
+	if ((ep = hj_ep_find(epfd)) == NULL) {
+		errno = EINVAL;	/* not an epoll fd we created */
+		rv = -1;
+		goto out;
+	}
+	if (ep->kq < 0 && (ep->kq = rv_int(rump_sys_kqueue())) < 0) {
+		rv = -1;
+		goto out;
+	}
+	r = hj_ep_reg(ep, rfd);
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		if (r != NULL) {
+			errno = EEXIST;
+			rv = -1;
+			break;
+		}
+		if (ep->nreg == ep->cap) {
+			int cap = ep->cap ? 2 * ep->cap : 8;
+			struct hj_epreg *n = realloc(ep->reg, cap * sizeof(*n));
+			if (n == NULL) {
+				errno = ENOMEM;
+				rv = -1;
+				break;
+			}
+			ep->reg = n;
+			ep->cap = cap;
+		}
+		if ((rv = hj_kq_set(ep->kq, rfd, event->events,
+		    event->data.u64)) == 0) {
+			ep->reg[ep->nreg].rfd = rfd;
+			ep->reg[ep->nreg++].events = event->events;
+		}
+		break;
+	case EPOLL_CTL_MOD:
+		if (r == NULL) {
+			errno = ENOENT;
+			rv = -1;
+			break;
+		}
+		if ((rv = hj_kq_set(ep->kq, rfd, event->events,
+		    event->data.u64)) == 0)
+			r->events = event->events;
+		break;
+	case EPOLL_CTL_DEL:
+		if (r == NULL) {
+			errno = ENOENT;
+			rv = -1;
+			break;
+		}
+		(void)hj_kq_set(ep->kq, rfd, 0, 0);
+		*r = ep->reg[--ep->nreg];
+		break;
+	default:
+		errno = EINVAL;
+		rv = -1;
+	}
+out:
+	pthread_mutex_unlock(&hj_ep_mtx);
+	return rv;
+}
+
+/* Collect up to `max` rump events from `kq` into `out`, waiting up to
+ * `timeout` ms (-1 = forever); one event per fd. */
+static int
+hj_kq_wait(int kq, struct epoll_event *out, int max, int timeout)
+{
+	struct nb_kevent kev[64];
+	int fdof[64];
+	struct timespec ts, *tsp = NULL;
+	int nk, n = 0, i, j;
+
+	if (max > 32)
+		max = 32;	/* two knotes per fd fit kev[] */
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000L;
+		tsp = &ts;
+	}
+	nk = rv_int(rump_sys_kevent(kq, NULL, 0, (void *)kev, 2 * (size_t)max,
+	    tsp));
+	for (i = 0; i < nk; i++) {
+		uint32_t ev;
+
+		if (kev[i].flags & NB_EV_ERROR)
+			ev = EPOLLERR;
+		else if (kev[i].filter == NB_EVFILT_READ)
+			ev = EPOLLIN | ((kev[i].flags & NB_EV_EOF) ?
+			    EPOLLRDHUP | (kev[i].fflags ? EPOLLERR : 0) : 0);
+		else
+			ev = EPOLLOUT | ((kev[i].flags & NB_EV_EOF) ? EPOLLHUP : 0);
+		for (j = 0; j < n; j++)
+			if (fdof[j] == (int)kev[i].ident)
+				break;
+		if (j == n) {
+			if (n == max)
+				continue;
+			fdof[n] = (int)kev[i].ident;
+			out[n].events = 0;
+			out[n++].data.u64 = (uint64_t)kev[i].udata;
+		}
+		out[j].events |= ev;
+	}
+	return nk < 0 ? -1 : n;
+}
+
+int
+epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+	struct hj_epoll *ep;
+	int kq = -1, nhost = 0, nh, nr;
+	long start;
+
+	if (hj_eps != NULL) {
+		pthread_mutex_lock(&hj_ep_mtx);
+		if ((ep = hj_ep_find(epfd)) != NULL && ep->nreg > 0) {
+			kq = ep->kq;
+			nhost = ep->nhost;
+		}
+		pthread_mutex_unlock(&hj_ep_mtx);
+	}
+	if (kq < 0 || maxevents <= 0)
+		return real_epoll_wait(epfd, events, maxevents, timeout);
+	if (nhost == 0)
+		return hj_kq_wait(kq, events, maxevents, timeout);
+	start = now_ms();
+	for (;;) {
+		if ((nh = real_epoll_wait(epfd, events, maxevents, 0)) < 0)
+			return -1;
+		if (nh == maxevents)
+			return nh;
+		nr = hj_kq_wait(kq, events + nh, maxevents - nh,
+		    nh > 0 ? 0 : slice_ms(timeout, start, HJ_MIXED_SLICE_MS));
+		if (nr < 0)
+			return nh > 0 ? nh : -1;
+		if (nh + nr > 0 || slice_ms(timeout, start, 1) == 0)
+			return nh + nr;
+	}
+}
+
+/* ── sendfile / splice ───────────────────────────────────────────────────── */
+/*
+ * Serving a file over a rump socket with read()/write() copies it twice in
+ * user space (page cache -> app buffer, app buffer -> mbufs in rump_sys_write)
+ * and enters the rump kernel once per app-sized buffer. A rump socket cannot
+ * take host pages, so the mbuf copy stays, but the first one can go: for a
+ * regular file the data is mapped HJ_SF_WINDOW bytes at a time and each
+ * window is one rump_sys_write straight from the mapping.
+ *
+ * Anything else with a rump end (a pipe or socket source, a rump source, a
+ * file that will not map) goes through an HJ_SF_BOUNCE buffer, which is no
+ * worse than the app's own loop. Neither end rump: the real call.
+ *
+ * Semantics as on Linux: the return is the bytes moved, -1/errno only if none
+ * were (EAGAIN from a non-blocking rump socket). sendfile() advances *offset,
+ * or the file position if offset is NULL.
+ */
+#define HJ_SF_WINDOW	(1 << 20)
+#define HJ_SF_BOUNCE	(64 * 1024)
+#define LINUX_SPLICE_F_NONBLOCK 0x02
+
+/* Send count bytes of regular file `in` at pos to rump fd rfd from a mapped
+ * view. Returns the bytes sent, -1/errno if none, or -2 if `in` is not a
+ * regular file or will not map (the caller bounces instead). */
+static ssize_t
+hj_send_mapped(int rfd, int in, off_t pos, size_t count, int dontwait)
+{
+	long pg = sysconf(_SC_PAGESIZE);
+	struct stat st;
+	size_t sent = 0;
+
+	if (fstat(in, &st) == -1 || !S_ISREG(st.st_mode) || pos < 0)
+		return -2;
+	if (pos >= st.st_size)
 		return 0;
+	if ((off_t)count > st.st_size - pos)
+		count = (size_t)(st.st_size - pos);
+	while (sent < count) {
+		off_t at = pos + (off_t)sent;
+		off_t base = at & ~(off_t)(pg - 1);
+		size_t skip = (size_t)(at - base);
+		size_t len = count - sent;
+		char *map;
+		ssize_t w;
+		int e;
+
+		if (len > HJ_SF_WINDOW - skip)
+			len = HJ_SF_WINDOW - skip;
+		map = mmap(NULL, skip + len, PROT_READ, MAP_SHARED, in, base);
+		if (map == MAP_FAILED)
+			return sent > 0 ? (ssize_t)sent : -2;
+		(void)madvise(map, skip + len, MADV_SEQUENTIAL);
+		w = dontwait ?
+		    rump_sys_sendto(rfd, map + skip, len, NETBSD_MSG_DONTWAIT,
+			NULL, 0) :
+		    rump_sys_write(rfd, map + skip, len);
+		e = errno;
+		munmap(map, skip + len);
+		if (w < 0) {
+			if (sent > 0)
+				return (ssize_t)sent;
+			errno = linux_errno(e);
+			return -1;
+		}
+		sent += (size_t)w;
+		if ((size_t)w < len)
+			break;
+	}
+	return (ssize_t)sent;
+}
+
+/* One read of at most n bytes from `fd` (rump or host; at *pos if pos). */
+static ssize_t
+hj_sf_read(int fd, void *buf, size_t n, off_t *pos, int dontwait)
+{
+	int rfd = hj_rfd(fd);
+	ssize_t r;
+
+	if (rfd >= 0)
+		r = rv_ssz(dontwait ?
+		    rump_sys_recvfrom(rfd, buf, n, NETBSD_MSG_DONTWAIT,
+			NULL, NULL) :
+		    rump_sys_read(rfd, buf, n));
+	else
+		r = pos ? pread(fd, buf, n, *pos) : real_read(fd, buf, n);
+	if (r > 0 && pos)
+		*pos += r;
+	return r;
+}
+
+/* All n bytes to `fd` (rump or host; at *pos if pos). They are already taken
+ * from the source, so EAGAIN waits in poll() rather than dropping them. */
+static ssize_t
+hj_sf_write(int fd, const char *buf, size_t n, off_t *pos)
+{
+	int rfd = hj_rfd(fd);
+	size_t done = 0;
+
+	while (done < n) {
+		ssize_t w;
+
+		if (rfd >= 0)
+			w = rv_ssz(rump_sys_write(rfd, buf + done, n - done));
+		else
+			w = pos ? pwrite(fd, buf + done, n - done, *pos) :
+			    real_write(fd, buf + done, n - done);
+		if (w < 0) {
+			struct pollfd p = { .fd = fd, .events = POLLOUT };
+
+			if (errno != EAGAIN)
+				return done > 0 ? (ssize_t)done : -1;
+			(void)poll(&p, 1, -1);
+			continue;
+		}
+		if (pos)
+			*pos += w;
+		done += (size_t)w;
+	}
+	return (ssize_t)done;
+}
+
+/* Copy up to count bytes through a bounce buffer; `once` stops after the
+ * first chunk (splice moves what one read gives, sendfile fills count). */
+static ssize_t
+hj_sf_bounce(int out, off_t *opos, int in, off_t *ipos, size_t count,
+	int dontwait, int once)
+{
+	char *buf = malloc(HJ_SF_BOUNCE);
+	size_t moved = 0;
+
+	if (buf == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+	while (moved < count) {
+		size_t want = count - moved < HJ_SF_BOUNCE ?
+		    count - moved : HJ_SF_BOUNCE;
+		ssize_t r = hj_sf_read(in, buf, want, ipos, dontwait), w;
+
+		if (r <= 0) {
+			if (r < 0 && moved == 0) {
+				free(buf);
+				return -1;
+			}
+			break;
+		}
+		w = hj_sf_write(out, buf, (size_t)r, opos);
+		if (w > 0)
+			moved += (size_t)w;
+		if (w < r || once)
+			break;
+	}
+	free(buf);
+	return (ssize_t)moved;
+}
+
+ssize_t
+sendfile(int out, int in, off_t *offset, size_t count)
+{
+	int rout = hj_rfd(out), rin = hj_rfd(in);
+	off_t pos, at;
+	ssize_t n;
+
+	if (rout < 0 && rin < 0)
+		return real_sendfile(out, in, offset, count);
+	if (rin >= 0)
+		return hj_sf_bounce(out, NULL, in, offset, count, 0, 0);
+	pos = offset ? *offset : lseek(in, 0, SEEK_CUR);
+	n = hj_send_mapped(rout, in, pos, count, 0);
+	if (n == -2) {
+		/* Not mappable: bounce from pos (pread), or a pipe/socket. */
+		if (pos < 0)
+			return hj_sf_bounce(out, NULL, in, NULL, count, 0, 0);
+		at = pos;
+		n = hj_sf_bounce(out, NULL, in, &at, count, 0, 0);
+	}
+	if (n > 0) {
+		if (offset)
+			*offset = pos + n;
+		else
+			(void)lseek(in, pos + n, SEEK_SET);
+	}
+	return n;
+}
+
+ssize_t
+splice(int in, loff_t *ipos, int out, loff_t *opos, size_t len,
+	unsigned int flags)
+{
+	int dontwait = (flags & LINUX_SPLICE_F_NONBLOCK) != 0;
+	int rout = hj_rfd(out), rin = hj_rfd(in);
+	off_t pos;
+	ssize_t n;
+
+	if (rout < 0 && rin < 0)
+		return real_splice(in, ipos, out, opos, len, flags);
+	if (rout >= 0 && rin < 0) {
+		pos = ipos ? *ipos : lseek(in, 0, SEEK_CUR);
+		if (pos >= 0 &&
+		    (n = hj_send_mapped(rout, in, pos, len, dontwait)) != -2) {
+			if (n > 0 && ipos)
+				*ipos = pos + n;
+			else if (n > 0)
+				(void)lseek(in, pos + n, SEEK_SET);
+			return n;
+		}
 	}
-	int (*real)(int, int, int, const void *, socklen_t) =
-	    dlsym(RTLD_NEXT, "setsockopt");
-	return real(fd, level, optname, val, len);
+	return hj_sf_bounce(out, opos, in, ipos, len, dontwait, 1);
 }
@@ -7,20 +7,41 @@
  * Differences vs. the stock/container backend:
  *  - open("/dev/net/tap0") directly; NO /dev/net/tun + TUNSETIFF (the Akuma tap is
  *    a clean packet device, not a Linux TUN/TAP impersonation).
- *  - the kernel tap fd is non-blocking with NO poll/epoll yet, so the RX thread
- *    BUSY-POLLS read() (EAGAIN → short nanosleep) instead of poll()ing.
+ *  - under the fiber backend the tap fd is non-blocking and an idle RX fiber
+ *    parks on it with rumpuser_akuma_wait_fd (POLLIN), as the sysproxy channel
+ *    does in sp_serve_fd.c: the kernel wakes the poll from NIC1's RX interrupt,
+ *    so an idle box sleeps instead of re-polling every scheduler tick.
+ *  - frames move through the tap's shared slot ring when the kernel offers one
+ *    (mmap of the tap fd; crates/akuma-rump/src/ring.rs): TX frames are copied
+ *    from the iovec straight into a slot, and one TAPRINGSYNC per pass both
+ *    sends them and fills the free RX slots, whose frames go to the stack in
+ *    one schedule/unschedule bracket. No syscall or kernel temp per frame.
+ *  - without the ring, RX drains the NIC with TAPRECVBATCH (every ready frame,
+ *    up to RX_BATCH, per syscall); kernels without that (ENOTTY) get one
+ *    read() per frame, as before.
+ *  - RUMP_VIRTIF_GRO=<mtu> turns on receive coalescing (virtif_gro.h): RX keeps
+ *    draining while frames are pending, up to RX_GRO_MAX frames or RX_GRO_US,
+ *    and in-order TCP segments of one flow in that batch go to the stack as one
+ *    frame of up to <mtu> IP bytes. The interface MTU must be raised to match
+ *    (rump_server does so), or ether_input drops the merged frames; the cost is
+ *    that the stack then also sends IP datagrams that large, which the wire
+ *    will not carry, so it is for TCP-bulk boxes. Off by default.
  *
- * Same instrumentation as virtif_user_instr.c: per-frame counters/log at the
- * rump↔wire seam (RUMP_VIRTIF_TRACE=1) + virtif_dump_stats() (the proof).
+ * Same instrumentation as virtif_user_instr.c: counters, latency/batch
+ * histograms and a SIGUSR1 dump at the rump↔wire seam (virtif_stats.h), the
+ * per-frame log (RUMP_VIRTIF_TRACE=1) + virtif_dump_stats() (the proof).
  */
 #ifndef _KERNEL
 #include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/uio.h>
 
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,6 +53,8 @@
 
 #include "if_virt.h"
 #include "virtif_user.h"
+#include "virtif_stats.h"
+#include "virtif_gro.h"
 
 #if VIFHYPER_REVISION != 20140313
 #error VIFHYPER_REVISION mismatch
@@ -39,6 +62,47 @@
 
 #define TAPDEV "/dev/net/tap0"
 
+/*
+ * Batched tap I/O (kernel src/syscall/term.rs). The buffer holds records of
+ * [u32 little-endian length][frame][pad to 4]; the kernel only adds a frame
+ * while TAP_RECORD_MAX bytes are left, so RX_BATCH of those fit every frame.
+ */
+struct tap_batch {
+	uint64_t buf;
+	uint32_t len;
+	uint32_t max_frames;
+};
+#define TAPRECVBATCH	_IOWR('T', 0xf0, struct tap_batch)
+#define TAP_FRAME_MAX	2048	/* the kernel's staging buffer (FRAME_BUF) */
+#define TAP_RECORD_MAX	(4 + TAP_FRAME_MAX)
+#define RX_BATCH	16
+
+/* With GRO on, one RX batch keeps draining up to these caps. */
+#define RX_GRO_MAX	VG_MAX_SEGS	/* frames */
+#define RX_GRO_US	200		/* µs after the first frame */
+
+/*
+ * The shared ring (layout: crates/akuma-rump/src/ring.rs). Indices are
+ * free-running u32s; slot = index % RING_SLOTS. The kernel writes rx_tail and
+ * tx_head, we write rx_head and tx_tail, each published with release after
+ * the slots it covers.
+ */
+#define RING_BYTES	(4096 + 2 * RING_SLOTS * RING_SLOT_SIZE)
+#define RING_SLOTS	64
+#define RING_SLOT_SIZE	2048
+#define RING_MAGIC	0x474e5254	/* "TRNG" */
+#define RING_RX_HEAD	64
+#define RING_RX_TAIL	128
+#define RING_TX_HEAD	192
+#define RING_TX_TAIL	256
+#define RING_RX_LEN	1024
+#define RING_TX_LEN	1536
+#define RING_RX_SLOTS	4096
+#define RING_TX_SLOTS	(RING_RX_SLOTS + RING_SLOTS * RING_SLOT_SIZE)
+#define RING_U32(r, off)	((uint32_t *)((r) + (off)))
+#define TAPRINGSYNC	_IO('T', 0xf2)
+#define TAPRING_WAIT	1
+
 /*
  * Create the RX thread via the rumpuser hypercall, NOT pthread_create directly.
  * Under the default (pthread) rumpuser this still maps to a host pthread; under
@@ -62,8 +126,27 @@ extern int rumpuser_thread_join(void *cookie);
  */
 extern int rumpuser_akuma_cooperative(void);
 extern void rumpuser_akuma_yield(void);
+extern int rumpuser_akuma_wait_fd(int fd, int events, int timeout_ms);
+
+/*
+ * Fiber Thread/stack pool counters (fiber.rs FiberStats; same field order).
+ * Returns -1 under the pthread backend, which has no pool.
+ */
+struct akfiber_stats {
+	unsigned long fresh;      /* Thread+stack built from scratch */
+	unsigned long reused;     /* creates served from the pool */
+	unsigned long pooled;     /* reaped fibers parked for reuse */
+	unsigned long unmapped;   /* reaped fibers released (pool full) */
+	unsigned long pool_len, pool_hiwat, pool_max;
+};
+extern int rumpuser_akuma_fiber_stats(struct akfiber_stats *out);
+
+/*
+ * Longest an idle RX fiber sleeps on the tap fd before re-polling anyway, so a
+ * missed readiness edge costs latency, never a wedged receiver.
+ */
+#define RX_IDLE_WAIT_MS	1000
 
-static volatile unsigned long g_tx_pkts, g_tx_bytes, g_rx_pkts, g_rx_bytes;
 static int g_trace = -1;
 
 static void
@@ -97,7 +180,15 @@ virtif_dump_stats(void)
 	fprintf(stderr,
 	    "[VIRTIF STATS] tx=%lu pkts/%lu bytes  rx=%lu pkts/%lu bytes "
 	    "(carried by the NetBSD rump stack over /dev/net/tap0)\n",
-	    g_tx_pkts, g_tx_bytes, g_rx_pkts, g_rx_bytes);
+	    VS_GET(tx_pkts), VS_GET(tx_bytes), VS_GET(rx_pkts), VS_GET(rx_bytes));
+	vs_dump();
+	struct akfiber_stats fs;
+	if (rumpuser_akuma_fiber_stats(&fs) == 0)
+		fprintf(stderr,
+		    "[FIBER STATS] fresh=%lu reused=%lu pooled=%lu unmapped=%lu "
+		    "pool=%lu/%lu (hiwat %lu)\n",
+		    fs.fresh, fs.reused, fs.pooled, fs.unmapped,
+		    fs.pool_len, fs.pool_max, fs.pool_hiwat);
 }
 
 struct virtif_user {
@@ -105,41 +196,286 @@ struct virtif_user {
 	int viu_fd;
 	int viu_dying;
 	void *viu_rcvcookie;   /* rumpuser_thread_create cookie (pthread or fiber) */
-	char viu_rcvbuf[9018];
+	int viu_nobatch;       /* kernel has no TAPRECVBATCH: read() per frame */
+	unsigned char *viu_ring;   /* the tap's shared slot ring, or NULL */
+	int viu_txlock;        /* one TX producer at a time in the ring */
+	size_t viu_gro;        /* RUMP_VIRTIF_GRO: merged IP length cap, 0 = off */
+	struct vg_out viu_groout;
+	unsigned char *viu_groframe;   /* 14 + viu_gro bytes, merged frames */
+	char viu_rcvbuf[RX_GRO_MAX * TAP_RECORD_MAX];
 };
 
+/* RUMP_VIRTIF_GRO: the MTU merged frames may reach (576..65535), or 0. */
+static size_t
+gro_mtu(void)
+{
+	const char *e = getenv("RUMP_VIRTIF_GRO");
+	long v = e ? strtol(e, NULL, 10) : 0;
+
+	if (v < 576)
+		return 0;
+	return v > 65535 ? 65535 : (size_t)v;
+}
+
+/*
+ * Hand n received frames to the stack in one rump CPU bracket, merged first
+ * if GRO is on. The stack copies each frame into an mbuf chain, so the
+ * buffers are free once this returns. A merged frame is gathered into
+ * viu_groframe first: if_virt.c's VIF_DELIVERPKT is only ever given one iovec
+ * by the stock backends, and its m_copyback length check assumes that.
+ */
+static void
+deliver(struct virtif_user *viu, struct iovec *iov, int n)
+{
+	struct vg_out *o = &viu->viu_groout;
+	struct iovec flat;
+	size_t j;
+	int i, k;
+
+	rumpuser_component_schedule(NULL);
+	for (i = 0; i < n; i += k) {
+		if (viu->viu_gro == 0) {
+			VIF_DELIVERPKT(viu->viu_virtifsc, &iov[i], 1);
+			k = 1;
+			continue;
+		}
+		k = vg_next(iov, n, i, viu->viu_gro, o);
+		if (k == 1) {
+			VIF_DELIVERPKT(viu->viu_virtifsc, o->iov, 1);
+			continue;
+		}
+		VS_INC(rx_gro_pkts);
+		VS_ADD(rx_gro_segs, (unsigned long)k);
+		flat.iov_base = viu->viu_groframe;
+		flat.iov_len = 0;
+		for (j = 0; j < o->iovlen; j++) {
+			memcpy(viu->viu_groframe + flat.iov_len,
+			    o->iov[j].iov_base, o->iov[j].iov_len);
+			flat.iov_len += o->iov[j].iov_len;
+		}
+		VIF_DELIVERPKT(viu->viu_virtifsc, &flat, 1);
+	}
+	rumpuser_component_unschedule();
+}
+
+/*
+ * Receive up to RX_BATCH frames into viu_rcvbuf and describe them in iov[at..],
+ * after the `at` frames already there. Returns the number of frames, or <1 if
+ * none (errno EAGAIN/EINTR).
+ */
+static int
+rcvframes(struct virtif_user *viu, struct iovec *iov, int at)
+{
+	/* a frame's record takes at most TAP_RECORD_MAX, so frame `at` on
+	 * starts at or after slot `at` */
+	char *buf = viu->viu_rcvbuf + (size_t)at * TAP_RECORD_MAX;
+	int max = RX_GRO_MAX - at < RX_BATCH ? RX_GRO_MAX - at : RX_BATCH;
+	struct tap_batch tb;
+	unsigned char *p;
+	uint32_t len;
+	ssize_t nn;
+	int n, i;
+
+	iov += at;
+	if (!viu->viu_nobatch) {
+		tb.buf = (uint64_t)(uintptr_t)buf;
+		tb.len = (uint32_t)max * TAP_RECORD_MAX;
+		tb.max_frames = (uint32_t)max;
+		n = ioctl(viu->viu_fd, TAPRECVBATCH, &tb);
+		if (n == -1 && (errno == ENOTTY || errno == EINVAL)) {
+			viu->viu_nobatch = 1;
+		} else {
+			if (n < 1) {
+				if (n == 0 || errno == EAGAIN)
+					VS_INC(rx_eagain);
+				else if (errno != EINTR)
+					VS_INC(rx_errs);
+			}
+			p = (unsigned char *)buf;
+			for (i = 0; i < n; i++) {
+				memcpy(&len, p, sizeof(len));
+				iov[i].iov_base = p + 4;
+				iov[i].iov_len = len;
+				p += (4 + len + 3) & ~3u;
+			}
+			return n;
+		}
+	}
+	nn = read(viu->viu_fd, buf, TAP_RECORD_MAX);
+	if (nn < 1) {
+		if (nn == -1 && errno == EAGAIN)
+			VS_INC(rx_eagain);
+		else if (!(nn == -1 && errno == EINTR))
+			VS_INC(rx_errs);
+		return 0;
+	}
+	iov[0].iov_base = buf;
+	iov[0].iov_len = nn;
+	return 1;
+}
+
+/* Whether another frame is ready on the tap, without blocking. */
+static int
+rcvpending(struct virtif_user *viu)
+{
+	struct pollfd pfd = { .fd = viu->viu_fd, .events = POLLIN };
+
+	return poll(&pfd, 1, 0) == 1;
+}
+
+/*
+ * RX over the ring. Each sync also sends whatever VIFHYPER_SEND queued, so
+ * this thread is the ring's TX flusher too: a blocking sync sleeps in the
+ * kernel until a frame arrives, and a cooperative one parks on the tap fd once
+ * both directions are idle. Either way sendring kicks it when TX goes from
+ * empty to non-empty.
+ */
+static void
+rcvring(struct virtif_user *viu, int coop)
+{
+	unsigned char *ring = viu->viu_ring;
+	struct iovec iov[RX_GRO_MAX];
+	uint32_t max = viu->viu_gro ? RX_GRO_MAX : RX_BATCH;
+	uint32_t head, tail, n;
+	uint32_t i;
+	uint64_t t0;
+
+	while (!viu->viu_dying) {
+		if (ioctl(viu->viu_fd, TAPRINGSYNC, coop ? 0 : TAPRING_WAIT) < 1) {
+			VS_INC(rx_eagain);
+			if (!coop)
+				continue;
+			/* a TX frame the NIC refused is retried next pass */
+			VS_INC(rx_waits);
+			if (*RING_U32(ring, RING_TX_TAIL) != __atomic_load_n(
+			    RING_U32(ring, RING_TX_HEAD), __ATOMIC_ACQUIRE))
+				rumpuser_akuma_yield();
+			else
+				rumpuser_akuma_wait_fd(viu->viu_fd, POLLIN,
+				    RX_IDLE_WAIT_MS);
+			continue;
+		}
+		t0 = vs_now_us();
+		head = *RING_U32(ring, RING_RX_HEAD);
+		tail = __atomic_load_n(RING_U32(ring, RING_RX_TAIL), __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			n = tail - head < max ? tail - head : max;
+			for (i = 0; i < n; i++) {
+				uint32_t slot = (head + i) % RING_SLOTS;
+				iov[i].iov_base = ring + RING_RX_SLOTS + slot * RING_SLOT_SIZE;
+				iov[i].iov_len = *RING_U32(ring, RING_RX_LEN + slot * 4);
+				VS_INC(rx_pkts);
+				VS_ADD(rx_bytes, (unsigned long)iov[i].iov_len);
+				if (g_trace == 1)
+					log_frame("RX", &iov[i], 1, VS_GET(rx_pkts));
+			}
+
+			/* the slots are free once the stack has its mbufs */
+			deliver(viu, iov, (int)n);
+			vs_hist(vs.rx_lat, vs_now_us() - t0);
+			vs_hist(vs.rx_batch, n);
+
+			head += n;
+			__atomic_store_n(RING_U32(ring, RING_RX_HEAD), head, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+/*
+ * Queue one frame in the TX ring; 0 if the ring stayed full. The first frame
+ * into an empty ring kicks a sync, since the RX thread may be asleep: the
+ * kick sends it, or (EBUSY) wakes the RX thread's blocking sync to do so.
+ * Frames queued behind it ride along with that sync.
+ */
+static int
+sendring(struct virtif_user *viu, struct iovec *iov, size_t iovlen)
+{
+	unsigned char *ring = viu->viu_ring;
+	unsigned char *slot;
+	uint32_t tail, off = 0;
+	size_t i, c;
+	int tries, kick;
+
+	while (__atomic_test_and_set(&viu->viu_txlock, __ATOMIC_ACQUIRE))
+		;
+	tail = *RING_U32(ring, RING_TX_TAIL);
+	for (tries = 0; tail - __atomic_load_n(RING_U32(ring, RING_TX_HEAD),
+	    __ATOMIC_ACQUIRE) >= RING_SLOTS; tries++) {
+		/* full: the RX thread flushes on its next pass. Kick it along
+		 * (EBUSY while it is already syncing), then give up and drop,
+		 * as a full NIC queue would */
+		if (tries == 8) {
+			__atomic_clear(&viu->viu_txlock, __ATOMIC_RELEASE);
+			return 0;
+		}
+		if (ioctl(viu->viu_fd, TAPRINGSYNC, 0) == -1)
+			rumpuser_akuma_yield();
+	}
+	kick = tail == __atomic_load_n(RING_U32(ring, RING_TX_HEAD), __ATOMIC_ACQUIRE);
+	slot = ring + RING_TX_SLOTS + (tail % RING_SLOTS) * RING_SLOT_SIZE;
+	for (i = 0; i < iovlen && off < RING_SLOT_SIZE; i++) {
+		c = iov[i].iov_len;
+		if (off + c > RING_SLOT_SIZE)
+			c = RING_SLOT_SIZE - off;
+		memcpy(slot + off, iov[i].iov_base, c);
+		off += c;
+	}
+	*RING_U32(ring, RING_TX_LEN + (tail % RING_SLOTS) * 4) = off;
+	__atomic_store_n(RING_U32(ring, RING_TX_TAIL), tail + 1, __ATOMIC_RELEASE);
+	__atomic_clear(&viu->viu_txlock, __ATOMIC_RELEASE);
+	if (kick)
+		(void)ioctl(viu->viu_fd, TAPRINGSYNC, 0);
+	return 1;
+}
+
 static void *
 rcvthread(void *aaargh)
 {
 	struct virtif_user *viu = aaargh;
-	struct iovec iov;
-	ssize_t nn;
+	struct iovec iov[RX_GRO_MAX];
+	uint64_t t0;
+	int n, m, i;
 
 	rumpuser_component_kthread();
 
 	/* pthread backend: the tap fd is BLOCKING; read() parks THIS host thread until
 	 * a frame arrives (no rump CPU held, so other rump threads keep running).
-	 * fiber backend: the fd is non-blocking; on EAGAIN we cooperatively yield so
-	 * the rest of the rump kernel (and the DHCP path) runs on the one OS thread. */
+	 * fiber backend: the fd is non-blocking; on EAGAIN we park this fiber on the
+	 * tap fd so the rest of the rump kernel (and the DHCP path) runs on the one
+	 * OS thread, and the OS thread itself sleeps in poll() once all are idle. */
 	int coop = rumpuser_akuma_cooperative();
+	if (viu->viu_ring != NULL) {
+		rcvring(viu, coop);
+		rumpuser_component_kthread_release();
+		return NULL;
+	}
 	while (!viu->viu_dying) {
-		nn = read(viu->viu_fd, viu->viu_rcvbuf, sizeof(viu->viu_rcvbuf));
-		if (nn < 1) {
-			if (coop)
-				rumpuser_akuma_yield();
+		n = rcvframes(viu, iov, 0);
+		if (n < 1) {
+			if (coop) {
+				VS_INC(rx_waits);
+				rumpuser_akuma_wait_fd(viu->viu_fd, POLLIN,
+				    RX_IDLE_WAIT_MS);
+			}
 			continue;
 		}
-		iov.iov_base = viu->viu_rcvbuf;
-		iov.iov_len = nn;
-
-		g_rx_pkts++;
-		g_rx_bytes += (unsigned long)nn;
-		if (g_trace == 1)
-			log_frame("RX", &iov, 1, g_rx_pkts);
+		t0 = vs_now_us();
+		/* GRO: a full batch means more are likely queued; keep taking
+		 * them while the caps allow, so there is more to merge */
+		for (m = n; viu->viu_gro && m == RX_BATCH && n < RX_GRO_MAX &&
+		    vs_now_us() - t0 < RX_GRO_US && rcvpending(viu); n += m)
+			if ((m = rcvframes(viu, iov, n)) < 1)
+				break;
+		for (i = 0; i < n; i++) {
+			VS_INC(rx_pkts);
+			VS_ADD(rx_bytes, (unsigned long)iov[i].iov_len);
+			if (g_trace == 1)
+				log_frame("RX", &iov[i], 1, VS_GET(rx_pkts));
+		}
 
-		rumpuser_component_schedule(NULL);
-		VIF_DELIVERPKT(viu->viu_virtifsc, &iov, 1);
-		rumpuser_component_unschedule();
+		deliver(viu, iov, n);
+		vs_hist(vs.rx_lat, vs_now_us() - t0);
+		vs_hist(vs.rx_batch, (uint64_t)n);
 	}
 	rumpuser_component_kthread_release();
 	return NULL;
@@ -155,11 +491,16 @@ VIFHYPER_CREATE(const char *devstr, struct virtif_sc *vif_sc, uint8_t *enaddr,
 
 	(void)devstr;   /* single tap device; ignore the unit string */
 	trace_init();
+	vs_install_signal();
 	cookie = rumpuser_component_unschedule();
 
 	viu = calloc(1, sizeof(*viu));
 	if (viu == NULL) { rv = errno; goto err1; }
 	viu->viu_virtifsc = vif_sc;
+	viu->viu_gro = gro_mtu();
+	if (viu->viu_gro != 0 &&
+	    (viu->viu_groframe = malloc(14 + viu->viu_gro)) == NULL)
+		viu->viu_gro = 0;
 
 	viu->viu_fd = open(TAPDEV, O_RDWR | (rumpuser_akuma_cooperative() ? O_NONBLOCK : 0));
 	if (viu->viu_fd == -1) {
@@ -169,6 +510,15 @@ VIFHYPER_CREATE(const char *devstr, struct virtif_sc *vif_sc, uint8_t *enaddr,
 		goto err2;
 	}
 
+	viu->viu_ring = mmap(NULL, RING_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    viu->viu_fd, 0);
+	if (viu->viu_ring == MAP_FAILED)
+		viu->viu_ring = NULL;
+	else if (*RING_U32(viu->viu_ring, 0) != RING_MAGIC) {
+		munmap(viu->viu_ring, RING_BYTES);
+		viu->viu_ring = NULL;
+	}
+
 	if ((rv = rumpuser_thread_create(rcvthread, viu, "tap-rx", 1, 0, -1,
 	    &viu->viu_rcvcookie)) != 0)
 		goto err3;
@@ -178,8 +528,11 @@ VIFHYPER_CREATE(const char *devstr, struct virtif_sc *vif_sc, uint8_t *enaddr,
 	return 0;
 
  err3:
+	if (viu->viu_ring != NULL)
+		munmap(viu->viu_ring, RING_BYTES);
 	close(viu->viu_fd);
  err2:
+	free(viu->viu_groframe);
 	free(viu);
  err1:
 	rumpuser_component_schedule(cookie);
@@ -190,19 +543,23 @@ void
 VIFHYPER_SEND(struct virtif_user *viu, struct iovec *iov, size_t iovlen)
 {
 	void *cookie = rumpuser_component_unschedule();
+	uint64_t t0 = vs_now_us();
 	size_t i, total = 0;
-	ssize_t idontcare __attribute__((__unused__));
+	ssize_t wrv = 0;
 
 	for (i = 0; i < iovlen; i++)
 		total += iov[i].iov_len;
-	g_tx_pkts++;
-	g_tx_bytes += (unsigned long)total;
+	VS_INC(tx_pkts);
+	VS_ADD(tx_bytes, (unsigned long)total);
 	if (g_trace == 1)
-		log_frame("TX", iov, iovlen, g_tx_pkts);
+		log_frame("TX", iov, iovlen, VS_GET(tx_pkts));
 
+	if (viu->viu_ring != NULL) {
+		if (!sendring(viu, iov, iovlen))
+			VS_INC(tx_drops);
 	/* The kernel tap write(2) takes one whole L2 frame; coalesce the iov. */
-	if (iovlen == 1) {
-		idontcare = write(viu->viu_fd, iov[0].iov_base, iov[0].iov_len);
+	} else if (iovlen == 1) {
+		wrv = write(viu->viu_fd, iov[0].iov_base, iov[0].iov_len);
 	} else {
 		char tmp[9018];
 		size_t off = 0;
@@ -212,8 +569,11 @@ VIFHYPER_SEND(struct virtif_user *viu, struct iovec *iov, size_t iovlen)
 			memcpy(tmp + off, iov[i].iov_base, c);
 			off += c;
 		}
-		idontcare = write(viu->viu_fd, tmp, off);
+		wrv = write(viu->viu_fd, tmp, off);
 	}
+	if (wrv == -1)
+		VS_INC(tx_errs);
+	vs_hist(vs.tx_lat, vs_now_us() - t0);
 
 	rumpuser_component_schedule(cookie);
 }
@@ -231,7 +591,10 @@ VIFHYPER_DESTROY(struct virtif_user *viu)
 	void *cookie = rumpuser_component_unschedule();
 	viu->viu_dying = 1;
 	rumpuser_thread_join(viu->viu_rcvcookie);
+	if (viu->viu_ring != NULL)
+		munmap(viu->viu_ring, RING_BYTES);
 	close(viu->viu_fd);
+	free(viu->viu_groframe);
 	free(viu);
 	rumpuser_component_schedule(cookie);
 }
@@ -8,13 +8,17 @@
  * Akuma box booted with RUMP_NIC=1 (so /dev/net/tap0 is backed by NIC1's SLIRP,
  * which also serves DHCP and NATs to the QEMU host at 10.0.2.2).
  *
- *   rumphttp [host] [port]      default: 10.0.2.2 80   (the QEMU host)
+ *   rumphttp [host] [port] [path]      default: 10.0.2.2 80 /   (the QEMU host)
+ *
+ * Given a path, the body is counted but not echoed, so a large file measures
+ * bulk TCP receive throughput through the stack (the RUMPHTTP: rate line).
  */
 #include <sys/types.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <rump/rump.h>
 #include <rump/rump_syscalls.h>
@@ -47,6 +51,9 @@ main(int argc, char **argv)
 {
 	const char *host = (argc > 1) ? argv[1] : "10.0.2.2";
 	int port = (argc > 2) ? atoi(argv[2]) : 80;
+	const char *path = (argc > 3) ? argv[3] : "/";
+	int echo = (argc <= 3);
+	struct timespec t0, t1;
 	int rv, s;
 
 	setvbuf(stdout, NULL, _IONBF, 0);
@@ -82,21 +89,30 @@ main(int argc, char **argv)
 	printf("RUMPHTTP: connect %s:%d -> %d\n", host, port, rv);
 	if (rv != 0) { virtif_dump_stats(); return 1; }
 
-	char req[256];
+	char req[512];
 	int reqlen = snprintf(req, sizeof(req),
-	    "GET / HTTP/1.0\r\nHost: %s\r\nUser-Agent: rumphttp\r\n\r\n", host);
+	    "GET %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: rumphttp\r\n\r\n",
+	    path, host);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
 	rv = rump_sys_write(s, req, reqlen);
 	printf("RUMPHTTP: sent %d-byte GET -> %d\n", reqlen, rv);
 
 	printf("RUMPHTTP: --- response over the NetBSD rump stack ---\n");
-	char buf[2048];
+	char buf[16384];
 	ssize_t n, total = 0;
-	while ((n = rump_sys_read(s, buf, sizeof(buf) - 1)) > 0) {
-		buf[n] = '\0';
-		fwrite(buf, 1, n, stdout);
+	while ((n = rump_sys_read(s, buf, sizeof(buf))) > 0) {
+		if (echo)
+			fwrite(buf, 1, n, stdout);
 		total += n;
 	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
 	printf("\nRUMPHTTP: --- end (%ld bytes) ---\n", (long)total);
+	{
+		long ms = (t1.tv_sec - t0.tv_sec) * 1000L +
+		    (t1.tv_nsec - t0.tv_nsec) / 1000000L;
+		printf("RUMPHTTP: rate %ld bytes in %ld ms = %ld KiB/s\n",
+		    (long)total, ms, ms > 0 ? (long)(total / 1024 * 1000 / ms) : 0L);
+	}
 	rump_sys_close(s);
 
 	virtif_dump_stats();
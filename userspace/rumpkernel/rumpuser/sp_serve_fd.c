@@ -8,7 +8,11 @@
  *
  * This file #includes the NetBSD `rumpuser_sp.c` to reach its (static) per-client
  * machinery (spclist/pfdlist, readframe, handlereq, kickwaiter, banner, ...) and
- * adds `rumpuser_sp_init_fd()` + a one-client serve loop reduced from `spserver`.
+ * adds `rumpuser_sp_init_fd()`/`rumpuser_sp_init_mux()` + a serve loop reduced
+ * from `spserver` (one channel, or several announced on a control fd),
+ * a persistent worker pool behind the pthread_create redirect below, the
+ * PREFETCH bulk-copy extension behind a rumpuser_sp_copyin wrapper, and the
+ * shared-memory channel behind the channel I/O redirects.
  * The NetBSD source is unmodified; this addition is original Akuma code derived
  * from NetBSD's `spserver`/`serv_handleconn` (NetBSD project, BSD-licensed,
  * copyright the NetBSD contributors).
@@ -44,8 +48,11 @@ extern int __akuma_real_pthread_create(pthread_t *, const pthread_attr_t *,
     void *(*)(void *), void *) __asm__("pthread_create");
 extern int __akuma_real_pthread_detach(pthread_t) __asm__("pthread_detach");
 
+static int sp_pool_dispatch(pthread_t *, void *(*)(void *), void *);
+
+/* Start a thread for real: a fiber under the cooperative backend, else a pthread. */
 static int
-akuma_sp_pthread_create(pthread_t *t, const pthread_attr_t *attr,
+akuma_sp_spawn(pthread_t *t, const pthread_attr_t *attr,
     void *(*fn)(void *), void *arg)
 {
 	if (rumpuser_akuma_cooperative()) {
@@ -57,6 +64,21 @@ akuma_sp_pthread_create(pthread_t *t, const pthread_attr_t *attr,
 	}
 	return __akuma_real_pthread_create(t, attr, fn, arg);
 }
+
+/*
+ * rumpuser_sp.c creates only detached threads (schedulework's request workers,
+ * with &pattr_detached); hand those to a parked pool worker when one is idle, so a
+ * request costs one wakeup instead of a create + first schedule + exit. Our own
+ * serve-loop thread (attr NULL, below) and pool misses get a real thread.
+ */
+static int
+akuma_sp_pthread_create(pthread_t *t, const pthread_attr_t *attr,
+    void *(*fn)(void *), void *arg)
+{
+	if (attr != NULL && sp_pool_dispatch(t, fn, arg) == 0)
+		return 0;
+	return akuma_sp_spawn(t, attr, fn, arg);
+}
 static int
 akuma_sp_pthread_detach(pthread_t t)
 {
@@ -145,11 +167,744 @@ static int akuma_sp_cond_destroy(pthread_cond_t *c) {
 #define pthread_cond_broadcast akuma_sp_cond_broadcast
 #define pthread_cond_destroy akuma_sp_cond_destroy
 
+/*
+ * Shared-memory channel (Akuma extension; layout and the kernel side in
+ * crates/akuma-rump shmchan.rs). The kernel backs the channel fd with a region
+ * holding a request ring and a response ring; mapping it with mmap(fd) moves
+ * the frames off the kernel pipes, which then only carry doorbells: one byte,
+ * written only when the peer cleared its bell to say it is going to sleep.
+ * rumpuser_sp.c does its channel I/O through plain read/send/poll, so those
+ * calls are redirected below and served from the rings for a channel fd;
+ * every other fd goes straight to libc. A kernel without the region (the
+ * mmap fails or shows no magic) leaves the channel on the pipes.
+ */
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SPCH_MAGIC	0x48435053u	/* "SPCH" */
+#define SPCH_VERSION	1
+#define SPCH_RING_BYTES	(128 * 1024)
+#define SPCH_BYTES	(4096 + 2 * SPCH_RING_BYTES)
+#define SPCH_OFF_MAGIC	0
+#define SPCH_OFF_VERSION 4
+#define SPCH_OFF_RING_BYTES 8
+#define SPCH_REQ_HEAD	64	/* ours: request bytes consumed */
+#define SPCH_REQ_TAIL	128	/* kernel: request bytes produced */
+#define SPCH_RESP_HEAD	192	/* kernel: response bytes consumed */
+#define SPCH_RESP_TAIL	256	/* ours: response bytes produced */
+#define SPCH_REQ_BELL	320	/* 0 = we sleep, kernel rings and sets 1 */
+#define SPCH_RESP_BELL	384	/* 0 = kernel sleeps, we ring and set 1 */
+#define SPCH_REQ_RING	4096
+#define SPCH_RESP_RING	(SPCH_REQ_RING + SPCH_RING_BYTES)
+
+/*
+ * Mapped channel regions by fd: one per shm channel of the multi-client server
+ * (rumpuser_sp_init_mux), or just the one of a single-channel server. A fd not
+ * in the table is a plain pipe channel (or not a channel at all).
+ */
+#define SP_MAXCHAN	32
+
+struct sp_shm_chan {
+	int sc_fd;
+	int sc_eof;		/* the doorbell pipe hit EOF: the kernel hung up */
+	uint8_t *sc_base;	/* NULL = free */
+};
+static struct sp_shm_chan sp_shm_tab[SP_MAXCHAN];
+static int sp_shm_nchan;
+
+extern ssize_t __akuma_real_read(int, void *, size_t) __asm__("read");
+extern ssize_t __akuma_real_write(int, const void *, size_t) __asm__("write");
+extern ssize_t __akuma_real_writev(int, const struct iovec *, int)
+    __asm__("writev");
+extern ssize_t __akuma_real_recvfrom(int, void *, size_t, int,
+    struct sockaddr *, socklen_t *) __asm__("recvfrom");
+extern ssize_t __akuma_real_sendto(int, const void *, size_t, int,
+    const struct sockaddr *, socklen_t) __asm__("sendto");
+extern ssize_t __akuma_real_sendmsg(int, const struct msghdr *, int)
+    __asm__("sendmsg");
+extern int __akuma_real_poll(struct pollfd *, nfds_t, int) __asm__("poll");
+
+static uint32_t
+sp_shm_load(const uint8_t *shm, size_t off)
+{
+	return __atomic_load_n((const uint32_t *)(const void *)(shm + off),
+	    __ATOMIC_ACQUIRE);
+}
+
+static void
+sp_shm_store(uint8_t *shm, size_t off, uint32_t v)
+{
+	__atomic_store_n((uint32_t *)(void *)(shm + off), v, __ATOMIC_RELEASE);
+}
+
+/* Request bytes waiting, or (uint32_t)-1 if the kernel's index is impossible. */
+static uint32_t
+sp_shm_req_avail(const uint8_t *shm)
+{
+	uint32_t n = sp_shm_load(shm, SPCH_REQ_TAIL) -
+	    sp_shm_load(shm, SPCH_REQ_HEAD);
+
+	return n <= SPCH_RING_BYTES ? n : (uint32_t)-1;
+}
+
+/* Free response space, or (uint32_t)-1 likewise. */
+static uint32_t
+sp_shm_resp_room(const uint8_t *shm)
+{
+	uint32_t used = sp_shm_load(shm, SPCH_RESP_TAIL) -
+	    sp_shm_load(shm, SPCH_RESP_HEAD);
+
+	return used <= SPCH_RING_BYTES ? SPCH_RING_BYTES - used : (uint32_t)-1;
+}
+
+/* read(2) on the channel: consume request bytes; EAGAIN while there are none. */
+static ssize_t
+sp_shm_in(uint8_t *shm, void *buf, size_t len)
+{
+	uint32_t head = sp_shm_load(shm, SPCH_REQ_HEAD);
+	uint32_t avail = sp_shm_req_avail(shm);
+	size_t at, first;
+
+	if (avail == (uint32_t)-1) {
+		errno = EIO;
+		return -1;
+	}
+	if (avail == 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+	if (len > avail)
+		len = avail;
+	at = head % SPCH_RING_BYTES;
+	first = len < SPCH_RING_BYTES - at ? len : SPCH_RING_BYTES - at;
+	memcpy(buf, shm + SPCH_REQ_RING + at, first);
+	memcpy((uint8_t *)buf + first, shm + SPCH_REQ_RING, len - first);
+	sp_shm_store(shm, SPCH_REQ_HEAD, head + (uint32_t)len);
+	return (ssize_t)len;
+}
+
+/*
+ * sendmsg(2) on the channel: produce as much of iov as fits (a short count,
+ * like a full socket buffer; EAGAIN if nothing fits) and ring the kernel on
+ * `fd` if it is waiting. rumpuser_sp.c's sendlock keeps this single-producer.
+ */
+static ssize_t
+sp_shm_out(uint8_t *shm, int fd, const struct iovec *iov, int iovcnt)
+{
+	uint32_t tail = sp_shm_load(shm, SPCH_RESP_TAIL);
+	uint32_t room = sp_shm_resp_room(shm);
+	size_t done = 0, want = 0, left, at, n;
+	const uint8_t *p;
+	int i;
+
+	if (room == (uint32_t)-1) {
+		errno = EIO;
+		return -1;
+	}
+	for (i = 0; i < iovcnt; i++) {
+		want += iov[i].iov_len;
+		p = iov[i].iov_base;
+		left = iov[i].iov_len;
+		while (left > 0 && room > 0) {
+			at = (tail + done) % SPCH_RING_BYTES;
+			n = left;
+			if (n > room)
+				n = room;
+			if (n > SPCH_RING_BYTES - at)
+				n = SPCH_RING_BYTES - at;
+			memcpy(shm + SPCH_RESP_RING + at, p, n);
+			p += n;
+			left -= n;
+			room -= n;
+			done += n;
+		}
+	}
+	if (done == 0 && want > 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+	sp_shm_store(shm, SPCH_RESP_TAIL, tail + (uint32_t)done);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (sp_shm_load(shm, SPCH_RESP_BELL) == 0) {
+		sp_shm_store(shm, SPCH_RESP_BELL, 1);
+		(void)__akuma_real_write(fd, "", 1);
+	}
+	return (ssize_t)done;
+}
+
+/*
+ * poll(2) on one channel alone. The kernel drains responses without ringing
+ * us, so waiting for POLLOUT (dosend on a full ring) yields and re-checks.
+ * rumpuser_sp.c only polls a channel with INFTIM, so any non-zero timeout
+ * waits until ready.
+ */
+static int
+sp_shm_poll(const uint8_t *shm, struct pollfd *pfd, int timeout)
+{
+	for (;;) {
+		pfd->revents = 0;
+		if ((pfd->events & POLLIN) && sp_shm_req_avail(shm) != 0)
+			pfd->revents |= POLLIN;
+		if ((pfd->events & POLLOUT) && sp_shm_resp_room(shm) != 0)
+			pfd->revents |= POLLOUT;
+		if (pfd->revents != 0 || timeout == 0)
+			return pfd->revents != 0;
+		if (rumpuser_akuma_cooperative())
+			rumpuser_akuma_yield();
+		else
+			sched_yield();
+	}
+}
+
+/*
+ * Going idle on a channel: clear its bell, drain stale doorbells, and re-check.
+ * Returns non-zero if requests came in meanwhile (the caller must not sleep);
+ * an EOF on the doorbell pipe is noted in sc_eof.
+ */
+static int
+sp_shm_quiesce(struct sp_shm_chan *sc)
+{
+	char b[64];
+	ssize_t n;
+
+	sp_shm_store(sc->sc_base, SPCH_REQ_BELL, 0);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	while ((n = __akuma_real_read(sc->sc_fd, b, sizeof(b))) ==
+	    (ssize_t)sizeof(b))
+		continue;
+	if (n == 0)
+		sc->sc_eof = 1;
+	return sp_shm_req_avail(sc->sc_base) != 0 || sc->sc_eof;
+}
+
+static struct sp_shm_chan *
+sp_shm_find(int fd)
+{
+	int i;
+
+	if (sp_shm_nchan == 0 || fd < 0)
+		return NULL;
+	for (i = 0; i < SP_MAXCHAN; i++)
+		if (sp_shm_tab[i].sc_base != NULL && sp_shm_tab[i].sc_fd == fd)
+			return &sp_shm_tab[i];
+	return NULL;
+}
+
+/* Unmap `fd`'s region, if it has one. */
+static void
+sp_shm_detach(int fd)
+{
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	if (sc == NULL)
+		return;
+	munmap(sc->sc_base, SPCH_BYTES);
+	sc->sc_base = NULL;
+	sc->sc_eof = 0;
+	sp_shm_nchan--;
+}
+
+/* Map the channel region behind `fd`, if the kernel provides one. */
+static void
+sp_shm_attach(int fd)
+{
+	struct sp_shm_chan *sc = NULL;
+	uint8_t *p;
+	int i;
+
+	sp_shm_detach(fd);	/* a stale entry of a closed, reused fd */
+	for (i = 0; i < SP_MAXCHAN && sc == NULL; i++)
+		if (sp_shm_tab[i].sc_base == NULL)
+			sc = &sp_shm_tab[i];
+	if (sc == NULL)
+		return;
+	p = mmap(NULL, SPCH_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		return;
+	if (sp_shm_load(p, SPCH_OFF_MAGIC) != SPCH_MAGIC ||
+	    sp_shm_load(p, SPCH_OFF_VERSION) != SPCH_VERSION ||
+	    sp_shm_load(p, SPCH_OFF_RING_BYTES) != SPCH_RING_BYTES) {
+		munmap(p, SPCH_BYTES);
+		return;
+	}
+	sc->sc_base = p;
+	sc->sc_eof = 0;
+	sc->sc_fd = fd;
+	sp_shm_nchan++;
+	fprintf(stderr, "rump_sp(fd): channel %d over shared memory (%d KiB rings)\n",
+	    fd, SPCH_RING_BYTES / 1024);
+}
+
+static ssize_t
+akuma_sp_read(int fd, void *buf, size_t len)
+{
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_in(sc->sc_base, buf, len)
+	                  : __akuma_real_read(fd, buf, len);
+}
+static ssize_t
+akuma_sp_recv(int fd, void *buf, size_t len, int flags)
+{
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_in(sc->sc_base, buf, len)
+	                  : __akuma_real_recvfrom(fd, buf, len, flags, NULL, NULL);
+}
+static ssize_t
+akuma_sp_recvfrom(int fd, void *buf, size_t len, int flags,
+    struct sockaddr *sa, socklen_t *salen)
+{
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_in(sc->sc_base, buf, len)
+	                  : __akuma_real_recvfrom(fd, buf, len, flags, sa, salen);
+}
+static ssize_t
+akuma_sp_write(int fd, const void *buf, size_t len)
+{
+	struct iovec iov = { .iov_base = (void *)(uintptr_t)buf, .iov_len = len };
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_out(sc->sc_base, fd, &iov, 1)
+	                  : __akuma_real_write(fd, buf, len);
+}
+static ssize_t
+akuma_sp_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_out(sc->sc_base, fd, iov, iovcnt)
+	                  : __akuma_real_writev(fd, iov, iovcnt);
+}
+static ssize_t
+akuma_sp_send(int fd, const void *buf, size_t len, int flags)
+{
+	struct iovec iov = { .iov_base = (void *)(uintptr_t)buf, .iov_len = len };
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_out(sc->sc_base, fd, &iov, 1)
+	                  : __akuma_real_sendto(fd, buf, len, flags, NULL, 0);
+}
+static ssize_t
+akuma_sp_sendto(int fd, const void *buf, size_t len, int flags,
+    const struct sockaddr *sa, socklen_t salen)
+{
+	struct iovec iov = { .iov_base = (void *)(uintptr_t)buf, .iov_len = len };
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_out(sc->sc_base, fd, &iov, 1)
+	                  : __akuma_real_sendto(fd, buf, len, flags, sa, salen);
+}
+static ssize_t
+akuma_sp_sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+	struct sp_shm_chan *sc = sp_shm_find(fd);
+
+	return sc != NULL ? sp_shm_out(sc->sc_base, fd, msg->msg_iov,
+	                        (int)msg->msg_iovlen)
+	                  : __akuma_real_sendmsg(fd, msg, flags);
+}
+static int
+akuma_sp_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	struct sp_shm_chan *sc;
+
+	if (nfds == 1 && (sc = sp_shm_find(fds[0].fd)) != NULL)
+		return sp_shm_poll(sc->sc_base, &fds[0], timeout);
+	return __akuma_real_poll(fds, nfds, timeout);
+}
+#define read akuma_sp_read
+#define recv akuma_sp_recv
+#define recvfrom akuma_sp_recvfrom
+#define write akuma_sp_write
+#define writev akuma_sp_writev
+#define send akuma_sp_send
+#define sendto akuma_sp_sendto
+#define sendmsg akuma_sp_sendmsg
+#define poll akuma_sp_poll
+
+/* rumpuser_sp.c's copyin becomes the wire fallback of our wrapper (below). */
+#define rumpuser_sp_copyin akuma_sp_copyin_wire
+
 #include "rumpuser_sp.c"
 
+#undef rumpuser_sp_copyin
+#undef read
+#undef recv
+#undef recvfrom
+#undef write
+#undef writev
+#undef send
+#undef sendto
+#undef sendmsg
+#undef poll
+
+/*
+ * Persistent sysproxy worker pool. SP_POOL_WORKERS long-lived threads (fibers
+ * under the cooperative backend) park on their own condvar; sp_pool_dispatch
+ * hands one the thread function rumpuser_sp.c asked to start (its request
+ * bouncer), and when that function returns — the bouncer's idle exit — the worker
+ * parks again instead of exiting. Lock order: sbamtx (held by schedulework around
+ * pthread_create) before sp_pool_mtx; a worker runs its job with neither held.
+ */
+#define SP_POOL_WORKERS 8
+
+struct sp_pool_worker {
+	pthread_cond_t w_cv;
+	pthread_t w_thread;
+	void *(*w_fn)(void *);        /* job, or NULL while parked */
+	void *w_arg;
+	struct sp_pool_worker *w_next; /* idle list */
+};
+static pthread_mutex_t sp_pool_mtx;
+static struct sp_pool_worker sp_pool[SP_POOL_WORKERS];
+static struct sp_pool_worker *sp_pool_idle;
+static int sp_pool_up;
+static unsigned long sp_pool_hits, sp_pool_misses;
+
+static void *
+sp_pool_worker_main(void *arg)
+{
+	struct sp_pool_worker *w = arg;
+	void *(*fn)(void *);
+	void *fnarg;
+
+	pthread_mutex_lock(&sp_pool_mtx);
+	for (;;) {
+		w->w_next = sp_pool_idle;
+		sp_pool_idle = w;
+		while (w->w_fn == NULL)
+			pthread_cond_wait(&w->w_cv, &sp_pool_mtx);
+		fn = w->w_fn;
+		fnarg = w->w_arg;
+		pthread_mutex_unlock(&sp_pool_mtx);
+		(void)fn(fnarg);
+		pthread_mutex_lock(&sp_pool_mtx);
+		w->w_fn = NULL;
+	}
+	return NULL;
+}
+
+/* 0 = a parked worker took `fn`; -1 = none idle, caller starts a thread. */
+static int
+sp_pool_dispatch(pthread_t *t, void *(*fn)(void *), void *arg)
+{
+	struct sp_pool_worker *w;
+
+	if (!sp_pool_up)
+		return -1;
+	pthread_mutex_lock(&sp_pool_mtx);
+	w = sp_pool_idle;
+	if (w != NULL) {
+		sp_pool_idle = w->w_next;
+		w->w_fn = fn;
+		w->w_arg = arg;
+		if (t != NULL)
+			*t = w->w_thread;
+		pthread_cond_signal(&w->w_cv);
+		sp_pool_hits++;
+	} else {
+		sp_pool_misses++;
+	}
+	pthread_mutex_unlock(&sp_pool_mtx);
+	return w != NULL ? 0 : -1;
+}
+
+static void
+sp_pool_start(void)
+{
+	int i, n = 0;
+
+	pthread_mutex_init(&sp_pool_mtx, NULL);
+	for (i = 0; i < SP_POOL_WORKERS; i++) {
+		struct sp_pool_worker *w = &sp_pool[i];
+		pthread_cond_init(&w->w_cv, NULL);
+		w->w_fn = NULL;
+		if (akuma_sp_spawn(&w->w_thread, NULL, sp_pool_worker_main, w) != 0)
+			break;
+		pthread_detach(w->w_thread);
+		n++;
+	}
+	sp_pool_up = n > 0;
+	if (n < SP_POOL_WORKERS)
+		fprintf(stderr, "rump_sp(fd): worker pool: %d of %d started\n",
+		    n, SP_POOL_WORKERS);
+}
+
+/*
+ * PREFETCH bulk copy (Akuma extension; client side in crates/akuma-rump
+ * sysproxy.rs). Ahead of a SYSCALL the kernel may send, under the same reqno, a
+ * REQ of type RUMPSP_AKUMA_PREFETCH carrying the user memory that syscall will
+ * copyin (a write's buffer, a writev's iovecs):
+ *
+ *	{ u32 nlive; u32 nseg; u64 live[nlive];
+ *	  nseg * { u64 addr; u64 len; u8 data[len]; pad to 8 } }
+ *
+ * The receive loop files the segments here, before the SYSCALL reaches a
+ * worker; rumpuser_sp_copyin serves a copyin lying inside a segment from it, and
+ * anything else by the usual COPYIN round trip. `live` is the set of reqnos the
+ * client still has in flight: segments of every other reqno are dropped on
+ * arrival, so a buffer the box has since rewritten is never served stale.
+ * Segments belong to the channel they came on (reqnos are per client, and
+ * each client is a different address space); a disconnect drops its own.
+ */
+#define RUMPSP_AKUMA_PREFETCH 0x4150
+#define SP_PREFETCH_MAXBYTES (1024 * 1024)
+
+struct sp_prefetch {
+	const struct spclient *pf_spc;
+	uint64_t pf_reqno;
+	uint64_t pf_addr;
+	uint64_t pf_len;
+	struct sp_prefetch *pf_next;	/* newest first */
+	uint8_t pf_data[];
+};
+static pthread_mutex_t sp_prefetch_mtx;
+static struct sp_prefetch *sp_prefetch_list;
+static size_t sp_prefetch_bytes;
+static unsigned long sp_prefetch_hits, sp_prefetch_wire;
+
+/* Drop every segment of `spc` whose reqno is not in live[]; with nlive 0,
+ * drop all of them. */
+static void
+sp_prefetch_retire(const struct spclient *spc, const uint8_t *live,
+    uint32_t nlive)
+{
+	struct sp_prefetch **pp = &sp_prefetch_list, *pf;
+	uint64_t r;
+	uint32_t i;
+
+	while ((pf = *pp) != NULL) {
+		if (pf->pf_spc != spc) {
+			pp = &pf->pf_next;
+			continue;
+		}
+		for (i = 0; i < nlive; i++) {
+			memcpy(&r, live + 8 * i, sizeof(r));
+			if (r == pf->pf_reqno)
+				break;
+		}
+		if (i < nlive) {
+			pp = &pf->pf_next;
+			continue;
+		}
+		*pp = pf->pf_next;
+		sp_prefetch_bytes -= pf->pf_len;
+		free(pf);
+	}
+}
+
+/* File one PREFETCH frame's payload. A malformed payload files nothing. */
+static void
+sp_prefetch_add(const struct spclient *spc, uint64_t reqno, const uint8_t *p,
+    size_t len)
+{
+	struct sp_prefetch *pf;
+	uint32_t nlive, nseg, i;
+	uint64_t addr, slen;
+	size_t off;
+
+	if (p == NULL || len < 8)
+		return;
+	memcpy(&nlive, p, 4);
+	memcpy(&nseg, p + 4, 4);
+	off = 8 + 8 * (size_t)nlive;
+	if (nlive > len / 8 || off > len)
+		return;
+
+	pthread_mutex_lock(&sp_prefetch_mtx);
+	sp_prefetch_retire(spc, p + 8, nlive);
+	for (i = 0; i < nseg; i++) {
+		if (len - off < 16)
+			break;
+		memcpy(&addr, p + off, 8);
+		memcpy(&slen, p + off + 8, 8);
+		off += 16;
+		if (slen > len - off)
+			break;
+		if (sp_prefetch_bytes + slen <= SP_PREFETCH_MAXBYTES &&
+		    (pf = malloc(sizeof(*pf) + slen)) != NULL) {
+			pf->pf_spc = spc;
+			pf->pf_reqno = reqno;
+			pf->pf_addr = addr;
+			pf->pf_len = slen;
+			memcpy(pf->pf_data, p + off, slen);
+			pf->pf_next = sp_prefetch_list;
+			sp_prefetch_list = pf;
+			sp_prefetch_bytes += slen;
+		}
+		off += (slen + 7) & ~(uint64_t)7;
+		if (off > len)
+			break;
+	}
+	pthread_mutex_unlock(&sp_prefetch_mtx);
+}
+
+int rumpuser_sp_copyin(void *, const void *, void *, size_t);
+
+int
+rumpuser_sp_copyin(void *arg, const void *raddr, void *laddr, size_t len)
+{
+	struct sp_prefetch *pf;
+	uint64_t a = (uint64_t)(uintptr_t)raddr;
+
+	pthread_mutex_lock(&sp_prefetch_mtx);
+	for (pf = sp_prefetch_list; pf != NULL; pf = pf->pf_next) {
+		if (pf->pf_spc == arg && a >= pf->pf_addr && len <= pf->pf_len &&
+		    a - pf->pf_addr <= pf->pf_len - len) {
+			memcpy(laddr, pf->pf_data + (a - pf->pf_addr), len);
+			sp_prefetch_hits++;
+			pthread_mutex_unlock(&sp_prefetch_mtx);
+			return 0;
+		}
+	}
+	sp_prefetch_wire++;
+	pthread_mutex_unlock(&sp_prefetch_mtx);
+	return akuma_sp_copyin_wire(arg, raddr, laddr, len);
+}
+
+/*
+ * Multi-client serving (rumpuser_sp_init_mux). Each channel is a separate
+ * sysproxy client in its own spclist slot, so it gets its own rump process and
+ * fd namespace, exactly like a client spserver accepts. The control fd sits at
+ * slot 0 in place of the listener: the kernel writes it the fd number (a
+ * native-endian u32) of each further channel it installs in this process. A
+ * single-channel server (rumpuser_sp_init_fd) has no control fd and serves
+ * slot 1 alone.
+ */
+extern int rumpuser_akuma_wait_fds(struct pollfd *fds, int nfds, int timeout_ms);
+
+static int sp_ctlfd = -1;
+static unsigned sp_maxidx;	/* highest slot ever used */
+static int sp_nchan;		/* live channels */
+static struct pollfd sp_idle_pfd[MAXCLI];
+
+/* Slot `idx`'s region, if it is a live shm channel (pfdlist leaves those out:
+ * their requests arrive in the ring, the fd only rings). */
+static struct sp_shm_chan *
+sp_chan_shm(unsigned idx)
+{
+	if (pfdlist[idx].fd != -1 || spclist[idx].spc_fd == -1)
+		return NULL;
+	return sp_shm_find(spclist[idx].spc_fd);
+}
+
+/* Take channel `fd` on as a new client: map its region if the kernel backs it
+ * with one, send the banner and seed a free slot, as serv_handleconn does. */
+static int
+sp_chan_open(int fd)
+{
+	struct spclient *spc;
+	unsigned idx;
+	int flags;
+
+	for (idx = 1; idx < MAXCLI; idx++)
+		if (pfdlist[idx].fd == -1 && spclist[idx].spc_fd == -1)
+			break;
+	if (idx == MAXCLI) {
+		fprintf(stderr, "rump_sp(fd): no free slot for channel %d\n", fd);
+		close(fd);
+		return -1;
+	}
+	flags = fcntl(fd, F_GETFL, 0);
+	(void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	sp_shm_attach(fd);
+	if (akuma_sp_send(fd, banner, strlen(banner), MSG_NOSIGNAL) !=
+	    (ssize_t)strlen(banner)) {
+		fprintf(stderr, "rump_sp(fd): banner send failed on %d\n", fd);
+		sp_shm_detach(fd);
+		close(fd);
+		return -1;
+	}
+	spc = &spclist[idx];
+	spc->spc_fd = fd;
+	spc->spc_istatus = SPCSTATUS_BUSY; /* dedicated receiver */
+	spc->spc_refcnt = 1;
+	TAILQ_INIT(&spc->spc_respwait);
+	pfdlist[idx].fd = sp_shm_find(fd) != NULL ? -1 : fd;
+	if (idx > sp_maxidx)
+		sp_maxidx = idx;
+	sp_nchan++;
+	return 0;
+}
+
+/* Channel `idx` hung up (or sent garbage): drop its client and its state. */
+static void
+sp_chan_close(unsigned idx)
+{
+	struct spclient *spc = &spclist[idx];
+	int fd = spc->spc_fd;
+
+	serv_handledisco(idx);
+	sp_shm_detach(fd);
+	pthread_mutex_lock(&sp_prefetch_mtx);
+	sp_prefetch_retire(spc, NULL, 0);
+	pthread_mutex_unlock(&sp_prefetch_mtx);
+	sp_nchan--;
+}
+
+/* Open the channels announced on the control fd; -1 once it hung up. */
+static int
+sp_ctl_read(void)
+{
+	uint32_t fds[16];
+	ssize_t n;
+	size_t i;
+
+	n = read(sp_ctlfd, fds, sizeof(fds));
+	if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+		return -1;
+	for (i = 0; n > 0 && i < (size_t)n / sizeof(fds[0]); i++)
+		(void)sp_chan_open((int)fds[i]);
+	return 0;
+}
+
 /*
- * One-client serve loop: poll the single pre-connected fd (seeded at slot 1, no
- * listener at slot 0) and dispatch frames exactly like spserver's client branch.
+ * Nothing to serve: sleep until a channel or the control fd turns readable,
+ * in one wait over all of them. Each shm channel first clears its bell and
+ * re-checks its ring, so a request that landed meanwhile is served instead.
+ */
+static void
+sp_idle(int coop)
+{
+	struct pollfd *pfd = sp_idle_pfd;
+	struct sp_shm_chan *sc;
+	unsigned idx;
+	int n = 0;
+
+	if (sp_ctlfd != -1) {
+		pfd[n].fd = sp_ctlfd;
+		pfd[n++].events = POLLIN;
+	}
+	for (idx = 1; idx <= sp_maxidx; idx++) {
+		if ((sc = sp_chan_shm(idx)) != NULL) {
+			if (sp_shm_quiesce(sc))
+				return;
+		} else if (pfdlist[idx].fd == -1)
+			continue;
+		pfd[n].fd = spclist[idx].spc_fd;
+		pfd[n++].events = POLLIN;
+	}
+	if (coop)
+		(void)rumpuser_akuma_wait_fds(pfd, n, 1000);
+	else
+		(void)poll(pfd, (nfds_t)n, 1000);
+}
+
+/*
+ * Serve loop: poll the pre-connected channel(s) and dispatch frames exactly
+ * like spserver's client branch; slot 0 is the control fd, or inert (fd == -1,
+ * so poll ignores it) for a single-channel server.
  */
 static void *
 spserver_fd(void *arg)
@@ -157,7 +912,8 @@ spserver_fd(void *arg)
 	struct spservarg *sarg = arg;
 	int connfd = sarg->sps_sock;
 	struct spclient *spc;
-	unsigned idx, maxidx;
+	struct sp_shm_chan *sc;
+	unsigned idx;
 	int rv, seen, flags;
 	int coop = rumpuser_akuma_cooperative();
 
@@ -174,66 +930,87 @@ spserver_fd(void *arg)
 	pthread_attr_setdetachstate(&pattr_detached, PTHREAD_CREATE_DETACHED);
 	pthread_mutex_init(&sbamtx, NULL);
 	pthread_cond_init(&sbacv, NULL);
+	pthread_mutex_init(&sp_prefetch_mtx, NULL);
+	sp_pool_start();
 
-	/* seed the connected fd as the single client (slot 1); slot 0 stays inert
-	 * (fd == -1 → poll ignores it, the "new connection" branch never fires). */
-	flags = fcntl(connfd, F_GETFL, 0);
-	(void)fcntl(connfd, F_SETFL, flags | O_NONBLOCK);
-	if (send(connfd, banner, strlen(banner), MSG_NOSIGNAL) != (ssize_t)strlen(banner)) {
-		fprintf(stderr, "rump_sp(fd): banner send failed\n");
-		free(sarg);
+	free(sarg);
+	if (sp_chan_open(connfd) != 0)
 		return NULL;
+	if (sp_ctlfd != -1) {
+		flags = fcntl(sp_ctlfd, F_GETFL, 0);
+		(void)fcntl(sp_ctlfd, F_SETFL, flags | O_NONBLOCK);
+		pfdlist[0].fd = sp_ctlfd;
 	}
-	idx = 1;
-	pfdlist[idx].fd = connfd;
-	spclist[idx].spc_fd = connfd;
-	spclist[idx].spc_istatus = SPCSTATUS_BUSY; /* dedicated receiver */
-	spclist[idx].spc_refcnt = 1;
-	TAILQ_INIT(&spclist[idx].spc_respwait);
-	maxidx = 1;
-
-	free(sarg);
 
-	for (;;) {
+	while (sp_nchan > 0 || sp_ctlfd != -1) {
 		seen = 0;
 		/* fiber backend: poll must NOT block the one OS thread — poll with a
-		 * zero timeout and cooperatively yield when idle so the rest of the rump
-		 * kernel runs. pthread backend: block in poll on this thread as before. */
-		rv = poll(pfdlist, maxidx + 1, coop ? 0 : INFTIM);
+		 * zero timeout and cooperatively wait when idle so the rest of the rump
+		 * kernel runs. pthread backend: block in poll on this thread as before,
+		 * unless shm channels need their rings scanned. */
+		rv = poll(pfdlist, sp_maxidx + 1,
+		    coop || sp_shm_nchan != 0 ? 0 : INFTIM);
 		if (rv == -1) {
 			if (errno == EINTR)
 				continue;
 			fprintf(stderr, "rump_sp(fd): poll errno %d\n", errno);
 			break;
 		}
+		for (idx = 1; idx <= sp_maxidx; idx++) {
+			if ((sc = sp_chan_shm(idx)) != NULL &&
+			    (sp_shm_req_avail(sc->sc_base) != 0 || sc->sc_eof)) {
+				pfdlist[idx].revents = POLLIN;
+				rv++;
+			}
+		}
 		if (rv == 0) {
-			if (coop)
-				/* Block on the channel fd until a request arrives (woken
-				 * immediately by the kernel pipe waker) instead of a blind
-				 * 1ms yield + re-poll; bounded so a missed edge can't wedge
-				 * the one OS thread (next iteration's poll(...,0) re-checks). */
-				rumpuser_akuma_wait_fd(connfd, POLLIN, 1000);
+			/* Block on every channel until a request arrives (woken
+			 * immediately by the kernel pipe waker) instead of a blind
+			 * yield + re-poll; bounded so a missed edge can't wedge the
+			 * one OS thread (the next poll(...,0) re-checks). */
+			sp_idle(coop);
 			continue;
 		}
-		for (idx = 0; seen < rv && idx < MAXCLI; idx++) {
-			if ((pfdlist[idx].revents & POLLIN) == 0)
+		for (idx = 0; seen < rv && idx <= sp_maxidx; idx++) {
+			if ((pfdlist[idx].revents & (POLLIN | POLLHUP)) == 0)
 				continue;
+			pfdlist[idx].revents = 0;
 			seen++;
-			if (idx == 0)
-				continue; /* no listener in fd mode */
+			if (idx == 0) {
+				if (sp_ctl_read() != 0) {
+					close(sp_ctlfd);
+					sp_ctlfd = -1;
+					pfdlist[0].fd = -1;
+				}
+				continue;
+			}
 			spc = &spclist[idx];
+			if ((sc = sp_chan_shm(idx)) != NULL && sc->sc_eof &&
+			    sp_shm_req_avail(sc->sc_base) == 0) {
+				sp_chan_close(idx);
+				continue;
+			}
 			switch (readframe(spc)) {
 			case 0:
 				break;
 			case -1:
-				serv_handledisco(idx);
-				goto out; /* single client gone → done */
+				sp_chan_close(idx);
+				break;
 			default:
 				switch (spc->spc_hdr.rsp_class) {
 				case RUMPSP_RESP:
 					kickwaiter(spc);
 					break;
 				case RUMPSP_REQ:
+					if (spc->spc_hdr.rsp_type ==
+					    RUMPSP_AKUMA_PREFETCH) {
+						sp_prefetch_add(spc,
+						    spc->spc_hdr.rsp_reqno,
+						    spc->spc_buf,
+						    spc->spc_hdr.rsp_len - HDRSZ);
+						spcfreebuf(spc);
+						break;
+					}
 					handlereq(spc);
 					break;
 				default:
@@ -246,30 +1023,39 @@ spserver_fd(void *arg)
 			}
 		}
 	}
-out:
+	fprintf(stderr, "rump_sp(fd): worker pool: %lu requests to a parked worker, "
+	    "%lu needed a new thread\n", sp_pool_hits, sp_pool_misses);
+	fprintf(stderr, "rump_sp(fd): prefetch: %lu copyins served locally, "
+	    "%lu by round trip\n", sp_prefetch_hits, sp_prefetch_wire);
 	return NULL;
 }
 
 /*
  * Serve the sysproxy protocol on `connfd` (a connected stream fd). Mirrors
  * rumpuser_sp_init's banner setup + worker-thread launch, minus the listener.
+ * With `ctlfd` >= 0 the server is multi-client: further channels arrive on it
+ * (see sp_chan_open), and the banner's "+mux" tells the kernel it may route
+ * other boxes' channels here.
  */
 int
-rumpuser_sp_init_fd(int connfd, const char *ostype, const char *osrelease,
-	const char *machine)
+rumpuser_sp_init_mux(int connfd, int ctlfd, const char *ostype,
+	const char *osrelease, const char *machine)
 {
 	pthread_t pt;
 	struct spservarg *sarg;
 	int error;
 
-	snprintf(banner, sizeof(banner), "RUMPSP-%d.%d-%s-%s/%s\n",
-	    PROTOMAJOR, PROTOMINOR, ostype, osrelease, machine);
+	/* "+prefetch": the kernel client only sends PREFETCH frames when it sees it */
+	snprintf(banner, sizeof(banner), "RUMPSP-%d.%d-%s-%s/%s+prefetch%s\n",
+	    PROTOMAJOR, PROTOMINOR, ostype, osrelease, machine,
+	    ctlfd >= 0 ? "+mux" : "");
 
 	sarg = malloc(sizeof(*sarg));
 	if (sarg == NULL)
 		return ENOMEM;
 	sarg->sps_sock = connfd;
 	sarg->sps_connhook = (connecthook_fn)success; /* unix-style: no-op */
+	sp_ctlfd = ctlfd;
 
 	if ((error = pthread_create(&pt, NULL, spserver_fd, sarg)) != 0) {
 		free(sarg);
@@ -278,3 +1064,11 @@ rumpuser_sp_init_fd(int connfd, const char *ostype, const char *osrelease,
 	pthread_detach(pt);
 	return 0;
 }
+
+/* Single-channel server: rumpuser_sp_init_mux without a control fd. */
+int
+rumpuser_sp_init_fd(int connfd, const char *ostype, const char *osrelease,
+	const char *machine)
+{
+	return rumpuser_sp_init_mux(connfd, -1, ostype, osrelease, machine);
+}
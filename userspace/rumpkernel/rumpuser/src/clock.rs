@@ -0,0 +1,143 @@
+//! Syscall-free `clock_gettime` for the clock hypercalls and the schedulers.
+//!
+//! Akuma maps a read-only time page into every process and lets EL0 read
+//! `CNTVCT_EL0` (kernel `akuma_exec::timepage`, docs/TIME_PAGE.md), so
+//! MONOTONIC/REALTIME are one `mrs` plus two divisions instead of an SVC. The
+//! fiber scheduler reads the clock on every pass of its run loop and the rump
+//! hardclock/callout path on every tick, which made `clock_gettime` one of the
+//! hottest syscalls under load.
+//!
+//! The page is found through the `AT_AKUMA_TIMEPAGE` auxv entry. Without it
+//! (older kernel, `TIME_PAGE_ENABLED = false`, Linux host, non-aarch64 test
+//! build) — or for REALTIME before the kernel knows the wall time — this is
+//! plain libc `clock_gettime`. `RUMPUSER_FASTCLOCK=0` forces the libc path,
+//! for A/B runs of `c_stress/clock_bench.c`-style measurements.
+
+use core::ffi::c_int;
+
+use crate::Timespec;
+#[cfg(target_arch = "aarch64")]
+use crate::{CLOCK_MONOTONIC, CLOCK_REALTIME};
+
+extern "C" {
+    fn clock_gettime(clk: c_int, ts: *mut Timespec) -> c_int;
+}
+
+/// Exactly the kernel's `timepage::counter_to_ns`, so a mix of fast and
+/// trapping reads never goes backwards.
+#[cfg_attr(not(target_arch = "aarch64"), allow(dead_code))]
+#[inline]
+const fn counter_to_ns(cnt: u64, freq: u64) -> u64 {
+    (cnt / freq) * 1_000_000_000 + (cnt % freq) * 1_000_000_000 / freq
+}
+
+#[cfg(target_arch = "aarch64")]
+mod fast {
+    use super::counter_to_ns;
+    use core::ffi::c_ulong;
+    use core::sync::atomic::{fence, AtomicUsize, Ordering};
+
+    extern "C" {
+        fn getauxval(t: c_ulong) -> c_ulong;
+    }
+
+    const AT_AKUMA_TIMEPAGE: c_ulong = 0x414B_0001;
+    const TIME_PAGE_MAGIC: u32 = 0x5054_4B41;
+    const TP_REALTIME_VALID: u64 = 1;
+
+    /// Mirror of the kernel's `TimePage`.
+    #[repr(C)]
+    struct TimePage {
+        magic: u32,
+        version: u32,
+        seq: u32,
+        _pad: u32,
+        cntfrq: u64,
+        realtime_off_ns: u64,
+        flags: u64,
+    }
+
+    /// 0 = not probed, 1 = unavailable, else the page VA.
+    static PAGE: AtomicUsize = AtomicUsize::new(0);
+
+    unsafe fn page() -> Option<*const TimePage> {
+        let mut va = PAGE.load(Ordering::Relaxed);
+        if va == 0 {
+            let env = crate::getenv(c"RUMPUSER_FASTCLOCK".as_ptr());
+            let off = !env.is_null() && *env == b'0' as core::ffi::c_char;
+            let aux = getauxval(AT_AKUMA_TIMEPAGE) as usize;
+            va = if !off && aux > 1 && (*(aux as *const TimePage)).magic == TIME_PAGE_MAGIC {
+                aux
+            } else {
+                1
+            };
+            PAGE.store(va, Ordering::Relaxed);
+        }
+        if va == 1 { None } else { Some(va as *const TimePage) }
+    }
+
+    /// ns since boot (or since the epoch when `realtime`), or `None` to fall
+    /// back to the syscall.
+    pub(super) unsafe fn now_ns(realtime: bool) -> Option<u64> {
+        let tp = page()?;
+        loop {
+            let seq = core::ptr::read_volatile(&(*tp).seq);
+            if seq & 1 != 0 {
+                core::hint::spin_loop();
+                continue;
+            }
+            fence(Ordering::Acquire);
+            let freq = core::ptr::read_volatile(&(*tp).cntfrq);
+            let off = core::ptr::read_volatile(&(*tp).realtime_off_ns);
+            let flags = core::ptr::read_volatile(&(*tp).flags);
+            let cnt: u64;
+            // ISB keeps the counter read from being hoisted above the seq load.
+            core::arch::asm!("isb", "mrs {}, cntvct_el0", out(reg) cnt, options(nomem, nostack));
+            fence(Ordering::Acquire);
+            if core::ptr::read_volatile(&(*tp).seq) != seq {
+                continue;
+            }
+            if freq == 0 || (realtime && flags & TP_REALTIME_VALID == 0) {
+                return None;
+            }
+            let ns = counter_to_ns(cnt, freq);
+            return Some(if realtime { off.wrapping_add(ns) } else { ns });
+        }
+    }
+}
+
+/// `clock_gettime(clk, ts)`, served from the time page for MONOTONIC and
+/// REALTIME when possible. Same return convention as libc.
+pub unsafe fn gettime(clk: c_int, ts: *mut Timespec) -> c_int {
+    #[cfg(target_arch = "aarch64")]
+    if clk == CLOCK_MONOTONIC || clk == CLOCK_REALTIME {
+        if let Some(ns) = fast::now_ns(clk == CLOCK_REALTIME) {
+            (*ts).tv_sec = (ns / 1_000_000_000) as i64;
+            (*ts).tv_nsec = (ns % 1_000_000_000) as _;
+            return 0;
+        }
+    }
+    clock_gettime(clk, ts)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn counter_to_ns_matches_reference() {
+        for freq in [24_000_000u64, 62_500_000, 1_000_000_000] {
+            for cnt in [0u64, 1, freq - 1, freq, 3_600 * freq + 7, 1 << 50] {
+                let want = (u128::from(cnt) * 1_000_000_000 / u128::from(freq)) as u64;
+                assert_eq!(counter_to_ns(cnt, freq), want);
+            }
+        }
+    }
+
+    #[test]
+    fn gettime_falls_back_to_libc() {
+        let mut ts = Timespec { tv_sec: 0, tv_nsec: 0 };
+        assert_eq!(unsafe { gettime(crate::CLOCK_MONOTONIC, &mut ts) }, 0);
+        assert!(ts.tv_sec > 0 || ts.tv_nsec > 0);
+    }
+}
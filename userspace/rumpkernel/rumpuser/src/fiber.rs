@@ -25,9 +25,10 @@ use core::ptr;
 extern "C" {
     fn malloc(size: usize) -> *mut c_void;
     fn free(ptr: *mut c_void);
+    fn realloc(ptr: *mut c_void, size: usize) -> *mut c_void;
     fn mmap(addr: *mut c_void, len: usize, prot: c_int, flags: c_int, fd: c_int, off: i64) -> *mut c_void;
     fn munmap(addr: *mut c_void, len: usize) -> c_int;
-    fn clock_gettime(clk: c_int, ts: *mut Timespec) -> c_int;
+    fn mprotect(addr: *mut c_void, len: usize, prot: c_int) -> c_int;
     fn nanosleep(req: *const Timespec, rem: *mut Timespec) -> c_int;
     fn write(fd: c_int, buf: *const c_void, n: usize) -> isize;
     fn abort() -> !;
@@ -40,15 +41,16 @@ extern "C" {
 /// musl `struct pollfd` — `{ int fd; short events; short revents; }`.
 #[repr(C)]
 #[derive(Clone, Copy)]
-struct PollFd {
+pub struct PollFd {
     fd: c_int,
     events: i16,
     revents: i16,
 }
 
-/// Max fds the idle poll watches at once (sysproxy channel + headroom). Cooperative
-/// single-thread, so this is the count of fibers simultaneously blocked on an fd.
-const MAXFDWAIT: usize = 8;
+/// Max distinct fds the idle poll watches at once (sysproxy channels + control
+/// fd + tap + headroom). Any number of fibers may wait on the same fd — they share one slot
+/// (see `FdWait`); a waiter that finds every slot taken falls back to its timeout.
+const MAXFDWAIT: usize = 16;
 
 #[repr(C)]
 struct Timespec {
@@ -58,6 +60,7 @@ struct Timespec {
 
 const CLOCK_REALTIME: c_int = 0;
 const CLOCK_MONOTONIC: c_int = 1;
+const PROT_NONE: c_int = 0x0;
 const PROT_READ: c_int = 0x1;
 const PROT_WRITE: c_int = 0x2;
 const MAP_PRIVATE: c_int = 0x2;
@@ -69,6 +72,13 @@ const EINVAL: c_int = 22;
 const ETIMEDOUT: c_int = 110; // Linux/musl; rump only checks nonzero
 
 const STACKSIZE: usize = 65536;
+/// PROT_NONE page below each fiber stack, so an overflow faults instead of
+/// silently scribbling over the neighbouring mapping.
+const GUARDSIZE: usize = 4096;
+/// Reaped fibers kept (Thread + mapped, already-faulted stack) for reuse, and
+/// how many are pre-built at init. Bounds idle memory at POOL_MAX * 68 KiB.
+const POOL_MAX: usize = 32;
+const POOL_PREFILL: usize = 4;
 
 // rump mutex / rwlock / lwp-op flags (must match rump's rumpuser.h)
 const RUMPUSER_MTX_SPIN: c_int = 0x01;
@@ -168,10 +178,11 @@ unsafe extern "C" fn akfiber_start(
 }
 
 /// Seed a fresh context so the first switch into it lands on the trampoline,
-/// which calls `entry(arg)` on `stack_base`'s fiber stack.
+/// which calls `entry(arg)` on the fiber stack mapped at `stack_base` (above its
+/// guard page).
 unsafe fn akctx_make(c: *mut AkCtx, stack_base: *mut c_void, entry: usize, arg: *mut c_void) {
     (*c).reg = [0; 22];
-    let top = ((stack_base as usize) + STACKSIZE) & !15usize;
+    let top = ((stack_base as usize) + GUARDSIZE + STACKSIZE) & !15usize;
     (*c).reg[0] = entry as u64; // x19
     (*c).reg[1] = arg as u64; // x20
     (*c).reg[11] = akfiber_tramp as *const () as usize as u64; // x30 -> trampoline
@@ -257,7 +268,7 @@ struct Thread {
     wakeup_time: i64, // -1 = not sleeping
     ctx: AkCtx,
     flags: c_int,
-    stack: *mut c_void, // mmap base to munmap on reap (null for the init thread)
+    stack: *mut c_void, // mmap base incl. guard page (null for the init thread)
     // Event-driven fd wait (rumpuser_akuma_wait_fd): when a fiber blocks on an fd
     // (e.g. the sysproxy receiver on the channel pipe), schedule()'s idle path
     // poll()s these so a peer write wakes the OS thread IMMEDIATELY via the kernel
@@ -265,6 +276,11 @@ struct Thread {
     wait_fd: c_int,
     wait_events: i16,  // POLL* bits we're waiting for
     wait_revents: i16, // POLL* bits the idle poll observed ready (consumed on wake)
+    // Scheduler bookkeeping (see RUNQ / TIMERS / FDWAIT): run-queue node, slot in
+    // the timer heap (NOT_IN_HEAP if no timer armed), and fd-waiter node.
+    runq: Waiter,
+    heap_idx: usize,
+    fdq: Waiter,
 }
 impl Linked for Thread {
     unsafe fn link(this: *mut Self) -> *mut Link<Self> {
@@ -276,6 +292,7 @@ struct Waiter {
     link: Link<Waiter>,
     who: *mut Thread,
     onlist: c_int,
+    events: i16, // POLL* interest while on an FDWAIT slot
 }
 impl Linked for Waiter {
     unsafe fn link(this: *mut Self) -> *mut Link<Self> {
@@ -294,8 +311,26 @@ impl Linked for JoinWaiter {
     }
 }
 
+/// One watched fd for the idle poll: the union of its waiters' POLL* interest and
+/// the fibers blocked on it (their `fdq` nodes, or the per-fd nodes of a
+/// `rumpuser_akuma_wait_fds`). `fd == -1` ⇒ slot free.
+struct FdWait {
+    fd: c_int,
+    events: i16,
+    waiters: List<Waiter>,
+}
+impl FdWait {
+    const FREE: FdWait = FdWait { fd: -1, events: 0, waiters: List::new() };
+}
+
 // ── scheduler globals (single OS thread → no locking) ─────────────────────────
+// THREAD_LIST is membership only (reaping/debug); schedule() never walks it. The
+// switch path touches RUNQ (FIFO of runnable threads other than CURRENT) and the
+// top of TIMERS, so it is O(1) regardless of how many fibers exist.
 static mut THREAD_LIST: List<Thread> = List::new();
+static mut RUNQ: List<Waiter> = List::new();
+static mut TIMERS: TimerHeap = TimerHeap::new();
+static mut FDWAIT: [FdWait; MAXFDWAIT] = [FdWait::FREE; MAXFDWAIT];
 static mut EXITED: List<Thread> = List::new();
 static mut JOINWQ: List<JoinWaiter> = List::new();
 static mut CURRENT: *mut Thread = ptr::null_mut();
@@ -309,7 +344,8 @@ unsafe fn get_current() -> *mut Thread {
 #[inline]
 unsafe fn now() -> i64 {
     let mut ts = Timespec { tv_sec: 0, tv_nsec: 0 };
-    clock_gettime(CLOCK_MONOTONIC, &mut ts);
+    // Every scheduler pass reads this: time page, no syscall (clock.rs).
+    crate::clock::gettime(CLOCK_MONOTONIC, (&raw mut ts).cast());
     ts.tv_sec * 1000 + ts.tv_nsec / 1_000_000
 }
 
@@ -317,24 +353,154 @@ unsafe fn now() -> i64 {
 unsafe fn is_runnable(t: *mut Thread) -> bool {
     (*t).flags & RUNNABLE_FLAG != 0
 }
+/// Append `t` to the run queue unless it is already queued. CURRENT is never on
+/// RUNQ while it runs; schedule() requeues it at the tail if it stays runnable.
+#[inline]
+unsafe fn enqueue(t: *mut Thread) {
+    if (*t).runq.onlist == 0 {
+        RUNQ.insert_tail(&mut (*t).runq);
+        (*t).runq.onlist = 1;
+    }
+}
 #[inline]
 unsafe fn set_runnable(t: *mut Thread) {
     (*t).flags |= RUNNABLE_FLAG;
+    if t != CURRENT {
+        enqueue(t);
+    }
 }
 #[inline]
 unsafe fn clear_runnable(t: *mut Thread) {
     (*t).flags &= !RUNNABLE_FLAG;
+    if (*t).runq.onlist != 0 {
+        RUNQ.remove(&mut (*t).runq);
+        (*t).runq.onlist = 0;
+    }
 }
 
 unsafe fn wake(t: *mut Thread) {
+    TIMERS.cancel(t);
     (*t).wakeup_time = -1;
     set_runnable(t);
 }
 unsafe fn block(t: *mut Thread) {
+    TIMERS.cancel(t);
     (*t).wakeup_time = -1;
     clear_runnable(t);
 }
 
+/// Arm `t`'s sleep timer for absolute monotonic millis `when` (replaces any
+/// earlier deadline). Fired by schedule() with THREAD_TIMEDOUT set.
+unsafe fn set_wakeup(t: *mut Thread, when: i64) {
+    (*t).wakeup_time = when;
+    TIMERS.arm(t);
+}
+
+// ── timer min-heap ────────────────────────────────────────────────────────────
+const NOT_IN_HEAP: usize = usize::MAX;
+
+/// Binary min-heap of sleeping threads keyed on `wakeup_time`; each thread
+/// records its slot in `heap_idx` so cancel/re-arm is O(log n) without a search.
+/// Storage is malloc'd and grows by doubling (never shrinks — it is bounded by the
+/// peak fiber count).
+struct TimerHeap {
+    buf: *mut *mut Thread,
+    len: usize,
+    cap: usize,
+}
+impl TimerHeap {
+    const fn new() -> Self {
+        TimerHeap { buf: ptr::null_mut(), len: 0, cap: 0 }
+    }
+    #[inline]
+    unsafe fn at(&self, i: usize) -> *mut Thread {
+        *self.buf.add(i)
+    }
+    #[inline]
+    unsafe fn key(&self, i: usize) -> i64 {
+        (*self.at(i)).wakeup_time
+    }
+    #[inline]
+    unsafe fn place(&mut self, i: usize, t: *mut Thread) {
+        *self.buf.add(i) = t;
+        (*t).heap_idx = i;
+    }
+    unsafe fn sift_up(&mut self, mut i: usize) {
+        let t = self.at(i);
+        while i > 0 {
+            let parent = (i - 1) / 2;
+            if self.key(parent) <= (*t).wakeup_time {
+                break;
+            }
+            self.place(i, self.at(parent));
+            i = parent;
+        }
+        self.place(i, t);
+    }
+    unsafe fn sift_down(&mut self, mut i: usize) {
+        let t = self.at(i);
+        loop {
+            let l = 2 * i + 1;
+            if l >= self.len {
+                break;
+            }
+            let r = l + 1;
+            let c = if r < self.len && self.key(r) < self.key(l) { r } else { l };
+            if self.key(c) >= (*t).wakeup_time {
+                break;
+            }
+            self.place(i, self.at(c));
+            i = c;
+        }
+        self.place(i, t);
+    }
+    /// Insert `t`, or restore heap order if it is already in (deadline changed).
+    unsafe fn arm(&mut self, t: *mut Thread) {
+        let i = (*t).heap_idx;
+        if i != NOT_IN_HEAP {
+            self.sift_up(i);
+            self.sift_down((*t).heap_idx);
+            return;
+        }
+        if self.len == self.cap {
+            let cap = if self.cap == 0 { 32 } else { self.cap * 2 };
+            let nb = realloc(self.buf as *mut c_void, cap * core::mem::size_of::<*mut Thread>());
+            if nb.is_null() {
+                dprint(b"fiber: timer heap allocation failed\n");
+                abort();
+            }
+            self.buf = nb as *mut *mut Thread;
+            self.cap = cap;
+        }
+        self.len += 1;
+        self.place(self.len - 1, t);
+        self.sift_up(self.len - 1);
+    }
+    unsafe fn cancel(&mut self, t: *mut Thread) {
+        let i = (*t).heap_idx;
+        if i == NOT_IN_HEAP {
+            return;
+        }
+        (*t).heap_idx = NOT_IN_HEAP;
+        self.len -= 1;
+        if i != self.len {
+            // Move the last element into the hole, then restore order in
+            // whichever direction it violates.
+            self.place(i, self.at(self.len));
+            if i > 0 && self.key(i) < self.key((i - 1) / 2) {
+                self.sift_up(i);
+            } else {
+                self.sift_down(i);
+            }
+        }
+    }
+    /// Earliest-deadline sleeper, or null.
+    #[inline]
+    unsafe fn peek(&self) -> *mut Thread {
+        if self.len == 0 { ptr::null_mut() } else { self.at(0) }
+    }
+}
+
 unsafe fn switch_threads(prev: *mut Thread, next: *mut Thread) {
     CURRENT = next;
     if let Some(hook) = SCHED_HOOK {
@@ -344,95 +510,90 @@ unsafe fn switch_threads(prev: *mut Thread, next: *mut Thread) {
     akfiber_switch(&mut (*prev).ctx, &mut (*next).ctx);
 }
 
-/// Cooperative round-robin scheduler. Picks the next runnable thread, waking any
-/// whose sleep timer expired; if none is runnable, sleeps the OS thread until the
-/// next wakeup. Then reaps exited threads. Port of rumpfiber.c:schedule().
-unsafe fn schedule() {
-    let prev = get_current();
-    let mut next: *mut Thread;
-
+/// Wake every sleeper whose deadline is at or before `tm`, marking it timed out.
+unsafe fn fire_timers(tm: i64) {
     loop {
-        let tm = now();
-        let mut wakeup = tm + 1000; // wake up in 1s max
-        next = ptr::null_mut();
-
-        // Walk all threads (capturing next link first — wake() may relink).
-        let mut t = THREAD_LIST.first();
-        while !t.is_null() {
-            let tnext = (*Thread::link(t)).next;
-            if !is_runnable(t) && (*t).wakeup_time >= 0 {
-                if (*t).wakeup_time <= tm {
-                    (*t).flags |= THREAD_TIMEDOUT;
-                    wake(t);
-                } else if (*t).wakeup_time < wakeup {
-                    wakeup = (*t).wakeup_time;
-                }
-            }
-            if is_runnable(t) {
-                next = t;
-                // move to tail (round-robin)
-                THREAD_LIST.remove(t);
-                THREAD_LIST.insert_tail(t);
-                break;
-            }
-            t = tnext;
-        }
-
-        if !next.is_null() {
+        let t = TIMERS.peek();
+        if t.is_null() || (*t).wakeup_time > tm {
             break;
         }
+        (*t).flags |= THREAD_TIMEDOUT;
+        wake(t); // cancels the timer: pops the heap top
+    }
+}
 
-        // Nothing runnable: park the OS thread until the soonest wakeup. If any
-        // fiber is blocked on an fd (rumpuser_akuma_wait_fd), poll() those fds with
-        // that same timeout — on Akuma a peer write registers a waker and returns
-        // poll() immediately, so the sysproxy channel becomes event-driven (no
-        // busy re-poll, no fixed latency floor). Otherwise plain nanosleep.
-        let delta = wakeup - tm; // ms, always >= 1 (wakeup > tm here)
-
-        // Collect fds from fibers blocked on one (single OS thread → no locking).
-        let mut pfds = [PollFd { fd: -1, events: 0, revents: 0 }; MAXFDWAIT];
-        let mut nfds = 0usize;
-        let mut t = THREAD_LIST.first();
-        while !t.is_null() && nfds < MAXFDWAIT {
-            if !is_runnable(t) && (*t).wait_fd >= 0 {
-                pfds[nfds] = PollFd { fd: (*t).wait_fd, events: (*t).wait_events, revents: 0 };
-                nfds += 1;
-            }
-            t = (*Thread::link(t)).next;
+/// Nothing runnable: park the OS thread until the soonest timer (1s max). If any
+/// fiber is blocked on an fd (rumpuser_akuma_wait_fd), poll() the FDWAIT slots with
+/// that same timeout — on Akuma a peer write registers a waker and returns poll()
+/// immediately, so the sysproxy channel becomes event-driven (no busy re-poll, no
+/// fixed latency floor). Otherwise plain nanosleep.
+unsafe fn idle(tm: i64) {
+    let mut wakeup = tm + 1000; // wake up in 1s max
+    let t = TIMERS.peek();
+    if !t.is_null() && (*t).wakeup_time < wakeup {
+        wakeup = (*t).wakeup_time;
+    }
+    let delta = wakeup - tm; // ms, always >= 1 (expired timers already fired)
+
+    let mut pfds = [PollFd { fd: -1, events: 0, revents: 0 }; MAXFDWAIT];
+    let mut slot = [0usize; MAXFDWAIT];
+    let mut nfds = 0usize;
+    for (i, fw) in (*ptr::addr_of_mut!(FDWAIT)).iter().enumerate() {
+        if fw.fd >= 0 {
+            pfds[nfds] = PollFd { fd: fw.fd, events: fw.events, revents: 0 };
+            slot[nfds] = i;
+            nfds += 1;
         }
+    }
 
-        if nfds > 0 {
-            let rv = poll(pfds.as_mut_ptr(), nfds, delta as c_int);
-            if rv > 0 {
-                // Wake every fd-waiter whose fd reported readiness; stamp revents so
-                // the woken hypercall can return them. Timed-out waiters are handled
-                // by the wakeup_time scan on the next loop iteration.
-                for pfd in pfds.iter().take(nfds) {
-                    if pfd.revents == 0 {
-                        continue;
-                    }
-                    let mut w = THREAD_LIST.first();
-                    while !w.is_null() {
-                        let wnext = (*Thread::link(w)).next;
-                        if !is_runnable(w) && (*w).wait_fd == pfd.fd {
-                            (*w).wait_revents = pfd.revents;
-                            wake(w);
-                        }
-                        w = wnext;
-                    }
+    if nfds > 0 {
+        let rv = poll(pfds.as_mut_ptr(), nfds, delta as c_int);
+        if rv > 0 {
+            // Wake every waiter on each ready fd; stamp revents so the woken
+            // hypercall can return them. Timed-out waiters are fired by TIMERS on
+            // the next loop iteration.
+            for (pfd, &i) in pfds.iter().zip(slot.iter()).take(nfds) {
+                if pfd.revents != 0 {
+                    fdwait_ready(i, pfd.revents);
                 }
             }
-            // rv == 0 (timeout) or rv < 0 (EINTR/err): fall through; the next loop
-            // iteration re-scans (timer wakeups) and re-polls as needed.
-        } else {
-            let sl = Timespec {
-                tv_sec: delta / 1000,
-                tv_nsec: (delta % 1000) * 1_000_000,
-            };
-            nanosleep(&sl, ptr::null_mut());
         }
+        // rv == 0 (timeout) or rv < 0 (EINTR/err): fall through; the next loop
+        // iteration fires timers and re-polls as needed.
+    } else {
+        let sl = Timespec {
+            tv_sec: delta / 1000,
+            tv_nsec: (delta % 1000) * 1_000_000,
+        };
+        nanosleep(&sl, ptr::null_mut());
+    }
+}
+
+/// Cooperative round-robin scheduler. Requeues `prev` if it is still runnable,
+/// fires expired sleep timers, and switches to the head of the run queue; if none
+/// is runnable, sleeps the OS thread until the next timer or fd readiness. Then
+/// reaps exited threads. Port of rumpfiber.c:schedule(), with its per-switch
+/// THREAD_LIST walk replaced by RUNQ (FIFO), TIMERS (min-heap) and FDWAIT.
+unsafe fn schedule() {
+    let prev = get_current();
+    if is_runnable(prev) {
+        enqueue(prev);
     }
 
+    let next = loop {
+        let tm = now();
+        fire_timers(tm);
+
+        let w = RUNQ.first();
+        if !w.is_null() {
+            RUNQ.remove(w);
+            (*w).onlist = 0;
+            break (*w).who;
+        }
+
+        idle(tm);
+    };
+
     if prev != next {
         switch_threads(prev, next);
     }
@@ -443,26 +604,107 @@ unsafe fn schedule() {
         let tnext = (*Thread::link(t)).next;
         if t != prev {
             EXITED.remove(t);
-            if !(*t).stack.is_null() {
-                munmap((*t).stack, STACKSIZE);
-            }
-            free(t as *mut c_void);
+            release_thread(t);
         }
         t = tnext;
     }
 }
 
-// ── thread lifecycle ──────────────────────────────────────────────────────────
-unsafe fn create_thread(entry: usize, arg: *mut c_void) -> *mut Thread {
+// ── Thread + stack pool ───────────────────────────────────────────────────────
+// Sysproxy spawns a worker fiber per request, so without recycling every proxied
+// syscall paid a malloc + 68 KiB mmap/mprotect + first-touch faults on create and
+// a munmap + free on reap. Reaped fibers go onto POOL (LIFO, so the most recently
+// used — cache- and TLB-warm — stack is handed out next) up to POOL_MAX; beyond
+// that they are released as before. A pooled Thread keeps only `stack`; everything
+// else is re-initialised by init_thread().
+static mut POOL: List<Thread> = List::new();
+static mut POOL_LEN: usize = 0;
+static mut STATS: FiberStats = FiberStats {
+    fresh: 0,
+    reused: 0,
+    pooled: 0,
+    unmapped: 0,
+    pool_len: 0,
+    pool_hiwat: 0,
+    pool_max: POOL_MAX,
+};
+
+/// Pool counters, filled by `rumpuser_akuma_fiber_stats` (layout shared with the
+/// C `struct akfiber_stats` in rumpcomp_tap.c).
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct FiberStats {
+    fresh: usize,    // Thread+stack built from scratch (incl. prefill)
+    reused: usize,   // create_thread served from the pool
+    pooled: usize,   // reaped fibers parked in the pool
+    unmapped: usize, // reaped fibers released (pool full)
+    pool_len: usize,
+    pool_hiwat: usize,
+    pool_max: usize,
+}
+
+/// Build a Thread with a guarded, pre-faulted stack. Null on OOM.
+unsafe fn fresh_thread() -> *mut Thread {
     let thr = malloc(core::mem::size_of::<Thread>()) as *mut Thread;
     if thr.is_null() {
         return ptr::null_mut();
     }
-    let stack = mmap(ptr::null_mut(), STACKSIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    let map = GUARDSIZE + STACKSIZE;
+    let stack = mmap(ptr::null_mut(), map, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
     if stack == MAP_FAILED {
         free(thr as *mut c_void);
         return ptr::null_mut();
     }
+    // Best-effort: without the guard the fiber still runs, just unprotected.
+    mprotect(stack, GUARDSIZE, PROT_NONE);
+    // Fault the stack in now rather than page-by-page on the fiber's first run.
+    let mut off = GUARDSIZE;
+    while off < map {
+        ptr::write_volatile((stack as *mut u8).add(off), 0);
+        off += GUARDSIZE;
+    }
+    (*thr).stack = stack;
+    STATS.fresh += 1;
+    thr
+}
+
+unsafe fn pool_put(t: *mut Thread) {
+    POOL.insert_head(t);
+    POOL_LEN += 1;
+    if POOL_LEN > STATS.pool_hiwat {
+        STATS.pool_hiwat = POOL_LEN;
+    }
+}
+
+/// A Thread with a usable stack: pooled if available, else freshly built.
+unsafe fn alloc_thread() -> *mut Thread {
+    let t = POOL.first();
+    if t.is_null() {
+        return fresh_thread();
+    }
+    POOL.remove(t);
+    POOL_LEN -= 1;
+    STATS.reused += 1;
+    t
+}
+
+/// Reap path: park `t` in the pool, or release it if the pool is full (or it is
+/// the init thread, whose stack isn't ours).
+unsafe fn release_thread(t: *mut Thread) {
+    if !(*t).stack.is_null() && POOL_LEN < POOL_MAX {
+        pool_put(t);
+        STATS.pooled += 1;
+        return;
+    }
+    if !(*t).stack.is_null() {
+        munmap((*t).stack, GUARDSIZE + STACKSIZE);
+        STATS.unmapped += 1;
+    }
+    free(t as *mut c_void);
+}
+
+// ── thread lifecycle ──────────────────────────────────────────────────────────
+unsafe fn init_thread(thr: *mut Thread, stack: *mut c_void) {
     ptr::write(
         thr,
         Thread {
@@ -475,8 +717,20 @@ unsafe fn create_thread(entry: usize, arg: *mut c_void) -> *mut Thread {
             wait_fd: -1,
             wait_events: 0,
             wait_revents: 0,
+            runq: Waiter { link: Link::null(), who: thr, onlist: 0, events: 0 },
+            heap_idx: NOT_IN_HEAP,
+            fdq: Waiter { link: Link::null(), who: thr, onlist: 0, events: 0 },
         },
     );
+}
+
+unsafe fn create_thread(entry: usize, arg: *mut c_void) -> *mut Thread {
+    let thr = alloc_thread();
+    if thr.is_null() {
+        return ptr::null_mut();
+    }
+    let stack = (*thr).stack;
+    init_thread(thr, stack);
     akctx_make(&mut (*thr).ctx, stack, entry, arg);
     set_runnable(thr);
     THREAD_LIST.insert_tail(thr);
@@ -535,14 +789,14 @@ unsafe fn join_thread(joinable: *mut Thread) {
 
 unsafe fn msleep(millis: i64) {
     let thread = get_current();
-    (*thread).wakeup_time = now() + millis;
+    set_wakeup(thread, now() + millis);
     clear_runnable(thread);
     schedule();
 }
 
 unsafe fn abssleep(millis: i64) {
     let thread = get_current();
-    (*thread).wakeup_time = millis;
+    set_wakeup(thread, millis);
     clear_runnable(thread);
     schedule();
 }
@@ -553,23 +807,19 @@ pub unsafe fn init_sched() {
     if thr.is_null() {
         abort();
     }
-    ptr::write(
-        thr,
-        Thread {
-            link: Link::null(),
-            lwp: ptr::null_mut(),
-            wakeup_time: -1,
-            ctx: AkCtx::zero(),
-            flags: 0,
-            stack: ptr::null_mut(), // main thread's stack: not ours to munmap
-            wait_fd: -1,
-            wait_events: 0,
-            wait_revents: 0,
-        },
-    );
+    init_thread(thr, ptr::null_mut()); // main thread's stack: not ours to munmap
+    CURRENT = thr; // before set_runnable: the running thread is never on RUNQ
     set_runnable(thr);
     THREAD_LIST.insert_tail(thr);
-    CURRENT = thr;
+
+    // Warm the pool so the first kthreads / sysproxy workers skip the mmap.
+    for _ in 0..POOL_PREFILL {
+        let t = fresh_thread();
+        if t.is_null() {
+            break;
+        }
+        pool_put(t);
+    }
 }
 
 // ── wait queues ───────────────────────────────────────────────────────────────
@@ -581,12 +831,13 @@ unsafe fn wait(wh: *mut List<Waiter>, msec: i64) -> c_int {
         link: Link::null(),
         who: cur,
         onlist: 1,
+        events: 0,
     };
     let wp: *mut Waiter = &mut w;
     (*wh).insert_tail(wp);
     block(cur);
     if msec != 0 {
-        (*cur).wakeup_time = now() + msec;
+        set_wakeup(cur, now() + msec);
     }
     schedule();
 
@@ -634,6 +885,71 @@ unsafe fn dprint(msg: &[u8]) {
     write(2, msg.as_ptr() as *const c_void, msg.len());
 }
 
+/// Put waiter node `w` (for `fd`, interest `events`) on that fd's FDWAIT slot,
+/// claiming a free slot for a new fd. No slot free ⇒ `w` stays off the map and
+/// its wait degrades to the bounded timeout, as the old fixed-size poll array did.
+unsafe fn fdwait_join(fd: c_int, events: i16, w: *mut Waiter) {
+    let fds = &mut *ptr::addr_of_mut!(FDWAIT);
+    let i = match fds.iter().position(|fw| fw.fd == fd) {
+        Some(i) => i,
+        None => match fds.iter().position(|fw| fw.fd < 0) {
+            Some(i) => {
+                fds[i].fd = fd;
+                i
+            }
+            None => return,
+        },
+    };
+    (*w).events = events;
+    fds[i].events |= events;
+    fds[i].waiters.insert_tail(w);
+    (*w).onlist = 1;
+}
+
+/// Take `w` off `fd`'s FDWAIT slot if it is still there (woken by timeout or by
+/// another fd), keeping the slot's interest mask to the remaining waiters and
+/// freeing it when empty.
+unsafe fn fdwait_leave(fd: c_int, w: *mut Waiter) {
+    if (*w).onlist == 0 {
+        return;
+    }
+    let fds = &mut *ptr::addr_of_mut!(FDWAIT);
+    let fw = match fds.iter_mut().find(|fw| fw.fd == fd) {
+        Some(fw) => fw,
+        None => return,
+    };
+    fw.waiters.remove(w);
+    (*w).onlist = 0;
+    fw.events = 0;
+    let mut o = fw.waiters.first();
+    while !o.is_null() {
+        fw.events |= (*o).events;
+        o = (*Waiter::link(o)).next;
+    }
+    if fw.waiters.is_empty() {
+        fw.fd = -1;
+    }
+}
+
+/// The idle poll saw `revents` on slot `i`: wake all its waiters and free it.
+/// A fiber waiting on several fds is woken once (`wake` is idempotent); its
+/// nodes on the other slots come off in `fdwait_leave`.
+unsafe fn fdwait_ready(i: usize, revents: i16) {
+    let fw = &mut (*ptr::addr_of_mut!(FDWAIT))[i];
+    loop {
+        let w = fw.waiters.first();
+        if w.is_null() {
+            break;
+        }
+        fw.waiters.remove(w);
+        (*w).onlist = 0;
+        (*(*w).who).wait_revents = revents;
+        wake((*w).who);
+    }
+    fw.fd = -1;
+    fw.events = 0;
+}
+
 /// Cooperative short yield for a backend poll loop (e.g. rumpcomp_tap.c's RX on
 /// EAGAIN): park this fiber ~1ms and let every other fiber run. This is what lets
 /// a non-blocking tap read coexist with the rest of the rump kernel on one OS
@@ -642,7 +958,7 @@ unsafe fn dprint(msg: &[u8]) {
 #[no_mangle]
 pub unsafe extern "C" fn rumpuser_akuma_yield() {
     let cur = get_current();
-    (*cur).wakeup_time = now() + 1; // 1ms
+    set_wakeup(cur, now() + 1); // 1ms
     clear_runnable(cur);
     schedule();
 }
@@ -664,10 +980,12 @@ pub unsafe extern "C" fn rumpuser_akuma_wait_fd(fd: c_int, events: c_int, timeou
     // Always bound the wait so a missed/asymmetric readiness edge can't wedge the
     // one OS thread; the receiver re-polls (timeout 0) on wake regardless.
     let to = if timeout_ms > 0 { timeout_ms as i64 } else { 1000 };
-    (*cur).wakeup_time = now() + to;
+    fdwait_join(fd, events as i16, &mut (*cur).fdq);
+    set_wakeup(cur, now() + to);
     clear_runnable(cur);
     schedule();
     // Cleared on return; report what the idle poll saw (0 ⇒ woke by timeout).
+    fdwait_leave(fd, &mut (*cur).fdq);
     (*cur).wait_fd = -1;
     (*cur).wait_events = 0;
     let rev = (*cur).wait_revents;
@@ -675,6 +993,50 @@ pub unsafe extern "C" fn rumpuser_akuma_wait_fd(fd: c_int, events: c_int, timeou
     rev as c_int
 }
 
+/// `rumpuser_akuma_wait_fd` over several fds at once (the multi-client sysproxy
+/// server: every channel plus its control fd): block this fiber until any of
+/// `fds[..nfds]` is ready for its `events` OR `timeout_ms` elapses. Each fd gets
+/// its own waiter node on this fiber's stack, so the fiber sits on several FDWAIT
+/// slots and the first ready one wakes it. On return every `revents` is filled by
+/// a zero-timeout poll, and the result is the number of ready fds, like poll()
+/// (0 on timeout). At most MAXFDWAIT fds are watched; the rest are only
+/// reported if ready when the wait ends.
+#[no_mangle]
+pub unsafe extern "C" fn rumpuser_akuma_wait_fds(fds: *mut PollFd, nfds: c_int, timeout_ms: c_int) -> c_int {
+    let cur = get_current();
+    let n = nfds.max(0) as usize;
+    let mut nodes: [Waiter; MAXFDWAIT] =
+        core::array::from_fn(|_| Waiter { link: Link::null(), who: cur, onlist: 0, events: 0 });
+    let watched = n.min(MAXFDWAIT);
+    for i in 0..watched {
+        let pfd = &*fds.add(i);
+        if pfd.fd >= 0 {
+            fdwait_join(pfd.fd, pfd.events, &mut nodes[i]);
+        }
+    }
+    let to = if timeout_ms > 0 { timeout_ms as i64 } else { 1000 };
+    set_wakeup(cur, now() + to);
+    clear_runnable(cur);
+    schedule();
+    for i in 0..watched {
+        fdwait_leave((*fds.add(i)).fd, &mut nodes[i]);
+    }
+    (*cur).wait_revents = 0;
+    poll(fds, n, 0)
+}
+
+/// Copy the fiber Thread/stack pool counters into `out` (a C `struct
+/// akfiber_stats`). Returns 0; the pthread backend's stub returns -1.
+#[no_mangle]
+pub unsafe extern "C" fn rumpuser_akuma_fiber_stats(out: *mut FiberStats) -> c_int {
+    if out.is_null() {
+        return EINVAL;
+    }
+    STATS.pool_len = POOL_LEN;
+    *out = STATS;
+    0
+}
+
 // ══════════════════════════════════════════════════════════════════════════════
 // rumpuser_* hypercall exports (fiber backend)
 // ══════════════════════════════════════════════════════════════════════════════
@@ -59,14 +59,14 @@ macro_rules! tr {
 
 extern "C" {
     // malloc: only the pthread backend's lock/cv allocs use it (the fiber backend
-    // declares its own); rumpuser_malloc itself uses posix_memalign.
+    // declares its own); rumpuser_malloc goes through the pool (pool.rs), which
+    // falls back to posix_memalign/free.
     #[cfg(not(feature = "threads_fiber"))]
     fn malloc(size: usize) -> *mut c_void;
     fn free(ptr: *mut c_void);
     fn posix_memalign(memptr: *mut *mut c_void, align: usize, size: usize) -> c_int;
     fn mmap(addr: *mut c_void, len: usize, prot: c_int, flags: c_int, fd: c_int, off: i64) -> *mut c_void;
     fn munmap(addr: *mut c_void, len: usize) -> c_int;
-    fn clock_gettime(clk: c_int, ts: *mut Timespec) -> c_int;
     // nanosleep: only the pthread clock_sleep uses it (fiber yields cooperatively).
     #[cfg(not(feature = "threads_fiber"))]
     fn nanosleep(req: *const Timespec, rem: *mut Timespec) -> c_int;
@@ -217,6 +217,12 @@ mod fiber;
 #[cfg(feature = "rump_server_main")]
 mod rump_server;
 
+/// Size-classed pool behind `rumpuser_malloc`/`rumpuser_free`.
+mod pool;
+
+/// `clock_gettime` served from Akuma's time page (no syscall) when available.
+mod clock;
+
 /// pthread TLS key holding the current lwp pointer (per host thread).
 #[cfg(not(feature = "threads_fiber"))]
 static mut CURLWP_KEY: PthreadKey = 0;
@@ -255,7 +261,7 @@ pub unsafe extern "C" fn rumpuser_malloc(len: usize, alignment: c_int, memp: *mu
     // posix_memalign requires alignment to be a power of two and >= sizeof(void*).
     let align = align.max(core::mem::size_of::<usize>()).next_power_of_two();
     let mut ptr: *mut c_void = ptr::null_mut();
-    let rv = posix_memalign(&mut ptr, align, len);
+    let rv = pool::malloc(len, align, &mut ptr);
     if rv != 0 {
         return rv;
     }
@@ -266,16 +272,16 @@ pub unsafe extern "C" fn rumpuser_malloc(len: usize, alignment: c_int, memp: *mu
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn rumpuser_free(ptr: *mut c_void, _size: usize) {
+pub unsafe extern "C" fn rumpuser_free(ptr: *mut c_void, size: usize) {
     tr!(b"free");
-    free(ptr);
+    pool::free_sized(ptr, size);
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn rumpuser_anonmmap(
     _prefaddr: *mut c_void,
     size: usize,
-    _alignbit: c_int,
+    alignbit: c_int,
     exec: c_int,
     memp: *mut *mut c_void,
 ) -> c_int {
@@ -284,10 +290,24 @@ pub unsafe extern "C" fn rumpuser_anonmmap(
     if exec != 0 {
         prot |= PROT_EXEC;
     }
-    let p = mmap(ptr::null_mut(), size, prot, MAP_PRIVATE | MAP_ANON, -1, 0);
+    // mmap only promises page alignment: for a larger `alignbit` map the slack
+    // too and unmap what lies outside the aligned window.
+    let align = if alignbit > 12 && alignbit < 48 { 1usize << alignbit } else { 0 };
+    let p = mmap(ptr::null_mut(), size + align, prot, MAP_PRIVATE | MAP_ANON, -1, 0);
     if p == MAP_FAILED {
         return *__errno_location();
     }
+    let mut p = p;
+    if align != 0 {
+        let start = p as usize;
+        let base = (start + align - 1) & !(align - 1);
+        let end = (base + size + 4095) & !4095;
+        if base > start {
+            munmap(p, base - start);
+        }
+        munmap(end as *mut c_void, start + size + align - end);
+        p = base as *mut c_void;
+    }
     *memp = p;
     #[cfg(feature = "rumpuser_debug")]
     dbg3(b"  anonmmap size/exec/ptr ", size, exec as usize, p as usize);
@@ -309,7 +329,7 @@ pub unsafe extern "C" fn rumpuser_clock_gettime(enum_: c_int, sec: *mut i64, nse
     tr!(b"clock_gettime");
     let clk = if enum_ == RUMPUSER_CLOCK_ABSMONO { CLOCK_MONOTONIC } else { CLOCK_REALTIME };
     let mut ts = Timespec { tv_sec: 0, tv_nsec: 0 };
-    if clock_gettime(clk, &mut ts) != 0 {
+    if clock::gettime(clk, &mut ts) != 0 {
         return *__errno_location();
     }
     *sec = ts.tv_sec;
@@ -333,7 +353,7 @@ pub unsafe extern "C" fn rumpuser_clock_sleep(enum_: c_int, sec: i64, nsec: c_lo
     // RELWALL: relative sleep. ABSMONO: sleep until the absolute monotonic time.
     let req = if enum_ == RUMPUSER_CLOCK_ABSMONO {
         let mut now = Timespec { tv_sec: 0, tv_nsec: 0 };
-        clock_gettime(CLOCK_MONOTONIC, &mut now);
+        clock::gettime(CLOCK_MONOTONIC, &mut now);
         let mut s = sec - now.tv_sec;
         let mut n = nsec - now.tv_nsec;
         if n < 0 {
@@ -356,10 +376,67 @@ pub unsafe extern "C" fn rumpuser_clock_sleep(enum_: c_int, sec: i64, nsec: c_lo
 
 // ── host params ───────────────────────────────────────────────────────────────
 
+/// Rump virtual CPUs, as answered for `_RUMPUSER_NCPU` (rump_init asks once,
+/// before it creates any thread). The pthread backend pins per-CPU kthreads by it.
+#[cfg_attr(feature = "threads_fiber", allow(dead_code))]
+static mut NCPU: usize = 1;
+
+/// Host CPUs this process may run on (its sched_getaffinity mask), at least 1.
+unsafe fn host_ncpu() -> usize {
+    extern "C" {
+        fn sched_getaffinity(pid: c_int, size: usize, set: *mut u64) -> c_int;
+    }
+    let mut set = [0u64; 16];
+    if sched_getaffinity(0, core::mem::size_of_val(&set), set.as_mut_ptr()) != 0 {
+        return 1;
+    }
+    (set.iter().map(|w| w.count_ones() as usize).sum::<usize>()).max(1)
+}
+
+/// `_RUMPUSER_NCPU` from `RUMP_NCPU` as NetBSD's librumpuser reads it: a count,
+/// or `inherit` for the host's CPUs; 1 if unset. The fiber backend runs every
+/// kthread on one OS thread, where extra vCPUs only add scheduling work, so it
+/// always answers 1 (build `--no-default-features` for RUMP_NCPU > 1).
+unsafe fn getparam_ncpu(buf: *mut c_void, blen: usize) -> c_int {
+    let env = getenv(c"RUMP_NCPU".as_ptr());
+    let mut ncpu = if env.is_null() {
+        1
+    } else if cstr(env) == b"inherit" {
+        host_ncpu()
+    } else {
+        cstr(env).iter().take_while(|c| c.is_ascii_digit()).fold(0usize, |v, c| v * 10 + (c - b'0') as usize)
+    };
+    ncpu = ncpu.clamp(1, 64);
+    if cfg!(feature = "threads_fiber") && ncpu > 1 {
+        dprint(b"rumpuser: RUMP_NCPU > 1 needs the pthread backend; fiber runs 1 vCPU\n");
+        ncpu = 1;
+    }
+    let mut txt = [0u8; 4];
+    let mut i = txt.len() - 1; // txt[3] stays the NUL
+    let mut v = ncpu;
+    loop {
+        i -= 1;
+        txt[i] = b'0' + (v % 10) as u8;
+        v /= 10;
+        if v == 0 {
+            break;
+        }
+    }
+    if txt.len() - i > blen {
+        return ENOMEM;
+    }
+    memcpy(buf, txt[i..].as_ptr() as *const c_void, txt.len() - i);
+    NCPU = ncpu;
+    0
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn rumpuser_getparam(name: *const c_char, buf: *mut c_void, blen: usize) -> c_int {
     tr!(b"getparam");
     let n = cstr(name);
+    if n == b"_RUMPUSER_NCPU" {
+        return getparam_ncpu(buf, blen);
+    }
 
     // Honor the host environment first for every param (as NetBSD's own
     // librumpuser does): a set RUMP_VERBOSE / RUMP_NCPU / RUMP_MEMLIMIT / … wins.
@@ -374,9 +451,7 @@ pub unsafe extern "C" fn rumpuser_getparam(name: *const c_char, buf: *mut c_void
     }
 
     // Defaults when the env doesn't set it.
-    let default: &[u8] = if n == b"_RUMPUSER_NCPU" {
-        b"1\0"
-    } else if n == b"_RUMPUSER_HOSTNAME" {
+    let default: &[u8] = if n == b"_RUMPUSER_HOSTNAME" {
         b"rump-akuma\0"
     } else if n == b"RUMP_VERBOSE" {
         // ON by default so the NetBSD copyright banner + boot steps print — we
@@ -473,6 +548,28 @@ pub unsafe extern "C" fn rumpuser_akuma_yield() {
     nanosleep(&req, ptr::null_mut());
 }
 
+/// Fiber pool counters — fiber backend only (see fiber.rs); pthread threads are
+/// plain host threads with no pool, so report "unsupported".
+#[cfg(not(feature = "threads_fiber"))]
+#[no_mangle]
+pub unsafe extern "C" fn rumpuser_akuma_fiber_stats(_out: *mut c_void) -> c_int {
+    -1
+}
+
+/// `struct pollfd` for the pthread backend's real `poll` (fiber.rs has its own).
+#[cfg(not(feature = "threads_fiber"))]
+#[repr(C)]
+struct PollFd {
+    fd: c_int,
+    events: i16,
+    revents: i16,
+}
+
+#[cfg(not(feature = "threads_fiber"))]
+extern "C" {
+    fn poll(fds: *mut PollFd, nfds: usize, timeout: c_int) -> c_int;
+}
+
 /// Event-driven fd wait — the fiber backend integrates this into its cooperative
 /// scheduler (see fiber.rs); the pthread backend's RX/receiver runs on its own OS
 /// thread, so it just blocks in a real `poll`. Defined here only so the symbol
@@ -481,15 +578,6 @@ pub unsafe extern "C" fn rumpuser_akuma_yield() {
 #[cfg(not(feature = "threads_fiber"))]
 #[no_mangle]
 pub unsafe extern "C" fn rumpuser_akuma_wait_fd(fd: c_int, events: c_int, timeout_ms: c_int) -> c_int {
-    #[repr(C)]
-    struct PollFd {
-        fd: c_int,
-        events: i16,
-        revents: i16,
-    }
-    extern "C" {
-        fn poll(fds: *mut PollFd, nfds: usize, timeout: c_int) -> c_int;
-    }
     let mut pfd = PollFd { fd, events: events as i16, revents: 0 };
     if poll(&mut pfd, 1, timeout_ms) > 0 {
         pfd.revents as c_int
@@ -498,6 +586,14 @@ pub unsafe extern "C" fn rumpuser_akuma_wait_fd(fd: c_int, events: c_int, timeou
     }
 }
 
+/// Multi-fd event wait (the multi-client sysproxy server's idle) — on the
+/// pthread backend just a real `poll` over the array, as above.
+#[cfg(not(feature = "threads_fiber"))]
+#[no_mangle]
+pub unsafe extern "C" fn rumpuser_akuma_wait_fds(fds: *mut c_void, nfds: c_int, timeout_ms: c_int) -> c_int {
+    poll(fds as *mut PollFd, nfds.max(0) as usize, timeout_ms)
+}
+
 // ── pthread threading/sync/curlwp backend ────────────────────────────────────
 // The default backend: rump kthreads are 1:1 host pthreads; locks/cv/rw map to
 // pthread primitives. Wrapped in a module so the entire block is swapped out for
@@ -517,7 +613,7 @@ pub unsafe extern "C" fn rumpuser_thread_create(
     _thrname: *const c_char,
     _mustjoin: c_int,
     _priority: c_int,
-    _cpuidx: c_int,
+    cpuidx: c_int,
     cookie: *mut *mut c_void,
 ) -> c_int {
     tr!(b"thread_create");
@@ -526,12 +622,48 @@ pub unsafe extern "C" fn rumpuser_thread_create(
     if rv != 0 {
         return rv;
     }
+    pin_to_vcpu(tid, cpuidx);
     if !cookie.is_null() {
         *cookie = tid;
     }
     0
 }
 
+/// With RUMP_NCPU > 1, bind a kthread created for rump CPU `cpuidx` (the per-CPU
+/// softint and xcall threads; -1 = unbound) to the `cpuidx % n`-th of the n host
+/// CPUs in our affinity mask, so each vCPU's packet and timer work stays on one
+/// core's caches. Unbound lwps float. `RUMPUSER_PIN=0` turns this off.
+/// Best-effort: on Akuma every thread of a process runs on the core it was
+/// placed on (docs/MULTIKERNEL.md), and sched_setaffinity accepts the mask
+/// without acting on it.
+unsafe fn pin_to_vcpu(tid: PthreadT, cpuidx: c_int) {
+    extern "C" {
+        fn sched_getaffinity(pid: c_int, size: usize, set: *mut u64) -> c_int;
+        fn pthread_setaffinity_np(t: PthreadT, size: usize, set: *const u64) -> c_int;
+    }
+    if cpuidx < 0 || NCPU <= 1 {
+        return;
+    }
+    let pin = getenv(c"RUMPUSER_PIN".as_ptr());
+    if !pin.is_null() && *pin == b'0' as c_char {
+        return;
+    }
+    let mut mask = [0u64; 16];
+    if sched_getaffinity(0, core::mem::size_of_val(&mask), mask.as_mut_ptr()) != 0 {
+        return;
+    }
+    let n: usize = mask.iter().map(|w| w.count_ones() as usize).sum();
+    if n == 0 {
+        return;
+    }
+    let Some(cpu) = (0..mask.len() * 64).filter(|&c| mask[c / 64] & (1 << (c % 64)) != 0).nth(cpuidx as usize % n) else {
+        return;
+    };
+    let mut set = [0u64; 16];
+    set[cpu / 64] = 1 << (cpu % 64);
+    pthread_setaffinity_np(tid, core::mem::size_of_val(&set), set.as_ptr());
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn rumpuser_thread_exit() -> ! {
     tr!(b"thread_exit");
@@ -861,7 +993,7 @@ pub unsafe extern "C" fn rumpuser_cv_timedwait(cv: *mut Cv, m: *mut Mtx, sec: i6
     // absolute CLOCK_REALTIME deadline. Sample the clock before unscheduling (we
     // may be parked a while after releasing the rump CPU). Matches NetBSD.
     let mut ts = Timespec { tv_sec: 0, tv_nsec: 0 };
-    clock_gettime(CLOCK_REALTIME, &mut ts);
+    clock::gettime(CLOCK_REALTIME, &mut ts);
 
     (*cv).waiters += 1;
     let nlocks = cv_unschedule(m);
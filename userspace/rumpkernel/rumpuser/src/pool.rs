@@ -0,0 +1,386 @@
+//! Size-classed pool behind `rumpuser_malloc`/`rumpuser_free`.
+//!
+//! The rump kernel allocates through these two hypercalls for every mbuf
+//! cluster, pool page and kmem cache slab, and frees with the size it
+//! allocated. Passing each one to musl's `posix_memalign` paid musl's general
+//! path (its aligned case over-allocates and trims, per call) and scattered the
+//! stack's hot objects across the heap. Here, requests up to 64 KiB are served
+//! from power-of-two size classes (16 B … 64 KiB):
+//!
+//! - memory comes in 2 MiB arenas, 2 MiB-aligned, mapped through
+//!   `rumpuser_anonmmap`; with `RUMPUSER_POOL_HUGE=1` each arena is also
+//!   `madvise(MADV_HUGEPAGE)`d, so a host with transparent hugepages backs it
+//!   with one TLB entry;
+//! - an arena is cut into 64 KiB slabs, each owned by one class for good; a
+//!   class bump-allocates from its current slab, so pages are only touched
+//!   when handed out, and freed objects go on a per-class LIFO free list;
+//! - an object of class `c` sits at a multiple of `c` in a 64 KiB-aligned
+//!   slab, so it is `c`-aligned: the class is `max(len, align)` rounded up.
+//!
+//! `rumpuser_free` skips the pool for sizes above the largest class (those
+//! came from libc); otherwise the arena table says whether the pointer is ours
+//! and the slab's class byte says which list it goes back on. Anything the
+//! pool cannot serve — too large, too aligned, arenas exhausted — falls back
+//! to `posix_memalign`/`free` as before. Memory never goes back to the host:
+//! the rump kernel keeps its own pools on top of this and its working set is
+//! stable, so a slab freed to a class is reused by that class.
+//!
+//! One spinlock guards the lists: uncontended on the fiber backend (one OS
+//! thread), and held for a few instructions on the pthread backend, except
+//! while mapping a new arena.
+//!
+//! `RUMPUSER_POOL=0` turns the pool off (everything goes to libc) for A/B runs.
+//! `RUMPUSER_POOL_TIME=1` times every `rumpuser_malloc` into a log2 ns
+//! histogram (two `clock_gettime` per call, so only for measurement).
+//! `rumpuser_akuma_pool_stats` reports the counters; the virtif backends print
+//! them with their own (`[POOL]` lines, at exit and on SIGUSR1).
+
+use core::ffi::{c_char, c_int, c_void};
+use core::ptr;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU8, AtomicUsize, Ordering};
+
+use super::{clock, free, getenv, posix_memalign, rumpuser_anonmmap, Timespec, CLOCK_MONOTONIC};
+
+extern "C" {
+    fn madvise(addr: *mut c_void, len: usize, advice: c_int) -> c_int;
+}
+
+const MADV_HUGEPAGE: c_int = 14;
+const EINVAL: c_int = 22;
+
+const MIN_SHIFT: u32 = 4; // 16 B
+const MAX_SHIFT: u32 = 16; // 64 KiB
+const NCLASS: usize = (MAX_SHIFT - MIN_SHIFT + 1) as usize;
+/// Largest request the pool serves; `rumpuser_free` sends bigger ones to libc.
+pub const MAX_CLASS: usize = 1 << MAX_SHIFT;
+
+const SLAB_SHIFT: u32 = 16;
+const SLAB: usize = 1 << SLAB_SHIFT;
+const ARENA_SHIFT: u32 = 21;
+const ARENA: usize = 1 << ARENA_SHIFT;
+const SLABS_PER_ARENA: usize = ARENA / SLAB;
+/// 128 MiB of arenas; past that allocations fall back to libc.
+const MAX_ARENAS: usize = 64;
+
+const LAT_BUCKETS: usize = 24;
+
+#[derive(Clone, Copy)]
+struct Arena {
+    base: usize,
+    /// Owning class + 1 per slab; 0 = not handed out yet.
+    class: [u8; SLABS_PER_ARENA],
+}
+
+#[repr(C)]
+struct FreeObj {
+    next: *mut FreeObj,
+}
+
+/// Everything below is only touched with LOCK held.
+struct Pool {
+    free: [*mut FreeObj; NCLASS],
+    /// Bump range `[cur, end)` of each class's current slab.
+    cur: [usize; NCLASS],
+    end: [usize; NCLASS],
+    arenas: [Arena; MAX_ARENAS],
+    narenas: usize,
+    /// Next unused slab in the newest arena.
+    next_slab: usize,
+}
+
+static LOCK: AtomicBool = AtomicBool::new(false);
+static mut POOL: Pool = Pool {
+    free: [ptr::null_mut(); NCLASS],
+    cur: [0; NCLASS],
+    end: [0; NCLASS],
+    arenas: [Arena { base: 0, class: [0; SLABS_PER_ARENA] }; MAX_ARENAS],
+    narenas: 0,
+    next_slab: SLABS_PER_ARENA,
+};
+
+const MODE_UNSET: u8 = 0;
+const MODE_ON: u8 = 1;
+const MODE_OFF: u8 = 2;
+static MODE: AtomicU8 = AtomicU8::new(MODE_UNSET);
+static HUGE: AtomicBool = AtomicBool::new(false);
+static TIMED: AtomicBool = AtomicBool::new(false);
+
+static ALLOCS: AtomicUsize = AtomicUsize::new(0);
+static FREES: AtomicUsize = AtomicUsize::new(0);
+static LIBC_ALLOCS: AtomicUsize = AtomicUsize::new(0);
+static LIBC_FREES: AtomicUsize = AtomicUsize::new(0);
+static SLAB_BYTES: AtomicUsize = AtomicUsize::new(0);
+static INUSE: AtomicUsize = AtomicUsize::new(0);
+static INUSE_HIWAT: AtomicUsize = AtomicUsize::new(0);
+static LAT: [AtomicU32; LAT_BUCKETS] = [const { AtomicU32::new(0) }; LAT_BUCKETS];
+
+/// Pool counters, filled by `rumpuser_akuma_pool_stats` (layout shared with the
+/// C `struct akpool_stats` in virtif_stats.h).
+#[repr(C)]
+pub struct PoolStats {
+    enabled: usize,
+    huge: usize,        // arenas madvise(MADV_HUGEPAGE)d
+    allocs: usize,      // served from the pool
+    frees: usize,       // returned to the pool
+    libc_allocs: usize, // too large/aligned, pool off or out of arenas
+    libc_frees: usize,
+    arenas: usize,
+    arena_bytes: usize, // mapped
+    slab_bytes: usize,  // handed to a class (upper bound on touched)
+    inuse_bytes: usize, // pooled objects live, by class size
+    inuse_hiwat: usize,
+    lat_ns: [u32; LAT_BUCKETS], // rumpuser_malloc, log2 ns (RUMPUSER_POOL_TIME)
+}
+
+fn lock() {
+    while LOCK.compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed).is_err() {
+        while LOCK.load(Ordering::Relaxed) {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+fn unlock() {
+    LOCK.store(false, Ordering::Release);
+}
+
+/// Whether env `name` is set to something other than "0" (`dflt` if unset).
+unsafe fn env_flag(name: *const c_char, dflt: bool) -> bool {
+    let v = getenv(name);
+    if v.is_null() || *v == 0 {
+        dflt
+    } else {
+        *v != b'0' as c_char
+    }
+}
+
+unsafe fn mode() -> u8 {
+    let m = MODE.load(Ordering::Relaxed);
+    if m != MODE_UNSET {
+        return m;
+    }
+    // First call is rump_init's, before any rump thread exists.
+    HUGE.store(env_flag(c"RUMPUSER_POOL_HUGE".as_ptr(), false), Ordering::Relaxed);
+    TIMED.store(env_flag(c"RUMPUSER_POOL_TIME".as_ptr(), false), Ordering::Relaxed);
+    let m = if env_flag(c"RUMPUSER_POOL".as_ptr(), true) { MODE_ON } else { MODE_OFF };
+    MODE.store(m, Ordering::Relaxed);
+    m
+}
+
+/// Size class index for a request, or None if it is too big for the pool.
+fn class_of(len: usize, align: usize) -> Option<usize> {
+    let sz = len.max(align).max(1 << MIN_SHIFT);
+    if sz > MAX_CLASS {
+        return None;
+    }
+    Some((sz.next_power_of_two().trailing_zeros() - MIN_SHIFT) as usize)
+}
+
+/// Map one more arena. LOCK held.
+unsafe fn grow(p: &mut Pool) -> bool {
+    if p.narenas == MAX_ARENAS {
+        return false;
+    }
+    let mut base: *mut c_void = ptr::null_mut();
+    if rumpuser_anonmmap(ptr::null_mut(), ARENA, ARENA_SHIFT as c_int, 0, &mut base) != 0 {
+        return false;
+    }
+    if HUGE.load(Ordering::Relaxed) {
+        madvise(base, ARENA, MADV_HUGEPAGE);
+    }
+    p.arenas[p.narenas] = Arena { base: base as usize, class: [0; SLABS_PER_ARENA] };
+    p.narenas += 1;
+    p.next_slab = 0;
+    true
+}
+
+/// Give class `c` a fresh slab to bump from. LOCK held.
+unsafe fn refill(p: &mut Pool, c: usize) -> bool {
+    if p.next_slab == SLABS_PER_ARENA && !grow(p) {
+        return false;
+    }
+    let a = &mut p.arenas[p.narenas - 1];
+    a.class[p.next_slab] = c as u8 + 1;
+    p.cur[c] = a.base + p.next_slab * SLAB;
+    p.end[c] = p.cur[c] + SLAB;
+    p.next_slab += 1;
+    SLAB_BYTES.fetch_add(SLAB, Ordering::Relaxed);
+    true
+}
+
+unsafe fn pool_alloc(c: usize) -> *mut c_void {
+    let sz = 1usize << (c as u32 + MIN_SHIFT);
+    lock();
+    let p = &mut *ptr::addr_of_mut!(POOL);
+    let obj = if !p.free[c].is_null() {
+        let o = p.free[c];
+        p.free[c] = (*o).next;
+        o as *mut c_void
+    } else if p.cur[c] < p.end[c] || refill(p, c) {
+        let o = p.cur[c];
+        p.cur[c] += sz;
+        o as *mut c_void
+    } else {
+        ptr::null_mut()
+    };
+    unlock();
+    if !obj.is_null() {
+        let inuse = INUSE.fetch_add(sz, Ordering::Relaxed) + sz;
+        INUSE_HIWAT.fetch_max(inuse, Ordering::Relaxed);
+    }
+    obj
+}
+
+/// Put `obj` back on its class list if it lies in one of our arenas.
+unsafe fn pool_free(obj: *mut c_void) -> bool {
+    let a = obj as usize & !(ARENA - 1);
+    lock();
+    let p = &mut *ptr::addr_of_mut!(POOL);
+    let mut class = 0;
+    for arena in &p.arenas[..p.narenas] {
+        if arena.base == a {
+            class = arena.class[(obj as usize - a) >> SLAB_SHIFT] as usize;
+            break;
+        }
+    }
+    if class != 0 {
+        let o = obj as *mut FreeObj;
+        (*o).next = p.free[class - 1];
+        p.free[class - 1] = o;
+    }
+    unlock();
+    if class != 0 {
+        INUSE.fetch_sub(1 << (class as u32 - 1 + MIN_SHIFT), Ordering::Relaxed);
+    }
+    class != 0
+}
+
+fn now_ns() -> u64 {
+    let mut ts = Timespec { tv_sec: 0, tv_nsec: 0 };
+    unsafe { clock::gettime(CLOCK_MONOTONIC, &mut ts) };
+    ts.tv_sec as u64 * 1_000_000_000 + ts.tv_nsec as u64
+}
+
+unsafe fn alloc_untimed(len: usize, align: usize, memp: *mut *mut c_void) -> c_int {
+    if mode() == MODE_ON {
+        if let Some(c) = class_of(len, align) {
+            let obj = pool_alloc(c);
+            if !obj.is_null() {
+                ALLOCS.fetch_add(1, Ordering::Relaxed);
+                *memp = obj;
+                return 0;
+            }
+        }
+    }
+    LIBC_ALLOCS.fetch_add(1, Ordering::Relaxed);
+    posix_memalign(memp, align, len)
+}
+
+/// `rumpuser_malloc` body; `align` is a power of two >= sizeof(void *).
+pub unsafe fn malloc(len: usize, align: usize, memp: *mut *mut c_void) -> c_int {
+    if !TIMED.load(Ordering::Relaxed) {
+        return alloc_untimed(len, align, memp);
+    }
+    let t0 = now_ns();
+    let rv = alloc_untimed(len, align, memp);
+    let ns = now_ns().saturating_sub(t0);
+    let i = if ns == 0 { 0 } else { 64 - ns.leading_zeros() as usize };
+    LAT[i.min(LAT_BUCKETS - 1)].fetch_add(1, Ordering::Relaxed);
+    rv
+}
+
+/// `rumpuser_free` body; `size` is what the rump kernel allocated.
+pub unsafe fn free_sized(obj: *mut c_void, size: usize) {
+    if obj.is_null() {
+        return;
+    }
+    if MODE.load(Ordering::Relaxed) == MODE_ON && size <= MAX_CLASS && pool_free(obj) {
+        FREES.fetch_add(1, Ordering::Relaxed);
+        return;
+    }
+    LIBC_FREES.fetch_add(1, Ordering::Relaxed);
+    free(obj);
+}
+
+/// Copy the pool counters into `out` (a C `struct akpool_stats`). Returns 0.
+#[no_mangle]
+pub unsafe extern "C" fn rumpuser_akuma_pool_stats(out: *mut PoolStats) -> c_int {
+    if out.is_null() {
+        return EINVAL;
+    }
+    lock();
+    let narenas = (*ptr::addr_of!(POOL)).narenas;
+    unlock();
+    let huge = HUGE.load(Ordering::Relaxed);
+    let mut lat = [0u32; LAT_BUCKETS];
+    for (d, s) in lat.iter_mut().zip(LAT.iter()) {
+        *d = s.load(Ordering::Relaxed);
+    }
+    *out = PoolStats {
+        enabled: (MODE.load(Ordering::Relaxed) == MODE_ON) as usize,
+        huge: if huge { narenas } else { 0 },
+        allocs: ALLOCS.load(Ordering::Relaxed),
+        frees: FREES.load(Ordering::Relaxed),
+        libc_allocs: LIBC_ALLOCS.load(Ordering::Relaxed),
+        libc_frees: LIBC_FREES.load(Ordering::Relaxed),
+        arenas: narenas,
+        arena_bytes: narenas * ARENA,
+        slab_bytes: SLAB_BYTES.load(Ordering::Relaxed),
+        inuse_bytes: INUSE.load(Ordering::Relaxed),
+        inuse_hiwat: INUSE_HIWAT.load(Ordering::Relaxed),
+        lat_ns: lat,
+    };
+    0
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn classes_round_up_and_honour_alignment() {
+        assert_eq!(class_of(1, 8), Some(0));
+        assert_eq!(class_of(16, 8), Some(0));
+        assert_eq!(class_of(17, 8), Some(1));
+        assert_eq!(class_of(100, 256), Some(4)); // 256 B
+        assert_eq!(class_of(2048, 64), Some(7));
+        assert_eq!(class_of(MAX_CLASS, 8), Some(NCLASS - 1));
+        assert_eq!(class_of(MAX_CLASS + 1, 8), None);
+        assert_eq!(class_of(64, 1 << 17), None);
+    }
+
+    #[test]
+    fn pooled_objects_are_aligned_reused_and_returned() {
+        unsafe {
+            MODE.store(MODE_ON, Ordering::Relaxed);
+            let mut a: *mut c_void = ptr::null_mut();
+            let mut b: *mut c_void = ptr::null_mut();
+            assert_eq!(malloc(200, 64, &mut a), 0);
+            assert_eq!(malloc(200, 64, &mut b), 0);
+            assert_eq!(a as usize % 256, 0);
+            assert_eq!(b as usize, a as usize + 256); // bump within the slab
+            ptr::write_bytes(a as *mut u8, 0xa5, 200);
+            free_sized(a, 200);
+            let mut c: *mut c_void = ptr::null_mut();
+            assert_eq!(malloc(256, 8, &mut c), 0);
+            assert_eq!(c, a); // LIFO free list
+            free_sized(b, 200);
+            free_sized(c, 256);
+
+            // Past the largest class: libc, and freed back to libc by size.
+            let libc = LIBC_FREES.load(Ordering::Relaxed);
+            let mut big: *mut c_void = ptr::null_mut();
+            assert_eq!(malloc(MAX_CLASS * 2, 4096, &mut big), 0);
+            assert_eq!(big as usize % 4096, 0);
+            free_sized(big, MAX_CLASS * 2);
+            assert!(LIBC_FREES.load(Ordering::Relaxed) > libc);
+
+            let mut st = core::mem::MaybeUninit::<PoolStats>::uninit();
+            assert_eq!(rumpuser_akuma_pool_stats(st.as_mut_ptr()), 0);
+            let st = st.assume_init();
+            assert!(st.arenas >= 1 && st.slab_bytes >= SLAB);
+            assert_eq!(st.arena_bytes % ARENA, 0);
+            assert_eq!((*ptr::addr_of!(POOL)).arenas[0].base % ARENA, 0);
+        }
+    }
+}
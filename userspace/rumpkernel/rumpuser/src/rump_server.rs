@@ -5,7 +5,7 @@
 //! URL) so other processes can run `rump_sys_*` against this stack.
 //!
 //! This file is ORIGINAL Akuma code. It only *calls* the rump public API
-//! (`rump_init`, `rump_pub_netconfig_*`), our sysproxy bridge `rumpuser_sp_init_fd`
+//! (`rump_init`, `rump_pub_netconfig_*`), our sysproxy bridge `rumpuser_sp_init_mux`
 //! (from `sp_serve_fd.c`, which `#include`s NetBSD's UNMODIFIED `rumpuser_sp.c`),
 //! and libc — so it ports cleanly to Rust while the sysproxy protocol server
 //! itself stays NetBSD C. See docs/FIBER_HANDOFF.md.
@@ -32,6 +32,7 @@ extern "C" {
     fn strlen(s: *const c_char) -> usize;
     fn memcpy(d: *mut c_void, s: *const c_void, n: usize) -> *mut c_void;
     fn setvbuf(stream: *mut c_void, buf: *mut c_char, mode: c_int, size: usize) -> c_int;
+    fn getenv(name: *const c_char) -> *const c_char;
     // musl exports a real `stdout` symbol (a `FILE *const`); we only need the
     // pointer value to hand to setvbuf.
     static stdout: *mut c_void;
@@ -43,8 +44,18 @@ extern "C" {
     fn rump_pub_netconfig_ifcreate(ifname: *const c_char) -> c_int;
     fn rump_pub_netconfig_dhcp_ipv4_oneshot(ifname: *const c_char) -> c_int;
     fn rump_init_server(url: *const c_char) -> c_int;
-    // serve sysproxy on a pre-connected fd (kernel-pipe transport); from sp_serve_fd.c.
-    fn rumpuser_sp_init_fd(fd: c_int, host: *const c_char, vers: *const c_char, arch: *const c_char) -> c_int;
+    fn rump_sys_socket(domain: c_int, ty: c_int, proto: c_int) -> c_int;
+    fn rump_sys_ioctl(fd: c_int, req: u64, ...) -> c_int;
+    fn rump_sys_close(fd: c_int) -> c_int;
+    // serve sysproxy on a pre-connected fd (kernel-pipe transport), plus any further
+    // channels the kernel announces on `ctlfd` (-1: none); from sp_serve_fd.c.
+    fn rumpuser_sp_init_mux(
+        fd: c_int,
+        ctlfd: c_int,
+        host: *const c_char,
+        vers: *const c_char,
+        arch: *const c_char,
+    ) -> c_int;
     // rumpuser backend introspection (defined in this crate): 1 if rump kthreads
     // are cooperative fibers on one OS thread (else 0 = pthread). _yield runs the
     // fiber scheduler. Declared extern so we resolve the symbol regardless of which
@@ -59,6 +70,37 @@ const O_CREAT: c_int = 0o100;
 const O_TRUNC: c_int = 0o1000;
 const _IONBF: c_int = 2;
 
+// NetBSD (rump side): AF_INET, SOCK_DGRAM, SIOCSIFMTU = _IOW('i', 127, struct
+// ifreq), where ifreq is ifr_name[16] + a 128-byte union holding ifr_mtu.
+const RUMP_AF_INET: c_int = 2;
+const RUMP_SOCK_DGRAM: c_int = 2;
+const RUMP_SIOCSIFMTU: u64 = 0x8090_697f;
+const RUMP_IFREQ_LEN: usize = 144;
+
+/// `RUMP_VIRTIF_GRO`, parsed as rumpcomp_tap.c does: the MTU merged RX frames
+/// may reach (576..=65535, larger values clamp), or 0 when GRO is off.
+unsafe fn gro_mtu() -> c_int {
+    let e = getenv(c"RUMP_VIRTIF_GRO".as_ptr());
+    let v = if e.is_null() { 0 } else { atoi(e) };
+    if v < 576 { 0 } else { v.min(65535) }
+}
+
+/// Set `ifname`'s MTU on the rump stack (SIOCSIFMTU on a scratch socket).
+/// Returns 0 or the rump errno-style -1.
+unsafe fn set_mtu(ifname: *const c_char, mtu: c_int) -> c_int {
+    let mut ifr = [0u8; RUMP_IFREQ_LEN];
+    let n = strlen(ifname).min(15);
+    memcpy(ifr.as_mut_ptr().cast(), ifname.cast(), n);
+    ifr[16..20].copy_from_slice(&mtu.to_ne_bytes());
+    let s = rump_sys_socket(RUMP_AF_INET, RUMP_SOCK_DGRAM, 0);
+    if s < 0 {
+        return s;
+    }
+    let rv = rump_sys_ioctl(s, RUMP_SIOCSIFMTU, ifr.as_mut_ptr());
+    rump_sys_close(s);
+    rv
+}
+
 /// 1 if `--net` was given (for the `(net=%s)` log fields), else 0 → "up"/"off".
 unsafe fn netstr(do_net: c_int) -> *const c_char {
     if do_net != 0 {
@@ -107,11 +149,14 @@ pub unsafe extern "C" fn main(argc: c_int, argv: *const *const c_char) -> c_int
     let mut ifname: *const c_char = c"virt0".as_ptr();
     let mut logpath: *const c_char = ptr::null(); // --log: redirect stdout/stderr here
     let mut serve_fd: c_int = -1; // >=0: serve sysproxy on this inherited fd
+    let mut chan_fd: c_int = -1; // >=0: more boxes' channels announced on this fd
     let mut do_net: c_int = 0; // --net: bring up virt0 + DHCP over /dev/net/tap0
     let mut url_given: c_int = 0; // a positional URL was passed (legacy listen mode)
 
     // Modes:
     //   rump_server --fd N [--net]     serve on inherited fd N (Akuma kernel-pipe)
+    //     [--chan-fd M]                 ...and on the channels of boxes sharing this
+    //                                   stack, whose fds the kernel writes to fd M
     //   rump_server [url] [--net]      listen on a URL (container/path tests)
     // --net brings the rump stack online (needs RUMP_NIC=1 / a tap); without it
     // the stack still serves control-plane syscalls (e.g. socket()).
@@ -121,6 +166,9 @@ pub unsafe extern "C" fn main(argc: c_int, argv: *const *const c_char) -> c_int
         if strcmp(arg, c"--fd".as_ptr()) == 0 && i + 1 < argc {
             i += 1;
             serve_fd = atoi(*argv.add(i as usize));
+        } else if strcmp(arg, c"--chan-fd".as_ptr()) == 0 && i + 1 < argc {
+            i += 1;
+            chan_fd = atoi(*argv.add(i as usize));
         } else if strcmp(arg, c"--net".as_ptr()) == 0 {
             do_net = 1;
         } else if strcmp(arg, c"--if".as_ptr()) == 0 && i + 1 < argc {
@@ -152,6 +200,13 @@ pub unsafe extern "C" fn main(argc: c_int, argv: *const *const c_char) -> c_int
     if do_net != 0 {
         rv = rump_pub_netconfig_ifcreate(ifname);
         printf(c"RUMP_SERVER: ifcreate %s -> %d\n".as_ptr(), ifname, rv);
+        // RX coalescing in rumpcomp_tap.c hands the stack frames up to this
+        // size; ether_input drops anything over the interface MTU.
+        let mtu = gro_mtu();
+        if mtu != 0 {
+            rv = set_mtu(ifname, mtu);
+            printf(c"RUMP_SERVER: GRO mtu %s %d -> %d\n".as_ptr(), ifname, mtu, rv);
+        }
         rv = rump_pub_netconfig_dhcp_ipv4_oneshot(ifname);
         printf(c"RUMP_SERVER: dhcp_ipv4_oneshot %s -> %d\n".as_ptr(), ifname, rv);
         if rv != 0 {
@@ -160,8 +215,14 @@ pub unsafe extern "C" fn main(argc: c_int, argv: *const *const c_char) -> c_int
     }
 
     if serve_fd >= 0 {
-        rv = rumpuser_sp_init_fd(serve_fd, c"NetBSD".as_ptr(), c"7.99.34".as_ptr(), c"evbarm64".as_ptr());
-        printf(c"RUMP_SERVER: rumpuser_sp_init_fd(%d) -> %d\n".as_ptr(), serve_fd, rv);
+        rv = rumpuser_sp_init_mux(
+            serve_fd,
+            chan_fd,
+            c"NetBSD".as_ptr(),
+            c"7.99.34".as_ptr(),
+            c"evbarm64".as_ptr(),
+        );
+        printf(c"RUMP_SERVER: rumpuser_sp_init_mux(%d, %d) -> %d\n".as_ptr(), serve_fd, chan_fd, rv);
         if rv != 0 {
             printf(c"RUMP_SERVER: FAIL — sp_init_fd rv=%d\n".as_ptr(), rv);
             return 1;
@@ -0,0 +1,212 @@
+/*
+ * virtif_gro.h — receive-side coalescing for a virtif backend: consecutive
+ * in-order TCP/IPv4 segments of one flow in an RX batch go to the stack as one
+ * frame, so a bulk download costs the NetBSD input path (ether_input, ip_input,
+ * tcp_input, the socket wakeup) once per merged frame instead of once per
+ * ~1448-byte segment.
+ *
+ * The merged frame comes back as a gather list: a rebuilt header (the first
+ * segment's, with the IP length/checksum, PSH and TCP checksum redone)
+ * followed by each segment's payload in place. The caller decides how to hand
+ * that to the stack.
+ *
+ * Segments merge, as in Linux's GRO, only if they are IPv4 without options or
+ * fragmentation, TCP with just ACK (PSH allowed, and it ends the run), a
+ * payload, and the same addresses, ports, TOS, TTL, DF, ack, window and TCP
+ * options as the run's first, and continue its sequence. Anything else goes
+ * through alone. The TCP checksum of the merged frame is built from each
+ * segment's own checksum field, not by summing the payloads, so it costs
+ * O(headers); a corrupt segment makes the merged frame's checksum fail in the
+ * stack, as the segment alone would have.
+ *
+ * The stack drops input frames longer than the interface MTU, so merged
+ * frames are capped at an IP length of `mtu`, which the caller must have set
+ * on the interface (RUMP_VIRTIF_GRO, see rumpcomp_tap.c).
+ *
+ * Header-only with static functions, like virtif_stats.h, and free of rump
+ * calls, so c_tests/test_gro.c can run it on any host.
+ */
+#ifndef VIRTIF_GRO_H
+#define VIRTIF_GRO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#define VG_MAX_SEGS	64	/* segments per merged frame */
+#define VG_HDR_MAX	(14 + 20 + 60)	/* Ethernet + IPv4 + largest TCP */
+
+/* One output frame: iov[0] is hdr (or the whole frame if nothing merged). */
+struct vg_out {
+	struct iovec iov[VG_MAX_SEGS + 1];
+	size_t iovlen;
+	unsigned char hdr[VG_HDR_MAX];
+};
+
+#define VG_TH_ACK	0x10
+#define VG_TH_PSH	0x08
+
+static inline uint16_t
+vg_be16(const unsigned char *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline void
+vg_put16(unsigned char *p, uint16_t v)
+{
+	p[0] = (unsigned char)(v >> 8);
+	p[1] = (unsigned char)v;
+}
+
+/* Ones' complement sum of n (even) bytes at p, added to s, unfolded. */
+static inline uint32_t
+vg_sum(const unsigned char *p, size_t n, uint32_t s)
+{
+	size_t i;
+
+	for (i = 0; i + 1 < n; i += 2)
+		s += vg_be16(p + i);
+	return s;
+}
+
+static inline uint16_t
+vg_fold(uint32_t s)
+{
+	while (s >> 16)
+		s = (s & 0xffff) + (s >> 16);
+	return (uint16_t)s;
+}
+
+/* A parsed TCP/IPv4 segment, or ok = 0 if the frame cannot merge. */
+struct vg_seg {
+	int ok;
+	const unsigned char *ip, *tcp;
+	size_t thlen, plen;	/* TCP header and payload bytes */
+	uint32_t seq;
+};
+
+static inline struct vg_seg
+vg_parse(const struct iovec *f)
+{
+	struct vg_seg s = { 0 };
+	const unsigned char *e = f->iov_base, *ip = e + 14, *tcp = ip + 20;
+	size_t len = f->iov_len, iplen, thlen;
+
+	if (len < 14 + 20 + 20 || vg_be16(e + 12) != 0x0800 || ip[0] != 0x45 ||
+	    ip[9] != 6 || (vg_be16(ip + 6) & 0x3fff) != 0 ||
+	    vg_fold(vg_sum(ip, 20, 0)) != 0xffff)
+		return s;
+	iplen = vg_be16(ip + 2);
+	thlen = (size_t)(tcp[12] >> 4) * 4;
+	if (iplen > len - 14 || thlen < 20 || 20 + thlen >= iplen ||
+	    (tcp[13] & ~VG_TH_PSH) != VG_TH_ACK)
+		return s;
+	s.ok = 1;
+	s.ip = ip;
+	s.tcp = tcp;
+	s.thlen = thlen;
+	s.plen = iplen - 20 - thlen;
+	s.seq = (uint32_t)vg_be16(tcp + 4) << 16 | vg_be16(tcp + 6);
+	return s;
+}
+
+/* Whether segment b may follow a, whose run ends at sequence `next`. */
+static inline int
+vg_follows(const struct vg_seg *a, const struct vg_seg *b, uint32_t next)
+{
+	return b->ok && b->seq == next && b->thlen == a->thlen &&
+	    a->ip[1] == b->ip[1] && a->ip[6] == b->ip[6] &&
+	    a->ip[8] == b->ip[8] &&
+	    memcmp(a->ip + 12, b->ip + 12, 8) == 0 &&	/* addresses */
+	    memcmp(a->tcp, b->tcp, 4) == 0 &&		/* ports */
+	    memcmp(a->tcp + 8, b->tcp + 8, 4) == 0 &&	/* ack */
+	    memcmp(a->tcp + 14, b->tcp + 14, 2) == 0 &&	/* window */
+	    memcmp(a->tcp + 20, b->tcp + 20, a->thlen - 20) == 0;
+}
+
+/* Payload sum of segment s recovered from its checksum field: the field is
+ * ~(pseudo header + TCP header without it + payload). */
+static inline uint32_t
+vg_payload_sum(const struct vg_seg *s)
+{
+	uint32_t hdr = vg_sum(s->ip + 12, 8, 6 + (uint32_t)(s->thlen + s->plen));
+
+	hdr = vg_sum(s->tcp, 16, hdr) + vg_sum(s->tcp + 18, s->thlen - 18, 0);
+	/* payload = ~csum - hdr, in ones' complement */
+	return (uint32_t)(uint16_t)~vg_be16(s->tcp + 16) +
+	    (uint16_t)~vg_fold(hdr);
+}
+
+/*
+ * Build in `out` the frame starting at frames[i] of the n in a batch: it alone,
+ * or it merged with the segments that follow it, keeping the IP length within
+ * `mtu`. Returns how many frames it took (at least 1).
+ */
+static inline int
+vg_next(const struct iovec *frames, int n, int i, size_t mtu,
+	struct vg_out *out)
+{
+	struct vg_seg first = vg_parse(&frames[i]), cur;
+	size_t hlen, total;
+	uint32_t next, psum;
+	unsigned char *ip, *tcp;
+	int k = 1;
+
+	out->iov[0] = frames[i];
+	out->iovlen = 1;
+	if (!first.ok || (first.tcp[13] & VG_TH_PSH))
+		return 1;
+	hlen = 14 + 20 + first.thlen;
+	total = first.plen;
+	next = first.seq + (uint32_t)first.plen;
+	psum = vg_payload_sum(&first);
+	while (i + k < n && k < VG_MAX_SEGS) {
+		cur = vg_parse(&frames[i + k]);
+		if (!vg_follows(&first, &cur, next) ||
+		    20 + first.thlen + total + cur.plen > mtu)
+			break;
+		if (k == 1) {
+			memcpy(out->hdr, frames[i].iov_base, hlen);
+			out->iov[0].iov_base = out->hdr;
+			out->iov[0].iov_len = hlen;
+			out->iov[1].iov_base = (unsigned char *)first.tcp +
+			    first.thlen;
+			out->iov[1].iov_len = first.plen;
+			out->iovlen = 2;
+		}
+		/* a payload at an odd offset sums byte-swapped */
+		{
+			uint32_t p = vg_fold(vg_payload_sum(&cur));
+
+			if (total & 1)
+				p = ((p & 0xff) << 8) | (p >> 8);
+			psum += p;
+		}
+		out->iov[out->iovlen].iov_base = (unsigned char *)cur.tcp +
+		    cur.thlen;
+		out->iov[out->iovlen++].iov_len = cur.plen;
+		total += cur.plen;
+		next += (uint32_t)cur.plen;
+		k++;
+		if (cur.tcp[13] & VG_TH_PSH)
+			break;
+	}
+	if (k == 1)
+		return 1;
+
+	ip = out->hdr + 14;
+	tcp = ip + 20;
+	vg_put16(ip + 2, (uint16_t)(20 + first.thlen + total));
+	vg_put16(ip + 10, 0);
+	vg_put16(ip + 10, (uint16_t)~vg_fold(vg_sum(ip, 20, 0)));
+	tcp[13] = ((const unsigned char *)out->iov[out->iovlen - 1].iov_base -
+	    first.thlen)[13];	/* the last segment's flags (PSH) */
+	vg_put16(tcp + 16, 0);
+	vg_put16(tcp + 16, (uint16_t)~vg_fold(psum + vg_sum(tcp, first.thlen,
+	    vg_sum(ip + 12, 8, 6 + (uint32_t)(first.thlen + total)))));
+	return k;
+}
+
+#endif /* VIRTIF_GRO_H */
@@ -0,0 +1,300 @@
+/*
+ * virtif_stats.h — always-on instrumentation shared by the virtif backends
+ * (rumpcomp_tap.c on Akuma, virtif_user_instr.c in the container demo).
+ *
+ * Each backend is the only one linked into its program, so this is header-only
+ * with static storage: one `vif_stats` per program.
+ *
+ * What is kept, all with relaxed atomics so any thread may record:
+ *  - TX/RX packet and byte totals (the old g_* counters);
+ *  - log2 histograms of RX read-to-deliver latency (per batch: from the read
+ *    or ring sync returning to the last frame handed to the stack), TX send
+ *    latency (per frame, inside VIFHYPER_SEND), and RX batch size;
+ *  - counts of RX EAGAINs, RX waits (fiber parked on the tap fd or yielded),
+ *    TX drops (ring full) and TX/RX errors.
+ *
+ * Latency bucket i counts samples in [2^(i-1), 2^i) µs, bucket 0 exactly 0,
+ * as in crates/akuma-rump/src/latency.rs; a percentile prints as the upper
+ * edge of its bucket ("p99<=2048us").
+ *
+ * On demand: SIGUSR1 dumps everything to stderr with the rates since the
+ * previous dump, from the signal handler itself (write(2) only, no stdio), so
+ * a live rump box can be inspected without restarting it:
+ *     kill -USR1 <pid>
+ * The handler is only installed if SIGUSR1 is still SIG_DFL, so an app that
+ * uses SIGUSR1 itself (under the hijack) keeps it.
+ *
+ * The dump also carries the rumpuser memory pool's counters (src/pool.rs):
+ * mapped arena and slab bytes stand in for the rump kernel's RSS, and
+ * RUMPUSER_POOL_TIME=1 fills its rumpuser_malloc latency histogram (ns).
+ */
+#ifndef VIRTIF_STATS_H
+#define VIRTIF_STATS_H
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VS_BUCKETS 24
+
+struct vif_stats {
+	unsigned long tx_pkts, tx_bytes, rx_pkts, rx_bytes;
+	unsigned long rx_eagain;	/* RX read/sync found nothing */
+	unsigned long rx_waits;		/* RX fiber parked or yielded */
+	unsigned long tx_drops;		/* frame dropped: TX ring full */
+	unsigned long tx_errs, rx_errs;	/* write/read failures */
+	unsigned long rx_gro_pkts;	/* merged frames delivered (GRO) */
+	unsigned long rx_gro_segs;	/* segments that went into them */
+	uint32_t rx_lat[VS_BUCKETS];	/* µs, per RX batch */
+	uint32_t tx_lat[VS_BUCKETS];	/* µs, per TX frame */
+	uint32_t rx_batch[VS_BUCKETS];	/* frames per RX batch */
+};
+static struct vif_stats vs;
+
+/* rumpuser memory pool counters (pool.rs PoolStats; same field order). */
+struct akpool_stats {
+	unsigned long enabled, huge;	/* pool on; arenas madvised huge */
+	unsigned long allocs, frees;	/* served by / returned to the pool */
+	unsigned long libc_allocs, libc_frees;	/* passed to libc */
+	unsigned long arenas, arena_bytes, slab_bytes;
+	unsigned long inuse_bytes, inuse_hiwat;
+	uint32_t lat_ns[VS_BUCKETS];	/* rumpuser_malloc, RUMPUSER_POOL_TIME */
+};
+extern int rumpuser_akuma_pool_stats(struct akpool_stats *out);
+
+#define VS_INC(f)	__atomic_fetch_add(&vs.f, 1, __ATOMIC_RELAXED)
+#define VS_ADD(f, n)	__atomic_fetch_add(&vs.f, (n), __ATOMIC_RELAXED)
+#define VS_GET(f)	__atomic_load_n(&vs.f, __ATOMIC_RELAXED)
+
+static inline uint64_t
+vs_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static inline void
+vs_hist(uint32_t *h, uint64_t v)
+{
+	unsigned i = v ? 64 - (unsigned)__builtin_clzll(v) : 0;
+
+	__atomic_fetch_add(&h[i < VS_BUCKETS ? i : VS_BUCKETS - 1], 1,
+	    __ATOMIC_RELAXED);
+}
+
+/* ── dump (async-signal-safe: fixed buffer + write(2)) ───────────────────── */
+
+struct vs_buf {
+	char b[1024];
+	size_t n;
+};
+
+static void
+vs_puts(struct vs_buf *o, const char *s)
+{
+	while (*s && o->n < sizeof(o->b))
+		o->b[o->n++] = *s++;
+}
+
+static void
+vs_putu(struct vs_buf *o, unsigned long v)
+{
+	char t[24];
+	int i = 0;
+
+	do
+		t[i++] = (char)('0' + v % 10);
+	while ((v /= 10) != 0);
+	while (i > 0 && o->n < sizeof(o->b))
+		o->b[o->n++] = t[--i];
+}
+
+/* Upper bucket edge holding the pct-th percentile sample, or 0 if empty. */
+static unsigned long
+vs_pct(const uint32_t *c, unsigned long total, unsigned pct)
+{
+	unsigned long rank = (total * pct + 99) / 100, seen = 0;
+	int i;
+
+	if (total == 0)
+		return 0;
+	if (rank == 0)
+		rank = 1;
+	for (i = 0; i < VS_BUCKETS; i++) {
+		seen += c[i];
+		if (seen >= rank)
+			break;
+	}
+	return i == 0 ? 0 : 1ul << (i < VS_BUCKETS ? i : VS_BUCKETS - 1);
+}
+
+static void
+vs_put_hist(struct vs_buf *o, const char *name, const uint32_t *h,
+	const char *unit)
+{
+	uint32_t c[VS_BUCKETS];
+	unsigned long total = 0;
+	int i;
+
+	for (i = 0; i < VS_BUCKETS; i++)
+		total += c[i] = __atomic_load_n(&h[i], __ATOMIC_RELAXED);
+	vs_puts(o, "[VIRTIF HIST] ");
+	vs_puts(o, name);
+	vs_puts(o, " n=");
+	vs_putu(o, total);
+	vs_puts(o, " p50<=");
+	vs_putu(o, vs_pct(c, total, 50));
+	vs_puts(o, unit);
+	vs_puts(o, " p99<=");
+	vs_putu(o, vs_pct(c, total, 99));
+	vs_puts(o, unit);
+	vs_puts(o, " |");
+	for (i = 0; i < VS_BUCKETS; i++) {
+		if (c[i] == 0)
+			continue;
+		vs_puts(o, " <");
+		vs_putu(o, i == 0 ? 1 : 1ul << i);
+		vs_puts(o, ":");
+		vs_putu(o, c[i]);
+	}
+	vs_puts(o, "\n");
+}
+
+static void
+vs_flush(struct vs_buf *o)
+{
+	ssize_t w;
+	size_t off = 0;
+
+	while (off < o->n && (w = write(2, o->b + off, o->n - off)) > 0)
+		off += (size_t)w;
+	o->n = 0;
+}
+
+static void
+vs_dump_pool(struct vs_buf *o)
+{
+	struct akpool_stats ps;
+
+	if (rumpuser_akuma_pool_stats(&ps) != 0)
+		return;
+	vs_puts(o, "[POOL] ");
+	vs_puts(o, ps.enabled ? "on" : "off (RUMPUSER_POOL=0)");
+	vs_puts(o, " allocs=");
+	vs_putu(o, ps.allocs);
+	vs_puts(o, " frees=");
+	vs_putu(o, ps.frees);
+	vs_puts(o, " libc=");
+	vs_putu(o, ps.libc_allocs);
+	vs_puts(o, "/");
+	vs_putu(o, ps.libc_frees);
+	vs_puts(o, " arenas=");
+	vs_putu(o, ps.arenas);
+	vs_puts(o, " (");
+	vs_putu(o, ps.arena_bytes >> 10);
+	vs_puts(o, " KB, ");
+	vs_putu(o, ps.huge);
+	vs_puts(o, " huge) slabs=");
+	vs_putu(o, ps.slab_bytes >> 10);
+	vs_puts(o, " KB inuse=");
+	vs_putu(o, ps.inuse_bytes >> 10);
+	vs_puts(o, " KB (hiwat ");
+	vs_putu(o, ps.inuse_hiwat >> 10);
+	vs_puts(o, " KB)\n");
+	vs_put_hist(o, "pool_lat", ps.lat_ns, "ns");
+	vs_flush(o);
+}
+
+/* Everything but the totals line (virtif_dump_stats prints that), with rates
+ * since the previous call. */
+static void
+vs_dump(void)
+{
+	static uint64_t last_us;
+	static unsigned long last_tx_pkts, last_tx_bytes, last_rx_pkts, last_rx_bytes;
+	struct vs_buf o = { .n = 0 };
+	uint64_t now = vs_now_us();
+	unsigned long txp = VS_GET(tx_pkts), txb = VS_GET(tx_bytes);
+	unsigned long rxp = VS_GET(rx_pkts), rxb = VS_GET(rx_bytes);
+	unsigned long ms = last_us ? (unsigned long)((now - last_us) / 1000) : 0;
+
+	vs_puts(&o, "[VIRTIF RATE] over ");
+	vs_putu(&o, ms);
+	vs_puts(&o, " ms: tx ");
+	vs_putu(&o, ms ? (txp - last_tx_pkts) * 1000 / ms : 0);
+	vs_puts(&o, " pkt/s ");
+	vs_putu(&o, ms ? (txb - last_tx_bytes) / ms : 0);
+	vs_puts(&o, " KB/s  rx ");
+	vs_putu(&o, ms ? (rxp - last_rx_pkts) * 1000 / ms : 0);
+	vs_puts(&o, " pkt/s ");
+	vs_putu(&o, ms ? (rxb - last_rx_bytes) / ms : 0);
+	vs_puts(&o, " KB/s\n[VIRTIF CNT] rx_eagain=");
+	vs_putu(&o, VS_GET(rx_eagain));
+	vs_puts(&o, " rx_waits=");
+	vs_putu(&o, VS_GET(rx_waits));
+	vs_puts(&o, " tx_drops=");
+	vs_putu(&o, VS_GET(tx_drops));
+	vs_puts(&o, " tx_errs=");
+	vs_putu(&o, VS_GET(tx_errs));
+	vs_puts(&o, " rx_errs=");
+	vs_putu(&o, VS_GET(rx_errs));
+	vs_puts(&o, " rx_gro=");
+	vs_putu(&o, VS_GET(rx_gro_pkts));
+	vs_puts(&o, "/");
+	vs_putu(&o, VS_GET(rx_gro_segs));
+	vs_puts(&o, "\n");
+	vs_flush(&o);
+	vs_put_hist(&o, "rx_lat  ", vs.rx_lat, "us");
+	vs_put_hist(&o, "tx_lat  ", vs.tx_lat, "us");
+	vs_put_hist(&o, "rx_batch", vs.rx_batch, "");
+	vs_flush(&o);
+	vs_dump_pool(&o);
+
+	last_us = now;
+	last_tx_pkts = txp;
+	last_tx_bytes = txb;
+	last_rx_pkts = rxp;
+	last_rx_bytes = rxb;
+}
+
+static void
+vs_signal(int sig)
+{
+	struct vs_buf o = { .n = 0 };
+	int saved = errno;
+
+	(void)sig;
+	vs_puts(&o, "[VIRTIF STATS] tx=");
+	vs_putu(&o, VS_GET(tx_pkts));
+	vs_puts(&o, " pkts/");
+	vs_putu(&o, VS_GET(tx_bytes));
+	vs_puts(&o, " bytes  rx=");
+	vs_putu(&o, VS_GET(rx_pkts));
+	vs_puts(&o, " pkts/");
+	vs_putu(&o, VS_GET(rx_bytes));
+	vs_puts(&o, " bytes\n");
+	vs_flush(&o);
+	vs_dump();
+	errno = saved;
+}
+
+static void
+vs_install_signal(void)
+{
+	struct sigaction sa, old;
+
+	if (sigaction(SIGUSR1, NULL, &old) == 0 && old.sa_handler == SIG_DFL) {
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = vs_signal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		(void)sigaction(SIGUSR1, &sa, NULL);
+	}
+}
+
+#endif /* VIRTIF_STATS_H */
@@ -7,7 +7,8 @@
  * and every frame off the wire passes through the rcvthread → VIF_DELIVERPKT (RX).
  * smoltcp has no virtif, so a packet counted here DID go through the rump stack.
  *
- * Added (vs. stock): global TX/RX packet+byte counters, an optional per-packet
+ * Added (vs. stock): TX/RX counters, latency/batch histograms and a SIGUSR1
+ * dump (virtif_stats.h, shared with rumpcomp_tap.c), an optional per-packet
  * Ethernet-header log (env RUMP_VIRTIF_TRACE=1), and an exported
  * virtif_dump_stats() the demo/shim calls at exit. Kept otherwise verbatim so it
  * stays a faithful stand-in for the stock backend.
@@ -37,13 +38,13 @@
 
 #include "if_virt.h"
 #include "virtif_user.h"
+#include "virtif_stats.h"
 
 #if VIFHYPER_REVISION != 20140313
 #error VIFHYPER_REVISION mismatch
 #endif
 
 /* ── instrumentation ─────────────────────────────────────────────────────── */
-static volatile unsigned long g_tx_pkts, g_tx_bytes, g_rx_pkts, g_rx_bytes;
 static int g_trace = -1;
 
 static void
@@ -83,10 +84,11 @@ virtif_dump_stats(void)
 	fprintf(stderr,
 	    "[VIRTIF STATS] tx=%lu pkts/%lu bytes  rx=%lu pkts/%lu bytes "
 	    "(all carried by the NetBSD rump stack, not smoltcp)\n",
-	    g_tx_pkts, g_tx_bytes, g_rx_pkts, g_rx_bytes);
+	    VS_GET(tx_pkts), VS_GET(tx_bytes), VS_GET(rx_pkts), VS_GET(rx_bytes));
+	vs_dump();
 }
 
-/* ── stock backend (verbatim, with the two count/log hooks) ──────────────── */
+/* ── stock backend (verbatim, with the count/log/timing hooks) ───────────── */
 struct virtif_user {
 	struct virtif_sc *viu_virtifsc;
 	int viu_devnum;
@@ -145,6 +147,7 @@ rcvthread(void *aaargh)
 	struct pollfd pfd[2];
 	struct iovec iov;
 	ssize_t nn = 0;
+	uint64_t t0;
 	int prv;
 
 	rumpuser_component_kthread();
@@ -168,9 +171,12 @@ rcvthread(void *aaargh)
 			continue;
 
 		nn = read(viu->viu_fd, viu->viu_rcvbuf, sizeof(viu->viu_rcvbuf));
-		if (nn == -1 && errno == EAGAIN)
+		if (nn == -1 && errno == EAGAIN) {
+			VS_INC(rx_eagain);
 			continue;
+		}
 		if (nn < 1) {
+			VS_INC(rx_errs);
 			fprintf(stderr, "virt%d: receive failed\n",
 			    viu->viu_devnum);
 			sleep(1);
@@ -180,14 +186,17 @@ rcvthread(void *aaargh)
 		iov.iov_len = nn;
 
 		/* INSTRUMENT: RX — a frame off the wire into the NetBSD stack. */
-		g_rx_pkts++;
-		g_rx_bytes += (unsigned long)nn;
+		t0 = vs_now_us();
+		VS_INC(rx_pkts);
+		VS_ADD(rx_bytes, (unsigned long)nn);
 		if (g_trace == 1)
-			log_frame("RX", &iov, 1, g_rx_pkts);
+			log_frame("RX", &iov, 1, VS_GET(rx_pkts));
 
 		rumpuser_component_schedule(NULL);
 		VIF_DELIVERPKT(viu->viu_virtifsc, &iov, 1);
 		rumpuser_component_unschedule();
+		vs_hist(vs.rx_lat, vs_now_us() - t0);
+		vs_hist(vs.rx_batch, 1);
 	}
 
 	assert(viu->viu_dying);
@@ -205,6 +214,7 @@ VIFHYPER_CREATE(const char *devstr, struct virtif_sc *vif_sc, uint8_t *enaddr,
 	int rv;
 
 	trace_init();
+	vs_install_signal();
 	cookie = rumpuser_component_unschedule();
 
 	devnum = atoi(devstr);
@@ -251,18 +261,20 @@ void
 VIFHYPER_SEND(struct virtif_user *viu, struct iovec *iov, size_t iovlen)
 {
 	void *cookie = rumpuser_component_unschedule();
-	ssize_t idontcare __attribute__((__unused__));
+	uint64_t t0 = vs_now_us();
 	size_t i, total = 0;
 
 	/* INSTRUMENT: TX — a frame the NetBSD stack is putting on the wire. */
 	for (i = 0; i < iovlen; i++)
 		total += iov[i].iov_len;
-	g_tx_pkts++;
-	g_tx_bytes += (unsigned long)total;
+	VS_INC(tx_pkts);
+	VS_ADD(tx_bytes, (unsigned long)total);
 	if (g_trace == 1)
-		log_frame("TX", iov, iovlen, g_tx_pkts);
+		log_frame("TX", iov, iovlen, VS_GET(tx_pkts));
 
-	idontcare = writev(viu->viu_fd, iov, iovlen);
+	if (writev(viu->viu_fd, iov, iovlen) == -1)
+		VS_INC(tx_errs);
+	vs_hist(vs.tx_lat, vs_now_us() - t0);
 
 	rumpuser_component_schedule(cookie);
 }
@@ -7,12 +7,14 @@ fn main() {
     let manifest_dir = PathBuf::from(env::var("CARGO_MANIFEST_DIR").unwrap());
     let go_src = manifest_dir.join("go");
     let c_src = manifest_dir.join("c/main.c");
+    let cshim = manifest_dir.join("../cshim");
     let out_dir = manifest_dir.join("../../bootstrap/bin");
 
     println!("cargo:rerun-if-changed=go/main.go");
     println!("cargo:rerun-if-changed=go/stp_arm64.s");
     println!("cargo:rerun-if-changed=go/go.mod");
     println!("cargo:rerun-if-changed=c/main.c");
+    println!("cargo:rerun-if-changed=../cshim/akuma_timing.h");
     println!("cargo:rerun-if-changed=build.rs");
 
     if !out_dir.exists() {
@@ -39,7 +41,10 @@ fn main() {
     // Build C binary
     println!("cargo:warning=Building stp_test C binary...");
     let c_status = Command::new("aarch64-linux-musl-gcc")
-        .args(["-static", "-O2", "-o"])
+        .args(["-static", "-O2"])
+        .arg("-I")
+        .arg(&cshim)
+        .arg("-o")
         .arg(out_dir.join("stp_test_c"))
         .arg(&c_src)
         .status()
@@ -5,13 +5,22 @@
  * each test mmaps a PROT_NONE region then executes a specific stp xzr, xzr
  * variant against it. The kernel must demand-page the target and emulate the
  * store. Without the fix the process crashes with SIGSEGV.
+ *
+ * stp_test_c -bench[=N] instead times N iterations of a null syscall, of
+ * `dc zva` and of `stp xzr, xzr` over fresh anonymous memory, and reads
+ * /proc/self/emulation before and after, so the cost of one emulated
+ * instruction can be read off against the plain SVC round trip.
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include "akuma_timing.h"
+
 #define PAGE 4096
 
 static int test_stp(const char *name, int offset_bytes)
@@ -89,10 +98,122 @@ static int test_stp_imm(const char *name, void *base, int imm_offset)
     }
 }
 
-int main(void)
+/* ---- -bench ------------------------------------------------------------ */
+
+#define BENCH_REGION (1 << 20)
+
+/* Counters from /proc/self/emulation; -1 when the file is missing (Linux). */
+struct emu {
+    long long dc_zva, stp_xzr, prefaulted;
+};
+
+static void read_emulation(struct emu *e)
+{
+    char name[64];
+    long long v;
+    FILE *f = fopen("/proc/self/emulation", "r");
+
+    e->dc_zva = e->stp_xzr = e->prefaulted = -1;
+    if (!f)
+        return;
+    e->dc_zva = e->stp_xzr = e->prefaulted = 0;
+    while (fscanf(f, "%63s %lld", name, &v) == 2) {
+        if (!strncmp(name, "dc_zva_", 7))
+            e->dc_zva += v;
+        else if (!strcmp(name, "stp_xzr_misrouted"))
+            e->stp_xzr = v;
+        else if (!strcmp(name, "pages_prefaulted"))
+            e->prefaulted = v;
+    }
+    fclose(f);
+}
+
+static void report(const char *name, const struct akt_hist *h, long long emulated,
+                   const struct emu *a, const struct emu *b)
+{
+    akt_hist_print(h, name, printf);
+    if (emulated < 0) {
+        printf("  (no /proc/self/emulation)\n");
+        return;
+    }
+    printf("  emulated=%lld prefaulted=%lld", emulated, b->prefaulted - a->prefaulted);
+    if (emulated > 0)
+        printf(" ns/emulated=%llu", h->sum / (unsigned long long)emulated);
+    printf("\n");
+}
+
+static uint8_t *fresh_region(void)
+{
+    uint8_t *p = mmap(NULL, BENCH_REGION, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static int bench(long iters)
+{
+    struct akt_hist h;
+    struct emu a, b;
+    uint64_t dczid;
+    size_t zva, off;
+    uint8_t *p;
+    long i;
+
+    akt_init();
+    printf("stp_test C: bench iters=%ld clock=%s\n", iters, akt_source_name());
+
+    /* Baseline: the SVC round trip every emulated instruction pays */
+    akt_hist_init(&h);
+    for (i = 0; i < iters; i++) {
+        akt_u64 t0 = akt_now();
+        syscall(SYS_getppid);
+        akt_hist_add(&h, akt_to_ns(akt_now() - t0));
+    }
+    akt_hist_print(&h, "null_syscall_ns", printf);
+
+    /* dc zva: DCZID_EL0.BS is log2 of the block size in words, DZP forbids it */
+    __asm__ volatile("mrs %0, dczid_el0" : "=r"(dczid));
+    if (dczid & 16) {
+        printf("dc_zva_ns skipped (DCZID_EL0.DZP set)\n");
+    } else {
+        zva = (size_t)4 << (dczid & 15);
+        if (!(p = fresh_region()))
+            return 1;
+        akt_hist_init(&h);
+        read_emulation(&a);
+        for (i = 0, off = 0; i < iters; i++, off = (off + zva) % BENCH_REGION) {
+            akt_u64 t0 = akt_now();
+            __asm__ volatile("dc zva, %0" : : "r"(p + off) : "memory");
+            akt_hist_add(&h, akt_to_ns(akt_now() - t0));
+        }
+        read_emulation(&b);
+        munmap(p, BENCH_REGION);
+        report("dc_zva_ns", &h, a.dc_zva < 0 ? -1 : b.dc_zva - a.dc_zva, &a, &b);
+    }
+
+    /* stp xzr, xzr: only reaches the kernel when TCG misroutes it */
+    if (!(p = fresh_region()))
+        return 1;
+    akt_hist_init(&h);
+    read_emulation(&a);
+    for (i = 0, off = 0; i < iters; i++, off = (off + 16) % BENCH_REGION) {
+        akt_u64 t0 = akt_now();
+        __asm__ volatile("stp xzr, xzr, [%0]" : : "r"(p + off) : "memory");
+        akt_hist_add(&h, akt_to_ns(akt_now() - t0));
+    }
+    read_emulation(&b);
+    munmap(p, BENCH_REGION);
+    report("stp_xzr_ns", &h, a.stp_xzr < 0 ? -1 : b.stp_xzr - a.stp_xzr, &a, &b);
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
     int pass = 1;
 
+    if (argc > 1 && !strncmp(argv[1], "-bench", 6)) {
+        long iters = argv[1][6] == '=' ? atol(argv[1] + 7) : 100000;
+        return bench(iters > 0 ? iters : 100000);
+    }
+
     /* Test 1: stp xzr, xzr, [x0] on PROT_NONE page */
     pass &= test_stp("offset=0", 0);
 
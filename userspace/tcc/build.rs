@@ -48,8 +48,9 @@ fn main() {
     println!("cargo:rerun-if-changed=tinycc/tcc.c");
     println!("cargo:rerun-if-changed=tinycc/libtcc.c");
     println!("cargo:rerun-if-changed=src/libc_stubs.c");
-    println!("cargo:rerun-if-changed=src/setjmp.S");
+    println!("cargo:rerun-if-changed=src/runsyms.c");
     println!("cargo:rerun-if-changed=src/config.h");
+    println!("cargo:rerun-if-changed=../cshim");
 
     let manifest_dir = PathBuf::from(env::var("CARGO_MANIFEST_DIR").unwrap());
     let out_dir = PathBuf::from(env::var("OUT_DIR").unwrap());
@@ -75,6 +76,28 @@ fn main() {
         );
     }
 
+    // Shared freestanding routines (userspace/cshim). Always -O2, unlike the
+    // size-tuned compiler build below: tcc's symbol hashing and buffer growth
+    // run through the string and memory routines, qsort orders its symbol
+    // and section tables at link time, and every diagnostic and generated
+    // name is formatted by printf.c (whose %f/%e/%g, like tcc's parsing of
+    // float constants via strtod, is dtoa.c).
+    cc::Build::new()
+        .file("../cshim/mem.c")
+        .file("../cshim/string.c")
+        .file("../cshim/qsort.c")
+        .file("../cshim/dtoa.c")
+        .file("../cshim/printf.c")
+        .include("../cshim")
+        .flag("-ffreestanding")
+        .flag("-fno-builtin")
+        .flag("-nostdinc")
+        .opt_level(2)
+        .target(&target)
+        .host(&host)
+        .out_dir(&out_dir)
+        .compile("cshim");
+
     // 1. Build TCC compiler itself
     let mut build = cc::Build::new();
     build
@@ -113,8 +136,12 @@ fn main() {
     build
         .file("tinycc/tcc.c")
         .file("src/libc_stubs.c")
-        .file("src/setjmp.S")
+        .file("src/runsyms.c")
+        // Shared with qjs
+        .file("../cshim/setjmp.S")
         .define("main", "tcc_main")
+        // exit() must flush the buffered FILE streams first (see tcc_exit)
+        .define("exit", "tcc_exit")
         .compile("tcc_all_objs");
 
     println!("cargo:rustc-link-search=native={}", out_dir.display());
@@ -144,6 +171,9 @@ fn main() {
     let musl_inc = musl_include.to_str().unwrap();
     run_cc("tinycc/lib/libtcc1.c", "libtcc1_base.o", &["-I", "tinycc", "-I", "tinycc/include", "-I", musl_inc]);
     run_cc("tinycc/lib/lib-arm64.c", "lib-arm64.o", &["-D__arm64_clear_cache=__clear_cache", "-I", "tinycc", "-I", "tinycc/include", "-I", musl_inc]);
+    // tcc has no arm64 inline asm: akuma_timing.h's counter reads and raw prctl
+    // come out of line from libtcc1.a, built from the header itself.
+    run_cc("../cshim/akuma_timing.h", "akuma_timing.o", &["-x", "c", "-DAKT_OUT_OF_LINE"]);
 
     // Create archives manually
     let find_tool = |name: &str| {
@@ -184,12 +214,16 @@ fn main() {
         }
     };
 
-    run_ar(&out_dir.join("libtcc1.a"), &[&out_dir.join("libtcc1_base.o"), &out_dir.join("lib-arm64.o")]);
+    run_ar(
+        &out_dir.join("libtcc1.a"),
+        &[&out_dir.join("libtcc1_base.o"), &out_dir.join("lib-arm64.o"), &out_dir.join("akuma_timing.o")],
+    );
 
     // 3. Stage + pack libtcc1.tar — the ONLY sysroot artifact we ship.
     //
     // It carries tcc's compiler-helper archive (libtcc1.a) AND tcc's internal
-    // headers (tccdefs.h, stddef.h, stdarg.h, …). Combined with `apk add
+    // headers (tccdefs.h, stddef.h, stdarg.h, …) plus cshim's akuma_timing.h,
+    // so `#include <akuma_timing.h>` works in any tcc build. Combined with `apk add
     // musl-dev` on Akuma — which provides crt1.o/crti.o/crtn.o, libc.a and the
     // POSIX headers — this is everything our tcc needs. We deliberately no
     // longer build or ship a full musl sysroot (the old libc.tar); musl is
@@ -203,6 +237,7 @@ fn main() {
     fs::create_dir_all(&libtcc1_inc_dir).unwrap();
     fs::copy(out_dir.join("libtcc1.a"), libtcc1_tcc_dir.join("libtcc1.a")).unwrap();
     copy_dir_recursive(Path::new("tinycc/include"), &libtcc1_inc_dir).unwrap();
+    fs::copy("../cshim/akuma_timing.h", libtcc1_inc_dir.join("akuma_timing.h")).unwrap();
 
     let libtcc1_archive_path = out_dir.join("libtcc1.tar");
     let status = Command::new("tar")
@@ -0,0 +1,68 @@
+/*
+ * Writes a 20-object program for timing tcc's link step:
+ *
+ *   tcc -run /link_bench.c  # lb00.c .. lb19.c in the working directory
+ *   tcc -c lb*.c
+ *   tcc -bench -o lb lb*.o
+ *
+ * lb00.c holds main. Every file calls the next one and a different part of
+ * libc, so the link pulls a spread of members out of libc.a rather than
+ * just printf's. build.sh --with-bench copies this file to /link_bench.c.
+ */
+#include <stdio.h>
+
+#define FILES 20
+
+static const char *const uses[FILES] = {
+    "printf(\"%d\\n\", x)",
+    "(int)strlen(\"link\")",
+    "atoi(\"42\")",
+    "(int)strtol(\"7f\", 0, 16)",
+    "({ char b[32]; snprintf(b, sizeof b, \"%x\", x); b[0]; })",
+    "({ int v[4] = {3, 1, 2, 0}; qsort(v, 4, sizeof v[0], cmp); v[0]; })",
+    "({ void *p = malloc(64); free(p); p != 0; })",
+    "(int)time(0) & 1",
+    "getenv(\"HOME\") != 0",
+    "({ FILE *f = fopen(\"/dev/null\", \"r\"); if (f) fclose(f); f != 0; })",
+    "(int)(strchr(\"abc\", 'c') - \"abc\")",
+    "memcmp(\"ab\", \"ac\", 2) < 0",
+    "(int)(strtod(\"2.5\", 0) * 2)",
+    "({ char b[8]; memset(b, 1, sizeof b); b[7]; })",
+    "isalpha('q') != 0",
+    "abs(-x)",
+    "({ char *s = strdup(\"dup\"); int c = s[0]; free(s); c; })",
+    "(int)(sqrt(16.0))",
+    "({ struct tm t = {0}; (int)mktime(&t) & 1; })",
+    "(fputs(\"\", stderr), 0)",
+};
+
+int main(void)
+{
+    char name[16];
+    int i;
+
+    for (i = 0; i < FILES; i++) {
+        FILE *f;
+
+        snprintf(name, sizeof name, "lb%02d.c", i);
+        f = fopen(name, "w");
+        if (!f) {
+            printf("gen: cannot write %s\n", name);
+            return 1;
+        }
+        fprintf(f, "#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n"
+                   "#include <ctype.h>\n#include <math.h>\n#include <time.h>\n\n");
+        fprintf(f, "static int cmp(const void *a, const void *b) { return *(int *)a - *(int *)b; }\n");
+        if (i + 1 < FILES)
+            fprintf(f, "int lb%02d(int x);\n", i + 1);
+        fprintf(f, "int lb%02d(int x)\n{\n    int r = %s;\n", i, uses[i]);
+        if (i + 1 < FILES)
+            fprintf(f, "    r += lb%02d(x + 1);\n", i + 1);
+        fprintf(f, "    return r;\n}\n");
+        if (i == 0)
+            fprintf(f, "\nint main(void)\n{\n    return lb00(1) == 0;\n}\n");
+        fclose(f);
+    }
+    printf("gen: wrote lb00.c .. lb%02d.c\n", FILES - 1);
+    return 0;
+}
@@ -0,0 +1,474 @@
+//! Link-order index for static archives (`libc.a`, `libtcc1.a`)
+//!
+//! tcc links an archive by scanning its symbol table (the `/` member that
+//! ranlib writes) for names still undefined, loading the member that
+//! defines each one, and scanning again until a pass loads nothing. What a
+//! loaded member references is only found by the next pass if its definer
+//! is listed earlier in the table, so each step of a chain like `printf` ->
+//! `vfprintf` -> `__stdio_write` that runs backwards in the archive costs
+//! another scan of all of musl's symbols.
+//!
+//! The archive is read out of a mapping (see `MappedInput`), and the shim
+//! serves tcc the same symbol table with its entries in dependency order
+//! instead, as `lorder | tsort` did for one-pass linkers: each member comes
+//! before the members that define what it references, so one pass loads
+//! the whole closure and the next finds nothing left. The table has the same
+//! entries and size, only permuted; member data is untouched. Members that
+//! reference each other in a cycle cannot all come first, but are ordered
+//! so that only the references closing a cycle point backwards. A symbol
+//! defined by several members keeps its definers in archive order, so tcc
+//! still picks the same definition.
+//!
+//! Building the order reads the ELF symbol table of every member, paging in
+//! the whole archive, so it is kept in `INDEX_DIR` under a hash of the path
+//! and reused while the archive's inode, size and mtime are unchanged:
+//!
+//! ```text
+//! "TCCA1\n"
+//! "<ino> <size> <mtime> <mtime_nsec> <table offset>\n"
+//! reordered symbol table bytes...
+//! ```
+//!
+//! `-fno-archive-index` serves the archive's own table, for comparing link
+//! times.
+
+use alloc::collections::{BTreeMap, BinaryHeap};
+use alloc::vec::Vec;
+use core::cmp::Reverse;
+
+use libakuma::Stat;
+
+use crate::header_cache::{read_file, write_file};
+
+const MAGIC: &[u8] = b"TCCA1\n";
+/// Where indexes are kept, one file per archive
+const INDEX_DIR: &str = "/var/cache/tcc/ar";
+
+const AR_MAGIC: &[u8] = b"!<arch>\n";
+const AR_HEADER_SIZE: usize = 60;
+const SHT_SYMTAB: u32 = 2;
+const STB_GLOBAL: u8 = 1;
+const STB_WEAK: u8 = 2;
+
+static mut ENABLED: bool = true;
+
+/// Indexes read from INDEX_DIR and built from the archive (printed with
+/// `-vv`)
+pub static mut INDEXES_LOADED: usize = 0;
+pub static mut INDEXES_BUILT: usize = 0;
+
+/// `-fno-archive-index`
+pub fn disable() {
+    unsafe { ENABLED = false };
+}
+
+/// The reordered symbol table of an archive, served in place of its own
+pub struct Armap {
+    /// File offset of the table's data
+    offset: usize,
+    bytes: Vec<u8>,
+}
+
+impl Armap {
+    /// Overwrite the part of `buf`, just read from file offset `pos`, that
+    /// falls inside the table
+    pub fn patch(&self, pos: usize, buf: &mut [u8]) {
+        let start = pos.max(self.offset);
+        let end = (pos + buf.len()).min(self.offset + self.bytes.len());
+        if start < end {
+            buf[start - pos..end - pos].copy_from_slice(&self.bytes[start - self.offset..end - self.offset]);
+        }
+    }
+}
+
+/// The table to serve for the archive `path`, whose contents are `data`:
+/// from its index, or built now and stored. None for other files, archives
+/// without a symbol table, or with the index disabled.
+pub fn load(path: &str, stat: &Stat, data: &[u8]) -> Option<Armap> {
+    if unsafe { !ENABLED } || !path.ends_with(".a") {
+        return None;
+    }
+    let (offset, table, entry) = symbol_table(data)?;
+    let key = alloc::format!(
+        "{} {} {} {} {}\n",
+        stat.st_ino, stat.st_size, stat.st_mtime, stat.st_mtime_nsec, offset
+    );
+    let file = alloc::format!("{}/{:016x}.tcca", INDEX_DIR, fnv(path.as_bytes()));
+    if let Some(mut cached) = read_file(&file) {
+        let header = MAGIC.len() + key.len();
+        if cached.len() == header + table.len()
+            && cached.starts_with(MAGIC)
+            && &cached[MAGIC.len()..header] == key.as_bytes()
+        {
+            cached.drain(..header);
+            unsafe { INDEXES_LOADED += 1 };
+            return Some(Armap { offset, bytes: cached });
+        }
+    }
+    let bytes = reorder(data, table, entry)?;
+    unsafe { INDEXES_BUILT += 1 };
+    store(&file, &key, &bytes);
+    Some(Armap { offset, bytes })
+}
+
+/// Write an index to a temporary name and rename it, as the header cache
+/// does; failures only cost rebuilding it next time
+fn store(file: &str, key: &str, bytes: &[u8]) {
+    if !libakuma::mkdir_p(INDEX_DIR) {
+        return;
+    }
+    let mut data = Vec::with_capacity(MAGIC.len() + key.len() + bytes.len());
+    data.extend_from_slice(MAGIC);
+    data.extend_from_slice(key.as_bytes());
+    data.extend_from_slice(bytes);
+    let tmp = alloc::format!("{}.{}.tmp", file, libakuma::getpid());
+    if write_file(&tmp, &data) && libakuma::rename(&tmp, file) < 0 {
+        libakuma::unlink(&tmp);
+    }
+}
+
+/// The data offset and bytes of the archive's symbol table (the first
+/// member, `/` or `/SYM64/`), with its entry size
+fn symbol_table(data: &[u8]) -> Option<(usize, &[u8], usize)> {
+    if !data.starts_with(AR_MAGIC) {
+        return None;
+    }
+    let header = data.get(AR_MAGIC.len()..AR_MAGIC.len() + AR_HEADER_SIZE)?;
+    let entry = match trim(&header[..16]) {
+        b"/" => 4,
+        b"/SYM64/" => 8,
+        _ => return None,
+    };
+    let offset = AR_MAGIC.len() + AR_HEADER_SIZE;
+    let size = member_size(header)?;
+    Some((offset, data.get(offset..offset.checked_add(size)?)?, entry))
+}
+
+/// The data size in an ar member header
+fn member_size(header: &[u8]) -> Option<usize> {
+    if &header[58..60] != b"`\n" {
+        return None;
+    }
+    core::str::from_utf8(trim(&header[48..58])).ok()?.parse().ok()
+}
+
+fn trim(field: &[u8]) -> &[u8] {
+    let end = field.iter().rposition(|&b| b != b' ').map_or(0, |p| p + 1);
+    &field[..end]
+}
+
+fn be(bytes: &[u8]) -> usize {
+    bytes.iter().fold(0, |v, &b| (v << 8) | b as usize)
+}
+
+fn le(data: &[u8], at: usize, len: usize) -> Option<usize> {
+    let bytes = data.get(at..at.checked_add(len)?)?;
+    Some(bytes.iter().rev().fold(0, |v, &b| (v << 8) | b as usize))
+}
+
+/// The symbol table with its entries grouped by member, in dependency order
+fn reorder(data: &[u8], table: &[u8], entry: usize) -> Option<Vec<u8>> {
+    // (member header offset, name) of each entry
+    let count = be(table.get(..entry)?);
+    let names_start = count.checked_mul(entry)?.checked_add(entry)?;
+    if names_start > table.len() {
+        return None;
+    }
+    let mut syms = Vec::with_capacity(count);
+    let mut pos = names_start;
+    for i in 0..count {
+        let off = be(&table[entry + i * entry..entry * (i + 2)]);
+        let len = table.get(pos..)?.iter().position(|&b| b == 0)?;
+        syms.push((off, &table[pos..pos + len]));
+        pos += len + 1;
+    }
+    let tail = &table[pos..];
+
+    // Members numbered in order of first appearance
+    let mut member_of = BTreeMap::new();
+    let mut members = Vec::new();
+    for &(off, _) in &syms {
+        member_of.entry(off).or_insert_with(|| {
+            members.push(off);
+            members.len() - 1
+        });
+    }
+    let n = members.len();
+    let mut succ: Vec<Vec<usize>> = alloc::vec![Vec::new(); n];
+
+    // Definers of each name. A later definer must stay after the one before
+    // it (and so after the first, which tcc loads)
+    let mut defs: BTreeMap<&[u8], (usize, usize)> = BTreeMap::new();
+    let mut redefined = Vec::new();
+    for &(off, name) in &syms {
+        let m = member_of[&off];
+        match defs.get_mut(name) {
+            Some((_, last)) => {
+                if *last != m {
+                    succ[*last].push(m);
+                    redefined.push((*last, m));
+                    *last = m;
+                }
+            }
+            None => {
+                defs.insert(name, (m, m));
+            }
+        }
+    }
+
+    // A member before the first definer of each name it leaves undefined
+    for (m, &off) in members.iter().enumerate() {
+        let header = data.get(off..off.checked_add(AR_HEADER_SIZE)?)?;
+        let start = off + AR_HEADER_SIZE;
+        let object = data.get(start..start.checked_add(member_size(header)?)?)?;
+        let _ = undefined_symbols(object, |name| {
+            if let Some(&(first, _)) = defs.get(name) {
+                if first != m {
+                    succ[m].push(first);
+                }
+            }
+        });
+    }
+
+    // Members that reference each other (strongly connected components)
+    // cannot all come first. The components go in dependency order, the one
+    // with the lowest archive position first among those ready, which keeps
+    // unrelated members where they were; see `cycle_order` for the members
+    // of one.
+    for s in succ.iter_mut() {
+        s.sort_unstable();
+        s.dedup();
+    }
+    let comp = components(&succ);
+    let ncomp = comp.iter().max().map_or(0, |&c| c + 1);
+    let mut members_of: Vec<Vec<usize>> = alloc::vec![Vec::new(); ncomp];
+    let mut indegree = alloc::vec![0usize; ncomp];
+    for m in 0..n {
+        members_of[comp[m]].push(m);
+        for &t in &succ[m] {
+            if comp[t] != comp[m] {
+                indegree[comp[t]] += 1;
+            }
+        }
+    }
+    let mut ready: BinaryHeap<Reverse<(usize, usize)>> = (0..ncomp)
+        .filter(|&c| indegree[c] == 0)
+        .map(|c| Reverse((members_of[c][0], c)))
+        .collect();
+    let mut order = Vec::with_capacity(n);
+    let mut rank = alloc::vec![0usize; n];
+    while let Some(Reverse((_, c))) = ready.pop() {
+        cycle_order(&succ, &comp, c, &members_of[c], &redefined, &mut rank, &mut order);
+        for &m in &members_of[c] {
+            for &t in &succ[m] {
+                let tc = comp[t];
+                if tc != c {
+                    indegree[tc] -= 1;
+                    if indegree[tc] == 0 {
+                        ready.push(Reverse((members_of[tc][0], tc)));
+                    }
+                }
+            }
+        }
+    }
+
+    // The entries of each member keep their relative order
+    for (i, &m) in order.iter().enumerate() {
+        rank[m] = i;
+    }
+    let mut sorted: Vec<usize> = (0..count).collect();
+    sorted.sort_by_key(|&i| rank[member_of[&syms[i].0]]);
+
+    let mut out = Vec::with_capacity(table.len());
+    out.extend_from_slice(&table[..entry]);
+    for &i in &sorted {
+        out.extend_from_slice(&table[entry * (i + 1)..entry * (i + 2)]);
+    }
+    for &i in &sorted {
+        out.extend_from_slice(syms[i].1);
+        out.push(0);
+    }
+    out.extend_from_slice(tail);
+    Some(out)
+}
+
+/// Append the members of component `c` to `order`, in reverse postorder of
+/// a depth-first walk of the component from its first member: only the
+/// edges closing a cycle point backwards then, so most of a cycle is still
+/// loaded in one pass. A later definer of a name (`redefined`) is moved
+/// after the earlier one where the walk put it first. `rank` is scratch
+/// space indexed by member.
+fn cycle_order(
+    succ: &[Vec<usize>],
+    comp: &[usize],
+    c: usize,
+    members: &[usize],
+    redefined: &[(usize, usize)],
+    rank: &mut [usize],
+    order: &mut Vec<usize>,
+) {
+    if members.len() == 1 {
+        order.push(members[0]);
+        return;
+    }
+    // Visited members are marked with a rank of usize::MAX until numbered
+    for &m in members {
+        rank[m] = 0;
+    }
+    let mut post = Vec::with_capacity(members.len());
+    let mut calls: Vec<(usize, usize)> = Vec::new();
+    for &root in members {
+        if rank[root] != 0 {
+            continue;
+        }
+        rank[root] = usize::MAX;
+        calls.push((root, 0));
+        while let Some(top) = calls.last_mut() {
+            let v = top.0;
+            if let Some(&w) = succ[v].get(top.1) {
+                top.1 += 1;
+                if comp[w] == c && rank[w] == 0 {
+                    rank[w] = usize::MAX;
+                    calls.push((w, 0));
+                }
+                continue;
+            }
+            calls.pop();
+            post.push(v);
+        }
+    }
+    // Then the same order, but each later definer of a name held back until
+    // the one before it is placed
+    let pairs: Vec<(usize, usize)> = redefined
+        .iter()
+        .copied()
+        .filter(|&(a, b)| comp[a] == c && comp[b] == c)
+        .collect();
+    for (i, &m) in post.iter().rev().enumerate() {
+        rank[m] = i;
+    }
+    let mut waiting = alloc::vec![0usize; members.len()];
+    for &(_, b) in &pairs {
+        waiting[rank[b]] += 1;
+    }
+    let mut ready: BinaryHeap<Reverse<usize>> = (0..members.len()).filter(|&r| waiting[r] == 0).map(Reverse).collect();
+    let by_rank: Vec<usize> = post.iter().rev().copied().collect();
+    while let Some(Reverse(r)) = ready.pop() {
+        let m = by_rank[r];
+        order.push(m);
+        for &(a, b) in &pairs {
+            if a == m {
+                waiting[rank[b]] -= 1;
+                if waiting[rank[b]] == 0 {
+                    ready.push(Reverse(rank[b]));
+                }
+            }
+        }
+    }
+}
+
+/// The strongly connected component of each node of the graph `succ`
+/// (Tarjan's algorithm, with an explicit stack instead of recursion)
+fn components(succ: &[Vec<usize>]) -> Vec<usize> {
+    const NONE: usize = usize::MAX;
+    let n = succ.len();
+    let mut index = alloc::vec![NONE; n];
+    let mut low = alloc::vec![0usize; n];
+    let mut on_stack = alloc::vec![false; n];
+    let mut comp = alloc::vec![NONE; n];
+    let mut stack = Vec::new();
+    // (node, next successor to visit)
+    let mut calls: Vec<(usize, usize)> = Vec::new();
+    let mut next = 0;
+    let mut ncomp = 0;
+    for root in 0..n {
+        if index[root] != NONE {
+            continue;
+        }
+        index[root] = next;
+        low[root] = next;
+        next += 1;
+        stack.push(root);
+        on_stack[root] = true;
+        calls.push((root, 0));
+        while let Some(top) = calls.last_mut() {
+            let v = top.0;
+            if let Some(&w) = succ[v].get(top.1) {
+                top.1 += 1;
+                if index[w] == NONE {
+                    index[w] = next;
+                    low[w] = next;
+                    next += 1;
+                    stack.push(w);
+                    on_stack[w] = true;
+                    calls.push((w, 0));
+                } else if on_stack[w] {
+                    low[v] = low[v].min(index[w]);
+                }
+                continue;
+            }
+            calls.pop();
+            if let Some(&(u, _)) = calls.last() {
+                low[u] = low[u].min(low[v]);
+            }
+            if low[v] == index[v] {
+                while let Some(w) = stack.pop() {
+                    on_stack[w] = false;
+                    comp[w] = ncomp;
+                    if w == v {
+                        break;
+                    }
+                }
+                ncomp += 1;
+            }
+        }
+    }
+    comp
+}
+
+/// Call `f` with each global or weak undefined symbol of a 64-bit
+/// little-endian ELF object, stopping at anything malformed
+fn undefined_symbols<'a>(object: &'a [u8], mut f: impl FnMut(&'a [u8])) -> Option<()> {
+    if object.len() < 64 || &object[..4] != b"\x7fELF" || object[4] != 2 || object[5] != 1 {
+        return None;
+    }
+    let shoff = le(object, 0x28, 8)?;
+    let shentsize = le(object, 0x3a, 2)?;
+    let shnum = le(object, 0x3c, 2)?;
+    let section = |i: usize| object.get(shoff.checked_add(i * shentsize)?..).filter(|s| s.len() >= 64);
+    for i in 0..shnum {
+        let sh = section(i)?;
+        if le(sh, 4, 4)? as u32 != SHT_SYMTAB {
+            continue;
+        }
+        let strtab = section(le(sh, 0x28, 4)?)?;
+        let strs = object.get(le(strtab, 0x18, 8)?..)?;
+        let strs = strs.get(..le(strtab, 0x20, 8)?.min(strs.len()))?;
+        let symoff = le(sh, 0x18, 8)?;
+        let entsize = le(sh, 0x38, 8)?;
+        if entsize < 24 {
+            return None;
+        }
+        for s in 0..le(sh, 0x20, 8)? / entsize {
+            let sym = object.get(symoff + s * entsize..symoff + s * entsize + 24)?;
+            let name = le(sym, 0, 4)?;
+            let bind = sym[4] >> 4;
+            if name == 0 || le(sym, 6, 2)? != 0 || (bind != STB_GLOBAL && bind != STB_WEAK) {
+                continue;
+            }
+            let rest = strs.get(name..)?;
+            let len = rest.iter().position(|&b| b == 0)?;
+            f(&rest[..len]);
+        }
+    }
+    Some(())
+}
+
+/// FNV-1a, naming the index file of a path
+fn fnv(bytes: &[u8]) -> u64 {
+    let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+    for &b in bytes {
+        h = (h ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    h
+}
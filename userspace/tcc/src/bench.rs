@@ -0,0 +1,233 @@
+//! Compile statistics for `tcc -bench`
+//!
+//! tcc's own `-bench` summary (identifiers, lines, bytes, seconds) times the
+//! run with `gettimeofday`, which the shim serves from `uptime()`. After it
+//! the shim adds what it sees from outside the compiler:
+//!
+//! - time per phase. tcc preprocesses, parses and generates code in one
+//!   pass, so phases are told apart by what the run opens: sources and
+//!   headers start `compile`, objects, archives and crt files `link`, the
+//!   output file `output`. Time before the first open is `setup`
+//!   (arguments, header cache lookup);
+//! - calls, bytes and time in the I/O shims. Reads served from a mapped
+//!   input (`mapped`) are counted apart: they are copies, not syscalls;
+//! - the peak of live `malloc` bytes (headers and size rounding included)
+//!   and the arena chunks behind the small ones.
+//!
+//! `-bench=json` prints the same as one JSON object on stderr instead, for
+//! collecting runs across kernel versions:
+//!
+//! ```text
+//! {"tcc_bench":1,"ms":41.250,"phases_ms":{"setup":0.310,"compile":35.007,...},
+//!  "calls":{"open":57,...},"io_ms":6.120,"bytes_read":812345,...}
+//! ```
+//!
+//! Timing a shim call costs two `uptime` syscalls, so I/O-heavy runs are
+//! somewhat slower under `-bench`; the counters themselves are always kept.
+
+use alloc::string::String;
+
+use libakuma::{open_flags, uptime};
+
+/// Phases of a run, in the order they usually come
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum Phase {
+    Setup,
+    Compile,
+    Link,
+    Output,
+}
+
+const PHASE_NAMES: [&str; 4] = ["setup", "compile", "link", "output"];
+
+/// Shim calls that are counted
+#[derive(Clone, Copy)]
+pub enum Op {
+    Open,
+    Close,
+    Read,
+    /// A read served from a mapped input
+    Mapped,
+    Write,
+    Lseek,
+    Mmap,
+    Munmap,
+    Stat,
+}
+
+const OP_NAMES: [&str; 9] = ["open", "close", "read", "mapped", "write", "lseek", "mmap", "munmap", "stat"];
+
+struct Stats {
+    enabled: bool,
+    json: bool,
+    start: u64,
+    phase: Phase,
+    phase_start: u64,
+    phase_us: [u64; 4],
+    calls: [u64; 9],
+    io_us: u64,
+    bytes_read: u64,
+    bytes_mapped: u64,
+    bytes_written: u64,
+    live: usize,
+    peak: usize,
+}
+
+static mut STATS: Stats = Stats {
+    enabled: false,
+    json: false,
+    start: 0,
+    phase: Phase::Setup,
+    phase_start: 0,
+    phase_us: [0; 4],
+    calls: [0; 9],
+    io_us: 0,
+    bytes_read: 0,
+    bytes_mapped: 0,
+    bytes_written: 0,
+    live: 0,
+    peak: 0,
+};
+
+fn stats() -> &'static mut Stats {
+    unsafe { &mut *&raw mut STATS }
+}
+
+/// Start collecting (`-bench`; `json` for `-bench=json`)
+pub fn enable(json: bool) {
+    let s = stats();
+    s.enabled = true;
+    s.json = json;
+    s.start = uptime();
+    s.phase_start = s.start;
+}
+
+/// Start timing a shim call: 0 unless benchmarking
+#[inline]
+pub fn begin() -> u64 {
+    if stats().enabled { uptime() } else { 0 }
+}
+
+/// Account a shim call started at `t0` (from `begin`) that moved `bytes`
+#[inline]
+pub fn end(op: Op, t0: u64, bytes: usize) {
+    let s = stats();
+    if !s.enabled {
+        return;
+    }
+    s.io_us += uptime().saturating_sub(t0);
+    count(op, bytes);
+}
+
+/// Account an untimed call (mapped reads)
+#[inline]
+pub fn count(op: Op, bytes: usize) {
+    let s = stats();
+    s.calls[op as usize] += 1;
+    match op {
+        Op::Read => s.bytes_read += bytes as u64,
+        Op::Mapped => s.bytes_mapped += bytes as u64,
+        Op::Write => s.bytes_written += bytes as u64,
+        _ => {}
+    }
+}
+
+/// Called by `open` for each file: move to the phase the file belongs to
+pub fn opening(path: &str, flags: u32) {
+    let s = stats();
+    if !s.enabled {
+        return;
+    }
+    let next = if flags & 3 != open_flags::O_RDONLY {
+        Phase::Output
+    } else if path.ends_with(".o") || path.ends_with(".a") || path.ends_with(".so") || path.contains(".so.") {
+        Phase::Link
+    } else {
+        Phase::Compile
+    };
+    if next != s.phase {
+        let now = uptime();
+        s.phase_us[s.phase as usize] += now.saturating_sub(s.phase_start);
+        s.phase = next;
+        s.phase_start = now;
+    }
+}
+
+/// A block of `bytes` was allocated
+#[inline]
+pub fn allocated(bytes: usize) {
+    let s = stats();
+    s.live += bytes;
+    if s.live > s.peak {
+        s.peak = s.live;
+    }
+}
+
+/// A block of `bytes` was freed
+#[inline]
+pub fn freed(bytes: usize) {
+    let s = stats();
+    s.live = s.live.saturating_sub(bytes);
+}
+
+/// Print the report on stderr if benchmarking (called on exit)
+pub fn report(mallocs: usize, arena_bytes: usize) {
+    let s = stats();
+    if !s.enabled {
+        return;
+    }
+    s.enabled = false;
+    let now = uptime();
+    s.phase_us[s.phase as usize] += now.saturating_sub(s.phase_start);
+    let total = now.saturating_sub(s.start);
+
+    let mut out = String::new();
+    if s.json {
+        out.push_str(&alloc::format!("{{\"tcc_bench\":1,\"ms\":{},\"phases_ms\":{{", ms(total)));
+        for (i, name) in PHASE_NAMES.iter().enumerate() {
+            let sep = if i == 0 { "" } else { "," };
+            out.push_str(&alloc::format!("{}\"{}\":{}", sep, name, ms(s.phase_us[i])));
+        }
+        out.push_str("},\"calls\":{");
+        for (i, name) in OP_NAMES.iter().enumerate() {
+            let sep = if i == 0 { "" } else { "," };
+            out.push_str(&alloc::format!("{}\"{}\":{}", sep, name, s.calls[i]));
+        }
+        out.push_str(&alloc::format!(
+            "}},\"io_ms\":{},\"bytes_read\":{},\"bytes_mapped\":{},\"bytes_written\":{},\
+             \"peak_heap_kb\":{},\"arena_kb\":{},\"mallocs\":{}}}",
+            ms(s.io_us),
+            s.bytes_read,
+            s.bytes_mapped,
+            s.bytes_written,
+            s.peak / 1024,
+            arena_bytes / 1024,
+            mallocs
+        ));
+    } else {
+        out.push_str(&alloc::format!("* shim: {} ms:", ms(total)));
+        for (i, name) in PHASE_NAMES.iter().enumerate() {
+            out.push_str(&alloc::format!(" {} {}", name, ms(s.phase_us[i])));
+        }
+        out.push_str(&alloc::format!("\n* shim: {} ms in I/O calls:", ms(s.io_us)));
+        for (i, name) in OP_NAMES.iter().enumerate() {
+            out.push_str(&alloc::format!(" {} {}", name, s.calls[i]));
+        }
+        out.push_str(&alloc::format!(
+            "\n* shim: read {} KB ({} KB mapped), wrote {} KB\n\
+             * shim: heap peak {} KB, {} KB arena chunks, {} mallocs",
+            s.bytes_read / 1024,
+            s.bytes_mapped / 1024,
+            s.bytes_written / 1024,
+            s.peak / 1024,
+            arena_bytes / 1024,
+            mallocs
+        ));
+    }
+    libakuma::eprintln(&out);
+}
+
+/// Microseconds as milliseconds with three decimals
+fn ms(us: u64) -> String {
+    alloc::format!("{}.{:03}", us / 1000, us % 1000)
+}
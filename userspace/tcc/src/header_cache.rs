@@ -0,0 +1,333 @@
+//! On-disk compile cache for `tcc -c` (`-fheader-cache=DIR`)
+//!
+//! Most of a small compile is spent preprocessing the musl and `tccdefs.h`
+//! headers, so a cached compile skips tcc entirely: every file the compile
+//! opened (its include chain) is recorded by the `open` shim, along with
+//! every include path it probed and did not find, and the resulting object
+//! is stored under a key made of the command line, the working directory
+//! and the tcc version. A later compile with the same key replays the object
+//! if each recorded file still has the same contents and each missing one is
+//! still missing:
+//!
+//! ```text
+//! "TCCH2\n"
+//! "P <size> <mtime> <mtime_nsec> <hash> <path>\n"   file that was read
+//! "A <path>\n"                                      include path probed, absent
+//! "\n"  object bytes...
+//! ```
+//!
+//! A file whose size and mtime are unchanged is taken as unchanged. If only
+//! the mtime differs (a checkout, `touch`, a generator rewriting the same
+//! header) its FNV-1a hash decides, so the compile is still replayed. Given
+//! the same flags and the same bytes in every input, the preprocessed
+//! translation unit is the same, without running the preprocessor again.
+//!
+//! Predefined macros are covered by the key: they come from `-D`/`-U` on
+//! the command line and from the tcc build itself. Only single-source `-c`
+//! compiles are cached; anything else runs tcc as usual. With `-MD` a
+//! replayed compile writes the dependency file tcc would have written, from
+//! the recorded inputs.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use libakuma::{close, fstat, open, open_flags, read_fd, write_fd, Stat};
+
+const MAGIC: &[u8] = b"TCCH2\n";
+
+/// Options whose value is the next argument
+pub const TAKES_ARG: &[&str] = &["-o", "-I", "-D", "-U", "-L", "-l", "-B", "-include", "-isystem", "-x", "-MF"];
+
+/// One input of a compile
+enum Dep {
+    Present { path: String, size: i64, mtime: i64, mtime_nsec: i64 },
+    Absent(String),
+}
+
+impl Dep {
+    fn path(&self) -> &str {
+        match self {
+            Dep::Present { path, .. } | Dep::Absent(path) => path,
+        }
+    }
+}
+
+/// Inputs seen by `open` while recording
+static mut DEPS: Option<Vec<Dep>> = None;
+
+/// A cacheable compile: the cache entry for its command line, the object it
+/// produces and its `-MD` dependency file, if any
+pub struct Plan {
+    dir: String,
+    entry: String,
+    output: String,
+    depfile: Option<String>,
+}
+
+impl Plan {
+    /// The plan for `args` (without `-fheader-cache`), or None if the
+    /// command is not a single-source `-c` compile
+    pub fn new(dir: &str, args: &[&str]) -> Option<Self> {
+        let mut source = None;
+        let mut output = None;
+        let mut compile_only = false;
+        let mut gen_deps = false;
+        let mut depfile = None;
+        let mut i = 1;
+        while i < args.len() {
+            let a = args[i];
+            match a {
+                "-c" => compile_only = true,
+                "-o" => output = args.get(i + 1).copied(),
+                "-MD" => gen_deps = true,
+                "-MF" => depfile = args.get(i + 1).copied(),
+                "-E" | "-run" | "-" => return None,
+                _ if a.starts_with("-M") => return None,
+                _ if !a.starts_with('-') => {
+                    if !a.ends_with(".c") || source.is_some() {
+                        return None;
+                    }
+                    source = Some(a);
+                }
+                _ => {}
+            }
+            i += if TAKES_ARG.contains(&a) { 2 } else { 1 };
+        }
+        let source = source?;
+        if !compile_only {
+            return None;
+        }
+        let output = match output {
+            Some(o) => String::from(o),
+            // tcc names the object after the source, in the working directory
+            None => {
+                let base = &source[source.rfind('/').map_or(0, |p| p + 1)..];
+                alloc::format!("{}.o", &base[..base.len() - 2])
+            }
+        };
+        // As tcc names it: the object with its extension replaced by .d
+        let depfile = match (gen_deps, depfile) {
+            (false, _) => None,
+            (true, Some(d)) => Some(String::from(d)),
+            (true, None) => {
+                let stem = match output.rfind('.') {
+                    Some(p) if !output[p..].contains('/') => &output[..p],
+                    _ => &output,
+                };
+                Some(alloc::format!("{}.d", stem))
+            }
+        };
+
+        let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+        let mut hash = |bytes: &[u8]| {
+            for &b in bytes.iter().chain(b"\0") {
+                h = (h ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+            }
+        };
+        hash(env!("CARGO_PKG_VERSION").as_bytes());
+        hash(libakuma::getcwd().as_bytes());
+        for a in &args[1..] {
+            hash(a.as_bytes());
+        }
+        Some(Plan {
+            dir: String::from(dir),
+            entry: alloc::format!("{}/{:016x}.tcch", dir, h),
+            output,
+            depfile,
+        })
+    }
+
+    /// Write the cached object to the output if the entry is still valid
+    pub fn replay(&self) -> bool {
+        let data = match read_file(&self.entry) {
+            Some(d) => d,
+            None => return false,
+        };
+        let (deps, object) = match check_entry(&data) {
+            Some(e) => e,
+            None => return false,
+        };
+        if let Some(depfile) = &self.depfile {
+            // tcc's gen_makedeps format
+            let mut text = alloc::format!("{}: \\\n", self.output);
+            for path in deps {
+                text.push_str(&alloc::format!(" {} \\\n", path));
+            }
+            text.push('\n');
+            if !write_file(depfile, text.as_bytes()) {
+                return false;
+            }
+        }
+        write_file(&self.output, object)
+    }
+
+    /// Start recording the inputs `open` sees
+    pub fn record(&self) {
+        unsafe { DEPS = Some(Vec::new()) };
+    }
+
+    /// Store the object of a successful compile with its recorded inputs.
+    /// Written to a temporary name and renamed, so a concurrent compile never
+    /// reads a partial entry. Failures are ignored: the cache only saves
+    /// time.
+    pub fn store(&self) {
+        let deps = match unsafe { (*&raw mut DEPS).take() } {
+            Some(d) => d,
+            None => return,
+        };
+        let object = match read_file(&self.output) {
+            Some(o) => o,
+            None => return,
+        };
+        let mut data = Vec::from(MAGIC);
+        for dep in &deps {
+            if dep.path().contains('\n') {
+                return;
+            }
+            let line = match dep {
+                Dep::Present { path, size, mtime, mtime_nsec } => {
+                    // Hashed after the compile: skip storing if the file
+                    // changed meanwhile, the object may be of the old one
+                    let hash = match (hash_file(path), stat_path(path)) {
+                        (Some(h), Some(s))
+                            if s.st_size == *size && s.st_mtime == *mtime && s.st_mtime_nsec == *mtime_nsec =>
+                        {
+                            h
+                        }
+                        _ => return,
+                    };
+                    alloc::format!("P {} {} {} {:016x} {}\n", size, mtime, mtime_nsec, hash, path)
+                }
+                Dep::Absent(path) => alloc::format!("A {}\n", path),
+            };
+            data.extend_from_slice(line.as_bytes());
+        }
+        data.push(b'\n');
+        data.extend_from_slice(&object);
+
+        if !libakuma::mkdir_p(&self.dir) {
+            return;
+        }
+        let tmp = alloc::format!("{}.{}.tmp", self.entry, libakuma::getpid());
+        if write_file(&tmp, &data) && libakuma::rename(&tmp, &self.entry) < 0 {
+            libakuma::unlink(&tmp);
+        }
+    }
+}
+
+/// Called by the `open` shim for each read-only open while recording;
+/// `fd` is negative if the file was not found
+pub fn record_open(path: &str, fd: i32) {
+    let deps = match unsafe { (*&raw mut DEPS).as_mut() } {
+        Some(d) => d,
+        None => return,
+    };
+    if deps.iter().any(|d| d.path() == path) {
+        return;
+    }
+    if fd < 0 {
+        deps.push(Dep::Absent(String::from(path)));
+    } else if let Ok(s) = fstat(fd) {
+        deps.push(Dep::Present {
+            path: String::from(path),
+            size: s.st_size,
+            mtime: s.st_mtime,
+            mtime_nsec: s.st_mtime_nsec,
+        });
+    }
+}
+
+/// The files read and the object of a cache entry, if every input it lists
+/// is unchanged
+fn check_entry(data: &[u8]) -> Option<(Vec<&str>, &[u8])> {
+    let mut rest = data.strip_prefix(MAGIC)?;
+    let mut read = Vec::new();
+    loop {
+        let nl = rest.iter().position(|&b| b == b'\n')?;
+        let line = core::str::from_utf8(&rest[..nl]).ok()?;
+        rest = &rest[nl + 1..];
+        if line.is_empty() {
+            return Some((read, rest));
+        }
+        let (kind, line) = line.split_once(' ')?;
+        match kind {
+            "P" => {
+                let mut f = line.splitn(5, ' ');
+                let size: i64 = f.next()?.parse().ok()?;
+                let mtime: i64 = f.next()?.parse().ok()?;
+                let mtime_nsec: i64 = f.next()?.parse().ok()?;
+                let hash = u64::from_str_radix(f.next()?, 16).ok()?;
+                let path = f.next()?;
+                let s = stat_path(path)?;
+                if s.st_size != size {
+                    return None;
+                }
+                if (s.st_mtime != mtime || s.st_mtime_nsec != mtime_nsec) && hash_file(path)? != hash {
+                    return None;
+                }
+                read.push(path);
+            }
+            "A" => {
+                if stat_path(line).is_some() {
+                    return None;
+                }
+            }
+            _ => return None,
+        }
+    }
+}
+
+fn stat_path(path: &str) -> Option<Stat> {
+    let fd = open(path, open_flags::O_RDONLY);
+    if fd < 0 {
+        return None;
+    }
+    let s = fstat(fd).ok();
+    close(fd);
+    s
+}
+
+/// FNV-1a of a file's contents
+fn hash_file(path: &str) -> Option<u64> {
+    let data = read_file(path)?;
+    let mut h: u64 = 0xcbf2_9ce4_8422_2325;
+    for &b in &data {
+        h = (h ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    Some(h)
+}
+
+pub fn read_file(path: &str) -> Option<Vec<u8>> {
+    let fd = open(path, open_flags::O_RDONLY);
+    if fd < 0 {
+        return None;
+    }
+    let size = fstat(fd).map(|s| s.st_size as usize).unwrap_or(0);
+    let mut data = alloc::vec![0u8; size];
+    let mut done = 0;
+    while done < size {
+        let n = read_fd(fd, &mut data[done..]);
+        if n <= 0 {
+            break;
+        }
+        done += n as usize;
+    }
+    close(fd);
+    if done == size { Some(data) } else { None }
+}
+
+pub fn write_file(path: &str, mut data: &[u8]) -> bool {
+    let fd = open(path, open_flags::O_WRONLY | open_flags::O_CREAT | open_flags::O_TRUNC);
+    if fd < 0 {
+        return false;
+    }
+    while !data.is_empty() {
+        let n = write_fd(fd, data);
+        if n <= 0 {
+            break;
+        }
+        data = &data[n as usize..];
+    }
+    close(fd);
+    data.is_empty()
+}
@@ -4,6 +4,11 @@
 
 extern crate alloc;
 
+mod archive_index;
+mod bench;
+mod header_cache;
+mod parallel;
+
 use alloc::alloc::Layout;
 use core::ffi::{c_char, c_void, c_int};
 use core::ptr;
@@ -11,10 +16,10 @@ use core::ptr;
 use libakuma::{
     close as akuma_close, exit as akuma_exit,
     open as akuma_open, open_flags,
-    read_fd, seek_mode, write_fd,
+    read_fd, seek_mode, write_fd, mmap_flags,
     unlink as akuma_unlink,
     rename as akuma_rename, mkdir as akuma_mkdir, getcwd as akuma_getcwd, Stat,
-    mmap as akuma_mmap, munmap as akuma_munmap,
+    mmap as akuma_mmap, mmap_fd as akuma_mmap_fd, munmap as akuma_munmap,
 };
 
 // ============================================================================
@@ -27,12 +32,52 @@ pub struct timeval {
     tv_usec: i64,
 }
 
+/// Size of each stream's read/write buffer, allocated on first use
+const STDIO_BUF_SIZE: usize = 64 * 1024;
+
+/// Buffer state of a stream
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum BufMode {
+    Idle,
+    /// buf[pos..len] is read ahead of the fd offset
+    Reading,
+    /// buf[..pos] is waiting to be written at the fd offset
+    Writing,
+}
+
 #[repr(C)]
 pub struct FILE {
     fd: i32,
     error: i32,
     eof: i32,
     ungot: i32, // For ungetc, -1 if empty
+    buf: *mut u8,
+    pos: usize,
+    len: usize,
+    mode: BufMode,
+    /// Flush after each write ending a line (stdout) / never buffer (stderr)
+    line_buffered: bool,
+    unbuffered: bool,
+    /// Next stream in OPEN_FILES
+    next: *mut FILE,
+}
+
+impl FILE {
+    const fn new(fd: i32) -> Self {
+        FILE {
+            fd,
+            error: 0,
+            eof: 0,
+            ungot: -1,
+            buf: ptr::null_mut(),
+            pos: 0,
+            len: 0,
+            mode: BufMode::Idle,
+            line_buffered: false,
+            unbuffered: false,
+            next: ptr::null_mut(),
+        }
+    }
 }
 
 #[no_mangle]
@@ -47,9 +92,16 @@ pub static mut stderr: *mut FILE = ptr::null_mut();
 type TimeT = i64;
 
 // Static buffers for standard streams
-static mut STDIN_FILE: FILE = FILE { fd: 0, error: 0, eof: 0, ungot: -1 };
-static mut STDOUT_FILE: FILE = FILE { fd: 1, error: 0, eof: 0, ungot: -1 };
-static mut STDERR_FILE: FILE = FILE { fd: 2, error: 0, eof: 0, ungot: -1 };
+static mut STDIN_FILE: FILE = FILE::new(0);
+static mut STDOUT_FILE: FILE = FILE::new(1);
+static mut STDERR_FILE: FILE = FILE::new(2);
+
+/// Streams from fopen/fdopen, flushed by `fflush(NULL)` and at exit
+static mut OPEN_FILES: *mut FILE = ptr::null_mut();
+
+/// read/write syscalls made by the stdio functions (printed with `-vv`)
+static mut STDIO_READS: usize = 0;
+static mut STDIO_WRITES: usize = 0;
 
 // ============================================================================
 // Entry Point
@@ -66,6 +118,8 @@ pub extern "C" fn main() {
         stdin = &raw mut STDIN_FILE;
         stdout = &raw mut STDOUT_FILE;
         stderr = &raw mut STDERR_FILE;
+        (*stdout).line_buffered = true;
+        (*stderr).unbuffered = true;
 
         // Get args from libakuma
         let args_iter = libakuma::args();
@@ -74,15 +128,50 @@ pub extern "C" fn main() {
         let mut argv_strings: alloc::vec::Vec<alloc::string::String> = alloc::vec::Vec::new();
 
         let mut actual_args: alloc::vec::Vec<&str> = alloc::vec::Vec::new();
+        let mut cache_dir = None;
+        let mut jobs = 1;
+        let mut jobs_next = false;
+        let mut bench_mode = None;
         for arg in args_iter {
+            // Handled here, not by tcc
+            if let Some(dir) = arg.strip_prefix("-fheader-cache=") {
+                cache_dir = Some(dir);
+                continue;
+            }
+            if arg == "-fno-archive-index" {
+                archive_index::disable();
+                continue;
+            }
+            if jobs_next || (arg.starts_with("-j") && arg.len() > 2) {
+                jobs = arg.trim_start_matches("-j").parse().unwrap_or(1);
+                jobs_next = false;
+                continue;
+            }
+            if arg == "-j" {
+                jobs_next = true;
+                continue;
+            }
+            // tcc only knows -bench; the JSON report is the shim's
+            let arg = match arg {
+                "-bench" => {
+                    bench_mode = Some(false);
+                    arg
+                }
+                "-bench=json" => {
+                    bench_mode = Some(true);
+                    "-bench"
+                }
+                _ => arg,
+            };
             actual_args.push(arg);
             let s = alloc::string::String::from(arg) + "\0";
             argv_ptrs.push(s.as_ptr() as *const c_char);
             argv_strings.push(s);
         }
         argv_ptrs.push(ptr::null());
-
-        let argc = (argv_ptrs.len() - 1) as c_int;
+        if let Some(json) = bench_mode {
+            bench::enable(json);
+        }
 
         // Debug: check libraries to be sure
         if actual_args.iter().any(|&a| a == "-vv") {
@@ -100,28 +189,165 @@ pub extern "C" fn main() {
             }
         }
 
+        let verbose = actual_args.iter().any(|&a| a == "-vv");
+        let mut link_objects = alloc::vec::Vec::new();
+        if jobs > 1 {
+            let cache_arg = cache_dir.map(|d| alloc::format!("-fheader-cache={}", d));
+            let mut extra: alloc::vec::Vec<&str> = cache_arg.as_deref().into_iter().collect();
+            if bench_mode == Some(true) {
+                extra.push("-bench=json");
+            }
+            match parallel::run(&actual_args, jobs, &extra) {
+                parallel::Outcome::Serial => {}
+                parallel::Outcome::Done(code) => tcc_exit(code),
+                parallel::Outcome::Link(args, objects) => {
+                    // The parent only links
+                    argv_strings = args.into_iter().map(|a| a + "\0").collect();
+                    argv_ptrs = argv_strings.iter().map(|s| s.as_ptr() as *const c_char).collect();
+                    argv_ptrs.push(ptr::null());
+                    link_objects = objects;
+                }
+            }
+        }
+        let argc = (argv_ptrs.len() - 1) as c_int;
+        let cache = cache_dir.and_then(|dir| header_cache::Plan::new(dir, &actual_args));
+        if let Some(plan) = &cache {
+            if plan.replay() {
+                if verbose {
+                    libakuma::println("tcc: debug: header cache hit");
+                }
+                tcc_exit(0);
+            }
+            plan.record();
+        }
         let ret = tcc_main(argc, argv_ptrs.as_ptr());
-        akuma_exit(ret); // Use akuma_exit here
+        parallel::remove_all(&link_objects);
+        if ret == 0 {
+            if let Some(plan) = &cache {
+                plan.store();
+            }
+        }
+        if verbose {
+            fflush(ptr::null_mut());
+            let (reads, writes) = (STDIO_READS, STDIO_WRITES);
+            libakuma::println(&alloc::format!(
+                "tcc: debug: stdio made {} read and {} write syscalls",
+                reads, writes
+            ));
+            let (mapped, reused) = (INPUTS_MAPPED, INPUTS_REUSED);
+            libakuma::println(&alloc::format!(
+                "tcc: debug: mapped {} input files, reused {} mappings",
+                mapped, reused
+            ));
+            let (loaded, built) = (archive_index::INDEXES_LOADED, archive_index::INDEXES_BUILT);
+            libakuma::println(&alloc::format!(
+                "tcc: debug: archive index: {} loaded, {} built",
+                loaded, built
+            ));
+            let (calls, arena, chunks) = (MALLOC_CALLS, ARENA_ALLOCS, ARENA_BYTES);
+            libakuma::println(&alloc::format!(
+                "tcc: debug: {} mallocs, {} from the arena ({} KB of chunks)",
+                calls, arena, chunks / 1024
+            ));
+        }
+        tcc_exit(ret);
     }
 }
 
+/// `exit` for the C code (build.rs defines `exit` as `tcc_exit`): flush
+/// every stream first, as libakuma's exit is a bare syscall
+#[no_mangle]
+pub unsafe extern "C" fn tcc_exit(code: c_int) -> ! {
+    fflush(ptr::null_mut());
+    bench::report(MALLOC_CALLS, ARENA_BYTES);
+    akuma_exit(code)
+}
+
 // ============================================================================
 // Memory Allocation
 // ============================================================================
 
+// Every block carries its rounded size in an 8-byte header. Blocks of up
+// to ARENA_MAX_BLOCK bytes (tokens, symbols, hash entries: the bulk of
+// tcc's allocations) are carved from ARENA_CHUNK-sized chunks and recycled
+// through per-size free lists, so tcc's many small malloc/free pairs stay
+// out of the global allocator. Chunks are never returned; the process exit
+// after tcc_delete releases them all at once. Larger blocks (section data,
+// grown by tcc doubling them with realloc) go to the global allocator.
+
+/// Serve small blocks from the arena (false: everything from the global
+/// allocator, as before)
+const USE_ARENA: bool = true;
+const ARENA_CHUNK: usize = 64 * 1024;
+/// Largest block (header included) served by the arena
+const ARENA_MAX_BLOCK: usize = 512;
+/// Arena block sizes are multiples of this
+const ARENA_GRAIN: usize = 16;
+
+/// Free arena blocks of each size, linked through their payload
+static mut ARENA_FREE: [*mut u8; ARENA_MAX_BLOCK / ARENA_GRAIN] = [ptr::null_mut(); ARENA_MAX_BLOCK / ARENA_GRAIN];
+/// Unused tail of the current chunk
+static mut ARENA_NEXT: usize = 0;
+static mut ARENA_END: usize = 0;
+
+/// malloc calls, those served by the arena, and chunk bytes taken for it
+/// (printed with `-vv`)
+static mut MALLOC_CALLS: usize = 0;
+static mut ARENA_ALLOCS: usize = 0;
+static mut ARENA_BYTES: usize = 0;
+
+/// Header-included size of a block for `size` payload bytes
+fn block_size(size: usize) -> usize {
+    if USE_ARENA && size + 8 <= ARENA_MAX_BLOCK {
+        (size + 8 + ARENA_GRAIN - 1) & !(ARENA_GRAIN - 1)
+    } else {
+        // Ensure size + 8 is a multiple of 8 for Layout
+        (size + 8 + 7) & !7
+    }
+}
+
+/// A free or fresh arena block of `alloc_size` bytes
+unsafe fn arena_alloc(alloc_size: usize) -> *mut u8 {
+    let class = alloc_size / ARENA_GRAIN - 1;
+    let head = ARENA_FREE[class];
+    if !head.is_null() {
+        ARENA_FREE[class] = *(head.add(8) as *mut *mut u8);
+        return head;
+    }
+    if ARENA_END - ARENA_NEXT < alloc_size {
+        let chunk = alloc::alloc::alloc(Layout::from_size_align_unchecked(ARENA_CHUNK, ARENA_GRAIN));
+        if chunk.is_null() {
+            return ptr::null_mut();
+        }
+        // The old chunk's tail is too small for this block; abandon it
+        ARENA_NEXT = chunk as usize;
+        ARENA_END = chunk as usize + ARENA_CHUNK;
+        ARENA_BYTES += ARENA_CHUNK;
+    }
+    let block = ARENA_NEXT as *mut u8;
+    ARENA_NEXT += alloc_size;
+    block
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn malloc(size: usize) -> *mut c_void {
-    // Ensure size + 8 is a multiple of 8 for Layout
-    let alloc_size = (size + 8 + 7) & !7;
-    let layout = match Layout::from_size_align(alloc_size, 8) {
-        Ok(l) => l,
-        Err(_) => return ptr::null_mut(),
+    MALLOC_CALLS += 1;
+    let alloc_size = block_size(size);
+    let ptr = if alloc_size <= ARENA_MAX_BLOCK && USE_ARENA {
+        ARENA_ALLOCS += 1;
+        arena_alloc(alloc_size)
+    } else {
+        let layout = match Layout::from_size_align(alloc_size, 8) {
+            Ok(l) => l,
+            Err(_) => return ptr::null_mut(),
+        };
+        alloc::alloc::alloc(layout)
     };
-    let ptr = alloc::alloc::alloc(layout);
     if ptr.is_null() {
         return ptr::null_mut();
     }
     *(ptr as *mut usize) = alloc_size;
+    bench::allocated(alloc_size);
     ptr.add(8) as *mut c_void
 }
 
@@ -132,6 +358,13 @@ pub unsafe extern "C" fn free(ptr: *mut c_void) {
     }
     let real_ptr = (ptr as *mut u8).sub(8);
     let alloc_size = *(real_ptr as *const usize);
+    bench::freed(alloc_size);
+    if USE_ARENA && alloc_size <= ARENA_MAX_BLOCK {
+        let class = alloc_size / ARENA_GRAIN - 1;
+        *(ptr as *mut *mut u8) = ARENA_FREE[class];
+        ARENA_FREE[class] = real_ptr;
+        return;
+    }
     let layout = match Layout::from_size_align(alloc_size, 8) {
         Ok(l) => l,
         Err(_) => return,
@@ -147,19 +380,33 @@ pub unsafe extern "C" fn realloc(ptr: *mut c_void, new_size: usize) -> *mut c_vo
     
     let real_ptr = (ptr as *mut u8).sub(8);
     let old_alloc_size = *(real_ptr as *const usize);
+    let new_alloc_size = block_size(new_size);
+    if USE_ARENA && (old_alloc_size <= ARENA_MAX_BLOCK || new_alloc_size <= ARENA_MAX_BLOCK) {
+        if new_alloc_size == old_alloc_size {
+            return ptr;
+        }
+        // Moving into, out of or within the arena
+        let new_ptr = malloc(new_size);
+        if !new_ptr.is_null() {
+            ptr::copy_nonoverlapping(ptr as *const u8, new_ptr as *mut u8, (old_alloc_size - 8).min(new_size));
+            free(ptr);
+        }
+        return new_ptr;
+    }
     
     let old_layout = match Layout::from_size_align(old_alloc_size, 8) {
         Ok(l) => l,
         Err(_) => return ptr::null_mut(),
     };
     
-    let new_alloc_size = (new_size + 8 + 7) & !7;
     let new_ptr = alloc::alloc::realloc(real_ptr, old_layout, new_alloc_size);
     if new_ptr.is_null() {
         return ptr::null_mut();
     }
     
     *(new_ptr as *mut usize) = new_alloc_size;
+    bench::freed(old_alloc_size);
+    bench::allocated(new_alloc_size);
     new_ptr.add(8) as *mut c_void
 }
 
@@ -177,11 +424,120 @@ pub unsafe extern "C" fn calloc(nmemb: usize, size: usize) -> *mut c_void {
 // File I/O
 // ============================================================================
 
+/// Most input files kept mapped; beyond this, closed ones are unmapped
+const MAX_MAPPED_INPUTS: usize = 256;
+const PAGE_SIZE: usize = 4096;
+/// Regular file bits of st_mode
+const S_IFMT: u32 = 0o170000;
+const S_IFREG: u32 = 0o100000;
+
+/// A read-only input file served from a private mapping of it. `read` and
+/// `lseek` on its fd copy out of the mapping instead of making syscalls.
+/// The mapping outlives `close`, so a header opened again by the next
+/// translation unit is not read a second time. For an archive, reads of its
+/// symbol table see the reordered one from `archive_index`.
+struct MappedInput {
+    path: alloc::string::String,
+    ino: u64,
+    size: usize,
+    mtime: i64,
+    addr: usize,
+    /// Open descriptor, or -1 once closed
+    fd: c_int,
+    pos: usize,
+    armap: Option<archive_index::Armap>,
+}
+
+static mut MAPPED_INPUTS: alloc::vec::Vec<MappedInput> = alloc::vec::Vec::new();
+
+/// Files mapped and mappings reused by a later `open` (printed with `-vv`)
+static mut INPUTS_MAPPED: usize = 0;
+static mut INPUTS_REUSED: usize = 0;
+
+/// The mapped input open as `fd`, if any
+unsafe fn mapped_input(fd: c_int) -> Option<&'static mut MappedInput> {
+    if fd < 0 {
+        return None;
+    }
+    (*&raw mut MAPPED_INPUTS).iter_mut().find(|m| m.fd == fd)
+}
+
+/// Serve the read-only `fd` of `path` from a mapping: reuse one of the same
+/// unchanged file, or map it now. Files that are empty, not regular or fail
+/// to map are left to plain reads.
+unsafe fn map_input(fd: c_int, path: &str) {
+    let t0 = bench::begin();
+    let stat = libakuma::fstat(fd);
+    bench::end(bench::Op::Stat, t0, 0);
+    let stat = match stat {
+        Ok(s) => s,
+        Err(_) => return,
+    };
+    let size = stat.st_size as usize;
+    if stat.st_mode & S_IFMT != S_IFREG || size == 0 {
+        return;
+    }
+    let inputs = &mut *&raw mut MAPPED_INPUTS;
+    if let Some(i) = inputs.iter().position(|m| m.path == path) {
+        let m = &mut inputs[i];
+        if m.fd < 0 && m.ino == stat.st_ino && m.size == size && m.mtime == stat.st_mtime {
+            m.fd = fd;
+            m.pos = 0;
+            INPUTS_REUSED += 1;
+            return;
+        }
+        if m.fd >= 0 {
+            // Open twice at once: the second descriptor reads normally
+            return;
+        }
+        // Changed since it was mapped
+        let old = inputs.remove(i);
+        unmap_input(&old);
+    }
+    let t0 = bench::begin();
+    let addr = akuma_mmap_fd(0, size, mmap_flags::PROT_READ, mmap_flags::MAP_PRIVATE, fd, 0);
+    bench::end(bench::Op::Mmap, t0, 0);
+    if addr == 0 || addr > usize::MAX - PAGE_SIZE {
+        return;
+    }
+    if inputs.len() >= MAX_MAPPED_INPUTS {
+        if let Some(i) = inputs.iter().position(|m| m.fd < 0) {
+            let old = inputs.remove(i);
+            unmap_input(&old);
+        }
+    }
+    let armap = archive_index::load(path, &stat, core::slice::from_raw_parts(addr as *const u8, size));
+    inputs.push(MappedInput {
+        path: alloc::string::String::from(path),
+        ino: stat.st_ino,
+        size,
+        mtime: stat.st_mtime,
+        addr,
+        fd,
+        pos: 0,
+        armap,
+    });
+    INPUTS_MAPPED += 1;
+}
+
+unsafe fn unmap_input(m: &MappedInput) {
+    let t0 = bench::begin();
+    akuma_munmap(m.addr, page_round(m.size));
+    bench::end(bench::Op::Munmap, t0, 0);
+}
+
+fn page_round(len: usize) -> usize {
+    (len + PAGE_SIZE - 1) & !(PAGE_SIZE - 1)
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn open(pathname: *const c_char, flags: c_int, _mode: c_int) -> c_int {
     let path = cstr_to_str(pathname);
+    bench::opening(path, flags as u32);
+    let t0 = bench::begin();
     let fd = akuma_open(path, flags as u32);
-    
+    bench::end(bench::Op::Open, t0, 0);
+
     // Log library and object file access to help debug search paths and linking
     if path.contains("crt") || path.contains(".a") || path.contains(".o") {
         if fd >= 0 {
@@ -190,24 +546,63 @@ pub unsafe extern "C" fn open(pathname: *const c_char, flags: c_int, _mode: c_in
             libakuma::eprintln(&alloc::format!("tcc: open('{}') -> FAILED ({})", path, fd));
         }
     }
+    // Inputs (access mode O_RDONLY) are read out of a mapping
+    if flags as u32 & 3 == open_flags::O_RDONLY {
+        header_cache::record_open(path, fd);
+        if fd >= 0 {
+            map_input(fd, path);
+        }
+    }
     fd
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn read(fd: c_int, buf: *mut c_void, count: usize) -> isize {
+    if let Some(m) = mapped_input(fd) {
+        let n = count.min(m.size.saturating_sub(m.pos));
+        ptr::copy_nonoverlapping((m.addr + m.pos) as *const u8, buf as *mut u8, n);
+        if let Some(armap) = &m.armap {
+            armap.patch(m.pos, core::slice::from_raw_parts_mut(buf as *mut u8, n));
+        }
+        m.pos += n;
+        bench::count(bench::Op::Mapped, n);
+        return n as isize;
+    }
     let buf_slice = core::slice::from_raw_parts_mut(buf as *mut u8, count);
-    libakuma::read_fd(fd, buf_slice)
+    let t0 = bench::begin();
+    let n = libakuma::read_fd(fd, buf_slice);
+    bench::end(bench::Op::Read, t0, n.max(0) as usize);
+    n
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn write(fd: c_int, buf: *const c_void, count: usize) -> isize {
     let buf_slice = core::slice::from_raw_parts(buf as *const u8, count);
-    libakuma::write_fd(fd, buf_slice)
+    let t0 = bench::begin();
+    let n = libakuma::write_fd(fd, buf_slice);
+    bench::end(bench::Op::Write, t0, n.max(0) as usize);
+    n
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn lseek(fd: c_int, offset: i64, whence: c_int) -> i64 {
-    libakuma::lseek(fd, offset, whence)
+    if let Some(m) = mapped_input(fd) {
+        let base = match whence {
+            seek_mode::SEEK_SET => 0,
+            seek_mode::SEEK_CUR => m.pos as i64,
+            seek_mode::SEEK_END => m.size as i64,
+            _ => return -1,
+        };
+        if base + offset < 0 {
+            return -1;
+        }
+        m.pos = (base + offset) as usize;
+        return m.pos as i64;
+    }
+    let t0 = bench::begin();
+    let pos = libakuma::lseek(fd, offset, whence);
+    bench::end(bench::Op::Lseek, t0, 0);
+    pos
 }
 
 #[no_mangle]
@@ -223,10 +618,17 @@ pub unsafe extern "C" fn getcwd(buf: *mut c_char, size: usize) -> *mut c_char {
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn mmap(addr: *mut c_void, length: usize, prot: c_int, flags: c_int, _fd: c_int, _offset: i64) -> *mut c_void {
-    // libakuma::mmap(addr, len, prot, flags)
-    let ret = akuma_mmap(addr as usize, length, prot as u32, flags as u32);
-    if ret == usize::MAX {
+pub unsafe extern "C" fn mmap(addr: *mut c_void, length: usize, prot: c_int, flags: c_int, fd: c_int, offset: i64) -> *mut c_void {
+    let t0 = bench::begin();
+    let ret = if flags as u32 & mmap_flags::MAP_ANONYMOUS == 0 && fd >= 0 {
+        // File-backed (read-only or private): demand-paged from the file
+        akuma_mmap_fd(addr as usize, length, prot as u32, flags as u32, fd, offset as usize)
+    } else {
+        akuma_mmap(addr as usize, length, prot as u32, flags as u32)
+    };
+    bench::end(bench::Op::Mmap, t0, 0);
+    // The kernel returns a negated errno on failure
+    if ret > usize::MAX - PAGE_SIZE {
         return -1isize as *mut c_void; // MAP_FAILED
     }
     ret as *mut c_void
@@ -234,13 +636,16 @@ pub unsafe extern "C" fn mmap(addr: *mut c_void, length: usize, prot: c_int, fla
 
 #[no_mangle]
 pub unsafe extern "C" fn munmap(addr: *mut c_void, length: usize) -> c_int {
-    akuma_munmap(addr as usize, length) as c_int
+    let t0 = bench::begin();
+    let ret = akuma_munmap(addr as usize, length) as c_int;
+    bench::end(bench::Op::Munmap, t0, 0);
+    ret
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn mprotect(_addr: *mut c_void, _len: usize, _prot: c_int) -> c_int {
-    // Stub: assume success (or kernel doesn't support changing protections yet)
-    0
+pub unsafe extern "C" fn mprotect(addr: *mut c_void, len: usize, prot: c_int) -> c_int {
+    // tcc -run makes its relocated code executable with this
+    if libakuma::mprotect(addr as usize, len, prot as u32) < 0 { -1 } else { 0 }
 }
 
 #[no_mangle]
@@ -249,6 +654,83 @@ pub unsafe extern "C" fn fcntl(_fd: c_int, _cmd: c_int, _arg: c_int) -> c_int {
     0
 }
 
+/// Write all of `data` to `fd`; false on error
+unsafe fn write_all(fd: i32, mut data: &[u8]) -> bool {
+    while !data.is_empty() {
+        STDIO_WRITES += 1;
+        let t0 = bench::begin();
+        let n = write_fd(fd, data);
+        bench::end(bench::Op::Write, t0, n.max(0) as usize);
+        if n <= 0 {
+            return false;
+        }
+        data = &data[n as usize..];
+    }
+    true
+}
+
+/// Allocate the stream's buffer if it has none; false for unbuffered streams
+/// (or out of memory)
+unsafe fn stream_buffer(f: &mut FILE) -> bool {
+    if f.buf.is_null() && !f.unbuffered {
+        f.buf = malloc(STDIO_BUF_SIZE) as *mut u8;
+    }
+    !f.buf.is_null()
+}
+
+/// Bring the fd offset to the stream's position: write out pending data, or
+/// seek back over read-ahead the caller has not consumed
+unsafe fn stream_sync(f: &mut FILE) -> c_int {
+    let mode = f.mode;
+    let (pos, len) = (f.pos, f.len);
+    f.mode = BufMode::Idle;
+    f.pos = 0;
+    f.len = 0;
+    match mode {
+        BufMode::Writing => {
+            if !write_all(f.fd, core::slice::from_raw_parts(f.buf, pos)) {
+                f.error = 1;
+                return -1;
+            }
+        }
+        BufMode::Reading => {
+            if len > pos {
+                lseek(f.fd, -((len - pos) as i64), seek_mode::SEEK_CUR);
+            }
+        }
+        BufMode::Idle => {}
+    }
+    0
+}
+
+/// Allocate a stream for `fd` and add it to OPEN_FILES
+unsafe fn stream_new(fd: i32) -> *mut FILE {
+    let file = malloc(core::mem::size_of::<FILE>()) as *mut FILE;
+    if file.is_null() {
+        return ptr::null_mut();
+    }
+    ptr::write(file, FILE::new(fd));
+    (*file).next = OPEN_FILES;
+    OPEN_FILES = file;
+    file
+}
+
+/// Remove a stream from OPEN_FILES and free it and its buffer
+unsafe fn stream_free(stream: *mut FILE) {
+    let mut link = &raw mut OPEN_FILES;
+    while !(*link).is_null() {
+        if *link == stream {
+            *link = (*stream).next;
+            break;
+        }
+        link = &raw mut (**link).next;
+    }
+    if !(*stream).buf.is_null() {
+        free((*stream).buf as *mut c_void);
+    }
+    free(stream as *mut c_void);
+}
+
 #[no_mangle]
 pub unsafe extern "C" fn fopen(filename: *const c_char, mode: *const c_char) -> *mut FILE {
     let _filename_str = cstr_to_str(filename);
@@ -275,31 +757,16 @@ pub unsafe extern "C" fn fopen(filename: *const c_char, mode: *const c_char) ->
         return ptr::null_mut();
     }
 
-    let file = malloc(core::mem::size_of::<FILE>()) as *mut FILE;
+    let file = stream_new(fd);
     if file.is_null() {
         close(fd);
-        return ptr::null_mut();
     }
-    
-    (*file).fd = fd;
-    (*file).error = 0;
-    (*file).eof = 0;
-    (*file).ungot = -1;
-    
     file
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn fdopen(fd: i32, _mode: *const c_char) -> *mut FILE {
-    let file = malloc(core::mem::size_of::<FILE>()) as *mut FILE;
-    if file.is_null() {
-        return ptr::null_mut();
-    }
-    (*file).fd = fd;
-    (*file).error = 0;
-    (*file).eof = 0;
-    (*file).ungot = -1;
-    file
+    stream_new(fd)
 }
 
 #[no_mangle]
@@ -307,45 +774,71 @@ pub unsafe extern "C" fn fclose(stream: *mut FILE) -> c_int {
     if stream.is_null() {
         return -1;
     }
+    let ret = stream_sync(&mut *stream);
     // Don't close stdin/stdout/stderr if they are static
     if stream == stdin || stream == stdout || stream == stderr {
-        return 0;
+        return ret;
     }
     
     let fd = (*stream).fd;
     close(fd);
-    free(stream as *mut c_void);
-    0
+    stream_free(stream);
+    ret
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn fread(ptr: *mut c_void, size: usize, nmemb: usize, stream: *mut FILE) -> usize {
-    if stream.is_null() {
+    if stream.is_null() || size == 0 {
         return 0;
     }
-    
-    let mut total_bytes = size * nmemb;
+    let f = &mut *stream;
+    let total_bytes = size * nmemb;
+    let out = ptr as *mut u8;
     let mut bytes_read = 0;
-    let mut buf_ptr = ptr as *mut u8;
 
     // Handle ungot char
-    if (*stream).ungot != -1 {
-        *buf_ptr = (*stream).ungot as u8;
-        buf_ptr = buf_ptr.add(1);
+    if f.ungot != -1 && total_bytes > 0 {
+        *out = f.ungot as u8;
         bytes_read += 1;
-        total_bytes -= 1;
-        (*stream).ungot = -1;
+        f.ungot = -1;
+    }
+    if f.mode == BufMode::Writing && stream_sync(f) < 0 {
+        return bytes_read / size;
     }
 
-    if total_bytes > 0 {
-        let buf = core::slice::from_raw_parts_mut(buf_ptr, total_bytes);
-        let n = read_fd((*stream).fd, buf);
+    while bytes_read < total_bytes {
+        let want = total_bytes - bytes_read;
+        if f.mode == BufMode::Reading && f.pos < f.len {
+            let n = want.min(f.len - f.pos);
+            ptr::copy_nonoverlapping(f.buf.add(f.pos), out.add(bytes_read), n);
+            f.pos += n;
+            bytes_read += n;
+            continue;
+        }
+        // Large reads go straight to the caller's memory
+        let direct = want >= STDIO_BUF_SIZE || !stream_buffer(f);
+        let dest = if direct {
+            core::slice::from_raw_parts_mut(out.add(bytes_read), want)
+        } else {
+            core::slice::from_raw_parts_mut(f.buf, STDIO_BUF_SIZE)
+        };
+        STDIO_READS += 1;
+        let t0 = bench::begin();
+        let n = read_fd(f.fd, dest);
+        bench::end(bench::Op::Read, t0, n.max(0) as usize);
         if n < 0 {
-            (*stream).error = 1;
+            f.error = 1;
+            break;
         } else if n == 0 {
-            (*stream).eof = 1;
-        } else {
+            f.eof = 1;
+            break;
+        }
+        if direct {
             bytes_read += n as usize;
+        } else {
+            f.mode = BufMode::Reading;
+            f.pos = 0;
+            f.len = n as usize;
         }
     }
     
@@ -354,26 +847,57 @@ pub unsafe extern "C" fn fread(ptr: *mut c_void, size: usize, nmemb: usize, stre
 
 #[no_mangle]
 pub unsafe extern "C" fn fwrite(ptr: *const c_void, size: usize, nmemb: usize, stream: *mut FILE) -> usize {
-    if stream.is_null() {
+    if stream.is_null() || size == 0 {
         return 0;
     }
+    let f = &mut *stream;
     let total_bytes = size * nmemb;
-    let buf = core::slice::from_raw_parts(ptr as *const u8, total_bytes);
-    let n = write_fd((*stream).fd, buf);
+    let data = core::slice::from_raw_parts(ptr as *const u8, total_bytes);
+    if f.mode == BufMode::Reading {
+        stream_sync(f);
+    }
+
+    let ok = if !stream_buffer(f) {
+        write_all(f.fd, data)
+    } else {
+        let mut ok = true;
+        if f.pos + total_bytes > STDIO_BUF_SIZE {
+            ok = stream_sync(f) == 0;
+        }
+        if !ok {
+            false
+        } else if total_bytes >= STDIO_BUF_SIZE {
+            // Too big to be worth copying
+            write_all(f.fd, data)
+        } else {
+            ptr::copy_nonoverlapping(data.as_ptr(), f.buf.add(f.pos), total_bytes);
+            f.pos += total_bytes;
+            f.mode = BufMode::Writing;
+            !(f.line_buffered && data.contains(&b'\n')) || stream_sync(f) == 0
+        }
+    };
     
-    if n < 0 {
-        (*stream).error = 1;
-        0
+    if ok {
+        nmemb
     } else {
-        (n as usize) / size
+        f.error = 1;
+        0
     }
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn fputc(c: c_int, stream: *mut FILE) -> c_int {
+    if !stream.is_null() {
+        let f = &mut *stream;
+        if f.mode == BufMode::Writing && f.pos < STDIO_BUF_SIZE && !(f.line_buffered && c as u8 == b'\n') {
+            *f.buf.add(f.pos) = c as u8;
+            f.pos += 1;
+            return c as u8 as c_int;
+        }
+    }
     let buf = [c as u8];
     if fwrite(buf.as_ptr() as *const c_void, 1, 1, stream) == 1 {
-        c
+        c as u8 as c_int
     } else {
         -1 // EOF
     }
@@ -381,6 +905,14 @@ pub unsafe extern "C" fn fputc(c: c_int, stream: *mut FILE) -> c_int {
 
 #[no_mangle]
 pub unsafe extern "C" fn fgetc(stream: *mut FILE) -> c_int {
+    if !stream.is_null() {
+        let f = &mut *stream;
+        if f.ungot == -1 && f.mode == BufMode::Reading && f.pos < f.len {
+            let c = *f.buf.add(f.pos);
+            f.pos += 1;
+            return c as c_int;
+        }
+    }
     let mut c = 0u8;
     if fread(&mut c as *mut u8 as *mut c_void, 1, 1, stream) == 1 {
         c as c_int
@@ -395,6 +927,7 @@ pub unsafe extern "C" fn ungetc(c: c_int, stream: *mut FILE) -> c_int {
         return -1;
     }
     (*stream).ungot = c;
+    (*stream).eof = 0;
     c
 }
 
@@ -426,19 +959,48 @@ pub unsafe extern "C" fn fputs(s: *const c_char, stream: *mut FILE) -> c_int {
     }
 }
 
+/// Write out a stream's buffer; NULL flushes every stream
 #[no_mangle]
-pub unsafe extern "C" fn fflush(_stream: *mut FILE) -> c_int {
-    0 // No buffering yet
+pub unsafe extern "C" fn fflush(stream: *mut FILE) -> c_int {
+    if !stream.is_null() {
+        return stream_sync(&mut *stream);
+    }
+    let mut ret = 0;
+    for f in [stdout, stderr] {
+        if !f.is_null() && (*f).mode == BufMode::Writing && stream_sync(&mut *f) < 0 {
+            ret = -1;
+        }
+    }
+    let mut f = OPEN_FILES;
+    while !f.is_null() {
+        if (*f).mode == BufMode::Writing && stream_sync(&mut *f) < 0 {
+            ret = -1;
+        }
+        f = (*f).next;
+    }
+    ret
 }
 
 #[no_mangle]
-pub unsafe extern "C" fn fseek(stream: *mut FILE, offset: i64, whence: c_int) -> c_int {
+pub unsafe extern "C" fn fseek(stream: *mut FILE, mut offset: i64, whence: c_int) -> c_int {
     if stream.is_null() {
         return -1;
     }
-    (*stream).ungot = -1; // Clear ungot char
-    let res = lseek((*stream).fd, offset, whence);
-    if res < 0 { -1 } else { 0 }
+    let f = &mut *stream;
+    if stream_sync(f) < 0 {
+        return -1;
+    }
+    // SEEK_CUR counts from the logical position, before any pushed-back char
+    if whence == seek_mode::SEEK_CUR && f.ungot != -1 {
+        offset -= 1;
+    }
+    f.ungot = -1; // Clear ungot char
+    let res = lseek(f.fd, offset, whence);
+    if res < 0 {
+        return -1;
+    }
+    f.eof = 0;
+    0
 }
 
 #[no_mangle]
@@ -446,12 +1008,25 @@ pub unsafe extern "C" fn ftell(stream: *mut FILE) -> i64 {
     if stream.is_null() {
         return -1;
     }
-    lseek((*stream).fd, 0, seek_mode::SEEK_CUR)
+    let f = &*stream;
+    let pos = lseek(f.fd, 0, seek_mode::SEEK_CUR);
+    if pos < 0 {
+        return pos;
+    }
+    let ungot = if f.ungot != -1 { 1 } else { 0 };
+    match f.mode {
+        BufMode::Writing => pos + f.pos as i64,
+        BufMode::Reading => pos - (f.len - f.pos) as i64 - ungot,
+        BufMode::Idle => pos - ungot,
+    }
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn rewind(stream: *mut FILE) {
     fseek(stream, 0, seek_mode::SEEK_SET);
+    if !stream.is_null() {
+        (*stream).error = 0;
+    }
 }
 
 #[no_mangle]
@@ -477,10 +1052,17 @@ pub unsafe extern "C" fn rename(oldpath: *const c_char, newpath: *const c_char)
     akuma_rename(old, new)
 }
 
+/// Wall-clock time at boot in microseconds (0 without an RTC), set on the
+/// first gettimeofday
+static mut BOOT_TIME_US: Option<u64> = None;
+
+/// Boot time plus uptime(): microsecond resolution, and it still advances
+/// (from the epoch) without an RTC, so tcc -bench can time a run
 #[no_mangle]
 pub unsafe extern "C" fn gettimeofday(tv: *mut timeval, _tz: *mut c_void) -> c_int {
     if tv.is_null() { return -1; }
-    let us = libakuma::time();
+    let boot = *(*&raw mut BOOT_TIME_US).get_or_insert_with(|| libakuma::time().saturating_sub(libakuma::uptime()));
+    let us = boot + libakuma::uptime();
     (*tv).tv_sec = (us / 1_000_000) as i64;
     (*tv).tv_usec = (us % 1_000_000) as i64;
     0
@@ -503,7 +1085,10 @@ pub unsafe extern "C" fn fstat(fd: i32, statbuf: *mut Stat) -> c_int {
 }
 
 unsafe fn fstat_impl(fd: i32, statbuf: *mut Stat) -> c_int {
-    match libakuma::fstat(fd) {
+    let t0 = bench::begin();
+    let stat = libakuma::fstat(fd);
+    bench::end(bench::Op::Stat, t0, 0);
+    match stat {
         Ok(s) => {
             if !statbuf.is_null() {
                 *statbuf = s;
@@ -522,25 +1107,33 @@ pub unsafe extern "C" fn mkdir(pathname: *const c_char, _mode: u32) -> c_int {
 
 #[no_mangle]
 pub unsafe extern "C" fn close(fd: c_int) -> c_int {
-    akuma_close(fd)
+    if let Some(m) = mapped_input(fd) {
+        // Keep the mapping for the next open of the same file
+        m.fd = -1;
+    }
+    let t0 = bench::begin();
+    let ret = akuma_close(fd);
+    bench::end(bench::Op::Close, t0, 0);
+    ret
 }
 
 #[no_mangle]
 pub unsafe extern "C" fn freopen(filename: *const c_char, mode: *const c_char, stream: *mut FILE) -> *mut FILE {
     if stream.is_null() { return ptr::null_mut(); }
     
+    stream_sync(&mut *stream);
     akuma_close((*stream).fd); 
 
     let new_stream_ptr = fopen(filename, mode);
     if new_stream_ptr.is_null() { return ptr::null_mut(); }
     
-    let new_stream = &*new_stream_ptr;
-    (*stream).fd = new_stream.fd;
-    (*stream).error = new_stream.error;
-    (*stream).eof = new_stream.eof;
-    (*stream).ungot = new_stream.ungot;
+    // Keep the caller's FILE (and its buffer) on the new fd
+    (*stream).fd = (*new_stream_ptr).fd;
+    (*stream).error = 0;
+    (*stream).eof = 0;
+    (*stream).ungot = -1;
     
-    free(new_stream_ptr as *mut c_void);
+    stream_free(new_stream_ptr);
     
     stream
 }
@@ -556,15 +1149,7 @@ pub unsafe extern "C" fn getenv(_name: *const c_char) -> *mut c_char {
     ptr::null_mut() // No environment variables supported yet
 }
 
-#[no_mangle]
-pub unsafe extern "C" fn strtod(_nptr: *const c_char, _endptr: *mut *mut c_char) -> f64 {
-    0.0 // Stub
-}
-
-#[no_mangle]
-pub unsafe extern "C" fn strtof(_nptr: *const c_char, _endptr: *mut *mut c_char) -> f32 {
-    0.0f32 // Stub
-}
+// strtod/strtof come from the shared ../cshim/dtoa.c
 
 #[no_mangle]
 pub unsafe extern "C" fn strtold(_nptr: *const c_char, _endptr: *mut *mut c_char) -> f64 { // long double as f64
@@ -0,0 +1,182 @@
+//! Parallel compiles (`tcc -j N`)
+//!
+//! tcc keeps its state in globals, so translation units cannot share a
+//! process. With `-j N` and several `.c` inputs each one is compiled by a
+//! separate `tcc -c` (spawned from this binary), at most N at a time, and
+//! the parent then runs the link itself with the objects in place of the
+//! sources. Each worker's output is printed in one piece when it exits, so
+//! diagnostics of different files do not interleave.
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use libakuma::{read_fd, sleep_ms, waitpid, SpawnResult};
+
+use crate::header_cache::TAKES_ARG;
+
+/// Where the binary is installed, when argv[0] is not a path
+const TCC_PATH: &str = "/bin/tcc";
+
+/// A running worker
+struct Worker {
+    child: SpawnResult,
+    source: usize,
+    output: Vec<u8>,
+}
+
+/// What is left for the caller after the workers
+pub enum Outcome {
+    /// Nothing to parallelize: run tcc on the arguments unchanged
+    Serial,
+    /// Every source compiled and `-c` was given: exit with this code. Also
+    /// used for a failed worker.
+    Done(i32),
+    /// Link: run tcc on these arguments (objects in place of sources),
+    /// then remove the temporary objects
+    Link(Vec<String>, Vec<String>),
+}
+
+/// Compile the `.c` inputs of `args` with up to `jobs` workers
+/// (`extra` is passed to each worker, e.g. the header cache option)
+pub fn run(args: &[&str], jobs: usize, extra: &[&str]) -> Outcome {
+    let mut sources = Vec::new();
+    let mut compile_only = false;
+    let mut gen_deps = false;
+    let mut i = 1;
+    while i < args.len() {
+        let a = args[i];
+        match a {
+            "-c" => compile_only = true,
+            "-MD" => gen_deps = true,
+            "-E" | "-run" | "-" => return Outcome::Serial,
+            _ if a.starts_with("-M") => return Outcome::Serial,
+            _ if !a.starts_with('-') && a.ends_with(".c") => sources.push(i),
+            _ => {}
+        }
+        i += if TAKES_ARG.contains(&a) { 2 } else { 1 };
+    }
+    // Workers' -MD files are named after their objects, which are only the
+    // ones tcc would use with -c
+    if jobs < 2 || sources.len() < 2 || (gen_deps && !compile_only) {
+        return Outcome::Serial;
+    }
+
+    // Options shared by every worker: everything but the inputs and -o.
+    // Object and archive inputs only matter to the link.
+    let mut common: Vec<&str> = Vec::new();
+    let mut i = 1;
+    while i < args.len() {
+        let a = args[i];
+        if a == "-o" {
+            i += 2;
+            continue;
+        }
+        if TAKES_ARG.contains(&a) {
+            common.extend_from_slice(&args[i..(i + 2).min(args.len())]);
+            i += 2;
+            continue;
+        }
+        if a.starts_with('-') && a != "-c" {
+            common.push(a);
+        }
+        i += 1;
+    }
+    common.extend_from_slice(extra);
+
+    let objects: Vec<String> = sources
+        .iter()
+        .enumerate()
+        .map(|(n, &s)| {
+            if compile_only {
+                // As tcc -c names them: after the source, in the working directory
+                let src = args[s];
+                let base = &src[src.rfind('/').map_or(0, |p| p + 1)..];
+                alloc::format!("{}.o", &base[..base.len() - 2])
+            } else {
+                alloc::format!("/tmp/tcc-{}-{}.o", libakuma::getpid(), n)
+            }
+        })
+        .collect();
+    let tcc = if args[0].contains('/') { args[0] } else { TCC_PATH };
+
+    let mut next = 0;
+    let mut running: Vec<Worker> = Vec::new();
+    let mut failed = false;
+    while next < sources.len() || !running.is_empty() {
+        while !failed && next < sources.len() && running.len() < jobs {
+            let mut worker_args = common.clone();
+            worker_args.extend_from_slice(&["-c", args[sources[next]], "-o", &objects[next]]);
+            match libakuma::spawn(tcc, Some(&worker_args)) {
+                Some(child) => {
+                    libakuma::set_nonblocking(child.stdout_fd as i32, true);
+                    running.push(Worker { child, source: sources[next], output: Vec::new() });
+                }
+                None => {
+                    libakuma::eprintln(&alloc::format!("tcc: cannot start {} for {}", tcc, args[sources[next]]));
+                    failed = true;
+                }
+            }
+            next += 1;
+        }
+        if failed && next < sources.len() {
+            // Stop starting workers once one has failed
+            next = sources.len();
+        }
+
+        let mut progress = false;
+        let mut w = 0;
+        while w < running.len() {
+            let mut buf = [0u8; 4096];
+            let fd = running[w].child.stdout_fd as i32;
+            loop {
+                let n = read_fd(fd, &mut buf);
+                if n <= 0 {
+                    break;
+                }
+                running[w].output.extend_from_slice(&buf[..n as usize]);
+                progress = true;
+            }
+            if let Some((_, code)) = waitpid(running[w].child.pid) {
+                let mut worker = running.swap_remove(w);
+                loop {
+                    let n = read_fd(fd, &mut buf);
+                    if n <= 0 {
+                        break;
+                    }
+                    worker.output.extend_from_slice(&buf[..n as usize]);
+                }
+                libakuma::close(fd);
+                libakuma::write_fd(1, &worker.output);
+                if code != 0 {
+                    libakuma::eprintln(&alloc::format!("tcc: {} failed (exit {})", args[worker.source], code));
+                    failed = true;
+                }
+                progress = true;
+                continue;
+            }
+            w += 1;
+        }
+        if !progress {
+            sleep_ms(1);
+        }
+    }
+
+    if failed || compile_only {
+        if failed && !compile_only {
+            remove_all(&objects);
+        }
+        return Outcome::Done(if failed { 1 } else { 0 });
+    }
+    let mut link: Vec<String> = args.iter().map(|&a| String::from(a)).collect();
+    for (n, &s) in sources.iter().enumerate() {
+        link[s] = objects[n].clone();
+    }
+    Outcome::Link(link, objects)
+}
+
+/// Remove temporary objects
+pub fn remove_all(objects: &[String]) {
+    for o in objects {
+        libakuma::unlink(o);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * dlsym for tcc -run
+ *
+ * tcc resolves the undefined symbols of a program it runs in memory with
+ * dlsym(). Akuma has no dynamic libc to look them up in, so they bind to
+ * this binary's own libc: the Rust shims in main.rs and the C ones in
+ * libc_stubs.c. The program then shares tcc's heap and stdio buffers, and
+ * its exit() (built as tcc_exit, see build.rs) flushes them.
+ *
+ * No headers on purpose: every symbol is declared as an opaque object so
+ * functions and data can share one table. Only add names that are defined
+ * in one of those two files.
+ */
+
+#define RUN_SYMBOLS(X) \
+    /* memory */ \
+    X(malloc) X(free) X(realloc) X(calloc) \
+    X(mmap) X(munmap) X(mprotect) \
+    /* files and descriptors */ \
+    X(open) X(read) X(write) X(lseek) X(close) X(fcntl) \
+    X(stat) X(fstat) X(mkdir) X(remove) X(rename) X(unlink) \
+    X(getcwd) X(realpath) \
+    /* stdio */ \
+    X(stdin) X(stdout) X(stderr) \
+    X(fopen) X(fdopen) X(freopen) X(fclose) X(fread) X(fwrite) \
+    X(fputc) X(fgetc) X(ungetc) X(getc) X(putc) X(putchar) X(fputs) X(puts) \
+    X(fflush) X(fseek) X(ftell) X(rewind) X(ferror) X(feof) \
+    X(printf) X(fprintf) X(sprintf) X(snprintf) \
+    X(vprintf) X(vfprintf) X(vsnprintf) \
+    /* strings */ \
+    X(memset) X(memcpy) X(memmove) X(memcmp) X(memchr) \
+    X(strlen) X(strcmp) X(strncmp) X(strcpy) X(strncpy) X(strcat) \
+    X(strchr) X(strrchr) X(strstr) X(strpbrk) X(strdup) X(strerror) \
+    X(strtol) X(strtoul) X(strtoll) X(strtoull) \
+    X(strtod) X(strtof) X(strtold) X(atoi) X(ldexpl) \
+    /* process and time */ \
+    X(exit) X(getenv) X(system) X(sysconf) X(environ) \
+    X(errno) X(__errno_location) X(__assert_fail) \
+    X(time) X(gettimeofday) X(localtime)
+
+#define DECLARE(name) extern char name[];
+RUN_SYMBOLS(DECLARE)
+
+static const struct {
+    const char *name;
+    void *addr;
+} run_symbols[] = {
+#define ENTRY(name) { #name, name },
+    RUN_SYMBOLS(ENTRY)
+};
+
+static int streq(const char *a, const char *b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+void *dlsym(void *handle, const char *symbol)
+{
+    unsigned long i;
+
+    (void)handle;
+    for (i = 0; i < sizeof(run_symbols) / sizeof(run_symbols[0]); i++) {
+        if (streq(run_symbols[i].name, symbol))
+            return run_symbols[i].addr;
+    }
+    return 0;
+}